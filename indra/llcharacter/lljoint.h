@@ -30,6 +30,7 @@
 //-----------------------------------------------------------------------------
 // Header Files
 //-----------------------------------------------------------------------------
+#include <atomic>
 #include <string>
 #include <list>
 
@@ -148,9 +149,9 @@ public:
     typedef std::vector<LLJoint*> joints_t;
     joints_t mChildren;
 
-    // debug statics
-    static S32      sNumTouches;
-    static S32      sNumUpdates;
+    // debug statics, atomic since skeletons may update in parallel
+    static std::atomic<S32> sNumTouches;
+    static std::atomic<S32> sNumUpdates;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
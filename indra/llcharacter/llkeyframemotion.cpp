@@ -151,7 +151,7 @@ LLKeyframeMotion::ScaleCurve::~ScaleCurve()
 //-----------------------------------------------------------------------------
 // getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration) const
 {
     LLVector3 value;
 
@@ -161,34 +161,18 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
         return value;
     }
 
-    key_map_t::iterator right = mKeys.lower_bound(time);
-    if (right == mKeys.end())
+    S32 cursor = 0;
+    S32 before, after;
+    F32 u;
+    if (mKeys.locate(time, cursor, before, after, u))
     {
-        // Past last key
-        --right;
-        value = right->second.mScale;
-    }
-    else if (right == mKeys.begin() || right->first == time)
-    {
-        // Before first key or exactly on a key
-        value = right->second.mScale;
+        // Between two keys
+        value = interp(u, mKeys.getKey(before), mKeys.getKey(after));
     }
     else
     {
-        // Between two keys
-        key_map_t::iterator left = right; --left;
-        F32 index_before = left->first;
-        F32 index_after = right->first;
-        ScaleKey& scale_before = left->second;
-        ScaleKey& scale_after = right->second;
-        if (right == mKeys.end())
-        {
-            scale_after = mLoopInKey;
-            index_after = duration;
-        }
-
-        F32 u = (time - index_before) / (index_after - index_before);
-        value = interp(u, scale_before, scale_after);
+        // Before the first key, past the last or exactly on one
+        value = mKeys.getKey(before);
     }
     return value;
 }
@@ -196,17 +180,17 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey& after)
+LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, const LLVector3& before, const LLVector3& after) const
 {
     switch (mInterpolationType)
     {
     case IT_STEP:
-        return before.mScale;
+        return before;
 
     default:
     case IT_LINEAR:
     case IT_SPLINE:
-        return lerp(before.mScale, after.mScale, u);
+        return lerp(before, after, u);
     }
 }
 
@@ -231,7 +215,7 @@ LLKeyframeMotion::RotationCurve::~RotationCurve()
 //-----------------------------------------------------------------------------
 // RotationCurve::getValue()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration) const
 {
     LLQuaternion value;
 
@@ -241,34 +225,18 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
         return value;
     }
 
-    key_map_t::iterator right = mKeys.lower_bound(time);
-    if (right == mKeys.end())
-    {
-        // Past last key
-        --right;
-        value = right->second.mRotation;
-    }
-    else if (right == mKeys.begin() || right->first == time)
+    S32 cursor = 0;
+    S32 before, after;
+    F32 u;
+    if (mKeys.locate(time, cursor, before, after, u))
     {
-        // Before first key or exactly on a key
-        value = right->second.mRotation;
+        // Between two keys
+        value = interp(u, mKeys.getKey(before), mKeys.getKey(after));
     }
     else
     {
-        // Between two keys
-        key_map_t::iterator left = right; --left;
-        F32 index_before = left->first;
-        F32 index_after = right->first;
-        RotationKey& rot_before = left->second;
-        RotationKey& rot_after = right->second;
-        if (right == mKeys.end())
-        {
-            rot_after = mLoopInKey;
-            index_after = duration;
-        }
-
-        F32 u = (time - index_before) / (index_after - index_before);
-        value = interp(u, rot_before, rot_after);
+        // Before the first key, past the last or exactly on one
+        value = mKeys.getKey(before);
     }
     return value;
 }
@@ -276,17 +244,17 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, const LLQuaternion& before, const LLQuaternion& after) const
 {
     switch (mInterpolationType)
     {
     case IT_STEP:
-        return before.mRotation;
+        return before;
 
     default:
     case IT_LINEAR:
     case IT_SPLINE:
-        return nlerp(u, before.mRotation, after.mRotation);
+        return nlerp(u, before, after);
     }
 }
 
@@ -312,7 +280,7 @@ LLKeyframeMotion::PositionCurve::~PositionCurve()
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration) const
 {
     LLVector3 value;
 
@@ -322,34 +290,18 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
         return value;
     }
 
-    key_map_t::iterator right = mKeys.lower_bound(time);
-    if (right == mKeys.end())
+    S32 cursor = 0;
+    S32 before, after;
+    F32 u;
+    if (mKeys.locate(time, cursor, before, after, u))
     {
-        // Past last key
-        --right;
-        value = right->second.mPosition;
-    }
-    else if (right == mKeys.begin() || right->first == time)
-    {
-        // Before first key or exactly on a key
-        value = right->second.mPosition;
+        // Between two keys
+        value = interp(u, mKeys.getKey(before), mKeys.getKey(after));
     }
     else
     {
-        // Between two keys
-        key_map_t::iterator left = right; --left;
-        F32 index_before = left->first;
-        F32 index_after = right->first;
-        PositionKey& pos_before = left->second;
-        PositionKey& pos_after = right->second;
-        if (right == mKeys.end())
-        {
-            pos_after = mLoopInKey;
-            index_after = duration;
-        }
-
-        F32 u = (time - index_before) / (index_after - index_before);
-        value = interp(u, pos_before, pos_after);
+        // Before the first key, past the last or exactly on one
+        value = mKeys.getKey(before);
     }
 
     llassert(value.isFinite());
@@ -360,62 +312,16 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
+LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, const LLVector3& before, const LLVector3& after) const
 {
     switch (mInterpolationType)
     {
     case IT_STEP:
-        return before.mPosition;
+        return before;
     default:
     case IT_LINEAR:
     case IT_SPLINE:
-        return lerp(before.mPosition, after.mPosition, u);
-    }
-}
-
-
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-// JointMotion class
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-
-//-----------------------------------------------------------------------------
-// JointMotion::update()
-//-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
-{
-    // this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't
-    // managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
-    if ( joint_state == NULL )
-    {
-        return;
-    }
-
-    U32 usage = joint_state->getUsage();
-
-    //-------------------------------------------------------------------------
-    // update scale component of joint state
-    //-------------------------------------------------------------------------
-    if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
-    {
-        joint_state->setScale( mScaleCurve.getValue( time, duration ) );
-    }
-
-    //-------------------------------------------------------------------------
-    // update rotation component of joint state
-    //-------------------------------------------------------------------------
-    if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
-    {
-        joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
-    }
-
-    //-------------------------------------------------------------------------
-    // update position component of joint state
-    //-------------------------------------------------------------------------
-    if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
-    {
-        joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+        return lerp(before, after, u);
     }
 }
 
@@ -737,12 +643,66 @@ bool LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 //-----------------------------------------------------------------------------
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
-    llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
-    for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+    const U32 num_joints = mJointMotionList->getNumJointMotions();
+    llassert_always (num_joints <= mJointStates.size());
+
+    // Collect the curves each joint state uses, so that the samplers find
+    // the keys of all of them from their cursors and interpolate them in
+    // one pass. Curves are always linear once loaded.
+    mRotationTracks.assign(num_joints, NULL);
+    mPositionTracks.assign(num_joints, NULL);
+    mScaleTracks.assign(num_joints, NULL);
+    for (U32 i = 0; i < num_joints; i++)
     {
-        mJointMotionList->getJointMotion(i)->update(mJointStates[i],
-                                                      time,
-                                                      mJointMotionList->mDuration );
+        // this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't
+        // managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
+        LLJointState* joint_state = mJointStates[i];
+        if (!joint_state)
+        {
+            continue;
+        }
+
+        const JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
+        const U32 usage = joint_state->getUsage();
+        if ((usage & LLJointState::SCALE) && joint_motion->mScaleCurve.mNumKeys)
+        {
+            llassert(joint_motion->mScaleCurve.mInterpolationType != IT_STEP);
+            mScaleTracks[i] = &joint_motion->mScaleCurve.mKeys;
+        }
+        if ((usage & LLJointState::ROT) && joint_motion->mRotationCurve.mNumKeys)
+        {
+            llassert(joint_motion->mRotationCurve.mInterpolationType != IT_STEP);
+            mRotationTracks[i] = &joint_motion->mRotationCurve.mKeys;
+        }
+        if ((usage & LLJointState::POS) && joint_motion->mPositionCurve.mNumKeys)
+        {
+            llassert(joint_motion->mPositionCurve.mInterpolationType != IT_STEP);
+            mPositionTracks[i] = &joint_motion->mPositionCurve.mKeys;
+        }
+    }
+
+    mScales.resize(num_joints);
+    mRotations.resize(num_joints);
+    mPositions.resize(num_joints);
+    mScaleSampler.sample(time, mScaleTracks.data(), num_joints, mScales.data());
+    mRotationSampler.sample(time, mRotationTracks.data(), num_joints, mRotations.data());
+    mPositionSampler.sample(time, mPositionTracks.data(), num_joints, mPositions.data());
+
+    for (U32 i = 0; i < num_joints; i++)
+    {
+        if (mScaleTracks[i] && !mScaleTracks[i]->empty())
+        {
+            mJointStates[i]->setScale(mScales[i]);
+        }
+        if (mRotationTracks[i] && !mRotationTracks[i]->empty())
+        {
+            mJointStates[i]->setRotation(mRotations[i]);
+        }
+        if (mPositionTracks[i] && !mPositionTracks[i]->empty())
+        {
+            llassert(mPositions[i].isFinite());
+            mJointStates[i]->setPosition(mPositions[i]);
+        }
     }
 
     LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
@@ -1663,7 +1623,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return false;
             }
 
-            rCurve->mKeys[time] = rot_key;
+            rCurve->mKeys.setKey(time, rot_key.mRotation);
         }
 
         if (joint_motion->mRotationCurve.mNumKeys > joint_motion->mRotationCurve.mKeys.size())
@@ -1772,7 +1732,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return false;
             }
 
-            pCurve->mKeys[pos_key.mTime] = pos_key;
+            pCurve->mKeys.setKey(pos_key.mTime, pos_key.mPosition);
 
             if (is_pelvis)
             {
@@ -2082,15 +2042,15 @@ bool LLKeyframeMotion::serialize(LLDataPacker& dp) const
         JointMotion* joint_motionp = mJointMotionList->getJointMotion(i);
         success &= dp.packString(joint_motionp->mJointName, "joint_name");
         success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
-        success &= dp.packS32(static_cast<S32>(joint_motionp->mRotationCurve.mKeys.size()), "num_rot_keys");
+        success &= dp.packS32(joint_motionp->mRotationCurve.mKeys.size(), "num_rot_keys");
 
         LL_DEBUGS("BVH") << "Joint " << i
             << " name: " << joint_motionp->mJointName
             << " Rotation keys: " << joint_motionp->mRotationCurve.mKeys.size()
             << " Position keys: " << joint_motionp->mPositionCurve.mKeys.size() << LL_ENDL;
-        for (RotationCurve::key_map_t::value_type& rot_pair : joint_motionp->mRotationCurve.mKeys)
+        for (S32 k = 0; k < joint_motionp->mRotationCurve.mKeys.size(); k++)
         {
-            RotationKey& rot_key = rot_pair.second;
+            RotationKey rot_key(joint_motionp->mRotationCurve.mKeys.getTime(k), joint_motionp->mRotationCurve.mKeys.getKey(k));
             U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
             success &= dp.packU16(time_short, "time");
 
@@ -2108,10 +2068,10 @@ bool LLKeyframeMotion::serialize(LLDataPacker& dp) const
             LL_DEBUGS("BVH") << "  rot: t " << rot_key.mTime << " angles " << rot_angles.mV[VX] <<","<< rot_angles.mV[VY] <<","<< rot_angles.mV[VZ] << LL_ENDL;
         }
 
-        success &= dp.packS32(static_cast<S32>(joint_motionp->mPositionCurve.mKeys.size()), "num_pos_keys");
-        for (PositionCurve::key_map_t::value_type& pos_pair : joint_motionp->mPositionCurve.mKeys)
+        success &= dp.packS32(joint_motionp->mPositionCurve.mKeys.size(), "num_pos_keys");
+        for (S32 k = 0; k < joint_motionp->mPositionCurve.mKeys.size(); k++)
         {
-            PositionKey& pos_key = pos_pair.second;
+            PositionKey pos_key(joint_motionp->mPositionCurve.mKeys.getTime(k), joint_motionp->mPositionCurve.mKeys.getKey(k));
             U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
             success &= dp.packU16(time_short, "time");
 
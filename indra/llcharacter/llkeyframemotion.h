@@ -37,6 +37,7 @@
 #include "llbboxlocal.h"
 #include "llhandmotion.h"
 #include "lljointstate.h"
+#include "llkeyframetrack.h"
 #include "llmotion.h"
 #include "llquaternion.h"
 #include "v3dmath.h"
@@ -325,13 +326,12 @@ public:
     public:
         ScaleCurve();
         ~ScaleCurve();
-        LLVector3 getValue(F32 time, F32 duration);
-        LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
+        LLVector3 getValue(F32 time, F32 duration) const;
+        LLVector3 interp(F32 u, const LLVector3& before, const LLVector3& after) const;
 
         InterpolationType   mInterpolationType;
         S32                 mNumKeys;
-        typedef std::map<F32, ScaleKey> key_map_t;
-        key_map_t           mKeys;
+        LLKeyframeTrack<LLVector3> mKeys;
         ScaleKey            mLoopInKey;
         ScaleKey            mLoopOutKey;
     };
@@ -344,13 +344,12 @@ public:
     public:
         RotationCurve();
         ~RotationCurve();
-        LLQuaternion getValue(F32 time, F32 duration);
-        LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+        LLQuaternion getValue(F32 time, F32 duration) const;
+        LLQuaternion interp(F32 u, const LLQuaternion& before, const LLQuaternion& after) const;
 
         InterpolationType   mInterpolationType;
         S32                 mNumKeys;
-        typedef std::map<F32, RotationKey> key_map_t;
-        key_map_t       mKeys;
+        LLKeyframeTrack<LLQuaternion> mKeys;
         RotationKey     mLoopInKey;
         RotationKey     mLoopOutKey;
     };
@@ -363,13 +362,12 @@ public:
     public:
         PositionCurve();
         ~PositionCurve();
-        LLVector3 getValue(F32 time, F32 duration);
-        LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+        LLVector3 getValue(F32 time, F32 duration) const;
+        LLVector3 interp(F32 u, const LLVector3& before, const LLVector3& after) const;
 
         InterpolationType   mInterpolationType;
         S32                 mNumKeys;
-        typedef std::map<F32, PositionKey> key_map_t;
-        key_map_t       mKeys;
+        LLKeyframeTrack<LLVector3> mKeys;
         PositionKey     mLoopInKey;
         PositionKey     mLoopOutKey;
     };
@@ -386,8 +384,6 @@ public:
         std::string     mJointName;
         U32             mUsage;
         LLJoint::JointPriority  mPriority;
-
-        void update(LLJointState* joint_state, F32 time, F32 duration);
     };
 
     //-------------------------------------------------------------------------
@@ -435,6 +431,19 @@ protected:
     F32                             mLastLoopedTime;
     AssetStatus                     mAssetStatus;
 
+    // applyKeyframes() samples the curves of all joints together. The
+    // curves are shared through LLKeyframeDataCache, the cursors into
+    // them, in the samplers, are per motion instance.
+    LLKeyframeSampler               mRotationSampler;
+    LLKeyframeSampler               mPositionSampler;
+    LLKeyframeSampler               mScaleSampler;
+    std::vector<const LLKeyframeTrack<LLQuaternion>*> mRotationTracks;
+    std::vector<const LLKeyframeTrack<LLVector3>*> mPositionTracks;
+    std::vector<const LLKeyframeTrack<LLVector3>*> mScaleTracks;
+    std::vector<LLQuaternion>       mRotations;
+    std::vector<LLVector3>          mPositions;
+    std::vector<LLVector3>          mScales;
+
 public:
     void setCharacter(LLCharacter* character) { mCharacter = character; }
 };
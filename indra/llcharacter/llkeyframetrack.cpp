@@ -0,0 +1,109 @@
+/**
+ * @file llkeyframetrack.cpp
+ * @brief Flat keyframe tracks and their batched sampler
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llkeyframetrack.h"
+
+// The components of a key value, to load into an LLVector4a
+static inline const F32* key_data(const LLVector3& key) { return key.mV; }
+static inline const F32* key_data(const LLQuaternion& key) { return key.mQ; }
+
+//-----------------------------------------------------------------------------
+// gather()
+// Finds the keys of every track, writes the values that need no
+// interpolation and queues the others in mBlends.
+//-----------------------------------------------------------------------------
+template <class T>
+void LLKeyframeSampler::gather(F32 time, const LLKeyframeTrack<T>* const* tracks, S32 count, T* out)
+{
+    if ((S32)mCursors.size() < count)
+    {
+        mCursors.resize(count, 0);
+    }
+    mBlends.clear();
+
+    for (S32 i = 0; i < count; ++i)
+    {
+        const LLKeyframeTrack<T>* track = tracks[i];
+        if (!track || track->empty())
+        {
+            continue;
+        }
+
+        S32 before, after;
+        F32 u;
+        if (track->locate(time, mCursors[i], before, after, u))
+        {
+            mBlends.push_back({ key_data(track->getKey(before)), key_data(track->getKey(after)), u, i });
+        }
+        else
+        {
+            out[i] = track->getKey(before);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// sample()
+//-----------------------------------------------------------------------------
+void LLKeyframeSampler::sample(F32 time, const LLKeyframeTrack<LLVector3>* const* tracks, S32 count, LLVector3* out)
+{
+    gather(time, tracks, count, out);
+
+    for (const Blend& blend : mBlends)
+    {
+        LLVector4a before, after, value;
+        before.load3(blend.mBefore);
+        after.load3(blend.mAfter);
+        value.setLerp(before, after, blend.mU);
+        out[blend.mTrack].set(value.getF32ptr());
+    }
+}
+
+void LLKeyframeSampler::sample(F32 time, const LLKeyframeTrack<LLQuaternion>* const* tracks, S32 count, LLQuaternion* out)
+{
+    gather(time, tracks, count, out);
+
+    for (const Blend& blend : mBlends)
+    {
+        LLVector4a before, after;
+        before.loadua(blend.mBefore);
+        after.loadua(blend.mAfter);
+        if (before.dot4(after).getF32() < 0.f)
+        {
+            // nlerp() takes the long way round with slerp()
+            out[blend.mTrack] = nlerp(blend.mU, LLQuaternion(blend.mBefore), LLQuaternion(blend.mAfter));
+            continue;
+        }
+
+        LLVector4a value;
+        value.setLerp(before, after, blend.mU);
+        value.normalize4();
+        // not set(), which would normalize again
+        memcpy(out[blend.mTrack].mQ, value.getF32ptr(), sizeof(out[blend.mTrack].mQ));
+    }
+}
@@ -0,0 +1,163 @@
+/**
+ * @file llkeyframetrack.h
+ * @brief Flat keyframe tracks and their batched sampler
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLKEYFRAMETRACK_H
+#define LL_LLKEYFRAMETRACK_H
+
+#include "llmath.h"
+#include "llquaternion.h"
+#include "llvector4a.h"
+#include "v3math.h"
+
+#include <algorithm>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// LLKeyframeTrack
+// The keys of one animation curve, as parallel arrays of times and values
+// sorted by time, one key per time.
+//-----------------------------------------------------------------------------
+template <class T>
+class LLKeyframeTrack
+{
+public:
+    // A key at the time of an existing one replaces it
+    void setKey(F32 time, const T& value)
+    {
+        std::vector<F32>::iterator it = std::lower_bound(mTimes.begin(), mTimes.end(), time);
+        const size_t index = it - mTimes.begin();
+        if (it != mTimes.end() && *it == time)
+        {
+            mValues[index] = value;
+        }
+        else
+        {
+            mTimes.insert(it, time);
+            mValues.insert(mValues.begin() + index, value);
+        }
+    }
+
+    void clear()
+    {
+        mTimes.clear();
+        mValues.clear();
+    }
+
+    bool empty() const { return mTimes.empty(); }
+    S32 size() const { return (S32)mTimes.size(); }
+    F32 getTime(S32 index) const { return mTimes[index]; }
+    const T& getKey(S32 index) const { return mValues[index]; }
+
+    // Index of the first key at or after time, as std::lower_bound. cursor
+    // is where the previous lookup ended: playback moves forward a key or
+    // two per frame, so scan from there and only search when it jumps.
+    S32 lowerBound(F32 time, S32& cursor) const
+    {
+        const S32 count = size();
+        S32 right = llclamp(cursor, 0, count);
+        if (right > 0 && mTimes[right - 1] >= time)
+        {
+            // went back, e.g. looped
+            right = (S32)(std::lower_bound(mTimes.begin(), mTimes.begin() + right, time) - mTimes.begin());
+        }
+        else
+        {
+            const S32 MAX_SCAN = 4;
+            const S32 scan_end = llmin(right + MAX_SCAN, count);
+            while (right < scan_end && mTimes[right] < time)
+            {
+                ++right;
+            }
+            if (right == scan_end && right < count && mTimes[right] < time)
+            {
+                right = (S32)(std::lower_bound(mTimes.begin() + right, mTimes.end(), time) - mTimes.begin());
+            }
+        }
+        cursor = right;
+        return right;
+    }
+
+    // Keys around time in a non-empty track. Returns true with the fraction
+    // u of the way from before to after when time is between two keys, and
+    // false when the value is just that of key before: time is on a key,
+    // or outside of the track.
+    bool locate(F32 time, S32& cursor, S32& before, S32& after, F32& u) const
+    {
+        const S32 right = lowerBound(time, cursor);
+        if (right == size())
+        {
+            before = after = right - 1;
+            return false;
+        }
+        if (right == 0 || mTimes[right] == time)
+        {
+            before = after = right;
+            return false;
+        }
+        before = right - 1;
+        after = right;
+        u = (time - mTimes[before]) / (mTimes[after] - mTimes[before]);
+        return true;
+    }
+
+private:
+    std::vector<F32>    mTimes;
+    std::vector<T>      mValues;
+};
+
+//-----------------------------------------------------------------------------
+// LLKeyframeSampler
+// Samples the tracks of all joints of a motion at once. Keys are found from
+// a cursor kept per track, then the interpolations are done in one pass
+// over packed SIMD vectors instead of one joint at a time.
+//-----------------------------------------------------------------------------
+class LLKeyframeSampler
+{
+public:
+    // out[i] is the value of tracks[i] at time; NULL or empty tracks are
+    // skipped and their out left alone. Tracks must keep their index from
+    // call to call, for the cursors.
+    // Vectors interpolate linearly and rotations as nlerp() does.
+    void sample(F32 time, const LLKeyframeTrack<LLVector3>* const* tracks, S32 count, LLVector3* out);
+    void sample(F32 time, const LLKeyframeTrack<LLQuaternion>* const* tracks, S32 count, LLQuaternion* out);
+
+private:
+    template <class T>
+    void gather(F32 time, const LLKeyframeTrack<T>* const* tracks, S32 count, T* out);
+
+    struct Blend
+    {
+        const F32*  mBefore;
+        const F32*  mAfter;
+        F32         mU;
+        S32         mTrack;
+    };
+
+    std::vector<S32>    mCursors;
+    std::vector<Blend>  mBlends;
+};
+
+#endif // LL_LLKEYFRAMETRACK_H
@@ -140,6 +140,8 @@ LLMotionController::LLMotionController()
       mTimeStep(0.f),
       mTimeStepCount(0),
       mLastInterp(0.f),
+      mDeferPoseBlend(false),
+      mPoseBlendPending(false),
       mIsSelf(false),
       mLastCountAfterPurge(0)
 {
@@ -827,6 +829,8 @@ void LLMotionController::updateMotions(bool force_update)
     // Currently setting mTimeStep to nonzero is disabled elsewhere.
     bool use_quantum = (mTimeStep != 0.f);
 
+    applyDeferredPose();
+
     // Always update mPrevTimerElapsed
     F32 cur_time = mTimer.getElapsedTimeF32();
     F32 delta_time = cur_time - mPrevTimerElapsed;
@@ -900,6 +904,10 @@ void LLMotionController::updateMotions(bool force_update)
         {
             mPoseBlender.blendAndCache(true);
         }
+        else if (mDeferPoseBlend)
+        {
+            mPoseBlendPending = true;
+        }
         else
         {
             mPoseBlender.blendAndApply();
@@ -910,6 +918,20 @@ void LLMotionController::updateMotions(bool force_update)
 //  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
 }
 
+//-----------------------------------------------------------------------------
+// applyDeferredPose()
+// Only touches the joints of this character, so controllers of different
+// characters can apply their poses in parallel.
+//-----------------------------------------------------------------------------
+void LLMotionController::applyDeferredPose()
+{
+    if (mPoseBlendPending)
+    {
+        mPoseBlendPending = false;
+        mPoseBlender.blendAndApply();
+    }
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
@@ -917,6 +939,8 @@ void LLMotionController::updateMotions(bool force_update)
 void LLMotionController::updateMotionsMinimal()
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    applyDeferredPose();
+
     // Always update mPrevTimerElapsed
     mPrevTimerElapsed = mTimer.getElapsedTimeF32();
 
@@ -1089,6 +1113,8 @@ void LLMotionController::dumpMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::deactivateAllMotions()
 {
+    applyDeferredPose();
+
     for (motion_map_t::value_type& motion_pair : mAllMotions)
     {
         LLMotion* motionp = motion_pair.second;
@@ -1102,6 +1128,8 @@ void LLMotionController::deactivateAllMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::flushAllMotions()
 {
+    applyDeferredPose();
+
     std::vector<std::pair<LLUUID,F32> > active_motions;
     active_motions.reserve(mActiveMotions.size());
     for (motion_list_t::iterator iter = mActiveMotions.begin();
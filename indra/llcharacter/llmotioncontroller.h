@@ -136,6 +136,14 @@ public:
 
     void clearBlenders() { mPoseBlender.clearBlenders(); }
 
+    // With deferral on, updateMotions() leaves the blended pose for
+    // applyDeferredPose() to write into the joints, possibly on another
+    // thread (see LLForkJoin). A pose left pending is applied
+    // before the next update.
+    void setDeferPoseBlend(bool defer) { mDeferPoseBlend = defer; }
+    bool isPoseBlendPending() const { return mPoseBlendPending; }
+    void applyDeferredPose();
+
     // flush motions
     // releases all motion instances
     void flushAllMotions();
@@ -229,6 +237,8 @@ protected:
     F32                 mTimeStep;
     S32                 mTimeStepCount;
     F32                 mLastInterp;
+    bool                mDeferPoseBlend;
+    bool                mPoseBlendPending;
 
     U8                  mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
 private:
@@ -0,0 +1,457 @@
+/**
+ * @file llkeyframetrack_test.cpp
+ * @brief Tests and benchmark of the keyframe tracks and their sampler
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llkeyframetrack.h"
+
+#include "llquantize.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+
+namespace
+{
+    // An .anim asset, as far as sampling goes
+    struct Animation
+    {
+        F32 mDuration{ 0.f };
+        std::vector<LLKeyframeTrack<LLQuaternion> > mRotations;
+        std::vector<LLKeyframeTrack<LLVector3> > mPositions;
+    };
+
+    // Reads the tracks of a version 1.0 .anim, as LLKeyframeMotion::deserialize()
+    class AnimReader
+    {
+    public:
+        AnimReader(const std::vector<U8>& data) : mCur(data.data()), mEnd(data.data() + data.size()) {}
+
+        bool read(Animation& anim)
+        {
+            U16 version, sub_version;
+            S32 priority, loop, num_keys;
+            F32 ignored;
+            U32 hand_pose, num_joints;
+            std::string name;
+            if (!get(version) || !get(sub_version) || version != 1 || sub_version != 0
+                || !get(priority) || !get(anim.mDuration) || !getString(name)
+                || !get(ignored) || !get(ignored) || !get(loop) || !get(ignored) || !get(ignored)
+                || !get(hand_pose) || !get(num_joints))
+            {
+                return false;
+            }
+
+            anim.mRotations.resize(num_joints);
+            anim.mPositions.resize(num_joints);
+            for (U32 j = 0; j < num_joints; ++j)
+            {
+                if (!getString(name) || !get(priority) || !get(num_keys) || num_keys < 0)
+                {
+                    return false;
+                }
+                for (S32 k = 0; k < num_keys; ++k)
+                {
+                    U16 time, x, y, z;
+                    if (!get(time) || !get(x) || !get(y) || !get(z))
+                    {
+                        return false;
+                    }
+                    LLQuaternion rot;
+                    rot.unpackFromVector3(LLVector3(U16_to_F32(x, -1.f, 1.f), U16_to_F32(y, -1.f, 1.f), U16_to_F32(z, -1.f, 1.f)));
+                    anim.mRotations[j].setKey(U16_to_F32(time, 0.f, anim.mDuration), rot);
+                }
+                if (!get(num_keys) || num_keys < 0)
+                {
+                    return false;
+                }
+                for (S32 k = 0; k < num_keys; ++k)
+                {
+                    U16 time, x, y, z;
+                    if (!get(time) || !get(x) || !get(y) || !get(z))
+                    {
+                        return false;
+                    }
+                    LLVector3 pos(U16_to_F32(x, -5.f, 5.f), U16_to_F32(y, -5.f, 5.f), U16_to_F32(z, -5.f, 5.f));
+                    anim.mPositions[j].setKey(U16_to_F32(time, 0.f, anim.mDuration), pos);
+                }
+            }
+            return anim.mDuration > 0.f;
+        }
+
+    private:
+        template <class T>
+        bool get(T& value)
+        {
+            if (mEnd - mCur < (ptrdiff_t)sizeof(T))
+            {
+                return false;
+            }
+            memcpy(&value, mCur, sizeof(T));
+            mCur += sizeof(T);
+            return true;
+        }
+
+        bool getString(std::string& value)
+        {
+            const U8* nul = std::find(mCur, mEnd, 0);
+            if (nul == mEnd)
+            {
+                return false;
+            }
+            value.assign((const char*)mCur, nul - mCur);
+            mCur = nul + 1;
+            return true;
+        }
+
+        const U8* mCur;
+        const U8* mEnd;
+    };
+
+    // What LLKeyframeMotion's curves did before the tracks: a map per curve
+    // and a tree search per joint per frame
+    template <class T>
+    struct MapTrack
+    {
+        std::map<F32, T> mKeys;
+
+        T getValue(F32 time) const
+        {
+            typename std::map<F32, T>::const_iterator right = mKeys.lower_bound(time);
+            if (right == mKeys.end())
+            {
+                return (--right)->second;
+            }
+            if (right == mKeys.begin() || right->first == time)
+            {
+                return right->second;
+            }
+            typename std::map<F32, T>::const_iterator left = right;
+            --left;
+            F32 u = (time - left->first) / (right->first - left->first);
+            return blend(u, left->second, right->second);
+        }
+
+        static LLVector3 blend(F32 u, const LLVector3& a, const LLVector3& b) { return lerp(a, b, u); }
+        static LLQuaternion blend(F32 u, const LLQuaternion& a, const LLQuaternion& b) { return nlerp(u, a, b); }
+    };
+}
+
+namespace tut
+{
+    struct keyframetrack_data
+    {
+        std::mt19937 mRandom{ 1234 };
+
+        F32 random(F32 low, F32 high)
+        {
+            return std::uniform_real_distribution<F32>(low, high)(mRandom);
+        }
+
+        LLQuaternion randomRotation()
+        {
+            LLQuaternion rot(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f));
+            rot.normalize();
+            return rot;
+        }
+
+        LLKeyframeTrack<LLQuaternion> randomRotationTrack(S32 num_keys, F32 duration, MapTrack<LLQuaternion>* reference = NULL)
+        {
+            LLKeyframeTrack<LLQuaternion> track;
+            for (S32 k = 0; k < num_keys; ++k)
+            {
+                F32 time = random(0.f, duration);
+                LLQuaternion rot = randomRotation();
+                track.setKey(time, rot);
+                if (reference)
+                {
+                    reference->mKeys[time] = rot;
+                }
+            }
+            return track;
+        }
+    };
+
+    typedef test_group<keyframetrack_data> keyframetrack_test;
+    typedef keyframetrack_test::object keyframetrack_object;
+    tut::keyframetrack_test keyframetrack_testcase("LLKeyframeTrack");
+
+    template<> template<>
+    void keyframetrack_object::test<1>()
+    {
+        set_test_name("keys stay sorted and unique");
+        LLKeyframeTrack<LLVector3> track;
+        track.setKey(2.f, LLVector3(2.f, 0.f, 0.f));
+        track.setKey(0.f, LLVector3(0.f, 0.f, 0.f));
+        track.setKey(1.f, LLVector3(1.f, 0.f, 0.f));
+        track.setKey(1.f, LLVector3(1.5f, 0.f, 0.f));
+        ensure_equals("size", track.size(), 3);
+        for (S32 i = 0; i < track.size(); ++i)
+        {
+            ensure_equals("time order", track.getTime(i), (F32)i);
+        }
+        ensure_equals("replaced key", track.getKey(1).mV[VX], 1.5f);
+    }
+
+    template<> template<>
+    void keyframetrack_object::test<2>()
+    {
+        set_test_name("cursor lookups match std::lower_bound");
+        LLKeyframeTrack<LLVector3> track;
+        std::vector<F32> times;
+        for (S32 k = 0; k < 200; ++k)
+        {
+            F32 time = (F32)k * 0.05f;
+            track.setKey(time, LLVector3::zero);
+            times.push_back(time);
+        }
+
+        S32 cursor = 0;
+        // forward in small steps, then jumps either way and out of range
+        std::vector<F32> lookups;
+        for (F32 time = -0.1f; time < 10.5f; time += 0.0123f)
+        {
+            lookups.push_back(time);
+        }
+        for (S32 i = 0; i < 500; ++i)
+        {
+            lookups.push_back(random(-1.f, 11.f));
+        }
+        lookups.push_back(times[17]);
+        lookups.push_back(times[3]);
+        for (F32 time : lookups)
+        {
+            S32 expected = (S32)(std::lower_bound(times.begin(), times.end(), time) - times.begin());
+            ensure_equals(STRINGIZE("lower bound of " << time), track.lowerBound(time, cursor), expected);
+        }
+    }
+
+    template<> template<>
+    void keyframetrack_object::test<3>()
+    {
+        set_test_name("batched sampling matches per curve sampling");
+        const S32 NUM_TRACKS = 40;
+        const F32 DURATION = 3.f;
+        std::vector<LLKeyframeTrack<LLQuaternion> > tracks;
+        std::vector<MapTrack<LLQuaternion> > references(NUM_TRACKS);
+        std::vector<const LLKeyframeTrack<LLQuaternion>*> track_ptrs;
+        for (S32 i = 0; i < NUM_TRACKS; ++i)
+        {
+            // the empty track is skipped
+            tracks.push_back(randomRotationTrack(i == 5 ? 0 : 1 + i % 30, DURATION, &references[i]));
+        }
+        for (const LLKeyframeTrack<LLQuaternion>& track : tracks)
+        {
+            track_ptrs.push_back(&track);
+        }
+        // and so is a joint that doesn't use its track
+        track_ptrs[7] = NULL;
+
+        LLKeyframeSampler sampler;
+        std::vector<LLQuaternion> out(NUM_TRACKS);
+        for (S32 loop = 0; loop < 2; ++loop)
+        {
+            for (F32 time = 0.f; time <= DURATION; time += 1.f / 45.f)
+            {
+                out[5] = out[7] = LLQuaternion(1.f, 2.f, 3.f, 4.f);
+                sampler.sample(time, track_ptrs.data(), NUM_TRACKS, out.data());
+                for (S32 i = 0; i < NUM_TRACKS; ++i)
+                {
+                    if (i == 5 || i == 7)
+                    {
+                        ensure_equals("skipped track", out[i].mQ[VX], LLQuaternion(1.f, 2.f, 3.f, 4.f).mQ[VX]);
+                        continue;
+                    }
+                    LLQuaternion expected = references[i].getValue(time);
+                    ensure(STRINGIZE("track " << i << " at " << time), out[i].isEqualEps(expected, 1.e-4f) || out[i].isEqualEps(-expected, 1.e-4f));
+                }
+            }
+        }
+
+        std::vector<LLKeyframeTrack<LLVector3> > positions(NUM_TRACKS);
+        std::vector<MapTrack<LLVector3> > position_references(NUM_TRACKS);
+        std::vector<const LLKeyframeTrack<LLVector3>*> position_ptrs;
+        for (S32 i = 0; i < NUM_TRACKS; ++i)
+        {
+            for (S32 k = 0; k < 1 + i % 10; ++k)
+            {
+                F32 time = random(0.f, DURATION);
+                LLVector3 pos(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f));
+                positions[i].setKey(time, pos);
+                position_references[i].mKeys[time] = pos;
+            }
+            position_ptrs.push_back(&positions[i]);
+        }
+        std::vector<LLVector3> position_out(NUM_TRACKS);
+        for (F32 time = DURATION; time >= 0.f; time -= 1.f / 30.f)
+        {
+            sampler.sample(time, position_ptrs.data(), NUM_TRACKS, position_out.data());
+            for (S32 i = 0; i < NUM_TRACKS; ++i)
+            {
+                ensure(STRINGIZE("position " << i << " at " << time),
+                       dist_vec(position_out[i], position_references[i].getValue(time)) < 1.e-5f);
+            }
+        }
+    }
+
+    template<> template<>
+    void keyframetrack_object::test<4>()
+    {
+        set_test_name("keyframe sampling benchmark");
+
+        // LL_ANIM_BENCHMARK_DIR=<directory of .anim files> plays them on a
+        // crowd of avatars, sampled through std::map curves and through the
+        // tracks and sampler. LL_ANIM_BENCHMARK_AVATARS sets the crowd size.
+        const char* dir = getenv("LL_ANIM_BENCHMARK_DIR");
+        if (!dir || !*dir)
+        {
+            skip("set LL_ANIM_BENCHMARK_DIR to a directory of .anim files to run the keyframe benchmark");
+        }
+        const char* avatars = getenv("LL_ANIM_BENCHMARK_AVATARS");
+        const S32 NUM_AVATARS = (avatars && atoi(avatars) > 0) ? atoi(avatars) : 80;
+        const S32 ANIMS_PER_AVATAR = 4;
+        const S32 FRAMES = 450;
+        const F32 FRAME_TIME = 1.f / 45.f;
+
+        std::vector<Animation> library;
+        std::vector<std::vector<MapTrack<LLQuaternion> > > map_rotations;
+        std::vector<std::vector<MapTrack<LLVector3> > > map_positions;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(dir))
+        {
+            if (entry.path().extension() != ".anim")
+            {
+                continue;
+            }
+            const std::string name = entry.path().filename().string();
+            std::ifstream file(entry.path(), std::ios::binary);
+            std::vector<U8> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            Animation anim;
+            if (!AnimReader(data).read(anim))
+            {
+                std::cout << "\nskipped " << name << std::endl;
+                continue;
+            }
+
+            std::vector<MapTrack<LLQuaternion> > rotations(anim.mRotations.size());
+            std::vector<MapTrack<LLVector3> > positions(anim.mPositions.size());
+            for (size_t j = 0; j < anim.mRotations.size(); ++j)
+            {
+                for (S32 k = 0; k < anim.mRotations[j].size(); ++k)
+                {
+                    rotations[j].mKeys[anim.mRotations[j].getTime(k)] = anim.mRotations[j].getKey(k);
+                }
+                for (S32 k = 0; k < anim.mPositions[j].size(); ++k)
+                {
+                    positions[j].mKeys[anim.mPositions[j].getTime(k)] = anim.mPositions[j].getKey(k);
+                }
+            }
+            library.push_back(std::move(anim));
+            map_rotations.push_back(std::move(rotations));
+            map_positions.push_back(std::move(positions));
+        }
+        ensure("animations in " + std::string(dir), !library.empty());
+
+        // what each avatar plays, and from when
+        struct Playing
+        {
+            size_t mAnim;
+            F32 mPhase;
+            LLKeyframeSampler mRotationSampler;
+            LLKeyframeSampler mPositionSampler;
+            std::vector<const LLKeyframeTrack<LLQuaternion>*> mRotationTracks;
+            std::vector<const LLKeyframeTrack<LLVector3>*> mPositionTracks;
+        };
+        std::vector<Playing> playing(NUM_AVATARS * ANIMS_PER_AVATAR);
+        size_t max_joints = 0;
+        for (Playing& play : playing)
+        {
+            play.mAnim = mRandom() % library.size();
+            const Animation& anim = library[play.mAnim];
+            play.mPhase = random(0.f, anim.mDuration);
+            for (size_t j = 0; j < anim.mRotations.size(); ++j)
+            {
+                play.mRotationTracks.push_back(anim.mRotations[j].empty() ? NULL : &anim.mRotations[j]);
+                play.mPositionTracks.push_back(anim.mPositions[j].empty() ? NULL : &anim.mPositions[j]);
+            }
+            max_joints = llmax(max_joints, anim.mRotations.size());
+        }
+
+        typedef std::chrono::high_resolution_clock clock;
+        std::vector<LLQuaternion> rotations(max_joints);
+        std::vector<LLVector3> positions(max_joints);
+        F32 checksum = 0.f;
+
+        clock::time_point start = clock::now();
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            for (const Playing& play : playing)
+            {
+                const F32 time = fmodf(play.mPhase + frame * FRAME_TIME, library[play.mAnim].mDuration);
+                const std::vector<MapTrack<LLQuaternion> >& rot_tracks = map_rotations[play.mAnim];
+                const std::vector<MapTrack<LLVector3> >& pos_tracks = map_positions[play.mAnim];
+                for (size_t j = 0; j < rot_tracks.size(); ++j)
+                {
+                    if (!rot_tracks[j].mKeys.empty())
+                    {
+                        rotations[j] = rot_tracks[j].getValue(time);
+                    }
+                    if (!pos_tracks[j].mKeys.empty())
+                    {
+                        positions[j] = pos_tracks[j].getValue(time);
+                    }
+                }
+                checksum += rotations[0].mQ[VW];
+            }
+        }
+        F64 map_ms = std::chrono::duration<F64, std::milli>(clock::now() - start).count() / FRAMES;
+
+        start = clock::now();
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            for (Playing& play : playing)
+            {
+                const F32 time = fmodf(play.mPhase + frame * FRAME_TIME, library[play.mAnim].mDuration);
+                const S32 count = (S32)play.mRotationTracks.size();
+                play.mRotationSampler.sample(time, play.mRotationTracks.data(), count, rotations.data());
+                play.mPositionSampler.sample(time, play.mPositionTracks.data(), count, positions.data());
+                checksum += rotations[0].mQ[VW];
+            }
+        }
+        F64 track_ms = std::chrono::duration<F64, std::milli>(clock::now() - start).count() / FRAMES;
+
+        std::cout << "\n" << library.size() << " animations, " << NUM_AVATARS << " avatars playing "
+                  << ANIMS_PER_AVATAR << " each (" << checksum << ")\n"
+                  << "std::map curves: " << map_ms << " ms per frame\n"
+                  << "tracks + sampler: " << track_ms << " ms per frame" << std::endl;
+    }
+}
@@ -0,0 +1,228 @@
+/**
+ * @file llpose_test.cpp
+ * @brief Tests and crowd benchmark of poses finished on a thread pool
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpose.h"
+
+#include "../lljoint.h"
+#include "../lljointstate.h"
+#include "llforkjoin.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace
+{
+    // About the size of an avatar skeleton, with three motions' joint states
+    // blended into each joint
+    const S32 NUM_JOINTS = 150;
+    const S32 NUM_MOTIONS = 3;
+
+    struct Skeleton
+    {
+        std::vector<std::unique_ptr<LLJoint> >              mJoints;
+        std::vector<std::unique_ptr<LLJointStateBlender> >  mBlenders;
+        std::vector<LLPointer<LLJointState> >               mStates;
+        std::vector<LLVector3>                              mAxes;
+
+        Skeleton(std::mt19937& random)
+        {
+            std::uniform_real_distribution<F32> unit(-1.f, 1.f);
+            for (S32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                mJoints.emplace_back(std::make_unique<LLJoint>(i));
+                LLJoint* joint = mJoints.back().get();
+                joint->setPosition(LLVector3(unit(random), unit(random), 0.1f));
+                if (i)
+                {
+                    // mostly chains, with some branching
+                    mJoints[llmax(0, i - 1 - (S32)(random() % 4))]->addChild(joint);
+                }
+
+                mBlenders.emplace_back(std::make_unique<LLJointStateBlender>());
+                for (S32 m = 0; m < NUM_MOTIONS; ++m)
+                {
+                    LLPointer<LLJointState> state = new LLJointState(joint);
+                    state->setUsage(LLJointState::ROT | (m ? 0 : LLJointState::POS));
+                    state->setWeight(m ? 0.5f : 1.f);
+                    mBlenders.back()->addJointState(state, m, false);
+                    mStates.push_back(state);
+
+                    LLVector3 axis(unit(random), unit(random), unit(random));
+                    axis.normalize();
+                    mAxes.push_back(axis);
+                }
+            }
+        }
+
+        ~Skeleton()
+        {
+            // children first
+            while (!mJoints.empty())
+            {
+                mJoints.pop_back();
+            }
+        }
+
+        // What the motions do on the main thread
+        void animate(F32 time)
+        {
+            for (size_t i = 0; i < mStates.size(); ++i)
+            {
+                mStates[i]->setRotation(LLQuaternion(sinf(time + (F32)i) * 0.5f, mAxes[i]));
+                if (mStates[i]->getUsage() & LLJointState::POS)
+                {
+                    mStates[i]->setPosition(LLVector3(0.f, 0.f, 0.1f + 0.01f * sinf(time)));
+                }
+            }
+        }
+
+        // What is left to the pose update
+        void pose()
+        {
+            for (std::unique_ptr<LLJointStateBlender>& blender : mBlenders)
+            {
+                blender->blendJointStates();
+            }
+            mJoints[0]->updateWorldMatrixChildren();
+        }
+    };
+}
+
+namespace tut
+{
+    struct pose_data
+    {
+        std::mt19937 mRandom{ 4321 };
+
+        pose_data()
+        {
+            // before any test starts the shared pool
+            if (const char* threads = getenv("LL_CROWD_BENCHMARK_THREADS"))
+            {
+                LLForkJoin::setPoolWidth((U32)atoi(threads));
+            }
+        }
+
+        std::vector<std::unique_ptr<Skeleton> > makeCrowd(S32 count)
+        {
+            std::vector<std::unique_ptr<Skeleton> > crowd;
+            for (S32 i = 0; i < count; ++i)
+            {
+                crowd.emplace_back(std::make_unique<Skeleton>(mRandom));
+            }
+            return crowd;
+        }
+
+        void animate(LLForkJoin& update, std::vector<std::unique_ptr<Skeleton> >& crowd, F32 time, bool parallel)
+        {
+            for (std::unique_ptr<Skeleton>& skeleton : crowd)
+            {
+                skeleton->animate(time);
+                Skeleton* skeletonp = skeleton.get();
+                update.add([skeletonp]() { skeletonp->pose(); });
+            }
+            update.run(parallel);
+        }
+    };
+
+    typedef test_group<pose_data> pose_test;
+    typedef pose_test::object pose_object;
+    tut::pose_test pose_testcase("LLPose");
+
+    template<> template<>
+    void pose_object::test<1>()
+    {
+        set_test_name("parallel poses match serial poses");
+        const S32 NUM_AVATARS = 24;
+        mRandom.seed(1);
+        std::vector<std::unique_ptr<Skeleton> > serial = makeCrowd(NUM_AVATARS);
+        mRandom.seed(1);
+        std::vector<std::unique_ptr<Skeleton> > parallel = makeCrowd(NUM_AVATARS);
+
+        LLForkJoin update("test pose update");
+        for (S32 frame = 0; frame < 10; ++frame)
+        {
+            const F32 time = frame * 0.1f;
+            animate(update, serial, time, false);
+            animate(update, parallel, time, true);
+            for (S32 a = 0; a < NUM_AVATARS; ++a)
+            {
+                for (S32 j = 0; j < NUM_JOINTS; ++j)
+                {
+                    const LLMatrix4& expected = serial[a]->mJoints[j]->getWorldMatrix();
+                    const LLMatrix4& actual = parallel[a]->mJoints[j]->getWorldMatrix();
+                    ensure(STRINGIZE("avatar " << a << " joint " << j << " frame " << frame),
+                           !memcmp(expected.mMatrix, actual.mMatrix, sizeof(expected.mMatrix)));
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void pose_object::test<2>()
+    {
+        set_test_name("crowd pose benchmark");
+
+        // LL_CROWD_BENCHMARK=<avatars> times blending and world matrix
+        // propagation for that many avatars, serially then in parallel.
+        // LL_CROWD_BENCHMARK_THREADS sets the width of the pool.
+        const char* avatars = getenv("LL_CROWD_BENCHMARK");
+        if (!avatars || atoi(avatars) <= 0)
+        {
+            skip("set LL_CROWD_BENCHMARK to a number of avatars to run the crowd pose benchmark");
+        }
+        const S32 NUM_AVATARS = atoi(avatars);
+        const S32 FRAMES = 200;
+
+        std::vector<std::unique_ptr<Skeleton> > crowd = makeCrowd(NUM_AVATARS);
+        LLForkJoin update("crowd benchmark");
+        // start the pool outside of the timing
+        animate(update, crowd, 0.f, true);
+
+        typedef std::chrono::high_resolution_clock clock;
+        F64 ms[2];
+        for (S32 parallel = 0; parallel < 2; ++parallel)
+        {
+            clock::time_point start = clock::now();
+            for (S32 frame = 0; frame < FRAMES; ++frame)
+            {
+                animate(update, crowd, frame / 45.f, parallel != 0);
+            }
+            ms[parallel] = std::chrono::duration<F64, std::milli>(clock::now() - start).count() / FRAMES;
+        }
+
+        std::cout << "\n" << NUM_AVATARS << " avatars of " << NUM_JOINTS << " joints\n"
+                  << "serial:   " << ms[0] << " ms per frame\n"
+                  << "parallel: " << ms[1] << " ms per frame" << std::endl;
+    }
+}
@@ -0,0 +1,168 @@
+/**
+ * @file llforkjoin.cpp
+ * @brief Runs a batch of independent tasks on a thread pool and waits for them
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llforkjoin.h"
+
+#include "llcond.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+// Below this many tasks waking the workers costs more than it saves
+static const S32 DEFAULT_MIN_PARALLEL_TASKS = 4;
+
+// One run()'s tasks. Workers hold on to it, so one that only wakes up
+// after the run is over finds nothing left and drops it.
+struct LLForkJoin::Batch
+{
+    std::vector<task_t>     mTasks;
+    std::atomic<size_t>     mNext{ 0 };
+    LLScalarCond<size_t>    mRemaining{ 0 };
+    std::mutex              mExceptionMutex;
+    std::exception_ptr      mException;     // first one a task threw
+
+    // Takes tasks, one at a time, until there are none left
+    void work()
+    {
+        size_t done = 0;
+        for (size_t i = mNext++; i < mTasks.size(); i = mNext++)
+        {
+            try
+            {
+                mTasks[i]();
+            }
+            catch (...)
+            {
+                // run() rethrows it once the others are done
+                std::lock_guard<std::mutex> lock(mExceptionMutex);
+                if (!mException)
+                {
+                    mException = std::current_exception();
+                }
+            }
+            ++done;
+        }
+        if (done)
+        {
+            mRemaining.update_all([done](size_t& remaining) { remaining -= done; });
+        }
+    }
+};
+
+namespace
+{
+    std::mutex sPoolMutex;
+    U32 sPoolWidth = 0;
+    // Never deleted: like the other pools it closes on application
+    // shutdown, and it must not outlive the instance tracker of the pools
+    LL::WorkStealingThreadPool* sPool = nullptr;
+}
+
+//static
+void LLForkJoin::setPoolWidth(U32 threads)
+{
+    std::lock_guard<std::mutex> lock(sPoolMutex);
+    sPoolWidth = threads;
+}
+
+//static
+LL::WorkStealingThreadPool* LLForkJoin::getPool()
+{
+    std::lock_guard<std::mutex> lock(sPoolMutex);
+    if (!sPool)
+    {
+        // the calling thread works too
+        U32 threads = sPoolWidth ? sPoolWidth : llclamp(std::thread::hardware_concurrency() / 2, 1U, 8U);
+        sPool = new LL::WorkStealingThreadPool("ForkJoin", threads);
+        sPool->start();
+    }
+    return sPool;
+}
+
+LLForkJoin::LLForkJoin(const std::string& name)
+:   mName(name),
+    mBatch(std::make_shared<Batch>()),
+    mMinParallelTasks(DEFAULT_MIN_PARALLEL_TASKS)
+{
+}
+
+LLForkJoin::~LLForkJoin()
+{
+}
+
+void LLForkJoin::add(task_t&& task)
+{
+    mBatch->mTasks.emplace_back(std::move(task));
+}
+
+S32 LLForkJoin::size() const
+{
+    return (S32)mBatch->mTasks.size();
+}
+
+void LLForkJoin::run(bool parallel)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    LL_PROFILE_ZONE_TEXT(mName.c_str(), mName.size());
+    if (mBatch->mTasks.empty())
+    {
+        return;
+    }
+
+    std::shared_ptr<Batch> batch = mBatch;
+    mBatch = std::make_shared<Batch>();
+    mBatch->mTasks.reserve(batch->mTasks.size());
+
+    const size_t count = batch->mTasks.size();
+    batch->mRemaining.set_all(count);
+
+    if (parallel && (S32)count >= mMinParallelTasks)
+    {
+        LL::WorkStealingThreadPool* pool = getPool();
+        const size_t jobs = llmin(pool->getWidth(), count - 1);
+        for (size_t i = 0; i < jobs; ++i)
+        {
+            // a closed queue (shutting down) leaves it all to this thread
+            if (!pool->getQueue().post([batch]() { batch->work(); }))
+            {
+                break;
+            }
+        }
+    }
+
+    batch->work();
+    batch->mRemaining.wait_equal(0);
+
+    if (batch->mException)
+    {
+        std::rethrow_exception(batch->mException);
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file llforkjoin.h
+ * @brief Runs a batch of independent tasks on a thread pool and waits for them
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFORKJOIN_H
+#define LL_LLFORKJOIN_H
+
+#include "threadpool_fwd.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Fork-join over a batch of independent tasks: the tasks added since the
+ * last run() are shared between a thread pool and the calling thread,
+ * which returns from run() once all of them are done. Meant for per-frame
+ * work that is split in many small pieces touching disjoint data, such as
+ * avatar poses, particle groups or texture priorities.
+ *
+ * All instances share one "ForkJoin" pool, so that several of them don't
+ * add up to more threads than there are cores.
+ */
+class LL_COMMON_API LLForkJoin
+{
+public:
+    typedef std::function<void()> task_t;
+
+    // name tells the runs of this instance apart in profiles
+    LLForkJoin(const std::string& name);
+    ~LLForkJoin();
+
+    // A task must not touch the data of the others
+    void add(task_t&& task);
+    S32 size() const;
+
+    // Fewer tasks than this run on the calling thread. Long tasks, such as
+    // the bands of an image, are worth sharing from two up.
+    void setMinParallelTasks(S32 tasks) { mMinParallelTasks = tasks; }
+
+    /**
+     * Runs the tasks added since the last run(), and returns once all of
+     * them are done. With parallel false, or too few tasks, they run on
+     * this thread. When tasks throw, the others still run, and the first
+     * exception is then rethrown here.
+     */
+    void run(bool parallel = true);
+
+    /**
+     * Width of the shared pool, 0 picks one from the hardware. The
+     * ThreadPoolSizes setting can override it. Only takes effect before the
+     * first run() that starts the pool.
+     */
+    static void setPoolWidth(U32 threads);
+
+private:
+    struct Batch;
+
+    static LL::WorkStealingThreadPool* getPool();
+
+    std::string                                 mName;
+    std::shared_ptr<Batch>                      mBatch;
+    S32                                         mMinParallelTasks;
+};
+
+#endif // LL_LLFORKJOIN_H
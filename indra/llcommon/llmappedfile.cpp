@@ -0,0 +1,141 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llmappedfile.h"
+#include "llstring.h"
+
+#if LL_WINDOWS
+#include "llwin32headers.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool LLMappedFile::open(const std::string& filename)
+{
+    close();
+
+#if LL_WINDOWS
+    // FILE_SHARE_DELETE so that the file can be replaced or removed while mapped
+    HANDLE file = CreateFileW(ll_convert<std::wstring>(filename).c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    mFileHandle = file;
+    mOpen = true;
+    if (file_size.QuadPart == 0)
+    {
+        return true;
+    }
+
+    mMappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMappingHandle)
+    {
+        mData = (const U8*)MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (!mData)
+    {
+        LL_WARNS() << "Unable to map " << filename << " error " << GetLastError() << LL_ENDL;
+        close();
+        return false;
+    }
+    mSize = (size_t)file_size.QuadPart;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mOpen = true;
+    if (file_stat.st_size > 0)
+    {
+        void* data = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            LL_WARNS() << "Unable to map " << filename << ": " << strerror(errno) << LL_ENDL;
+            ::close(fd);
+            mOpen = false;
+            return false;
+        }
+        mData = (const U8*)data;
+        mSize = (size_t)file_stat.st_size;
+    }
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+#endif
+
+    return true;
+}
+
+void LLMappedFile::close()
+{
+#if LL_WINDOWS
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if (mMappingHandle)
+    {
+        CloseHandle(mMappingHandle);
+        mMappingHandle = nullptr;
+    }
+    if (mFileHandle)
+    {
+        CloseHandle(mFileHandle);
+        mFileHandle = nullptr;
+    }
+#else
+    if (mData)
+    {
+        munmap((void*)mData, mSize);
+    }
+#endif
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file llmappedfile.h
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <string>
+
+/**
+ * Maps the current contents of a file read-only into memory. The mapping
+ * does not grow with the file: map it again to see data appended since.
+ *
+ * The file is opened so that it can still be renamed or deleted while it
+ * is mapped (also on Windows). The mapped data stays valid until close()
+ * or destruction.
+ */
+class LL_COMMON_API LLMappedFile
+{
+public:
+    LLMappedFile() = default;
+    LLMappedFile(const std::string& filename) { open(filename); }
+    ~LLMappedFile() { close(); }
+
+    LLMappedFile(const LLMappedFile&) = delete;
+    LLMappedFile& operator=(const LLMappedFile&) = delete;
+
+    /// Map the whole of filename (UTF-8). An empty file opens successfully
+    /// with a null data() and zero size().
+    /// @returns false if the file can't be opened or mapped
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return mOpen; }
+    const U8* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    const U8* mData{ nullptr };
+    size_t mSize{ 0 };
+    bool mOpen{ false };
+#if LL_WINDOWS
+    void* mFileHandle{ nullptr };
+    void* mMappingHandle{ nullptr };
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
@@ -2254,108 +2254,102 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
 
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32 size)
 {
-    U8* result = NULL;
-    llssize cur_size = 0;
-    z_stream strm;
-
-    constexpr U32 CHUNK = 1024 * 512;
+    // <FS> inflate straight into one buffer instead of growing a malloc'd
+    // block chunk by chunk, and reuse it between calls on this thread
+    static thread_local std::vector<U8> result;
 
-    static thread_local std::unique_ptr<U8[]> out;
-    if (!out)
+    EZipRresult unzip_result = unzip(result, in, size);
+    if (unzip_result != ZR_OK)
     {
-        out = std::unique_ptr<U8[]>(new(std::nothrow) U8[CHUNK]);
+        return unzip_result;
     }
 
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = size;
-    strm.next_in = const_cast<U8*>(in);
-
-    S32 ret = inflateInit(&strm);
-
-    do
+    //result now points to the decompressed LLSD block
     {
-        strm.avail_out = CHUNK;
-        strm.next_out = out.get();
-        ret = inflate(&strm, Z_NO_FLUSH);
-        switch (ret)
-        {
-        case Z_NEED_DICT:
-        case Z_DATA_ERROR:
-        {
-            inflateEnd(&strm);
-            // free(result);
-            if( result )
-                free(result);
-            return ZR_DATA_ERROR;
-        }
-        case Z_STREAM_ERROR:
-        case Z_BUF_ERROR:
-        {
-            inflateEnd(&strm);
-            free(result);
-            return ZR_BUFFER_ERROR;
-        }
+        llssize cur_size = result.size();
+        char* result_ptr = strip_deprecated_header((char*)result.data(), cur_size);
 
-        case Z_MEM_ERROR:
-        {
-            inflateEnd(&strm);
-            // free(result);
-            if( result )
-                free(result);
-            return ZR_MEM_ERROR;
-        }
-        }
-
-        U32 have = CHUNK-strm.avail_out;
+        boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
 
-        U8* new_result = (U8*)realloc(result, cur_size + have);
-        if (new_result == NULL)
+        if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
         {
-            inflateEnd(&strm);
-            if (result)
-            {
-                free(result);
-            }
-            return ZR_MEM_ERROR;
+            return ZR_PARSE_ERROR;
         }
-        result = new_result;
-        memcpy(result+cur_size, out.get(), have);
-        cur_size += have;
-
-    } while (ret == Z_OK && ret != Z_STREAM_END);
+    }
 
-    inflateEnd(&strm);
+    // don't pin the memory of an unusually large block
+    constexpr size_t MAX_KEPT_CAPACITY = 4 * 1024 * 1024;
+    if (result.capacity() > MAX_KEPT_CAPACITY)
+    {
+        std::vector<U8>().swap(result);
+    }
+    // </FS>
+    return ZR_OK;
+}
 
-    if (ret != Z_STREAM_END)
+// <FS>
+LLUZipHelper::EZipRresult LLUZipHelper::unzip(std::vector<U8>& out, const U8* in, S32 size)
+{
+    out.clear();
+    if (!in || size <= 0)
     {
-        // free(result);
-        if( result )
-            free(result);
         return ZR_DATA_ERROR;
     }
 
-    //result now points to the decompressed LLSD block
-    {
-        char* result_ptr = strip_deprecated_header((char*)result, cur_size);
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = size;
+    strm.next_in = const_cast<U8*>(in);
 
-        boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
+    if (inflateInit(&strm) != Z_OK)
+    {
+        return ZR_MEM_ERROR;
+    }
 
-        if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
+    // mesh and material blocks typically inflate to 3-6 times their size.
+    // Inflate through a stack chunk and append, so that growing the vector
+    // never zero-fills bytes that are about to be overwritten.
+    constexpr U32 CHUNK = 0x4000;
+    U8 chunk[CHUNK];
+    S32 ret = Z_OK;
+    try
+    {
+        out.reserve((size_t)size * 4);
+        do
         {
-            // free(result);
-            if( result )
-                free(result);
-            return ZR_PARSE_ERROR;
-        }
+            strm.next_out = chunk;
+            strm.avail_out = CHUNK;
+            ret = inflate(&strm, Z_NO_FLUSH);
+            out.insert(out.end(), chunk, chunk + (CHUNK - strm.avail_out));
+        } while (ret == Z_OK);
+    }
+    catch (const std::bad_alloc&)
+    {
+        ret = Z_MEM_ERROR;
     }
 
-    // free(result);
-    if( result )
-        free(result);
-    return ZR_OK;
+    inflateEnd(&strm);
+
+    switch (ret)
+    {
+    case Z_STREAM_END:
+        return ZR_OK;
+    case Z_STREAM_ERROR:
+    case Z_BUF_ERROR:
+        out.clear();
+        return ZR_BUFFER_ERROR;
+    case Z_MEM_ERROR:
+        out.clear();
+        return ZR_MEM_ERROR;
+    default:
+        out.clear();
+        return ZR_DATA_ERROR;
+    }
 }
+// </FS>
+
 //This unzip function will only work with a gzip header and trailer - while the contents
 //of the actual compressed data is the same for either format (gzip vs zlib ), the headers
 //and trailers are different for the formats.
@@ -864,6 +864,11 @@ public:
     // return OK or reason for failure
     static EZipRresult unzip_llsd(LLSD& data, std::istream& is, S32 size);
     static EZipRresult unzip_llsd(LLSD& data, const U8* in, S32 size);
+    // <FS> inflate a zlib block without parsing it, for callers that decode
+    // the binary LLSD themselves. out is resized to the inflated size, its
+    // capacity is kept so that a reused buffer doesn't reallocate.
+    static EZipRresult unzip(std::vector<U8>& out, const U8* in, S32 size);
+    // </FS>
 };
 
 //dirty little zip functions -- yell at davep
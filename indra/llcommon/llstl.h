@@ -306,6 +306,22 @@ inline T* vector_append(std::vector<T>& invec, S32 N)
     return &(invec[sz]);
 }
 
+// <FS> std::stable_sort() of a range whose front is sorted already, such as
+// a sorted list that had elements appended: only the unsorted tail is
+// sorted, then merged into the front. The order is the one of
+// std::stable_sort(), for n compares when nothing was appended.
+template <class RandomIter, class Compare>
+void ll_stable_sort_appended(RandomIter first, RandomIter last, Compare comp)
+{
+    RandomIter tail = std::is_sorted_until(first, last, comp);
+    if (tail != last)
+    {
+        std::stable_sort(tail, last, comp);
+        std::inplace_merge(first, tail, last, comp);
+    }
+}
+// </FS>
+
 // call function f to n members starting at first. similar to std::for_each
 template <class InputIter, class Size, class Function>
 Function ll_for_n(InputIter first, Size n, Function f)
@@ -0,0 +1,128 @@
+/**
+ * @file   llforkjoin_test.cpp
+ * @brief  Test for LLForkJoin.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llforkjoin.h"
+// STL headers
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// std headers
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "stringize.h"
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llforkjoin_data
+    {
+    };
+    typedef test_group<llforkjoin_data> llforkjoin_group;
+    typedef llforkjoin_group::object object;
+    llforkjoin_group llforkjoingrp("llforkjoin");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("every task runs once per run");
+        LLForkJoin fork_join("test fork join 1");
+        const S32 counts[] = { 0, 1, 3, 1000 };
+        for (S32 count : counts)
+        {
+            std::vector<std::atomic<S32> > runs(count);
+            for (S32 i = 0; i < count; ++i)
+            {
+                std::atomic<S32>* runp = &runs[i];
+                fork_join.add([runp]() { ++*runp; });
+            }
+            ensure_equals("queued", fork_join.size(), count);
+            fork_join.run();
+            ensure_equals("emptied", fork_join.size(), 0);
+            for (S32 i = 0; i < count; ++i)
+            {
+                ensure_equals(STRINGIZE("task " << i << " of " << count), runs[i].load(), 1);
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("serial runs stay on the calling thread");
+        LLForkJoin fork_join("test fork join 2");
+        const std::thread::id caller = std::this_thread::get_id();
+        std::atomic<S32> elsewhere{ 0 };
+        for (S32 i = 0; i < 100; ++i)
+        {
+            fork_join.add([caller, &elsewhere]()
+                          {
+                              if (std::this_thread::get_id() != caller)
+                              {
+                                  ++elsewhere;
+                              }
+                          });
+        }
+        fork_join.run(false);
+        ensure_equals("tasks run on another thread", elsewhere.load(), 0);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("a throwing task lets the others finish and rethrows");
+        LLForkJoin fork_join("test fork join 3");
+        for (bool parallel : { false, true })
+        {
+            const S32 COUNT = 100;
+            std::vector<std::atomic<S32> > runs(COUNT);
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                std::atomic<S32>* runp = &runs[i];
+                fork_join.add([runp, i]()
+                              {
+                                  ++*runp;
+                                  if (i % 10 == 3)
+                                  {
+                                      throw std::runtime_error(STRINGIZE("task " << i));
+                                  }
+                              });
+            }
+            bool thrown = false;
+            try
+            {
+                fork_join.run(parallel);
+            }
+            catch (const std::runtime_error&)
+            {
+                thrown = true;
+            }
+            ensure(STRINGIZE("rethrown, parallel " << parallel), thrown);
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                ensure_equals(STRINGIZE("task " << i << ", parallel " << parallel), runs[i].load(), 1);
+            }
+
+            // and the next run works as usual
+            std::atomic<S32> after{ 0 };
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                fork_join.add([&after]() { ++after; });
+            }
+            fork_join.run(parallel);
+            ensure_equals(STRINGIZE("next run, parallel " << parallel), after.load(), COUNT);
+        }
+    }
+}
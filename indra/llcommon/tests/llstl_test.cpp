@@ -0,0 +1,131 @@
+/**
+ * @file   llstl_test.cpp
+ * @date   2024-11
+ * @brief  Test of llstl.h algorithms.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llstl.h"
+#include "llstring.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <deque>
+#include <random>
+
+namespace
+{
+    // a list row: sorted by name, seq tells equal names apart
+    struct Row
+    {
+        std::string mName;
+        S32         mSeq;
+    };
+
+    // as LLScrollListCtrl sorts its rows
+    struct SortRows
+    {
+        bool operator()(const Row* lhs, const Row* rhs) const
+        {
+            return LLStringUtil::compareDict(lhs->mName, rhs->mName) < 0;
+        }
+    };
+
+    // few distinct names, so that there are equal ones to keep in order
+    std::vector<Row> make_rows(S32 count, S32 names, U32 seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<S32> name(0, names - 1);
+        std::vector<Row> rows;
+        rows.reserve(count);
+        for (S32 i = 0; i < count; ++i)
+        {
+            rows.push_back(Row{ STRINGIZE("Resident " << name(generator)), i });
+        }
+        return rows;
+    }
+}
+
+namespace tut
+{
+    struct stl_data
+    {
+        void ensure_same_order(const std::string& msg, const std::deque<Row*>& expected, const std::deque<Row*>& actual)
+        {
+            ensure_equals(msg + " size", actual.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                ensure_equals(STRINGIZE(msg << " row " << i), actual[i]->mSeq, expected[i]->mSeq);
+            }
+        }
+    };
+
+    typedef test_group<stl_data> stl_test;
+    typedef stl_test::object stl_object;
+    tut::stl_test stl_testcase("llstl");
+
+    template<> template<>
+    void stl_object::test<1>()
+    {
+        set_test_name("ll_stable_sort_appended() sorts as std::stable_sort()");
+        std::vector<Row> rows = make_rows(2000, 50, 1);
+
+        // sorted, then rows appended in batches, as a list filling up
+        std::deque<Row*> expected;
+        std::deque<Row*> actual;
+        for (size_t first = 0; first < rows.size(); first += 300)
+        {
+            for (size_t i = first; i < llmin(first + 300, rows.size()); ++i)
+            {
+                expected.push_back(&rows[i]);
+                actual.push_back(&rows[i]);
+            }
+            std::stable_sort(expected.begin(), expected.end(), SortRows());
+            ll_stable_sort_appended(actual.begin(), actual.end(), SortRows());
+            ensure_same_order(STRINGIZE("batch " << first), expected, actual);
+        }
+
+        // nothing appended
+        ll_stable_sort_appended(actual.begin(), actual.end(), SortRows());
+        ensure_same_order("sorted", expected, actual);
+
+        // in place edit in the middle
+        rows[actual[1000]->mSeq].mName = "AAA";
+        std::stable_sort(expected.begin(), expected.end(), SortRows());
+        ll_stable_sort_appended(actual.begin(), actual.end(), SortRows());
+        ensure_same_order("edited", expected, actual);
+
+        // nothing sorted, and empty
+        std::deque<Row*> reversed(expected.rbegin(), expected.rend());
+        std::deque<Row*> expected_reversed(reversed);
+        std::stable_sort(expected_reversed.begin(), expected_reversed.end(), SortRows());
+        ll_stable_sort_appended(reversed.begin(), reversed.end(), SortRows());
+        ensure_same_order("reversed", expected_reversed, reversed);
+        std::deque<Row*> empty;
+        ll_stable_sort_appended(empty.begin(), empty.end(), SortRows());
+        ensure("empty", empty.empty());
+    }
+}
@@ -15,8 +15,12 @@
 #include "workqueue.h"
 // STL headers
 // std headers
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <deque>
+#include <thread>
+#include <vector>
 // external library headers
 // other Linden headers
 #include "../test/lltut.h"
@@ -26,6 +30,7 @@
 #include "lleventcoro.h"
 #include "llstring.h"
 #include "stringize.h"
+#include "threadpool.h"
 
 using namespace LL;
 using namespace std::literals::chrono_literals; // ms suffix
@@ -236,4 +241,151 @@ namespace tut
         ensure_equals("didn't run coroutine", stored, "ran");
         ensure("void waitForResult() didn't return", done);
     }
+
+    template<> template<>
+    void object::test<7>()
+    {
+        set_test_name("WorkStealingQueue post, postTo and waitForResult");
+        WorkStealingQueue stealing("stealing", 1024, true, 4);
+        ensure("findable", WorkStealingQueue::getInstance("stealing") == stealing.getWeak().lock());
+        ensure_equals("lanes", stealing.getLaneCount(), 4);
+
+        // with a single consumer, work runs in posting order
+        std::string order;
+        stealing.post([&order](){ order.append("a"); });
+        stealing.post([&order](){ order.append("b"); });
+        stealing.post([&order](){ order.append("c"); }, WorkStealingQueue::PRIORITY_HIGH);
+        ensure_equals("size", stealing.size(), 3);
+        stealing.runPending();
+        ensure_equals("high priority first", order, "cab");
+
+        WorkSchedule main("main");
+        int result = 0;
+        main.postTo(stealing.getWeak(), [](){ return 17; }, [&result](int i){ result = i; });
+        stealing.runOne();
+        main.runOne();
+        ensure_equals("postTo", result, 17);
+
+        std::string stored;
+        LLCoros::instance().launch(
+            "waitForResult stealing",
+            [&stealing, &stored]()
+            { stored = stealing.waitForResult([](){ return "stolen"; }); });
+        llcoro::suspend();
+        stealing.runOne();
+        llcoro::suspend();
+        ensure_equals("waitForResult", stored, "stolen");
+
+        WorkStealingQueue small("small", 2, true, 2);
+        ensure("tryPost 1", small.tryPost([](){}));
+        ensure("tryPost 2", small.tryPost([](){}));
+        ensure("tryPost when full", ! small.tryPost([](){}));
+
+        stealing.close();
+        ensure("post after close", ! stealing.post([](){}));
+        ensure("done", stealing.done());
+        // must return rather than block
+        stealing.runUntilClose();
+    }
+
+    template<> template<>
+    void object::test<8>()
+    {
+        set_test_name("WorkStealingThreadPool runs everything exactly once");
+        constexpr size_t JOBS = 20000;
+        std::vector<std::atomic<U32>> runs(JOBS);
+        {
+            WorkStealingThreadPool pool("stealing pool", 4, 1024*1024, false);
+            pool.start();
+            auto& queue = pool.getQueue();
+            // half posted from outside, half fanned out from the workers
+            for (size_t i = 0; i < JOBS; i += 2)
+            {
+                queue.post([&runs, &queue, i]()
+                {
+                    ++runs[i];
+                    queue.post([&runs, i](){ ++runs[i + 1]; });
+                });
+            }
+            while (! std::all_of(runs.begin(), runs.end(), [](const std::atomic<U32>& n){ return n.load() > 0; }))
+            {
+                std::this_thread::sleep_for(1ms);
+            }
+            pool.close();
+        }
+        ensure("each job ran once",
+               std::all_of(runs.begin(), runs.end(), [](const std::atomic<U32>& n){ return n.load() == 1; }));
+    }
+
+    namespace
+    {
+        // Post small jobs from a few producer threads and report throughput
+        // and post-to-run latency
+        template <class QUEUE>
+        void benchmark_pool(const std::string& name, size_t threads, size_t jobs)
+        {
+            using clock = std::chrono::steady_clock;
+            ThreadPoolUsing<QUEUE> pool(name, threads, jobs, false);
+            pool.start();
+            auto& queue = pool.getQueue();
+
+            std::vector<F64> latencies(jobs);
+            std::atomic<size_t> remaining{ jobs };
+            constexpr size_t PRODUCERS = 4;
+            auto start = clock::now();
+            std::vector<std::thread> producers;
+            for (size_t p = 0; p < PRODUCERS; ++p)
+            {
+                producers.emplace_back([&, p]()
+                {
+                    for (size_t i = p; i < jobs; i += PRODUCERS)
+                    {
+                        auto posted = clock::now();
+                        queue.post([&, i, posted]()
+                        {
+                            latencies[i] = std::chrono::duration<F64, std::micro>(clock::now() - posted).count();
+                            // a few hundred ns of work, like a small decode step
+                            volatile U32 sink = 0;
+                            for (U32 k = 0; k < 200; ++k)
+                            {
+                                sink = sink + k;
+                            }
+                            --remaining;
+                        });
+                    }
+                });
+            }
+            for (auto& producer : producers)
+            {
+                producer.join();
+            }
+            while (remaining)
+            {
+                std::this_thread::yield();
+            }
+            F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+            pool.close();
+
+            std::sort(latencies.begin(), latencies.end());
+            std::cout << name << " (" << threads << " threads): "
+                      << (U64)(jobs / seconds) << " jobs/s, latency median "
+                      << latencies[jobs / 2] << "us, p99 " << latencies[jobs * 99 / 100] << "us" << std::endl;
+        }
+    }
+
+    template<> template<>
+    void object::test<9>()
+    {
+        set_test_name("WorkQueue vs WorkStealingQueue benchmark");
+        // Timing runs are noisy and slow, only run on request:
+        // LL_WORKQUEUE_BENCHMARK=1
+        if (! getenv("LL_WORKQUEUE_BENCHMARK"))
+        {
+            skip("set LL_WORKQUEUE_BENCHMARK to compare the queues");
+        }
+        constexpr size_t JOBS = 500000;
+        size_t threads = llmax(2u, std::thread::hardware_concurrency());
+        benchmark_pool<WorkQueue>("WorkQueue", threads, JOBS);
+        benchmark_pool<WorkStealingQueue>("WorkStealingQueue", threads, JOBS);
+    }
 } // namespace tut
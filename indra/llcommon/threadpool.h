@@ -98,7 +98,8 @@ namespace LL
     };
 
     /**
-     * Specialize with WorkQueue or, for timestamped tasks, WorkSchedule
+     * Specialize with WorkQueue or, for timestamped tasks, WorkSchedule. Wide
+     * pools fed lots of small tasks scale better with WorkStealingQueue.
      */
     template <class QUEUE>
     struct ThreadPoolUsing: public ThreadPoolBase
@@ -136,6 +137,9 @@ namespace LL
     /// ThreadPool is shorthand for using the simpler WorkQueue
     using ThreadPool = ThreadPoolUsing<WorkQueue>;
 
+    /// WorkStealingThreadPool gives each worker its own lane of work
+    using WorkStealingThreadPool = ThreadPoolUsing<WorkStealingQueue>;
+
 } // namespace LL
 
 #endif /* ! defined(LL_THREADPOOL_H) */
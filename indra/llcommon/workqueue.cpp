@@ -14,6 +14,9 @@
 // associated header
 #include "workqueue.h"
 // STL headers
+#include <deque>
+#include <mutex>
+#include <thread>
 // std headers
 // external library headers
 // other Linden headers
@@ -391,3 +394,258 @@ bool LL::WorkSchedule::tryPop_(Work& work)
 {
     return mQueue.tryPop(work);
 }
+
+/*****************************************************************************
+*   WorkStealingQueue
+*****************************************************************************/
+struct LL::WorkStealingQueue::Lane
+{
+    // std::mutex rather than a fiber mutex: it's only held to push or pop
+    alignas(64) std::mutex mMutex;
+    std::deque<Work> mWork;
+};
+
+namespace
+{
+    // Lanes claimed by the current thread, by queue ID. A thread normally
+    // serves a single queue so this stays tiny.
+    thread_local std::vector<std::pair<U64, size_t>> sWorkerLanes;
+
+    std::atomic<U64> sNextQueueId{ 1 };
+} // anonymous namespace
+
+LL::WorkStealingQueue::WorkStealingQueue(const std::string& name, size_t capacity,
+                                         bool auto_shutdown, size_t lanes):
+    super(name, auto_shutdown),
+    mHighPriority(std::make_unique<Lane>()),
+    mQueueId(sNextQueueId++),
+    mCapacity(capacity)
+{
+    if (! lanes)
+    {
+        lanes = llmax(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        mLanes.emplace_back(std::make_unique<Lane>());
+    }
+}
+
+LL::WorkStealingQueue::~WorkStealingQueue()
+{
+}
+
+void LL::WorkStealingQueue::close()
+{
+    // Take every lane lock so that no push can slip in after close() returns
+    {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.emplace_back(mHighPriority->mMutex);
+        for (auto& lane : mLanes)
+        {
+            locks.emplace_back(lane->mMutex);
+        }
+        mClosed = true;
+    }
+    LockType lock(mWaitMutex);
+    mWorkCond.notify_all();
+    mSpaceCond.notify_all();
+}
+
+size_t LL::WorkStealingQueue::size()
+{
+    return mSize;
+}
+
+bool LL::WorkStealingQueue::isClosed()
+{
+    return mClosed;
+}
+
+bool LL::WorkStealingQueue::done()
+{
+    return mClosed && ! mSize;
+}
+
+bool LL::WorkStealingQueue::post(const Work& callable)
+{
+    return push_(callable, PRIORITY_NORMAL, true);
+}
+
+bool LL::WorkStealingQueue::post(const Work& callable, EPriority priority)
+{
+    return push_(callable, priority, true);
+}
+
+bool LL::WorkStealingQueue::tryPost(const Work& callable)
+{
+    return push_(callable, PRIORITY_NORMAL, false);
+}
+
+bool LL::WorkStealingQueue::tryPost(const Work& callable, EPriority priority)
+{
+    return push_(callable, priority, false);
+}
+
+bool LL::WorkStealingQueue::push_(const Work& callable, EPriority priority, bool wait)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    if (mSize >= mCapacity)
+    {
+        if (! wait)
+        {
+            return false;
+        }
+        LL_WARNS_ONCE("ThreadPool") << "WorkStealingQueue " << getKey() << " full " << mSize << " >= " << mCapacity << LL_ENDL;
+        LockType lock(mWaitMutex);
+        ++mBlockedProducers;
+        while (mSize >= mCapacity && ! mClosed)
+        {
+            mSpaceCond.wait(lock);
+        }
+        --mBlockedProducers;
+    }
+
+    Lane& lane = (priority == PRIORITY_HIGH) ? *mHighPriority : *mLanes[getPostLane()];
+    // Count the item before it becomes visible so that a pop can never take
+    // mSize below zero. Pairs with the idle check in pop_(): either the
+    // worker going idle sees the new size, or we see the idle worker.
+    ++mSize;
+    try
+    {
+        std::lock_guard<std::mutex> lock(lane.mMutex);
+        if (mClosed)
+        {
+            --mSize;
+            return false;
+        }
+        lane.mWork.push_back(callable);
+    }
+    catch (std::bad_alloc&)
+    {
+        --mSize;
+        LLError::LLUserWarningMsg::showOutOfMemory();
+        LL_ERRS("LLCoros") << "Bad memory allocation in WorkStealingQueue::post" << LL_ENDL;
+        return false;
+    }
+
+    if (mIdleWorkers)
+    {
+        LockType lock(mWaitMutex);
+        mWorkCond.notify_one();
+    }
+    return true;
+}
+
+LL::WorkStealingQueue::Work LL::WorkStealingQueue::pop_()
+{
+    // Threads blocking in pop_() are the workers: give them a lane
+    getLane(true);
+    for (;;)
+    {
+        Work work;
+        if (tryPop_(work))
+        {
+            return work;
+        }
+
+        LockType lock(mWaitMutex);
+        ++mIdleWorkers;
+        while (! mSize && ! mClosed)
+        {
+            mWorkCond.wait(lock);
+        }
+        --mIdleWorkers;
+        if (mClosed && ! mSize)
+        {
+            LLTHROW(Closed());
+        }
+        // otherwise something was posted (or is still being drained after
+        // close()): go look for it. It may take a moment to show up in its
+        // lane, in which case we come straight back here.
+    }
+}
+
+bool LL::WorkStealingQueue::tryPop_(Work& work)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    if (! mSize)
+    {
+        return false;
+    }
+
+    if (popFrom(*mHighPriority, work))
+    {
+        return true;
+    }
+
+    // Own lane first, then steal from the others in turn. Threads that
+    // aren't workers of this queue just scan from the first lane.
+    size_t own = getLane(false);
+    if (own == NO_LANE)
+    {
+        own = 0;
+    }
+    for (size_t i = 0, count = mLanes.size(); i < count; ++i)
+    {
+        if (popFrom(*mLanes[(own + i) % count], work))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LL::WorkStealingQueue::popFrom(Lane& lane, Work& work)
+{
+    {
+        std::lock_guard<std::mutex> lock(lane.mMutex);
+        if (lane.mWork.empty())
+        {
+            return false;
+        }
+        work = std::move(lane.mWork.front());
+        lane.mWork.pop_front();
+    }
+
+    --mSize;
+    if (mBlockedProducers)
+    {
+        LockType lock(mWaitMutex);
+        mSpaceCond.notify_one();
+    }
+    return true;
+}
+
+size_t LL::WorkStealingQueue::getLane(bool register_worker)
+{
+    for (const auto& entry : sWorkerLanes)
+    {
+        if (entry.first == mQueueId)
+        {
+            return entry.second;
+        }
+    }
+
+    if (register_worker)
+    {
+        size_t lane = mWorkers++ % mLanes.size();
+        sWorkerLanes.emplace_back(mQueueId, lane);
+        return lane;
+    }
+    return NO_LANE;
+}
+
+size_t LL::WorkStealingQueue::getPostLane()
+{
+    size_t lane = getLane(false);
+    if (lane != NO_LANE)
+    {
+        return lane;
+    }
+
+    // Spread posts from outside over the lanes that have workers. Until a
+    // second worker shows up, everything goes to lane 0 and keeps its order.
+    size_t workers = llclamp(mWorkers.load(), size_t(1), mLanes.size());
+    return workers > 1 ? mNextPost++ % workers : 0;
+}
@@ -18,10 +18,15 @@
 #include "llinstancetracker.h"
 #include "llinstancetrackersubclass.h"
 #include "threadsafeschedule.h"
+#include LLCOROS_MUTEX_HEADER
+#include LLCOROS_CONDVAR_HEADER
+#include <atomic>
 #include <chrono>
 #include <exception>                // std::current_exception
 #include <functional>               // std::function
+#include <memory>                   // std::unique_ptr
 #include <string>
+#include <vector>
 
 class LLEventPumps;
 
@@ -365,6 +370,116 @@ namespace LL
         bool tryPop_(Work&) override;
     };
 
+/*****************************************************************************
+*   WorkStealingQueue: per-worker lanes for wide ThreadPools
+*****************************************************************************/
+    /**
+     * WorkStealingQueue serves the same purpose as WorkQueue, but instead of
+     * a single locked queue it keeps a lane (deque) per worker thread. Each
+     * worker takes work from its own lane and only when that is empty steals
+     * from the other lanes, so a wide ThreadPool doesn't serialize on one
+     * mutex when it's handed thousands of small tasks.
+     *
+     * * Work posted by one of the queue's own workers lands in that worker's
+     *   lane. Work posted from any other thread is spread over the lanes.
+     * * Work posted with PRIORITY_HIGH goes to a shared lane that every
+     *   worker checks first.
+     * * With a single worker, work runs in the order it was posted. With
+     *   more than one there is no ordering between lanes: use WorkQueue if
+     *   you depend on it.
+     * * capacity is honored approximately: concurrent producers may exceed
+     *   it by a few items.
+     *
+     * Select it with ThreadPoolUsing<WorkStealingQueue>.
+     */
+    class WorkStealingQueue: public LLInstanceTrackerSubclass<WorkStealingQueue, WorkQueueBase>
+    {
+    private:
+        using super = LLInstanceTrackerSubclass<WorkStealingQueue, WorkQueueBase>;
+
+    public:
+        enum EPriority
+        {
+            PRIORITY_NORMAL,
+            PRIORITY_HIGH
+        };
+
+        /**
+         * You may omit the WorkStealingQueue name, in which case a unique
+         * name is synthesized; for practical purposes that makes it
+         * anonymous. lanes = 0 means one lane per hardware thread.
+         */
+        WorkStealingQueue(const std::string& name = std::string(), size_t capacity=1024,
+                          bool auto_shutdown = true, size_t lanes = 0);
+        ~WorkStealingQueue() override;
+
+        void close() override;
+
+        /// See WorkQueue::size() for the caveats.
+        size_t size() override;
+        /// producer end: are we prevented from pushing any additional items?
+        bool isClosed() override;
+        /// consumer end: are we done, is the queue entirely drained?
+        bool done() override;
+
+        /*---------------------- fire and forget API -----------------------*/
+
+        /**
+         * post work, unless the queue is closed before we can post
+         */
+        bool post(const Work& callable) override;
+
+        /**
+         * post work at the given priority, unless the queue is closed before
+         * we can post
+         */
+        bool post(const Work& callable, EPriority priority);
+
+        /**
+         * post work, unless the queue is full
+         */
+        bool tryPost(const Work& callable) override;
+
+        /**
+         * post work at the given priority, unless the queue is full
+         */
+        bool tryPost(const Work& callable, EPriority priority);
+
+        size_t getLaneCount() const { return mLanes.size(); }
+
+    private:
+        struct Lane;
+        using LockType = std::unique_lock<LLCoros::Mutex>;
+
+        bool push_(const Work& callable, EPriority priority, bool wait);
+        Work pop_() override;
+        bool tryPop_(Work&) override;
+        bool popFrom(Lane& lane, Work& work);
+        // lane of the calling worker thread, or NO_LANE
+        size_t getLane(bool register_worker);
+        size_t getPostLane();
+
+        static constexpr size_t NO_LANE = size_t(-1);
+
+        std::vector<std::unique_ptr<Lane>> mLanes;
+        std::unique_ptr<Lane> mHighPriority;
+        const U64 mQueueId;
+        const size_t mCapacity;
+
+        std::atomic<size_t> mSize{ 0 };
+        std::atomic<bool> mClosed{ false };
+        // lanes claimed by worker threads, and the next lane for outside posts
+        std::atomic<size_t> mWorkers{ 0 };
+        std::atomic<size_t> mNextPost{ 0 };
+
+        // idle workers and blocked producers wait here
+        LLCoros::Mutex mWaitMutex;
+        LLCoros::ConditionVariable mWorkCond;
+        LLCoros::ConditionVariable mSpaceCond;
+        std::atomic<U32> mIdleWorkers{ 0 };
+        std::atomic<U32> mBlockedProducers{ 0 };
+    };
+
     /**
      * BackJack is, in effect, a hand-rolled lambda, binding a WorkSchedule, a
      * CALLABLE that returns bool, a TimePoint and an interval at which to
@@ -153,6 +153,10 @@ constexpr int HTTP_CONNECTION_LIMIT_MAX = 256;
 constexpr long HTTP_PIPELINING_DEFAULT = 0L;
 constexpr long HTTP_PIPELINING_MAX = 20L;
 
+// HTTP/2 multiplexing limits, servers commonly allow 100 streams
+constexpr long HTTP_HTTP2_STREAMS_DEFAULT = 0L;
+constexpr long HTTP_HTTP2_STREAMS_MAX = 100L;
+
 // Miscellaneous defaults
 constexpr bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 constexpr long HTTP_THROTTLE_RATE_DEFAULT = 0L;
@@ -542,7 +542,26 @@ void HttpLibcurl::policyUpdated(unsigned int policy_class)
         policy.stallPolicy(policy_class, false);
         mDirtyPolicy[policy_class] = false;
 
-        if (options.mPipelining > 1)
+        if (options.mHttp2Streams > 0)
+        {
+            // Multiplex HTTP/2 streams, libcurl manages the connections
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_PIPELINING,
+                                     CURLPIPE_MULTIPLEX);
+#if LIBCURL_VERSION_NUM >= 0x074300
+            // requires curl 7.67.0
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_CONCURRENT_STREAMS,
+                                     long(options.mHttp2Streams));
+#endif
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_HOST_CONNECTIONS,
+                                     long(options.mPerHostConnectionLimit));
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                                     long(options.mConnectionLimit));
+        }
+        else if (options.mPipelining > 1)
         {
             // We'll try to do pipelining on this multihandle
             check_curl_multi_setopt(multi_handle,
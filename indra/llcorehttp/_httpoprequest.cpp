@@ -731,7 +731,18 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
     {
         xfer_timeout = timeout;
     }
-    if (cpolicy.mPipelining > 1L)
+    if (cpolicy.mHttp2Streams > 0L)
+    {
+        // Streams share the connection's bandwidth so transfers take
+        // longer, give them the same room as pipelined requests.
+        xfer_timeout *= 2L;
+
+        // HTTP/2 where TLS negotiates it, and wait for a connection
+        // that can take one more stream before opening another.
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
+    }
+    else if (cpolicy.mPipelining > 1L)
     {
         // Pipelining affects both connection and transfer timeout values.
         // Requests that are added to a pipeling immediately have completed
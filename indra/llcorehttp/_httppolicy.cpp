@@ -249,7 +249,10 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
         }
 
         int active(transport.getActiveCountInClass(policy_class));
-        int active_limit(state.mOptions.mPipelining > 1L
+        int active_limit(state.mOptions.mHttp2Streams > 0L
+                         ? (state.mOptions.mPerHostConnectionLimit
+                            * state.mOptions.mHttp2Streams)
+                         : state.mOptions.mPipelining > 1L
                          ? (state.mOptions.mPerHostConnectionLimit
                             * state.mOptions.mPipelining)
                          : state.mOptions.mConnectionLimit);
@@ -232,6 +232,20 @@ public:
         /// Global only
         PO_SSL_VERIFY_CALLBACK,
 
+        /// If greater than 0, requests of the class ask for HTTP/2
+        /// (negotiated on https: connections) and libcurl multiplexes
+        /// them over its connections.  Value gives the maximum number
+        /// of concurrent streams on a connection.  Requests wait for
+        /// a connection to multiplex on rather than opening a new one,
+        /// so PO_PER_HOST_CONNECTION_LIMIT gives the connections per
+        /// host and in-flight requests go up to that limit times this
+        /// value.  Servers answering in HTTP/1.1 get one request per
+        /// connection, as when this is 0.  Takes precedence over
+        /// PO_PIPELINING_DEPTH.
+        ///
+        /// Per-class only
+        PO_HTTP2_STREAMS,
+
         PO_LAST  // Always at end
     };
 
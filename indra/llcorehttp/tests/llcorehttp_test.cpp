@@ -105,6 +105,23 @@ std::string get_base_url()
 }
 
 
+// HTTP/2 stand-in of test_llcorehttp_peer.py, empty when it isn't running
+std::string get_h2_base_url()
+{
+    const char * env(getenv("LL_TEST_H2_PORT"));
+
+    if (! env)
+    {
+        return std::string();
+    }
+
+    int port(atoi(env));
+    std::ostringstream out;
+    out << "https://127.0.0.1:" << port << "/";
+    return out.str();
+}
+
+
 void stop_thread(LLCore::HttpRequest * req)
 {
     if (req)
@@ -37,6 +37,9 @@
 
 #include <curl/curl.h>
 #include <boost/regex.hpp>
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <sstream>
 
 #include "llcorehttp_test.h"
@@ -185,6 +188,53 @@ public:
     regex_container_t mHeadersDisallowed;
 };
 
+// Keeps a number of GETs in flight and records their latencies
+class ConcurrencyHandler : public LLCore::HttpHandler
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+    ConcurrencyHandler(size_t body_size)
+        : mBodySize(body_size),
+          mCompleted(0),
+          mFailed(0)
+        {}
+
+    void issued(HttpHandle handle)
+        {
+            mStarted[handle] = clock_t::now();
+        }
+
+    virtual void onCompleted(HttpHandle handle, HttpResponse * response)
+        {
+            std::map<HttpHandle, clock_t::time_point>::iterator it(mStarted.find(handle));
+            if (mStarted.end() == it)
+            {
+                return;     // the stop request
+            }
+            mLatencies.push_back(std::chrono::duration<double, std::milli>(clock_t::now() - it->second).count());
+            mStarted.erase(it);
+
+            BufferArray * body(response ? response->getBody() : NULL);
+            if (! response || response->getStatus() != HttpStatus(200) || ! body || body->size() != mBodySize)
+            {
+                ++mFailed;
+            }
+            ++mCompleted;
+        }
+
+    size_t inFlight() const
+        {
+            return mStarted.size();
+        }
+
+    size_t mBodySize;
+    int mCompleted;
+    int mFailed;
+    std::map<HttpHandle, clock_t::time_point> mStarted;
+    std::vector<double> mLatencies;
+};
+
 typedef test_group<HttpRequestTestData> HttpRequestTestGroupType;
 typedef HttpRequestTestGroupType::object HttpRequestTestObjectType;
 HttpRequestTestGroupType HttpRequestTestGroup("HttpRequest Tests");
@@ -3043,6 +3093,104 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+    ScopedCurlInit ready;
+
+    set_test_name("HttpRequest GETs multiplexed over HTTP/2");
+
+    // Against the HTTP/2 stand-in of test_llcorehttp_peer.py, which
+    // answers each request after a delay standing for the round trip to
+    // a CDN.  Runs 8, 32 and 128 concurrent requests with one connection
+    // per request, then multiplexed, and reports latency and throughput.
+    const std::string url_base(get_h2_base_url());
+    if (url_base.empty())
+    {
+        skip("no HTTP/2 stand-in server (needs the python h2 package and openssl)");
+    }
+
+    static const size_t BODY_SIZE(16384);
+    static const int REQUESTS_PER_RUN(512);
+    std::ostringstream url;
+    url << url_base << "delay/20/bytes/" << BODY_SIZE << "/";
+
+    for (int concurrency : { 8, 32, 128 })
+    {
+        for (bool multiplexed : { false, true })
+        {
+            ConcurrencyHandler handler(BODY_SIZE);
+            LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+            HttpRequest * req = NULL;
+            HttpOptions::ptr_t opts;
+
+            try
+            {
+                HttpRequest::createService();
+
+                HttpRequest::policy_t policy(HttpRequest::createPolicyClass());
+                const long streams(multiplexed ? 32L : 0L);
+                const long connections(multiplexed ? (concurrency + streams - 1) / streams : concurrency);
+                HttpRequest::setStaticPolicyOption(HttpRequest::PO_CONNECTION_LIMIT, policy, connections, NULL);
+                HttpRequest::setStaticPolicyOption(HttpRequest::PO_PER_HOST_CONNECTION_LIMIT, policy, connections, NULL);
+                HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAMS, policy, streams, NULL);
+
+                HttpRequest::startThread();
+                req = new HttpRequest();
+
+                // self-signed certificate
+                opts = HttpOptions::ptr_t(new HttpOptions());
+                opts->setSSLVerifyPeer(false);
+                opts->setSSLVerifyHost(false);
+
+                const ConcurrencyHandler::clock_t::time_point start(ConcurrencyHandler::clock_t::now());
+                int issued(0);
+                int count(0);
+                int limit(20 * LOOP_COUNT_LONG);        // a minute at 1ms a loop
+                while (count++ < limit && handler.mCompleted < REQUESTS_PER_RUN)
+                {
+                    while (issued < REQUESTS_PER_RUN && int(handler.inFlight()) < concurrency)
+                    {
+                        HttpHandle handle = req->requestGet(policy, url.str(), opts, HttpHeaders::ptr_t(), handlerp);
+                        ensure("Valid handle returned for get request", handle != LLCORE_HTTP_HANDLE_INVALID);
+                        handler.issued(handle);
+                        ++issued;
+                    }
+                    req->update(0);
+                    usleep(1000);
+                }
+                const double seconds(std::chrono::duration<double>(ConcurrencyHandler::clock_t::now() - start).count());
+                ensure("Requests executed in reasonable time", count < limit);
+                ensure_equals("Failed requests", handler.mFailed, 0);
+
+                std::vector<double> & latencies(handler.mLatencies);
+                std::sort(latencies.begin(), latencies.end());
+                std::cout << (multiplexed ? "HTTP/2 multiplexed" : "connection per request")
+                          << ", " << concurrency << " concurrent: "
+                          << (REQUESTS_PER_RUN / seconds) << " req/s, "
+                          << (REQUESTS_PER_RUN * BODY_SIZE / seconds / (1024.0 * 1024.0)) << " MB/s, latency ms p50 "
+                          << latencies[latencies.size() / 2] << " p90 " << latencies[latencies.size() * 9 / 10]
+                          << " max " << latencies.back() << std::endl;
+
+                stop_thread(req);
+                opts.reset();
+                delete req;
+                req = NULL;
+                HttpRequest::destroyService();
+            }
+            catch (...)
+            {
+                stop_thread(req);
+                opts.reset();
+                delete req;
+                HttpRequest::destroyService();
+                throw;
+            }
+        }
+    }
+}
+
+
 }  // end namespace tut
 
 namespace
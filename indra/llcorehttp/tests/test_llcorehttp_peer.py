@@ -30,10 +30,17 @@ $/LicenseInfo$
 """
 
 import os
+import re
+import ssl
 import sys
 import time
 import select
 import getopt
+import asyncio
+import shutil
+import tempfile
+import threading
+import subprocess
 from io import StringIO
 from http.server import HTTPServer, BaseHTTPRequestHandler
 
@@ -285,6 +292,145 @@ class Server(HTTPServer):
         print('-'*40)
 
 
+class H2StandIn(object):
+    """HTTP/2 stand-in for a CDN, over TLS with a throwaway self-signed
+    certificate.  Clients that don't negotiate 'h2' by ALPN get HTTP/1.1
+    with keepalive on the same port.  Every stream or request is answered
+    concurrently, which is what the multiplexing tests need.  Paths:
+    - '/bytes/<n>/'     200 response with a body of n bytes
+    - '/delay/<ms>/'    answer after ms milliseconds, combines with
+                        '/bytes/' to mimic round trips to a remote host
+
+    Needs the 'h2' package and an 'openssl' executable.  start() returns
+    the port, or None when either is missing.
+    """
+    def __init__(self):
+        self.loop = None
+        self.thread = None
+        self.certdir = None
+
+    def start(self):
+        try:
+            import h2.config, h2.connection, h2.events
+        except ImportError:
+            debug("h2 package missing, no HTTP/2 stand-in")
+            return None
+        self.h2 = h2
+        self.certdir = tempfile.mkdtemp()
+        cert = os.path.join(self.certdir, "cert.pem")
+        key = os.path.join(self.certdir, "key.pem")
+        try:
+            subprocess.check_call(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes",
+                                   "-keyout", key, "-out", cert, "-days", "1",
+                                   "-subj", "/CN=127.0.0.1"],
+                                  stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        except (OSError, subprocess.CalledProcessError):
+            debug("openssl failed, no HTTP/2 stand-in")
+            return None
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(cert, key)
+        context.set_alpn_protocols(["h2", "http/1.1"])
+
+        self.loop = asyncio.new_event_loop()
+        server = self.loop.run_until_complete(
+            asyncio.start_server(self.serve, "127.0.0.1", 0, ssl=context))
+        port = server.sockets[0].getsockname()[1]
+        self.thread = threading.Thread(target=self.loop.run_forever, daemon=True)
+        self.thread.start()
+        return port
+
+    def stop(self):
+        if self.loop:
+            self.loop.call_soon_threadsafe(self.loop.stop)
+            self.thread.join(5)
+        if self.certdir:
+            shutil.rmtree(self.certdir, ignore_errors=True)
+
+    @staticmethod
+    def answer(path):
+        match = re.search(r"/delay/(\d+)/", path)
+        delay = int(match.group(1)) / 1000.0 if match else 0.0
+        match = re.search(r"/bytes/(\d+)/", path)
+        body = b"x" * (int(match.group(1)) if match else 0)
+        return delay, body
+
+    async def serve(self, reader, writer):
+        try:
+            protocol = writer.get_extra_info("ssl_object").selected_alpn_protocol()
+            if protocol == "h2":
+                await self.serve_h2(reader, writer)
+            else:
+                await self.serve_http1(reader, writer)
+        except Exception as e:
+            debug("HTTP/2 stand-in connection error: %s", e)
+        finally:
+            writer.close()
+
+    async def serve_http1(self, reader, writer):
+        while True:
+            head = await reader.readuntil(b"\r\n\r\n")
+            path = head.split(b" ", 2)[1].decode("latin-1")
+            delay, body = self.answer(path)
+            if delay:
+                await asyncio.sleep(delay)
+            writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+                         b"Content-Length: %d\r\n\r\n" % len(body) + body)
+            await writer.drain()
+
+    async def serve_h2(self, reader, writer):
+        h2 = self.h2
+        conn = h2.connection.H2Connection(config=h2.config.H2Configuration(client_side=False))
+        conn.initiate_connection()
+        writer.write(conn.data_to_send())
+        pending = {}                    # stream id -> body still to send
+
+        async def respond(stream_id, path):
+            delay, body = self.answer(path)
+            if delay:
+                await asyncio.sleep(delay)
+            conn.send_headers(stream_id, [(":status", "200"),
+                                          ("content-type", "application/octet-stream"),
+                                          ("content-length", str(len(body)))])
+            pending[stream_id] = body
+            flush()
+
+        def flush():
+            for stream_id, body in list(pending.items()):
+                while body:
+                    size = min(conn.local_flow_control_window(stream_id),
+                               conn.max_outbound_frame_size, len(body))
+                    if size <= 0:
+                        break
+                    conn.send_data(stream_id, body[:size])
+                    body = body[size:]
+                if body:
+                    pending[stream_id] = body
+                else:
+                    conn.end_stream(stream_id)
+                    del pending[stream_id]
+            writer.write(conn.data_to_send())
+
+        while True:
+            data = await reader.read(65536)
+            if not data:
+                return
+            for event in conn.receive_data(data):
+                if isinstance(event, h2.events.RequestReceived):
+                    path = dict((k.decode() if isinstance(k, bytes) else k,
+                                 v.decode() if isinstance(v, bytes) else v)
+                                for k, v in event.headers)[":path"]
+                    asyncio.ensure_future(respond(event.stream_id, path))
+                elif isinstance(event, (h2.events.WindowUpdated, h2.events.RemoteSettingsChanged)):
+                    flush()
+                elif isinstance(event, h2.events.StreamReset):
+                    pending.pop(event.stream_id, None)
+                elif isinstance(event, h2.events.ConnectionTerminated):
+                    writer.write(conn.data_to_send())
+                    return
+            writer.write(conn.data_to_send())
+            await writer.drain()
+
+
 if __name__ == "__main__":
     do_valgrind = False
     path_search = False
@@ -312,7 +458,18 @@ if __name__ == "__main__":
     # performed in TUT code rather than our own.
     os.environ["LL_TEST_PORT"] = str(httpd.server_port)
     debug("$LL_TEST_PORT = %s", httpd.server_port)
+
+    # HTTP/2 tests skip themselves without LL_TEST_H2_PORT
+    h2_standin = H2StandIn()
+    h2_port = h2_standin.start()
+    if h2_port:
+        os.environ["LL_TEST_H2_PORT"] = str(h2_port)
+        debug("$LL_TEST_H2_PORT = %s", h2_port)
     if do_valgrind:
         args = ["valgrind", "--log-file=./valgrind.log"] + args
         path_search = True
-    sys.exit(run(server_inst=httpd, use_path=path_search, *args))
+    try:
+        rc = run(server_inst=httpd, use_path=path_search, *args)
+    finally:
+        h2_standin.stop()
+    sys.exit(rc)
@@ -38,6 +38,7 @@
 #include <chrono>
 
 #include "lldiskcache.h"
+#include "llpackedassetstore.h"
 
  /**
   * The prefix inserted at the start of a cache file filename to
@@ -75,6 +76,19 @@ LLDiskCache::LLDiskCache(const std::string& cache_dir,
         LLFile::mkdir(dirname);
     }
     // </FS:Ansariel>
+
+    // <FS> Indexed disk cache
+    mIndex = std::make_unique<LLDiskCacheIndex>(cache_dir);
+    if (!mIndex->load())
+    {
+        // Files written from now on are recorded as usual, the scan only
+        // adds the ones it finds that are not in the index yet
+        mIndex->reset();
+        mIndexReady = false;
+        mRebuildThread = std::thread([this]() { rebuildIndex(); });
+    }
+    // </FS>
+
     // <FS:Beq> add static assets into the new cache after clear.
     // Only missing entries are copied on init, skiplist is setup
     // For everything we populate FS specific assets to allow future updates
@@ -82,6 +96,19 @@ LLDiskCache::LLDiskCache(const std::string& cache_dir,
     // </FS:Beq>
 }
 
+LLDiskCache::~LLDiskCache()
+{
+    stopRebuild();
+    if (!mIndexReady)
+    {
+        // An interrupted rebuild is missing files, scan again next start
+        mIndex->reset();
+        return;
+    }
+    // Leave a compact index behind so the next start doesn't replay the journal
+    mIndex->compact();
+}
+
 // WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
 // NOT touch any LLDiskCache data without introducing and locking a mutex!
 
@@ -112,6 +139,14 @@ LLDiskCache::LLDiskCache(const std::string& cache_dir,
 // asset will have to be re-requested.
 void LLDiskCache::purge()
 {
+    // <FS> Indexed disk cache
+    if (!mIndexReady)
+    {
+        LL_INFOS("LLDiskCache") << "Cache index is being rebuilt, skipping purge" << LL_ENDL;
+        return;
+    }
+    // </FS>
+
     if (mEnableCacheDebugInfo)
     {
         LL_INFOS() << "Total dir size before purge is " << dirFileSize(sCacheDir) << LL_ENDL;
@@ -120,48 +155,8 @@ void LLDiskCache::purge()
     boost::system::error_code ec;
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    typedef std::pair<std::time_t, std::pair<uintmax_t, std::string>> file_info_t;
-    std::vector<file_info_t> file_info;
-
-#if LL_WINDOWS
-    std::wstring cache_path(ll_convert<std::wstring>(sCacheDir));
-#else
-    std::string cache_path(sCacheDir);
-#endif
-    uintmax_t file_size_total = 0; // <FS:Beq/> try to make simple cache less naive.
-    
-    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
-    {
-        // <FS:Ansariel> Optimize asset simple disk cache
-        //boost::filesystem::directory_iterator iter(cache_path, ec);
-        //while (iter != boost::filesystem::directory_iterator() && !ec.failed())
-        boost::filesystem::recursive_directory_iterator iter(cache_path, ec);
-        while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
-        // </FS:Ansariel>
-        {
-            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
-            {
-                if ((*iter).path().string().find(CACHE_FILENAME_PREFIX) != std::string::npos)
-                {
-                    uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
-                    if (ec.failed())
-                    {
-                        continue;
-                    }
-                    const std::string file_path = (*iter).path().string();
-                    const std::time_t file_time = boost::filesystem::last_write_time(*iter, ec);
-                    if (ec.failed())
-                    {
-                        continue;
-                    }
-                    file_size_total += file_size; // <FS:Beq/> try to make simple cache less naive.
-
-                    file_info.push_back(file_info_t(file_time, { file_size, file_path }));
-                }
-            }
-            iter.increment(ec);
-        }
-    }
+    // <FS> Indexed disk cache: size and age come from the index rather than a directory scan
+    uintmax_t file_size_total = mIndex->getTotalSize();
 
     // <FS:Beq> add high water/low water thresholds to reduce the churn in the cache.
     LL_DEBUGS("LLDiskCache") << "Cache is " << (int)(((F32)file_size_total)/mMaxSizeBytes*100.0) << "% full" << LL_ENDL;
@@ -169,161 +164,110 @@ void LLDiskCache::purge()
     {
         // Nothing to do here 
         LL_DEBUGS("LLDiskCache") << "Not exceded high water - do nothing" << LL_ENDL;
+        if (mIndex->needsCompaction())
+        {
+            mIndex->compact();
+        }
         return;
     }
     // If we reach here we are above the trigger level so we must purge until we've removed enough to take us down to the low water mark.
     // </FS:Beq>
-    std::sort(file_info.begin(), file_info.end(), [](file_info_t& x, file_info_t& y)
-    {
-        return x.first < y.first; // <FS:Beq/> sort oldest to newest, to we can remove the oldest files first.
-    });
-
 
     // <FS:Beq> add high water/low water thresholds to reduce the churn in the cache.
     auto target_size = (uintmax_t)(mMaxSizeBytes * (mLowPercent/100));
     LL_INFOS() << "Purging cache to a maximum of " << target_size << " bytes" << LL_ENDL;
     // </FS:Beq>
 
-    // <FS:Beq> Extra accounting to track the retention of static assets
-    //std::vector<bool> file_removed;
-    enum class purge_action { delete_file=0, keep_file, skip_file };
-    std::map<std::string,purge_action> file_removed;
-    auto keep{file_info.size()};
-    auto del{0};
-    auto skip{0};
-    // </FS:Beq>
-    // <FS:Beq> revised purge logic to track amount removed not retained to shortern loop
-    // uintmax_t file_size_total = 0;
-    // if (mEnableCacheDebugInfo)
-    // {
-    //     file_removed.reserve(file_info.size());
-    // }
-    // uintmax_t file_size_total = 0;
-    // for (file_info_t& entry : file_info)
-    // {
-    //     file_size_total += entry.second.first;
-
-    //     bool should_remove = file_size_total > mMaxSizeBytes;
-    //     if (mEnableCacheDebugInfo)
-    //     {
-    //         file_removed.push_back(should_remove);
-    //     }
-    uintmax_t deleted_size_total = 0;
-    for (const file_info_t& entry : file_info)
+    // <FS:Beq> Make sure static assets are not eliminated
+    auto is_static = [this](const LLUUID& id)
     {
-        // first check if we still need to delete more files
-        bool should_remove = (file_size_total - deleted_size_total) > target_size;
+        return std::find(mSkipList.begin(), mSkipList.end(), id.asString()) != mSkipList.end();
+    };
+    // </FS:Beq>
 
-        // <FS> Make sure static assets are not eliminated
-        auto action{ should_remove ? purge_action::delete_file : purge_action::keep_file };
-        if (!should_remove)
-        {
-            break;
-        }
+    LLDiskCacheIndex::entry_list_t to_delete;
+    LLDiskCacheIndex::entry_list_t skipped;
+    mIndex->collectEvictionCandidates(target_size, is_static, to_delete, skipped);
 
-        auto this_file_size = entry.second.first;
-        deleted_size_total += this_file_size;
-        auto uuid_as_string = gDirUtilp->getBaseFileName(entry.second.second, true);
-        uuid_as_string      = uuid_as_string.substr(CACHE_FILENAME_PREFIX.size() + 1, 36);  // skip "sl_cache_" and trailing "_N"
-        // LL_INFOS() << "checking UUID=" <<uuid_as_string<< LL_ENDL;
-        if (std::find(mSkipList.begin(), mSkipList.end(), uuid_as_string) != mSkipList.end())
+    // Bump the static assets so that they don't sit at the front of the queue
+    const std::time_t now = std::time(nullptr);
+    for (const auto& entry : skipped)
+    {
+        mIndex->recordAccess(entry.first, now);
+    }
+
+    uintmax_t deleted_size_total = 0;
+    auto del{ 0 };
+    for (const auto& entry : to_delete)
+    {
+        // <FS> Packed asset store, loose files left over from before it was enabled are deleted below
+        if (LLPackedAssetStore::instanceExists() && LLPackedAssetStore::instance().removeAllTypes(entry.first))
         {
-            // this is one of our protected items so no purging
-            should_remove = false;
-            action = purge_action::skip_file;
-            boost::filesystem::last_write_time(entry.second.second, ec);  // force these to the front of the list next time so that purge size works 
-            skip++;
-        }
-        else{
+            mIndex->removeIfUnchanged(entry.first, entry.second);
+            deleted_size_total += entry.second.mSize;
             del++;
+            continue;
         }
-        keep--;
-        if (mEnableCacheDebugInfo)
-        {
-            file_removed.emplace(entry.second.second, action);
-        }
-    // </FS>
-        if (should_remove)
+        // </FS>
+
+        const std::string file_path = metaDataToFilepath(entry.first, LLAssetType::AT_UNKNOWN);
+#if LL_WINDOWS
+        boost::filesystem::remove(ll_convert<std::wstring>(file_path), ec);
+#else
+        boost::filesystem::remove(file_path, ec);
+#endif
+        if (ec.failed())
         {
-            boost::filesystem::remove(entry.second.second, ec);
-            if (ec.failed())
-            {
-                LL_WARNS() << "Failed to delete cache file " << entry.second.second << ": " << ec.message() << LL_ENDL;
-            }
+            LL_WARNS() << "Failed to delete cache file " << file_path << ": " << ec.message() << LL_ENDL;
+            continue;
         }
+
+        // A file that was read or rewritten since it was picked stays indexed,
+        // it'll be dropped from the index by a later purge if it's really gone
+        mIndex->removeIfUnchanged(entry.first, entry.second);
+        deleted_size_total += entry.second.mSize;
+        del++;
+    }
+
+    if (mIndex->needsCompaction())
+    {
+        mIndex->compact();
     }
+    // </FS>
+
 // <FS:Beq> update the debug logging to be more useful
     auto end_time = std::chrono::high_resolution_clock::now();
     auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 // </FS:Beq>
     if (mEnableCacheDebugInfo)
     {
-        // <FS:Beq> update the debug logging to be more useful
-        // auto end_time = std::chrono::high_resolution_clock::now();
-        // auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-        // </FS:Beq>
-
         // Log afterward so it doesn't affect the time measurement
         // Logging thousands of file results can take hundreds of milliseconds
+        for (const auto& entry : skipped)
+        {
+            LL_INFOS() << "STATIC  " << entry.second.mLastAccess << "  " << entry.second.mSize << "  " << entry.first << LL_ENDL;
+        }
         uintmax_t deleted_so_far{ 0 }; // <FS:Beq/> update the debug logging to be more useful
-        for (size_t i = 0; i < file_info.size(); ++i)
+        for (const auto& entry : to_delete)
         {
-            const file_info_t& entry = file_info[i];
-            // <FS> Static asset stuff
-            deleted_so_far += entry.second.first; // <FS:Beq/> update the debug logging to be more useful
-            //const bool removed = file_removed[i];
-            //const std::string action = removed ? "DELETE:" : "KEEP:";
-            std::string action{};
-
-            // Check if the file exists in the map
-            auto& filename{ entry.second.second };
-            if (file_removed.find(filename) != file_removed.end()) {
-            // File found in the map, retrieve the corresponding enum value
-            switch (file_removed[filename])
-            {
-                case purge_action::delete_file:
-                    action = "DELETE";
-                    del++;
-                break;
-                case purge_action::skip_file:
-                    action = "STATIC";
-                    skip++;
-                break;
-                default:
-                // Handle any unexpected enum value
-                    action = "UNKNOWN";
-                break;
-            }
-            }
-            else 
-            {
-                action = "KEEP";
-            }            
-            // </FS>
+            deleted_so_far += entry.second.mSize;
 
             // have to do this because of LL_INFO/LL_END weirdness
             std::ostringstream line;
 
-            line << action << "  ";
-            line << entry.first << "  ";
-            line << entry.second.first << "  ";
-            line << entry.second.second;
+            line << "DELETE  ";
+            line << entry.second.mLastAccess << "  ";
+            line << entry.second.mSize << "  ";
+            line << entry.first;
             line << " (" << file_size_total - deleted_so_far << "/" << mMaxSizeBytes << ")"; // <FS:Beq/> update the debug logging to be more useful
             LL_INFOS() << line.str() << LL_ENDL;
         }
-// <FS:Beq> make the summary stats more easily enabled.
     }
-    // <FS:Beq> update the debug logging to be more useful
-        // LL_INFOS() << "Total dir size after purge is " << dirFileSize(sCacheDir) << LL_ENDL;
-        // LL_INFOS() << "Cache purge took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
 
-    auto newCacheSize = updateCacheSize(file_size_total - deleted_size_total); 
-    LL_INFOS("LLDiskCache") << "Total dir size after purge is " << newCacheSize << LL_ENDL; 
-    LL_INFOS("LLDiskCache") << "Cache purge took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
-// </FS:Beq>
-    LL_INFOS("LLDiskCache") << "Deleted: " << del << " Skipped: " << skip << " Kept: " << keep << LL_ENDL;    // <FS:Beq/> Extra accounting to track the retention of static assets
+    LL_INFOS("LLDiskCache") << "Total dir size after purge is " << mIndex->getTotalSize() << LL_ENDL;
+    LL_INFOS("LLDiskCache") << "Cache purge took " << execute_time << " ms to execute for " << to_delete.size() << " of " << mIndex->getEntryCount() + del << " files" << LL_ENDL;
+    LL_INFOS("LLDiskCache") << "Deleted: " << del << " Skipped: " << skipped.size() << " Kept: " << mIndex->getEntryCount() << LL_ENDL;    // <FS:Beq/> Extra accounting to track the retention of static assets
     LL_INFOS("LLDiskCache") << "Total of " << deleted_size_total << " bytes removed." << LL_ENDL;    // <FS:Beq/> Extra accounting to track the retention of static assets
-    // } <FS:Beq/> this bracket was moved up a few lines.
 }
 
 const std::string LLDiskCache::metaDataToFilepath(const LLUUID& id, LLAssetType::EType at)
@@ -341,17 +285,7 @@ const std::string LLDiskCache::getCacheInfo()
     std::ostringstream cache_info;
 
     F32 max_in_mb = (F32)mMaxSizeBytes / (1024.0f * 1024.0f);
-    // <FS:Beq> stall prevention. We still need to make sure this initialised when called at startup.
-    F32 percent_used;
-    if (mStoredCacheSize > 0)
-    {
-        percent_used = ((F32)mStoredCacheSize / (F32)mMaxSizeBytes) * 100.0f;
-    }
-    else
-    {
-        percent_used = ((F32)dirFileSize(sCacheDir) / (F32)mMaxSizeBytes) * 100.0f; 
-    }
-    // </FS:Beq>
+    F32 percent_used = ((F32)mIndex->getTotalSize() / (F32)mMaxSizeBytes) * 100.0f; // <FS> Indexed disk cache
     cache_info << std::fixed;
     cache_info << std::setprecision(1);
     cache_info << "Max size " << max_in_mb << " MB ";
@@ -384,6 +318,22 @@ void LLDiskCache::prepopulateCacheWithStatic()
                 auto uuid_as_string{ gDirUtilp->getBaseFileName(from_asset_file, true) };
                 LLUUID uuid{ uuid_as_string };
                 auto to_asset_file = metaDataToFilepath(uuid, LLAssetType::AT_UNKNOWN);
+                // <FS> Packed asset store
+                if (LLPackedAssetStore::instanceExists())
+                {
+                    LLPackedAssetStore& store = LLPackedAssetStore::instance();
+                    if (!store.exists(uuid, LLAssetType::AT_UNKNOWN))
+                    {
+                        std::string contents = LLFile::getContents(from_asset_file);
+                        S32 size = store.write(uuid, LLAssetType::AT_UNKNOWN, 0, (const U8*)contents.data(), (S32)contents.size(), true);
+                        if (size > 0)
+                        {
+                            onFileWritten(uuid, size);
+                        }
+                    }
+                }
+                else
+                // </FS>
                 if (!gDirUtilp->fileExists(to_asset_file))
                 {
                     if (mEnableCacheDebugInfo)
@@ -394,6 +344,12 @@ void LLDiskCache::prepopulateCacheWithStatic()
                     {
                         LL_WARNS("LLDiskCache") << "Failed to copy " << from_asset_file << " to " << to_asset_file << LL_ENDL;
                     }
+                    // <FS> Indexed disk cache
+                    else if (llstat file_stat; LLFile::stat(to_asset_file, &file_stat) == 0)
+                    {
+                        onFileWritten(uuid, file_stat.st_size);
+                    }
+                    // </FS>
                 }
                 if (std::find(mSkipList.begin(), mSkipList.end(), uuid_as_string) == mSkipList.end())
                 {
@@ -412,6 +368,7 @@ void LLDiskCache::prepopulateCacheWithStatic()
 void LLDiskCache::clearCache()
 {
     LL_INFOS() << "clearing cache " << sCacheDir << LL_ENDL;
+    stopRebuild(); // <FS> Indexed disk cache
     /**
      * See notes on performance in dirFileSize(..) - there may be
      * a quicker way to do this by operating on the parent dir vs
@@ -446,6 +403,17 @@ void LLDiskCache::clearCache()
             }
             iter.increment(ec);
         }
+        // <FS> Indexed disk cache
+        mIndex->reset();
+        mIndex->compact();
+        mIndexReady = true;
+        // </FS>
+        // <FS> Packed asset store
+        if (LLPackedAssetStore::instanceExists())
+        {
+            LLPackedAssetStore::instance().clear();
+        }
+        // </FS>
         // <FS:Beq> add static assets into the new cache after clear
     LL_INFOS() << "prepopulating new cache " << LL_ENDL;
         prepopulateCacheWithStatic();
@@ -487,32 +455,105 @@ void LLDiskCache::removeOldVFSFiles()
     }
 }
 
-// <FS:Beq> Lets not scan every single time if we can avoid it eh?
-// uintmax_t LLDiskCache::dirFileSize(const std::string& dir)
-// {
-uintmax_t LLDiskCache::updateCacheSize(const uintmax_t newsize)
+void LLDiskCache::onFileWritten(const LLUUID& id, uintmax_t size)
 {
-    mStoredCacheSize = newsize;
-    mLastScanTime = system_clock::now();
-    return mStoredCacheSize;
+    mIndex->recordWrite(id, size, std::time(nullptr));
 }
 
-uintmax_t LLDiskCache::dirFileSize(const std::string& dir, bool force)
+void LLDiskCache::onFileAccessed(const LLUUID& id)
 {
-    using namespace std::chrono;
-    const seconds cache_duration{ 120 };// A rather arbitrary number. it takes 5 seconds+ on a fast drive to scan 80K+ items. purge runs every minute and will update. so 120 should mean we never need a superfluous cache scan.
+    mIndex->recordAccess(id, std::time(nullptr));
+}
 
-    const auto current_time = system_clock::now();
+void LLDiskCache::onFileRemoved(const LLUUID& id)
+{
+    mIndex->recordRemove(id);
+}
 
-    const auto time_difference = duration_cast<seconds>(current_time - mLastScanTime);
+void LLDiskCache::onFileRenamed(const LLUUID& old_id, const LLUUID& new_id)
+{
+    mIndex->recordRename(old_id, new_id);
+}
 
-    // Check if the cached result can be used
-    if( !force && time_difference < cache_duration )
+void LLDiskCache::rebuildIndex()
+{
+    LL_INFOS("LLDiskCache") << "Rebuilding cache index for " << sCacheDir << LL_ENDL;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    std::wstring cache_path(ll_convert<std::wstring>(sCacheDir));
+#else
+    std::string cache_path(sCacheDir);
+#endif
+    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
     {
-        LL_DEBUGS("LLDiskCache") << "Using cached result: " << mStoredCacheSize << LL_ENDL;
-        return mStoredCacheSize;
+        boost::filesystem::recursive_directory_iterator iter(cache_path, ec);
+        while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
+        {
+            if (mStopRebuild)
+            {
+                LL_INFOS("LLDiskCache") << "Cache index rebuild cancelled" << LL_ENDL;
+                return;
+            }
+
+            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
+            {
+                // sl_cache_<uuid>_0.asset
+                const std::string file_name = (*iter).path().filename().string();
+                if (file_name.size() > CACHE_FILENAME_PREFIX.size() + UUID_STR_LENGTH
+                    && file_name.compare(0, CACHE_FILENAME_PREFIX.size(), CACHE_FILENAME_PREFIX) == 0)
+                {
+                    const std::string uuid_as_string = file_name.substr(CACHE_FILENAME_PREFIX.size() + 1, UUID_STR_LENGTH - 1);
+                    uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
+                    std::time_t file_time = ec.failed() ? 0 : boost::filesystem::last_write_time(*iter, ec);
+                    if (!ec.failed() && LLUUID::validate(uuid_as_string))
+                    {
+                        mIndex->recordScanned(LLUUID(uuid_as_string), file_size, file_time);
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
     }
-// </FS:Beq>
+
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        // Copied out first so that the store is not locked while the index is
+        std::vector<std::pair<LLUUID, S32> > packed;
+        LLPackedAssetStore::instance().forEachAsset([&packed](const LLUUID& id, LLAssetType::EType, S32 size)
+        {
+            packed.emplace_back(id, size);
+        });
+        const std::time_t now = std::time(nullptr);
+        for (const std::pair<LLUUID, S32>& asset : packed)
+        {
+            mIndex->recordScanned(asset.first, asset.second, now);
+        }
+    }
+    // </FS>
+
+    mIndex->compact();
+    mIndexReady = true;
+
+    auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
+    LL_INFOS("LLDiskCache") << "Cache index rebuilt with " << mIndex->getEntryCount() << " files ("
+                            << mIndex->getTotalSize() << " bytes) in " << execute_time << " ms" << LL_ENDL;
+}
+
+void LLDiskCache::stopRebuild()
+{
+    if (mRebuildThread.joinable())
+    {
+        mStopRebuild = true;
+        mRebuildThread.join();
+        mStopRebuild = false;
+    }
+}
+
+uintmax_t LLDiskCache::dirFileSize(const std::string& dir)
+{
     uintmax_t total_file_size = 0;
 
     /**
@@ -554,10 +595,7 @@ uintmax_t LLDiskCache::dirFileSize(const std::string& dir, bool force)
         }
     }
 
-// <FS:Beq> Lets not scan every single time if we can avoid it eh?
-    // return total_file_size;
-    return updateCacheSize(total_file_size);
-// </FS:Beq>
+    return total_file_size;
 }
 
 LLPurgeDiskCacheThread::LLPurgeDiskCacheThread() :
@@ -572,5 +610,11 @@ void LLPurgeDiskCacheThread::run()
     while (LLApp::instance()->sleep(CHECK_INTERVAL))
     {
         LLDiskCache::instance().purge();
+        // <FS> Packed asset store
+        if (LLPackedAssetStore::instanceExists())
+        {
+            LLPackedAssetStore::instance().compact();
+        }
+        // </FS>
     }
 }
@@ -24,10 +24,12 @@
                     identify this as a Viewer asset file
  * 2/ The time of last access for a file can be updated instantly
  *    for file reads and automatically as part of the file writes.
- * 3/ The purge algorithm collects a list of all files in the
- *    directory, sorts them by date of last access (write) and then
- *    deletes any files based on age until the total size of all
- *    the files is less than the maximum size specified.
+ * 3/ The size and time of last access of every file is tracked by
+ *    LLDiskCacheIndex, which persists itself next to the cache files.
+ *    The purge algorithm asks the index for the least recently used
+ *    files and deletes them until the total size of all the files is
+ *    less than the maximum size specified. The cache directory is only
+ *    scanned when the index is missing or damaged.
  * 4/ An LLSingleton idiom is used since there will only ever be
  *    a single cache and we want to access it from numerous places.
  * 5/ Performance on my modest system seems very acceptable. For
@@ -63,7 +65,10 @@
 #define _LLDISKCACHE
 
 #include "llsingleton.h"
+#include "lldiskcacheindex.h"
+#include <atomic>
 #include <chrono>
+#include <thread>
 using namespace std::chrono;
 
 
@@ -108,7 +113,7 @@ class LLDiskCache :
                     // </FS:Beq>
                     );
 
-        virtual ~LLDiskCache() = default;
+        virtual ~LLDiskCache();
 
     public:
         /**
@@ -130,6 +135,8 @@ class LLDiskCache :
          * Purging the disk cache involves nontrivial work on the viewer's
          * filesystem. If called on the main thread, this causes a noticeable
          * freeze.
+         *
+         * Nothing is purged while the index is being rebuilt.
          */
         void purge();
 
@@ -152,6 +159,15 @@ class LLDiskCache :
 
         void removeOldVFSFiles();
 
+        /**
+         * Keep the cache index up to date. These are called by LLFileSystem
+         * whenever it writes, reads, removes or renames a cache file.
+         */
+        void onFileWritten(const LLUUID& id, uintmax_t size);
+        void onFileAccessed(const LLUUID& id);
+        void onFileRemoved(const LLUUID& id);
+        void onFileRenamed(const LLUUID& old_id, const LLUUID& new_id);
+
         // <FS:Ansariel> Better asset cache size control
         void setMaxSizeBytes(uintmax_t size) { mMaxSizeBytes = size; }
         // <FS:Beq> High/Low water control
@@ -162,18 +178,32 @@ class LLDiskCache :
     private:
         /**
          * Utility function to gather the total size the files in a given
-         * directory. Primarily used here to determine the directory size
-         * before and after the cache purge
+         * directory. Only used for debugging now that the index keeps
+         * track of the cache size.
          */
-        uintmax_t updateCacheSize(const uintmax_t newsize); // <FS:Beq/> enable time based caching of dirfilesize except when force is true.
-        uintmax_t dirFileSize(const std::string& dir, bool force = false); // <FS:Beq/> enable time based caching of dirfilesize except when force is true.
+        uintmax_t dirFileSize(const std::string& dir);
 
         /**
-         * cache the directory size cos it takes forever to calculate it
-         * 
+         * Walk the cache directory and rebuild the index from scratch.
+         * This is the slow path and is only taken when the index could
+         * not be loaded intact. It runs on mRebuildThread, the cache
+         * counts as empty until it is done.
          */
-        uintmax_t mStoredCacheSize{ 0 };
-        time_point<system_clock> mLastScanTime{ };
+        void rebuildIndex();
+
+        /**
+         * Cancel a rebuild still running and wait for its thread.
+         */
+        void stopRebuild();
+
+        /**
+         * Size and last access time of every file in the cache.
+         */
+        std::unique_ptr<LLDiskCacheIndex> mIndex;
+
+        std::thread mRebuildThread;
+        std::atomic<bool> mIndexReady{ true };
+        std::atomic<bool> mStopRebuild{ false };
 
     private:
         /**
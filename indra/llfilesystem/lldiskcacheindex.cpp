@@ -0,0 +1,575 @@
+/**
+ * @file lldiskcacheindex.cpp
+ * @brief Persistent size/last-access index for the asset disk cache.
+ *
+ * See lldiskcacheindex.h for a description of how the index and its
+ * files work.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lldiskcacheindex.h"
+
+namespace
+{
+    // The index files deliberately do not use the "sl_cache" prefix so
+    // that the directory scans and clearCache() leave them alone.
+    const std::string SNAPSHOT_FILENAME("cache_index.snapshot");
+    const std::string JOURNAL_FILENAME("cache_index.journal");
+
+    constexpr U32 SNAPSHOT_MAGIC = 0x49434c53; // "SLCI"
+    constexpr U32 JOURNAL_MAGIC = 0x4a434c53;  // "SLCJ"
+    constexpr U32 INDEX_VERSION = 1;
+
+    // id, size, last access
+    constexpr size_t SNAPSHOT_RECORD_SIZE = UUID_BYTES + sizeof(U64) + sizeof(S64);
+    // op, id, size, time, checksum
+    constexpr size_t JOURNAL_RECORD_SIZE = 1 + UUID_BYTES + sizeof(U64) + sizeof(S64) + sizeof(U32);
+    constexpr size_t HEADER_SIZE = sizeof(U32) + sizeof(U32);
+
+    // Don't bother compacting journals smaller than this
+    constexpr size_t MIN_COMPACT_RECORDS = 8192;
+
+    // FNV-1a, only used to detect torn or garbage records
+    U32 checksum(const U8* data, size_t len, U32 hash = 2166136261u)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            hash ^= data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    template<typename T>
+    U8* put(U8* dst, const T& value)
+    {
+        memcpy(dst, &value, sizeof(T));
+        return dst + sizeof(T);
+    }
+
+    template<typename T>
+    const U8* get(const U8* src, T& value)
+    {
+        memcpy(&value, src, sizeof(T));
+        return src + sizeof(T);
+    }
+
+    bool readFile(const std::string& filename, std::vector<U8>& buffer)
+    {
+        LLFILE* file = LLFile::fopen(filename, "rb");
+        if (!file)
+        {
+            return false;
+        }
+
+        buffer.clear();
+        U8 chunk[64 * 1024];
+        size_t bytes_read;
+        while ((bytes_read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            buffer.insert(buffer.end(), chunk, chunk + bytes_read);
+        }
+        LLFile::close(file);
+        return true;
+    }
+}
+
+// Same threshold as LLFileSystem::updateFileAccessTime()
+const std::time_t LLDiskCacheIndex::ACCESS_TIME_THRESHOLD = 1 * 60 * 60;
+
+LLDiskCacheIndex::LLDiskCacheIndex(const std::string& index_dir)
+{
+    std::string dir(index_dir);
+    if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+    {
+#if LL_WINDOWS
+        dir += '\\';
+#else
+        dir += '/';
+#endif
+    }
+    mSnapshotPath = dir + SNAPSHOT_FILENAME;
+    mJournalPath = dir + JOURNAL_FILENAME;
+}
+
+LLDiskCacheIndex::~LLDiskCacheIndex()
+{
+    closeJournal();
+}
+
+bool LLDiskCacheIndex::load()
+{
+    LLMutexLock lock(&mMutex);
+
+    closeJournal();
+    mEntries.clear();
+    mLRU.clear();
+    mTotalSize = 0;
+
+    bool damaged = false;
+    bool have_snapshot = readSnapshot(damaged);
+    bool have_journal = replayJournal(damaged);
+
+    LL_INFOS("LLDiskCache") << "Loaded cache index with " << mEntries.size() << " entries ("
+                            << mTotalSize << " bytes), replayed " << mJournalRecords
+                            << " journal records" << LL_ENDL;
+
+    // Fold the replayed journal into a fresh snapshot so that it does not
+    // keep growing from one session to the next
+    bool truncate_journal = true;
+    if (mJournalRecords > 0 || damaged)
+    {
+        truncate_journal = writeSnapshot();
+    }
+    openJournal(truncate_journal);
+
+    return (have_snapshot || have_journal) && !damaged;
+}
+
+void LLDiskCacheIndex::reset()
+{
+    LLMutexLock lock(&mMutex);
+
+    closeJournal();
+    mEntries.clear();
+    mLRU.clear();
+    mTotalSize = 0;
+    mJournalRecords = 0;
+
+    LLFile::remove(mSnapshotPath, ENOENT);
+    LLFile::remove(mJournalPath, ENOENT);
+}
+
+bool LLDiskCacheIndex::compact()
+{
+    LLMutexLock lock(&mMutex);
+
+    if (!writeSnapshot())
+    {
+        return false;
+    }
+    return openJournal(true);
+}
+
+bool LLDiskCacheIndex::needsCompaction() const
+{
+    LLMutexLock lock(&mMutex);
+    return mJournalRecords > llmax(MIN_COMPACT_RECORDS, mEntries.size() / 2);
+}
+
+void LLDiskCacheIndex::recordWrite(const LLUUID& id, uintmax_t size, std::time_t now)
+{
+    LLMutexLock lock(&mMutex);
+    applyWrite(id, size, now);
+    appendJournal(OP_WRITE, id, size, now);
+}
+
+void LLDiskCacheIndex::recordScanned(const LLUUID& id, uintmax_t size, std::time_t when)
+{
+    LLMutexLock lock(&mMutex);
+    if (mEntries.find(id) == mEntries.end())
+    {
+        applyWrite(id, size, when);
+        appendJournal(OP_WRITE, id, size, when);
+    }
+}
+
+void LLDiskCacheIndex::recordAccess(const LLUUID& id, std::time_t now)
+{
+    LLMutexLock lock(&mMutex);
+
+    entry_map_t::const_iterator it = mEntries.find(id);
+    if (it == mEntries.end() || now - it->second.mLastAccess <= ACCESS_TIME_THRESHOLD)
+    {
+        return;
+    }
+    applyAccess(id, now);
+    appendJournal(OP_ACCESS, id, 0, now);
+}
+
+void LLDiskCacheIndex::recordRemove(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+
+    if (mEntries.find(id) != mEntries.end())
+    {
+        applyRemove(id);
+        appendJournal(OP_REMOVE, id, 0, 0);
+    }
+}
+
+void LLDiskCacheIndex::recordRename(const LLUUID& old_id, const LLUUID& new_id)
+{
+    if (old_id == new_id)
+    {
+        return;
+    }
+
+    LLMutexLock lock(&mMutex);
+
+    entry_map_t::const_iterator it = mEntries.find(old_id);
+    if (it == mEntries.end())
+    {
+        return;
+    }
+    Entry entry = it->second;
+
+    applyRemove(old_id);
+    appendJournal(OP_REMOVE, old_id, 0, 0);
+    applyWrite(new_id, entry.mSize, entry.mLastAccess);
+    appendJournal(OP_WRITE, new_id, entry.mSize, entry.mLastAccess);
+}
+
+void LLDiskCacheIndex::collectEvictionCandidates(uintmax_t target_size,
+                                                 const skip_func_t& skip,
+                                                 entry_list_t& candidates,
+                                                 entry_list_t& skipped) const
+{
+    LLMutexLock lock(&mMutex);
+
+    uintmax_t remaining = mTotalSize;
+    for (lru_set_t::const_iterator it = mLRU.begin(); it != mLRU.end() && remaining > target_size; ++it)
+    {
+        const LLUUID& id = it->second;
+        const Entry& entry = mEntries.at(id);
+        if (skip && skip(id))
+        {
+            skipped.emplace_back(id, entry);
+        }
+        else
+        {
+            candidates.emplace_back(id, entry);
+            remaining -= entry.mSize;
+        }
+    }
+}
+
+bool LLDiskCacheIndex::removeIfUnchanged(const LLUUID& id, const Entry& entry)
+{
+    LLMutexLock lock(&mMutex);
+
+    entry_map_t::const_iterator it = mEntries.find(id);
+    if (it == mEntries.end()
+        || it->second.mLastAccess != entry.mLastAccess
+        || it->second.mSize != entry.mSize)
+    {
+        return false;
+    }
+    applyRemove(id);
+    appendJournal(OP_REMOVE, id, 0, 0);
+    return true;
+}
+
+bool LLDiskCacheIndex::getEntry(const LLUUID& id, Entry& entry) const
+{
+    LLMutexLock lock(&mMutex);
+
+    entry_map_t::const_iterator it = mEntries.find(id);
+    if (it == mEntries.end())
+    {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+uintmax_t LLDiskCacheIndex::getTotalSize() const
+{
+    LLMutexLock lock(&mMutex);
+    return mTotalSize;
+}
+
+size_t LLDiskCacheIndex::getEntryCount() const
+{
+    LLMutexLock lock(&mMutex);
+    return mEntries.size();
+}
+
+size_t LLDiskCacheIndex::getJournalRecordCount() const
+{
+    LLMutexLock lock(&mMutex);
+    return mJournalRecords;
+}
+
+void LLDiskCacheIndex::applyWrite(const LLUUID& id, uintmax_t size, std::time_t when)
+{
+    std::pair<entry_map_t::iterator, bool> result = mEntries.try_emplace(id);
+    Entry& entry = result.first->second;
+    if (!result.second)
+    {
+        mLRU.erase(std::make_pair(entry.mLastAccess, id));
+        mTotalSize -= entry.mSize;
+    }
+    entry.mSize = size;
+    entry.mLastAccess = when;
+    mLRU.emplace(when, id);
+    mTotalSize += size;
+}
+
+void LLDiskCacheIndex::applyAccess(const LLUUID& id, std::time_t when)
+{
+    entry_map_t::iterator it = mEntries.find(id);
+    if (it == mEntries.end() || it->second.mLastAccess >= when)
+    {
+        return;
+    }
+    mLRU.erase(std::make_pair(it->second.mLastAccess, id));
+    it->second.mLastAccess = when;
+    mLRU.emplace(when, id);
+}
+
+void LLDiskCacheIndex::applyRemove(const LLUUID& id)
+{
+    entry_map_t::iterator it = mEntries.find(id);
+    if (it == mEntries.end())
+    {
+        return;
+    }
+    mLRU.erase(std::make_pair(it->second.mLastAccess, id));
+    mTotalSize -= it->second.mSize;
+    mEntries.erase(it);
+}
+
+void LLDiskCacheIndex::appendJournal(EJournalOp op, const LLUUID& id, uintmax_t size, std::time_t when)
+{
+    // Journaling is suspended between reset() and the next compact()
+    if (!mJournal)
+    {
+        return;
+    }
+
+    U8 record[JOURNAL_RECORD_SIZE];
+    U8* p = record;
+    p = put(p, (U8)op);
+    memcpy(p, id.mData, UUID_BYTES);
+    p += UUID_BYTES;
+    p = put(p, (U64)size);
+    p = put(p, (S64)when);
+    put(p, checksum(record, p - record));
+
+    // Flushing hands the record to the OS, which is enough to survive a
+    // viewer crash. A torn record from a system crash is dropped on replay.
+    if (fwrite(record, 1, JOURNAL_RECORD_SIZE, mJournal) != JOURNAL_RECORD_SIZE
+        || fflush(mJournal) != 0)
+    {
+        LL_WARNS("LLDiskCache") << "Failed to append to cache index journal " << mJournalPath
+                                << ", index will be rebuilt on next start" << LL_ENDL;
+        closeJournal();
+        LLFile::remove(mSnapshotPath, ENOENT);
+        return;
+    }
+    ++mJournalRecords;
+}
+
+bool LLDiskCacheIndex::openJournal(bool truncate)
+{
+    closeJournal();
+
+    mJournal = LLFile::fopen(mJournalPath, truncate ? "wb" : "ab");
+    if (!mJournal)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to open cache index journal " << mJournalPath << LL_ENDL;
+        return false;
+    }
+
+    if (truncate)
+    {
+        mJournalRecords = 0;
+
+        U8 header[HEADER_SIZE];
+        put(put(header, JOURNAL_MAGIC), INDEX_VERSION);
+        if (fwrite(header, 1, HEADER_SIZE, mJournal) != HEADER_SIZE || fflush(mJournal) != 0)
+        {
+            LL_WARNS("LLDiskCache") << "Unable to write cache index journal " << mJournalPath << LL_ENDL;
+            closeJournal();
+            return false;
+        }
+    }
+    return true;
+}
+
+void LLDiskCacheIndex::closeJournal()
+{
+    if (mJournal)
+    {
+        LLFile::close(mJournal);
+        mJournal = nullptr;
+    }
+}
+
+bool LLDiskCacheIndex::readSnapshot(bool& damaged)
+{
+    std::vector<U8> buffer;
+    if (!readFile(mSnapshotPath, buffer))
+    {
+        return false;
+    }
+
+    constexpr size_t prefix_size = HEADER_SIZE + sizeof(U64);
+    U32 magic = 0, version = 0;
+    U64 count = 0;
+    if (buffer.size() >= prefix_size)
+    {
+        get(get(get(buffer.data(), magic), version), count);
+    }
+
+    if (magic != SNAPSHOT_MAGIC
+        || version != INDEX_VERSION
+        || buffer.size() != prefix_size + count * SNAPSHOT_RECORD_SIZE + sizeof(U32))
+    {
+        LL_WARNS("LLDiskCache") << "Discarding malformed cache index snapshot " << mSnapshotPath << LL_ENDL;
+        damaged = true;
+        return false;
+    }
+
+    const U8* records = buffer.data() + prefix_size;
+    const size_t records_size = count * SNAPSHOT_RECORD_SIZE;
+    U32 stored_checksum;
+    get(records + records_size, stored_checksum);
+    if (stored_checksum != checksum(records, records_size))
+    {
+        LL_WARNS("LLDiskCache") << "Discarding corrupted cache index snapshot " << mSnapshotPath << LL_ENDL;
+        damaged = true;
+        return false;
+    }
+
+    mEntries.reserve(count);
+    const U8* p = records;
+    for (U64 i = 0; i < count; ++i)
+    {
+        LLUUID id;
+        U64 size;
+        S64 when;
+        memcpy(id.mData, p, UUID_BYTES);
+        p = get(get(p + UUID_BYTES, size), when);
+        applyWrite(id, size, (std::time_t)when);
+    }
+    return true;
+}
+
+bool LLDiskCacheIndex::replayJournal(bool& damaged)
+{
+    mJournalRecords = 0;
+
+    std::vector<U8> buffer;
+    if (!readFile(mJournalPath, buffer))
+    {
+        return false;
+    }
+
+    U32 magic = 0, version = 0;
+    if (buffer.size() >= HEADER_SIZE)
+    {
+        get(get(buffer.data(), magic), version);
+    }
+    if (magic != JOURNAL_MAGIC || version != INDEX_VERSION)
+    {
+        LL_WARNS("LLDiskCache") << "Discarding malformed cache index journal " << mJournalPath << LL_ENDL;
+        damaged = true;
+        return false;
+    }
+
+    size_t offset = HEADER_SIZE;
+    while (offset + JOURNAL_RECORD_SIZE <= buffer.size())
+    {
+        const U8* record = buffer.data() + offset;
+        U8 op;
+        LLUUID id;
+        U64 size;
+        S64 when;
+        U32 stored_checksum;
+        const U8* p = get(record, op);
+        memcpy(id.mData, p, UUID_BYTES);
+        p = get(get(p + UUID_BYTES, size), when);
+        get(p, stored_checksum);
+        if (stored_checksum != checksum(record, p - record))
+        {
+            break;
+        }
+
+        switch (op)
+        {
+            case OP_WRITE:
+                applyWrite(id, size, (std::time_t)when);
+                break;
+            case OP_ACCESS:
+                applyAccess(id, (std::time_t)when);
+                break;
+            case OP_REMOVE:
+                applyRemove(id);
+                break;
+            default:
+                break;
+        }
+        ++mJournalRecords;
+        offset += JOURNAL_RECORD_SIZE;
+    }
+
+    if (offset != buffer.size())
+    {
+        // Anything after the last good record was being written when the
+        // viewer went away. Files it described are unknown to the index.
+        LL_WARNS("LLDiskCache") << "Cache index journal " << mJournalPath << " has "
+                                << buffer.size() - offset << " trailing bytes after "
+                                << mJournalRecords << " records" << LL_ENDL;
+        damaged = true;
+    }
+    return true;
+}
+
+bool LLDiskCacheIndex::writeSnapshot()
+{
+    const U64 count = mEntries.size();
+    constexpr size_t prefix_size = HEADER_SIZE + sizeof(U64);
+    std::vector<U8> buffer(prefix_size + count * SNAPSHOT_RECORD_SIZE + sizeof(U32));
+
+    U8* p = put(put(put(buffer.data(), SNAPSHOT_MAGIC), INDEX_VERSION), count);
+    U8* records = p;
+    // Oldest first, which keeps the LRU set insertions cheap on load
+    for (const lru_set_t::value_type& lru : mLRU)
+    {
+        const Entry& entry = mEntries.at(lru.second);
+        memcpy(p, lru.second.mData, UUID_BYTES);
+        p = put(put(p + UUID_BYTES, (U64)entry.mSize), (S64)entry.mLastAccess);
+    }
+    put(p, checksum(records, p - records));
+
+    const std::string temp_path = mSnapshotPath + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_path, "wb");
+    if (!file)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to create cache index snapshot " << temp_path << LL_ENDL;
+        return false;
+    }
+    bool success = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    success = (LLFile::close(file) == 0) && success;
+    if (!success || LLFile::rename(temp_path, mSnapshotPath) != 0)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to write cache index snapshot " << mSnapshotPath << LL_ENDL;
+        LLFile::remove(temp_path, ENOENT);
+        return false;
+    }
+    return true;
+}
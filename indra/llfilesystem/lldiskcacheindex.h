@@ -0,0 +1,185 @@
+/**
+ * @file lldiskcacheindex.h
+ * @brief Persistent size/last-access index for the asset disk cache.
+ *
+ * @Description:
+ * The index keeps the size and last access time of every file in the
+ * asset disk cache so that size accounting and least-recently-used
+ * eviction do not need to walk the cache directory.
+ *
+ * 1/ Entries are keyed by asset ID. The cache file name only depends on
+ *    the asset ID (see LLDiskCache::metaDataToFilepath()) so this is
+ *    sufficient to identify a file.
+ * 2/ Every change is appended to a journal file as a small fixed size,
+ *    checksummed record. Appending is cheap and a record that was only
+ *    partially written when the viewer crashed is detected and dropped
+ *    when the journal is replayed.
+ * 3/ The journal is periodically compacted into a snapshot file which
+ *    holds the whole index. The snapshot is written to a temporary file
+ *    and renamed over the previous one so there is always a complete
+ *    snapshot on disk. Replaying journal records on top of a snapshot
+ *    that already contains them is harmless.
+ * 4/ The files are native endian: the cache is never shared between
+ *    machines.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLDISKCACHEINDEX_H
+#define LL_LLDISKCACHEINDEX_H
+
+#include "llfile.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+#include <ctime>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class LLDiskCacheIndex
+{
+    public:
+        struct Entry
+        {
+            uintmax_t   mSize{ 0 };
+            std::time_t mLastAccess{ 0 };
+        };
+
+        typedef std::vector<std::pair<LLUUID, Entry>> entry_list_t;
+        typedef std::function<bool(const LLUUID&)> skip_func_t;
+
+        /**
+         * The index files are kept in index_dir, next to the cache files
+         * they describe. Nothing is read until load() is called.
+         */
+        LLDiskCacheIndex(const std::string& index_dir);
+        ~LLDiskCacheIndex();
+
+        /**
+         * Read the snapshot and replay the journal on top of it. Returns
+         * false when the on-disk index is missing or damaged, in which
+         * case the caller must rebuild it (see reset() and recordWrite()).
+         * Whatever could be recovered is kept either way.
+         */
+        bool load();
+
+        /**
+         * Forget every entry and truncate the files on disk. Used before
+         * rebuilding the index from a directory scan and when the cache
+         * is cleared.
+         */
+        void reset();
+
+        /**
+         * Write a fresh snapshot and empty the journal.
+         */
+        bool compact();
+
+        /**
+         * True when the journal has grown large enough relative to the
+         * number of entries that compacting it is worthwhile.
+         */
+        bool needsCompaction() const;
+
+        /**
+         * Record that a file was created or written, with its new size.
+         */
+        void recordWrite(const LLUUID& id, uintmax_t size, std::time_t now);
+
+        /**
+         * Record a file found by a directory scan. Unlike recordWrite() an
+         * entry recorded while the scan was running is left as it is.
+         */
+        void recordScanned(const LLUUID& id, uintmax_t size, std::time_t when);
+
+        /**
+         * Record that a file was read. Like LLFileSystem::updateFileAccessTime()
+         * the access is only journaled when the previous one is older than
+         * ACCESS_TIME_THRESHOLD so that reading hot assets does not turn into
+         * a stream of disk writes.
+         */
+        void recordAccess(const LLUUID& id, std::time_t now);
+
+        void recordRemove(const LLUUID& id);
+        void recordRename(const LLUUID& old_id, const LLUUID& new_id);
+
+        /**
+         * Collect the least recently used entries, oldest first, whose
+         * removal brings the total size down to target_size. Entries for
+         * which skip() returns true are never returned as candidates and
+         * are collected in skipped instead. Cost is proportional to the
+         * number of entries visited, not to the size of the cache.
+         */
+        void collectEvictionCandidates(uintmax_t target_size,
+                                       const skip_func_t& skip,
+                                       entry_list_t& candidates,
+                                       entry_list_t& skipped) const;
+
+        /**
+         * Remove an entry returned by collectEvictionCandidates() unless it
+         * was written or read since. Returns true if the entry was removed.
+         */
+        bool removeIfUnchanged(const LLUUID& id, const Entry& entry);
+
+        bool getEntry(const LLUUID& id, Entry& entry) const;
+        uintmax_t getTotalSize() const;
+        size_t getEntryCount() const;
+        size_t getJournalRecordCount() const;
+
+        static const std::time_t ACCESS_TIME_THRESHOLD;
+
+    private:
+        enum EJournalOp : U8
+        {
+            OP_WRITE = 1,
+            OP_ACCESS,
+            OP_REMOVE
+        };
+
+        void applyWrite(const LLUUID& id, uintmax_t size, std::time_t when);
+        void applyAccess(const LLUUID& id, std::time_t when);
+        void applyRemove(const LLUUID& id);
+
+        void appendJournal(EJournalOp op, const LLUUID& id, uintmax_t size, std::time_t when);
+        bool openJournal(bool truncate);
+        void closeJournal();
+        bool readSnapshot(bool& damaged);
+        bool replayJournal(bool& damaged);
+        bool writeSnapshot();
+
+        std::string mSnapshotPath;
+        std::string mJournalPath;
+        LLFILE* mJournal{ nullptr };
+        size_t mJournalRecords{ 0 };
+
+        typedef std::unordered_map<LLUUID, Entry> entry_map_t;
+        typedef std::set<std::pair<std::time_t, LLUUID>> lru_set_t;
+        entry_map_t mEntries;
+        lru_set_t mLRU;
+        uintmax_t mTotalSize{ 0 };
+
+        mutable LLMutex mMutex;
+};
+
+#endif // LL_LLDISKCACHEINDEX_H
@@ -33,6 +33,7 @@
 #include "llfilesystem.h"
 #include "llfasttimer.h"
 #include "lldiskcache.h"
+#include "llpackedassetstore.h"
 
 #include "boost/filesystem.hpp"
 
@@ -54,6 +55,16 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
     // This block of code was originally called in the read() method but after comments here:
     // https://bitbucket.org/lindenlab/viewer/commits/e28c1b46e9944f0215a13cab8ee7dded88d7fc90#comment-10537114
     // we decided to follow Henri's suggestion and move the code to update the last access time here.
+    // <FS> Packed asset store: there is no file time to maintain
+    if (mode == LLFileSystem::READ && LLPackedAssetStore::instanceExists())
+    {
+        if (LLDiskCache::instanceExists() && LLPackedAssetStore::instance().exists(mFileID, mFileType))
+        {
+            LLDiskCache::instance().onFileAccessed(mFileID);
+        }
+    }
+    else
+    // </FS>
     if (mode == LLFileSystem::READ)
     {
         // build the filename (TODO: we do this in a few places - perhaps we should factor into a single function)
@@ -67,6 +78,12 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
         if (exists)
         {
             updateFileAccessTime(filename);
+            // <FS> Indexed disk cache
+            if (LLDiskCache::instanceExists())
+            {
+                LLDiskCache::instance().onFileAccessed(mFileID);
+            }
+            // </FS>
         }
     }
 }
@@ -75,6 +92,12 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
 bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
     LL_PROFILE_ZONE_SCOPED;
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        return LLPackedAssetStore::instance().exists(file_id, file_type);
+    }
+    // </FS>
     const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
 
     // <FS:Ansariel> IO-streams replacement
@@ -98,9 +121,25 @@ bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType fil
 bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType file_type, int suppress_error /*= 0*/)
 {
     LL_PROFILE_ZONE_COLOR(tracy::Color::Gold); // <FS:Beq> measure cache performance
-    const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        LLPackedAssetStore::instance().remove(file_id, file_type);
+    }
+    else
+    // </FS>
+    {
+        const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
+
+        LLFile::remove(filename.c_str(), suppress_error);
+    }
 
-    LLFile::remove(filename.c_str(), suppress_error);
+    // <FS> Indexed disk cache
+    if (LLDiskCache::instanceExists())
+    {
+        LLDiskCache::instance().onFileRemoved(file_id);
+    }
+    // </FS>
 
     return true;
 }
@@ -110,6 +149,21 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
                               const LLUUID& new_file_id, const LLAssetType::EType new_file_type)
 {
     LL_PROFILE_ZONE_COLOR(tracy::Color::Gold); // <FS:Beq> measure cache performance
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        if (!LLPackedAssetStore::instance().rename(old_file_id, old_file_type, new_file_id, new_file_type))
+        {
+            LL_WARNS() << "Failed to rename " << old_file_id << " to " << new_file_id << " in packed asset store" << LL_ENDL;
+        }
+        else if (LLDiskCache::instanceExists())
+        {
+            LLDiskCache::instance().onFileRenamed(old_file_id, new_file_id);
+        }
+        return true;
+    }
+    // </FS>
+
     const std::string old_filename = LLDiskCache::metaDataToFilepath(old_file_id, old_file_type);
     const std::string new_filename = LLDiskCache::metaDataToFilepath(new_file_id, new_file_type);
 
@@ -121,6 +175,12 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
         //return false;
         LL_WARNS() << "Failed to rename " << old_file_id << " to " << new_file_id << " reason: " << strerror(errno) << LL_ENDL;
     }
+    // <FS> Indexed disk cache
+    else if (LLDiskCache::instanceExists())
+    {
+        LLDiskCache::instance().onFileRenamed(old_file_id, new_file_id);
+    }
+    // </FS>
 
     return true;
 }
@@ -129,6 +189,12 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
 S32 LLFileSystem::getFileSize(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
     LL_PROFILE_ZONE_COLOR(tracy::Color::Gold); // <FS:Beq> measure cache performance
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        return LLPackedAssetStore::instance().getSize(file_id, file_type);
+    }
+    // </FS>
     const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
 
     S32 file_size = 0;
@@ -153,6 +219,15 @@ bool LLFileSystem::read(U8* buffer, S32 bytes)
     LL_PROFILE_ZONE_COLOR(tracy::Color::Gold); // <FS:Beq> measure cache performance
     bool success = false;
 
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        mBytesRead = LLPackedAssetStore::instance().read(mFileID, mFileType, mPosition, buffer, bytes);
+        mPosition += mBytesRead;
+        return mBytesRead > 0;
+    }
+    // </FS>
+
     const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
 
     // <FS:Ansariel> IO-streams replacement
@@ -220,6 +295,7 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
     const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
 
     bool success = false;
+    long file_size = 0; // <FS/> Indexed disk cache
 
     // <FS:Ansariel> IO-streams replacement
     //if (mMode == APPEND)
@@ -269,6 +345,23 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
     //        success = true;
     //    }
     //}
+    // <FS> Packed asset store
+    if (LLPackedAssetStore::instanceExists())
+    {
+        LLPackedAssetStore& store = LLPackedAssetStore::instance();
+        // Same as the file modes below: WRITE replaces the asset on every call
+        const bool truncate = (mMode != APPEND && mMode != READ_WRITE);
+        const S32 offset = truncate ? 0 : (mMode == APPEND ? store.getSize(mFileID, mFileType) : mPosition);
+        const S32 new_size = store.write(mFileID, mFileType, offset, buffer, bytes, truncate);
+        if (new_size >= 0)
+        {
+            mPosition = offset + bytes;
+            file_size = new_size;
+            success = true;
+        }
+    }
+    else
+    // </FS>
     if (mMode == APPEND)
     {
         LLFILE* ofs = LLFile::fopen(filename, "a+b");
@@ -289,6 +382,12 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
             {
                 S32 bytes_written = static_cast<S32>(fwrite(buffer, 1, bytes, ofs));
                 mPosition = ftell(ofs);
+                // <FS> Indexed disk cache: writing in the middle doesn't tell us the size
+                if (fseek(ofs, 0, SEEK_END) == 0)
+                {
+                    file_size = ftell(ofs);
+                }
+                // </FS>
                 fclose(ofs);
                 success = (bytes_written == bytes);
             }
@@ -318,6 +417,13 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
     }
     // </FS:Ansariel>
 
+    // <FS> Indexed disk cache
+    if (success && LLDiskCache::instanceExists())
+    {
+        LLDiskCache::instance().onFileWritten(mFileID, llmax(file_size, (long)mPosition));
+    }
+    // </FS>
+
     return success;
 }
 
@@ -0,0 +1,768 @@
+/**
+ * @file llpackedassetstore.cpp
+ * @brief Optional LLFileSystem backend that packs cached assets into
+ * a few large segment files.
+ *
+ * See llpackedassetstore.h for a description of the segment format.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpackedassetstore.h"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <cstddef>
+
+namespace
+{
+    constexpr U32 SEGMENT_MAGIC = 0x53504c53;   // "SLPS"
+    constexpr U32 RECORD_MAGIC = 0x52504c53;    // "SLPR"
+    constexpr U32 SEGMENT_VERSION = 1;
+    constexpr U32 RECORD_LIVE = 0x1;
+
+    constexpr U64 SEGMENT_HEADER_SIZE = 16;
+    constexpr U64 RECORD_ALIGNMENT = 16;
+
+    // Segments are rolled over once they reach this size. An asset larger
+    // than this gets a segment to itself.
+    constexpr U64 SEGMENT_MAX_SIZE = 64 * 1024 * 1024;
+
+    struct SegmentHeader
+    {
+        U32 mMagic;
+        U32 mVersion;
+        U32 mNumber;
+        U32 mReserved;
+    };
+    static_assert(sizeof(SegmentHeader) == SEGMENT_HEADER_SIZE, "unexpected segment header size");
+
+    struct RecordHeader
+    {
+        U32 mMagic;
+        U32 mFlags;     // only field rewritten in place
+        U8  mID[UUID_BYTES];
+        S32 mType;
+        S32 mSize;
+        U32 mChecksum;  // of everything but mFlags, to catch torn headers
+        U8  mReserved[12];
+    };
+    static_assert(sizeof(RecordHeader) % RECORD_ALIGNMENT == 0, "record header breaks data alignment");
+
+    U32 header_checksum(const RecordHeader& header)
+    {
+        // FNV-1a
+        U32 hash = 2166136261u;
+        auto mix = [&hash](const void* data, size_t len)
+        {
+            const U8* bytes = (const U8*)data;
+            for (size_t i = 0; i < len; ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 16777619u;
+            }
+        };
+        mix(&header.mMagic, sizeof(header.mMagic));
+        mix(header.mID, sizeof(header.mID));
+        mix(&header.mType, sizeof(header.mType));
+        mix(&header.mSize, sizeof(header.mSize));
+        return hash;
+    }
+
+    U64 record_size(S32 data_size)
+    {
+        U64 size = sizeof(RecordHeader) + (U64)data_size;
+        return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+    }
+
+    std::string segment_path(const std::string& store_dir, U32 number)
+    {
+#if LL_WINDOWS
+        return store_dir + "\\" + llformat("segment_%08u.pack", number);
+#else
+        return store_dir + "/" + llformat("segment_%08u.pack", number);
+#endif
+    }
+
+    bool parse_segment_name(const std::string& filename, U32& number)
+    {
+        unsigned int value = 0;
+        char tail = 0;
+        if (sscanf(filename.c_str(), "segment_%8u.pac%c", &value, &tail) == 2 && tail == 'k')
+        {
+            number = value;
+            return true;
+        }
+        return false;
+    }
+}
+
+LLPackedAssetStore::Segment::~Segment()
+{
+    if (mFile)
+    {
+        LLFile::close(mFile);
+    }
+}
+
+LLPackedAssetStore::LLPackedAssetStore(const std::string& store_dir) :
+    mStoreDir(store_dir)
+{
+    LLFile::mkdir(mStoreDir);
+    loadSegments();
+}
+
+LLPackedAssetStore::~LLPackedAssetStore()
+{
+}
+
+void LLPackedAssetStore::loadSegments()
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<U32> numbers;
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    boost::filesystem::directory_iterator iter(ll_convert<std::wstring>(mStoreDir), ec);
+#else
+    boost::filesystem::directory_iterator iter(mStoreDir, ec);
+#endif
+    while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+    {
+        U32 number;
+        if (parse_segment_name((*iter).path().filename().string(), number))
+        {
+            numbers.push_back(number);
+        }
+        iter.increment(ec);
+    }
+    // Oldest first, so that later records win when an asset appears twice
+    std::sort(numbers.begin(), numbers.end());
+
+    LLMutexLock lock(&mMutex);
+
+    for (U32 number : numbers)
+    {
+        std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+        segment->mNumber = number;
+        segment->mPath = segment_path(mStoreDir, number);
+        segment->mFile = LLFile::fopen(segment->mPath, "r+b");
+        // Registered before the scan so that duplicates within the segment can be killed
+        mSegments[number] = segment;
+        if (!segment->mFile || !scanSegment(*segment))
+        {
+            LL_WARNS("LLDiskCache") << "Discarding unreadable asset segment " << segment->mPath << LL_ENDL;
+            mSegments.erase(number);
+            segment.reset();
+            LLFile::remove(segment_path(mStoreDir, number));
+            continue;
+        }
+        mActiveSegment = number;
+    }
+
+    // Failing here is not fatal, appendRecord() tries again
+    segment_map_t::const_iterator active = mSegments.find(mActiveSegment);
+    if (active == mSegments.end() || active->second->mSize >= SEGMENT_MAX_SIZE)
+    {
+        createSegment(mActiveSegment + 1);
+    }
+    else
+    {
+        // Appended to from now on, see getRecord()
+        active->second->mMapping.reset();
+    }
+
+    auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
+    LL_INFOS("LLDiskCache") << "Packed asset store loaded " << mIndex.size() << " assets from "
+                            << mSegments.size() << " segments in " << execute_time << " ms" << LL_ENDL;
+}
+
+bool LLPackedAssetStore::scanSegment(Segment& segment)
+{
+    std::shared_ptr<LLMappedFile> mapping = std::make_shared<LLMappedFile>();
+    if (!mapping->open(segment.mPath) || mapping->size() < SEGMENT_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    SegmentHeader segment_header;
+    memcpy(&segment_header, mapping->data(), sizeof(segment_header));
+    if (segment_header.mMagic != SEGMENT_MAGIC || segment_header.mVersion != SEGMENT_VERSION)
+    {
+        return false;
+    }
+
+    U64 offset = SEGMENT_HEADER_SIZE;
+    while (offset + sizeof(RecordHeader) <= mapping->size())
+    {
+        RecordHeader header;
+        memcpy(&header, mapping->data() + offset, sizeof(header));
+        if (header.mMagic != RECORD_MAGIC
+            || header.mSize < 0
+            || header.mChecksum != header_checksum(header)
+            || offset + record_size(header.mSize) > mapping->size())
+        {
+            // Torn write at the end of the segment, new records go over it
+            LL_WARNS("LLDiskCache") << "Asset segment " << segment.mPath << " truncated at " << offset
+                                    << " of " << mapping->size() << " bytes" << LL_ENDL;
+            break;
+        }
+
+        if (header.mFlags & RECORD_LIVE)
+        {
+            Key key;
+            memcpy(key.mID.mData, header.mID, UUID_BYTES);
+            key.mType = (LLAssetType::EType)header.mType;
+
+            Location location;
+            location.mSegment = segment.mNumber;
+            location.mHeaderOffset = offset;
+            location.mSize = header.mSize;
+
+            // A crash between appending a record and killing the one it
+            // replaces leaves both live: the newer one wins.
+            index_t::iterator it = mIndex.find(key);
+            if (it != mIndex.end())
+            {
+                killRecord(it->second);
+                it->second = location;
+            }
+            else
+            {
+                mIndex.emplace(key, location);
+            }
+            segment.mLiveBytes += record_size(header.mSize);
+        }
+        offset += record_size(header.mSize);
+    }
+
+    segment.mSize = offset;
+    segment.mMapping = mapping;
+    return true;
+}
+
+std::shared_ptr<LLPackedAssetStore::Segment> LLPackedAssetStore::createSegment(U32 number)
+{
+    std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+    segment->mNumber = number;
+    segment->mPath = segment_path(mStoreDir, number);
+    segment->mFile = LLFile::fopen(segment->mPath, "w+b");
+    if (!segment->mFile)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to create asset segment " << segment->mPath << LL_ENDL;
+        return nullptr;
+    }
+
+    SegmentHeader header{ SEGMENT_MAGIC, SEGMENT_VERSION, number, 0 };
+    if (fwrite(&header, 1, sizeof(header), segment->mFile) != sizeof(header) || fflush(segment->mFile) != 0)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to write asset segment " << segment->mPath << LL_ENDL;
+        return nullptr;
+    }
+    segment->mSize = SEGMENT_HEADER_SIZE;
+
+    mSegments[number] = segment;
+    mActiveSegment = number;
+    return segment;
+}
+
+LLPackedAssetStore::index_t::const_iterator LLPackedAssetStore::find(const LLUUID& id, LLAssetType::EType type) const
+{
+    index_t::const_iterator it = mIndex.find(Key{ id, type });
+    if (it == mIndex.end() && type != LLAssetType::AT_UNKNOWN)
+    {
+        it = mIndex.find(Key{ id, LLAssetType::AT_UNKNOWN });
+    }
+    return it;
+}
+
+bool LLPackedAssetStore::getRecord(const Location& location, BlobRef& blob) const
+{
+    segment_map_t::const_iterator seg_it = mSegments.find(location.mSegment);
+    if (seg_it == mSegments.end())
+    {
+        return false;
+    }
+
+    Segment& segment = *seg_it->second;
+    const U64 data_offset = location.mHeaderOffset + sizeof(RecordHeader);
+    if (segment.mNumber == mActiveSegment)
+    {
+        // Still being appended to: a mapping would have to be redone for
+        // every new record, read it instead
+        // At least one byte, an empty asset still makes a valid BlobRef
+        std::shared_ptr<std::vector<U8>> buffer = std::make_shared<std::vector<U8>>(llmax(location.mSize, 1));
+        if (fseek(segment.mFile, (long)data_offset, SEEK_SET) != 0
+            || (location.mSize > 0 && fread(buffer->data(), 1, location.mSize, segment.mFile) != (size_t)location.mSize))
+        {
+            LL_WARNS("LLDiskCache") << "Unable to read asset segment " << segment.mPath << LL_ENDL;
+            return false;
+        }
+        blob.mData = buffer->data();
+        blob.mSize = location.mSize;
+        blob.mOwner = std::move(buffer);
+        return true;
+    }
+
+    // Full segments don't change any more and are mapped once
+    if (!segment.mMapping)
+    {
+        std::shared_ptr<LLMappedFile> mapping = std::make_shared<LLMappedFile>();
+        if (!mapping->open(segment.mPath))
+        {
+            LL_WARNS("LLDiskCache") << "Unable to map asset segment " << segment.mPath << LL_ENDL;
+            return false;
+        }
+        segment.mMapping = mapping;
+    }
+    if (segment.mMapping->size() < data_offset + location.mSize)
+    {
+        LL_WARNS("LLDiskCache") << "Asset segment " << segment.mPath << " is shorter than its records" << LL_ENDL;
+        return false;
+    }
+
+    blob.mData = segment.mMapping->data() + data_offset;
+    blob.mSize = location.mSize;
+    blob.mOwner = segment.mMapping;
+    return true;
+}
+
+bool LLPackedAssetStore::appendRecord(const Key& key, const U8* data, S32 size, Location& location)
+{
+    const U64 total_size = record_size(size);
+
+    segment_map_t::const_iterator active = mSegments.find(mActiveSegment);
+    std::shared_ptr<Segment> segment = active != mSegments.end() ? active->second : nullptr;
+    if (!segment || (segment->mSize > SEGMENT_HEADER_SIZE && segment->mSize + total_size > SEGMENT_MAX_SIZE))
+    {
+        segment = createSegment(mActiveSegment + 1);
+        if (!segment)
+        {
+            return false;
+        }
+    }
+
+    RecordHeader header{};
+    header.mMagic = RECORD_MAGIC;
+    header.mFlags = RECORD_LIVE;
+    memcpy(header.mID, key.mID.mData, UUID_BYTES);
+    header.mType = key.mType;
+    header.mSize = size;
+    header.mChecksum = header_checksum(header);
+
+    static const U8 padding[RECORD_ALIGNMENT] = {};
+    const size_t padding_size = (size_t)(total_size - sizeof(RecordHeader) - size);
+
+    // Flushed before the index points at it so that a fresh mapping sees it
+    if (fseek(segment->mFile, (long)segment->mSize, SEEK_SET) != 0
+        || fwrite(&header, 1, sizeof(header), segment->mFile) != sizeof(header)
+        || (size > 0 && fwrite(data, 1, size, segment->mFile) != (size_t)size)
+        || (padding_size > 0 && fwrite(padding, 1, padding_size, segment->mFile) != padding_size)
+        || fflush(segment->mFile) != 0)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to write to asset segment " << segment->mPath << LL_ENDL;
+        return false;
+    }
+
+    location.mSegment = segment->mNumber;
+    location.mHeaderOffset = segment->mSize;
+    location.mSize = size;
+
+    segment->mSize += total_size;
+    segment->mLiveBytes += total_size;
+    return true;
+}
+
+bool LLPackedAssetStore::extendRecord(const Key& key, Location& location, S32 offset, const U8* data, S32 size)
+{
+    // Only the last record of the active segment can grow, and only past
+    // its end: the bytes a BlobRef may be looking at are left alone.
+    segment_map_t::const_iterator seg_it = mSegments.find(location.mSegment);
+    if (location.mSegment != mActiveSegment || seg_it == mSegments.end()
+        || offset < location.mSize || size > S32_MAX - offset)
+    {
+        return false;
+    }
+    Segment& segment = *seg_it->second;
+    const S32 new_size = offset + size;
+    const U64 old_total = record_size(location.mSize);
+    const U64 new_total = record_size(new_size);
+    if (location.mHeaderOffset + old_total != segment.mSize
+        || (location.mHeaderOffset > SEGMENT_HEADER_SIZE && location.mHeaderOffset + new_total > SEGMENT_MAX_SIZE))
+    {
+        return false;
+    }
+
+    RecordHeader header{};
+    header.mMagic = RECORD_MAGIC;
+    header.mFlags = RECORD_LIVE;
+    memcpy(header.mID, key.mID.mData, UUID_BYTES);
+    header.mType = key.mType;
+    header.mSize = new_size;
+    header.mChecksum = header_checksum(header);
+
+    static const U8 zeros[RECORD_ALIGNMENT] = {};
+    const U64 data_offset = location.mHeaderOffset + sizeof(RecordHeader);
+    const size_t padding_size = (size_t)(new_total - sizeof(RecordHeader) - new_size);
+    bool success = fseek(segment.mFile, (long)(data_offset + location.mSize), SEEK_SET) == 0;
+    for (S32 gap = offset - location.mSize; success && gap > 0; gap -= (S32)RECORD_ALIGNMENT)
+    {
+        const size_t chunk = (size_t)llmin(gap, (S32)RECORD_ALIGNMENT);
+        success = fwrite(zeros, 1, chunk, segment.mFile) == chunk;
+    }
+    // The data goes first: until the header is rewritten a scan still
+    // finds the old record, and stops at the new bytes after it.
+    success = success
+        && (size == 0 || fwrite(data, 1, size, segment.mFile) == (size_t)size)
+        && (padding_size == 0 || fwrite(zeros, 1, padding_size, segment.mFile) == padding_size)
+        && fflush(segment.mFile) == 0
+        && fseek(segment.mFile, (long)location.mHeaderOffset, SEEK_SET) == 0
+        && fwrite(&header, 1, sizeof(header), segment.mFile) == sizeof(header)
+        && fflush(segment.mFile) == 0;
+    if (!success)
+    {
+        LL_WARNS("LLDiskCache") << "Unable to extend a record of asset segment " << segment.mPath << LL_ENDL;
+        return false;
+    }
+
+    location.mSize = new_size;
+    segment.mSize = location.mHeaderOffset + new_total;
+    segment.mLiveBytes += new_total - old_total;
+    return true;
+}
+
+void LLPackedAssetStore::killRecord(const Location& location)
+{
+    segment_map_t::iterator seg_it = mSegments.find(location.mSegment);
+    if (seg_it == mSegments.end())
+    {
+        return;
+    }
+
+    Segment& segment = *seg_it->second;
+    const U32 flags = 0;
+    if (fseek(segment.mFile, (long)(location.mHeaderOffset + offsetof(RecordHeader, mFlags)), SEEK_SET) != 0
+        || fwrite(&flags, 1, sizeof(flags), segment.mFile) != sizeof(flags)
+        || fflush(segment.mFile) != 0)
+    {
+        // Not fatal: the newer record wins when the segment is scanned again
+        LL_WARNS("LLDiskCache") << "Unable to update asset segment " << segment.mPath << LL_ENDL;
+    }
+    segment.mLiveBytes -= record_size(location.mSize);
+}
+
+void LLPackedAssetStore::eraseEntry(index_t::const_iterator it)
+{
+    killRecord(it->second);
+    mIndex.erase(it);
+}
+
+bool LLPackedAssetStore::exists(const LLUUID& id, LLAssetType::EType type) const
+{
+    LLMutexLock lock(&mMutex);
+    return find(id, type) != mIndex.end();
+}
+
+S32 LLPackedAssetStore::getSize(const LLUUID& id, LLAssetType::EType type) const
+{
+    LLMutexLock lock(&mMutex);
+    index_t::const_iterator it = find(id, type);
+    return it != mIndex.end() ? it->second.mSize : 0;
+}
+
+LLPackedAssetStore::BlobRef LLPackedAssetStore::get(const LLUUID& id, LLAssetType::EType type) const
+{
+    LLMutexLock lock(&mMutex);
+
+    BlobRef blob;
+    index_t::const_iterator it = find(id, type);
+    if (it != mIndex.end())
+    {
+        getRecord(it->second, blob);
+    }
+    return blob;
+}
+
+S32 LLPackedAssetStore::read(const LLUUID& id, LLAssetType::EType type, S32 offset, U8* buffer, S32 bytes) const
+{
+    BlobRef blob = get(id, type);
+    if (!blob || offset < 0 || offset >= blob.size() || bytes <= 0)
+    {
+        return 0;
+    }
+
+    // The copy happens outside of the lock, the BlobRef keeps the mapping alive
+    S32 to_copy = llmin(bytes, blob.size() - offset);
+    memcpy(buffer, blob.data() + offset, to_copy);
+    return to_copy;
+}
+
+S32 LLPackedAssetStore::write(const LLUUID& id, LLAssetType::EType type, S32 offset, const U8* buffer, S32 bytes, bool truncate)
+{
+    if (offset < 0 || bytes < 0)
+    {
+        return -1;
+    }
+
+    LLMutexLock lock(&mMutex);
+
+    const Key key{ id, type };
+    index_t::iterator it = mIndex.find(key);
+
+    // Chunked writers append to the last record in place rather than
+    // rewriting the asset for every chunk
+    if (!truncate && it != mIndex.end() && extendRecord(key, it->second, offset, buffer, bytes))
+    {
+        return it->second.mSize;
+    }
+
+    const U8* data = buffer;
+    S32 size = bytes;
+    std::vector<U8> merged;
+    if (!truncate && (it != mIndex.end() || offset > 0))
+    {
+        // Records are otherwise immutable, so other partial writes rewrite
+        // the whole asset
+        BlobRef old_blob;
+        if (it != mIndex.end())
+        {
+            getRecord(it->second, old_blob);
+        }
+        const S32 old_size = old_blob.size();
+        merged.resize(llmax(old_size, offset + bytes));
+        if (old_size > 0)
+        {
+            memcpy(merged.data(), old_blob.data(), old_size);
+        }
+        if (bytes > 0)
+        {
+            memcpy(merged.data() + offset, buffer, bytes);
+        }
+        data = merged.data();
+        size = (S32)merged.size();
+    }
+
+    Location location;
+    if (!appendRecord(key, data, size, location))
+    {
+        return -1;
+    }
+
+    if (it != mIndex.end())
+    {
+        killRecord(it->second);
+        it->second = location;
+    }
+    else
+    {
+        mIndex.emplace(key, location);
+    }
+    return size;
+}
+
+bool LLPackedAssetStore::remove(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+
+    index_t::const_iterator it = mIndex.find(Key{ id, type });
+    if (it == mIndex.end())
+    {
+        return false;
+    }
+    eraseEntry(it);
+    return true;
+}
+
+bool LLPackedAssetStore::removeAllTypes(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+
+    bool removed = false;
+    auto remove_type = [&](LLAssetType::EType type)
+    {
+        index_t::const_iterator it = mIndex.find(Key{ id, type });
+        if (it != mIndex.end())
+        {
+            eraseEntry(it);
+            removed = true;
+        }
+    };
+    for (S32 type = 0; type < LLAssetType::AT_COUNT; ++type)
+    {
+        remove_type((LLAssetType::EType)type);
+    }
+    remove_type(LLAssetType::AT_UNKNOWN);
+    remove_type(LLAssetType::AT_NONE);
+    return removed;
+}
+
+bool LLPackedAssetStore::rename(const LLUUID& old_id, LLAssetType::EType old_type,
+                                const LLUUID& new_id, LLAssetType::EType new_type)
+{
+    LLMutexLock lock(&mMutex);
+
+    const Key old_key{ old_id, old_type };
+    const Key new_key{ new_id, new_type };
+    index_t::const_iterator old_it = mIndex.find(old_key);
+    if (old_it == mIndex.end())
+    {
+        return false;
+    }
+    if (old_key == new_key)
+    {
+        return true;
+    }
+
+    BlobRef blob;
+    Location location;
+    if (!getRecord(old_it->second, blob) || !appendRecord(new_key, blob.data(), blob.size(), location))
+    {
+        return false;
+    }
+    eraseEntry(old_it);
+
+    // Like a file rename, an existing asset with the new name is replaced
+    index_t::iterator new_it = mIndex.find(new_key);
+    if (new_it != mIndex.end())
+    {
+        killRecord(new_it->second);
+        new_it->second = location;
+    }
+    else
+    {
+        mIndex.emplace(new_key, location);
+    }
+    return true;
+}
+
+void LLPackedAssetStore::clear()
+{
+    LLMutexLock lock(&mMutex);
+
+    for (segment_map_t::value_type& seg : mSegments)
+    {
+        if (seg.second->mFile)
+        {
+            LLFile::close(seg.second->mFile);
+            seg.second->mFile = nullptr;
+        }
+        LLFile::remove(seg.second->mPath);
+    }
+    mSegments.clear();
+    mIndex.clear();
+    // Failing here is not fatal, appendRecord() tries again
+    mActiveSegment = 0;
+    createSegment(1);
+}
+
+void LLPackedAssetStore::compact(F32 max_dead_fraction)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    std::vector<U32> victims;
+    {
+        LLMutexLock lock(&mMutex);
+        for (const segment_map_t::value_type& seg : mSegments)
+        {
+            const U64 used = seg.second->mSize - SEGMENT_HEADER_SIZE;
+            if (seg.first != mActiveSegment
+                && (used == 0 || (F32)(used - seg.second->mLiveBytes) >= max_dead_fraction * used))
+            {
+                victims.push_back(seg.first);
+            }
+        }
+    }
+
+    for (U32 number : victims)
+    {
+        std::vector<Key> keys;
+        {
+            LLMutexLock lock(&mMutex);
+            for (const index_t::value_type& entry : mIndex)
+            {
+                if (entry.second.mSegment == number)
+                {
+                    keys.push_back(entry.first);
+                }
+            }
+        }
+
+        // One record at a time so that readers and writers are not held up
+        // for the whole segment
+        U64 moved_bytes = 0;
+        for (const Key& key : keys)
+        {
+            LLMutexLock lock(&mMutex);
+            index_t::iterator it = mIndex.find(key);
+            if (it == mIndex.end() || it->second.mSegment != number)
+            {
+                continue;
+            }
+
+            BlobRef blob;
+            Location location;
+            if (!getRecord(it->second, blob) || !appendRecord(key, blob.data(), blob.size(), location))
+            {
+                break;
+            }
+            killRecord(it->second);
+            it->second = location;
+            moved_bytes += record_size(location.mSize);
+        }
+
+        LLMutexLock lock(&mMutex);
+        segment_map_t::iterator seg_it = mSegments.find(number);
+        if (seg_it != mSegments.end() && seg_it->second->mLiveBytes == 0)
+        {
+            LL_DEBUGS("LLDiskCache") << "Compacted asset segment " << seg_it->second->mPath
+                                     << ", moved " << moved_bytes << " bytes" << LL_ENDL;
+            // Outstanding BlobRefs keep their mapping of the deleted file
+            LLFile::close(seg_it->second->mFile);
+            seg_it->second->mFile = nullptr;
+            LLFile::remove(seg_it->second->mPath);
+            mSegments.erase(seg_it);
+        }
+    }
+}
+
+void LLPackedAssetStore::forEachAsset(const std::function<void(const LLUUID&, LLAssetType::EType, S32)>& func) const
+{
+    LLMutexLock lock(&mMutex);
+    for (const index_t::value_type& entry : mIndex)
+    {
+        func(entry.first.mID, entry.first.mType, entry.second.mSize);
+    }
+}
+
+size_t LLPackedAssetStore::getAssetCount() const
+{
+    LLMutexLock lock(&mMutex);
+    return mIndex.size();
+}
+
+size_t LLPackedAssetStore::getSegmentCount() const
+{
+    LLMutexLock lock(&mMutex);
+    return mSegments.size();
+}
@@ -0,0 +1,212 @@
+/**
+ * @file llpackedassetstore.h
+ * @brief Optional LLFileSystem backend that packs cached assets into
+ * a few large segment files.
+ *
+ * @Description:
+ * The default LLFileSystem backend stores each asset in its own file,
+ * so every open or existence check is a syscall and small assets waste
+ * most of a filesystem block. When enabled (FSDiskCachePackedStore) the
+ * assets are appended to segment files instead:
+ * 1/ Each record in a segment is a small header (asset ID, asset type,
+ *    size, live flag) followed by the asset data, aligned to 16 bytes.
+ * 2/ An in-memory hash index maps UUID + asset type to the location of
+ *    the live record. It's rebuilt at startup by walking the record
+ *    headers, which only touches a few large files.
+ * 3/ Reads are served from a read-only mapping of the segment so there
+ *    is no syscall and no kernel copy per read. get() hands out the
+ *    mapped bytes directly. Each full segment is mapped once; the one
+ *    still being appended to is read through its file instead.
+ * 4/ Records are never modified in place. Writing, appending to or
+ *    renaming an asset appends a new record and clears the live flag of
+ *    the old one. compact() copies the live records out of segments that
+ *    are mostly dead and deletes them; it's run from the disk cache
+ *    purge thread.
+ * 5/ Assets copied in as AT_UNKNOWN (the static assets) are returned
+ *    for any asset type, as the loose file backend ignores the type.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKEDASSETSTORE_H
+#define LL_LLPACKEDASSETSTORE_H
+
+#include "llassettype.h"
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "llmutex.h"
+#include "llsingleton.h"
+#include "lluuid.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+class LLPackedAssetStore :
+    public LLParamSingleton<LLPackedAssetStore>
+{
+    LLSINGLETON(LLPackedAssetStore,
+                /**
+                 * Folder holding the segment files, typically a child
+                 * of the asset cache folder.
+                 */
+                const std::string& store_dir);
+    ~LLPackedAssetStore();
+
+public:
+    /**
+     * View of a stored asset. The data stays valid for as long as the
+     * BlobRef exists, even if the asset is rewritten, removed or compacted
+     * away in the meantime. Assets in a full segment are viewed in place
+     * through its mapping, those in the segment still being appended to
+     * are read into a buffer.
+     */
+    class BlobRef
+    {
+    public:
+        BlobRef() = default;
+        const U8* data() const { return mData; }
+        S32 size() const { return mSize; }
+        explicit operator bool() const { return mData != nullptr; }
+
+    private:
+        friend class LLPackedAssetStore;
+        std::shared_ptr<const void> mOwner;     // segment mapping or buffer
+        const U8* mData{ nullptr };
+        S32 mSize{ 0 };
+    };
+
+    bool exists(const LLUUID& id, LLAssetType::EType type) const;
+
+    /**
+     * Returns 0 if the asset is not stored.
+     */
+    S32 getSize(const LLUUID& id, LLAssetType::EType type) const;
+
+    BlobRef get(const LLUUID& id, LLAssetType::EType type) const;
+
+    /**
+     * Copy up to bytes of the asset starting at offset into buffer.
+     * Returns the number of bytes copied.
+     */
+    S32 read(const LLUUID& id, LLAssetType::EType type, S32 offset, U8* buffer, S32 bytes) const;
+
+    /**
+     * Write bytes at offset, with the same semantics as LLFileSystem::write():
+     * truncate replaces the whole asset, otherwise the existing data is kept
+     * and extended as needed. Returns the new size of the asset or -1.
+     */
+    S32 write(const LLUUID& id, LLAssetType::EType type, S32 offset, const U8* buffer, S32 bytes, bool truncate);
+
+    bool remove(const LLUUID& id, LLAssetType::EType type);
+
+    /**
+     * Remove the asset under every asset type. The disk cache only knows
+     * asset IDs when purging. Returns true if anything was removed.
+     */
+    bool removeAllTypes(const LLUUID& id);
+
+    bool rename(const LLUUID& old_id, LLAssetType::EType old_type,
+                const LLUUID& new_id, LLAssetType::EType new_type);
+
+    /**
+     * Remove every segment file.
+     */
+    void clear();
+
+    /**
+     * Rewrite segments where at least max_dead_fraction of the bytes belong
+     * to dead records. Safe to call from a background thread.
+     */
+    void compact(F32 max_dead_fraction = 0.5f);
+
+    /**
+     * Visit every stored asset, used to rebuild the disk cache index.
+     */
+    void forEachAsset(const std::function<void(const LLUUID&, LLAssetType::EType, S32)>& func) const;
+
+    size_t getAssetCount() const;
+    size_t getSegmentCount() const;
+
+private:
+    struct Key
+    {
+        LLUUID              mID;
+        LLAssetType::EType  mType;
+
+        bool operator==(const Key& other) const { return mID == other.mID && mType == other.mType; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            size_t seed = hash_value(key.mID);
+            boost::hash_combine(seed, (S32)key.mType);
+            return seed;
+        }
+    };
+
+    struct Location
+    {
+        U32 mSegment{ 0 };
+        U64 mHeaderOffset{ 0 };
+        S32 mSize{ 0 };
+    };
+
+    struct Segment
+    {
+        ~Segment();
+
+        U32         mNumber{ 0 };
+        std::string mPath;
+        LLFILE*     mFile{ nullptr };
+        U64         mSize{ 0 };         // end of the last complete record
+        U64         mLiveBytes{ 0 };    // header and data of live records
+        std::shared_ptr<const LLMappedFile> mMapping; // once full
+    };
+
+    typedef std::unordered_map<Key, Location, KeyHash> index_t;
+    typedef std::map<U32, std::shared_ptr<Segment>> segment_map_t;
+
+    void loadSegments();
+    bool scanSegment(Segment& segment);
+    std::shared_ptr<Segment> createSegment(U32 number);
+
+    // All of the following expect mMutex to be held
+    index_t::const_iterator find(const LLUUID& id, LLAssetType::EType type) const;
+    bool getRecord(const Location& location, BlobRef& blob) const;
+    bool appendRecord(const Key& key, const U8* data, S32 size, Location& location);
+    bool extendRecord(const Key& key, Location& location, S32 offset, const U8* data, S32 size);
+    void killRecord(const Location& location);
+    void eraseEntry(index_t::const_iterator it);
+
+    std::string mStoreDir;
+    index_t mIndex;
+    segment_map_t mSegments;
+    U32 mActiveSegment{ 0 };
+
+    mutable LLMutex mMutex;
+};
+
+#endif // LL_LLPACKEDASSETSTORE_H
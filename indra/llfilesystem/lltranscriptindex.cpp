@@ -0,0 +1,343 @@
+/**
+ * @file lltranscriptindex.cpp
+ * @brief Message offset index of chat transcript files.
+ *
+ * See lltranscriptindex.h for a description of the indexes.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltranscriptindex.h"
+
+#include "hbxxh.h"
+#include "llmutex.h"
+
+
+namespace
+{
+    constexpr U32 INDEX_MAGIC = 0x49544c53; // "SLTI"
+    constexpr U32 INDEX_VERSION = 1;
+
+    // How much of the start of a transcript must be unchanged to trust its
+    // index, without reading the whole of it
+    constexpr U32 HEAD_SIZE = 4096;
+
+    constexpr size_t SCAN_CHUNK_SIZE = 1024 * 1024;
+
+    // Several history threads may update the index of the same transcript
+    LLMutex sIndexFileMutex;
+
+    bool seek(LLFILE* file, U64 offset)
+    {
+#if LL_WINDOWS
+        return _fseeki64(file, (S64)offset, SEEK_SET) == 0;
+#else
+        return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+
+    bool read_at(LLFILE* file, U64 offset, void* buffer, size_t size)
+    {
+        return seek(file, offset) && fread(buffer, 1, size, file) == size;
+    }
+
+    // Same test as LLLogChat::loadChatHistory(): lines starting with a space
+    // and empty lines belong to the message before them
+    bool starts_message(char c)
+    {
+        return c != ' ' && c != '\n' && c != '\r';
+    }
+}
+
+struct LLTranscriptIndex::Header
+{
+    U32 mMagic;
+    U32 mVersion;
+    U64 mIndexedSize;
+    U64 mHeadHash;
+    U32 mHeadSize;
+    U32 mPad;
+    U64 mMessageCount;
+};
+
+LLTranscriptIndex::LLTranscriptIndex(const std::string& log_filename, const std::string& index_filename)
+:   mLogFilename(log_filename),
+    mIndexFilename(index_filename)
+{
+}
+
+void LLTranscriptIndex::clear()
+{
+    mFile.close();
+    mMappedOffsets = nullptr;
+    mMappedCount = 0;
+    mOffsets.clear();
+    mIndexedSize = 0;
+    mHeadHash = 0;
+    mHeadSize = 0;
+}
+
+bool LLTranscriptIndex::update()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    LLMutexLock lock(&sIndexFileMutex);
+
+    llstat stat_data;
+    LLFILE* log = LLFile::stat(mLogFilename, &stat_data) ? nullptr : LLFile::fopen(mLogFilename, "rb");
+    if (!log)
+    {
+        clear();
+        return false;
+    }
+    const U64 log_size = (U64)stat_data.st_size;
+
+    // Check the index against the transcript, from memory when it was
+    // already read
+    bool valid = mHeadSize ? true : readIndex(log_size);
+    if (valid && mHeadSize)
+    {
+        std::vector<char> head(mHeadSize);
+        valid = log_size >= mIndexedSize
+            && read_at(log, 0, head.data(), mHeadSize)
+            && HBXXH64::digest(head.data(), mHeadSize) == mHeadHash;
+    }
+    if (!valid)
+    {
+        clear();
+    }
+
+    const size_t first_new = getMessageCount();
+    const U64 indexed_size = mIndexedSize;
+    scan(log, log_size);
+
+    // Hash more of the head while the transcript is short
+    bool rewrite = !valid;
+    if (mHeadSize < HEAD_SIZE && mIndexedSize > mHeadSize)
+    {
+        mHeadSize = (U32)llmin(mIndexedSize, (U64)HEAD_SIZE);
+        std::vector<char> head(mHeadSize);
+        if (read_at(log, 0, head.data(), mHeadSize))
+        {
+            mHeadHash = HBXXH64::digest(head.data(), mHeadSize);
+        }
+        else
+        {
+            mHeadSize = 0;
+        }
+    }
+    LLFile::close(log);
+
+    if (rewrite || mIndexedSize != indexed_size)
+    {
+        writeIndex(first_new, rewrite);
+    }
+    return true;
+}
+
+bool LLTranscriptIndex::readIndex(U64 log_size)
+{
+    if (!mFile.open(mIndexFilename))
+    {
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(mFile.data());
+    bool valid = mFile.size() >= sizeof(Header)
+        && header->mMagic == INDEX_MAGIC
+        && header->mVersion == INDEX_VERSION
+        && header->mIndexedSize <= log_size
+        && header->mHeadSize <= HEAD_SIZE
+        && header->mHeadSize <= header->mIndexedSize
+        // offsets written after the header was last are ignored
+        && header->mMessageCount <= (mFile.size() - sizeof(Header)) / sizeof(U64);
+    if (valid)
+    {
+        mMappedOffsets = reinterpret_cast<const U64*>(mFile.data() + sizeof(Header));
+        mMappedCount = (size_t)header->mMessageCount;
+        valid = !mMappedCount || mMappedOffsets[mMappedCount - 1] < header->mIndexedSize;
+    }
+
+    if (!valid)
+    {
+        LL_INFOS("ChatHistory") << "Indexing transcript " << mLogFilename << " again" << LL_ENDL;
+        clear();
+        return false;
+    }
+    mIndexedSize = header->mIndexedSize;
+    mHeadHash = header->mHeadHash;
+    mHeadSize = header->mHeadSize;
+    return true;
+}
+
+void LLTranscriptIndex::scan(LLFILE* log, U64 log_size)
+{
+    if (mIndexedSize >= log_size || !seek(log, mIndexedSize))
+    {
+        return;
+    }
+
+    // mIndexedSize is always at the start of a line
+    std::vector<char> chunk(SCAN_CHUNK_SIZE);
+    U64 chunk_offset = mIndexedSize;
+    bool line_start = true;
+    size_t bytes_read;
+    while (chunk_offset < log_size
+           && (bytes_read = fread(chunk.data(), 1, (size_t)llmin((U64)chunk.size(), log_size - chunk_offset), log)) > 0)
+    {
+        const char* begin = chunk.data();
+        const char* end = begin + bytes_read;
+        const char* p = begin;
+        while (p < end)
+        {
+            if (line_start && starts_message(*p))
+            {
+                mOffsets.push_back(chunk_offset + (p - begin));
+            }
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            if (!newline)
+            {
+                line_start = false;
+                break;
+            }
+            p = newline + 1;
+            line_start = true;
+            mIndexedSize = chunk_offset + (p - begin);
+        }
+        chunk_offset += bytes_read;
+    }
+
+    // A last line without its end yet is indexed once it is complete
+    while (!mOffsets.empty() && mOffsets.back() >= mIndexedSize)
+    {
+        mOffsets.pop_back();
+    }
+}
+
+bool LLTranscriptIndex::writeIndex(size_t first_new, bool rewrite)
+{
+    Header header;
+    header.mMagic = INDEX_MAGIC;
+    header.mVersion = INDEX_VERSION;
+    header.mIndexedSize = mIndexedSize;
+    header.mHeadHash = mHeadHash;
+    header.mHeadSize = mHeadSize;
+    header.mPad = 0;
+    header.mMessageCount = getMessageCount();
+
+    // Only append the new offsets, then the header that counts them. The
+    // mapped ones are all older.
+    if (!rewrite)
+    {
+        LLFILE* file = LLFile::fopen(mIndexFilename, "r+b");
+        if (file)
+        {
+            const size_t new_count = getMessageCount() - first_new;
+            bool success = seek(file, sizeof(Header) + first_new * sizeof(U64))
+                && fwrite(mOffsets.data() + (first_new - mMappedCount), sizeof(U64), new_count, file) == new_count
+                && fflush(file) == 0
+                && seek(file, 0)
+                && fwrite(&header, sizeof(header), 1, file) == 1;
+            success = (LLFile::close(file) == 0) && success;
+            if (success)
+            {
+                return true;
+            }
+        }
+    }
+
+    // The whole index goes to a new file, which must not replace a mapped one
+    if (mMappedCount)
+    {
+        mOffsets.insert(mOffsets.begin(), mMappedOffsets, mMappedOffsets + mMappedCount);
+        mMappedOffsets = nullptr;
+        mMappedCount = 0;
+    }
+    mFile.close();
+
+    const std::string temp_filename = mIndexFilename + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_filename, "wb");
+    if (!file)
+    {
+        LL_WARNS("ChatHistory") << "Unable to create transcript index " << temp_filename << LL_ENDL;
+        return false;
+    }
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(mOffsets.data(), sizeof(U64), mOffsets.size(), file) == mOffsets.size();
+    success = (LLFile::close(file) == 0) && success;
+    if (!success || LLFile::rename(temp_filename, mIndexFilename) != 0)
+    {
+        LL_WARNS("ChatHistory") << "Unable to write transcript index " << mIndexFilename << LL_ENDL;
+        LLFile::remove(temp_filename, ENOENT);
+        return false;
+    }
+    return true;
+}
+
+bool LLTranscriptIndex::readMessages(size_t first, size_t count, std::vector<std::string>& lines) const
+{
+    lines.clear();
+    const size_t message_count = getMessageCount();
+    if (first >= message_count || !count)
+    {
+        return first <= message_count;
+    }
+
+    const U64 begin = getMessageOffset(first);
+    const U64 end = count < message_count - first ? getMessageOffset(first + count) : mIndexedSize;
+    if (begin > end || end > mIndexedSize)
+    {
+        // a damaged index file
+        return false;
+    }
+    LLFILE* log = LLFile::fopen(mLogFilename, "rb");
+    if (!log)
+    {
+        return false;
+    }
+    std::string text((size_t)(end - begin), '\0');
+    bool success = read_at(log, begin, text.data(), text.size());
+    LLFile::close(log);
+    if (!success)
+    {
+        return false;
+    }
+
+    size_t line_begin = 0;
+    while (line_begin < text.size())
+    {
+        size_t line_end = text.find('\n', line_begin);
+        if (line_end == std::string::npos)
+        {
+            line_end = text.size();
+        }
+        size_t trimmed_end = line_end;
+        while (trimmed_end > line_begin && text[trimmed_end - 1] == '\r')
+        {
+            --trimmed_end;
+        }
+        lines.emplace_back(text, line_begin, trimmed_end - line_begin);
+        line_begin = line_end + 1;
+    }
+    return true;
+}
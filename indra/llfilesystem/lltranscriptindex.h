@@ -0,0 +1,101 @@
+/**
+ * @file lltranscriptindex.h
+ * @brief Message offset index of chat transcript files.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTRANSCRIPTINDEX_H
+#define LL_LLTRANSCRIPTINDEX_H
+
+#include "llfile.h"
+#include "llmappedfile.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * The offset of every message of a chat transcript, the plain text file
+ * LLLogChat appends one message per line to. Lines starting with a space,
+ * and empty lines, continue the message before them, as in
+ * LLLogChat::loadChatHistory().
+ *
+ * The transcript stays the only copy of the messages: the index is kept in
+ * a file of its own, and update() only reads what was appended to the
+ * transcript since. A transcript rewritten or cut short is indexed again.
+ * The offsets in the index file are mapped rather than read, so that the
+ * last messages of a long transcript are found without going through all
+ * of them.
+ */
+class LLTranscriptIndex
+{
+    public:
+        LLTranscriptIndex(const std::string& log_filename, const std::string& index_filename);
+
+        /**
+         * Bring the index up to date with the transcript, and its file with
+         * the index. Returns false when the transcript cannot be read, the
+         * index is then empty.
+         */
+        bool update();
+
+        /**
+         * Number of messages, up to the last complete line of the
+         * transcript when update() was called.
+         */
+        size_t getMessageCount() const { return mMappedCount + mOffsets.size(); }
+        U64 getMessageOffset(size_t message) const
+        {
+            return message < mMappedCount ? mMappedOffsets[message] : mOffsets[message - mMappedCount];
+        }
+        U64 getIndexedSize() const { return mIndexedSize; }
+
+        /**
+         * The lines of messages [first, first + count), continuation lines
+         * included, as they are in the transcript but without line ends.
+         */
+        bool readMessages(size_t first, size_t count, std::vector<std::string>& lines) const;
+
+        const std::string& getLogFilename() const { return mLogFilename; }
+
+    private:
+        struct Header;
+
+        bool readIndex(U64 log_size);
+        void scan(LLFILE* log, U64 log_size);
+        bool writeIndex(size_t first_new, bool rewrite);
+        void clear();
+
+        std::string mLogFilename;
+        std::string mIndexFilename;
+        LLMappedFile mFile;
+        const U64* mMappedOffsets{ nullptr };
+        size_t mMappedCount{ 0 };
+        // Offsets of the messages after the mapped ones
+        std::vector<U64> mOffsets;
+        U64 mIndexedSize{ 0 };
+        // Hash of the first mHeadSize bytes, to notice a rewritten transcript
+        U64 mHeadHash{ 0 };
+        U32 mHeadSize{ 0 };
+};
+
+#endif // LL_LLTRANSCRIPTINDEX_H
@@ -0,0 +1,306 @@
+/**
+ * @file lldiskcacheindex_test.cpp
+ * @date 2024-10
+ * @brief LLDiskCacheIndex test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../lldiskcacheindex.h"
+
+#include "lltut.h"
+#include "namedtempfile.h"
+#include "stringize.h"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+
+namespace
+{
+    LLUUID make_id(U32 n)
+    {
+        LLUUID id;
+        memcpy(id.mData, &n, sizeof(n));
+        id.mData[UUID_BYTES - 1] = 0xff;
+        return id;
+    }
+}
+
+namespace tut
+{
+    struct LLDiskCacheIndexFixture
+    {
+        LLDiskCacheIndexFixture():
+            mPath(NamedTempFile::temp_path("lldiskcacheindex_"))
+        {
+            boost::filesystem::create_directories(mPath);
+        }
+
+        ~LLDiskCacheIndexFixture()
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove_all(mPath, ec);
+        }
+
+        std::string dir() const { return mPath.string(); }
+        std::string journal() const { return (mPath / "cache_index.journal").string(); }
+
+        boost::filesystem::path mPath;
+    };
+    typedef test_group<LLDiskCacheIndexFixture> LLDiskCacheIndex_factory;
+    typedef LLDiskCacheIndex_factory::object LLDiskCacheIndex_t;
+    LLDiskCacheIndex_factory tf("LLDiskCacheIndex");
+
+    template<> template<>
+    void LLDiskCacheIndex_t::test<1>()
+    {
+        set_test_name("journal replay");
+
+        {
+            LLDiskCacheIndex index(dir());
+            ensure("empty directory loads as needing a rebuild", !index.load());
+            for (U32 i = 0; i < 100; ++i)
+            {
+                index.recordWrite(make_id(i), 10, 1000 + i);
+            }
+            index.recordRemove(make_id(5));
+            index.recordRename(make_id(1), make_id(500));
+            index.recordWrite(make_id(2), 30, 1002);
+            ensure_equals("size before reload", index.getTotalSize(), 1010u);
+        }
+
+        LLDiskCacheIndex index(dir());
+        ensure("journal loads cleanly", index.load());
+        ensure_equals("entries after reload", index.getEntryCount(), 99u);
+        ensure_equals("size after reload", index.getTotalSize(), 1010u);
+
+        LLDiskCacheIndex::Entry entry;
+        ensure("removed entry is gone", !index.getEntry(make_id(5), entry));
+        ensure("renamed entry is gone", !index.getEntry(make_id(1), entry));
+        ensure("renamed entry exists", index.getEntry(make_id(500), entry));
+        ensure_equals("renamed entry keeps its access time", entry.mLastAccess, 1001);
+        ensure("rewritten entry exists", index.getEntry(make_id(2), entry));
+        ensure_equals("rewritten entry size", entry.mSize, 30u);
+    }
+
+    template<> template<>
+    void LLDiskCacheIndex_t::test<2>()
+    {
+        set_test_name("torn journal record");
+
+        {
+            LLDiskCacheIndex index(dir());
+            index.load();
+            index.recordWrite(make_id(1), 10, 1000);
+            index.recordWrite(make_id(2), 20, 1000);
+        }
+
+        // simulate a crash half way through appending a record
+        LLFILE* file = LLFile::fopen(journal(), "ab");
+        ensure("reopen journal", file != nullptr);
+        fwrite("\x01garbage", 1, 8, file);
+        LLFile::close(file);
+
+        {
+            LLDiskCacheIndex index(dir());
+            ensure("torn journal asks for a rebuild", !index.load());
+            ensure_equals("complete records are kept", index.getEntryCount(), 2u);
+            ensure_equals("size of complete records", index.getTotalSize(), 30u);
+            index.recordWrite(make_id(3), 40, 1000);
+        }
+
+        LLDiskCacheIndex index(dir());
+        ensure("recovered index loads cleanly", index.load());
+        ensure_equals("records after recovery", index.getEntryCount(), 3u);
+        ensure_equals("size after recovery", index.getTotalSize(), 70u);
+    }
+
+    template<> template<>
+    void LLDiskCacheIndex_t::test<3>()
+    {
+        set_test_name("compaction");
+
+        {
+            LLDiskCacheIndex index(dir());
+            index.load();
+            for (U32 i = 0; i < 1000; ++i)
+            {
+                index.recordWrite(make_id(i % 10), i, 1000 + i);
+            }
+            ensure_equals("journal records", index.getJournalRecordCount(), 1000u);
+            ensure("compact", index.compact());
+            ensure_equals("journal is empty after compaction", index.getJournalRecordCount(), 0u);
+        }
+
+        LLDiskCacheIndex index(dir());
+        ensure("snapshot loads cleanly", index.load());
+        ensure_equals("nothing to replay", index.getJournalRecordCount(), 0u);
+        ensure_equals("entries from snapshot", index.getEntryCount(), 10u);
+        // the last write of each id wins: sizes 990 to 999
+        ensure_equals("size from snapshot", index.getTotalSize(), 9945u);
+    }
+
+    template<> template<>
+    void LLDiskCacheIndex_t::test<4>()
+    {
+        set_test_name("eviction order");
+
+        LLDiskCacheIndex index(dir());
+        index.load();
+        for (U32 i = 0; i < 10; ++i)
+        {
+            index.recordWrite(make_id(i), 100, 1000 + i);
+        }
+        // reads inside the threshold don't move an entry, reads past it do
+        index.recordAccess(make_id(0), 1000 + 10);
+        index.recordAccess(make_id(1), 1001 + LLDiskCacheIndex::ACCESS_TIME_THRESHOLD + 1);
+
+        LLDiskCacheIndex::entry_list_t candidates, skipped;
+        index.collectEvictionCandidates(700,
+                                        [](const LLUUID& id) { return id == make_id(2); },
+                                        candidates, skipped);
+        ensure_equals("candidates", candidates.size(), 3u);
+        ensure_equals("skipped", skipped.size(), 1u);
+        ensure("oldest first", candidates[0].first == make_id(0));
+        ensure("accessed entry is not evicted", candidates[1].first == make_id(3));
+        ensure("skipped entry", skipped[0].first == make_id(2));
+
+        index.recordWrite(make_id(4), 50, 2000);
+        for (const auto& candidate : candidates)
+        {
+            index.removeIfUnchanged(candidate.first, candidate.second);
+        }
+        LLDiskCacheIndex::Entry entry;
+        ensure("rewritten candidate survives", index.getEntry(make_id(4), entry));
+        ensure_equals("size after eviction", index.getTotalSize(), 750u);
+    }
+
+    template<> template<>
+    void LLDiskCacheIndex_t::test<5>()
+    {
+        set_test_name("purge benchmark");
+
+        // Creating a realistic cache takes a while, so this only runs on request:
+        // LL_DISKCACHE_BENCHMARK_FILES=100000
+        const char* env = getenv("LL_DISKCACHE_BENCHMARK_FILES");
+        const U32 file_count = env ? (U32)atoi(env) : 0;
+        if (!file_count)
+        {
+            skip("set LL_DISKCACHE_BENCHMARK_FILES to run the purge benchmark");
+        }
+
+        // Same layout as LLDiskCache: 16 subdirectories by first hex digit
+        const std::string payload(1024, 'x');
+        {
+            LLDiskCacheIndex index(dir());
+            index.load();
+            for (U32 i = 0; i < file_count; ++i)
+            {
+                LLUUID id;
+                id.generate();
+                const std::string id_string = id.asString();
+                const boost::filesystem::path subdir = mPath / id_string.substr(0, 1);
+                boost::filesystem::create_directories(subdir);
+                const std::string file_path = (subdir / ("sl_cache_" + id_string + "_0.asset")).string();
+                LLFILE* file = LLFile::fopen(file_path, "wb");
+                fwrite(payload.data(), 1, payload.size(), file);
+                LLFile::close(file);
+                index.recordWrite(id, payload.size(), 1000 + i);
+            }
+            index.compact();
+        }
+
+        // Evict the oldest 10% of the cache
+        const uintmax_t target_size = (uintmax_t)file_count * payload.size() * 9 / 10;
+        typedef std::chrono::high_resolution_clock clock;
+
+        // What LLDiskCache::purge() used to do before it could delete anything
+        clock::time_point start = clock::now();
+        typedef std::pair<std::time_t, std::pair<uintmax_t, std::string>> file_info_t;
+        std::vector<file_info_t> file_info;
+        uintmax_t scanned_size = 0;
+        boost::system::error_code ec;
+        boost::filesystem::recursive_directory_iterator iter(mPath, ec);
+        while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed()
+                && (*iter).path().string().find("sl_cache") != std::string::npos)
+            {
+                uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
+                std::time_t file_time = boost::filesystem::last_write_time(*iter, ec);
+                scanned_size += file_size;
+                file_info.push_back(file_info_t(file_time, { file_size, (*iter).path().string() }));
+            }
+            iter.increment(ec);
+        }
+        std::sort(file_info.begin(), file_info.end(), [](file_info_t& x, file_info_t& y)
+        {
+            return x.first < y.first;
+        });
+        size_t scanned_victims = 0;
+        for (uintmax_t remaining = scanned_size; remaining > target_size; ++scanned_victims)
+        {
+            remaining -= file_info[scanned_victims].second.first;
+        }
+        const auto scan_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+
+        start = clock::now();
+        LLDiskCacheIndex index(dir());
+        ensure("benchmark index loads", index.load());
+        const auto load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+
+        start = clock::now();
+        LLDiskCacheIndex::entry_list_t candidates, skipped;
+        index.collectEvictionCandidates(target_size, LLDiskCacheIndex::skip_func_t(), candidates, skipped);
+        const auto index_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+
+        ensure_equals("scanner saw every file", file_info.size(), (size_t)file_count);
+        ensure_equals("same number of victims", candidates.size(), scanned_victims);
+
+        std::cout << "\nLLDiskCache purge over " << file_count << " files, evicting " << candidates.size() << ":\n"
+                  << "  directory scan + sort: " << scan_ms << " ms\n"
+                  << "  index load at startup: " << load_ms << " ms\n"
+                  << "  index eviction pass:   " << index_us << " us" << std::endl;
+    }
+
+    template<> template<>
+    void LLDiskCacheIndex_t::test<6>()
+    {
+        set_test_name("rebuild alongside writes");
+
+        LLDiskCacheIndex index(dir());
+        index.load();
+        index.reset();
+        // written while the scan runs, the scan then finds an older copy
+        index.recordWrite(make_id(1), 50, 2000);
+        index.recordScanned(make_id(1), 10, 1000);
+        index.recordScanned(make_id(2), 20, 1000);
+
+        LLDiskCacheIndex::Entry entry;
+        ensure("written entry exists", index.getEntry(make_id(1), entry));
+        ensure_equals("scan keeps the newer size", entry.mSize, 50u);
+        ensure_equals("scan keeps the newer access time", entry.mLastAccess, 2000);
+        ensure("scanned entry exists", index.getEntry(make_id(2), entry));
+        ensure_equals("size after scan", index.getTotalSize(), 70u);
+    }
+}
@@ -0,0 +1,261 @@
+/**
+ * @file llpackedassetstore_test.cpp
+ * @date 2024-10
+ * @brief LLPackedAssetStore test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llpackedassetstore.h"
+
+#include "lltut.h"
+#include "namedtempfile.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+namespace
+{
+    LLUUID make_id(U32 n)
+    {
+        LLUUID id;
+        memcpy(id.mData, &n, sizeof(n));
+        id.mData[UUID_BYTES - 1] = 0xff;
+        return id;
+    }
+}
+
+namespace tut
+{
+    struct LLPackedAssetStoreFixture
+    {
+        LLPackedAssetStoreFixture():
+            mPath(NamedTempFile::temp_path("llpackedassetstore_"))
+        {
+        }
+
+        ~LLPackedAssetStoreFixture()
+        {
+            LLPackedAssetStore::deleteSingleton();
+            boost::system::error_code ec;
+            boost::filesystem::remove_all(mPath, ec);
+        }
+
+        LLPackedAssetStore& reopen()
+        {
+            LLPackedAssetStore::deleteSingleton();
+            return LLPackedAssetStore::initParamSingleton(mPath.string());
+        }
+
+        boost::filesystem::path mPath;
+    };
+    typedef test_group<LLPackedAssetStoreFixture> LLPackedAssetStore_factory;
+    typedef LLPackedAssetStore_factory::object LLPackedAssetStore_t;
+    LLPackedAssetStore_factory tf("LLPackedAssetStore");
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<1>()
+    {
+        set_test_name("write, read and reload");
+
+        LLPackedAssetStore* store = &reopen();
+        for (U32 i = 0; i < 100; ++i)
+        {
+            U8 data[] = { 1, 2, 3, 4, (U8)i };
+            ensure_equals("write", store->write(make_id(i), LLAssetType::AT_TEXTURE, 0, data, sizeof(data), true), 5);
+        }
+
+        U8 buffer[16];
+        ensure_equals("read", store->read(make_id(3), LLAssetType::AT_TEXTURE, 0, buffer, sizeof(buffer)), 5);
+        ensure_equals("read data", buffer[4], 3);
+        ensure("other asset type", !store->exists(make_id(3), LLAssetType::AT_SOUND));
+
+        LLPackedAssetStore::BlobRef blob = store->get(make_id(7), LLAssetType::AT_TEXTURE);
+        ensure("blob view", bool(blob));
+        ensure_equals("blob size", blob.size(), 5);
+        ensure_equals("blob data", blob.data()[4], 7);
+
+        store = &reopen();
+        ensure_equals("assets after reload", store->getAssetCount(), 100u);
+        ensure_equals("read after reload", store->read(make_id(99), LLAssetType::AT_TEXTURE, 4, buffer, sizeof(buffer)), 1);
+        ensure_equals("data after reload", buffer[0], 99);
+        ensure("blob outlives the store", blob.data()[4] == 7);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<2>()
+    {
+        set_test_name("partial writes, rename and remove");
+
+        LLPackedAssetStore* store = &reopen();
+        const U8 data[] = { 1, 2, 3, 4, 5 };
+        const U8 more[] = { 9, 9, 9 };
+        store->write(make_id(1), LLAssetType::AT_TEXTURE, 0, data, sizeof(data), true);
+        ensure_equals("append", store->write(make_id(1), LLAssetType::AT_TEXTURE, 5, more, sizeof(more), false), 8);
+        ensure_equals("overwrite in the middle", store->write(make_id(1), LLAssetType::AT_TEXTURE, 1, more, 1, false), 8);
+        ensure_equals("truncate", store->write(make_id(2), LLAssetType::AT_TEXTURE, 0, data, 2, true), 2);
+
+        ensure("rename", store->rename(make_id(1), LLAssetType::AT_TEXTURE, make_id(3), LLAssetType::AT_SOUND));
+        ensure("renamed from", !store->exists(make_id(1), LLAssetType::AT_TEXTURE));
+        ensure_equals("renamed size", store->getSize(make_id(3), LLAssetType::AT_SOUND), 8);
+
+        ensure("remove", store->remove(make_id(2), LLAssetType::AT_TEXTURE));
+        ensure("removed", !store->exists(make_id(2), LLAssetType::AT_TEXTURE));
+        ensure("remove missing", !store->remove(make_id(2), LLAssetType::AT_TEXTURE));
+
+        // static assets are stored untyped and found under any type
+        store->write(make_id(4), LLAssetType::AT_UNKNOWN, 0, data, sizeof(data), true);
+        ensure("untyped asset", store->exists(make_id(4), LLAssetType::AT_ANIMATION));
+        ensure("remove all types", store->removeAllTypes(make_id(4)));
+
+        store = &reopen();
+        U8 buffer[8];
+        ensure_equals("read renamed", store->read(make_id(3), LLAssetType::AT_SOUND, 0, buffer, sizeof(buffer)), 8);
+        const U8 expected[] = { 1, 9, 3, 4, 5, 9, 9, 9 };
+        ensure("merged data", memcmp(buffer, expected, sizeof(expected)) == 0);
+        ensure_equals("assets after reload", store->getAssetCount(), 1u);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<3>()
+    {
+        set_test_name("compaction");
+
+        LLPackedAssetStore* store = &reopen();
+        // enough to roll over into a second segment
+        std::vector<U8> data(1024 * 1024);
+        for (U32 i = 0; i < 70; ++i)
+        {
+            data[0] = (U8)i;
+            store->write(make_id(i), LLAssetType::AT_TEXTURE, 0, data.data(), (S32)data.size(), true);
+        }
+        ensure_equals("segments", store->getSegmentCount(), 2u);
+
+        LLPackedAssetStore::BlobRef held = store->get(make_id(1), LLAssetType::AT_TEXTURE);
+        for (U32 i = 0; i < 60; ++i)
+        {
+            store->remove(make_id(i), LLAssetType::AT_TEXTURE);
+        }
+        store->compact();
+        ensure_equals("dead segment removed", store->getSegmentCount(), 1u);
+        ensure_equals("held blob still readable", held.data()[0], 1);
+
+        U8 first;
+        ensure_equals("moved asset", store->read(make_id(65), LLAssetType::AT_TEXTURE, 0, &first, 1), 1);
+        ensure_equals("moved asset data", first, 65);
+
+        store = &reopen();
+        ensure_equals("assets after compaction", store->getAssetCount(), 10u);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<4>()
+    {
+        set_test_name("chunked appends extend the record in place");
+
+        LLPackedAssetStore* store = &reopen();
+        std::vector<U8> chunk(1000);
+        const S32 chunks = 1000;
+        for (S32 i = 0; i < chunks; ++i)
+        {
+            std::fill(chunk.begin(), chunk.end(), (U8)i);
+            ensure_equals("append", store->write(make_id(1), LLAssetType::AT_TEXTURE, i * 1000, chunk.data(), 1000, false), (i + 1) * 1000);
+        }
+        // Rewriting the asset for every chunk would have taken 500 MB and
+        // several segments
+        ensure_equals("segments", store->getSegmentCount(), 1u);
+        boost::system::error_code ec;
+        ensure("segment size", boost::filesystem::file_size(mPath / "segment_00000001.pack", ec) < 1024 * 1024 + 1024);
+
+        LLPackedAssetStore::BlobRef held = store->get(make_id(1), LLAssetType::AT_TEXTURE);
+        U8 gap_end = 7;
+        ensure_equals("append past the end", store->write(make_id(1), LLAssetType::AT_TEXTURE, chunks * 1000 + 10, &gap_end, 1, false), chunks * 1000 + 11);
+        ensure_equals("held blob keeps its size", held.size(), chunks * 1000);
+
+        // Not the last record any more: falls back to a rewrite
+        store->write(make_id(2), LLAssetType::AT_TEXTURE, 0, chunk.data(), 10, true);
+        ensure_equals("append to an older record", store->write(make_id(1), LLAssetType::AT_TEXTURE, chunks * 1000 + 11, &gap_end, 1, false), chunks * 1000 + 12);
+
+        store = &reopen();
+        U8 buffer[12];
+        ensure_equals("size after reload", store->getSize(make_id(1), LLAssetType::AT_TEXTURE), chunks * 1000 + 12);
+        ensure_equals("read after reload", store->read(make_id(1), LLAssetType::AT_TEXTURE, (chunks - 1) * 1000 + 998, buffer, sizeof(buffer)), 12);
+        const U8 expected[] = { 231, 231, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        ensure("last chunk and gap", memcmp(buffer, expected, 12) == 0);
+        U8 last[2];
+        store->read(make_id(1), LLAssetType::AT_TEXTURE, chunks * 1000 + 10, last, 2);
+        ensure("appended bytes", last[0] == 7 && last[1] == 7);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<5>()
+    {
+        set_test_name("no segment can be created");
+
+        LLPackedAssetStore* store = &reopen();
+        const U8 data[] = { 1, 2, 3 };
+        store->write(make_id(1), LLAssetType::AT_TEXTURE, 0, data, sizeof(data), true);
+
+        // A file where the store folder should be stops segments from
+        // being created, even with administrator rights
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(mPath, ec);
+        std::ofstream(mPath.string()) << "in the way";
+        store->clear();
+        ensure_equals("no segment", store->getSegmentCount(), 0u);
+        ensure_equals("write fails", store->write(make_id(1), LLAssetType::AT_TEXTURE, 0, data, sizeof(data), true), -1);
+        ensure("nothing stored", !store->get(make_id(1), LLAssetType::AT_TEXTURE));
+        store->compact();
+
+        boost::filesystem::remove(mPath, ec);
+        boost::filesystem::create_directory(mPath, ec);
+        ensure_equals("write once the folder is back", store->write(make_id(1), LLAssetType::AT_TEXTURE, 0, data, sizeof(data), true), 3);
+        ensure_equals("segment", store->getSegmentCount(), 1u);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<6>()
+    {
+        set_test_name("empty assets");
+
+        LLPackedAssetStore* store = &reopen();
+        ensure_equals("write", store->write(make_id(1), LLAssetType::AT_NOTECARD, 0, nullptr, 0, true), 0);
+        ensure("exists", store->exists(make_id(1), LLAssetType::AT_NOTECARD));
+        ensure_equals("size", store->getSize(make_id(1), LLAssetType::AT_NOTECARD), 0);
+        LLPackedAssetStore::BlobRef blob = store->get(make_id(1), LLAssetType::AT_NOTECARD);
+        ensure("blob", bool(blob));
+        ensure_equals("blob size", blob.size(), 0);
+
+        // roll over so that the asset ends up in a full segment
+        std::vector<U8> data(1024 * 1024);
+        for (U32 i = 2; i < 70; ++i)
+        {
+            store->write(make_id(i), LLAssetType::AT_TEXTURE, 0, data.data(), (S32)data.size(), true);
+        }
+        ensure_equals("segments", store->getSegmentCount(), 2u);
+        ensure("blob from a full segment", bool(store->get(make_id(1), LLAssetType::AT_NOTECARD)));
+
+        store = &reopen();
+        ensure("exists after reload", store->exists(make_id(1), LLAssetType::AT_NOTECARD));
+    }
+}
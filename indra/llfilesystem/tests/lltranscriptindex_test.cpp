@@ -0,0 +1,292 @@
+/**
+ * @file lltranscriptindex_test.cpp
+ * @date 2024-11
+ * @brief LLTranscriptIndex test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../lltranscriptindex.h"
+
+#include "lltut.h"
+#include "namedtempfile.h"
+#include "stringize.h"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+
+namespace
+{
+    void append(const std::string& filename, const std::string& text)
+    {
+        LLFILE* file = LLFile::fopen(filename, "ab");
+        fwrite(text.data(), 1, text.size(), file);
+        LLFile::close(file);
+    }
+
+    void write(const std::string& filename, const std::string& text)
+    {
+        LLFile::remove(filename, ENOENT);
+        append(filename, text);
+    }
+
+    // A line as LLLogChat::saveHistory() writes them
+    std::string chat_line(U32 n)
+    {
+        static const char* words[] = { "hello", "there", "sim", "crossing", "lag", "party", "tonight", "sandbox", "prim", "mesh" };
+        std::string line = STRINGIZE("[2024/11/" << (1 + n % 28) << " " << (n / 60 % 24) << ":" << (n % 60) << "]  Resident" << n % 97 << ":");
+        for (U32 i = 0; i < 6 + n % 10; ++i)
+        {
+            line += ' ';
+            line += words[(n * 7 + i * 3) % 10];
+        }
+        return line + "\n";
+    }
+}
+
+namespace tut
+{
+    struct LLTranscriptIndexFixture
+    {
+        LLTranscriptIndexFixture():
+            mPath(NamedTempFile::temp_path("lltranscriptindex_"))
+        {
+            boost::filesystem::create_directories(mPath);
+        }
+
+        ~LLTranscriptIndexFixture()
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove_all(mPath, ec);
+        }
+
+        std::string log(const std::string& name = "chat") const { return (mPath / (name + ".txt")).string(); }
+        std::string index_file(const std::string& name = "chat") const { return (mPath / (name + ".idx")).string(); }
+
+        boost::filesystem::path mPath;
+    };
+    typedef test_group<LLTranscriptIndexFixture> LLTranscriptIndex_factory;
+    typedef LLTranscriptIndex_factory::object LLTranscriptIndex_t;
+    LLTranscriptIndex_factory tf("LLTranscriptIndex");
+
+    template<> template<>
+    void LLTranscriptIndex_t::test<1>()
+    {
+        set_test_name("messages and continuation lines");
+
+        write(log(), "[10:00]  Alice: hi\n"
+                     "[10:01]  Bob: two\r\n"
+                     " lines\n"
+                     "\n"
+                     "[10:02]  Alice: bye\n"
+                     "[10:03]  Bob: not finished");
+
+        LLTranscriptIndex index(log(), index_file());
+        ensure("indexed", index.update());
+        ensure_equals("complete messages", index.getMessageCount(), 3u);
+        ensure_equals("second message", index.getMessageOffset(1), 19u);
+
+        std::vector<std::string> lines;
+        ensure("read", index.readMessages(1, 2, lines));
+        ensure_equals("lines", lines.size(), 4u);
+        ensure_equals("line end", lines[0], "[10:01]  Bob: two");
+        ensure_equals("continuation", lines[1], " lines");
+        ensure_equals("empty line", lines[2], "");
+        ensure_equals("last", lines[3], "[10:02]  Alice: bye");
+
+        ensure("read past the end", index.readMessages(2, 10, lines));
+        ensure_equals("clamped", lines.size(), 1u);
+        ensure("read nothing", index.readMessages(3, 1, lines) && lines.empty());
+
+        // the last line is indexed once it is complete
+        append(log(), "\n");
+        ensure("updated", index.update());
+        ensure_equals("finished line", index.getMessageCount(), 4u);
+
+        ensure("missing transcript", !LLTranscriptIndex(log("missing"), index_file("missing")).update());
+    }
+
+    template<> template<>
+    void LLTranscriptIndex_t::test<2>()
+    {
+        set_test_name("appends reuse the index file");
+
+        std::string text;
+        for (U32 i = 0; i < 100; ++i)
+        {
+            text += chat_line(i);
+        }
+        write(log(), text);
+        {
+            LLTranscriptIndex index(log(), index_file());
+            ensure("indexed", index.update());
+            ensure_equals("messages", index.getMessageCount(), 100u);
+        }
+
+        append(log(), chat_line(100) + chat_line(101));
+        LLTranscriptIndex index(log(), index_file());
+        ensure("updated", index.update());
+        ensure_equals("appended messages", index.getMessageCount(), 102u);
+        ensure_equals("indexed size", index.getIndexedSize(), (U64)boost::filesystem::file_size(log()));
+
+        std::vector<std::string> lines;
+        ensure("read", index.readMessages(101, 1, lines));
+        ensure_equals("last message", lines[0] + "\n", chat_line(101));
+
+        // the file holds what was appended
+        LLTranscriptIndex reread(log(), index_file());
+        ensure("reread", reread.update());
+        ensure_equals("reread messages", reread.getMessageCount(), 102u);
+        ensure_equals("reread offset", reread.getMessageOffset(101), index.getMessageOffset(101));
+    }
+
+    template<> template<>
+    void LLTranscriptIndex_t::test<3>()
+    {
+        set_test_name("rewritten and damaged transcripts are indexed again");
+
+        write(log(), chat_line(1) + chat_line(2) + chat_line(3));
+        {
+            LLTranscriptIndex index(log(), index_file());
+            ensure("indexed", index.update());
+        }
+
+        // shorter
+        write(log(), chat_line(4));
+        {
+            LLTranscriptIndex index(log(), index_file());
+            ensure("shorter", index.update());
+            ensure_equals("shorter messages", index.getMessageCount(), 1u);
+        }
+
+        // as long, other text
+        write(log(), chat_line(7) + chat_line(8) + chat_line(9) + chat_line(10));
+        {
+            LLTranscriptIndex index(log(), index_file());
+            ensure("rewritten", index.update());
+            ensure_equals("rewritten messages", index.getMessageCount(), 4u);
+            std::vector<std::string> lines;
+            ensure("read", index.readMessages(0, 1, lines));
+            ensure_equals("first message", lines[0] + "\n", chat_line(7));
+        }
+
+        // garbage index
+        write(index_file(), "not an index");
+        LLTranscriptIndex index(log(), index_file());
+        ensure("damaged", index.update());
+        ensure_equals("damaged messages", index.getMessageCount(), 4u);
+    }
+
+    template<> template<>
+    void LLTranscriptIndex_t::test<4>()
+    {
+        set_test_name("transcript load benchmark");
+
+        // Writing a realistic corpus takes a while, so this only runs on request:
+        // LL_TRANSCRIPT_BENCHMARK_MB=1024
+        const char* env = getenv("LL_TRANSCRIPT_BENCHMARK_MB");
+        const U64 corpus_size = env ? (U64)atoi(env) * 1024 * 1024 : 0;
+        if (!corpus_size)
+        {
+            skip("set LL_TRANSCRIPT_BENCHMARK_MB to run the transcript benchmark");
+        }
+
+        // A few long conversations and many short ones
+        constexpr U32 TRANSCRIPTS = 64;
+        std::vector<std::string> names;
+        U64 written = 0;
+        U32 line_number = 0;
+        for (U32 t = 0; t < TRANSCRIPTS; ++t)
+        {
+            names.push_back(STRINGIZE("conversation" << t));
+            const U64 size = t < 4 ? corpus_size / 8 : corpus_size / 2 / (TRANSCRIPTS - 4);
+            LLFILE* file = LLFile::fopen(log(names.back()), "wb");
+            std::string block;
+            for (U64 transcript_size = 0; transcript_size < size; )
+            {
+                block.clear();
+                while (block.size() < 64 * 1024)
+                {
+                    block += chat_line(line_number++);
+                }
+                fwrite(block.data(), 1, block.size(), file);
+                transcript_size += block.size();
+                written += block.size();
+            }
+            LLFile::close(file);
+        }
+
+        typedef std::chrono::high_resolution_clock clock;
+        auto ms_since = [](clock::time_point start)
+        {
+            return std::chrono::duration<F64, std::milli>(clock::now() - start).count();
+        };
+
+        // What loading a whole history reads, before parsing any line
+        clock::time_point start = clock::now();
+        U64 lines = 0;
+        char buffer[20480];
+        for (const std::string& name : names)
+        {
+            LLFILE* file = LLFile::fopen(log(name), "rb");
+            while (fgets(buffer, sizeof(buffer), file))
+            {
+                ++lines;
+            }
+            LLFile::close(file);
+        }
+        const F64 read_ms = ms_since(start);
+
+        start = clock::now();
+        U64 messages = 0;
+        for (const std::string& name : names)
+        {
+            LLTranscriptIndex index(log(name), index_file(name));
+            index.update();
+            messages += index.getMessageCount();
+        }
+        const F64 build_ms = ms_since(start);
+        ensure_equals("every line indexed", messages, lines);
+
+        // Opening the largest conversation at its last page
+        start = clock::now();
+        LLTranscriptIndex index(log(names[0]), index_file(names[0]));
+        index.update();
+        std::vector<std::string> page;
+        index.readMessages(index.getMessageCount() - 100, 100, page);
+        const F64 open_ms = ms_since(start);
+        ensure_equals("last page", page.size(), 100u);
+
+        start = clock::now();
+        append(log(names[0]), chat_line(line_number++));
+        index.update();
+        const F64 append_ms = ms_since(start);
+
+        std::cout << "\nTranscripts of " << written / (1024 * 1024) << " MB, " << lines << " messages in "
+                  << TRANSCRIPTS << " files:\n"
+                  << "  read every line:           " << read_ms << " ms\n"
+                  << "  first index build:         " << build_ms << " ms\n"
+                  << "  open + last 100 messages:  " << open_ms << " ms\n"
+                  << "  append + update:           " << append_ms << " ms" << std::endl;
+    }
+}
@@ -42,6 +42,9 @@ LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl();
 LLImageCompressionTester* LLImageJ2C::sTesterp = NULL ;
 const std::string sTesterName("ImageCompressionTester");
 
+U32 LLImageJ2C::sDecodeThreadsPerImage = 1;
+U32 LLImageJ2C::sExtraDecodeThreadBudget = 0;
+
 //static
 std::string LLImageJ2C::getEngineInfo()
 {
@@ -51,6 +54,13 @@ std::string LLImageJ2C::getEngineInfo()
     return impl->getEngineInfo();
 }
 
+//static
+void LLImageJ2C::setDecodeThreads(U32 per_image, U32 extra_budget)
+{
+    sDecodeThreadsPerImage = llmax(per_image, 1U);
+    sExtraDecodeThreadBudget = extra_budget;
+}
+
 LLImageJ2C::LLImageJ2C() :  LLImageFormatted(IMG_CODEC_J2C),
                             mMaxBytes(0),
                             mRawDiscardLevel(-1),
@@ -78,6 +78,13 @@ public:
 
     static std::string getEngineInfo();
 
+    // Threads a single large image may use for decoding, and how many
+    // threads beyond their own all the decodes in flight may add.
+    // Engines without intra-image threading ignore this.
+    static void setDecodeThreads(U32 per_image, U32 extra_budget);
+    static U32 getDecodeThreadsPerImage() { return sDecodeThreadsPerImage; }
+    static U32 getExtraDecodeThreadBudget() { return sExtraDecodeThreadBudget; }
+
 protected:
     friend class LLImageJ2CImpl;
     friend class LLImageJ2COJ;
@@ -99,6 +106,9 @@ protected:
 
     // Image compression/decompression tester
     static LLImageCompressionTester* sTesterp;
+
+    static U32 sDecodeThreadsPerImage;
+    static U32 sExtraDecodeThreadBudget;
 };
 
 // Derive from this class to implement JPEG2000 decoding
@@ -67,7 +67,9 @@ private:
 LLImageDecodeThread::LLImageDecodeThread(bool /*threaded*/)
     : mDecodeCount(0)
 {
-    mThreadPool = std::make_unique<LL::ThreadPool>("ImageDecode", 8);
+    // <FS> many small decodes from several fetch threads: avoid one contended queue
+    mThreadPool = std::make_unique<LL::WorkStealingThreadPool>("ImageDecode", 8);
+    // </FS>
     mThreadPool->start();
 }
 
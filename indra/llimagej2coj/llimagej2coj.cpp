@@ -30,6 +30,11 @@
 // this is defined so that we get static linking.
 #include "openjpeg.h"
 
+#include "llforkjoin.h"
+
+#include <atomic>
+#include <memory>
+
 // Factory function: see declaration in llimagej2c.cpp
 LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl()
 {
@@ -101,6 +106,69 @@ int ceildivpow2(int a, int b)
     return (a + (1 << b) - 1) >> b;
 }
 
+// Pixels of the decoded image per decode thread: a 512x512 image gets
+// two threads and a 1024x1024 one up to eight, within the limits set by
+// LLImageJ2C::setDecodeThreads()
+constexpr U32 PIXELS_PER_DECODE_THREAD = 256 * 256 * 2;
+
+// Rows of the reduced image that fall in band out of bands. The bands start
+// on rows of the full image that are multiples of 2^discard_level, so that
+// their reduced rows add up to those of the whole image.
+static bool get_band_rows(const opj_image_t* image, U32 discard_level, U32 band, U32 bands, U32& first_row, U32& end_row)
+{
+    if (image->y0 != 0)
+    {
+        return false;
+    }
+    const U32 rows = ceildivpow2(image->y1, discard_level);
+    first_row = rows * band / bands;
+    end_row = rows * (band + 1) / bands;
+    return first_row < end_row;
+}
+
+// Threads added by all decodes in flight, beyond the decode pool's own
+static std::atomic<U32> sExtraDecodeThreads{ 0 };
+
+// Reserves extra decode threads for one image from the shared budget
+class DecodeThreadReservation
+{
+public:
+    DecodeThreadReservation(U32 width, U32 height)
+    {
+        U32 wanted = llmin(width * height / PIXELS_PER_DECODE_THREAD, LLImageJ2C::getDecodeThreadsPerImage());
+        if (wanted < 2)
+        {
+            return;
+        }
+
+        U32 budget = LLImageJ2C::getExtraDecodeThreadBudget();
+        U32 in_use = sExtraDecodeThreads.load(std::memory_order_relaxed);
+        U32 extra = 0;
+        do
+        {
+            extra = llmin(wanted - 1, budget > in_use ? budget - in_use : 0U);
+            if (!extra)
+            {
+                return;
+            }
+        } while (!sExtraDecodeThreads.compare_exchange_weak(in_use, in_use + extra, std::memory_order_relaxed));
+        mExtra = extra;
+    }
+
+    ~DecodeThreadReservation()
+    {
+        if (mExtra)
+        {
+            sExtraDecodeThreads.fetch_sub(mExtra, std::memory_order_relaxed);
+        }
+    }
+
+    U32 getThreads() const { return mExtra + 1; }
+
+private:
+    U32 mExtra = 0;
+};
+
 class JPEG2KBase
 {
 public:
@@ -378,10 +446,16 @@ public:
         return true;
     }
 
-    bool decode(U8* data, U32 dataSize, U32* channels, U8 discard_level)
+    // With bands > 1, only that band of the rows is decoded, see get_band_rows()
+    bool decode(U8* data, U32 dataSize, U32* channels, U8 discard_level, U32 band = 0, U32 bands = 1)
     {
         parameters.flags &= ~OPJ_DPARAMETERS_DUMP_FLAG;
 
+        // decoded before, as a band
+        if (decoder)
+        {
+            opj_destroy_codec(decoder);
+        }
         decoder = opj_create_decompress(OPJ_CODEC_J2K);
         opj_setup_decoder(decoder, &parameters);
 
@@ -434,6 +508,18 @@ public:
             *channels = image->numcomps;
         }
 
+        if (bands > 1)
+        {
+            U32 first_row = 0;
+            U32 end_row = 0;
+            if (!get_band_rows(image, discard_level, band, bands, first_row, end_row)
+                || !opj_set_decode_area(decoder, image, image->x0, first_row << discard_level,
+                                        image->x1, llmin(end_row << discard_level, image->y1)))
+            {
+                return false;
+            }
+        }
+
         OPJ_BOOL decoded = opj_decode(decoder, stream, image);
 
         // count was zero.  The latter is just a sanity check before we
@@ -781,6 +867,43 @@ private:
 };
 
 
+// Decodes the rows of a large image in bands, first into decoder and the
+// others into extra_bands, on the threads of the shared fork-join pool.
+// Their threads stay around between decodes.
+static bool decode_bands(U8* data, S32 max_bytes, U8 discard_level, U32 bands, U32* channels,
+                         JPEG2KDecode& decoder, std::vector<std::unique_ptr<JPEG2KDecode>>& extra_bands)
+{
+    std::vector<JPEG2KDecode*> decoders(1, &decoder);
+    for (U32 band = 1; band < bands; ++band)
+    {
+        extra_bands.emplace_back(std::make_unique<JPEG2KDecode>(0));
+        decoders.push_back(extra_bands.back().get());
+    }
+
+    std::vector<U32> band_channels(bands, 0);
+    std::unique_ptr<bool[]> decoded(new bool[bands]());
+    LLForkJoin fork_join("ImageDecodeBands");
+    fork_join.setMinParallelTasks(2);
+    for (U32 band = 0; band < bands; ++band)
+    {
+        fork_join.add([&, band]()
+        {
+            decoded[band] = decoders[band]->decode(data, max_bytes, &band_channels[band], discard_level, band, bands);
+        });
+    }
+    fork_join.run();
+
+    *channels = band_channels[0];
+    for (U32 band = 0; band < bands; ++band)
+    {
+        if (!decoded[band] || band_channels[band] != band_channels[0])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 LLImageJ2COJ::LLImageJ2COJ()
     : LLImageJ2CImpl()
 {
@@ -855,7 +978,19 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
     U32 image_channels = 0;
     S32 data_size = base.getDataSize();
     S32 max_bytes = (base.getMaxBytes() ? base.getMaxBytes() : data_size);
-    bool decoded = decoder.decode(base.getData(), max_bytes, &image_channels, base.mDiscardLevel);
+    // <FS> Large images are decoded in bands of rows, on several threads.
+    // Size from getMetadata(), zero when the header was not read yet.
+    S32 discard = llmax((S32)base.mDiscardLevel, 0);
+    DecodeThreadReservation threads(base.getWidth() >> discard, base.getHeight() >> discard);
+    std::vector<std::unique_ptr<JPEG2KDecode>> extra_bands;
+    bool decoded = threads.getThreads() > 1
+        && decode_bands(base.getData(), max_bytes, base.mDiscardLevel, threads.getThreads(), &image_channels, decoder, extra_bands);
+    if (!decoded)
+    {
+        extra_bands.clear();
+        decoded = decoder.decode(base.getData(), max_bytes, &image_channels, base.mDiscardLevel);
+    }
+    // </FS>
 
     // set correct channel count early so failed decodes don't miss it...
     S32 channels = (S32)image_channels - first_channel;
@@ -885,12 +1020,18 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
     // It is integer math so the formula is written in ceildivpo2.
     // (Assuming all the components have the same width, height and
     // factor.)
-    U32 comp_width = image->comps[0].w; // leave this unshifted by 'f' discard factor, the strides are always for the full buffer width
+    //U32 comp_width = image->comps[0].w; // leave this unshifted by 'f' discard factor, the strides are always for the full buffer width // <FS/> per band below
     U32 f = image->comps[0].factor;
 
     // do size the texture to the mem we'll acrually use...
     U32 width = image->comps[0].w;
     U32 height = image->comps[0].h;
+    // <FS> The bands are stacked
+    for (const std::unique_ptr<JPEG2KDecode>& band : extra_bands)
+    {
+        height += band->getImage()->comps[0].h;
+    }
+    // </FS>
 
     raw_image.resize(U16(width), U16(height), S8(channels));
 
@@ -908,20 +1049,51 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
     // first_channel is what channel to start copying from
     // dest is what channel to copy to.  first_channel comes from the
     // argument, dest always starts writing at channel zero.
+    // <FS> Raw images are stored bottom up: the last band goes first
+    std::vector<opj_image_t*> band_images;
+    for (auto it = extra_bands.rbegin(); it != extra_bands.rend(); ++it)
+    {
+        band_images.push_back((*it)->getImage());
+    }
+    band_images.push_back(image);
+    // </FS>
     for (S32 comp = first_channel, dest = 0; comp < first_channel + channels; comp++, dest++)
     {
-        llassert(image->comps[comp].data);
-        if (image->comps[comp].data)
+        // <FS>
+        //llassert(image->comps[comp].data);
+        //if (image->comps[comp].data)
+        bool has_data = true;
+        for (opj_image_t* band_image : band_images)
+        {
+            has_data = has_data && band_image->comps[comp].data;
+        }
+        llassert(has_data);
+        if (has_data)
+        // </FS>
         {
             S32 offset = dest;
-            for (S32 y = (height - 1); y >= 0; y--)
+            // <FS>
+            //for (S32 y = (height - 1); y >= 0; y--)
+            //{
+            //    for (U32 x = 0; x < width; x++)
+            //    {
+            //        rawp[offset] = image->comps[comp].data[y*comp_width + x];
+            //        offset += channels;
+            //    }
+            //}
+            for (opj_image_t* band_image : band_images)
             {
-                for (U32 x = 0; x < width; x++)
+                const opj_image_comp_t& band_comp = band_image->comps[comp];
+                for (S32 y = (S32)band_comp.h - 1; y >= 0; y--)
                 {
-                    rawp[offset] = image->comps[comp].data[y*comp_width + x];
-                    offset += channels;
+                    for (U32 x = 0; x < width; x++)
+                    {
+                        rawp[offset] = band_comp.data[y * band_comp.w + x];
+                        offset += channels;
+                    }
                 }
             }
+            // </FS>
         }
         else // Some rare OpenJPEG versions have this bug.
         {
@@ -0,0 +1,261 @@
+/**
+ * @file   llimagej2coj_test.cpp
+ * @date   2024-11
+ * @brief  Test of the OpenJPEG decoder, and a decode benchmark
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llimagej2coj.h"
+#include "llimage.h"
+#include "llimagej2c.h"
+
+#include "../test/lltut.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    LLPointer<LLImageRaw> make_raw(U16 width, U16 height, S8 components)
+    {
+        LLPointer<LLImageRaw> raw = new LLImageRaw(width, height, components);
+        U8* data = raw->getData();
+        for (S32 y = 0; y < height; ++y)
+        {
+            for (S32 x = 0; x < width; ++x)
+            {
+                for (S32 c = 0; c < components; ++c)
+                {
+                    // gradients with some detail, so that every resolution level has content
+                    *data++ = (U8)((x * (c + 1) + y * (3 - c) + ((x ^ y) & 0x1f)) & 0xff);
+                }
+            }
+        }
+        return raw;
+    }
+
+    std::vector<U8> encode(const LLImageRaw* raw)
+    {
+        LLPointer<LLImageJ2C> j2c = new LLImageJ2C;
+        if (!j2c->encode(raw, 0.f))
+        {
+            return std::vector<U8>();
+        }
+        return std::vector<U8>(j2c->getData(), j2c->getData() + j2c->getDataSize());
+    }
+
+    LLPointer<LLImageRaw> decode(const std::vector<U8>& data, S8 discard_level)
+    {
+        LLPointer<LLImageJ2C> j2c = new LLImageJ2C;
+        LLPointer<LLImageRaw> raw = new LLImageRaw;
+        if (data.empty() || !j2c->allocateData((S32)data.size()))
+        {
+            return LLPointer<LLImageRaw>();
+        }
+        memcpy(j2c->getData(), data.data(), data.size());
+        if (!j2c->updateData())
+        {
+            return LLPointer<LLImageRaw>();
+        }
+        j2c->setDiscardLevel(discard_level);
+        if (!j2c->decode(raw, 0.f))
+        {
+            return LLPointer<LLImageRaw>();
+        }
+        return raw;
+    }
+
+    bool same_pixels(const LLImageRaw* a, const LLImageRaw* b)
+    {
+        return a && b
+            && a->getWidth() == b->getWidth()
+            && a->getHeight() == b->getHeight()
+            && a->getComponents() == b->getComponents()
+            && a->getDataSize() == b->getDataSize()
+            && !memcmp(a->getData(), b->getData(), a->getDataSize());
+    }
+}
+
+namespace tut
+{
+    struct llimagej2coj_test
+    {
+        llimagej2coj_test()
+        {
+            LLImage::initClass();
+        }
+
+        ~llimagej2coj_test()
+        {
+            LLImageJ2C::setDecodeThreads(1, 0);
+            LLImage::cleanupClass();
+        }
+    };
+    typedef test_group<llimagej2coj_test> llimagej2coj_t;
+    typedef llimagej2coj_t::object llimagej2coj_object_t;
+    tut::llimagej2coj_t tut_llimagej2coj("LLImageJ2COJ");
+
+    template<> template<>
+    void llimagej2coj_object_t::test<1>()
+    {
+        set_test_name("threaded decode matches single threaded decode");
+
+        LLPointer<LLImageRaw> source = make_raw(1024, 1024, 3);
+        std::vector<U8> data = encode(source);
+        ensure("encoded", !data.empty());
+
+        for (S8 discard_level : { 0, 1, 2 })
+        {
+            LLImageJ2C::setDecodeThreads(1, 0);
+            LLPointer<LLImageRaw> single = decode(data, discard_level);
+            ensure("single threaded decode", single.notNull());
+            ensure_equals("width", (S32)single->getWidth(), 1024 >> discard_level);
+
+            LLImageJ2C::setDecodeThreads(8, 8);
+            LLPointer<LLImageRaw> threaded = decode(data, discard_level);
+            ensure("threaded decode", threaded.notNull());
+            ensure("same pixels", same_pixels(single, threaded));
+        }
+    }
+
+    template<> template<>
+    void llimagej2coj_object_t::test<2>()
+    {
+        set_test_name("concurrent decodes share the thread budget");
+
+        std::vector<U8> large = encode(make_raw(1024, 1024, 4));
+        std::vector<U8> small = encode(make_raw(128, 128, 3));
+        ensure("encoded", !large.empty() && !small.empty());
+
+        LLImageJ2C::setDecodeThreads(1, 0);
+        LLPointer<LLImageRaw> large_ref = decode(large, 0);
+        LLPointer<LLImageRaw> small_ref = decode(small, 0);
+
+        // more threaded images in flight than the budget covers
+        LLImageJ2C::setDecodeThreads(4, 3);
+        std::vector<std::thread> threads;
+        std::atomic<U32> mismatches{ 0 };
+        for (U32 i = 0; i < 6; ++i)
+        {
+            threads.emplace_back([&, i]()
+            {
+                for (U32 j = 0; j < 3; ++j)
+                {
+                    const bool is_large = (i + j) % 2 == 0;
+                    LLPointer<LLImageRaw> raw = decode(is_large ? large : small, 0);
+                    if (!same_pixels(raw, is_large ? large_ref : small_ref))
+                    {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        ensure_equals("mismatches", mismatches.load(), 0U);
+    }
+
+    template<> template<>
+    void llimagej2coj_object_t::test<3>()
+    {
+        set_test_name("j2c decode benchmark");
+
+        // Decodes every .j2c file of a folder at each discard level, on one
+        // thread per image and with intra-image threading:
+        // LL_J2C_BENCHMARK_DIR=/path/to/textures
+        const char* dir = getenv("LL_J2C_BENCHMARK_DIR");
+        if (!dir || !*dir)
+        {
+            skip("set LL_J2C_BENCHMARK_DIR to run the j2c decode benchmark");
+        }
+
+        std::vector<std::vector<U8>> files;
+        boost::system::error_code ec;
+        boost::filesystem::recursive_directory_iterator iter(dir, ec);
+        while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
+        {
+            const boost::filesystem::path& path = (*iter).path();
+            if (boost::filesystem::is_regular_file(*iter, ec) && path.extension() == ".j2c")
+            {
+                std::ifstream file(path.string(), std::ios::binary);
+                files.emplace_back((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            }
+            iter.increment(ec);
+        }
+        if (files.empty())
+        {
+            skip("no .j2c files found in LL_J2C_BENCHMARK_DIR");
+        }
+
+        const U32 cores = llmax(std::thread::hardware_concurrency(), 2U);
+        typedef std::chrono::high_resolution_clock clock;
+        for (U32 per_image : { 1U, llmin(cores, 8U) })
+        {
+            LLImageJ2C::setDecodeThreads(per_image, per_image - 1);
+            for (S8 discard_level = 0; discard_level <= 3; ++discard_level)
+            {
+                std::vector<F64> latencies;
+                F64 pixels = 0.0;
+                F64 total = 0.0;
+                U32 failed = 0;
+                for (const std::vector<U8>& data : files)
+                {
+                    clock::time_point start = clock::now();
+                    LLPointer<LLImageRaw> raw = decode(data, discard_level);
+                    F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+                    if (raw.isNull())
+                    {
+                        ++failed;
+                        continue;
+                    }
+                    latencies.push_back(seconds * 1000.0);
+                    pixels += (F64)raw->getWidth() * raw->getHeight();
+                    total += seconds;
+                }
+                if (latencies.empty())
+                {
+                    continue;
+                }
+
+                std::sort(latencies.begin(), latencies.end());
+                auto percentile = [&latencies](F64 p) { return latencies[(size_t)(p * (latencies.size() - 1))]; };
+                std::cout << per_image << " thread(s) per image, discard " << (S32)discard_level << ": "
+                          << latencies.size() << " images (" << failed << " failed), "
+                          << (pixels / 1000000.0 / total) << " MP/s, latency ms p50 " << percentile(0.5)
+                          << " p90 " << percentile(0.9) << " p99 " << percentile(0.99)
+                          << " max " << latencies.back() << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,367 @@
+/**
+ * @file llskinningbatch.cpp
+ * @brief Skins the positions of a whole rigged volume face at once
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llskinningbatch.h"
+
+#include <algorithm>
+#include <numeric>
+
+#ifdef __AVX2__
+// The AVX2 build (USE_AVX2_OPTIMIZATION) compiles with /arch:AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Influences of one vertex, sorted by joint, with their packed joints
+    // as the sort key
+    struct Influences
+    {
+        U64 mKey;
+        U8  mJoints[4];
+        F32 mWeights[4];
+        S32 mCount;
+    };
+
+    void decode_influences(const LLVector4a& packed, U32 max_joints, Influences& out)
+    {
+        const F32* packed_weights = packed.getF32ptr();
+        S32 joints[4];
+        F32 weights[4];
+        F32 scale = 0.f;
+        for (S32 k = 0; k < 4; ++k)
+        {
+            // as LLSkinningUtil::getPerVertexSkinMatrix()
+            const F32 w = packed_weights[k];
+            joints[k] = llclamp((S32)floorf(w), 0, (S32)max_joints - 1);
+            weights[k] = w - floorf(w);
+            scale += weights[k];
+        }
+
+        out.mCount = 0;
+        if (scale <= 0.f)
+        {
+            // scrubSkinWeights() should have made this impossible
+            out.mJoints[0] = (U8)joints[0];
+            out.mWeights[0] = 1.f;
+            out.mCount = 1;
+        }
+        else
+        {
+            for (S32 k = 0; k < 4; ++k)
+            {
+                if (weights[k] <= 0.f)
+                {
+                    continue;
+                }
+                const F32 weight = weights[k] / scale;
+                S32 slot = 0;
+                while (slot < out.mCount && out.mJoints[slot] < joints[k])
+                {
+                    ++slot;
+                }
+                if (slot < out.mCount && out.mJoints[slot] == joints[k])
+                {
+                    // same joint twice
+                    out.mWeights[slot] += weight;
+                    continue;
+                }
+                for (S32 j = out.mCount; j > slot; --j)
+                {
+                    out.mJoints[j] = out.mJoints[j - 1];
+                    out.mWeights[j] = out.mWeights[j - 1];
+                }
+                out.mJoints[slot] = (U8)joints[k];
+                out.mWeights[slot] = weight;
+                ++out.mCount;
+            }
+        }
+
+        out.mKey = (U64)out.mCount << 32;
+        for (S32 k = 0; k < out.mCount; ++k)
+        {
+            out.mKey |= (U64)out.mJoints[k] << (8 * k);
+        }
+        for (S32 k = out.mCount; k < 4; ++k)
+        {
+            out.mJoints[k] = out.mJoints[0];
+            out.mWeights[k] = 0.f;
+        }
+    }
+
+    template <S32 N>
+    void skin_run(const LLMatrix4a* const* mats, const LLVector4a* bound, const LLVector4a* weights, const U32* order,
+                  U32 begin, U32 end, LLVector4a* out, LLVector4a& min, LLVector4a& max)
+    {
+        for (U32 i = begin; i < end; ++i)
+        {
+            LLVector4a res;
+            mats[0]->affineTransform(bound[i], res);
+            if constexpr (N > 1)
+            {
+                LLVector4a w, t;
+                w.splat<0>(weights[i]);
+                res.mul(w);
+                for (S32 k = 1; k < N; ++k)
+                {
+                    mats[k]->affineTransform(bound[i], t);
+                    w.splat(weights[i], k);
+                    t.mul(w);
+                    res.add(t);
+                }
+            }
+            out[order[i]] = res;
+            min.setMin(min, res);
+            max.setMax(max, res);
+        }
+    }
+
+#ifdef __AVX2__
+    // Same arithmetic as LLMatrix4a::affineTransform(), on two vertices
+    inline __m256 transform2(const __m256* cols, __m256 x, __m256 y, __m256 z)
+    {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, cols[0]), _mm256_mul_ps(y, cols[1])),
+                             _mm256_add_ps(_mm256_mul_ps(z, cols[2]), cols[3]));
+    }
+
+    template <S32 N>
+    void skin_run_avx2(const LLMatrix4a* const* mats, const LLVector4a* bound, const LLVector4a* weights, const U32* order,
+                       U32 begin, U32 end, LLVector4a* out, __m256& min, __m256& max)
+    {
+        // the matrices of the run, in both halves
+        __m256 cols[N][4];
+        for (S32 k = 0; k < N; ++k)
+        {
+            for (S32 c = 0; c < 4; ++c)
+            {
+                cols[k][c] = _mm256_broadcast_ps((const __m128*)mats[k]->mMatrix[c].getF32ptr());
+            }
+        }
+
+        U32 i = begin;
+        for (; i + 1 < end; i += 2)
+        {
+            const __m256 v = _mm256_loadu_ps(bound[i].getF32ptr());
+            const __m256 x = _mm256_permute_ps(v, 0x00);
+            const __m256 y = _mm256_permute_ps(v, 0x55);
+            const __m256 z = _mm256_permute_ps(v, 0xAA);
+
+            __m256 res = transform2(cols[0], x, y, z);
+            if constexpr (N > 1)
+            {
+                const __m256 w = _mm256_loadu_ps(weights[i].getF32ptr());
+                res = _mm256_mul_ps(res, _mm256_permute_ps(w, 0x00));
+                res = _mm256_add_ps(res, _mm256_mul_ps(transform2(cols[1], x, y, z), _mm256_permute_ps(w, 0x55)));
+                if constexpr (N > 2)
+                {
+                    res = _mm256_add_ps(res, _mm256_mul_ps(transform2(cols[2], x, y, z), _mm256_permute_ps(w, 0xAA)));
+                }
+                if constexpr (N > 3)
+                {
+                    res = _mm256_add_ps(res, _mm256_mul_ps(transform2(cols[3], x, y, z), _mm256_permute_ps(w, 0xFF)));
+                }
+            }
+
+            _mm_store_ps(out[order[i]].getF32ptr(), _mm256_castps256_ps128(res));
+            _mm_store_ps(out[order[i + 1]].getF32ptr(), _mm256_extractf128_ps(res, 1));
+            min = _mm256_min_ps(min, res);
+            max = _mm256_max_ps(max, res);
+        }
+
+        if (i < end)
+        {
+            // odd one out
+            LLVector4a tail_min, tail_max;
+            _mm_store_ps(tail_min.getF32ptr(), _mm256_castps256_ps128(min));
+            _mm_store_ps(tail_max.getF32ptr(), _mm256_castps256_ps128(max));
+            skin_run<N>(mats, bound, weights, order, i, end, out, tail_min, tail_max);
+            // in both halves, the upper half of a cast is undefined
+            min = _mm256_min_ps(min, _mm256_broadcast_ps((const __m128*)tail_min.getF32ptr()));
+            max = _mm256_max_ps(max, _mm256_broadcast_ps((const __m128*)tail_max.getF32ptr()));
+        }
+    }
+#endif
+}
+
+LLSkinningBatch::LLSkinningBatch()
+:   mSourceWeights(NULL),
+    mMaxJoints(0),
+    mCacheValid(false),
+    mBoundValid(false),
+    mLastIn(NULL),
+    mLastOut(NULL)
+{
+}
+
+void LLSkinningBatch::clear()
+{
+    mRuns.clear();
+    mOrder.clear();
+    mWeights.clear();
+    mBound.clear();
+    mSourceWeights = NULL;
+    mMaxJoints = 0;
+    mCacheValid = false;
+    mBoundValid = false;
+    mLastIn = NULL;
+    mLastOut = NULL;
+    mLastPalette.clear();
+}
+
+bool LLSkinningBatch::isPrepared(const LLVector4a* weights, S32 num_vertices, U32 max_joints) const
+{
+    return weights && weights == mSourceWeights && num_vertices == getNumVertices() && max_joints == mMaxJoints;
+}
+
+void LLSkinningBatch::prepare(const LLVector4a* weights, S32 num_vertices, U32 max_joints)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+    clear();
+    llassert(max_joints <= 256);
+    if (!weights || num_vertices <= 0 || !max_joints)
+    {
+        return;
+    }
+    mSourceWeights = weights;
+    mMaxJoints = max_joints;
+
+    std::vector<Influences> influences(num_vertices);
+    for (S32 i = 0; i < num_vertices; ++i)
+    {
+        decode_influences(weights[i], max_joints, influences[i]);
+    }
+
+    // Neighbouring vertices mostly share their joints, keep their order
+    // within a run so the output is written close to sequentially
+    mOrder.resize(num_vertices);
+    std::iota(mOrder.begin(), mOrder.end(), 0);
+    std::stable_sort(mOrder.begin(), mOrder.end(),
+                     [&influences](U32 a, U32 b) { return influences[a].mKey < influences[b].mKey; });
+
+    mWeights.resize(num_vertices);
+    for (U32 i = 0; i < (U32)num_vertices; ++i)
+    {
+        const Influences& vertex = influences[mOrder[i]];
+        mWeights[i].loadua(vertex.mWeights);
+        if (mRuns.empty() || influences[mOrder[mRuns.back().mBegin]].mKey != vertex.mKey)
+        {
+            Run run;
+            memcpy(run.mJoints, vertex.mJoints, sizeof(run.mJoints));
+            run.mNumJoints = vertex.mCount;
+            run.mBegin = i;
+            run.mEnd = i;
+            mRuns.push_back(run);
+        }
+        mRuns.back().mEnd = i + 1;
+    }
+}
+
+void LLSkinningBatch::transformBindShape(const LLMatrix4a& bind_shape, const LLVector4a* in)
+{
+    const U32 count = (U32)mOrder.size();
+    mBound.resize(count);
+    for (U32 i = 0; i < count; ++i)
+    {
+        bind_shape.affineTransform(in[mOrder[i]], mBound[i]);
+    }
+}
+
+bool LLSkinningBatch::skin(const LLMatrix4a* palette, S32 palette_count, const LLMatrix4a& bind_shape,
+                           const LLVector4a* in, LLVector4a* out, LLVector4a* extents)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+    if (mOrder.empty() || !in || !out || palette_count < (S32)mMaxJoints)
+    {
+        return false;
+    }
+
+    const bool same_bound = mBoundValid && in == mLastIn
+        && !memcmp(&bind_shape, &mLastBindShape, sizeof(LLMatrix4a));
+    if (mCacheValid && same_bound && out == mLastOut
+        && palette_count == (S32)mLastPalette.size()
+        && !memcmp(palette, mLastPalette.data(), palette_count * sizeof(LLMatrix4a)))
+    {
+        return false;
+    }
+
+    if (!same_bound)
+    {
+        transformBindShape(bind_shape, in);
+        mLastIn = in;
+        mLastBindShape = bind_shape;
+        mBoundValid = true;
+    }
+    mLastPalette.assign(palette, palette + palette_count);
+    mLastOut = out;
+
+    const LLVector4a* bound = mBound.data();
+    const LLVector4a* weights = mWeights.data();
+    const U32* order = mOrder.data();
+    const LLMatrix4a* mats[4];
+
+#ifdef __AVX2__
+    __m256 min = _mm256_set1_ps(F32_MAX);
+    __m256 max = _mm256_set1_ps(-F32_MAX);
+    for (const Run& run : mRuns)
+    {
+        for (S32 k = 0; k < 4; ++k)
+        {
+            mats[k] = &palette[run.mJoints[k]];
+        }
+        switch (run.mNumJoints)
+        {
+        case 1: skin_run_avx2<1>(mats, bound, weights, order, run.mBegin, run.mEnd, out, min, max); break;
+        case 2: skin_run_avx2<2>(mats, bound, weights, order, run.mBegin, run.mEnd, out, min, max); break;
+        case 3: skin_run_avx2<3>(mats, bound, weights, order, run.mBegin, run.mEnd, out, min, max); break;
+        default: skin_run_avx2<4>(mats, bound, weights, order, run.mBegin, run.mEnd, out, min, max); break;
+        }
+    }
+    extents[0] = _mm_min_ps(_mm256_castps256_ps128(min), _mm256_extractf128_ps(min, 1));
+    extents[1] = _mm_max_ps(_mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1));
+#else
+    extents[0].splat(F32_MAX);
+    extents[1].splat(-F32_MAX);
+    for (const Run& run : mRuns)
+    {
+        for (S32 k = 0; k < 4; ++k)
+        {
+            mats[k] = &palette[run.mJoints[k]];
+        }
+        switch (run.mNumJoints)
+        {
+        case 1: skin_run<1>(mats, bound, weights, order, run.mBegin, run.mEnd, out, extents[0], extents[1]); break;
+        case 2: skin_run<2>(mats, bound, weights, order, run.mBegin, run.mEnd, out, extents[0], extents[1]); break;
+        case 3: skin_run<3>(mats, bound, weights, order, run.mBegin, run.mEnd, out, extents[0], extents[1]); break;
+        default: skin_run<4>(mats, bound, weights, order, run.mBegin, run.mEnd, out, extents[0], extents[1]); break;
+        }
+    }
+#endif
+
+    mCacheValid = true;
+    return true;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file llskinningbatch.h
+ * @brief Skins the positions of a whole rigged volume face at once
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNINGBATCH_H
+#define LL_LLSKINNINGBATCH_H
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "llvector4a.h"
+
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// LLSkinningBatch
+// The CPU skinning of one LLVolumeFace, for picking, extents and raycasts.
+//
+// prepare() decodes the packed weights (joint index in the integer part,
+// weight in the fraction) once, drops the unused influences and sorts the
+// vertices by the joints they depend on. skin() then goes through runs of
+// vertices sharing their joints, with the joint matrices loaded once per
+// run, transforming two vertices at a time in the AVX2 build and one at a
+// time with SSE2 otherwise. When the palette, bind shape and source
+// positions are those of the previous call, the output is left as it is.
+//-----------------------------------------------------------------------------
+class LLSkinningBatch
+{
+public:
+    LLSkinningBatch();
+
+    // weights as in LLVolumeFace::mWeights. Joint indices are clamped to
+    // max_joints - 1, which must not exceed the palette passed to skin().
+    void prepare(const LLVector4a* weights, S32 num_vertices, U32 max_joints);
+    bool isPrepared(const LLVector4a* weights, S32 num_vertices, U32 max_joints) const;
+    void clear();
+
+    // out[i] = sum of weight * palette[joint] applied to bind_shape * in[i],
+    // and extents the bounds of out. Returns false when nothing was
+    // written: nothing changed since the last call, or nothing is prepared.
+    // out must not be changed by anyone else between calls, or call
+    // invalidate().
+    bool skin(const LLMatrix4a* palette, S32 palette_count, const LLMatrix4a& bind_shape,
+              const LLVector4a* in, LLVector4a* out, LLVector4a* extents);
+    void invalidate() { mCacheValid = false; }
+
+    S32 getNumVertices() const { return (S32)mOrder.size(); }
+    S32 getNumRuns() const { return (S32)mRuns.size(); }
+
+private:
+    void transformBindShape(const LLMatrix4a& bind_shape, const LLVector4a* in);
+
+    // Vertices mOrder[mBegin..mEnd) all depend on mNumJoints joints
+    struct Run
+    {
+        U8  mJoints[4];
+        S32 mNumJoints;
+        U32 mBegin;
+        U32 mEnd;
+    };
+
+    std::vector<Run>        mRuns;
+    std::vector<U32>        mOrder;     // vertex index, in run order
+    std::vector<LLVector4a> mWeights;   // normalized, in run order, matching Run::mJoints
+    std::vector<LLVector4a> mBound;     // bind_shape * in, in run order
+    const LLVector4a*       mSourceWeights;
+    U32                     mMaxJoints;
+
+    // what the last skin() was given
+    bool                    mCacheValid;
+    bool                    mBoundValid;
+    const LLVector4a*       mLastIn;
+    const LLVector4a*       mLastOut;
+    LLMatrix4a              mLastBindShape;
+    std::vector<LLMatrix4a> mLastPalette;
+};
+
+#endif // LL_LLSKINNINGBATCH_H
@@ -32,6 +32,7 @@
 #include <stdint.h>
 #endif
 #include <cmath>
+#include <string_view>
 #include <unordered_map>
 
 #include "llerror.h"
@@ -57,6 +58,9 @@
 
 #include "meshoptimizer/meshoptimizer.h"
 
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
 #define DEBUG_SILHOUETTE_BINORMALS 0
 #define DEBUG_SILHOUETTE_NORMALS 0 // TomY: Use this to display normals using the silhouette
 #define DEBUG_SILHOUETTE_EDGE_MAP 0 // DaveP: Use this to display edge map using the silhouette
@@ -2308,40 +2312,536 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
     return retval;
 }
 
+// <FS> Mesh LODs are decoded straight from the inflated binary LLSD into the
+// face arrays, without building the LLSD tree first. That tree costs a map
+// node per face element and a copy of every vertex stream.
+bool LLVolume::sUseBinaryMeshDecoder = true;
+
+struct LLVolume::PackedFace
+{
+    struct Bytes
+    {
+        const U8*   mData{ nullptr };
+        size_t      mSize{ 0 };
+
+        bool empty() const { return mSize == 0; }
+    };
+
+    Bytes       mPositions;
+    Bytes       mNormals;
+    Bytes       mTexCoords;
+    Bytes       mIndices;
+    Bytes       mWeights;
+    LLVector3   mPositionMin;
+    LLVector3   mPositionMax;
+    LLVector2   mTexCoordMin;
+    LLVector2   mTexCoordMax;
+    LLVector3   mNormalizedScale{ 1.f, 1.f, 1.f };
+    bool        mNoGeometry{ false };
+    bool        mHasWeights{ false };
+};
+
+namespace
+{
+    constexpr S32 MESH_LLSD_MAX_DEPTH = 96; // as UNZIP_LLSD_MAX_DEPTH in llsdserialize.cpp
+
+    // Vertex streams are little endian U16 arrays at any alignment
+    inline U16 load_u16(const U8* data)
+    {
+        U16 value;
+        memcpy(&value, data, sizeof(U16));
+        return value;
+    }
+
+    /**
+     * Reader for the subset of the binary LLSD serialization used by mesh
+     * LODs (see LLSDBinaryParser::doParse() for the format). Anything it
+     * doesn't expect makes it fail, and the caller falls back to the
+     * generic parser.
+     */
+    class LLMeshBinaryReader
+    {
+    public:
+        LLMeshBinaryReader(const U8* data, size_t size) : mPos(data), mEnd(data + size) {}
+
+        bool parseFaces(std::vector<LLVolume::PackedFace>& faces)
+        {
+            U32 count = 0;
+            if (!expect('[') || !getU32(count) || count > remaining())
+            {
+                return false;
+            }
+            faces.resize(count);
+            for (U32 i = 0; i < count; ++i)
+            {
+                if (!parseFace(faces[i]))
+                {
+                    return false;
+                }
+            }
+            return expect(']');
+        }
+
+    private:
+        // Keys are matched like LLSD::has(), the first of duplicate keys wins
+        enum : U32
+        {
+            SEEN_POSITION = 1 << 0,
+            SEEN_NORMAL = 1 << 1,
+            SEEN_TEXCOORD = 1 << 2,
+            SEEN_INDICES = 1 << 3,
+            SEEN_WEIGHTS = 1 << 4,
+            SEEN_POSITION_DOMAIN = 1 << 5,
+            SEEN_TEXCOORD_DOMAIN = 1 << 6,
+            SEEN_SCALE = 1 << 7
+        };
+
+        bool parseFace(LLVolume::PackedFace& face)
+        {
+            U32 count = 0;
+            if (!expect('{') || !getU32(count))
+            {
+                return false;
+            }
+            U32 seen = 0;
+            for (U32 i = 0; i < count; ++i)
+            {
+                std::string_view key;
+                if (!getKey(key))
+                {
+                    return false;
+                }
+
+                bool ok;
+                if (key == "Position")
+                {
+                    ok = getBinary(face.mPositions, seen, SEEN_POSITION);
+                }
+                else if (key == "Normal")
+                {
+                    ok = getBinary(face.mNormals, seen, SEEN_NORMAL);
+                }
+                else if (key == "TexCoord0")
+                {
+                    ok = getBinary(face.mTexCoords, seen, SEEN_TEXCOORD);
+                }
+                else if (key == "TriangleList")
+                {
+                    ok = getBinary(face.mIndices, seen, SEEN_INDICES);
+                }
+                else if (key == "Weights")
+                {
+                    face.mHasWeights = true;
+                    ok = getBinary(face.mWeights, seen, SEEN_WEIGHTS);
+                }
+                else if (key == "PositionDomain")
+                {
+                    ok = getDomain(face.mPositionMin.mV, face.mPositionMax.mV, 3, seen, SEEN_POSITION_DOMAIN);
+                }
+                else if (key == "TexCoord0Domain")
+                {
+                    ok = getDomain(face.mTexCoordMin.mV, face.mTexCoordMax.mV, 2, seen, SEEN_TEXCOORD_DOMAIN);
+                }
+                else if (key == "NormalizedScale")
+                {
+                    ok = getVector(face.mNormalizedScale.mV, 3, seen, SEEN_SCALE);
+                }
+                else
+                {
+                    face.mNoGeometry |= key == "NoGeometry";
+                    ok = skipValue(MAX_DEPTH);
+                }
+                if (!ok)
+                {
+                    return false;
+                }
+            }
+            return expect('}');
+        }
+
+        // A value that isn't binary reads as empty, like LLSD::asBinary()
+        bool getBinary(LLVolume::PackedFace::Bytes& bytes, U32& seen, U32 flag)
+        {
+            U32 size = 0;
+            if ((seen & flag) || mPos >= mEnd || *mPos != 'b')
+            {
+                return skipValue(MAX_DEPTH);
+            }
+            seen |= flag;
+            ++mPos;
+            if (!getU32(size) || size > remaining())
+            {
+                return false;
+            }
+            bytes.mData = mPos;
+            bytes.mSize = size;
+            mPos += size;
+            return true;
+        }
+
+        bool getDomain(F32* min, F32* max, U32 dims, U32& seen, U32 flag)
+        {
+            if ((seen & flag) || mPos >= mEnd || *mPos != '{')
+            {
+                return skipValue(MAX_DEPTH);
+            }
+            seen |= flag;
+            ++mPos;
+            U32 count = 0;
+            if (!getU32(count))
+            {
+                return false;
+            }
+            U32 domain_seen = 0;
+            for (U32 i = 0; i < count; ++i)
+            {
+                std::string_view key;
+                if (!getKey(key))
+                {
+                    return false;
+                }
+                bool ok;
+                if (key == "Min")
+                {
+                    ok = getVector(min, dims, domain_seen, 1);
+                }
+                else if (key == "Max")
+                {
+                    ok = getVector(max, dims, domain_seen, 2);
+                }
+                else
+                {
+                    ok = skipValue(MAX_DEPTH);
+                }
+                if (!ok)
+                {
+                    return false;
+                }
+            }
+            return expect('}');
+        }
+
+        // Same as LLVector3::setValue(): missing components are zero
+        bool getVector(F32* values, U32 dims, U32& seen, U32 flag)
+        {
+            if (seen & flag)
+            {
+                return skipValue(MAX_DEPTH);
+            }
+            seen |= flag;
+            for (U32 i = 0; i < dims; ++i)
+            {
+                values[i] = 0.f;
+            }
+            if (mPos >= mEnd || *mPos != '[')
+            {
+                return skipValue(MAX_DEPTH);
+            }
+            ++mPos;
+            U32 count = 0;
+            if (!getU32(count))
+            {
+                return false;
+            }
+            for (U32 i = 0; i < count; ++i)
+            {
+                F64 value = 0.0;
+                if (!getReal(value))
+                {
+                    return false;
+                }
+                if (i < dims)
+                {
+                    values[i] = (F32)value;
+                }
+            }
+            return expect(']');
+        }
+
+        bool getReal(F64& value)
+        {
+            char type;
+            if (!getChar(type))
+            {
+                return false;
+            }
+            if (type == 'r')
+            {
+                if (remaining() < 8)
+                {
+                    return false;
+                }
+                U64 bits = 0;
+                for (S32 i = 0; i < 8; ++i)
+                {
+                    bits = (bits << 8) | *mPos++;
+                }
+                memcpy(&value, &bits, sizeof(F64));
+                return true;
+            }
+            if (type == 'i')
+            {
+                U32 bits = 0;
+                if (!getU32(bits))
+                {
+                    return false;
+                }
+                value = (F64)(S32)bits;
+                return true;
+            }
+            // strings and the like convert in LLSD::asReal(), leave those
+            // to the generic parser
+            return false;
+        }
+
+        bool getKey(std::string_view& key)
+        {
+            U32 size = 0;
+            if (!expect('k') || !getU32(size) || size > remaining())
+            {
+                return false;
+            }
+            key = std::string_view((const char*)mPos, size);
+            mPos += size;
+            return true;
+        }
+
+        bool skipValue(S32 depth)
+        {
+            char type;
+            if (depth <= 0 || !getChar(type))
+            {
+                return false;
+            }
+            U32 size = 0;
+            switch (type)
+            {
+            case '!':
+            case '0':
+            case '1':
+                return true;
+            case 'i':
+                return skip(4);
+            case 'r':
+            case 'd':
+                return skip(8);
+            case 'u':
+                return skip(UUID_BYTES);
+            case 's':
+            case 'l':
+            case 'b':
+                return getU32(size) && skip(size);
+            case '[':
+                if (!getU32(size))
+                {
+                    return false;
+                }
+                for (U32 i = 0; i < size; ++i)
+                {
+                    if (!skipValue(depth - 1))
+                    {
+                        return false;
+                    }
+                }
+                return expect(']');
+            case '{':
+                if (!getU32(size))
+                {
+                    return false;
+                }
+                for (U32 i = 0; i < size; ++i)
+                {
+                    std::string_view key;
+                    if (!getKey(key) || !skipValue(depth - 1))
+                    {
+                        return false;
+                    }
+                }
+                return expect('}');
+            default:
+                return false;
+            }
+        }
+
+        bool getChar(char& c)
+        {
+            if (mPos >= mEnd)
+            {
+                return false;
+            }
+            c = (char)*mPos++;
+            return true;
+        }
+
+        bool expect(char c)
+        {
+            char actual;
+            return getChar(actual) && actual == c;
+        }
+
+        // network byte order
+        bool getU32(U32& value)
+        {
+            if (remaining() < 4)
+            {
+                return false;
+            }
+            value = ((U32)mPos[0] << 24) | ((U32)mPos[1] << 16) | ((U32)mPos[2] << 8) | (U32)mPos[3];
+            mPos += 4;
+            return true;
+        }
+
+        bool skip(size_t bytes)
+        {
+            if (bytes > remaining())
+            {
+                return false;
+            }
+            mPos += bytes;
+            return true;
+        }
+
+        size_t remaining() const { return mEnd - mPos; }
+
+        static constexpr S32 MAX_DEPTH = MESH_LLSD_MAX_DEPTH;
+
+        const U8*   mPos;
+        const U8*   mEnd;
+    };
+
+    LLVolume::PackedFace::Bytes binary_of(const LLSD& sd)
+    {
+        LLVolume::PackedFace::Bytes bytes;
+        const LLSD::Binary& binary = sd.asBinary();
+        if (!binary.empty())
+        {
+            bytes.mData = binary.data();
+            bytes.mSize = binary.size();
+        }
+        return bytes;
+    }
+}
+// </FS>
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
+    // <FS> read the block and share the binary decoder
     //input stream is now pointing at a zlib compressed block of LLSD
-    //decompress block
-    LLSD mdl;
-    U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, is, size);
-    if (uzip_result != LLUZipHelper::ZR_OK)
+    std::unique_ptr<U8[]> in_data(new(std::nothrow) U8[size]);
+    if (!in_data)
     {
-        LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
+        LL_DEBUGS("MeshStreaming") << "Failed to allocate " << size << " bytes for LoD, will probably fetch from sim again." << LL_ENDL;
         return false;
     }
-    return unpackVolumeFacesInternal(mdl);
+    is.read((char*)in_data.get(), size);
+
+    return unpackVolumeFaces(in_data.get(), size);
+    // </FS>
 }
 
 bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
 {
-    //input data is now pointing at a zlib compressed block of LLSD
-    //decompress block
-    LLSD mdl;
-    U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, in_data, size);
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    // <FS>
+    if (!sUseBinaryMeshDecoder)
+    {
+        //input data is now pointing at a zlib compressed block of LLSD
+        //decompress block
+        LLSD mdl;
+        U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, in_data, size);
+        if (uzip_result != LLUZipHelper::ZR_OK)
+        {
+            LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
+            return false;
+        }
+        return unpackVolumeFacesInternal(mdl);
+    }
+
+    // reused between LoDs decoded on this thread
+    static thread_local std::vector<U8> inflated;
+
+    U32 uzip_result = LLUZipHelper::unzip(inflated, in_data, size);
     if (uzip_result != LLUZipHelper::ZR_OK)
     {
         LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
         return false;
     }
-    return unpackVolumeFacesInternal(mdl);
+
+    llssize data_size = inflated.size();
+    char* data = strip_deprecated_header((char*)inflated.data(), data_size);
+
+    bool result;
+    std::vector<PackedFace> faces;
+    LLMeshBinaryReader reader((const U8*)data, data_size);
+    if (reader.parseFaces(faces))
+    {
+        result = unpackVolumeFacesInternal(faces);
+    }
+    else
+    {
+        LL_DEBUGS("MeshStreaming") << "Unexpected LoD layout, decoding through LLSD" << LL_ENDL;
+        LLSD mdl;
+        boost::iostreams::stream<boost::iostreams::array_source> istrm(data, data_size);
+        if (!LLSDSerialize::fromBinary(mdl, istrm, data_size, MESH_LLSD_MAX_DEPTH))
+        {
+            LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << LLUZipHelper::ZR_PARSE_ERROR << " , will probably fetch from sim again." << LL_ENDL;
+            return false;
+        }
+        result = unpackVolumeFacesInternal(mdl);
+    }
+
+    // don't pin the memory of an unusually large LoD
+    constexpr size_t MAX_KEPT_CAPACITY = 4 * 1024 * 1024;
+    if (inflated.capacity() > MAX_KEPT_CAPACITY)
+    {
+        std::vector<U8>().swap(inflated);
+    }
+
+    return result;
+    // </FS>
 }
 
 bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
+{
+    // <FS> the faces point into mdl, which outlives the decode
+    std::vector<PackedFace> faces(mdl.size());
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        const LLSD& face_sd = mdl[i];
+        PackedFace& face = faces[i];
+
+        face.mNoGeometry = face_sd.has("NoGeometry");
+        face.mPositions = binary_of(face_sd["Position"]);
+        face.mNormals = binary_of(face_sd["Normal"]);
+        face.mTexCoords = binary_of(face_sd["TexCoord0"]);
+        face.mIndices = binary_of(face_sd["TriangleList"]);
+        face.mHasWeights = face_sd.has("Weights");
+        if (face.mHasWeights)
+        {
+            face.mWeights = binary_of(face_sd["Weights"]);
+        }
+
+        face.mPositionMin.setValue(face_sd["PositionDomain"]["Min"]);
+        face.mPositionMax.setValue(face_sd["PositionDomain"]["Max"]);
+        face.mTexCoordMin.setValue(face_sd["TexCoord0Domain"]["Min"]);
+        face.mTexCoordMax.setValue(face_sd["TexCoord0Domain"]["Max"]);
+        if (face_sd.has("NormalizedScale"))
+        {
+            face.mNormalizedScale.setValue(face_sd["NormalizedScale"]);
+        }
+    }
+
+    return unpackVolumeFacesInternal(faces);
+    // </FS>
+}
+
+bool LLVolume::unpackVolumeFacesInternal(const std::vector<PackedFace>& faces)
 {
     {
-        auto face_count = mdl.size();
+        auto face_count = faces.size();
 
         if (face_count == 0)
         { //no faces unpacked, treat as failed decode
@@ -2354,8 +2854,9 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
         for (size_t i = 0; i < face_count; ++i)
         {
             LLVolumeFace& face = mVolumeFaces[i];
+            const PackedFace& packed = faces[i];
 
-            if (mdl[i].has("NoGeometry"))
+            if (packed.mNoGeometry)
             { //face has no geometry, continue
                 face.resizeIndices(3);
                 face.resizeVertices(1);
@@ -2366,14 +2867,11 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-            const LLSD::Binary& pos = mdl[i]["Position"].asBinary();
-            const LLSD::Binary& norm = mdl[i]["Normal"].asBinary();
-            // const LLSD::Binary& tangent = mdl[i]["Tangent"].asBinary(); // <FS:Beq/> more set but unused
-            const LLSD::Binary& tc = mdl[i]["TexCoord0"].asBinary();
-            const LLSD::Binary& idx = mdl[i]["TriangleList"].asBinary();
+            const PackedFace::Bytes& pos = packed.mPositions;
+            const PackedFace::Bytes& idx = packed.mIndices;
 
             //copy out indices
-            auto num_indices = idx.size() / 2;
+            auto num_indices = idx.mSize / 2;
             const S32 indices_to_discard = num_indices % 3;
             if (indices_to_discard > 0)
             {
@@ -2395,14 +2893,10 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-            U16* indices = (U16*) &(idx[0]);
-            for (U32 j = 0; j < num_indices; ++j)
-            {
-                face.mIndices[j] = indices[j];
-            }
+            memcpy(face.mIndices, idx.mData, num_indices * sizeof(U16));
 
             //copy out vertices
-            U32 num_verts = static_cast<U32>(pos.size())/(3*2);
+            U32 num_verts = static_cast<U32>(pos.mSize)/(3*2);
             face.resizeVertices(num_verts);
 
             if (num_verts > 0 && !face.mPositions)
@@ -2412,29 +2906,23 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-            LLVector3 minp;
-            LLVector3 maxp;
-            LLVector2 min_tc;
-            LLVector2 max_tc;
+            // <FS> streams shorter than the positions are treated as missing
+            // instead of being read past their end
+            const PackedFace::Bytes norm = packed.mNormals.mSize >= (size_t)num_verts * 6 ? packed.mNormals : PackedFace::Bytes();
+            const PackedFace::Bytes tc = packed.mTexCoords.mSize >= (size_t)num_verts * 4 ? packed.mTexCoords : PackedFace::Bytes();
+            // </FS>
+
+            const LLVector3& minp = packed.mPositionMin;
+            const LLVector3& maxp = packed.mPositionMax;
+            const LLVector2& min_tc = packed.mTexCoordMin;
+            const LLVector2& max_tc = packed.mTexCoordMax;
 
-            minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-            maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
             LLVector4a min_pos, max_pos;
             min_pos.load3(minp.mV);
             max_pos.load3(maxp.mV);
 
-            min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-            max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
-
             //unpack normalized scale/translation
-            if (mdl[i].has("NormalizedScale"))
-            {
-                face.mNormalizedScale.setValue(mdl[i]["NormalizedScale"]);
-            }
-            else
-            {
-                face.mNormalizedScale.set(1, 1, 1);
-            }
+            face.mNormalizedScale = packed.mNormalizedScale;
 
             LLVector4a pos_range;
             pos_range.setSub(max_pos, min_pos);
@@ -2449,15 +2937,15 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
             LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
 
             {
-                U16* v = (U16*) &(pos[0]);
+                const U8* v = pos.mData;
                 for (U32 j = 0; j < num_verts; ++j)
                 {
-                    pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
+                    pos_out->set((F32) load_u16(v), (F32) load_u16(v + 2), (F32) load_u16(v + 4));
                     pos_out->div(65535.f);
                     pos_out->mul(pos_range);
                     pos_out->add(min_pos);
                     pos_out++;
-                    v += 3;
+                    v += 6;
                 }
 
             }
@@ -2465,15 +2953,15 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
             {
                 if (!norm.empty())
                 {
-                    U16* n = (U16*) &(norm[0]);
+                    const U8* n = norm.mData;
                     for (U32 j = 0; j < num_verts; ++j)
                     {
-                        norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
+                        norm_out->set((F32) load_u16(n), (F32) load_u16(n + 2), (F32) load_u16(n + 4));
                         norm_out->div(65535.f);
                         norm_out->mul(2.f);
                         norm_out->sub(1.f);
                         norm_out++;
-                        n += 3;
+                        n += 6;
                     }
                 }
                 else
@@ -2517,19 +3005,19 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
             {
                 if (!tc.empty())
                 {
-                    U16* t = (U16*) &(tc[0]);
+                    const U8* t = tc.mData;
                     for (U32 j = 0; j < num_verts; j+=2)
                     {
                         if (j < num_verts-1)
                         {
-                            tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
+                            tc_out->set((F32) load_u16(t), (F32) load_u16(t + 2), (F32) load_u16(t + 4), (F32) load_u16(t + 6));
                         }
                         else
                         {
-                            tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
+                            tc_out->set((F32) load_u16(t), (F32) load_u16(t + 2), 0.f, 0.f);
                         }
 
-                        t += 4;
+                        t += 8;
 
                         tc_out->div(65535.f);
                         tc_out->mul(tc_range);
@@ -2548,7 +3036,7 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 }
             }
 
-            if (mdl[i].has("Weights"))
+            if (packed.mHasWeights)
             {
                 face.allocateWeights(num_verts);
                 if (!face.mWeights && num_verts)
@@ -2559,25 +3047,27 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                     continue;
                 }
 
-                const LLSD::Binary& weights = mdl[i]["Weights"].asBinary();
+                const PackedFace::Bytes& weights = packed.mWeights;
+                // <FS> a truncated list ends the influences of its last vertex
+                auto weight_at = [&weights](size_t pos) -> U8 { return pos < weights.mSize ? weights.mData[pos] : 0xFF; };
 
-                U32 idx = 0;
+                size_t idx = 0;
 
                 U32 cur_vertex = 0;
-                while (idx < weights.size() && cur_vertex < num_verts)
+                while (idx < weights.mSize && cur_vertex < num_verts)
                 {
                     const U8 END_INFLUENCES = 0xFF;
-                    U8 joint = weights[idx++];
+                    U8 joint = weight_at(idx++);
 
                     U32 cur_influence = 0;
                     LLVector4 wght(0,0,0,0);
                     U32 joints[4] = {0,0,0,0};
                     LLVector4 joints_with_weights(0,0,0,0);
 
-                    while (joint != END_INFLUENCES && idx < weights.size())
+                    while (joint != END_INFLUENCES && idx < weights.mSize)
                     {
-                        U16 influence = weights[idx++];
-                        influence |= ((U16) weights[idx++] << 8);
+                        U16 influence = weight_at(idx++);
+                        influence |= ((U16) weight_at(idx++) << 8);
 
                         F32 w = llclamp((F32) influence / 65535.f, 0.001f, 0.999f);
                         wght.mV[cur_influence] = w;
@@ -2590,9 +3080,10 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                         }
                         else
                         {
-                            joint = weights[idx++];
+                            joint = weight_at(idx++);
                         }
                     }
+                    // </FS>
                     F32 wsum = wght.mV[VX] + wght.mV[VY] + wght.mV[VZ] + wght.mV[VW];
                     if (wsum <= 0.f)
                     {
@@ -2611,7 +3102,7 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                     cur_vertex++;
                 }
 
-                if (cur_vertex != num_verts || idx != weights.size())
+                if (cur_vertex != num_verts || idx != weights.mSize)
                 {
                     LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
                 }
@@ -1126,8 +1126,17 @@ protected:
 public:
     bool unpackVolumeFaces(std::istream& is, S32 size);
     bool unpackVolumeFaces(U8* in_data, S32 size);
+
+    // <FS> Decoded view of one face of a mesh LoD block
+    struct PackedFace;
+
+    // Decode mesh LoDs straight from the binary LLSD instead of through an
+    // LLSD tree. Only cleared by tests and benchmarks comparing the two.
+    static bool sUseBinaryMeshDecoder;
+    // </FS>
 private:
     bool unpackVolumeFacesInternal(const LLSD& mdl);
+    bool unpackVolumeFacesInternal(const std::vector<PackedFace>& faces); // <FS/>
 
 public:
     virtual void setMeshAssetLoaded(bool loaded);
@@ -0,0 +1,358 @@
+/**
+ * @file   llskinningbatch_test.cpp
+ * @date   2024-11
+ * @brief  Test for the batched skinning in llskinningbatch.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llskinningbatch.h"
+#include "../llvolume.h"
+#include "llsdserialize.h"
+#include "stringize.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    const U32 MAX_JOINTS = 110;
+
+    // What LLRiggedVolume::update() did per vertex before the batches
+    void skin_reference(const LLMatrix4a* palette, U32 max_joints, const LLMatrix4a& bind_shape,
+                        const LLVector4a* weights, const LLVector4a* in, LLVector4a* out, S32 count)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            const F32* w = weights[i].getF32ptr();
+            S32 idx[4];
+            F32 wght[4];
+            F32 scale = 0.f;
+            for (S32 k = 0; k < 4; ++k)
+            {
+                idx[k] = llclamp((S32)floorf(w[k]), 0, (S32)max_joints - 1);
+                wght[k] = w[k] - floorf(w[k]);
+                scale += wght[k];
+            }
+
+            LLMatrix4a final_mat;
+            final_mat.clear();
+            for (S32 k = 0; k < 4; ++k)
+            {
+                LLMatrix4a src;
+                src.setMul(palette[idx[k]], wght[k] / scale);
+                final_mat.add(src);
+            }
+
+            LLVector4a t;
+            bind_shape.affineTransform(in[i], t);
+            final_mat.affineTransform(t, out[i]);
+        }
+    }
+
+    void make_matrix(std::mt19937& random, LLMatrix4a& mat)
+    {
+        std::uniform_real_distribution<F32> unit(-1.f, 1.f);
+        LLMatrix4 m;
+        LLQuaternion rot(unit(random), LLVector3(unit(random), unit(random), unit(random) + 2.f));
+        m.initAll(LLVector3(1.f, 1.f, 1.f) + LLVector3(unit(random), unit(random), unit(random)) * 0.1f,
+                  rot, LLVector3(unit(random), unit(random), unit(random)));
+        mat.loadu(m);
+    }
+
+    // Weights packed as in LLVolumeFace::mWeights, one to four joints
+    void make_weights(std::mt19937& random, std::vector<LLVector4a>& weights, S32 count)
+    {
+        std::uniform_real_distribution<F32> fraction(0.05f, 0.95f);
+        weights.resize(count);
+        for (S32 i = 0; i < count; ++i)
+        {
+            // neighbours share joints, as in real meshes
+            const S32 base = (i / 7) % (MAX_JOINTS - 4);
+            const S32 influences = 1 + (i / 5) % 4;
+            F32 w[4];
+            for (S32 k = 0; k < 4; ++k)
+            {
+                w[k] = (F32)(base + k) + (k < influences ? fraction(random) : 0.f);
+            }
+            weights[i].loadua(w);
+        }
+    }
+
+    bool close_enough(const LLVector4a* a, const LLVector4a* b, S32 count, std::string& error)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            for (S32 k = 0; k < 3; ++k)
+            {
+                if (fabsf(a[i][k] - b[i][k]) > 1e-4f * llmax(1.f, fabsf(a[i][k])))
+                {
+                    error = STRINGIZE("vertex " << i << " axis " << k << ": " << a[i][k] << " vs " << b[i][k]);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    struct SkinnedFace
+    {
+        std::vector<LLVector4a> mWeights;
+        std::vector<LLVector4a> mPositions;
+    };
+}
+
+namespace tut
+{
+    struct LLSkinningBatchFixture
+    {
+        std::mt19937 mRandom{ 1234 };
+        LLMatrix4a mPalette[MAX_JOINTS];
+        LLMatrix4a mBindShape;
+
+        LLSkinningBatchFixture()
+        {
+            for (U32 j = 0; j < MAX_JOINTS; ++j)
+            {
+                make_matrix(mRandom, mPalette[j]);
+            }
+            make_matrix(mRandom, mBindShape);
+        }
+
+        SkinnedFace makeFace(S32 count)
+        {
+            std::uniform_real_distribution<F32> unit(-1.f, 1.f);
+            SkinnedFace face;
+            make_weights(mRandom, face.mWeights, count);
+            face.mPositions.resize(count);
+            for (LLVector4a& position : face.mPositions)
+            {
+                position.set(unit(mRandom), unit(mRandom), unit(mRandom), 1.f);
+            }
+            return face;
+        }
+    };
+    typedef test_group<LLSkinningBatchFixture> LLSkinningBatch_factory;
+    typedef LLSkinningBatch_factory::object LLSkinningBatch_t;
+    LLSkinningBatch_factory tf("LLSkinningBatch");
+
+    template<> template<>
+    void LLSkinningBatch_t::test<1>()
+    {
+        set_test_name("batches match the per vertex skinning");
+
+        // odd and even counts, for the two vertex AVX2 loop
+        for (S32 count : { 1, 2, 3, 257, 4000 })
+        {
+            SkinnedFace face = makeFace(count);
+            std::vector<LLVector4a> expected(count), actual(count);
+            skin_reference(mPalette, MAX_JOINTS, mBindShape, face.mWeights.data(), face.mPositions.data(), expected.data(), count);
+
+            LLSkinningBatch batch;
+            batch.prepare(face.mWeights.data(), count, MAX_JOINTS);
+            ensure("prepared", batch.isPrepared(face.mWeights.data(), count, MAX_JOINTS));
+            ensure("runs", batch.getNumRuns() > 0 && batch.getNumRuns() <= count);
+
+            LLVector4a extents[2];
+            ensure("skinned", batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+            std::string error;
+            bool same = close_enough(expected.data(), actual.data(), count, error);
+            ensure(STRINGIZE(count << " vertices, " << error), same);
+
+            LLVector4a min = expected[0], max = expected[0];
+            for (const LLVector4a& position : expected)
+            {
+                min.setMin(min, position);
+                max.setMax(max, position);
+            }
+            same = close_enough(&min, &extents[0], 1, error);
+            ensure(STRINGIZE(count << " vertices, min " << error), same);
+            same = close_enough(&max, &extents[1], 1, error);
+            ensure(STRINGIZE(count << " vertices, max " << error), same);
+        }
+    }
+
+    template<> template<>
+    void LLSkinningBatch_t::test<2>()
+    {
+        set_test_name("unchanged poses are not skinned again");
+
+        const S32 count = 100;
+        SkinnedFace face = makeFace(count);
+        std::vector<LLVector4a> expected(count), actual(count);
+        LLVector4a extents[2];
+
+        LLSkinningBatch batch;
+        ensure("not prepared", !batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+        batch.prepare(face.mWeights.data(), count, MAX_JOINTS);
+        ensure("short palette", !batch.skin(mPalette, MAX_JOINTS - 1, mBindShape, face.mPositions.data(), actual.data(), extents));
+        ensure("first", batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+        ensure("same pose", !batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+
+        batch.invalidate();
+        ensure("invalidated", batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+
+        // a joint moves
+        make_matrix(mRandom, mPalette[(S32)floorf(face.mWeights[count / 2][0])]);
+        ensure("moved joint", batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+        skin_reference(mPalette, MAX_JOINTS, mBindShape, face.mWeights.data(), face.mPositions.data(), expected.data(), count);
+        std::string error;
+        bool same = close_enough(expected.data(), actual.data(), count, error);
+        ensure("moved joint " + error, same);
+
+        // the bind shape changes, the bound positions are recomputed
+        make_matrix(mRandom, mBindShape);
+        ensure("new bind shape", batch.skin(mPalette, MAX_JOINTS, mBindShape, face.mPositions.data(), actual.data(), extents));
+        skin_reference(mPalette, MAX_JOINTS, mBindShape, face.mWeights.data(), face.mPositions.data(), expected.data(), count);
+        same = close_enough(expected.data(), actual.data(), count, error);
+        ensure("new bind shape " + error, same);
+
+        batch.clear();
+        ensure("cleared", !batch.isPrepared(face.mWeights.data(), count, MAX_JOINTS));
+    }
+
+    template<> template<>
+    void LLSkinningBatch_t::test<3>()
+    {
+        set_test_name("skinning benchmark");
+
+        // Skins the rigged faces of the mesh assets in a folder, for instance
+        // a copy of the viewer cache:
+        // LL_SKINNING_BENCHMARK_DIR=/path/to/cache
+        const char* dir = getenv("LL_SKINNING_BENCHMARK_DIR");
+        if (!dir || !*dir)
+        {
+            skip("set LL_SKINNING_BENCHMARK_DIR to run the skinning benchmark");
+        }
+
+        std::vector<LLPointer<LLVolume> > volumes;
+        boost::system::error_code ec;
+        boost::filesystem::recursive_directory_iterator iter(dir, ec);
+        while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec))
+            {
+                std::ifstream file((*iter).path().string(), std::ios::binary);
+                std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+                LLSD header;
+                std::istringstream stream(contents);
+                if (LLSDSerialize::fromBinary(header, stream, contents.size(), 32) > 0 && header.isMap()
+                    && header.has("skin") && header.has("high_lod"))
+                {
+                    const size_t header_size = (size_t)stream.tellg();
+                    const S32 offset = header["high_lod"]["offset"].asInteger();
+                    const S32 size = header["high_lod"]["size"].asInteger();
+                    if (offset >= 0 && size > 0 && header_size + offset + size <= contents.size())
+                    {
+                        LLVolumeParams params;
+                        params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+                        LLUUID id;
+                        id.generate();
+                        params.setSculptID(id, LL_SCULPT_TYPE_MESH);
+                        LLPointer<LLVolume> volume = new LLVolume(params, 0.f);
+                        if (volume->unpackVolumeFaces((U8*)contents.data() + header_size + offset, size))
+                        {
+                            volumes.push_back(volume);
+                        }
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
+
+        std::vector<const LLVolumeFace*> faces;
+        S32 vertices = 0;
+        for (LLVolume* volume : volumes)
+        {
+            for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
+            {
+                const LLVolumeFace& face = volume->getVolumeFace(i);
+                if (face.mWeights && face.mNumVertices > 0)
+                {
+                    faces.push_back(&face);
+                    vertices += face.mNumVertices;
+                }
+            }
+        }
+        if (faces.empty())
+        {
+            skip("no rigged mesh assets found in LL_SKINNING_BENCHMARK_DIR");
+        }
+
+        std::vector<std::vector<LLVector4a> > output(faces.size());
+        std::vector<LLSkinningBatch> batches(faces.size());
+        for (size_t f = 0; f < faces.size(); ++f)
+        {
+            output[f].resize(faces[f]->mNumVertices);
+            batches[f].prepare(faces[f]->mWeights, faces[f]->mNumVertices, MAX_JOINTS);
+        }
+
+        // a new pose every frame, then the same pose again
+        const S32 FRAMES = 20;
+        typedef std::chrono::high_resolution_clock clock;
+        F64 ms[3] = { 0., 0., 0. };
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            make_matrix(mRandom, mPalette[frame % MAX_JOINTS]);
+
+            clock::time_point start = clock::now();
+            for (size_t f = 0; f < faces.size(); ++f)
+            {
+                skin_reference(mPalette, MAX_JOINTS, mBindShape, faces[f]->mWeights, faces[f]->mPositions,
+                               output[f].data(), faces[f]->mNumVertices);
+            }
+            clock::time_point reference = clock::now();
+
+            LLVector4a extents[2];
+            for (size_t f = 0; f < faces.size(); ++f)
+            {
+                batches[f].skin(mPalette, MAX_JOINTS, mBindShape, faces[f]->mPositions, output[f].data(), extents);
+            }
+            clock::time_point batched = clock::now();
+
+            for (size_t f = 0; f < faces.size(); ++f)
+            {
+                batches[f].skin(mPalette, MAX_JOINTS, mBindShape, faces[f]->mPositions, output[f].data(), extents);
+            }
+            clock::time_point unchanged = clock::now();
+
+            ms[0] += std::chrono::duration<F64, std::milli>(reference - start).count();
+            ms[1] += std::chrono::duration<F64, std::milli>(batched - reference).count();
+            ms[2] += std::chrono::duration<F64, std::milli>(unchanged - batched).count();
+        }
+
+        std::cout << "\n" << faces.size() << " rigged faces, " << vertices << " vertices\n"
+                  << "per vertex:     " << ms[0] / FRAMES << " ms per frame\n"
+                  << "batched:        " << ms[1] / FRAMES << " ms per frame\n"
+                  << "unchanged pose: " << ms[2] / FRAMES << " ms per frame" << std::endl;
+    }
+}
@@ -0,0 +1,301 @@
+/**
+ * @file   llvolume_test.cpp
+ * @date   2024-10
+ * @brief  Test for the mesh LoD decoding in llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llvolume.h"
+#include "llsdserialize.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    LLSD::Binary make_u16_stream(U32 count, U16 seed)
+    {
+        LLSD::Binary data(count * sizeof(U16));
+        for (U32 i = 0; i < count; ++i)
+        {
+            U16 value = (U16)(seed + i * 7919);
+            memcpy(&data[i * sizeof(U16)], &value, sizeof(U16));
+        }
+        return data;
+    }
+
+    LLSD make_vector(F64 x, F64 y)
+    {
+        LLSD sd = LLSD::emptyArray();
+        sd.append(x);
+        sd.append(y);
+        return sd;
+    }
+
+    LLSD make_vector(F64 x, F64 y, F64 z)
+    {
+        LLSD sd = make_vector(x, y);
+        sd.append(z);
+        return sd;
+    }
+
+    // A grid of quads laid out like the faces the uploader writes
+    LLSD make_face(U32 side, bool weights)
+    {
+        const U32 num_verts = side * side;
+        LLSD face;
+        face["Position"] = make_u16_stream(num_verts * 3, 11);
+        face["Normal"] = make_u16_stream(num_verts * 3, 23);
+        face["TexCoord0"] = make_u16_stream(num_verts * 2, 37);
+        face["PositionDomain"]["Min"] = make_vector(-0.5, -1.0, -2.0);
+        face["PositionDomain"]["Max"] = make_vector(0.5, 1.0, 2.0);
+        face["TexCoord0Domain"]["Min"] = make_vector(0.0, 0.0);
+        face["TexCoord0Domain"]["Max"] = make_vector(1.0, 2.0);
+        face["NormalizedScale"] = make_vector(1.0, 2.0, 4.0);
+
+        std::vector<U16> indices;
+        for (U32 y = 0; y + 1 < side; ++y)
+        {
+            for (U32 x = 0; x + 1 < side; ++x)
+            {
+                const U16 i = (U16)(y * side + x);
+                const U16 quad[] = { i, (U16)(i + 1), (U16)(i + side), (U16)(i + 1), (U16)(i + side + 1), (U16)(i + side) };
+                indices.insert(indices.end(), std::begin(quad), std::end(quad));
+            }
+        }
+        LLSD::Binary index_data(indices.size() * sizeof(U16));
+        memcpy(index_data.data(), indices.data(), index_data.size());
+        face["TriangleList"] = index_data;
+
+        if (weights)
+        {
+            LLSD::Binary weight_data;
+            for (U32 i = 0; i < num_verts; ++i)
+            {
+                const U8 influences = (U8)(1 + i % 4);
+                for (U8 k = 0; k < influences; ++k)
+                {
+                    const U16 weight = (U16)(65535 / influences);
+                    weight_data.push_back((U8)(i + k) % 100);
+                    weight_data.push_back((U8)(weight & 0xFF));
+                    weight_data.push_back((U8)(weight >> 8));
+                }
+                if (influences < 4)
+                {
+                    weight_data.push_back(0xFF);
+                }
+            }
+            face["Weights"] = weight_data;
+        }
+        return face;
+    }
+
+    LLPointer<LLVolume> decode(std::string& block, bool binary_decoder)
+    {
+        LLVolumeParams params;
+        params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+        LLUUID id;
+        id.generate();
+        params.setSculptID(id, LL_SCULPT_TYPE_MESH);
+
+        LLPointer<LLVolume> volume = new LLVolume(params, 0.f);
+        LLVolume::sUseBinaryMeshDecoder = binary_decoder;
+        bool success = volume->unpackVolumeFaces((U8*)block.data(), (S32)block.size());
+        LLVolume::sUseBinaryMeshDecoder = true;
+        return success ? volume : LLPointer<LLVolume>();
+    }
+
+    bool same_vectors(const LLVector4a* a, const LLVector4a* b, S32 count)
+    {
+        return (!a && !b) || (a && b && !memcmp(a, b, count * sizeof(LLVector4a)));
+    }
+}
+
+namespace tut
+{
+    struct LLVolumeDecodeFixture
+    {
+        void ensure_same_faces(const std::string& msg, LLVolume* expected, LLVolume* actual)
+        {
+            ensure(msg + " LLSD decode", expected != nullptr);
+            ensure(msg + " binary decode", actual != nullptr);
+            ensure_equals(msg + " face count", actual->getNumVolumeFaces(), expected->getNumVolumeFaces());
+            for (S32 i = 0; i < expected->getNumVolumeFaces(); ++i)
+            {
+                const LLVolumeFace& a = expected->getVolumeFace(i);
+                const LLVolumeFace& b = actual->getVolumeFace(i);
+                ensure_equals(msg + " vertices", b.mNumVertices, a.mNumVertices);
+                ensure_equals(msg + " indices", b.mNumIndices, a.mNumIndices);
+                ensure(msg + " index data", !memcmp(a.mIndices, b.mIndices, a.mNumIndices * sizeof(U16)));
+                ensure(msg + " positions", same_vectors(a.mPositions, b.mPositions, a.mNumVertices));
+                ensure(msg + " normals", same_vectors(a.mNormals, b.mNormals, a.mNumVertices));
+                ensure(msg + " texcoords", !memcmp(a.mTexCoords, b.mTexCoords, a.mNumVertices * sizeof(LLVector2)));
+                ensure(msg + " weights", same_vectors(a.mWeights, b.mWeights, a.mNumVertices));
+                ensure(msg + " extents", same_vectors(a.mExtents, b.mExtents, 2));
+                ensure(msg + " normalized scale", a.mNormalizedScale == b.mNormalizedScale);
+            }
+        }
+    };
+    typedef test_group<LLVolumeDecodeFixture> LLVolumeDecode_factory;
+    typedef LLVolumeDecode_factory::object LLVolumeDecode_t;
+    LLVolumeDecode_factory tf("LLVolume mesh decode");
+
+    template<> template<>
+    void LLVolumeDecode_t::test<1>()
+    {
+        set_test_name("binary decoder matches the LLSD decoder");
+
+        LLSD lod = LLSD::emptyArray();
+        lod.append(make_face(16, true));
+        LLSD no_geometry;
+        no_geometry["NoGeometry"] = true;
+        lod.append(no_geometry);
+        lod.append(make_face(9, false));
+        std::string block = zip_llsd(lod);
+
+        LLPointer<LLVolume> expected = decode(block, false);
+        LLPointer<LLVolume> actual = decode(block, true);
+        ensure_same_faces("mesh", expected, actual);
+        ensure("weights decoded", actual->getVolumeFace(0).mWeights != nullptr);
+    }
+
+    template<> template<>
+    void LLVolumeDecode_t::test<2>()
+    {
+        set_test_name("unexpected layouts fall back to the LLSD decoder");
+
+        // a domain given as strings is only understood by LLSD::asReal()
+        LLSD lod = LLSD::emptyArray();
+        LLSD face = make_face(4, false);
+        face["PositionDomain"]["Min"][0] = "-0.5";
+        face["Extra"]["Nested"] = LLSD::emptyArray();
+        lod.append(face);
+        std::string block = zip_llsd(lod);
+
+        ensure_same_faces("fallback", decode(block, false), decode(block, true));
+
+        std::string truncated = block.substr(0, block.size() / 2);
+        ensure("truncated block", decode(truncated, true).isNull());
+
+        LLSD empty = LLSD::emptyArray();
+        std::string no_faces = zip_llsd(empty);
+        ensure("no faces", decode(no_faces, true).isNull());
+    }
+
+    template<> template<>
+    void LLVolumeDecode_t::test<3>()
+    {
+        set_test_name("unzip reuses its buffer");
+
+        LLSD lod = LLSD::emptyArray();
+        lod.append(make_face(32, true));
+        std::string block = zip_llsd(lod);
+
+        // the mesh decoder keeps one buffer per thread; a second block no
+        // larger than the first must be inflated without reallocating it
+        std::vector<U8> buffer;
+        ensure_equals("first unzip", LLUZipHelper::unzip(buffer, (const U8*)block.data(), (S32)block.size()), LLUZipHelper::ZR_OK);
+        const std::vector<U8> first(buffer);
+        const U8* data = buffer.data();
+        ensure_equals("second unzip", LLUZipHelper::unzip(buffer, (const U8*)block.data(), (S32)block.size()), LLUZipHelper::ZR_OK);
+        ensure("buffer reused", buffer.data() == data);
+        ensure("same contents", buffer == first);
+
+        std::string truncated = block.substr(0, block.size() / 2);
+        ensure("truncated block", LLUZipHelper::unzip(buffer, (const U8*)truncated.data(), (S32)truncated.size()) != LLUZipHelper::ZR_OK);
+        ensure("cleared on failure", buffer.empty());
+    }
+
+    template<> template<>
+    void LLVolumeDecode_t::test<4>()
+    {
+        set_test_name("mesh decode benchmark");
+
+        // Decodes every LoD of the mesh assets in a folder, for instance a
+        // copy of the viewer cache:
+        // LL_MESH_BENCHMARK_DIR=/path/to/cache
+        const char* dir = getenv("LL_MESH_BENCHMARK_DIR");
+        if (!dir || !*dir)
+        {
+            skip("set LL_MESH_BENCHMARK_DIR to run the mesh decode benchmark");
+        }
+
+        // the LoD blocks of a mesh asset, in its header
+        std::vector<std::string> blocks;
+        boost::system::error_code ec;
+        boost::filesystem::recursive_directory_iterator iter(dir, ec);
+        while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec))
+            {
+                std::ifstream file((*iter).path().string(), std::ios::binary);
+                std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+                LLSD header;
+                std::istringstream stream(contents);
+                if (LLSDSerialize::fromBinary(header, stream, contents.size(), 32) > 0 && header.isMap()
+                    && header.has("high_lod"))
+                {
+                    const size_t header_size = (size_t)stream.tellg();
+                    for (const char* lod_name : { "lowest_lod", "low_lod", "medium_lod", "high_lod" })
+                    {
+                        const S32 offset = header[lod_name]["offset"].asInteger();
+                        const S32 size = header[lod_name]["size"].asInteger();
+                        if (offset >= 0 && size > 0 && header_size + offset + size <= contents.size())
+                        {
+                            blocks.push_back(contents.substr(header_size + offset, size));
+                        }
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
+        if (blocks.empty())
+        {
+            skip("no mesh assets found in LL_MESH_BENCHMARK_DIR");
+        }
+
+        typedef std::chrono::high_resolution_clock clock;
+        for (bool binary_decoder : { false, true })
+        {
+            size_t decoded = 0;
+            clock::time_point start = clock::now();
+            for (std::string& block : blocks)
+            {
+                decoded += decode(block, binary_decoder).notNull();
+            }
+            F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+
+            std::cout << (binary_decoder ? "binary" : "LLSD") << " decoder: " << decoded << "/" << blocks.size()
+                      << " LoDs in " << seconds << "s" << std::endl;
+        }
+    }
+}
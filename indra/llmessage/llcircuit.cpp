@@ -138,35 +138,19 @@ LLCircuitData::~LLCircuitData()
     // Clean up all pending transfers.
     gTransferManager.cleanupConnection(mHost);
 
-    // remove all pending reliable messages on this circuit
-    std::vector<TPACKETID> doomed;
-    reliable_iter iter;
-    reliable_iter end = mUnackedPackets.end();
-    for(iter = mUnackedPackets.begin(); iter != end; ++iter)
-    {
-        packetp = iter->second;
-        gMessageSystem->mFailedResendPackets++;
-        if(gMessageSystem->mVerboseLog)
-        {
-            doomed.push_back(packetp->mPacketID);
-        }
-        if (packetp->mCallback)
-        {
-            packetp->mCallback(packetp->mCallbackData,LL_ERR_CIRCUIT_GONE);
-        }
+    // remove all pending reliable messages on this circuit, retrying or
+    // on their final try
+    // <FS> Reliable packets tracked by packet id
+    std::vector<LLReliablePacket*> pending;
+    pending.reserve(mUnackedPackets.size());
+    mUnackedPackets.forEach([&pending](TPACKETID, LLReliablePacket* packetp) { pending.push_back(packetp); });
+    mUnackedPackets.clear();
 
-        // Update stats
-        mUnackedPacketCount--;
-        mUnackedPacketBytes -= packetp->mBufferLength;
-
-        delete packetp;
-    }
-
-    // remove all pending final retry reliable messages on this circuit
-    end = mFinalRetryPackets.end();
-    for(iter = mFinalRetryPackets.begin(); iter != end; ++iter)
+    std::vector<TPACKETID> doomed;
+    for (LLReliablePacket* pending_packetp : pending)
     {
-        packetp = iter->second;
+        packetp = pending_packetp;
+    // </FS>
         gMessageSystem->mFailedResendPackets++;
         if(gMessageSystem->mVerboseLog)
         {
@@ -187,6 +171,7 @@ LLCircuitData::~LLCircuitData()
     // log aborted reliable packets for this circuit.
     if(gMessageSystem->mVerboseLog && !doomed.empty())
     {
+        std::sort(doomed.begin(), doomed.end()); // <FS/> Reliable packets tracked by packet id
         std::ostringstream str;
         std::ostream_iterator<TPACKETID> append(str, " ");
         str << "MSG: -> " << mHost << "\tABORTING RELIABLE:\t";
@@ -198,48 +183,14 @@ LLCircuitData::~LLCircuitData()
 
 void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 {
-    reliable_iter iter;
-    LLReliablePacket *packetp;
-
-    iter = mUnackedPackets.find(packet_num);
-    if (iter != mUnackedPackets.end())
+    // <FS> Reliable packets tracked by packet id. A packet on its final try
+    // is in the same ring as the ones still retrying.
+    LLReliablePacket **found = mUnackedPackets.find(packet_num);
+    if (found)
     {
-        packetp = iter->second;
-
-        if(gMessageSystem->mVerboseLog)
-        {
-            std::ostringstream str;
-            str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
-                << packetp->mPacketID;
-            LL_INFOS() << str.str() << LL_ENDL;
-        }
-        if (packetp->mCallback)
-        {
-            if (packetp->mTimeout < F32Seconds(0.f))   // negative timeout will always return timeout even for successful ack, for debugging
-            {
-                packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
-            }
-            else
-            {
-                packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
-            }
-        }
-
-        // Update stats
-        mUnackedPacketCount--;
-        mUnackedPacketBytes -= packetp->mBufferLength;
+        LLReliablePacket *packetp = *found;
+    // </FS>
 
-        // Cleanup
-        delete packetp;
-        mUnackedPackets.erase(iter);
-        return;
-    }
-
-    iter = mFinalRetryPackets.find(packet_num);
-    if (iter != mFinalRetryPackets.end())
-    {
-        packetp = iter->second;
-        // LL_INFOS() << "Packet " << packet_num << " removed from the pending list" << LL_ENDL;
         if(gMessageSystem->mVerboseLog)
         {
             std::ostringstream str;
@@ -265,7 +216,7 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 
         // Cleanup
         delete packetp;
-        mFinalRetryPackets.erase(iter);
+        mUnackedPackets.erase(packet_num); // <FS/> Reliable packets tracked by packet id
     }
     else
     {
@@ -288,11 +239,23 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
     // I'm not going to worry about this for now - djs
     //
 
-    reliable_iter iter;
+    // <FS> Reliable packets tracked by packet id. Only the packets whose
+    // expiration time has passed come out of the timer wheel; they are
+    // handled in packet id order, the packets that still have retries left
+    // first, then the ones on their final try, like the two lists were.
+    mResendTimers.collectExpired(now, mExpiredResends);
+    std::sort(mExpiredResends.begin(), mExpiredResends.end(),
+              [](const LLPacketTimerWheel::Entry& a, const LLPacketTimerWheel::Entry& b) { return a.mID < b.mID; });
+
     bool have_resend_overflow = false;
-    for (iter = mUnackedPackets.begin(); iter != mUnackedPackets.end();)
+    bool stopped_resending = false;
+    for (const LLPacketTimerWheel::Entry& expired : mExpiredResends)
     {
-        packetp = iter->second;
+        packetp = findExpiredPacket(expired);
+        if (!packetp || !packetp->mRetries)
+        {
+            continue;
+        }
 
         // Only check overflow if we haven't had one yet.
         if (!have_resend_overflow)
@@ -308,130 +271,119 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
             // If we have too many unacked packets, we need to start dropping expired ones.
             if (mUnackedPacketBytes > 512000)
             {
-                if (now > packetp->mExpirationTime)
-                {
-                    // This circuit has overflowed.  Do not retry.  Do not pass go.
-                    packetp->mRetries = 0;
-                    // Remove it from this list and add it to the final list.
-                    mUnackedPackets.erase(iter++);
-                    mFinalRetryPackets[packetp->mPacketID] = packetp;
-                }
-                else
-                {
-                    ++iter;
-                }
-                // Move on to the next unacked packet.
+                // This circuit has overflowed.  Do not retry.  Do not pass go.
+                // It is aborted with the final tries below.
+                packetp->mRetries = 0;
                 continue;
             }
 
-            if (mUnackedPacketBytes > 256000 && !(getPacketsOut() % 1024))
+            if (!stopped_resending && mUnackedPacketBytes > 256000 && !(getPacketsOut() % 1024))
             {
                 // Warn if we've got a lot of resends waiting.
                 LL_WARNS() << mHost << " has " << mUnackedPacketBytes
                         << " bytes of reliable messages waiting" << LL_ENDL;
             }
             // Stop resending.  There are less than 512000 unacked packets.
-            break;
+            // Try again on the next call.
+            stopped_resending = true;
+            mResendTimers.schedule(expired.mID, expired.mDeadline);
+            continue;
         }
 
-        if (now > packetp->mExpirationTime)
-        {
-            packetp->mRetries--;
+        packetp->mRetries--;
 
-            // retry
-            mCurrentResendCount++;
+        // retry
+        mCurrentResendCount++;
 
-            gMessageSystem->mResentPackets++;
+        gMessageSystem->mResentPackets++;
 
-            if(gMessageSystem->mVerboseLog)
-            {
-                std::ostringstream str;
-                str << "MSG: -> " << packetp->mHost
-                    << "\tRESENDING RELIABLE:\t" << packetp->mPacketID;
-                LL_INFOS() << str.str() << LL_ENDL;
-            }
+        if(gMessageSystem->mVerboseLog)
+        {
+            std::ostringstream str;
+            str << "MSG: -> " << packetp->mHost
+                << "\tRESENDING RELIABLE:\t" << packetp->mPacketID;
+            LL_INFOS() << str.str() << LL_ENDL;
+        }
 
-            packetp->mBuffer[0] |= LL_RESENT_FLAG;  // tag packet id as being a resend
+        packetp->mBuffer[0] |= LL_RESENT_FLAG;  // tag packet id as being a resend
 
-            gMessageSystem->mPacketRing.sendPacket(packetp->mSocket,
-                                               (char *)packetp->mBuffer, packetp->mBufferLength,
-                                               packetp->mHost);
+        gMessageSystem->mPacketRing.sendPacket(packetp->mSocket,
+                                           (char *)packetp->mBuffer, packetp->mBufferLength,
+                                           packetp->mHost);
 
-            mThrottles.throttleOverflow(TC_RESEND, packetp->mBufferLength * 8.f);
+        mThrottles.throttleOverflow(TC_RESEND, packetp->mBufferLength * 8.f);
 
-            // The new method, retry time based on ping
-            if (packetp->mPingBasedRetry)
-            {
-                packetp->mExpirationTime = now + llmax(LL_MINIMUM_RELIABLE_TIMEOUT_SECONDS, F32Seconds(LL_RELIABLE_TIMEOUT_FACTOR * getPingDelayAveraged()));
-            }
-            else
-            {
-                // custom, constant retry time
-                packetp->mExpirationTime = now + packetp->mTimeout;
-            }
-
-            if (!packetp->mRetries)
-            {
-                // Last resend, remove it from this list and add it to the final list.
-                mUnackedPackets.erase(iter++);
-                mFinalRetryPackets[packetp->mPacketID] = packetp;
-            }
-            else
-            {
-                // Don't remove it yet, it still gets to try to resend at least once.
-                ++iter;
-            }
+        // The new method, retry time based on ping
+        if (packetp->mPingBasedRetry)
+        {
+            packetp->mExpirationTime = now + llmax(LL_MINIMUM_RELIABLE_TIMEOUT_SECONDS, F32Seconds(LL_RELIABLE_TIMEOUT_FACTOR * getPingDelayAveraged()));
         }
         else
         {
-            // Don't need to do anything with this packet, keep iterating.
-            ++iter;
+            // custom, constant retry time
+            packetp->mExpirationTime = now + packetp->mTimeout;
         }
+        // After its last resend, it is on its final try.
+        mResendTimers.schedule(packetp->mPacketID, packetp->mExpirationTime);
     }
 
 
-    for (iter = mFinalRetryPackets.begin(); iter != mFinalRetryPackets.end();)
+    for (const LLPacketTimerWheel::Entry& expired : mExpiredResends)
     {
-        packetp = iter->second;
-        if (now > packetp->mExpirationTime)
+        packetp = findExpiredPacket(expired);
+        if (!packetp || packetp->mRetries)
         {
-            // fail (too many retries)
-            //LL_INFOS() << "Packet " << packetp->mPacketID << " removed from the pending list: exceeded retry limit" << LL_ENDL;
-            //if (packetp->mMessageName)
-            //{
-            //  LL_INFOS() << "Packet name " << packetp->mMessageName << LL_ENDL;
-            //}
-            gMessageSystem->mFailedResendPackets++;
-
-            if(gMessageSystem->mVerboseLog)
-            {
-                std::ostringstream str;
-                str << "MSG: -> " << packetp->mHost << "\tABORTING RELIABLE:\t"
-                    << packetp->mPacketID;
-                LL_INFOS() << str.str() << LL_ENDL;
-            }
-
-            if (packetp->mCallback)
-            {
-                packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
-            }
-
-            // Update stats
-            mUnackedPacketCount--;
-            mUnackedPacketBytes -= packetp->mBufferLength;
+            continue;
+        }
+    // </FS>
+
+        // fail (too many retries)
+        //LL_INFOS() << "Packet " << packetp->mPacketID << " removed from the pending list: exceeded retry limit" << LL_ENDL;
+        //if (packetp->mMessageName)
+        //{
+        //  LL_INFOS() << "Packet name " << packetp->mMessageName << LL_ENDL;
+        //}
+        gMessageSystem->mFailedResendPackets++;
 
-            mFinalRetryPackets.erase(iter++);
-            delete packetp;
+        if(gMessageSystem->mVerboseLog)
+        {
+            std::ostringstream str;
+            str << "MSG: -> " << packetp->mHost << "\tABORTING RELIABLE:\t"
+                << packetp->mPacketID;
+            LL_INFOS() << str.str() << LL_ENDL;
         }
-        else
+
+        if (packetp->mCallback)
         {
-            ++iter;
+            packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
         }
+
+        // Update stats
+        mUnackedPacketCount--;
+        mUnackedPacketBytes -= packetp->mBufferLength;
+
+        mUnackedPackets.erase(packetp->mPacketID); // <FS/> Reliable packets tracked by packet id
+        delete packetp;
     }
+    mExpiredResends.clear(); // <FS/> Reliable packets tracked by packet id
 
     return mUnackedPacketCount;
 }
 
+// <FS> Reliable packets tracked by packet id
+// The packet an expired timer is for, or NULL if it was acked or got
+// another expiration time since
+LLReliablePacket* LLCircuitData::findExpiredPacket(const LLPacketTimerWheel::Entry& expired)
+{
+    LLReliablePacket **found = mUnackedPackets.find(expired.mID);
+    if (!found || (*found)->mExpirationTime != expired.mDeadline)
+    {
+        return NULL;
+    }
+    return *found;
+}
+// </FS>
+
 
 LLCircuit::LLCircuit(const F32Seconds circuit_heartbeat_interval, const F32Seconds circuit_timeout)
 :   mLastCircuit(NULL),
@@ -577,14 +529,19 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
     mUnackedPacketCount++;
     mUnackedPacketBytes += packet_info->mBufferLength;
 
-    if (params && params->mRetries)
-    {
-        mUnackedPackets[packet_info->mPacketID] = packet_info;
-    }
-    else
-    {
-        mFinalRetryPackets[packet_info->mPacketID] = packet_info;
-    }
+    // <FS> Reliable packets tracked by packet id. Without retries, the
+    // packet is on its final try from the start.
+    //if (params && params->mRetries)
+    //{
+    //    mUnackedPackets[packet_info->mPacketID] = packet_info;
+    //}
+    //else
+    //{
+    //    mFinalRetryPackets[packet_info->mPacketID] = packet_info;
+    //}
+    mUnackedPackets.set(packet_info->mPacketID, packet_info);
+    mResendTimers.schedule(packet_info->mPacketID, packet_info->mExpirationTime);
+    // </FS>
 }
 
 
@@ -607,7 +564,7 @@ void LLCircuit::resendUnackedPackets(S32& unacked_list_length, S32& unacked_list
 
 bool LLCircuitData::isDuplicateResend(TPACKETID packetnum)
 {
-    return (mRecentlyReceivedReliablePackets.find(packetnum) != mRecentlyReceivedReliablePackets.end());
+    return mRecentlyReceivedReliablePackets.find(packetnum) != NULL; // <FS/> Reliable packets tracked by packet id
 }
 
 
@@ -719,7 +676,7 @@ void LLCircuitData::checkPacketInID(TPACKETID id, bool receive_resent)
         const U8 width = 24;
         gap = LLModularMath::subtract<width>(mPacketsInID, id);
 
-        if (mPotentialLostPackets.find(id) != mPotentialLostPackets.end())
+        if (mPotentialLostPackets.find(id)) // <FS/> Reliable packets tracked by packet id
         {
             if(gMessageSystem->mVerboseLog)
             {
@@ -748,7 +705,7 @@ void LLCircuitData::checkPacketInID(TPACKETID id, bool receive_resent)
                     }
 
 //                      LL_INFOS() << "adding potential lost: " << index << LL_ENDL;
-                    mPotentialLostPackets[index] = time;
+                    mPotentialLostPackets.set(index, time); // <FS/> Reliable packets tracked by packet id
                     index++;
                     index = index % LL_MAX_OUT_PACKET_ID;
                     gap_count++;
@@ -886,89 +843,9 @@ bool LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
     // This is to handle the case if we actually manage to wrap our
     // packet IDs - the oldest will actually have a higher packet ID
     // than the current.
-    bool wrapped = false;
-    reliable_iter iter;
-    iter = mUnackedPackets.upper_bound(getPacketOutID());
-    if (iter == mUnackedPackets.end())
-    {
-        // Nothing AFTER this one, so we want the lowest packet ID
-        // then.
-        iter = mUnackedPackets.begin();
-        wrapped = true;
-    }
-
-    TPACKETID packet_id = 0;
-
-    // Check against the "final" packets
-    bool wrapped_final = false;
-    reliable_iter iter_final;
-    iter_final = mFinalRetryPackets.upper_bound(getPacketOutID());
-    if (iter_final == mFinalRetryPackets.end())
-    {
-        iter_final = mFinalRetryPackets.begin();
-        wrapped_final = true;
-    }
-
-    //LL_INFOS() << mHost << " - unacked count " << mUnackedPackets.size() << LL_ENDL;
-    //LL_INFOS() << mHost << " - final count " << mFinalRetryPackets.size() << LL_ENDL;
-    if (wrapped != wrapped_final)
-    {
-        // One of the "unacked" or "final" lists hasn't wrapped.  Whichever one
-        // hasn't has the oldest packet.
-        if (!wrapped)
-        {
-            // Hasn't wrapped, so the one on the
-            // unacked packet list is older
-            packet_id = iter->first;
-            //LL_INFOS() << mHost << ": nowrapped unacked" << LL_ENDL;
-        }
-        else
-        {
-            packet_id = iter_final->first;
-            //LL_INFOS() << mHost << ": nowrapped final" << LL_ENDL;
-        }
-    }
-    else
-    {
-        // They both wrapped, we can just use the minimum of the two.
-        if ((iter == mUnackedPackets.end()) && (iter_final == mFinalRetryPackets.end()))
-        {
-            // Wow!  No unacked packets at all!
-            // Send the ID of the last packet we sent out.
-            // This will flush all of the destination's
-            // unacked packets, theoretically.
-            //LL_INFOS() << mHost << ": No unacked!" << LL_ENDL;
-            packet_id = getPacketOutID();
-        }
-        else
-        {
-            bool had_unacked = false;
-            if (iter != mUnackedPackets.end())
-            {
-                // Unacked list has the lowest so far
-                packet_id = iter->first;
-                had_unacked = true;
-                //LL_INFOS() << mHost << ": Unacked" << LL_ENDL;
-            }
-
-            if (iter_final != mFinalRetryPackets.end())
-            {
-                // Use the lowest of the unacked list and the final list
-                if (had_unacked)
-                {
-                    // Both had a packet, use the lowest.
-                    packet_id = llmin(packet_id, iter_final->first);
-                    //LL_INFOS() << mHost << ": Min of unacked/final" << LL_ENDL;
-                }
-                else
-                {
-                    // Only the final had a packet, use it.
-                    packet_id = iter_final->first;
-                    //LL_INFOS() << mHost << ": Final!" << LL_ENDL;
-                }
-            }
-        }
-    }
+    // <FS> Reliable packets tracked by packet id
+    TPACKETID packet_id = getOldestUnackedID();
+    // </FS>
 
     nd::etw::tickTask( L"sendingPing" ); // <FS:ND/> Write an event for each ping we send. Happens every ~5 seconds.
     // Send off the another ping.
@@ -983,37 +860,78 @@ bool LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
     // Check to see if anything on our lost list is old enough to
     // be considered lost
 
-    LLCircuitData::packet_time_map::iterator it;
+    // <FS> Reliable packets tracked by packet id
     U64Microseconds timeout = llmin(LL_MAX_LOST_TIMEOUT, F32Seconds(getPingDelayAveraged()) * LL_LOST_TIMEOUT_FACTOR);
 
     U64Microseconds mt_usec = LLMessageSystem::getMessageTimeUsecs();
-    for (it = mPotentialLostPackets.begin(); it != mPotentialLostPackets.end(); )
-    {
-        U64Microseconds delta_t_usec = mt_usec - (*it).second;
-        if (delta_t_usec > timeout)
+    std::vector<TPACKETID> lost;
+    mPotentialLostPackets.forEach([&](TPACKETID id, U64Microseconds time)
         {
-            // let's call this one a loss!
-            mPacketsLost++;
-            gMessageSystem->mDroppedPackets++;
-            if(gMessageSystem->mVerboseLog)
+            U64Microseconds delta_t_usec = mt_usec - time;
+            if (delta_t_usec > timeout)
             {
-                std::ostringstream str;
-                str << "MSG: <- " << mHost << "\tLOST PACKET:\t"
-                    << (*it).first;
-                LL_INFOS() << str.str() << LL_ENDL;
+                lost.push_back(id);
             }
-            mPotentialLostPackets.erase(it++);
-        }
-        else
+        });
+    std::sort(lost.begin(), lost.end());
+    for (TPACKETID id : lost)
+    {
+        // let's call this one a loss!
+        mPacketsLost++;
+        gMessageSystem->mDroppedPackets++;
+        if(gMessageSystem->mVerboseLog)
         {
-            ++it;
+            std::ostringstream str;
+            str << "MSG: <- " << mHost << "\tLOST PACKET:\t"
+                << id;
+            LL_INFOS() << str.str() << LL_ENDL;
         }
+        mPotentialLostPackets.erase(id);
     }
+    // </FS>
 
     return true;
 }
 
 
+// <FS> Reliable packets tracked by packet id
+// The oldest is the lowest ID above the current one if there is any, else
+// the lowest ID.
+TPACKETID LLCircuitData::getOldestUnackedID() const
+{
+    const TPACKETID out_id = getPacketOutID();
+    bool have_unacked = false;
+    bool have_wrapped = false;
+    TPACKETID lowest_id = 0;
+    TPACKETID lowest_wrapped_id = 0;
+    mUnackedPackets.forEach([&](TPACKETID id, LLReliablePacket*)
+        {
+            if (id > out_id)
+            {
+                lowest_wrapped_id = have_wrapped ? llmin(lowest_wrapped_id, id) : id;
+                have_wrapped = true;
+            }
+            lowest_id = have_unacked ? llmin(lowest_id, id) : id;
+            have_unacked = true;
+        });
+
+    if (have_wrapped)
+    {
+        return lowest_wrapped_id;
+    }
+    if (have_unacked)
+    {
+        return lowest_id;
+    }
+    // Wow!  No unacked packets at all!
+    // Send the ID of the last packet we sent out.
+    // This will flush all of the destination's
+    // unacked packets, theoretically.
+    return out_id;
+}
+// </FS>
+
+
 void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
 {
     // purge old data from the duplicate suppression queue
@@ -1022,43 +940,49 @@ void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
 
     //LL_INFOS() << mHost << ": clearing before oldest " << oldest_id << LL_ENDL;
     //LL_INFOS() << "Recent list before: " << mRecentlyReceivedReliablePackets.size() << LL_ENDL;
-    if (oldest_id < mHighestPacketID)
-    {
-        // Clean up everything with a packet ID less than oldest_id.
-        packet_time_map::iterator pit_start;
-        packet_time_map::iterator pit_end;
-        pit_start = mRecentlyReceivedReliablePackets.begin();
-        pit_end = mRecentlyReceivedReliablePackets.lower_bound(oldest_id);
-        mRecentlyReceivedReliablePackets.erase(pit_start, pit_end);
-    }
-
-    // Do timeout checks on everything with an ID > mHighestPacketID.
-    // This should be empty except for wrapping IDs.  Thus, this should be
-    // highly rare.
+    // <FS> Reliable packets tracked by packet id
+    // Clean up everything with a packet ID less than oldest_id, and do
+    // timeout checks on everything with an ID > mHighestPacketID.
+    // The latter should be empty except for wrapping IDs.  Thus, this
+    // should be highly rare.
     U64Microseconds mt_usec = LLMessageSystem::getMessageTimeUsecs();
 
-    packet_time_map::iterator pit;
-    for(pit = mRecentlyReceivedReliablePackets.upper_bound(mHighestPacketID);
-        pit != mRecentlyReceivedReliablePackets.end(); )
-    {
-        // Validate that the packet ID seems far enough away
-        if ((pit->first - mHighestPacketID) < 100)
+    std::vector<TPACKETID> cleared;
+    std::vector<TPACKETID> timed_out;
+    mRecentlyReceivedReliablePackets.forEach([&](TPACKETID id, U64Microseconds time)
         {
-            LL_WARNS() << "Probably incorrectly timing out non-wrapped packets!" << LL_ENDL;
-        }
-        U64Microseconds delta_t_usec = mt_usec - (*pit).second;
-        F64Seconds delta_t_sec = delta_t_usec;
-        if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
-        {
-            // enough time has elapsed we're not likely to get a duplicate on this one
-            LL_INFOS() << "Clearing " << pit->first << " from recent list" << LL_ENDL;
-            mRecentlyReceivedReliablePackets.erase(pit++);
-        }
-        else
-        {
-            ++pit;
-        }
+            if (oldest_id < mHighestPacketID && id < oldest_id)
+            {
+                cleared.push_back(id);
+            }
+            else if (id > mHighestPacketID)
+            {
+                // Validate that the packet ID seems far enough away
+                if ((id - mHighestPacketID) < 100)
+                {
+                    LL_WARNS() << "Probably incorrectly timing out non-wrapped packets!" << LL_ENDL;
+                }
+                U64Microseconds delta_t_usec = mt_usec - time;
+                F64Seconds delta_t_sec = delta_t_usec;
+                if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
+                {
+                    // enough time has elapsed we're not likely to get a duplicate on this one
+                    timed_out.push_back(id);
+                }
+            }
+        });
+
+    for (TPACKETID id : cleared)
+    {
+        mRecentlyReceivedReliablePackets.erase(id);
+    }
+    std::sort(timed_out.begin(), timed_out.end());
+    for (TPACKETID id : timed_out)
+    {
+        LL_INFOS() << "Clearing " << id << " from recent list" << LL_ENDL;
+        mRecentlyReceivedReliablePackets.erase(id);
     }
+    // </FS>
     //LL_INFOS() << "Recent list after: " << mRecentlyReceivedReliablePackets.size() << LL_ENDL;
 }
 
@@ -37,6 +37,7 @@
 #include "net.h"
 #include "llhost.h"
 #include "llpacketack.h"
+#include "llpacketidring.h" // <FS/> Reliable packets tracked by packet id
 #include "lluuid.h"
 #include "llthrottle.h"
 
@@ -176,6 +177,10 @@ protected:
     bool            updateWatchDogTimers(LLMessageSystem *msgsys);  // Return false if the circuit is dead and should be cleaned up
 
     void            addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLReliablePacketParams *params);
+    // <FS> Reliable packets tracked by packet id
+    LLReliablePacket* findExpiredPacket(const LLPacketTimerWheel::Entry& expired);
+    TPACKETID       getOldestUnackedID() const;     // for StartPingCheck, aware of wrapped ids
+    // </FS>
     bool            isDuplicateResend(TPACKETID packetnum);
     // Call this method when a reliable message comes in - this will
     // correctly place the packet in the correct list to be acked
@@ -233,18 +238,31 @@ protected:
     U32Milliseconds     mPingDelay;             // raw ping delay
     F32Milliseconds     mPingDelayAveraged;     // averaged ping delay (fast attack/slow decay)
 
-    typedef std::map<TPACKETID, U64Microseconds> packet_time_map;
+    // <FS> Reliable packets tracked by packet id
+    //typedef std::map<TPACKETID, U64Microseconds> packet_time_map;
+    typedef LLPacketIDRing<U64Microseconds> packet_time_map;
+    // </FS>
 
     packet_time_map                         mPotentialLostPackets;
     packet_time_map                         mRecentlyReceivedReliablePackets;
     std::vector<TPACKETID> mAcks;
     F32 mAckCreationTime; // first ack creation time
 
-    typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
-    typedef reliable_map::iterator                  reliable_iter;
+    // <FS> Reliable packets tracked by packet id. The packets that still
+    // have retries left and the ones on their final try are in the same
+    // ring, told apart by mRetries, and the wheel holds their expiration
+    // times.
+    //typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
+    //typedef reliable_map::iterator                  reliable_iter;
+    //
+    //reliable_map                            mUnackedPackets;
+    //reliable_map                            mFinalRetryPackets;
+    typedef LLPacketIDRing<LLReliablePacket *> reliable_map;
 
     reliable_map                            mUnackedPackets;
-    reliable_map                            mFinalRetryPackets;
+    LLPacketTimerWheel                      mResendTimers;
+    std::vector<LLPacketTimerWheel::Entry>  mExpiredResends;    // scratch for resendUnackedPackets()
+    // </FS>
 
     S32                                     mUnackedPacketCount;
     S32                                     mUnackedPacketBytes;
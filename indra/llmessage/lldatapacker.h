@@ -185,6 +185,8 @@ public:
                 void        reset()             { mCurBufferp = mBufferp; mWriteEnabled = (mCurBufferp != NULL); }
                 void        shift(S32 offset)   { reset(); mCurBufferp += offset;}
                 void        freeBuffer()        { delete [] mBufferp; mBufferp = mCurBufferp = NULL; mBufferSize = 0; mWriteEnabled = false; }
+                // forget a buffer owned elsewhere, without deleting it
+                void        detachBuffer()      { mBufferp = mCurBufferp = NULL; mBufferSize = 0; mWriteEnabled = false; }
                 void        assignBuffer(U8 *bufferp, S32 size)
                 {
                     if(mBufferp && mBufferp != bufferp)
@@ -171,6 +171,37 @@ std::ostream& operator<<(std::ostream& s, LLMessageTemplate &msg)
     return s;
 }
 
+// <FS> Names are canonical strings from the message string table
+S32 LLMessageTemplate::getBlockIndex(const char* name) const
+{
+    for (S32 block = 0; block < (S32)mDecodeBlocks.size(); ++block)
+    {
+        if (mDecodeBlocks[block].mName == name)
+        {
+            return block;
+        }
+    }
+    return -1;
+}
+
+S32 LLMessageTemplate::getVariableIndex(S32 block, const char* name) const
+{
+    if (block < 0 || block >= (S32)mDecodeBlocks.size())
+    {
+        return -1;
+    }
+    const DecodeBlock& decode_block = mDecodeBlocks[block];
+    for (S32 variable = 0; variable < decode_block.mVariableCount; ++variable)
+    {
+        if (mDecodeVariables[decode_block.mFirstVariable + variable].mName == name)
+        {
+            return variable;
+        }
+    }
+    return -1;
+}
+// </FS>
+
 void LLMessageTemplate::banUdp()
 {
     static const char* deprecation[] = {
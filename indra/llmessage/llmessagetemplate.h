@@ -319,6 +319,24 @@ public:
         {
             mTotalSize = -1;
         }
+
+        // <FS> Blocks are complete when they are added, see LLTemplateParser::parseMessage()
+        DecodeBlock decode_block;
+        decode_block.mName = blockp->mName;
+        decode_block.mType = blockp->mType;
+        decode_block.mNumber = blockp->mNumber;
+        decode_block.mFirstVariable = (S32)mDecodeVariables.size();
+        decode_block.mVariableCount = (S32)blockp->mMemberVariables.size();
+        mDecodeBlocks.push_back(decode_block);
+        for (const LLMessageVariable* variablep : blockp->mMemberVariables)
+        {
+            DecodeVariable decode_variable;
+            decode_variable.mName = variablep->getName();
+            decode_variable.mType = variablep->getType();
+            decode_variable.mSize = variablep->getSize();
+            mDecodeVariables.push_back(decode_variable);
+        }
+        // </FS>
     }
 
     LLMessageBlock *getBlock(char *name)
@@ -326,6 +344,12 @@ public:
         return mMemberBlocks[name];
     }
 
+    // <FS> Index of the block in mDecodeBlocks, and of a variable among the
+    // ones of its block, -1 when there is none of that name
+    S32 getBlockIndex(const char* name) const;
+    S32 getVariableIndex(S32 block, const char* name) const;
+    // </FS>
+
     // Trusted messages can only be recieved on trusted circuits.
     void setTrust(EMsgTrust t)
     {
@@ -430,6 +454,28 @@ public:
     bool                                    mBanFromTrusted;
     bool                                    mBanFromUntrusted;
 
+    // <FS> The blocks and variables in wire order, in flat arrays for
+    // LLTemplateMessageReader::decodeData()
+    struct DecodeBlock
+    {
+        char*                               mName;
+        EMsgBlockType                       mType;
+        S32                                 mNumber;
+        S32                                 mFirstVariable;     // index in mDecodeVariables
+        S32                                 mVariableCount;
+    };
+
+    struct DecodeVariable
+    {
+        char*                               mName;
+        EMsgVariableType                    mType;
+        S32                                 mSize;              // of the size field for MVT_VARIABLE
+    };
+
+    std::vector<DecodeBlock>                mDecodeBlocks;
+    std::vector<DecodeVariable>             mDecodeVariables;
+    // </FS>
+
 private:
     // message handler function (this is set by each application)
     void                                    (*mHandlerFunc)(LLMessageSystem *msgsystem, void **user_data);
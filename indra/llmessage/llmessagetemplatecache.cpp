@@ -0,0 +1,316 @@
+/**
+ * @file llmessagetemplatecache.cpp
+ * @brief Compiled binary form of message_template.msg
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagetemplatecache.h"
+
+#include "hbxxh.h"
+#include "llfile.h"
+#include "llmessagetemplate.h"
+
+#include <vector>
+
+// Bump when the layout, or what the tables mean, changes
+static const char CACHE_MAGIC[4] = { 'L', 'L', 'M', 'T' };
+static const U32 CACHE_VERSION = 1;
+
+// The file holds a Header, the Message, Block and Variable tables, then the
+// names, each followed by a NUL. Offsets are from the start of the file.
+struct LLMessageTemplateCache::Header
+{
+    char    mMagic[4];
+    U32     mVersion;
+    U64     mSourceHash;
+    F32     mTemplateVersion;
+    U32     mMessageCount;
+    U32     mBlockCount;
+    U32     mVariableCount;
+};
+
+struct LLMessageTemplateCache::Message
+{
+    U32     mName;
+    U32     mNameSize;
+    U32     mNumber;
+    U8      mFrequency;     // EMsgFrequency
+    U8      mTrust;         // EMsgTrust
+    U8      mEncoding;      // EMsgEncoding
+    U8      mDeprecation;   // EMsgDeprecation
+    U32     mFirstBlock;
+    U32     mBlockCount;
+};
+
+struct LLMessageTemplateCache::Block
+{
+    U32     mName;
+    U32     mNameSize;
+    U32     mType;          // EMsgBlockType
+    S32     mNumber;
+    U32     mFirstVariable;
+    U32     mVariableCount;
+};
+
+struct LLMessageTemplateCache::Variable
+{
+    U32     mName;
+    U32     mNameSize;
+    U32     mType;          // EMsgVariableType
+    S32     mSize;
+};
+
+// static
+U64 LLMessageTemplateCache::hashSource(const std::string& source)
+{
+    return HBXXH64::digest(source);
+}
+
+bool LLMessageTemplateCache::open(const std::string& filename, U64 source_hash)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    close();
+
+    if (!mFile.open(filename))
+    {
+        return false;
+    }
+
+    const U8* data = mFile.data();
+    const size_t file_size = mFile.size();
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (file_size < sizeof(Header)
+        || memcmp(header->mMagic, CACHE_MAGIC, sizeof(CACHE_MAGIC))
+        || header->mVersion != CACHE_VERSION
+        || header->mSourceHash != source_hash)
+    {
+        close();
+        return false;
+    }
+
+    const U64 tables_size = (U64)header->mMessageCount * sizeof(Message)
+        + (U64)header->mBlockCount * sizeof(Block)
+        + (U64)header->mVariableCount * sizeof(Variable);
+    bool valid = sizeof(Header) + tables_size <= file_size;
+
+    // a name must be in the file, NUL terminated, and fit the string table
+    auto valid_name = [&](U32 offset, U32 size)
+    {
+        return size > 0 && size < MESSAGE_MAX_STRINGS_LENGTH
+            && (U64)offset + size < file_size && data[offset + size] == 0;
+    };
+
+    const Message* messages = reinterpret_cast<const Message*>(data + sizeof(Header));
+    const Block* blocks = reinterpret_cast<const Block*>(messages + header->mMessageCount);
+    const Variable* variables = reinterpret_cast<const Variable*>(blocks + header->mBlockCount);
+    for (U32 i = 0; valid && i < header->mMessageCount; ++i)
+    {
+        const Message& message = messages[i];
+        valid = valid_name(message.mName, message.mNameSize)
+            && (U64)message.mFirstBlock + message.mBlockCount <= header->mBlockCount
+            && (message.mFrequency == MFT_HIGH || message.mFrequency == MFT_MEDIUM || message.mFrequency == MFT_LOW)
+            && message.mTrust <= MT_NOTRUST
+            && message.mEncoding <= ME_ZEROCODED
+            && message.mDeprecation <= MD_DEPRECATED;
+    }
+    for (U32 i = 0; valid && i < header->mBlockCount; ++i)
+    {
+        const Block& block = blocks[i];
+        valid = valid_name(block.mName, block.mNameSize)
+            && (U64)block.mFirstVariable + block.mVariableCount <= header->mVariableCount
+            && block.mType > MBT_NULL && block.mType < MBT_EOF;
+    }
+    for (U32 i = 0; valid && i < header->mVariableCount; ++i)
+    {
+        const Variable& variable = variables[i];
+        valid = valid_name(variable.mName, variable.mNameSize)
+            && variable.mType > MVT_NULL && variable.mType < MVT_EOL;
+    }
+
+    if (!valid)
+    {
+        LL_WARNS("Messaging") << "Corrupt message template cache " << filename << LL_ENDL;
+        close();
+        return false;
+    }
+
+    mMessageCount = (S32)header->mMessageCount;
+    return true;
+}
+
+void LLMessageTemplateCache::close()
+{
+    mFile.close();
+    mMessageCount = 0;
+}
+
+// static
+bool LLMessageTemplateCache::write(const std::string& filename, U64 source_hash, F32 version, const template_list_t& templates)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    Header header;
+    memcpy(header.mMagic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.mVersion = CACHE_VERSION;
+    header.mSourceHash = source_hash;
+    header.mTemplateVersion = version;
+    header.mMessageCount = (U32)templates.size();
+    header.mBlockCount = 0;
+    header.mVariableCount = 0;
+    for (const LLMessageTemplate* templatep : templates)
+    {
+        header.mBlockCount += (U32)templatep->mDecodeBlocks.size();
+        header.mVariableCount += (U32)templatep->mDecodeVariables.size();
+    }
+
+    std::vector<Message> messages;
+    std::vector<Block> blocks;
+    std::vector<Variable> variables;
+    messages.reserve(header.mMessageCount);
+    blocks.reserve(header.mBlockCount);
+    variables.reserve(header.mVariableCount);
+
+    std::string names;
+    const size_t names_offset = sizeof(Header) + header.mMessageCount * sizeof(Message)
+        + header.mBlockCount * sizeof(Block) + header.mVariableCount * sizeof(Variable);
+    auto add_name = [&](const char* name, U32& offset, U32& size)
+    {
+        offset = (U32)(names_offset + names.size());
+        size = (U32)strlen(name);
+        names.append(name, size + 1);
+    };
+
+    for (const LLMessageTemplate* templatep : templates)
+    {
+        Message message;
+        add_name(templatep->mName, message.mName, message.mNameSize);
+        message.mNumber = templatep->mMessageNumber;
+        message.mFrequency = (U8)templatep->mFrequency;
+        message.mTrust = (U8)templatep->getTrust();
+        message.mEncoding = (U8)templatep->getEncoding();
+        message.mDeprecation = (U8)templatep->getDeprecation();
+        message.mFirstBlock = (U32)blocks.size();
+        message.mBlockCount = (U32)templatep->mDecodeBlocks.size();
+        messages.push_back(message);
+
+        for (const LLMessageTemplate::DecodeBlock& decode_block : templatep->mDecodeBlocks)
+        {
+            Block block;
+            add_name(decode_block.mName, block.mName, block.mNameSize);
+            block.mType = (U32)decode_block.mType;
+            block.mNumber = decode_block.mNumber;
+            block.mFirstVariable = (U32)variables.size();
+            block.mVariableCount = (U32)decode_block.mVariableCount;
+            blocks.push_back(block);
+
+            for (S32 i = 0; i < decode_block.mVariableCount; ++i)
+            {
+                const LLMessageTemplate::DecodeVariable& decode_variable = templatep->mDecodeVariables[decode_block.mFirstVariable + i];
+                Variable variable;
+                add_name(decode_variable.mName, variable.mName, variable.mNameSize);
+                variable.mType = (U32)decode_variable.mType;
+                variable.mSize = decode_variable.mSize;
+                variables.push_back(variable);
+            }
+        }
+    }
+
+    // Write next to it and rename, another instance may have it mapped
+    const std::string temp_filename = filename + ".tmp";
+    {
+        llofstream file(temp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)messages.data(), messages.size() * sizeof(Message));
+        file.write((const char*)blocks.data(), blocks.size() * sizeof(Block));
+        file.write((const char*)variables.data(), variables.size() * sizeof(Variable));
+        file.write(names.data(), names.size());
+        if (!file.good())
+        {
+            file.close();
+            LLFile::remove(temp_filename);
+            return false;
+        }
+    }
+
+    if (LLFile::rename(temp_filename, filename))
+    {
+        LLFile::remove(temp_filename);
+        return false;
+    }
+    return true;
+}
+
+const LLMessageTemplateCache::Header* LLMessageTemplateCache::getHeader() const
+{
+    return reinterpret_cast<const Header*>(mFile.data());
+}
+
+std::string_view LLMessageTemplateCache::getString(U32 offset, U32 size) const
+{
+    return std::string_view((const char*)mFile.data() + offset, size);
+}
+
+F32 LLMessageTemplateCache::getVersion() const
+{
+    return mMessageCount ? getHeader()->mTemplateVersion : 0.f;
+}
+
+std::string_view LLMessageTemplateCache::getMessageName(S32 message) const
+{
+    const Message* messages = reinterpret_cast<const Message*>(getHeader() + 1);
+    return getString(messages[message].mName, messages[message].mNameSize);
+}
+
+LLMessageTemplate* LLMessageTemplateCache::createTemplate(S32 message_index) const
+{
+    const Header* header = getHeader();
+    const Message* messages = reinterpret_cast<const Message*>(header + 1);
+    const Block* blocks = reinterpret_cast<const Block*>(messages + header->mMessageCount);
+    const Variable* variables = reinterpret_cast<const Variable*>(blocks + header->mBlockCount);
+    const char* names = (const char*)mFile.data();
+
+    // the names are NUL terminated in the file, see open()
+    const Message& message = messages[message_index];
+    LLMessageTemplate* templatep = new LLMessageTemplate(names + message.mName, message.mNumber, (EMsgFrequency)message.mFrequency);
+    templatep->setTrust((EMsgTrust)message.mTrust);
+    templatep->setEncoding((EMsgEncoding)message.mEncoding);
+    templatep->setDeprecation((EMsgDeprecation)message.mDeprecation);
+    for (U32 b = message.mFirstBlock; b < message.mFirstBlock + message.mBlockCount; ++b)
+    {
+        const Block& block = blocks[b];
+        LLMessageBlock* blockp = new LLMessageBlock(names + block.mName, (EMsgBlockType)block.mType, block.mNumber);
+        for (U32 v = block.mFirstVariable; v < block.mFirstVariable + block.mVariableCount; ++v)
+        {
+            const Variable& variable = variables[v];
+            blockp->addVariable(LLMessageStringTable::getInstance()->getString(names + variable.mName),
+                                (EMsgVariableType)variable.mType, variable.mSize);
+        }
+        templatep->addBlock(blockp);
+    }
+    return templatep;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file llmessagetemplatecache.h
+ * @brief Compiled binary form of message_template.msg
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGETEMPLATECACHE_H
+#define LL_LLMESSAGETEMPLATECACHE_H
+
+#include "llmappedfile.h"
+
+#include <list>
+#include <string>
+#include <string_view>
+
+class LLMessageTemplate;
+
+//
+// The messages of a template file as LLTemplateParser reads them, compiled
+// into three flat tables: the messages, then all their blocks, then all
+// their variables. A message names its blocks, and a block its variables,
+// as a range of the next table, in wire order. The index of a block or
+// variable within its range is the one of LLMessageTemplate::mDecodeBlocks
+// and mDecodeVariables.
+//
+// The cache records the hash of the template text it was compiled from, and
+// open() refuses it when the text is different.
+//
+class LLMessageTemplateCache
+{
+public:
+    typedef std::list<LLMessageTemplate*> template_list_t;
+
+    // Hash of the template text, which open() and write() key the cache on
+    static U64 hashSource(const std::string& source);
+
+    // Maps filename when it was compiled from a template text of that hash
+    bool open(const std::string& filename, U64 source_hash);
+    void close();
+
+    // Writes the cache of templates, parsed from a text of that hash
+    static bool write(const std::string& filename, U64 source_hash, F32 version, const template_list_t& templates);
+
+    F32 getVersion() const;
+    S32 getMessageCount() const { return mMessageCount; }
+    std::string_view getMessageName(S32 message) const;
+
+    // New template of the message, its names interned in the message string
+    // table. The caller owns it.
+    LLMessageTemplate* createTemplate(S32 message) const;
+
+private:
+    struct Header;
+    struct Message;
+    struct Block;
+    struct Variable;
+
+    const Header* getHeader() const;
+    std::string_view getString(U32 offset, U32 size) const;
+
+    LLMappedFile    mFile;
+    S32             mMessageCount{ 0 };
+};
+
+#endif // LL_LLMESSAGETEMPLATECACHE_H
@@ -82,3 +82,11 @@ void LLPacketBuffer::init(const char* buffer, S32 data_size, const LLHost& host)
     }
 }
 
+// <FS> Batched UDP I/O
+void LLPacketBuffer::init(S32 data_size, const LLHost& host, const LLHost& receiving_if)
+{
+    mSize = data_size;
+    mHost = host;
+    mReceivingIF = receiving_if;
+}
+// </FS>
@@ -46,6 +46,11 @@ public:
     void init(S32 hSocket);
     void init(const char* buffer, S32 data_size, const LLHost& host);
 
+    // <FS> Batched UDP I/O: the data was received in place by receive_packets()
+    char        *getData()                      { return mData; }
+    void init(S32 data_size, const LLHost& host, const LLHost& receiving_if);
+    // </FS>
+
 protected:
     char    mData[NET_BUFFER_SIZE]; // packet data       /* Flawfinder : ignore */
     S32     mSize;                  // size of buffer in bytes
@@ -0,0 +1,285 @@
+/**
+ * @file llpacketidring.h
+ * @brief Packet id keyed ring and resend timer wheel for LLCircuitData
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETIDRING_H
+#define LL_LLPACKETIDRING_H
+
+#include <cmath>
+#include <vector>
+
+#include "llunits.h"
+
+//-----------------------------------------------------------------------------
+// LLPacketIDRing
+// A set of packet ids with a value each, in a ring of slots indexed by the
+// packet id modulo the capacity. The ids a circuit tracks are mostly a run
+// of consecutive ones, so they land in consecutive slots, and an id whose
+// slot is taken goes to the next free one. The ring is kept at most half
+// full and never shrinks, so a busy circuit stops allocating once it has
+// grown to its working set.
+//-----------------------------------------------------------------------------
+template <typename T>
+class LLPacketIDRing
+{
+public:
+    LLPacketIDRing()
+    :   mMask(0),
+        mCount(0)
+    {
+    }
+
+    bool empty() const { return mCount == 0; }
+    S32 size() const { return mCount; }
+
+    // NULL if the id is not in the ring
+    T* find(TPACKETID id)
+    {
+        const S32 slot = findSlot(id);
+        return slot < 0 ? NULL : &mSlots[slot].mValue;
+    }
+
+    const T* find(TPACKETID id) const
+    {
+        const S32 slot = findSlot(id);
+        return slot < 0 ? NULL : &mSlots[slot].mValue;
+    }
+
+    // Adds the id, or replaces its value
+    void set(TPACKETID id, const T& value)
+    {
+        if ((U32)(mCount + 1) * 2 > (U32)mSlots.size())
+        {
+            grow();
+        }
+
+        U32 slot = id & mMask;
+        while (mSlots[slot].mID != EMPTY_ID && mSlots[slot].mID != id)
+        {
+            slot = (slot + 1) & mMask;
+        }
+        if (mSlots[slot].mID == EMPTY_ID)
+        {
+            ++mCount;
+        }
+        mSlots[slot].mID = id;
+        mSlots[slot].mValue = value;
+    }
+
+    // Returns false if the id was not in the ring
+    bool erase(TPACKETID id)
+    {
+        const S32 found = findSlot(id);
+        if (found < 0)
+        {
+            return false;
+        }
+
+        // Pull back the ids after the hole that could not have their own
+        // slot when they were added, so that find() never stops early.
+        U32 hole = found;
+        U32 slot = found;
+        while (true)
+        {
+            slot = (slot + 1) & mMask;
+            if (mSlots[slot].mID == EMPTY_ID)
+            {
+                break;
+            }
+            const U32 home = mSlots[slot].mID & mMask;
+            if (((slot - home) & mMask) >= ((slot - hole) & mMask))
+            {
+                mSlots[hole] = mSlots[slot];
+                hole = slot;
+            }
+        }
+        mSlots[hole].mID = EMPTY_ID;
+        mSlots[hole].mValue = T();
+        --mCount;
+        return true;
+    }
+
+    void clear()
+    {
+        for (Slot& slot : mSlots)
+        {
+            slot.mID = EMPTY_ID;
+            slot.mValue = T();
+        }
+        mCount = 0;
+    }
+
+    // Calls func(id, value) on every id, in no particular order. func must
+    // not add or erase ids.
+    template <typename F>
+    void forEach(F func) const
+    {
+        if (!mCount)
+        {
+            return;
+        }
+        for (const Slot& slot : mSlots)
+        {
+            if (slot.mID != EMPTY_ID)
+            {
+                func(slot.mID, slot.mValue);
+            }
+        }
+    }
+
+private:
+    // Packet ids are 24 bits
+    static constexpr TPACKETID EMPTY_ID = 0xFFFFFFFF;
+    static constexpr U32 MIN_CAPACITY = 64;
+
+    struct Slot
+    {
+        Slot() : mID(EMPTY_ID), mValue() {}
+
+        TPACKETID mID;
+        T mValue;
+    };
+
+    S32 findSlot(TPACKETID id) const
+    {
+        if (!mCount)
+        {
+            return -1;
+        }
+        for (U32 slot = id & mMask; ; slot = (slot + 1) & mMask)
+        {
+            if (mSlots[slot].mID == id)
+            {
+                return (S32)slot;
+            }
+            if (mSlots[slot].mID == EMPTY_ID)
+            {
+                return -1;
+            }
+        }
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old_slots(llmax((U32)mSlots.size() * 2, MIN_CAPACITY));
+        old_slots.swap(mSlots);
+        mMask = (U32)mSlots.size() - 1;
+        mCount = 0;
+        for (const Slot& slot : old_slots)
+        {
+            if (slot.mID != EMPTY_ID)
+            {
+                set(slot.mID, slot.mValue);
+            }
+        }
+    }
+
+    std::vector<Slot> mSlots;
+    U32 mMask;
+    S32 mCount;
+};
+
+//-----------------------------------------------------------------------------
+// LLPacketTimerWheel
+// Resend deadlines of reliable packets, bucketed by time in a wheel of
+// SLOT_COUNT slots of 1/TICKS_PER_SECOND seconds. collectExpired() only
+// looks at the slots time went through since the last call, plus the
+// current one, instead of at every packet waiting for an ack. Deadlines
+// further away than a turn of the wheel wait in their slot for the turns
+// to pass.
+//
+// Entries are not removed when a packet is acked or gets a new deadline:
+// the owner checks each expired entry against the packet it names and
+// drops the stale ones.
+//-----------------------------------------------------------------------------
+class LLPacketTimerWheel
+{
+public:
+    struct Entry
+    {
+        TPACKETID   mID;
+        F64Seconds  mDeadline;
+    };
+
+    static constexpr S32 SLOT_COUNT = 512;
+    static constexpr S32 TICKS_PER_SECOND = 64;
+
+    LLPacketTimerWheel()
+    :   mSlots(SLOT_COUNT),
+        mCurrentTick(0)
+    {
+    }
+
+    void schedule(TPACKETID id, F64Seconds deadline)
+    {
+        // a deadline already behind the wheel expires on the next call
+        const S64 tick = llmax(toTick(deadline), mCurrentTick);
+        mSlots[tick & (SLOT_COUNT - 1)].push_back({ id, deadline });
+    }
+
+    // Appends the entries whose deadline is before now to expired
+    void collectExpired(F64Seconds now, std::vector<Entry>& expired)
+    {
+        const S64 now_tick = toTick(now);
+        for (S64 tick = llmax(mCurrentTick, now_tick - SLOT_COUNT + 1); tick <= now_tick; ++tick)
+        {
+            std::vector<Entry>& slot = mSlots[tick & (SLOT_COUNT - 1)];
+            size_t kept = 0;
+            for (size_t i = 0; i < slot.size(); ++i)
+            {
+                if (now > slot[i].mDeadline)
+                {
+                    expired.push_back(slot[i]);
+                }
+                else
+                {
+                    slot[kept++] = slot[i];
+                }
+            }
+            slot.resize(kept);
+        }
+        // the current slot is looked at again on the next call
+        mCurrentTick = llmax(mCurrentTick, now_tick);
+    }
+
+    void clear()
+    {
+        for (std::vector<Entry>& slot : mSlots)
+        {
+            slot.clear();
+        }
+    }
+
+private:
+    static S64 toTick(F64Seconds time)
+    {
+        return (S64)std::floor(time.value() * TICKS_PER_SECOND);
+    }
+
+    std::vector<std::vector<Entry> > mSlots;
+    S64 mCurrentTick;
+};
+
+#endif // LL_LLPACKETIDRING_H
@@ -63,6 +63,13 @@ LLPacketRing::~LLPacketRing ()
         delete packet;
     }
     mPacketRing.clear();
+    // <FS> Batched UDP I/O
+    for (auto packet : mOutboundPackets)
+    {
+        delete packet;
+    }
+    mOutboundPackets.clear();
+    // </FS>
     mNumBufferedPackets = 0;
     mNumBufferedBytes = 0;
     mHeadIndex = 0;
@@ -71,6 +78,16 @@ LLPacketRing::~LLPacketRing ()
 S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
     bool drop = computeDrop();
+    // <FS> Batched UDP I/O: read what the socket has into the ring, then
+    // deliver (or drop) it from there one packet at a time
+    if (mNumBufferedPackets == 0 && useBatchIO())
+    {
+        if (bufferInboundPackets(socket) == 0)
+        {
+            return 0;
+        }
+    }
+    // </FS>
     return (mNumBufferedPackets > 0) ?
         receiveOrDropBufferedPacket(datap, drop) :
         receiveOrDropPacket(socket, datap, drop);
@@ -104,9 +121,135 @@ bool send_packet_helper(int socket, const char * datap, S32 data_size, LLHost ho
 bool LLPacketRing::sendPacket(int socket, const char * datap, S32 data_size, LLHost host)
 {
     mActualBytesOut += data_size;
+    // <FS> Batched UDP I/O
+    if (mSendBatchOpen && useBatchIO())
+    {
+        if (mNumOutboundPackets == (S32)mOutboundPackets.size()
+            || (mNumOutboundPackets > 0 && socket != mOutboundSocket))
+        {
+            flushOutboundPackets();
+        }
+        mOutboundSocket = socket;
+        mOutboundPackets[mNumOutboundPackets++]->init(datap, data_size, host);
+        // failures are counted by endSendBatch()
+        return true;
+    }
+    // </FS>
     return send_packet_helper(socket, datap, data_size, host);
 }
 
+// <FS> Batched UDP I/O
+bool LLPacketRing::useBatchIO() const
+{
+#if LL_LINUX
+    return mBatchIO && !LLProxy::isSOCKSProxyEnabled();
+#else
+    return false;
+#endif
+}
+
+void LLPacketRing::beginSendBatch()
+{
+#if LL_LINUX
+    if (mOutboundPackets.empty())
+    {
+        LLHost invalid_host;
+        mOutboundPackets.resize(NET_BATCH_SIZE, nullptr);
+        for (auto& packet : mOutboundPackets)
+        {
+            packet = new LLPacketBuffer(invalid_host, nullptr, 0);
+        }
+    }
+    mSendBatchOpen = true;
+#endif
+}
+
+S32 LLPacketRing::endSendBatch()
+{
+    mSendBatchOpen = false;
+    return flushOutboundPackets();
+}
+
+S32 LLPacketRing::flushOutboundPackets()
+{
+    S32 failed = 0;
+#if LL_LINUX
+    if (mNumOutboundPackets > 0)
+    {
+        const char* buffers[NET_BATCH_SIZE];
+        S32 sizes[NET_BATCH_SIZE];
+        LLHost recipients[NET_BATCH_SIZE];
+        for (S32 i = 0; i < mNumOutboundPackets; ++i)
+        {
+            const LLPacketBuffer* packet = mOutboundPackets[i];
+            buffers[i] = packet->getData();
+            sizes[i] = packet->getSize();
+            recipients[i] = packet->getHost();
+        }
+        failed = send_packets(mOutboundSocket, buffers, sizes, recipients, mNumOutboundPackets);
+        mNumOutboundPackets = 0;
+    }
+#endif
+    return failed;
+}
+
+S32 LLPacketRing::bufferInboundPackets(S32 socket)
+{
+#if LL_LINUX
+    if (mNumBufferedPackets == mPacketRing.size() && mNumBufferedPackets < MAX_BUFFER_RING_SIZE)
+    {
+        expandRing();
+    }
+
+    const S16 ring_size = (S16)(mPacketRing.size());
+    const S32 count = llmin(ring_size - mNumBufferedPackets, NET_BATCH_SIZE);
+    if (count <= 0)
+    {
+        // the ring is full at its largest: overwrite the oldest packet, as
+        // bufferInboundPacket() does
+        return bufferInboundPacket(socket) > 0 ? 1 : 0;
+    }
+
+    // the free slots after mHeadIndex receive in place
+    char* buffers[NET_BATCH_SIZE];
+    S32 sizes[NET_BATCH_SIZE];
+    LLHost senders[NET_BATCH_SIZE];
+    U32 receiving_ifs[NET_BATCH_SIZE];
+    for (S32 i = 0; i < count; ++i)
+    {
+        buffers[i] = mPacketRing[(mHeadIndex + i) % ring_size]->getData();
+    }
+    const S32 received = receive_packets(socket, buffers, sizes, senders, receiving_ifs, count);
+
+    S16 buffered = 0;
+    for (S32 i = 0; i < received; ++i)
+    {
+        if (sizes[i] <= 0)
+        {
+            // empty datagram: the next packet takes its slot
+            continue;
+        }
+        mActualBytesIn += sizes[i];
+
+        const S16 index = (mHeadIndex + i) % ring_size;
+        const S16 buffered_index = (mHeadIndex + buffered) % ring_size;
+        if (index != buffered_index)
+        {
+            std::swap(mPacketRing[index], mPacketRing[buffered_index]);
+        }
+        mPacketRing[buffered_index]->init(sizes[i], senders[i], LLHost(receiving_ifs[i], INVALID_PORT));
+        mNumBufferedBytes += sizes[i];
+        ++buffered;
+    }
+    mHeadIndex = (mHeadIndex + buffered) % ring_size;
+    mNumBufferedPackets += buffered;
+    return buffered;
+#else
+    return bufferInboundPacket(socket) > 0 ? 1 : 0;
+#endif
+}
+// </FS>
+
 void LLPacketRing::dropPackets (U32 num_to_drop)
 {
     mPacketsToDrop += num_to_drop;
@@ -302,12 +445,34 @@ S32 LLPacketRing::drainSocket(S32 socket)
     S32 packet_size = 1;
     S32 num_loops = 0;
     S32 old_num_packets = mNumBufferedPackets;
-    while (packet_size > 0)
+    // <FS> Batched UDP I/O
+    //while (packet_size > 0)
+    //{
+    //    packet_size = bufferInboundPacket(socket);
+    //    ++num_loops;
+    //}
+    //S32 num_dropped_packets = (num_loops - 1 + old_num_packets) - mNumBufferedPackets;
+    S32 num_received = 0;
+    if (useBatchIO())
+    {
+        S32 num_packets = 1;
+        while (num_packets > 0)
+        {
+            num_packets = bufferInboundPackets(socket);
+            num_received += num_packets;
+        }
+    }
+    else
     {
-        packet_size = bufferInboundPacket(socket);
-        ++num_loops;
+        while (packet_size > 0)
+        {
+            packet_size = bufferInboundPacket(socket);
+            ++num_loops;
+        }
+        num_received = num_loops - 1;
     }
-    S32 num_dropped_packets = (num_loops - 1 + old_num_packets) - mNumBufferedPackets;
+    S32 num_dropped_packets = (num_received + old_num_packets) - mNumBufferedPackets;
+    // </FS>
     if (num_dropped_packets > 0)
     {
         // It will eventually be accounted by mDroppedPackets
@@ -49,6 +49,18 @@ public:
     // drains packets from socket and returns final mNumBufferedPackets
     S32 drainSocket(S32 socket);
 
+    // <FS> Batched UDP I/O
+    // Linux: read and send with recvmmsg()/sendmmsg(), up to NET_BATCH_SIZE
+    // packets per call. Not used through a SOCKS proxy.
+    void setBatchIO(bool batch_io) { mBatchIO = batch_io; }
+    bool useBatchIO() const;
+
+    // Packets sent between these two go out together when the batch ends.
+    // endSendBatch() returns the number of packets that could not be sent.
+    void beginSendBatch();
+    S32 endSendBatch();
+    // </FS>
+
     void dropPackets(U32);
     void setDropPercentage (F32 percent_to_drop);
 
@@ -77,6 +89,13 @@ protected:
     // returns packet_size of packet buffered
     S32 bufferInboundPacket(S32 socket);
 
+    // <FS> Batched UDP I/O
+    // returns the number of packets buffered with one read of the socket
+    S32 bufferInboundPackets(S32 socket);
+    // returns the number of packets that could not be sent
+    S32 flushOutboundPackets();
+    // </FS>
+
     // returns 'true' if ring was expanded
     bool expandRing();
 
@@ -96,6 +115,15 @@ protected:
     // These are the sender and receiving_interface for the last packet delivered by receivePacket()
     LLHost mLastSender;
     LLHost mLastReceivingIF;
+
+    // <FS> Batched UDP I/O
+    bool mBatchIO { true };        // only used on Linux
+    bool mSendBatchOpen { false };
+    // packets held by sendPacket() while a send batch is open
+    std::vector<LLPacketBuffer*> mOutboundPackets;
+    S32 mNumOutboundPackets { 0 };
+    S32 mOutboundSocket { 0 };
+    // </FS>
 };
 
 
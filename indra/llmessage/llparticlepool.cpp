@@ -0,0 +1,260 @@
+/**
+ * @file llparticlepool.cpp
+ * @brief Particle state in structure of arrays, and its integrator
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llparticlepool.h"
+
+#include "llmath.h"
+#include "llsimdmath.h"
+
+static const S32 CACHE_LINE_FLOATS = 64 / sizeof(F32);
+
+namespace
+{
+    // All bits set in the lanes that have the flag
+    inline __m128 flag_mask(__m128i flags, U32 flag)
+    {
+        const __m128i bit = _mm_set1_epi32((S32)flag);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, bit), bit));
+    }
+
+    inline bool any(__m128 mask)
+    {
+        return _mm_movemask_ps(mask) != 0;
+    }
+
+    inline __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // The pieces of LLViewerPartGroup::updateParticles() below keep its
+    // order of operations, so that every lane gets the same result as the
+    // scalar code. Lanes without a flag compute its branch all the same and
+    // drop it in select(), unless none of the four lanes has it.
+    struct LLParticleLanes
+    {
+        F32* mData;
+        S32 mStride;
+        S32 mIndex;
+
+        __m128 load(LLParticlePool::EField field) const
+        {
+            return _mm_load_ps(mData + field * mStride + mIndex);
+        }
+
+        void store(LLParticlePool::EField field, __m128 value) const
+        {
+            _mm_store_ps(mData + field * mStride + mIndex, value);
+        }
+    };
+}
+
+LLParticlePool::LLParticlePool()
+:   mData(NULL),
+    mFlags(NULL),
+    mSize(0),
+    mCapacity(0),
+    mStride(0)
+{
+}
+
+LLParticlePool::~LLParticlePool()
+{
+    ll_aligned_free_16(mData);
+    ll_aligned_free_16(mFlags);
+}
+
+void LLParticlePool::resize(S32 count)
+{
+    count = llmax(count, 0);
+    if (count > mCapacity)
+    {
+        // rounded up to whole lanes, the last ones computing zeroes
+        const S32 capacity = (llmax(count, mCapacity * 2) + LANES - 1) & ~(LANES - 1);
+        // with a power of two capacity, the fields of a particle would all
+        // fall in the same cache set
+        const S32 stride = capacity + CACHE_LINE_FLOATS;
+
+        F32* data = (F32*)ll_aligned_malloc_16(FIELD_COUNT * stride * sizeof(F32));
+        U32* flags = (U32*)ll_aligned_malloc_16(capacity * sizeof(U32));
+        memset(data, 0, FIELD_COUNT * stride * sizeof(F32));
+        memset(flags, 0, capacity * sizeof(U32));
+        if (mData)
+        {
+            for (S32 field = 0; field < FIELD_COUNT; ++field)
+            {
+                memcpy(data + field * stride, mData + field * mStride, mSize * sizeof(F32));
+            }
+            memcpy(flags, mFlags, mSize * sizeof(U32));
+            ll_aligned_free_16(mData);
+            ll_aligned_free_16(mFlags);
+        }
+
+        mData = data;
+        mFlags = flags;
+        mCapacity = capacity;
+        mStride = stride;
+    }
+    mSize = count;
+}
+
+void LLParticlePool::integrate()
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 tenth = _mm_set1_ps(0.1f);
+    const __m128 five = _mm_set1_ps(5.f);
+    const __m128 minus_two = _mm_set1_ps(-2.f);
+    const __m128 restitution = _mm_set1_ps(-0.75f);
+
+    LLParticleLanes lanes = { mData, mStride, 0 };
+    for (S32 i = 0; i < mSize; i += LANES)
+    {
+        lanes.mIndex = i;
+        const __m128i flags = _mm_load_si128((const __m128i*)(mFlags + i));
+
+        __m128 pos[3] = { lanes.load(POS_X), lanes.load(POS_Y), lanes.load(POS_Z) };
+        __m128 vel[3] = { lanes.load(VEL_X), lanes.load(VEL_Y), lanes.load(VEL_Z) };
+        const __m128 source[3] = { lanes.load(SOURCE_X), lanes.load(SOURCE_Y), lanes.load(SOURCE_Z) };
+        const __m128 target[3] = { lanes.load(TARGET_X), lanes.load(TARGET_Y), lanes.load(TARGET_Z) };
+        const __m128 dt = lanes.load(DT);
+        const __m128 age = lanes.load(AGE);
+        const __m128 max_age = lanes.load(MAX_AGE);
+
+        const __m128 cur_time = _mm_add_ps(age, dt);
+        const __m128 frac = _mm_div_ps(cur_time, max_age);
+
+        // Wind drags the velocity along
+        const __m128 wind_mask = flag_mask(flags, LLPartData::LL_PART_WIND_MASK);
+        if (any(wind_mask))
+        {
+            const __m128 tenth_dt = _mm_mul_ps(tenth, dt);
+            const __m128 keep = _mm_sub_ps(one, tenth_dt);
+            const __m128 wind[3] = { lanes.load(WIND_X), lanes.load(WIND_Y), lanes.load(WIND_Z) };
+            for (S32 c = 0; c < 3; ++c)
+            {
+                const __m128 v = _mm_add_ps(_mm_mul_ps(vel[c], keep), _mm_mul_ps(tenth_dt, wind[c]));
+                vel[c] = select(wind_mask, v, vel[c]);
+            }
+        }
+
+        // Interpolation towards the target
+        const __m128 target_mask = flag_mask(flags, LLPartData::LL_PART_TARGET_POS_MASK);
+        if (any(target_mask))
+        {
+            const __m128 remaining = _mm_sub_ps(max_age, age);
+            __m128 step = _mm_div_ps(dt, remaining);
+            step = select(_mm_cmplt_ps(step, zero), zero, step);
+            step = select(_mm_cmpgt_ps(step, tenth), tenth, step);
+            step = _mm_mul_ps(step, five);
+            const __m128 keep = _mm_sub_ps(one, step);
+            const __m128 inv_remaining = _mm_div_ps(one, remaining);
+            for (S32 c = 0; c < 3; ++c)
+            {
+                const __m128 delta = _mm_mul_ps(_mm_sub_ps(target[c], pos[c]), inv_remaining);
+                const __m128 v = _mm_add_ps(_mm_mul_ps(vel[c], keep), _mm_mul_ps(step, delta));
+                vel[c] = select(target_mask, v, vel[c]);
+            }
+        }
+
+        // Straight from the source to the target, or velocity interpolation
+        {
+            const __m128 linear_mask = flag_mask(flags, LLPartData::LL_PART_TARGET_LINEAR_MASK);
+            const __m128 half_dt2 = _mm_mul_ps(_mm_mul_ps(half, dt), dt);
+            const __m128 accel[3] = { lanes.load(ACCEL_X), lanes.load(ACCEL_Y), lanes.load(ACCEL_Z) };
+            for (S32 c = 0; c < 3; ++c)
+            {
+                const __m128 delta = _mm_sub_ps(target[c], source[c]);
+                const __m128 linear_pos = _mm_add_ps(source[c], _mm_mul_ps(frac, delta));
+
+                __m128 p = _mm_add_ps(pos[c], _mm_mul_ps(dt, vel[c]));
+                p = _mm_add_ps(p, _mm_mul_ps(half_dt2, accel[c]));
+                const __m128 v = _mm_add_ps(vel[c], _mm_mul_ps(accel[c], dt));
+
+                pos[c] = select(linear_mask, linear_pos, p);
+                vel[c] = select(linear_mask, delta, v);
+            }
+        }
+
+        // Bounce off the height of the source
+        {
+            const __m128 dz = _mm_sub_ps(pos[2], source[2]);
+            const __m128 bounce_mask = _mm_and_ps(flag_mask(flags, LLPartData::LL_PART_BOUNCE_MASK), _mm_cmplt_ps(dz, zero));
+            pos[2] = select(bounce_mask, _mm_add_ps(pos[2], _mm_mul_ps(minus_two, dz)), pos[2]);
+            vel[2] = select(bounce_mask, _mm_mul_ps(vel[2], restitution), vel[2]);
+        }
+
+        lanes.store(POS_X, pos[0]);
+        lanes.store(POS_Y, pos[1]);
+        lanes.store(POS_Z, pos[2]);
+        lanes.store(VEL_X, vel[0]);
+        lanes.store(VEL_Y, vel[1]);
+        lanes.store(VEL_Z, vel[2]);
+
+        // New offset from the source, read with LL_PART_FOLLOW_SRC_MASK
+        lanes.store(OFFSET_X, _mm_sub_ps(pos[0], source[0]));
+        lanes.store(OFFSET_Y, _mm_sub_ps(pos[1], source[1]));
+        lanes.store(OFFSET_Z, _mm_sub_ps(pos[2], source[2]));
+
+        const __m128 inv_frac = _mm_sub_ps(one, frac);
+
+        // Color interpolation
+        const __m128 color_mask = flag_mask(flags, LLPartData::LL_PART_INTERP_COLOR_MASK);
+        if (any(color_mask))
+        {
+            for (S32 c = 0; c < 4; ++c)
+            {
+                const EField color = (EField)(COLOR_R + c);
+                const __m128 start = lanes.load((EField)(START_COLOR_R + c));
+                const __m128 end = lanes.load((EField)(END_COLOR_R + c));
+                const __m128 value = _mm_add_ps(_mm_mul_ps(start, inv_frac), _mm_mul_ps(end, frac));
+                lanes.store(color, select(color_mask, value, lanes.load(color)));
+            }
+        }
+
+        // Scale interpolation
+        const __m128 scale_mask = flag_mask(flags, LLPartData::LL_PART_INTERP_SCALE_MASK);
+        if (any(scale_mask))
+        {
+            for (S32 c = 0; c < 2; ++c)
+            {
+                const EField scale = (EField)(SCALE_X + c);
+                const __m128 start = lanes.load((EField)(START_SCALE_X + c));
+                const __m128 end = lanes.load((EField)(END_SCALE_X + c));
+                const __m128 value = _mm_add_ps(_mm_mul_ps(start, inv_frac), _mm_mul_ps(frac, end));
+                lanes.store(scale, select(scale_mask, value, lanes.load(scale)));
+            }
+        }
+
+        lanes.store(AGE, cur_time);
+        lanes.store(FRAC, frac);
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * @file llparticlepool.h
+ * @brief Particle state in structure of arrays, and its integrator
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPARTICLEPOOL_H
+#define LL_LLPARTICLEPOOL_H
+
+#include "llpartdata.h"
+
+//-----------------------------------------------------------------------------
+// LLParticlePool
+// The state that a particle group integrates every frame, one 16 byte
+// aligned array per component, so that integrate() steps four particles at
+// a time. The owner fills the inputs of each particle, integrate() runs the
+// rules of LLViewerPartGroup::updateParticles() on all of them, and the
+// owner reads the outputs back. The arrays are only ever grown, so a group
+// keeps reusing its pool frame after frame.
+//-----------------------------------------------------------------------------
+class LLParticlePool
+{
+public:
+    enum EField
+    {
+        // inputs and outputs
+        POS_X, POS_Y, POS_Z,
+        VEL_X, VEL_Y, VEL_Z,
+        AGE,                    // mLastUpdateTime, then the age after this step
+        COLOR_R, COLOR_G, COLOR_B, COLOR_A,
+        SCALE_X, SCALE_Y,
+        // inputs
+        ACCEL_X, ACCEL_Y, ACCEL_Z,
+        DT,                     // time step of the particle
+        MAX_AGE,
+        WIND_X, WIND_Y, WIND_Z, // wind velocity at the particle, with LL_PART_WIND_MASK
+        SOURCE_X, SOURCE_Y, SOURCE_Z, // source position
+        TARGET_X, TARGET_Y, TARGET_Z, // source target position
+        START_COLOR_R, START_COLOR_G, START_COLOR_B, START_COLOR_A,
+        END_COLOR_R, END_COLOR_G, END_COLOR_B, END_COLOR_A,
+        START_SCALE_X, START_SCALE_Y,
+        END_SCALE_X, END_SCALE_Y,
+        // outputs
+        FRAC,                   // fraction of the maximum age
+        OFFSET_X, OFFSET_Y, OFFSET_Z, // mPosOffset, with LL_PART_FOLLOW_SRC_MASK
+        FIELD_COUNT
+    };
+
+    static const S32 LANES = 4;
+
+    LLParticlePool();
+    ~LLParticlePool();
+
+    // Sets the number of particles, keeping the arrays when they are large
+    // enough. The values of the particles are left as they were.
+    void resize(S32 count);
+    S32 size() const { return mSize; }
+    S32 capacity() const { return mCapacity; }
+
+    F32* field(EField field) { return mData + field * mStride; }
+    const F32* field(EField field) const { return mData + field * mStride; }
+    // LLPartData::mFlags of each particle
+    U32* flags() { return mFlags; }
+    const U32* flags() const { return mFlags; }
+
+    // Steps every particle by its DT
+    void integrate();
+
+private:
+    LLParticlePool(const LLParticlePool&) = delete;
+    LLParticlePool& operator=(const LLParticlePool&) = delete;
+
+    F32*    mData;
+    U32*    mFlags;
+    S32     mSize;
+    S32     mCapacity;
+    S32     mStride;    // between the arrays, a cache line more than mCapacity
+};
+
+#endif // LL_LLPARTICLEPOOL_H
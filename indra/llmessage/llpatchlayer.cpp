@@ -0,0 +1,178 @@
+/**
+ * @file llpatchlayer.cpp
+ * @brief Decodes all the patches of a terrain layer at once
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpatchlayer.h"
+
+// The most one patch can take: its header and 32x32 coefficients of a
+// sign, a value and up to 32 bits. The data is copied with this many zeroes
+// after it, so that a truncated layer reads zeroes past its end.
+static const S32 MAX_PATCH_BYTES = (8 + 32 + 16 + 32 + LARGE_PATCH_SIZE * LARGE_PATCH_SIZE * (3 + 32)) / 8 + 1;
+
+namespace
+{
+    // Reads the values that decode_patch_header() and decode_patch() get
+    // from LLBitPack::bitUnpack(), without its loop over every bit and
+    // without their globals.
+    class LLPatchBitReader
+    {
+    public:
+        LLPatchBitReader(const U8* data) : mData(data), mBit(0) {}
+
+        // Up to 8 bits, most significant first
+        U32 readBits(U32 bits)
+        {
+            const size_t i = mBit >> 3;
+            const U32 word = ((U32)mData[i] << 8) | mData[i + 1];
+            const U32 value = (word >> (16 - (mBit & 7) - bits)) & ((1 << bits) - 1);
+            mBit += bits;
+            return value;
+        }
+
+        // bitUnpack() into an integer: 8 bits per byte, the rest in the last one
+        U32 read(U32 bits)
+        {
+            U32 value = 0;
+            for (U32 shift = 0; bits; shift += 8)
+            {
+                const U32 chunk = llmin(bits, 8U);
+                value |= readBits(chunk) << shift;
+                bits -= chunk;
+            }
+            return value;
+        }
+
+        size_t getBytesRead() const { return (mBit + 7) >> 3; }
+
+    private:
+        const U8*   mData;
+        size_t      mBit;
+    };
+
+    // as decode_patch_header()
+    void decode_header(LLPatchBitReader& reader, LLPatchHeader& header, bool b_large_patch)
+    {
+        header.quant_wbits = (U8)reader.read(8);
+        if (header.quant_wbits == END_OF_PATCHES)
+        {
+            header.dc_offset = 0;
+            header.range = 0;
+            header.patchids = 0;
+            return;
+        }
+        const U32 dc_offset = reader.read(32);
+        memcpy(&header.dc_offset, &dc_offset, sizeof(F32));
+        header.range = (U16)reader.read(16);
+        header.patchids = reader.read(b_large_patch ? 32 : 10);
+    }
+
+    // as decode_patch()
+    void decode_coefficients(LLPatchBitReader& reader, S32* patch, S32 count, U32 wbits)
+    {
+        for (S32 i = 0; i < count; i++)
+        {
+            if (!reader.readBits(1))
+            {
+                patch[i] = 0;
+            }
+            else if (!reader.readBits(1))
+            {
+                // end of block
+                memset(patch + i, 0, (count - i) * sizeof(S32));
+                return;
+            }
+            else
+            {
+                const bool negative = reader.readBits(1);
+                const S32 value = (S32)reader.read(wbits);
+                patch[i] = negative ? -value : value;
+            }
+        }
+    }
+}
+LLPatchLayer::LLPatchLayer()
+{
+    mGroupHeader.stride = 0;
+    mGroupHeader.patch_size = 0;
+    mGroupHeader.layer_type = 0;
+}
+
+bool LLPatchLayer::decode(const U8* data, S32 size, bool b_large_patch)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    mPatches.clear();
+    mHeights.clear();
+
+    std::vector<U8> buffer(size + MAX_PATCH_BYTES, 0);
+    memcpy(buffer.data(), data, size);
+    LLPatchBitReader reader(buffer.data());
+
+    // as decode_patch_group_header()
+    mGroupHeader.stride = (U16)reader.read(16);
+    mGroupHeader.patch_size = (U8)reader.read(8);
+    mGroupHeader.layer_type = (U8)reader.read(8);
+    const S32 patch_size = mGroupHeader.patch_size;
+    if (patch_size != NORMAL_PATCH_SIZE && patch_size != LARGE_PATCH_SIZE)
+    {
+        return false;
+    }
+
+    S32 coefficients[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+    while ((S32)reader.getBytesRead() <= size)
+    {
+        Patch patch;
+        decode_header(reader, patch.mHeader, b_large_patch);
+        if (patch.mHeader.quant_wbits == END_OF_PATCHES)
+        {
+            break;
+        }
+
+        if (b_large_patch)
+        {
+            patch.mX = patch.mHeader.patchids >> 16;
+            patch.mY = patch.mHeader.patchids & 0xFFFF;
+        }
+        else
+        {
+            patch.mX = patch.mHeader.patchids >> 5;
+            patch.mY = patch.mHeader.patchids & 0x1F;
+        }
+
+        decode_coefficients(reader, coefficients, patch_size * patch_size, (patch.mHeader.quant_wbits & 0xf) + 2);
+        if ((S32)reader.getBytesRead() > size)
+        {
+            LL_WARNS() << "Truncated terrain layer after " << mPatches.size() << " patches" << LL_ENDL;
+            break;
+        }
+
+        mHeights.resize(mHeights.size() + patch_size * patch_size);
+        F32* heights = mHeights.data() + mPatches.size() * patch_size * patch_size;
+        decompress_patch_block(heights, patch_size, coefficients, &patch.mHeader, patch_size);
+        mPatches.push_back(patch);
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file llpatchlayer.h
+ * @brief Decodes all the patches of a terrain layer at once
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPATCHLAYER_H
+#define LL_LLPATCHLAYER_H
+
+#include "patch_dct.h"
+
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// LLPatchLayer
+// The patches of one LayerData message, decoded into plain height blocks.
+// decode() keeps no global state, so layers can be decoded on worker
+// threads and handed over to the surface once done.
+//-----------------------------------------------------------------------------
+class LLPatchLayer
+{
+public:
+    struct Patch
+    {
+        LLPatchHeader   mHeader;
+        U32             mX;
+        U32             mY;
+    };
+
+    LLPatchLayer();
+
+    // Decodes the group header and the patches up to END_OF_PATCHES, with
+    // b_large_patch as LLSurface::decompressDCTPatch(). Returns false when
+    // the patch size is not supported by decompress_patch_block(); a
+    // truncated layer keeps the patches decoded before the end of the data.
+    bool decode(const U8* data, S32 size, bool b_large_patch);
+
+    const LLGroupHeader& getGroupHeader() const { return mGroupHeader; }
+    S32 getPatchSize() const { return mGroupHeader.patch_size; }
+    const std::vector<Patch>& getPatches() const { return mPatches; }
+
+    // patch_size rows of patch_size heights, for getPatches()[index]
+    const F32* getHeights(size_t index) const { return mHeights.data() + index * getPatchSize() * getPatchSize(); }
+
+private:
+    LLGroupHeader       mGroupHeader;
+    std::vector<Patch>  mPatches;
+    std::vector<F32>    mHeights;
+};
+
+#endif // LL_LLPATCHLAYER_H
@@ -42,6 +42,7 @@ LLTemplateMessageBuilder::LLTemplateMessageBuilder(const message_template_name_m
     mCurrentSDataBlock(NULL),
     mCurrentSMessageName(NULL),
     mCurrentSBlockName(NULL),
+    mCurrentSTemplateBlock(NULL), // <FS/>
     mbSBuilt(false),
     mbSClear(true),
     mCurrentSendTotal(0),
@@ -75,6 +76,7 @@ void LLTemplateMessageBuilder::newMessage(const char *name)
         mCurrentSMessageName = namep;
         mCurrentSDataBlock = NULL;
         mCurrentSBlockName = NULL;
+        mCurrentSTemplateBlock = NULL; // <FS/>
 
         // add at one of each block
         const LLMessageTemplate* msg_template = mMessageTemplates.find(name)->second;
@@ -116,6 +118,7 @@ void LLTemplateMessageBuilder::clearMessage()
     mCurrentSMessageName = NULL;
     mCurrentSDataBlock = NULL;
     mCurrentSBlockName = NULL;
+    mCurrentSTemplateBlock = NULL; // <FS/>
 }
 
 // virtual
@@ -146,6 +149,7 @@ void LLTemplateMessageBuilder::nextBlock(const char* blockname)
         block_data->mBlockNumber = 1;
         mCurrentSDataBlock = block_data;
         mCurrentSBlockName = bnamep;
+        mCurrentSTemplateBlock = template_data; // <FS/>
 
         // add placeholders for each of the variables
         for (LLMessageBlock::message_variable_map_t::const_iterator iter = template_data->mMemberVariables.begin();
@@ -302,7 +306,10 @@ void LLTemplateMessageBuilder::addData(const char *varname, const void *data, EM
     }
 
     // kewl, add the data if it exists
-    const LLMessageVariable* var_data = mCurrentSMessageTemplate->getBlock(mCurrentSBlockName)->getVariable(vnamep);
+    // <FS> The template block of mCurrentSBlockName, looked up once in nextBlock()
+    //const LLMessageVariable* var_data = mCurrentSMessageTemplate->getBlock(mCurrentSBlockName)->getVariable(vnamep);
+    const LLMessageVariable* var_data = mCurrentSTemplateBlock->getVariable(vnamep);
+    // </FS>
     if (!var_data || !var_data->getName())
     {
         LL_ERRS() << vnamep << " not a variable in block " << mCurrentSBlockName << " of " << mCurrentSMessageTemplate->mName << LL_ENDL;
@@ -362,7 +369,10 @@ void LLTemplateMessageBuilder::addData(const char *varname, const void *data, EM
     }
 
     // kewl, add the data if it exists
-    const LLMessageVariable* var_data = mCurrentSMessageTemplate->getBlock(mCurrentSBlockName)->getVariable(vnamep);
+    // <FS> The template block of mCurrentSBlockName, looked up once in nextBlock()
+    //const LLMessageVariable* var_data = mCurrentSMessageTemplate->getBlock(mCurrentSBlockName)->getVariable(vnamep);
+    const LLMessageVariable* var_data = mCurrentSTemplateBlock->getVariable(vnamep);
+    // </FS>
     if (!var_data->getName())
     {
         LL_ERRS() << vnamep << " not a variable in block " << mCurrentSBlockName << " of " << mCurrentSMessageTemplate->mName << LL_ENDL;
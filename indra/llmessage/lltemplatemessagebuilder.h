@@ -36,6 +36,7 @@ class LLMsgData;
 class LLMessageTemplate;
 class LLMsgBlkData;
 class LLMessageTemplate;
+class LLMessageBlock; // <FS/>
 
 class LLTemplateMessageBuilder : public LLMessageBuilder
 {
@@ -106,6 +107,7 @@ private:
     LLMsgBlkData* mCurrentSDataBlock;
     char* mCurrentSMessageName;
     char* mCurrentSBlockName;
+    const LLMessageBlock* mCurrentSTemplateBlock; // <FS/> template of mCurrentSBlockName
     bool mbSBuilt;
     bool mbSClear;
     S32  mCurrentSendTotal;
@@ -44,7 +44,11 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
                                                  number_template_map) :
     mReceiveSize(0),
     mCurrentRMessageTemplate(NULL),
-    mCurrentRMessageData(NULL),
+    // <FS>
+    mHasDecodedData(false),
+    mLastBlock(0),
+    mLastVariable(0),
+    // </FS>
     mMessageNumbers(number_template_map)
 {
 }
@@ -52,8 +56,6 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 //virtual
 LLTemplateMessageReader::~LLTemplateMessageReader()
 {
-    delete mCurrentRMessageData;
-    mCurrentRMessageData = NULL;
 }
 
 //virtual
@@ -61,10 +63,70 @@ void LLTemplateMessageReader::clearMessage()
 {
     mReceiveSize = -1;
     mCurrentRMessageTemplate = NULL;
-    delete mCurrentRMessageData;
-    mCurrentRMessageData = NULL;
+    mHasDecodedData = false; // <FS/>
 }
 
+// <FS> Lookups in the flat decoded data. Block and variable names are
+// canonical strings from the message string table, so comparing the
+// pointers is enough.
+S32 LLTemplateMessageReader::findBlock(const char* blockname) const
+{
+    const std::vector<LLMessageTemplate::DecodeBlock>& blocks = mCurrentRMessageTemplate->mDecodeBlocks;
+    const S32 count = (S32)blocks.size();
+    S32 block = mLastBlock;
+    for (S32 i = 0; i < count; ++i, ++block)
+    {
+        if (block >= count)
+        {
+            block = 0;
+        }
+        if (blocks[block].mName == blockname)
+        {
+            mLastBlock = block;
+            return block;
+        }
+    }
+    return -1;
+}
+
+S32 LLTemplateMessageReader::findVariable(S32 block, const char* varname) const
+{
+    const LLMessageTemplate::DecodeBlock& decode_block = mCurrentRMessageTemplate->mDecodeBlocks[block];
+    const LLMessageTemplate::DecodeVariable* variables = &mCurrentRMessageTemplate->mDecodeVariables[decode_block.mFirstVariable];
+    const S32 count = decode_block.mVariableCount;
+    // handlers usually read the variables in template order
+    S32 variable = mLastVariable + 1;
+    for (S32 i = 0; i < count; ++i, ++variable)
+    {
+        if (variable >= count)
+        {
+            variable = 0;
+        }
+        if (variables[variable].mName == varname)
+        {
+            mLastVariable = variable;
+            return variable;
+        }
+    }
+    return -1;
+}
+
+void LLTemplateMessageReader::addDecodedData(const U8* data, S32 available, S32 size, EMsgVariableType type)
+{
+    DecodedVariable variable;
+    variable.mOffset = (S32)mDecodedData.size();
+    variable.mSize = size;
+    mDecodedVariables.push_back(variable);
+
+    // anything missing from the packet reads as zeros
+    mDecodedData.resize(mDecodedData.size() + size);
+    if (available > 0)
+    {
+        htolememcpy(&mDecodedData[variable.mOffset], data, type, available);
+    }
+}
+// </FS>
+
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
 {
     // is there a message ready to go?
@@ -74,80 +136,156 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
         return;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData) // <FS/>
     {
         LL_ERRS() << "Invalid mCurrentMessageData in getData!" << LL_ENDL;
         return;
     }
 
-    char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-    char *vnamep = (char *)varname;
+    // <FS> Look the variable up in the flat decoded data
+    const S32 block = findBlock(blockname);
+    if (block < 0 || blocknum < 0 || blocknum >= mDecodedBlocks[block].mCount)
+    {
+        LL_ERRS() << "Block " << blockname << " #" << blocknum
+            << " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
+        return;
+    }
+
+    const S32 variable = findVariable(block, varname);
+    if (variable < 0)
+    {
+        LL_ERRS() << "Variable "<< varname << " not in message "
+            << mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
+        return;
+    }
 
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
+    copyData(block, variable, datap, size, blocknum, max_size);
+    // </FS>
+}
 
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+// <FS> Indexed access, without the name lookups
+S32 LLTemplateMessageReader::getNumberOfBlocksAt(S32 block) const
+{
+    if (mReceiveSize == -1 || !mHasDecodedData)
     {
-        LL_ERRS() << "Block " << blockname << " #" << blocknum
-            << " not in message " << mCurrentRMessageData->mName << LL_ENDL;
+        LL_ERRS() << "No message waiting for decode in getNumberOfBlocksAt!" << LL_ENDL;
+        return -1;
+    }
+
+    if (block < 0 || block >= (S32)mDecodedBlocks.size())
+    {
+        LL_ERRS() << "Block #" << block << " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
+        return -1;
+    }
+
+    return mDecodedBlocks[block].mCount;
+}
+
+S32 LLTemplateMessageReader::getSizeAt(S32 block, S32 blocknum, S32 variable) const
+{
+    if (mReceiveSize == -1 || !mHasDecodedData)
+    {   // This is a serious error - crash
+        LL_ERRS() << "No message waiting for decode in getSizeAt!" << LL_ENDL;
+        return LL_MESSAGE_ERROR;
+    }
+
+    if (block < 0 || block >= (S32)mDecodedBlocks.size()
+        || blocknum < 0 || blocknum >= mDecodedBlocks[block].mCount)
+    {   // don't crash
+        LL_INFOS() << "Block #" << block << " #" << blocknum << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
+        return LL_BLOCK_NOT_IN_MESSAGE;
+    }
+
+    const S32 variable_count = mCurrentRMessageTemplate->mDecodeBlocks[block].mVariableCount;
+    if (variable < 0 || variable >= variable_count)
+    {   // don't crash
+        LL_INFOS() << "Variable #" << variable << " not in message " << mCurrentRMessageTemplate->mName
+            << " block " << mCurrentRMessageTemplate->mDecodeBlocks[block].mName << LL_ENDL;
+        return LL_VARIABLE_NOT_IN_BLOCK;
+    }
+
+    return mDecodedVariables[mDecodedBlocks[block].mFirstData + blocknum * variable_count + variable].mSize;
+}
+
+void LLTemplateMessageReader::getBinaryDataAt(S32 block, S32 variable, void *datap, S32 size, S32 blocknum, S32 max_size)
+{
+    if (mReceiveSize == -1 || !mHasDecodedData)
+    {
+        LL_ERRS() << "No message waiting for decode in getBinaryDataAt!" << LL_ENDL;
         return;
     }
 
-    LLMsgBlkData *msg_block_data = iter->second;
-    LLMsgBlkData::msg_var_data_map_t &var_data_map = msg_block_data->mMemberVarData;
+    if (block < 0 || block >= (S32)mDecodedBlocks.size()
+        || blocknum < 0 || blocknum >= mDecodedBlocks[block].mCount)
+    {
+        LL_ERRS() << "Block #" << block << " #" << blocknum
+            << " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
+        return;
+    }
 
-    if (var_data_map.find(vnamep) == var_data_map.end())
+    if (variable < 0 || variable >= mCurrentRMessageTemplate->mDecodeBlocks[block].mVariableCount)
     {
-        LL_ERRS() << "Variable "<< vnamep << " not in message "
-            << mCurrentRMessageData->mName<< " block " << bnamep << LL_ENDL;
+        LL_ERRS() << "Variable #" << variable << " not in message " << mCurrentRMessageTemplate->mName
+            << " block " << mCurrentRMessageTemplate->mDecodeBlocks[block].mName << LL_ENDL;
         return;
     }
 
-    LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
+    copyData(block, variable, datap, size, blocknum, max_size);
+}
+
+void LLTemplateMessageReader::copyData(S32 block, S32 variable, void *datap, S32 size, S32 blocknum, S32 max_size) const
+{
+    const LLMessageTemplate::DecodeBlock& decode_block = mCurrentRMessageTemplate->mDecodeBlocks[block];
+    const char* varname = mCurrentRMessageTemplate->mDecodeVariables[decode_block.mFirstVariable + variable].mName;
+    const DecodedVariable& vardata = mDecodedVariables[mDecodedBlocks[block].mFirstData + blocknum * decode_block.mVariableCount + variable];
+    const U8* vardata_ptr = mDecodedData.data() + vardata.mOffset;
 
-    if (size && size != vardata.getSize())
+    if (size && size != vardata.mSize)
     {
-        LL_ERRS() << "Msg " << mCurrentRMessageData->mName
-            << " variable " << vnamep
-            << " is size " << vardata.getSize()
+        LL_ERRS() << "Msg " << mCurrentRMessageTemplate->mName
+            << " variable " << varname
+            << " is size " << vardata.mSize
             << " but copying into buffer of size " << size
             << LL_ENDL;
         return;
     }
 
 
-    const S32 vardata_size = vardata.getSize();
+    const S32 vardata_size = vardata.mSize;
     if( max_size >= vardata_size )
     {
+        // the decoded data is packed, so copy rather than load through casts
         switch( vardata_size )
         {
         case 1:
-            *((U8*)datap) = *((U8*)vardata.getData());
+            *((U8*)datap) = *vardata_ptr;
             break;
         case 2:
-            *((U16*)datap) = *((U16*)vardata.getData());
+            memcpy(datap, vardata_ptr, 2);
             break;
         case 4:
-            *((U32*)datap) = *((U32*)vardata.getData());
+            memcpy(datap, vardata_ptr, 4);
             break;
         case 8:
-            ((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-            ((U32*)datap)[1] = ((U32*)vardata.getData())[1];
+            memcpy(datap, vardata_ptr, 8);
             break;
         default:
-            memcpy(datap, vardata.getData(), vardata_size);
+            memcpy(datap, vardata_ptr, vardata_size);
             break;
         }
     }
     else
     {
-        LL_WARNS() << "Msg " << mCurrentRMessageData->mName
-            << " variable " << vnamep
-            << " is size " << vardata.getSize()
+        LL_WARNS() << "Msg " << mCurrentRMessageTemplate->mName
+            << " variable " << varname
+            << " is size " << vardata_size
             << " but truncated to max size of " << max_size
             << LL_ENDL;
 
-        memcpy(datap, vardata.getData(), max_size);
+        memcpy(datap, vardata_ptr, max_size);
     }
+    // </FS>
 }
 
 S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
@@ -159,22 +297,21 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
         return -1;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData) // <FS/>
     {
         LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
         return -1;
     }
 
-    char *bnamep = (char *)blockname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    // <FS>
+    const S32 block = findBlock(blockname);
+    if (block < 0)
     {
         return 0;
     }
 
-    return (iter->second)->mBlockNumber;
+    return mDecodedBlocks[block].mCount;
+    // </FS>
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -186,43 +323,38 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
         return LL_MESSAGE_ERROR;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData) // <FS/>
     {   // This is a serious error - crash
         LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    char *bnamep = (char *)blockname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    // <FS>
+    const S32 block = findBlock(blockname);
+    if (block < 0 || !mDecodedBlocks[block].mCount)
     {   // don't crash
-        LL_INFOS() << "Block " << bnamep << " not in message "
-            << mCurrentRMessageData->mName << LL_ENDL;
+        LL_INFOS() << "Block " << blockname << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
         return LL_BLOCK_NOT_IN_MESSAGE;
     }
 
-    char *vnamep = (char *)varname;
-
-    LLMsgBlkData* msg_data = iter->second;
-    LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-
-    if (!vardata.getName())
+    const S32 variable = findVariable(block, varname);
+    if (variable < 0)
     {   // don't crash
         LL_INFOS() << "Variable " << varname << " not in message "
-            << mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+            << mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
         return LL_VARIABLE_NOT_IN_BLOCK;
     }
 
-    if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+    if (mCurrentRMessageTemplate->mDecodeBlocks[block].mType != MBT_SINGLE)
     {   // This is a serious error - crash
-        LL_ERRS() << "Block " << bnamep << " isn't type MBT_SINGLE,"
+        LL_ERRS() << "Block " << blockname << " isn't type MBT_SINGLE,"
             " use getSize with blocknum argument!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    return vardata.getSize();
+    return mDecodedVariables[mDecodedBlocks[block].mFirstData + variable].mSize;
+    // </FS>
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
@@ -234,35 +366,32 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
         return LL_MESSAGE_ERROR;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData) // <FS/>
     {   // This is a serious error - crash
         LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    char *bnamep = (char *)blockname + blocknum;
-    char *vnamep = (char *)varname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    // <FS>
+    const S32 block = findBlock(blockname);
+    if (block < 0 || blocknum < 0 || blocknum >= mDecodedBlocks[block].mCount)
     {   // don't crash
-        LL_INFOS() << "Block " << bnamep << " not in message "
-            << mCurrentRMessageData->mName << LL_ENDL;
+        LL_INFOS() << "Block " << blockname << " #" << blocknum << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
         return LL_BLOCK_NOT_IN_MESSAGE;
     }
 
-    LLMsgBlkData* msg_data = iter->second;
-    LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-
-    if (!vardata.getName())
+    const S32 variable = findVariable(block, varname);
+    if (variable < 0)
     {   // don't crash
-        LL_INFOS() << "Variable " << vnamep << " not in message "
-            <<  mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+        LL_INFOS() << "Variable " << varname << " not in message "
+            <<  mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
         return LL_VARIABLE_NOT_IN_BLOCK;
     }
 
-    return vardata.getSize();
+    const S32 variable_count = mCurrentRMessageTemplate->mDecodeBlocks[block].mVariableCount;
+    return mDecodedVariables[mDecodedBlocks[block].mFirstData + blocknum * variable_count + variable].mSize;
+    // </FS>
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname,
@@ -539,8 +668,7 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 
     llassert( mReceiveSize >= 0 );
     llassert( mCurrentRMessageTemplate);
-    llassert( !mCurrentRMessageData );
-    delete mCurrentRMessageData; // just to make sure
+    llassert( !mHasDecodedData ); // <FS/>
 	// <FS:Beq> storage for Tracy tag
 	#ifdef TRACY_ENABLE
 	static char msgstr[36];
@@ -552,33 +680,37 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
     U8 offset = buffer[PHL_OFFSET];
     S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
-    // create base working data set
-    mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+    // <FS> Decode into flat arrays, reused from one message to the next,
+    // following the blocks and variables of the template in wire order
+    const std::vector<LLMessageTemplate::DecodeBlock>& decode_blocks = mCurrentRMessageTemplate->mDecodeBlocks;
+    const std::vector<LLMessageTemplate::DecodeVariable>& decode_variables = mCurrentRMessageTemplate->mDecodeVariables;
+    mDecodedBlocks.resize(decode_blocks.size());
+    mDecodedVariables.clear();
+    mDecodedData.clear();
+    mLastBlock = 0;
+    mLastVariable = -1;
+    bool has_blocks = false;
 
-    // loop through the template building the data structure as we go
-    LLMessageTemplate::message_block_map_t::const_iterator iter;
-    for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-        iter != mCurrentRMessageTemplate->mMemberBlocks.end();
-        ++iter)
+    for (size_t block = 0; block < decode_blocks.size(); ++block)
     {
         LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("BuildFromTemplate");
-        LLMessageBlock* mbci = *iter;
+        const LLMessageTemplate::DecodeBlock& mbci = decode_blocks[block];
         U8  repeat_number;
         S32 i;
 
         // how many of this block?
 
-        if (mbci->mType == MBT_SINGLE)
+        if (mbci.mType == MBT_SINGLE)
         {
             // just one
             repeat_number = 1;
         }
-        else if (mbci->mType == MBT_MULTIPLE)
+        else if (mbci.mType == MBT_MULTIPLE)
         {
             // a known number
-            repeat_number = mbci->mNumber;
+            repeat_number = mbci.mNumber;
         }
-        else if (mbci->mType == MBT_VARIABLE)
+        else if (mbci.mType == MBT_VARIABLE)
         {
             // need to read the number from the message
             // repeat number is a single byte
@@ -603,50 +735,33 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
             return false;
         }
 
-        LLMsgBlkData* cur_data_block = NULL;
         // <FS:Beq> Tracy Message processing
-		LL_DEBUGS("LLMessage") << "Processing " << mbci->mName << " with " << repeat_number << " repetitions" << LL_ENDL;
+		LL_DEBUGS("LLMessage") << "Processing " << mbci.mName << " with " << repeat_number << " repetitions" << LL_ENDL;
 		#ifdef TRACY_ENABLE
-		strncpy(msgstr, mbci->mName, 35);
+		strncpy(msgstr, mbci.mName, 35);
 		LL_PROFILE_ZONE_TEXT(msgstr, 35);
 		#endif        
         // </FS:Beq>
 
+        DecodedBlock& decoded_block = mDecodedBlocks[block];
+        decoded_block.mCount = repeat_number;
+        decoded_block.mFirstData = (S32)mDecodedVariables.size();
+        has_blocks = has_blocks || repeat_number;
+
         // now loop through the block
         for (i = 0; i < repeat_number; i++)
         {
-            if (i)
-            {
-                // build new name to prevent collisions
-                // TODO: This should really change to a vector
-                cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-                cur_data_block->mName = mbci->mName + i;
-            }
-            else
-            {
-                cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-            }
-
-            // add the block to the message
-            mCurrentRMessageData->addBlock(cur_data_block);
-
             // now read the variables
-            for (LLMessageBlock::message_variable_map_t::const_iterator iter =
-                     mbci->mMemberVariables.begin();
-                 iter != mbci->mMemberVariables.end(); iter++)
+            for (S32 variable = 0; variable < mbci.mVariableCount; ++variable)
             {
 				LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("AddVariables");
-                const LLMessageVariable& mvci = **iter;
-
-                // ok, build out the variables
-                // add variable block
-                cur_data_block->addVariable(mvci.getName(), mvci.getType());
+                const LLMessageTemplate::DecodeVariable& mvci = decode_variables[mbci.mFirstVariable + variable];
 
                 // what type of variable?
-                if (mvci.getType() == MVT_VARIABLE)
+                if (mvci.mType == MVT_VARIABLE)
                 {
                     // variable, get the number of bytes to read from the template
-                    S32 data_size = mvci.getSize();
+                    S32 data_size = mvci.mSize;
                     U8 tsizeb = 0;
                     U16 tsizeh = 0;
                     U32 tsize = 0;
@@ -680,42 +795,43 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
                     }
                     decode_pos += data_size;
 
-                    cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+                    // data past the end of the packet reads as zeros
+                    const S32 available = llclamp(mReceiveSize - decode_pos, 0, (S32)tsize);
+                    if (available < (S32)tsize)
+                    {
+                        logRanOffEndOfPacket(sender, decode_pos, tsize);
+                    }
+                    addDecodedData(available ? &buffer[decode_pos] : NULL, available, tsize, mvci.mType);
                     decode_pos += tsize;
                 }
                 else
                 {
                     // fixed!
                     // so, copy data pointer and set data size to fixed size
-                    if ((decode_pos + mvci.getSize()) > mReceiveSize)
+                    if ((decode_pos + mvci.mSize) > mReceiveSize)
                     {
-                        logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+                        logRanOffEndOfPacket(sender, decode_pos, mvci.mSize);
 
                         // default to 0s.
-                        U32 size = mvci.getSize();
-                        std::vector<U8> data(size, 0);
-                        cur_data_block->addData(mvci.getName(), &(data[0]),
-                                                size, mvci.getType());
+                        addDecodedData(NULL, 0, mvci.mSize, mvci.mType);
                     }
                     else
                     {
-                        cur_data_block->addData(mvci.getName(),
-                                                &buffer[decode_pos],
-                                                mvci.getSize(),
-                                                mvci.getType());
+                        addDecodedData(&buffer[decode_pos], mvci.mSize, mvci.mSize, mvci.mType);
                     }
-                    decode_pos += mvci.getSize();
+                    decode_pos += mvci.mSize;
                 }
             }
         }
     }
+    mHasDecodedData = true;
 
-    if (mCurrentRMessageData->mMemberBlocks.empty()
-        && !mCurrentRMessageTemplate->mMemberBlocks.empty())
+    if (!has_blocks && !decode_blocks.empty())
     {
         LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
         return false;
     }
+    // </FS>
 
     {
         // <FS:Beq> Tracy Message processing
@@ -848,5 +964,34 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
-    builder.copyFromMessageData(*mCurrentRMessageData);
+
+    // <FS> Rebuild the data the builder copies from, the way decodeData()
+    // used to store it
+    LLMsgData message_data(mCurrentRMessageTemplate->mName);
+    if (mHasDecodedData)
+    {
+        const std::vector<LLMessageTemplate::DecodeBlock>& decode_blocks = mCurrentRMessageTemplate->mDecodeBlocks;
+        for (size_t block = 0; block < decode_blocks.size(); ++block)
+        {
+            const LLMessageTemplate::DecodeBlock& mbci = decode_blocks[block];
+            const DecodedBlock& decoded_block = mDecodedBlocks[block];
+            for (S32 i = 0; i < decoded_block.mCount; ++i)
+            {
+                // repeated blocks are keyed by their name offset by the repeat
+                LLMsgBlkData* block_data = new LLMsgBlkData(mbci.mName, decoded_block.mCount);
+                block_data->mName = mbci.mName + i;
+                message_data.addBlock(block_data);
+
+                for (S32 variable = 0; variable < mbci.mVariableCount; ++variable)
+                {
+                    const LLMessageTemplate::DecodeVariable& mvci = mCurrentRMessageTemplate->mDecodeVariables[mbci.mFirstVariable + variable];
+                    const DecodedVariable& vardata = mDecodedVariables[decoded_block.mFirstData + i * mbci.mVariableCount + variable];
+                    block_data->addVariable(mvci.mName, mvci.mType);
+                    block_data->addData(mvci.mName, mDecodedData.data() + vardata.mOffset, vardata.mSize, mvci.mType);
+                }
+            }
+        }
+    }
+    builder.copyFromMessageData(message_data);
+    // </FS>
 }
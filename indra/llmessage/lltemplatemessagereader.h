@@ -28,8 +28,10 @@
 #define LL_LLTEMPLATEMESSAGEREADER_H
 
 #include "llmessagereader.h"
+#include "llmsgvariabletype.h" // <FS/>
 
 #include <map>
+#include <vector> // <FS/>
 
 class LLMessageTemplate;
 class LLMsgData;
@@ -91,6 +93,15 @@ public:
     virtual S32 getSize(const char *blockname, S32 blocknum,
                         const char *varname);
 
+    // <FS> By the indices of LLMessageTemplate::getBlockIndex() and
+    // getVariableIndex() in the template of the current message
+    const LLMessageTemplate* getMessageTemplate() const { return mCurrentRMessageTemplate; }
+    S32 getNumberOfBlocksAt(S32 block) const;
+    S32 getSizeAt(S32 block, S32 blocknum, S32 variable) const;
+    void getBinaryDataAt(S32 block, S32 variable, void *datap, S32 size = 0,
+                         S32 blocknum = 0, S32 max_size = S32_MAX);
+    // </FS>
+
     virtual void clearMessage();
 
     virtual const char* getMessageName() const;
@@ -118,9 +129,35 @@ private:
 
     bool decodeData(const U8* buffer, const LLHost& sender );
 
+    // <FS> Flat storage of the decoded message
+    S32 findBlock(const char* blockname) const;
+    S32 findVariable(S32 block, const char* varname) const;
+    void addDecodedData(const U8* data, S32 available, S32 size, EMsgVariableType type);
+    void copyData(S32 block, S32 variable, void *datap, S32 size, S32 blocknum, S32 max_size) const;
+
+    struct DecodedBlock
+    {
+        S32 mCount;         // repeats of the block in the message
+        S32 mFirstData;     // index in mDecodedVariables of its first variable
+    };
+
+    struct DecodedVariable
+    {
+        S32 mOffset;        // in mDecodedData
+        S32 mSize;
+    };
+    // </FS>
+
     S32 mReceiveSize;
     LLMessageTemplate* mCurrentRMessageTemplate;
-    LLMsgData* mCurrentRMessageData;
+    // <FS> Replaces the LLMsgData, which allocated every block and variable
+    bool mHasDecodedData;
+    std::vector<DecodedBlock> mDecodedBlocks;       // one per template block
+    std::vector<DecodedVariable> mDecodedVariables;
+    std::vector<U8> mDecodedData;
+    mutable S32 mLastBlock;                         // lookup hints, handlers read in order
+    mutable S32 mLastVariable;
+    // </FS>
     message_template_number_map_t& mMessageNumbers;
 };
 
@@ -0,0 +1,135 @@
+/**
+ * @file llzerocode.cpp
+ * @date   2024-11
+ * @brief Expansion of zero-coded message packets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+#include "llcircuit.h"
+
+#include <algorithm>
+#include <bit>
+
+#if LL_ARM64
+#include "sse2neon.h"
+#else
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // First zero byte in [begin, end), or end
+    inline const U8* find_zero(const U8* begin, const U8* end)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const U8* p = begin;
+        while (end - p >= 16)
+        {
+            const __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+            const U32 mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero));
+            if (mask)
+            {
+                return p + std::countr_zero(mask);
+            }
+            p += 16;
+        }
+        while (p < end && *p)
+        {
+            ++p;
+        }
+        return p;
+    }
+}
+
+// static
+LLZeroCode::EExpandStatus LLZeroCode::expand(const U8* in, S32 in_size, U8* out, S32 out_capacity, S32& out_size)
+{
+    out_size = 0;
+
+    const S32 header_size = std::clamp(in_size, 0, std::min((S32)LL_PACKET_ID_SIZE, out_capacity));
+    memcpy(out, in, header_size);
+
+    const U8* inp = in + header_size;
+    const U8* const in_end = in + std::max(in_size, header_size);
+    U8* outp = out + header_size;
+    U8* const out_end = out + out_capacity;
+
+    // The limits below are the ones of the byte at a time decoder this
+    // replaces, so that packets it accepted still decode.
+    while (inp < in_end)
+    {
+        const U8* zero = find_zero(inp, in_end);
+        const S32 literals = (S32)(zero - inp);
+        if (literals > out_end - outp)
+        {
+            return EXPAND_OVERFLOW_LITERAL;
+        }
+        memcpy(outp, inp, literals);
+        outp += literals;
+        inp = zero;
+        if (inp == in_end)
+        {
+            break;
+        }
+
+        // start of a run
+        if (outp >= out_end)
+        {
+            return EXPAND_OVERFLOW_LITERAL;
+        }
+        *outp++ = 0;
+        ++inp;
+
+        // each further 0 adds 256 zeros
+        while (inp < in_end && !*inp)
+        {
+            if (out_end - outp < 257)
+            {
+                return EXPAND_OVERFLOW_WRAP;
+            }
+            memset(outp, 0, 256);
+            outp += 256;
+            ++inp;
+        }
+        if (inp == in_end)
+        {
+            break;
+        }
+
+        // then the length of the run, including the 0 already written
+        const S32 run = *inp++;
+        if (out_end - outp < run)
+        {
+            return EXPAND_OVERFLOW_RUN;
+        }
+        memset(outp, 0, run - 1);
+        outp += run - 1;
+    }
+
+    out_size = (S32)(outp - out);
+    return EXPAND_OK;
+}
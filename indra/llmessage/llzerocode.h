@@ -0,0 +1,64 @@
+/**
+ * @file llzerocode.h
+ * @date   2024-11
+ * @brief Expansion of zero-coded message packets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLZEROCODE_H
+#define LL_LLZEROCODE_H
+
+#include "stdtypes.h"
+
+/**
+ * @class LLZeroCode
+ * @brief Decoder for the zero coding of template messages.
+ *
+ * After the packet header, a run of zero bytes is sent as a 0 followed by
+ * the length of the run, with each additional 0 before the length adding
+ * 256 zeros. The literal bytes between the runs are found 16 bytes at a
+ * time and copied as blocks, and the runs are written with memset().
+ */
+class LLZeroCode
+{
+public:
+    enum EExpandStatus
+    {
+        EXPAND_OK = 0,
+        // The output buffer is too small, numbered like the warnings of
+        // LLMessageSystem::zeroCodeExpand()
+        EXPAND_OVERFLOW_LITERAL = 1,
+        EXPAND_OVERFLOW_WRAP = 2,
+        EXPAND_OVERFLOW_RUN = 3
+    };
+
+    /**
+     * Expands in_size bytes of a zero-coded packet into out, which holds
+     * out_capacity bytes. The packet header is copied unchanged and a run
+     * cut off by the end of the packet ends the output. out_size is 0 when
+     * the expanded packet does not fit.
+     */
+    static EExpandStatus expand(const U8* in, S32 in_size, U8* out, S32 out_capacity, S32& out_size);
+};
+
+#endif // LL_LLZEROCODE_H
@@ -62,6 +62,7 @@
 #include "lltrustedmessageservice.h"
 #include "llmessagetemplate.h"
 #include "llmessagetemplateparser.h"
+#include "llmessagetemplatecache.h" // <FS/>
 #include "llsd.h"
 #include "llsdmessagebuilder.h"
 #include "llsdmessagereader.h"
@@ -76,6 +77,7 @@
 #include "v3math.h"
 #include "v4math.h"
 #include "lltransfertargetvfile.h"
+#include "llzerocode.h" // <FS/>
 #include "llcorehttputil.h"
 #include "llpounceable.h"
 
@@ -308,20 +310,65 @@ void LLMessageSystem::loadTemplateFile(const std::string& filename, bool failure
         return;
     }
 
+    // <FS> Load the compiled templates while the text is unchanged
+    std::string cache_filename;
+    U64 template_hash = 0;
+    if (!sTemplateCacheDirectory.empty())
+    {
+        cache_filename = sTemplateCacheDirectory + gDirUtilp->getDirDelimiter()
+            + gDirUtilp->getBaseFileName(filename, true) + ".llmsgcache";
+        template_hash = LLMessageTemplateCache::hashSource(template_body);
+
+        LLMessageTemplateCache cache;
+        if (cache.open(cache_filename, template_hash))
+        {
+            mMessageFileVersionNumber = cache.getVersion();
+            for (S32 i = 0; i < cache.getMessageCount(); ++i)
+            {
+                addTemplate(cache.createTemplate(i));
+            }
+            LL_INFOS("Messaging") << "Read " << cache.getMessageCount() << " messages from the cache of " << filename << LL_ENDL;
+            return;
+        }
+    }
+    // </FS>
+
     LLTemplateTokenizer tokens(template_body);
     LLTemplateParser parsed(tokens);
     mMessageFileVersionNumber = parsed.getVersion();
     S32 count                 = 0;
+    // <FS>
+    LLMessageTemplateCache::template_list_t templates;
+    // </FS>
     for(LLTemplateParser::message_iterator iter = parsed.getMessagesBegin();
         iter != parsed.getMessagesEnd();
         iter++)
     {
         addTemplate(*iter);
+        templates.push_back(*iter); // <FS/>
         count++;
     }
     LL_INFOS("Messaging") << "Read " << count << " messages from " << filename << LL_ENDL;
+
+    // <FS>
+    if (!cache_filename.empty()
+        && !LLMessageTemplateCache::write(cache_filename, template_hash, mMessageFileVersionNumber, templates))
+    {
+        LL_WARNS("Messaging") << "Could not write the message template cache " << cache_filename << LL_ENDL;
+    }
+    // </FS>
 }
 
+// <FS>
+std::string LLMessageSystem::sTemplateCacheDirectory;
+
+//static
+void LLMessageSystem::setTemplateCacheDirectory(const std::string& dir)
+{
+    sTemplateCacheDirectory = dir;
+}
+// </FS>
+
 
 LLMessageSystem::~LLMessageSystem()
 {
@@ -710,7 +757,10 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
                 if (cdp && recv_reliable)
                 {
                     // Add to the recently received list for duplicate suppression
-                    cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+                    // <FS> Reliable packets tracked by packet id
+                    //cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+                    cdp->mRecentlyReceivedReliablePackets.set(mCurrentRecvPacketID, getMessageTimeUsecs());
+                    // </FS>
 
                     // Put it onto the list of packets to be acked
                     cdp->collectRAck(mCurrentRecvPacketID);
@@ -765,6 +815,9 @@ S32 LLMessageSystem::getReceiveBytes() const
 void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
 {
     F64Seconds mt_sec = getMessageTimeSeconds();
+    // <FS> Batched UDP I/O: resends, acks and pings go out together
+    mPacketRing.beginSendBatch();
+    // </FS>
     {
         gTransferManager.updateTransfers();
 
@@ -800,6 +853,10 @@ void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
             mDenyTrustedCircuitSet.clear();
         }
 
+        // <FS> Batched UDP I/O
+        mSendPacketFailureCount += mPacketRing.endSendBatch();
+        // </FS>
+
         if (mMaxMessageCounts >= 0)
         {
             if (mNumMessageCounts >= mMaxMessageCounts)
@@ -854,6 +911,13 @@ void LLMessageSystem::copyMessageReceivedToSend()
     mMessageReader->copyToBuilder(*mMessageBuilder);
 }
 
+// <FS>
+LLTemplateMessageReader* LLMessageSystem::getTemplateMessageReader() const
+{
+    return mMessageReader == mTemplateMessageReader ? mTemplateMessageReader : NULL;
+}
+// </FS>
+
 LLSD LLMessageSystem::getReceivedMessageLLSD() const
 {
     LLSDMessageBuilder builder;
@@ -2859,72 +2923,18 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
     *data[0] &= (~LL_ZERO_CODE_FLAG);
 
-    S32 count = (*data_size);
-
-    U8 *inptr = (U8 *)*data;
-    U8 *outptr = (U8 *)mEncodedRecvBuffer;
-
-// skip the packet id field
-
-    for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
+    // <FS> Expand whole literal spans and runs at once
+    S32 out_size = 0;
+    LLZeroCode::EExpandStatus status = LLZeroCode::expand(*data, *data_size, mEncodedRecvBuffer, MAX_BUFFER_SIZE, out_size);
+    if (status != LLZeroCode::EXPAND_OK)
     {
-        count--;
-        *outptr++ = *inptr++;
-    }
-
-// reconstruct encoded packet, keeping track of net size gain
-
-// sequential zero bytes are encoded as 0 [U8 count]
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-    while (count--)
-    {
-        if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
-        {
-            LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-            callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-            outptr = mEncodedRecvBuffer;
-            break;
-        }
-        if (!((*outptr++ = *inptr++)))
-        {
-            while (((count--)) && (!(*inptr)))
-            {
-                *outptr++ = *inptr++;
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
-                {
-                    LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
-                    count = -1;
-                    break;
-                }
-                memset(outptr,0,255);
-                outptr += 255;
-            }
-
-            if (count < 0)
-            {
-                break;
-            }
-
-            else
-            {
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
-                {
-                    LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
-                }
-                memset(outptr,0,(*inptr) - 1);
-                outptr += ((*inptr) - 1);
-                inptr++;
-            }
-        }
+        LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size " << (S32)status << LL_ENDL;
+        callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
     }
 
     *data = mEncodedRecvBuffer;
-    *data_size = (S32)(outptr - mEncodedRecvBuffer);
+    *data_size = out_size;
+    // </FS>
     mUncompressedBytesIn += *data_size;
 
     return(in_size);
@@ -378,6 +378,11 @@ public:
     // template.
     void loadTemplateFile(const std::string& filename, bool failure_is_fatal);
 
+    // <FS> Keep a compiled cache of the template file in dir, and load the
+    // templates from it while the file is unchanged
+    static void setTemplateCacheDirectory(const std::string& dir);
+    // </FS>
+
 
     // methods for building, sending, receiving, and handling messages
     void    setHandlerFuncFast(const char *name, void (*handler_func)(LLMessageSystem *msgsystem, void **user_data), void **user_data = NULL);
@@ -458,6 +463,11 @@ public:
     LLStoredMessagePtr getBuiltMessage() const;
     S32 sendMessage(const LLHost &host, LLStoredMessagePtr message);
 
+    // <FS> The template reader while it holds the current message, for the
+    // indexed getters; NULL when the message came in as LLSD
+    LLTemplateMessageReader* getTemplateMessageReader() const;
+    // </FS>
+
 private:
     LLSD getReceivedMessageLLSD() const;
     LLSD getBuiltMessageLLSD() const;
@@ -890,6 +900,7 @@ private:
 
     static F32 mTimeDecodesSpamThreshold;  // If mTimeDecodes is on, all this many seconds for each msg decode before spamming
     static bool mTimeDecodes;  // Measure time for all message decodes if true;
+    static std::string sTemplateCacheDirectory; // <FS/>
 
     msg_timing_callback mTimingCallback;
     void* mTimingCallbackData;
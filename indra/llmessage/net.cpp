@@ -517,12 +517,31 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+// The address the datagram was sent to, from the IP_PKTINFO turned on in start_net()
+static void get_destip( struct msghdr *msg, U32 *dstip )
+{
+    struct cmsghdr *cmsgptr;
+    for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( msg, cmsgptr))
+    {
+        if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+        {
+            in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+            if( pktinfo )
+            {
+                // Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+                // routed. We should stay with specified until we go to multiple
+                // interfaces
+                *dstip = pktinfo->ipi_spec_dst.s_addr;
+            }
+        }
+    }
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
     int size;
     struct iovec iov[1];
     char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-    struct cmsghdr *cmsgptr;
     struct msghdr msg = {0};
 
     iov[0].iov_base = buf;
@@ -543,20 +562,9 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
         return -1;
     }
 
-    for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-    {
-        if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-        {
-            in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-            if( pktinfo )
-            {
-                // Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-                // routed. We should stay with specified until we go to multiple
-                // interfaces
-                *dstip = pktinfo->ipi_spec_dst.s_addr;
-            }
-        }
-    }
+    // <FS> Batched UDP I/O: shared with receive_packets()
+    get_destip(&msg, dstip);
+    // </FS>
 
     return size;
 }
@@ -652,6 +660,105 @@ bool send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
     return success;
 }
 
+// <FS> Batched UDP I/O
+#if LL_LINUX
+S32 receive_packets(int hSocket, char** receiveBuffers, S32* sizes, LLHost* senders, U32* receiving_ifs, S32 count)
+{
+    count = llmin(count, NET_BATCH_SIZE);
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    struct mmsghdr msgs[NET_BATCH_SIZE];
+    struct iovec iovs[NET_BATCH_SIZE];
+    struct sockaddr_in from[NET_BATCH_SIZE];
+    char cmsgs[NET_BATCH_SIZE][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (S32 i = 0; i < count; ++i)
+    {
+        iovs[i].iov_base = receiveBuffers[i];
+        iovs[i].iov_len = NET_BUFFER_SIZE;
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = cmsgs[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+    }
+
+    // The socket is non-blocking: this returns what is already queued
+    int received = recvmmsg(hSocket, msgs, count, 0, NULL);
+    if (received <= 0)
+    {
+        // Like receive_packet(), nothing received on error
+        return 0;
+    }
+
+    for (S32 i = 0; i < received; ++i)
+    {
+        sizes[i] = (S32)msgs[i].msg_len;
+        senders[i] = LLHost(from[i].sin_addr.s_addr, ntohs(from[i].sin_port));
+        receiving_ifs[i] = INVALID_HOST_IP_ADDRESS;
+        get_destip(&msgs[i].msg_hdr, &receiving_ifs[i]);
+    }
+
+    // get_sender() and get_receiving_interface() describe the last one
+    stSrcAddr = from[received - 1];
+    gsnReceivingIFAddr = receiving_ifs[received - 1];
+    return received;
+}
+
+S32 send_packets(int hSocket, const char* const* sendBuffers, const S32* sizes, const LLHost* recipients, S32 count)
+{
+    struct mmsghdr msgs[NET_BATCH_SIZE];
+    struct iovec iovs[NET_BATCH_SIZE];
+    struct sockaddr_in to[NET_BATCH_SIZE];
+
+    S32 failed = 0;
+    S32 sent = 0;
+    while (sent < count)
+    {
+        const S32 batch = llmin(count - sent, NET_BATCH_SIZE);
+        memset(msgs, 0, batch * sizeof(msgs[0]));
+        for (S32 i = 0; i < batch; ++i)
+        {
+            const LLHost& recipient = recipients[sent + i];
+            memset(&to[i], 0, sizeof(to[i]));
+            to[i].sin_family = AF_INET;
+            to[i].sin_addr.s_addr = recipient.getAddress();
+            to[i].sin_port = htons(recipient.getPort());
+            iovs[i].iov_base = const_cast<char*>(sendBuffers[sent + i]);
+            iovs[i].iov_len = sizes[sent + i];
+            msgs[i].msg_hdr.msg_name = &to[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(to[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int ret = sendmmsg(hSocket, msgs, batch, 0);
+        if (ret > 0)
+        {
+            sent += ret;
+        }
+        else
+        {
+            // The packet the batch stopped at goes out on its own, with the
+            // retries of send_packet()
+            const LLHost& recipient = recipients[sent];
+            if (!send_packet(hSocket, sendBuffers[sent], sizes[sent], recipient.getAddress(), recipient.getPort()))
+            {
+                ++failed;
+            }
+            ++sent;
+        }
+    }
+    return failed;
+}
+#endif
+// </FS>
+
 #endif
 
 //EOF
@@ -45,6 +45,21 @@ S32     receive_packet(int hSocket, char * receiveBuffer);
 
 bool    send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);   // Returns true on success.
 
+// <FS> Batched UDP I/O
+#if LL_LINUX
+// One recvmmsg()/sendmmsg() call for up to NET_BATCH_SIZE datagrams
+const S32 NET_BATCH_SIZE = 64;
+
+// Receives up to count packets into buffers of NET_BUFFER_SIZE bytes.
+// Returns how many were received, with their size, sender and receiving
+// interface address.
+S32     receive_packets(int hSocket, char** receiveBuffers, S32* sizes, LLHost* senders, U32* receiving_ifs, S32 count);
+
+// Returns the number of packets that could not be sent
+S32     send_packets(int hSocket, const char* const* sendBuffers, const S32* sizes, const LLHost* recipients, S32 count);
+#endif
+// </FS>
+
 //void  get_sender(char * tmp);
 LLHost  get_sender();
 U32     get_sender_port();
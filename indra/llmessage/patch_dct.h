@@ -90,5 +90,10 @@ void set_group_of_patch_header(LLGroupHeader *gopp);
 void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
+// <FS> Same result as decompress_patch() to the bit, with a SIMD IDCT and
+// no global state, so that any thread can call it. Returns false for patch
+// sizes other than 16 and 32.
+bool decompress_patch_block(F32 *patch, S32 stride, const S32 *cpatch, const LLPatchHeader *ph, S32 size);
+// </FS>
 
 #endif
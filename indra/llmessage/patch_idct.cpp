@@ -27,6 +27,7 @@
 #include "linden_common.h"
 
 #include "llmath.h"
+#include "llsimdmath.h"
 #include "v3math.h"
 #include "patch_dct.h"
 
@@ -38,14 +39,14 @@ void set_group_of_patch_header(LLGroupHeader *gopp)
 }
 
 F32 gPatchDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-void build_patch_dequantize_table(S32 size)
+void build_patch_dequantize_table(F32 *table, S32 size)
 {
     S32 i, j;
     for (j = 0; j < size; j++)
     {
         for (i = 0; i < size; i++)
         {
-            gPatchDequantizeTable[j*size + i] = (1.f + 2.f*(i+j));
+            table[j*size + i] = (1.f + 2.f*(i+j));
         }
     }
 }
@@ -54,7 +55,7 @@ S32 gCurrentDeSize = 0;
 
 F32 gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void setup_patch_icosines(S32 size)
+void setup_patch_icosines(F32 *icosines, S32 size)
 {
     S32 n, u;
     F32 oosob = F_PI*0.5f/size;
@@ -63,14 +64,14 @@ void setup_patch_icosines(S32 size)
     {
         for (n = 0; n < size; n++)
         {
-            gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+            icosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
         }
     }
 }
 
 S32 gDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void build_decopy_matrix(S32 size)
+void build_decopy_matrix(S32 *decopy_matrix, S32 size)
 {
     S32 i, j, count;
     bool    b_diag = false;
@@ -83,7 +84,7 @@ void build_decopy_matrix(S32 size)
     while (  (i < size)
            &&(j < size))
     {
-        gDeCopyMatrix[j*size + i] = count;
+        decopy_matrix[j*size + i] = count;
 
         count++;
 
@@ -139,9 +140,9 @@ void init_patch_decompressor(S32 size)
     if (size != gCurrentDeSize)
     {
         gCurrentDeSize = size;
-        build_patch_dequantize_table(size);
-        setup_patch_icosines(size);
-        build_decopy_matrix(size);
+        build_patch_dequantize_table(gPatchDequantizeTable, size);
+        setup_patch_icosines(gPatchICosines, size);
+        build_decopy_matrix(gDeCopyMatrix, size);
     }
 }
 
@@ -681,3 +682,206 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
     }
 }
 
+
+// <FS> Decompression for worker threads
+
+namespace
+{
+    // What init_patch_decompressor() builds, for one patch size. Built on
+    // first use and only read afterwards, so any thread can share them.
+    struct LLPatchDecompressTables
+    {
+        LL_ALIGN_16(F32 mDequantize[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+        LL_ALIGN_16(F32 mICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+        S32 mDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+
+        LLPatchDecompressTables(S32 size)
+        {
+            build_patch_dequantize_table(mDequantize, size);
+            setup_patch_icosines(mICosines, size);
+            build_decopy_matrix(mDeCopyMatrix, size);
+        }
+    };
+
+    const LLPatchDecompressTables& get_decompress_tables(S32 size)
+    {
+        static const LLPatchDecompressTables normal(NORMAL_PATCH_SIZE);
+        static const LLPatchDecompressTables large(LARGE_PATCH_SIZE);
+        return size == NORMAL_PATCH_SIZE ? normal : large;
+    }
+
+    // idct_patch() and idct_patch_large() with SSE2, on strips of 16 outputs
+    // of two lines or columns at a time. Each output is summed in the same
+    // order as there, so the results are the same to the bit. Rows and
+    // columns past the last non zero coefficient would only add zeroes and
+    // are skipped.
+    template <S32 SIZE>
+    void idct_columns_simd(const F32 *block, F32 *temp, const F32 *icosines, S32 rows)
+    {
+        const __m128 oo_sqrt2 = _mm_set1_ps(OO_SQRT2);
+        for (S32 c = 0; c < SIZE; c += 16)
+        {
+            // temp[n][c] = OO_SQRT2*block[0][c] + sum(block[u][c]*icosines[u][n])
+            const __m128 f0 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c));
+            const __m128 f1 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c + 4));
+            const __m128 f2 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c + 8));
+            const __m128 f3 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c + 12));
+            for (S32 n = 0; n < SIZE; n += 2)
+            {
+                __m128 a0 = f0, a1 = f1, a2 = f2, a3 = f3;
+                __m128 b0 = f0, b1 = f1, b2 = f2, b3 = f3;
+                for (S32 u = 1; u < rows; u++)
+                {
+                    const F32 *row = block + u*SIZE + c;
+                    const __m128 r0 = _mm_load_ps(row);
+                    const __m128 r1 = _mm_load_ps(row + 4);
+                    const __m128 r2 = _mm_load_ps(row + 8);
+                    const __m128 r3 = _mm_load_ps(row + 12);
+                    const __m128 ca = _mm_set1_ps(icosines[u*SIZE + n]);
+                    const __m128 cb = _mm_set1_ps(icosines[u*SIZE + n + 1]);
+                    a0 = _mm_add_ps(a0, _mm_mul_ps(r0, ca));
+                    a1 = _mm_add_ps(a1, _mm_mul_ps(r1, ca));
+                    a2 = _mm_add_ps(a2, _mm_mul_ps(r2, ca));
+                    a3 = _mm_add_ps(a3, _mm_mul_ps(r3, ca));
+                    b0 = _mm_add_ps(b0, _mm_mul_ps(r0, cb));
+                    b1 = _mm_add_ps(b1, _mm_mul_ps(r1, cb));
+                    b2 = _mm_add_ps(b2, _mm_mul_ps(r2, cb));
+                    b3 = _mm_add_ps(b3, _mm_mul_ps(r3, cb));
+                }
+                F32 *out = temp + n*SIZE + c;
+                _mm_store_ps(out, a0);
+                _mm_store_ps(out + 4, a1);
+                _mm_store_ps(out + 8, a2);
+                _mm_store_ps(out + 12, a3);
+                out += SIZE;
+                _mm_store_ps(out, b0);
+                _mm_store_ps(out + 4, b1);
+                _mm_store_ps(out + 8, b2);
+                _mm_store_ps(out + 12, b3);
+            }
+        }
+    }
+
+    template <S32 SIZE>
+    void idct_lines_simd(const F32 *temp, F32 *block, const F32 *icosines, S32 columns)
+    {
+        const __m128 oosob = _mm_set1_ps(2.f/SIZE);
+        for (S32 n = 0; n < SIZE; n += 16)
+        {
+            // block[l][n] = (OO_SQRT2*temp[l][0] + sum(temp[l][u]*icosines[u][n]))*oosob
+            for (S32 l = 0; l < SIZE; l += 2)
+            {
+                const F32 *line_a = temp + l*SIZE;
+                const F32 *line_b = line_a + SIZE;
+                __m128 a0 = _mm_set1_ps(OO_SQRT2*line_a[0]);
+                __m128 b0 = _mm_set1_ps(OO_SQRT2*line_b[0]);
+                __m128 a1 = a0, a2 = a0, a3 = a0;
+                __m128 b1 = b0, b2 = b0, b3 = b0;
+                for (S32 u = 1; u < columns; u++)
+                {
+                    const F32 *cosines = icosines + u*SIZE + n;
+                    const __m128 c0 = _mm_load_ps(cosines);
+                    const __m128 c1 = _mm_load_ps(cosines + 4);
+                    const __m128 c2 = _mm_load_ps(cosines + 8);
+                    const __m128 c3 = _mm_load_ps(cosines + 12);
+                    const __m128 va = _mm_set1_ps(line_a[u]);
+                    const __m128 vb = _mm_set1_ps(line_b[u]);
+                    a0 = _mm_add_ps(a0, _mm_mul_ps(va, c0));
+                    a1 = _mm_add_ps(a1, _mm_mul_ps(va, c1));
+                    a2 = _mm_add_ps(a2, _mm_mul_ps(va, c2));
+                    a3 = _mm_add_ps(a3, _mm_mul_ps(va, c3));
+                    b0 = _mm_add_ps(b0, _mm_mul_ps(vb, c0));
+                    b1 = _mm_add_ps(b1, _mm_mul_ps(vb, c1));
+                    b2 = _mm_add_ps(b2, _mm_mul_ps(vb, c2));
+                    b3 = _mm_add_ps(b3, _mm_mul_ps(vb, c3));
+                }
+                F32 *out = block + l*SIZE + n;
+                _mm_store_ps(out, _mm_mul_ps(a0, oosob));
+                _mm_store_ps(out + 4, _mm_mul_ps(a1, oosob));
+                _mm_store_ps(out + 8, _mm_mul_ps(a2, oosob));
+                _mm_store_ps(out + 12, _mm_mul_ps(a3, oosob));
+                out += SIZE;
+                _mm_store_ps(out, _mm_mul_ps(b0, oosob));
+                _mm_store_ps(out + 4, _mm_mul_ps(b1, oosob));
+                _mm_store_ps(out + 8, _mm_mul_ps(b2, oosob));
+                _mm_store_ps(out + 12, _mm_mul_ps(b3, oosob));
+            }
+        }
+    }
+
+    template <S32 SIZE>
+    void idct_patch_simd(F32 *block, const F32 *icosines, S32 rows, S32 columns)
+    {
+        LL_ALIGN_16(F32 temp[SIZE*SIZE]);
+        idct_columns_simd<SIZE>(block, temp, icosines, rows);
+        idct_lines_simd<SIZE>(temp, block, icosines, columns);
+    }
+}
+
+bool decompress_patch_block(F32 *patch, S32 stride, const S32 *cpatch, const LLPatchHeader *ph, S32 size)
+{
+    if (size != NORMAL_PATCH_SIZE && size != LARGE_PATCH_SIZE)
+    {
+        return false;
+    }
+
+    const LLPatchDecompressTables& tables = get_decompress_tables(size);
+    LL_ALIGN_16(F32 block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    LL_ALIGN_16(S32 coefficients[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+
+    // as decompress_patch()
+    F32     range = ph->range;
+    S32     prequant = (ph->quant_wbits >> 4) + 2;
+    S32     quantize = 1<<prequant;
+    F32     hmin = ph->dc_offset;
+
+    F32     ooq = 1.f/(F32)quantize;
+    F32     mult = ooq*range;
+    F32     addval = mult*(F32)(1<<(prequant - 1))+hmin;
+
+    // dequantize, noting the extent of the non zero coefficients
+    S32 rows = 1;
+    S32 columns = 1;
+    for (S32 j = 0; j < size; j++)
+    {
+        const S32 *decopy = tables.mDeCopyMatrix + j*size;
+        S32 *row = coefficients + j*size;
+        for (S32 i = 0; i < size; i++)
+        {
+            row[i] = cpatch[decopy[i]];
+            if (row[i])
+            {
+                rows = llmax(rows, j + 1);
+                columns = llmax(columns, i + 1);
+            }
+        }
+    }
+    for (S32 i = 0; i < size*size; i += 4)
+    {
+        const __m128 value = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)(coefficients + i)));
+        _mm_store_ps(block + i, _mm_mul_ps(value, _mm_load_ps(tables.mDequantize + i)));
+    }
+
+    if (size == NORMAL_PATCH_SIZE)
+    {
+        idct_patch_simd<NORMAL_PATCH_SIZE>(block, tables.mICosines, rows, columns);
+    }
+    else
+    {
+        idct_patch_simd<LARGE_PATCH_SIZE>(block, tables.mICosines, rows, columns);
+    }
+
+    const __m128 mult4 = _mm_set1_ps(mult);
+    const __m128 addval4 = _mm_set1_ps(addval);
+    for (S32 j = 0; j < size; j++)
+    {
+        F32 *tpatch = patch + j*stride;
+        const F32 *tblock = block + j*size;
+        for (S32 i = 0; i < size; i += 4)
+        {
+            _mm_storeu_ps(tpatch + i, _mm_add_ps(_mm_mul_ps(_mm_load_ps(tblock + i), mult4), addval4));
+        }
+    }
+    return true;
+}
+// </FS>
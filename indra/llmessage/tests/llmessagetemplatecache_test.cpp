@@ -0,0 +1,279 @@
+/**
+ * @file   llmessagetemplatecache_test.cpp
+ * @date   2024-11
+ * @brief  Test of the compiled message template cache.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llmessagetemplatecache.h"
+#include "../llmessagetemplate.h"
+#include "../llmessagetemplateparser.h"
+#include "llfile.h"
+#include "lluuid.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+    // The template the viewer ships, from the source tree
+    std::string read_template_file()
+    {
+        std::string filename(__FILE__);
+        filename = filename.substr(0, filename.find_last_of("/\\") + 1) + "../../../scripts/messages/message_template.msg";
+        std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    // The templates of a text, as LLMessageSystem::loadTemplateFile() parses them
+    struct ParsedTemplates
+    {
+        LLMessageTemplateCache::template_list_t mTemplates;
+        F32 mVersion{ 0.f };
+
+        ParsedTemplates(const std::string& source)
+        {
+            LLTemplateTokenizer tokens(source);
+            LLTemplateParser parsed(tokens);
+            mVersion = parsed.getVersion();
+            mTemplates.assign(parsed.getMessagesBegin(), parsed.getMessagesEnd());
+        }
+
+        ~ParsedTemplates()
+        {
+            for (LLMessageTemplate* templatep : mTemplates)
+            {
+                delete templatep;
+            }
+        }
+    };
+
+    std::string name_of(const char* name)
+    {
+        return name ? name : "";
+    }
+}
+
+namespace tut
+{
+    struct messagetemplatecache_data
+    {
+        std::string mSource;
+        std::string mCacheFile;
+
+        messagetemplatecache_data()
+        {
+            mSource = read_template_file();
+            LLUUID random;
+            random.generate();
+            mCacheFile = STRINGIZE(LLFile::tmpdir() << "llmessagetemplatecache-test-" << random << ".llmsgcache");
+        }
+
+        ~messagetemplatecache_data()
+        {
+            if (LLFile::isfile(mCacheFile))
+            {
+                LLFile::remove(mCacheFile);
+            }
+        }
+
+        void ensure_same_template(const std::string& msg, const LLMessageTemplate& expected, const LLMessageTemplate& actual)
+        {
+            ensure_equals(msg + " name", name_of(actual.mName), name_of(expected.mName));
+            ensure_equals(msg + " number", actual.mMessageNumber, expected.mMessageNumber);
+            ensure_equals(msg + " frequency", (S32)actual.mFrequency, (S32)expected.mFrequency);
+            ensure_equals(msg + " trust", (S32)actual.getTrust(), (S32)expected.getTrust());
+            ensure_equals(msg + " encoding", (S32)actual.getEncoding(), (S32)expected.getEncoding());
+            ensure_equals(msg + " deprecation", (S32)actual.getDeprecation(), (S32)expected.getDeprecation());
+            ensure_equals(msg + " total size", actual.mTotalSize, expected.mTotalSize);
+
+            ensure_equals(msg + " blocks", actual.mDecodeBlocks.size(), expected.mDecodeBlocks.size());
+            for (size_t b = 0; b < expected.mDecodeBlocks.size(); ++b)
+            {
+                const LLMessageTemplate::DecodeBlock& expected_block = expected.mDecodeBlocks[b];
+                const LLMessageTemplate::DecodeBlock& actual_block = actual.mDecodeBlocks[b];
+                const std::string block_msg = STRINGIZE(msg << " block " << name_of(expected_block.mName));
+                // the reader and builder look names up by the interned pointer
+                ensure_equals(block_msg + " name", (void*)actual_block.mName, (void*)expected_block.mName);
+                ensure_equals(block_msg + " type", (S32)actual_block.mType, (S32)expected_block.mType);
+                ensure_equals(block_msg + " number", actual_block.mNumber, expected_block.mNumber);
+                ensure_equals(block_msg + " variables", actual_block.mVariableCount, expected_block.mVariableCount);
+                for (S32 v = 0; v < expected_block.mVariableCount; ++v)
+                {
+                    const LLMessageTemplate::DecodeVariable& expected_variable = expected.mDecodeVariables[expected_block.mFirstVariable + v];
+                    const LLMessageTemplate::DecodeVariable& actual_variable = actual.mDecodeVariables[actual_block.mFirstVariable + v];
+                    const std::string variable_msg = STRINGIZE(block_msg << " variable " << name_of(expected_variable.mName));
+                    ensure_equals(variable_msg + " name", (void*)actual_variable.mName, (void*)expected_variable.mName);
+                    ensure_equals(variable_msg + " type", (S32)actual_variable.mType, (S32)expected_variable.mType);
+                    ensure_equals(variable_msg + " size", actual_variable.mSize, expected_variable.mSize);
+                }
+            }
+        }
+    };
+
+    typedef test_group<messagetemplatecache_data> messagetemplatecache_test;
+    typedef messagetemplatecache_test::object messagetemplatecache_object;
+    tut::messagetemplatecache_test messagetemplatecache_testcase("LLMessageTemplateCache");
+
+    template<> template<>
+    void messagetemplatecache_object::test<1>()
+    {
+        set_test_name("cached templates are the parsed ones");
+        if (mSource.empty())
+        {
+            skip("message_template.msg not found");
+        }
+
+        ParsedTemplates parsed(mSource);
+        ensure("templates parsed", !parsed.mTemplates.empty());
+        const U64 hash = LLMessageTemplateCache::hashSource(mSource);
+        ensure("cache written", LLMessageTemplateCache::write(mCacheFile, hash, parsed.mVersion, parsed.mTemplates));
+
+        LLMessageTemplateCache cache;
+        ensure("cache opened", cache.open(mCacheFile, hash));
+        ensure_equals("version", cache.getVersion(), parsed.mVersion);
+        ensure_equals("message count", cache.getMessageCount(), (S32)parsed.mTemplates.size());
+
+        S32 message = 0;
+        for (const LLMessageTemplate* expected : parsed.mTemplates)
+        {
+            ensure_equals("message name", std::string(cache.getMessageName(message)), name_of(expected->mName));
+            std::unique_ptr<LLMessageTemplate> actual(cache.createTemplate(message));
+            ensure_same_template(name_of(expected->mName), *expected, *actual);
+            ++message;
+        }
+    }
+
+    template<> template<>
+    void messagetemplatecache_object::test<2>()
+    {
+        set_test_name("stale and damaged caches are refused");
+        if (mSource.empty())
+        {
+            skip("message_template.msg not found");
+        }
+
+        ParsedTemplates parsed(mSource);
+        const U64 hash = LLMessageTemplateCache::hashSource(mSource);
+        ensure("cache written", LLMessageTemplateCache::write(mCacheFile, hash, parsed.mVersion, parsed.mTemplates));
+
+        LLMessageTemplateCache cache;
+        ensure("other template text", !cache.open(mCacheFile, LLMessageTemplateCache::hashSource(mSource + " ")));
+        ensure_equals("closed", cache.getMessageCount(), 0);
+        ensure("missing file", !cache.open(mCacheFile + ".missing", hash));
+
+        std::string contents;
+        {
+            std::ifstream file(mCacheFile.c_str(), std::ios::in | std::ios::binary);
+            std::ostringstream stream;
+            stream << file.rdbuf();
+            contents = stream.str();
+        }
+        auto rewrite = [this](const std::string& data)
+        {
+            std::ofstream file(mCacheFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            file.write(data.data(), data.size());
+        };
+
+        // names cut off
+        rewrite(contents.substr(0, contents.size() / 2));
+        ensure("truncated", !cache.open(mCacheFile, hash));
+
+        // no table
+        rewrite(contents.substr(0, 16));
+        ensure("header only", !cache.open(mCacheFile, hash));
+
+        // a name no longer NUL terminated
+        std::string damaged(contents);
+        damaged.back() = 'x';
+        rewrite(damaged);
+        ensure("unterminated name", !cache.open(mCacheFile, hash));
+
+        rewrite(contents);
+        ensure("intact", cache.open(mCacheFile, hash));
+    }
+
+    template<> template<>
+    void messagetemplatecache_object::test<3>()
+    {
+        set_test_name("message template load benchmark");
+
+        // Loads the templates that many times, parsing message_template.msg
+        // and then from the cache: LL_MESSAGE_TEMPLATE_BENCHMARK=<loads>
+        const char* loads = getenv("LL_MESSAGE_TEMPLATE_BENCHMARK");
+        if (!loads || !*loads)
+        {
+            skip("set LL_MESSAGE_TEMPLATE_BENCHMARK to run the message template load benchmark");
+        }
+        if (mSource.empty())
+        {
+            skip("message_template.msg not found");
+        }
+        const S32 count = llmax(atoi(loads), 1);
+
+        typedef std::chrono::high_resolution_clock clock;
+        S32 messages = 0;
+        clock::time_point start = clock::now();
+        for (S32 i = 0; i < count; ++i)
+        {
+            ParsedTemplates parsed(mSource);
+            messages += (S32)parsed.mTemplates.size();
+        }
+        const F64 parse_seconds = std::chrono::duration<F64>(clock::now() - start).count();
+
+        const U64 hash = LLMessageTemplateCache::hashSource(mSource);
+        {
+            ParsedTemplates parsed(mSource);
+            ensure("cache written", LLMessageTemplateCache::write(mCacheFile, hash, parsed.mVersion, parsed.mTemplates));
+        }
+
+        S32 cached_messages = 0;
+        start = clock::now();
+        for (S32 i = 0; i < count; ++i)
+        {
+            LLMessageTemplateCache cache;
+            ensure("cache opened", cache.open(mCacheFile, LLMessageTemplateCache::hashSource(mSource)));
+            for (S32 message = 0; message < cache.getMessageCount(); ++message)
+            {
+                delete cache.createTemplate(message);
+                ++cached_messages;
+            }
+        }
+        const F64 cache_seconds = std::chrono::duration<F64>(clock::now() - start).count();
+        ensure_equals("same messages", cached_messages, messages);
+
+        std::cout << "\n" << count << " loads of " << messages / count << " messages" << std::endl;
+        std::cout << "parse message_template.msg: " << parse_seconds * 1000. / count << " ms per load" << std::endl;
+        std::cout << "hash and open cache:        " << cache_seconds * 1000. / count << " ms per load" << std::endl;
+    }
+}
@@ -0,0 +1,489 @@
+/**
+ * @file   llpacketidring_test.cpp
+ * @date   2024-11
+ * @brief  Test for the reliable packet tracking of LLCircuitData.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcircuit.h"
+#include "../llpacketidring.h"
+#include "../message.h"
+#include "../net.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#if !LL_WINDOWS
+#include <netinet/in.h>
+#else
+#include "winsock2.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const S32 PACKET_SIZE = 1200;
+
+    // How the reliable packets of a circuit ended, from their callbacks
+    struct PacketResults
+    {
+        S32 mAcked = 0;
+        S32 mTimedOut = 0;
+        S32 mGone = 0;
+    };
+
+    void count_result(void** data, S32 result)
+    {
+        PacketResults* results = reinterpret_cast<PacketResults*>(data);
+        if (result == LL_ERR_NOERR)
+        {
+            results->mAcked++;
+        }
+        else if (result == LL_ERR_TCP_TIMEOUT)
+        {
+            results->mTimedOut++;
+        }
+        else if (result == LL_ERR_CIRCUIT_GONE)
+        {
+            results->mGone++;
+        }
+    }
+
+    // An LLCircuitData whose reliable packets the tests send, ack and time
+    // out themselves, as LLMessageSystem does
+    struct TestCircuit : public LLCircuitData
+    {
+        TestCircuit()
+            : LLCircuitData(LLHost("127.0.0.1", gMessageSystem->mPort), 0, F32Seconds(5.f), F32Seconds(100.f))
+        {
+        }
+
+        void send(TPACKETID id, S32 retries, F32Seconds timeout, PacketResults* results = NULL)
+        {
+            U8 buffer[PACKET_SIZE] = { 0 };
+            buffer[0] = LL_RELIABLE_FLAG;
+            *((U32*)&buffer[PHL_PACKET_ID]) = htonl(id);
+
+            LLReliablePacketParams params;
+            params.set(mHost, retries, false, timeout, results ? &count_result : NULL,
+                       reinterpret_cast<void**>(results), NULL);
+            addReliablePacket(gMessageSystem->mSocket, buffer, PACKET_SIZE, &params);
+        }
+
+        // The resend throttle as after a burst of resends
+        void overflowResends()
+        {
+            mThrottles.throttleOverflow(TC_RESEND, 1.e9f);
+        }
+
+        void openResendThrottle()
+        {
+            mThrottles.resetDynamicAdjust();
+        }
+
+        bool isUnacked(TPACKETID id) const
+        {
+            return mUnackedPackets.find(id) != NULL;
+        }
+
+        void setPacketOutID(TPACKETID id)
+        {
+            mPacketsOutID = id;
+        }
+
+        using LLCircuitData::getOldestUnackedID;
+    };
+}
+
+namespace tut
+{
+    struct packetidring_data
+    {
+        std::mt19937 mRandom{ 2024 };
+
+        packetidring_data()
+        {
+            // a message system without templates, for its socket and counters
+            static bool init = false;
+            if (!init)
+            {
+                start_messaging_system("notafile", NET_USE_OS_ASSIGNED_PORT, 1, 0, 0, false, "notasharedsecret",
+                                       NULL, false, 5.f, 100.f);
+                init = true;
+            }
+        }
+
+        F64Seconds now() const
+        {
+            return F64Seconds(totalTime());
+        }
+    };
+
+    typedef test_group<packetidring_data> packetidring_test;
+    typedef packetidring_test::object packetidring_object;
+    tut::packetidring_test packetidring_testcase("LLPacketIDRing");
+
+    template<> template<>
+    void packetidring_object::test<1>()
+    {
+        set_test_name("ring keeps the same ids as a map");
+
+        // runs of consecutive ids, a few far away ones, and ids across the wrap
+        LLPacketIDRing<U32> ring;
+        std::map<TPACKETID, U32> expected;
+        std::uniform_int_distribution<U32> op(0, 9);
+        std::uniform_int_distribution<U32> far(0, LL_MAX_OUT_PACKET_ID - 1);
+        TPACKETID next = LL_MAX_OUT_PACKET_ID - 300;
+        for (U32 i = 0; i < 20000; ++i)
+        {
+            const U32 what = op(mRandom);
+            if (what < 5)
+            {
+                ring.set(next, i);
+                expected[next] = i;
+                next = (next + 1) % LL_MAX_OUT_PACKET_ID;
+            }
+            else if (what < 6)
+            {
+                const TPACKETID id = (i % 2) ? far(mRandom) : (next + 64 * op(mRandom)) % LL_MAX_OUT_PACKET_ID;
+                ring.set(id, i);
+                expected[id] = i;
+            }
+            else if (!expected.empty())
+            {
+                // mostly the oldest ids, as acks do
+                auto iter = expected.begin();
+                std::advance(iter, std::min<size_t>(expected.size() - 1, op(mRandom) * (what == 9 ? 7 : 1)));
+                ensure(STRINGIZE("erase " << iter->first), ring.erase(iter->first));
+                ensure(STRINGIZE("erased " << iter->first), !ring.find(iter->first));
+                expected.erase(iter);
+            }
+
+            if (i % 1000 == 0 || i == 19999)
+            {
+                ensure_equals("size", ring.size(), (S32)expected.size());
+                for (const std::pair<const TPACKETID, U32>& pair : expected)
+                {
+                    const U32* value = ring.find(pair.first);
+                    ensure(STRINGIZE("find " << pair.first), value != NULL);
+                    ensure_equals(STRINGIZE("value " << pair.first), *value, pair.second);
+                }
+                S32 visited = 0;
+                ring.forEach([&](TPACKETID id, U32 value)
+                    {
+                        ++visited;
+                        ensure(STRINGIZE("visited " << id), expected.count(id) && expected[id] == value);
+                    });
+                ensure_equals("visited", visited, (S32)expected.size());
+            }
+        }
+
+        ensure("erase missing", !ring.erase(LL_MAX_OUT_PACKET_ID + 1));
+        ring.clear();
+        ensure("cleared", ring.empty() && !ring.find(next - 1));
+    }
+
+    template<> template<>
+    void packetidring_object::test<2>()
+    {
+        set_test_name("timer wheel expires after the deadline only");
+
+        LLPacketTimerWheel wheel;
+        std::vector<LLPacketTimerWheel::Entry> expired;
+        const F64Seconds start(5000.0);
+        wheel.collectExpired(start, expired);
+        ensure("empty wheel", expired.empty());
+
+        wheel.schedule(1, start + F64Seconds(0.25));
+        wheel.schedule(2, start + F64Seconds(0.25));
+        // more than a turn of the wheel away
+        const F64Seconds far_deadline = start + F64Seconds(2.5 * LLPacketTimerWheel::SLOT_COUNT / LLPacketTimerWheel::TICKS_PER_SECOND);
+        wheel.schedule(3, far_deadline);
+
+        wheel.collectExpired(start + F64Seconds(0.25), expired);
+        ensure("not before the deadline", expired.empty());
+        wheel.collectExpired(start + F64Seconds(0.2501), expired);
+        ensure_equals("at the deadline", expired.size(), 2);
+        ensure("same deadline", expired[0].mDeadline == start + F64Seconds(0.25));
+        expired.clear();
+
+        // a deadline the wheel is already past, as for a negative timeout
+        wheel.schedule(4, start);
+        wheel.collectExpired(start + F64Seconds(0.2502), expired);
+        ensure_equals("behind the wheel", expired.size(), 1);
+        ensure_equals("behind the wheel id", expired[0].mID, 4);
+        expired.clear();
+
+        // frames far apart go around the wheel several times
+        for (F64 t = 1.0; t < 40.0; t += 3.7)
+        {
+            wheel.collectExpired(start + F64Seconds(t), expired);
+            if (start + F64Seconds(t) > far_deadline)
+            {
+                break;
+            }
+            ensure(STRINGIZE("far deadline at " << t), expired.empty());
+        }
+        ensure_equals("far deadline", expired.size(), 1);
+        ensure_equals("far deadline id", expired[0].mID, 3);
+    }
+
+
+    template<> template<>
+    void packetidring_object::test<3>()
+    {
+        set_test_name("circuit resends until the final try, then times out");
+
+        TestCircuit circuit;
+        PacketResults results;
+        const F64Seconds start = now();
+        const F32Seconds timeout(1.f);
+        for (TPACKETID id = 1; id <= 10; ++id)
+        {
+            circuit.send(id, 2, timeout, &results);
+        }
+        ensure_equals("unacked", circuit.getUnackedPacketCount(), 10);
+        ensure_equals("unacked bytes", circuit.getUnackedPacketBytes(), 10 * PACKET_SIZE);
+
+        circuit.ackReliablePacket(3);
+        circuit.ackReliablePacket(5);
+        circuit.ackReliablePacket(5);
+        ensure_equals("acked", results.mAcked, 2);
+        ensure("ack removes", !circuit.isUnacked(3) && circuit.isUnacked(4));
+
+        // the message time stands still here, so the resend throttle is
+        // opened before each resend, as if a second had passed
+        const U32 resent = gMessageSystem->mResentPackets;
+        circuit.resendUnackedPackets(start + F64Seconds(0.5));
+        ensure_equals("nothing due", gMessageSystem->mResentPackets - resent, 0);
+        circuit.openResendThrottle();
+        circuit.resendUnackedPackets(start + F64Seconds(1.5));
+        ensure_equals("first resend", gMessageSystem->mResentPackets - resent, 8);
+        circuit.resendUnackedPackets(start + F64Seconds(2.0));
+        ensure_equals("not due again yet", gMessageSystem->mResentPackets - resent, 8);
+        circuit.openResendThrottle();
+        circuit.resendUnackedPackets(start + F64Seconds(3.0));
+        ensure_equals("second resend", gMessageSystem->mResentPackets - resent, 16);
+        ensure_equals("none timed out", results.mTimedOut, 0);
+
+        // an ack for a packet on its final try
+        circuit.ackReliablePacket(7);
+        ensure_equals("acked on the final try", results.mAcked, 3);
+
+        const U32 failed = gMessageSystem->mFailedResendPackets;
+        circuit.openResendThrottle();
+        circuit.resendUnackedPackets(start + F64Seconds(4.5));
+        ensure_equals("no third resend", gMessageSystem->mResentPackets - resent, 16);
+        ensure_equals("timed out", results.mTimedOut, 7);
+        ensure_equals("failed", gMessageSystem->mFailedResendPackets - failed, 7);
+        ensure_equals("none left", circuit.getUnackedPacketCount(), 0);
+        ensure_equals("no bytes left", circuit.getUnackedPacketBytes(), 0);
+    }
+
+    template<> template<>
+    void packetidring_object::test<4>()
+    {
+        set_test_name("circuit over its resend throttle and 512000 unacked bytes aborts");
+
+        TestCircuit circuit;
+        PacketResults results;
+        const F64Seconds start = now();
+        const S32 count = 512000 / PACKET_SIZE + 10;
+        for (S32 i = 1; i <= count; ++i)
+        {
+            circuit.send(i, 3, F32Seconds(1.f), &results);
+        }
+        ensure("over the limit", circuit.getUnackedPacketBytes() > 512000);
+
+        circuit.overflowResends();
+        const U32 resent = gMessageSystem->mResentPackets;
+        const U32 failed = gMessageSystem->mFailedResendPackets;
+        circuit.resendUnackedPackets(start + F64Seconds(1.5));
+        ensure_equals("not resent", gMessageSystem->mResentPackets - resent, 0);
+        ensure_equals("aborted", results.mTimedOut, count);
+        ensure_equals("failed", (S32)(gMessageSystem->mFailedResendPackets - failed), count);
+        ensure_equals("none left", circuit.getUnackedPacketCount(), 0);
+        ensure_equals("no bytes left", circuit.getUnackedPacketBytes(), 0);
+    }
+
+    template<> template<>
+    void packetidring_object::test<5>()
+    {
+        set_test_name("circuit over its resend throttle resends later");
+
+        TestCircuit circuit;
+        PacketResults results;
+        const F64Seconds start = now();
+        for (TPACKETID id = 1; id <= 20; ++id)
+        {
+            circuit.send(id, 3, F32Seconds(1.f), &results);
+        }
+
+        circuit.overflowResends();
+        const U32 resent = gMessageSystem->mResentPackets;
+        circuit.resendUnackedPackets(start + F64Seconds(1.5));
+        circuit.resendUnackedPackets(start + F64Seconds(1.6));
+        ensure_equals("stopped", gMessageSystem->mResentPackets - resent, 0);
+        ensure_equals("kept", circuit.getUnackedPacketCount(), 20);
+
+        // 100000 bits a second take 11 packets before the throttle closes
+        circuit.openResendThrottle();
+        circuit.resendUnackedPackets(start + F64Seconds(1.7));
+        ensure_equals("resent up to the throttle", gMessageSystem->mResentPackets - resent, 11);
+        circuit.openResendThrottle();
+        circuit.resendUnackedPackets(start + F64Seconds(1.8));
+        ensure_equals("resent the rest", gMessageSystem->mResentPackets - resent, 20);
+        circuit.openResendThrottle();
+        circuit.resendUnackedPackets(start + F64Seconds(2.0));
+        ensure_equals("each once", gMessageSystem->mResentPackets - resent, 20);
+        ensure_equals("none timed out", results.mTimedOut, 0);
+    }
+
+    template<> template<>
+    void packetidring_object::test<6>()
+    {
+        set_test_name("oldest unacked id across the packet id wrap");
+
+        TestCircuit circuit;
+        circuit.setPacketOutID(100);
+        ensure_equals("none unacked", circuit.getOldestUnackedID(), 100);
+        for (TPACKETID id = 40; id < 43; ++id)
+        {
+            circuit.send(id, 1, F32Seconds(100.f));
+        }
+        ensure_equals("lowest", circuit.getOldestUnackedID(), 40);
+
+        TestCircuit wrapped;
+        wrapped.setPacketOutID(3);
+        for (TPACKETID id = LL_MAX_OUT_PACKET_ID - 3; id != 3; id = (id + 1) % LL_MAX_OUT_PACKET_ID)
+        {
+            wrapped.send(id, 1, F32Seconds(100.f));
+        }
+        ensure_equals("before the wrap", wrapped.getOldestUnackedID(), LL_MAX_OUT_PACKET_ID - 3);
+        wrapped.ackReliablePacket(LL_MAX_OUT_PACKET_ID - 3);
+        ensure_equals("next before the wrap", wrapped.getOldestUnackedID(), LL_MAX_OUT_PACKET_ID - 2);
+        wrapped.ackReliablePacket(LL_MAX_OUT_PACKET_ID - 2);
+        wrapped.ackReliablePacket(LL_MAX_OUT_PACKET_ID - 1);
+        ensure_equals("after the wrap", wrapped.getOldestUnackedID(), 0);
+    }
+
+    template<> template<>
+    void packetidring_object::test<7>()
+    {
+        set_test_name("circuit packet tracking benchmark");
+
+        // Runs 3600 frames of that many circuits, each sending 20 reliable
+        // packets a frame with 5% of them never acked and acks held back in
+        // storms. The frames go as fast as they can, so fewer of them pass
+        // before a resend is due than at 60 a second:
+        // LL_CIRCUIT_BENCHMARK=<circuits>
+        const char* circuits_env = getenv("LL_CIRCUIT_BENCHMARK");
+        if (!circuits_env || !*circuits_env)
+        {
+            skip("set LL_CIRCUIT_BENCHMARK to run the circuit packet tracking benchmark");
+        }
+
+        struct Circuit
+        {
+            TestCircuit mCircuit;
+            TPACKETID mOutID = 0;
+            std::vector<std::pair<S32, TPACKETID> > mAcksInFlight;
+        };
+
+        const S32 FRAMES = 3600;
+        const S32 SENT_PER_FRAME = 20;
+        const S32 STORM_FRAMES = 90;
+        std::uniform_real_distribution<F32> unit(0.f, 1.f);
+        std::vector<std::unique_ptr<Circuit> > circuits;
+        for (S32 i = llmax(atoi(circuits_env), 1); i > 0; --i)
+        {
+            circuits.emplace_back(new Circuit);
+        }
+
+        const U32 resent = gMessageSystem->mResentPackets;
+        const U32 failed = gMessageSystem->mFailedResendPackets;
+        typedef std::chrono::high_resolution_clock clock;
+        clock::time_point start = clock::now();
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            LLMessageSystem::getMessageTimeSeconds(true);
+            const F64Seconds frame_time = now();
+            for (std::unique_ptr<Circuit>& circuit : circuits)
+            {
+                for (S32 i = 0; i < SENT_PER_FRAME; ++i)
+                {
+                    circuit->mOutID = (circuit->mOutID + 1) % LL_MAX_OUT_PACKET_ID;
+                    circuit->mCircuit.send(circuit->mOutID, 2, F32Seconds(0.5f));
+                    if (unit(mRandom) >= 0.05f)
+                    {
+                        circuit->mAcksInFlight.emplace_back(frame + 6 + (S32)(12 * unit(mRandom)), circuit->mOutID);
+                    }
+                }
+
+                const bool storm = (frame % STORM_FRAMES) > STORM_FRAMES / 2;
+                if (!storm)
+                {
+                    std::vector<std::pair<S32, TPACKETID> > waiting;
+                    for (const std::pair<S32, TPACKETID>& ack : circuit->mAcksInFlight)
+                    {
+                        if (ack.first <= frame)
+                        {
+                            circuit->mCircuit.ackReliablePacket(ack.second);
+                        }
+                        else
+                        {
+                            waiting.push_back(ack);
+                        }
+                    }
+                    circuit->mAcksInFlight.swap(waiting);
+                }
+
+                // a link with room for the resends
+                circuit->mCircuit.openResendThrottle();
+                circuit->mCircuit.resendUnackedPackets(frame_time);
+
+                // a ping every 300 frames, each circuit at its own time
+                if ((frame + (S32)(&circuit - &circuits[0]) * 7) % 300 == 0)
+                {
+                    circuit->mCircuit.setPacketOutID(circuit->mOutID);
+                    circuit->mCircuit.getOldestUnackedID();
+                }
+            }
+        }
+        const F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+
+        std::cout << "\n" << circuits.size() << " circuits, " << FRAMES << " frames in " << seconds << " s: "
+                  << gMessageSystem->mResentPackets - resent << " resent, "
+                  << gMessageSystem->mFailedResendPackets - failed << " failed, "
+                  << seconds * 1.e6 / FRAMES << " us per frame" << std::endl;
+    }
+}
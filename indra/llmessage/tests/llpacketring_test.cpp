@@ -0,0 +1,283 @@
+/**
+ * @file   llpacketring_test.cpp
+ * @date   2024-11
+ * @brief  Loopback test for the batched UDP I/O of LLPacketRing.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketring.h"
+#include "../net.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    // Two sockets on the loopback interface
+    struct LoopbackPair
+    {
+        S32 mReceiver = -1;
+        S32 mSender = -1;
+        int mReceiverPort = NET_USE_OS_ASSIGNED_PORT;
+        int mSenderPort = NET_USE_OS_ASSIGNED_PORT;
+
+        LoopbackPair()
+        {
+            if (start_net(mReceiver, mReceiverPort) != 0)
+            {
+                mReceiver = -1;
+            }
+            if (start_net(mSender, mSenderPort) != 0)
+            {
+                mSender = -1;
+            }
+        }
+
+        ~LoopbackPair()
+        {
+            if (mReceiver >= 0)
+            {
+                end_net(mReceiver);
+            }
+            if (mSender >= 0)
+            {
+                end_net(mSender);
+            }
+        }
+
+        bool isOpen() const { return mReceiver >= 0 && mSender >= 0; }
+        LLHost getReceiverHost() const { return LLHost(ip_string_to_u32("127.0.0.1"), mReceiverPort); }
+    };
+
+    // Packet number, then bytes that depend on it, of a size that depends on it
+    S32 fill_packet(char* buffer, S32 number)
+    {
+        const S32 size = 8 + (number * 37) % 1000;
+        memcpy(buffer, &number, sizeof(number));
+        for (S32 i = sizeof(number); i < size; ++i)
+        {
+            buffer[i] = (char)(number + i);
+        }
+        return size;
+    }
+
+    // Returns the number of the packet, -1 if it is not one of fill_packet()
+    S32 check_packet(const char* buffer, S32 size)
+    {
+        S32 number;
+        if (size < (S32)sizeof(number))
+        {
+            return -1;
+        }
+        memcpy(&number, buffer, sizeof(number));
+        char expected[NET_BUFFER_SIZE];
+        if (number < 0 || fill_packet(expected, number) != size || memcmp(expected, buffer, size) != 0)
+        {
+            return -1;
+        }
+        return number;
+    }
+
+    // Sends the packets numbered from first, in send batches when batch is set
+    void send_numbered(LLPacketRing& ring, const LoopbackPair& sockets, S32 first, S32 count, bool batch)
+    {
+        char buffer[NET_BUFFER_SIZE];
+        if (batch)
+        {
+            ring.beginSendBatch();
+        }
+        for (S32 number = first; number < first + count; ++number)
+        {
+            const S32 size = fill_packet(buffer, number);
+            ring.sendPacket(sockets.mSender, buffer, size, sockets.getReceiverHost());
+        }
+        if (batch)
+        {
+            ring.endSendBatch();
+        }
+    }
+}
+
+namespace tut
+{
+    struct packetring_data
+    {
+        LoopbackPair mSockets;
+        char mBuffer[NET_BUFFER_SIZE];
+
+        // Calls receivePacket() count times, the packet numbers delivered,
+        // -1 for the dropped ones
+        std::vector<S32> receive(LLPacketRing& ring, S32 count)
+        {
+            std::vector<S32> numbers;
+            for (S32 i = 0; i < count; ++i)
+            {
+                const S32 size = ring.receivePacket(mSockets.mReceiver, mBuffer);
+                if (size <= 0)
+                {
+                    numbers.push_back(-1);
+                    continue;
+                }
+                numbers.push_back(check_packet(mBuffer, size));
+                ensure_equals("sender port", ring.getLastSender().getPort(), (U32)mSockets.mSenderPort);
+                ensure_equals("receiving interface", ring.getLastReceivingInterface().getAddress(), ip_string_to_u32("127.0.0.1"));
+            }
+            return numbers;
+        }
+
+        void setup(LLPacketRing& ring, bool batch)
+        {
+            ring.setBatchIO(batch);
+            ensure_equals("batch I/O", ring.useBatchIO(), batch);
+        }
+    };
+
+    typedef test_group<packetring_data> packetring_test;
+    typedef packetring_test::object packetring_object;
+    tut::packetring_test packetring_testcase("LLPacketRing");
+
+    template<> template<>
+    void packetring_object::test<1>()
+    {
+        set_test_name("batched and single packet I/O deliver the same packets");
+#if ! LL_LINUX
+        skip("batched UDP I/O is Linux only");
+#endif
+        if (!mSockets.isOpen())
+        {
+            skip("no UDP sockets");
+        }
+
+        // more than a batch each way
+        const S32 COUNT = NET_BATCH_SIZE * 3 + 5;
+        for (bool batch : { false, true })
+        {
+            LLPacketRing ring;
+            setup(ring, batch);
+            send_numbered(ring, mSockets, 0, COUNT, batch);
+            std::vector<S32> numbers = receive(ring, COUNT);
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                ensure_equals(STRINGIZE("batch " << batch << " packet " << i), numbers[i], i);
+            }
+            ensure_equals(STRINGIZE("batch " << batch << " no more packets"), ring.receivePacket(mSockets.mReceiver, mBuffer), 0);
+        }
+    }
+
+    template<> template<>
+    void packetring_object::test<2>()
+    {
+        set_test_name("drop simulation and socket drain with batched I/O");
+#if ! LL_LINUX
+        skip("batched UDP I/O is Linux only");
+#endif
+        if (!mSockets.isOpen())
+        {
+            skip("no UDP sockets");
+        }
+
+        for (bool batch : { false, true })
+        {
+            LLPacketRing ring;
+            setup(ring, batch);
+
+            // the next n inbound packets are dropped, buffered or not
+            send_numbered(ring, mSockets, 0, 10, batch);
+            ring.dropPackets(3);
+            std::vector<S32> numbers = receive(ring, 10);
+            for (S32 i = 0; i < 10; ++i)
+            {
+                ensure_equals(STRINGIZE("batch " << batch << " packet " << i), numbers[i], i < 3 ? -1 : i);
+            }
+
+            // more than the default ring holds, which it grows for
+            const S32 COUNT = 300;
+            send_numbered(ring, mSockets, 0, COUNT, batch);
+            ensure_equals(STRINGIZE("batch " << batch << " drained"), ring.drainSocket(mSockets.mReceiver), COUNT);
+            ensure_equals(STRINGIZE("batch " << batch << " dropped"), ring.getNumDroppedPackets(), 0);
+
+            ring.dropPackets(1);
+            numbers = receive(ring, COUNT);
+            ensure_equals(STRINGIZE("batch " << batch << " dropped first"), numbers[0], -1);
+            for (S32 i = 1; i < COUNT; ++i)
+            {
+                ensure_equals(STRINGIZE("batch " << batch << " drained packet " << i), numbers[i], i);
+            }
+            ensure_equals(STRINGIZE("batch " << batch << " empty"), ring.getNumBufferedPackets(), 0);
+        }
+    }
+
+    template<> template<>
+    void packetring_object::test<3>()
+    {
+        set_test_name("UDP loopback benchmark");
+
+        // Sends and receives that many packets through LLPacketRing, a
+        // batch worth at a time, one packet per call and then batched:
+        // LL_UDP_BENCHMARK=<packets>
+        const char* packets = getenv("LL_UDP_BENCHMARK");
+        if (!packets || !*packets)
+        {
+            skip("set LL_UDP_BENCHMARK to run the UDP loopback benchmark");
+        }
+#if ! LL_LINUX
+        skip("batched UDP I/O is Linux only");
+#endif
+        if (!mSockets.isOpen())
+        {
+            skip("no UDP sockets");
+        }
+        const S32 count = llmax(atoi(packets), NET_BATCH_SIZE);
+
+        typedef std::chrono::high_resolution_clock clock;
+        std::cout << "\n" << count << " packets" << std::endl;
+        for (bool batch : { false, true })
+        {
+            LLPacketRing ring;
+            setup(ring, batch);
+
+            S32 received = 0;
+            clock::time_point start = clock::now();
+            for (S32 sent = 0; sent < count; sent += NET_BATCH_SIZE)
+            {
+                send_numbered(ring, mSockets, sent, NET_BATCH_SIZE, batch);
+                for (S32 i = 0; i < NET_BATCH_SIZE; ++i)
+                {
+                    received += ring.receivePacket(mSockets.mReceiver, mBuffer) > 0;
+                }
+            }
+            const F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+            ensure(STRINGIZE("batch " << batch << " received " << received), received > 0);
+
+            std::cout << (batch ? "recvmmsg/sendmmsg:  " : "recvmsg/sendto:     ")
+                      << (S64)(received / seconds) << " packets per second, "
+                      << (count - received) << " lost" << std::endl;
+        }
+    }
+}
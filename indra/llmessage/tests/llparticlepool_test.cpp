@@ -0,0 +1,430 @@
+/**
+ * @file   llparticlepool_test.cpp
+ * @date   2024-11
+ * @brief  Test for the particle integrator in llparticlepool.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llparticlepool.h"
+#include "llmath.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace
+{
+    // A particle as LLViewerPart keeps it
+    struct RefPart : public LLPartData
+    {
+        LLVector3   mPosAgent;
+        LLVector3   mVelocity;
+        LLVector3   mAccel;
+        LLColor4    mColor;
+        LLVector2   mScale;
+        F32         mLastUpdateTime = 0.f;
+        F32         mFrac = 0.f;
+    };
+
+    // The source a particle belongs to
+    struct RefSource
+    {
+        LLVector3   mPosAgent;
+        LLVector3   mTargetPosAgent;
+    };
+
+    // What LLViewerPartGroup::updateParticles() does to a particle, with
+    // the wind sampled at its position
+    void reference_update(RefPart& part, const RefSource& source, const LLVector3& wind_velocity, F32 dt)
+    {
+        const F32 cur_time = part.mLastUpdateTime + dt;
+        const F32 frac = cur_time / part.mMaxAge;
+
+        if (part.mFlags & LLPartData::LL_PART_WIND_MASK)
+        {
+            part.mVelocity *= 1.f - 0.1f*dt;
+            part.mVelocity += 0.1f*dt*wind_velocity;
+        }
+
+        if (part.mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
+        {
+            F32 remaining = part.mMaxAge - part.mLastUpdateTime;
+            F32 step = dt / remaining;
+
+            step = llclamp(step, 0.f, 0.1f);
+            step *= 5.f;
+            LLVector3 delta_pos = source.mTargetPosAgent - part.mPosAgent;
+
+            delta_pos /= remaining;
+
+            part.mVelocity *= (1.f - step);
+            part.mVelocity += step*delta_pos;
+        }
+
+        if (part.mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
+        {
+            LLVector3 delta_pos = source.mTargetPosAgent - source.mPosAgent;
+            part.mPosAgent = source.mPosAgent;
+            part.mPosAgent += frac*delta_pos;
+            part.mVelocity = delta_pos;
+        }
+        else
+        {
+            part.mPosAgent += dt*part.mVelocity;
+            part.mPosAgent += 0.5f*dt*dt*part.mAccel;
+            part.mVelocity += part.mAccel*dt;
+        }
+
+        if (part.mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+        {
+            F32 dz = part.mPosAgent.mV[VZ] - source.mPosAgent.mV[VZ];
+            if (dz < 0)
+            {
+                part.mPosAgent.mV[VZ] += -2.f*dz;
+                part.mVelocity.mV[VZ] *= -0.75f;
+            }
+        }
+
+        if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+        {
+            part.mPosOffset = part.mPosAgent;
+            part.mPosOffset -= source.mPosAgent;
+        }
+
+        if (part.mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+        {
+            part.mColor.setVec(part.mStartColor);
+            part.mColor *= 1.f - frac;
+            part.mColor %= 1.f - frac;
+            part.mColor += frac%(frac*part.mEndColor);
+        }
+
+        if (part.mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+        {
+            part.mScale.setVec(part.mStartScale);
+            part.mScale *= 1.f - frac;
+            part.mScale += frac*part.mEndScale;
+        }
+
+        part.mLastUpdateTime = cur_time;
+        part.mFrac = frac;
+    }
+
+    LLVector3 wind_at(const LLVector3& pos)
+    {
+        return LLVector3(sinf(pos.mV[VY] * 0.1f) * 3.f, cosf(pos.mV[VX] * 0.1f) * 3.f, 0.f);
+    }
+}
+
+namespace tut
+{
+    struct particlepool_data
+    {
+        std::mt19937 mRandom{ 2024 };
+
+        F32 frand(F32 low, F32 high)
+        {
+            return std::uniform_real_distribution<F32>(low, high)(mRandom);
+        }
+
+        // A script particle system, as llParticleSystem() would set it up
+        LLPartSysData makeSystem(U32 part_flags)
+        {
+            LLPartSysData system;
+            system.mPattern = LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE;
+            system.mBurstPartCount = 50;
+            system.mBurstRadius = 0.5f;
+            system.mBurstSpeedMin = 0.5f;
+            system.mBurstSpeedMax = 4.f;
+            system.mPartAccel.setVec(0.f, 0.f, -2.f);
+            system.mPartData.mFlags = part_flags;
+            system.mPartData.mMaxAge = frand(2.f, 8.f);
+            system.mPartData.mStartColor.setVec(1.f, 0.5f, 0.25f, 1.f);
+            system.mPartData.mEndColor.setVec(0.f, 0.2f, 1.f, 0.f);
+            system.mPartData.mStartScale.setVec(0.1f, 0.2f);
+            system.mPartData.mEndScale.setVec(1.f, 0.5f);
+            return system;
+        }
+
+        // A burst of the system, like LLViewerPartSourceScript::update()
+        void burst(const LLPartSysData& system, const RefSource& source, std::vector<RefPart>& parts)
+        {
+            for (S32 i = 0; i < system.mBurstPartCount; ++i)
+            {
+                RefPart part;
+                static_cast<LLPartData&>(part) = system.mPartData;
+                LLVector3 dir(frand(-1.f, 1.f), frand(-1.f, 1.f), frand(-1.f, 1.f));
+                dir.normVec();
+                part.mPosAgent = source.mPosAgent + dir * system.mBurstRadius;
+                part.mPosOffset = part.mPosAgent - source.mPosAgent;
+                part.mVelocity = dir * frand(system.mBurstSpeedMin, system.mBurstSpeedMax);
+                part.mAccel = system.mPartAccel;
+                part.mColor = part.mStartColor;
+                part.mScale = part.mStartScale;
+                part.mLastUpdateTime = frand(0.f, 1.f);
+                parts.push_back(part);
+            }
+        }
+
+        std::vector<RefPart> makeParticles(const RefSource& source, S32 bursts)
+        {
+            static const U32 FLAGS[] = {
+                0,
+                LLPartData::LL_PART_WIND_MASK | LLPartData::LL_PART_INTERP_COLOR_MASK,
+                LLPartData::LL_PART_BOUNCE_MASK | LLPartData::LL_PART_INTERP_SCALE_MASK,
+                LLPartData::LL_PART_TARGET_POS_MASK | LLPartData::LL_PART_FOLLOW_VELOCITY_MASK,
+                LLPartData::LL_PART_TARGET_LINEAR_MASK | LLPartData::LL_PART_INTERP_COLOR_MASK,
+                LLPartData::LL_PART_FOLLOW_SRC_MASK | LLPartData::LL_PART_WIND_MASK | LLPartData::LL_PART_BOUNCE_MASK,
+                LLPartData::LL_PART_TARGET_POS_MASK | LLPartData::LL_PART_TARGET_LINEAR_MASK | LLPartData::LL_PART_INTERP_SCALE_MASK,
+            };
+            std::vector<RefPart> parts;
+            for (S32 i = 0; i < bursts; ++i)
+            {
+                burst(makeSystem(FLAGS[i % LL_ARRAY_SIZE(FLAGS)]), source, parts);
+            }
+            std::shuffle(parts.begin(), parts.end(), mRandom);
+            return parts;
+        }
+
+        // What LLViewerPartGroup::simulate() puts in the pool
+        void fill(LLParticlePool& pool, const std::vector<RefPart>& parts, const RefSource& source,
+                  const std::vector<F32>& dts)
+        {
+            pool.resize((S32)parts.size());
+            for (size_t i = 0; i < parts.size(); ++i)
+            {
+                const RefPart& part = parts[i];
+                const LLVector3 wind = wind_at(part.mPosAgent);
+                pool.flags()[i] = part.mFlags;
+                for (S32 c = 0; c < 3; ++c)
+                {
+                    pool.field((LLParticlePool::EField)(LLParticlePool::POS_X + c))[i] = part.mPosAgent.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::VEL_X + c))[i] = part.mVelocity.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::ACCEL_X + c))[i] = part.mAccel.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::WIND_X + c))[i] = wind.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::SOURCE_X + c))[i] = source.mPosAgent.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::TARGET_X + c))[i] = source.mTargetPosAgent.mV[c];
+                }
+                for (S32 c = 0; c < 4; ++c)
+                {
+                    pool.field((LLParticlePool::EField)(LLParticlePool::COLOR_R + c))[i] = part.mColor.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::START_COLOR_R + c))[i] = part.mStartColor.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::END_COLOR_R + c))[i] = part.mEndColor.mV[c];
+                }
+                for (S32 c = 0; c < 2; ++c)
+                {
+                    pool.field((LLParticlePool::EField)(LLParticlePool::SCALE_X + c))[i] = part.mScale.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::START_SCALE_X + c))[i] = part.mStartScale.mV[c];
+                    pool.field((LLParticlePool::EField)(LLParticlePool::END_SCALE_X + c))[i] = part.mEndScale.mV[c];
+                }
+                pool.field(LLParticlePool::DT)[i] = dts[i];
+                pool.field(LLParticlePool::AGE)[i] = part.mLastUpdateTime;
+                pool.field(LLParticlePool::MAX_AGE)[i] = part.mMaxAge;
+            }
+        }
+
+        void ensureSame(const std::string& msg, F32 expected, F32 actual)
+        {
+            if (memcmp(&expected, &actual, sizeof(F32)))
+            {
+                fail(STRINGIZE(msg << " expected " << expected << " got " << actual));
+            }
+        }
+
+        void ensureSameAsReference(const std::string& msg, const LLParticlePool& pool,
+                                   const std::vector<RefPart>& parts)
+        {
+            for (size_t i = 0; i < parts.size(); ++i)
+            {
+                const RefPart& part = parts[i];
+                const std::string part_msg = STRINGIZE(msg << " particle " << i << " flags " << part.mFlags);
+                for (S32 c = 0; c < 3; ++c)
+                {
+                    ensureSame(part_msg + " position", part.mPosAgent.mV[c],
+                               pool.field((LLParticlePool::EField)(LLParticlePool::POS_X + c))[i]);
+                    ensureSame(part_msg + " velocity", part.mVelocity.mV[c],
+                               pool.field((LLParticlePool::EField)(LLParticlePool::VEL_X + c))[i]);
+                    if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+                    {
+                        ensureSame(part_msg + " offset", part.mPosOffset.mV[c],
+                                   pool.field((LLParticlePool::EField)(LLParticlePool::OFFSET_X + c))[i]);
+                    }
+                }
+                for (S32 c = 0; c < 4; ++c)
+                {
+                    ensureSame(part_msg + " color", part.mColor.mV[c],
+                               pool.field((LLParticlePool::EField)(LLParticlePool::COLOR_R + c))[i]);
+                }
+                for (S32 c = 0; c < 2; ++c)
+                {
+                    ensureSame(part_msg + " scale", part.mScale.mV[c],
+                               pool.field((LLParticlePool::EField)(LLParticlePool::SCALE_X + c))[i]);
+                }
+                ensureSame(part_msg + " age", part.mLastUpdateTime, pool.field(LLParticlePool::AGE)[i]);
+                ensureSame(part_msg + " frac", part.mFrac, pool.field(LLParticlePool::FRAC)[i]);
+            }
+        }
+    };
+
+    typedef test_group<particlepool_data> particlepool_test;
+    typedef particlepool_test::object particlepool_object;
+    tut::particlepool_test particlepool_testcase("LLParticlePool");
+
+    template<> template<>
+    void particlepool_object::test<1>()
+    {
+        set_test_name("integrate() matches the scalar particle update to the bit");
+
+        RefSource source;
+        source.mPosAgent.setVec(128.f, 128.f, 25.f);
+        source.mTargetPosAgent.setVec(140.f, 120.f, 40.f);
+        std::vector<RefPart> parts = makeParticles(source, 7 * 3);
+        // not a whole number of lanes
+        parts.resize(parts.size() - 3);
+
+        LLParticlePool pool;
+        for (S32 frame = 0; frame < 30; ++frame)
+        {
+            source.mPosAgent += LLVector3(0.1f, -0.05f, 0.02f);
+
+            // skipped groups step by more than a frame
+            std::vector<F32> dts(parts.size());
+            for (F32& dt : dts)
+            {
+                dt = (frame % 3) ? 1.f / 60.f : frand(0.f, 0.3f);
+            }
+
+            fill(pool, parts, source, dts);
+            pool.integrate();
+            for (size_t i = 0; i < parts.size(); ++i)
+            {
+                reference_update(parts[i], source, wind_at(parts[i].mPosAgent), dts[i]);
+            }
+            ensureSameAsReference(STRINGIZE("frame " << frame), pool, parts);
+        }
+    }
+
+    template<> template<>
+    void particlepool_object::test<2>()
+    {
+        set_test_name("the pool keeps its arrays and their values as it grows");
+
+        LLParticlePool pool;
+        ensure_equals("empty", pool.size(), 0);
+        pool.integrate();
+
+        pool.resize(5);
+        ensure_equals("size", pool.size(), 5);
+        ensure("whole lanes", pool.capacity() >= 8 && pool.capacity() % LLParticlePool::LANES == 0);
+        for (S32 i = 0; i < 5; ++i)
+        {
+            pool.field(LLParticlePool::POS_X)[i] = (F32)i;
+            pool.field(LLParticlePool::END_SCALE_Y)[i] = (F32)-i;
+            pool.flags()[i] = i;
+        }
+
+        F32* pos = pool.field(LLParticlePool::POS_X);
+        pool.resize(3);
+        ensure("shrinking keeps the arrays", pos == pool.field(LLParticlePool::POS_X));
+
+        pool.resize(100);
+        for (S32 field = 0; field < LLParticlePool::FIELD_COUNT; ++field)
+        {
+            ensure("aligned", ((uintptr_t)pool.field((LLParticlePool::EField)field) & 0xF) == 0);
+        }
+        ensure("aligned flags", ((uintptr_t)pool.flags() & 0xF) == 0);
+        for (S32 i = 0; i < 3; ++i)
+        {
+            ensure_equals("position kept", pool.field(LLParticlePool::POS_X)[i], (F32)i);
+            ensure_equals("end scale kept", pool.field(LLParticlePool::END_SCALE_Y)[i], (F32)-i);
+            ensure_equals("flags kept", pool.flags()[i], (U32)i);
+        }
+    }
+
+    template<> template<>
+    void particlepool_object::test<3>()
+    {
+        set_test_name("particle simulation benchmark");
+
+        // Steps synthetic script particle systems for a few hundred frames,
+        // one heap allocated particle at a time as before, then in the pool:
+        // LL_PARTICLE_BENCHMARK=<particle count>
+        const char* count_env = getenv("LL_PARTICLE_BENCHMARK");
+        const S32 count = count_env ? atoi(count_env) : 0;
+        if (count <= 0)
+        {
+            skip("set LL_PARTICLE_BENCHMARK to a particle count to run the particle simulation benchmark");
+        }
+
+        RefSource source;
+        source.mPosAgent.setVec(128.f, 128.f, 25.f);
+        source.mTargetPosAgent.setVec(140.f, 120.f, 40.f);
+        std::vector<RefPart> parts = makeParticles(source, (count + 49) / 50);
+        parts.resize(count);
+
+        // scattered over the heap, like particles born over many frames
+        std::vector<std::unique_ptr<RefPart> > heap_parts;
+        for (const RefPart& part : parts)
+        {
+            heap_parts.emplace_back(new RefPart(part));
+        }
+        std::shuffle(heap_parts.begin(), heap_parts.end(), mRandom);
+
+        const S32 FRAMES = 300;
+        const F32 DT = 1.f / 60.f;
+        std::vector<F32> dts(parts.size(), DT);
+
+        // the wind is sampled in both cases before the step, not timed here
+        const LLVector3 wind(1.f, 2.f, 0.f);
+
+        typedef std::chrono::high_resolution_clock clock;
+        clock::time_point start = clock::now();
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            for (const std::unique_ptr<RefPart>& part : heap_parts)
+            {
+                reference_update(*part, source, wind, DT);
+            }
+        }
+        clock::time_point scalar = clock::now();
+
+        LLParticlePool pool;
+        fill(pool, parts, source, dts);
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            pool.integrate();
+        }
+        clock::time_point simd = clock::now();
+
+        std::cout << "\n" << count << " particles, " << FRAMES << " frames\n"
+                  << "scalar: " << std::chrono::duration<F64, std::milli>(scalar - start).count() / FRAMES << " ms per frame\n"
+                  << "pool:   " << std::chrono::duration<F64, std::milli>(simd - scalar).count() / FRAMES << " ms per frame" << std::endl;
+    }
+}
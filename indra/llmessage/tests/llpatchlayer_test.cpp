@@ -0,0 +1,300 @@
+/**
+ * @file   llpatchlayer_test.cpp
+ * @date   2024-11
+ * @brief  Test for the terrain layer decoding in llpatchlayer.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpatchlayer.h"
+#include "../patch_code.h"
+#include "../patch_dct.h"
+#include "llbitpack.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    typedef std::vector<U8> payload_t;
+
+    // A land layer as the simulator sends it, encoded from heights laid out
+    // in a region of patches_per_edge patches of patch_size
+    payload_t encode_layer(const std::vector<F32>& heights, S32 patch_size, S32 patches_per_edge,
+                           const std::vector<std::pair<U32, U32> >& patches)
+    {
+        const S32 stride = patch_size * patches_per_edge;
+        payload_t data(patches.size() * 6000 + 64);
+        LLBitPack bitpack(data.data(), (U32)data.size());
+
+        init_patch_compressor(patch_size, stride, 'L');
+        LLGroupHeader group;
+        get_patch_group_header(&group);
+        init_patch_coding(bitpack);
+        code_patch_group_header(bitpack, &group);
+
+        for (const std::pair<U32, U32>& xy : patches)
+        {
+            F32* patch = const_cast<F32*>(heights.data()) + xy.second * patch_size * stride + xy.first * patch_size;
+            LLPatchHeader header;
+            F32 zmax, zmin;
+            prescan_patch(patch, &header, zmax, zmin);
+            S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+            compress_patch(patch, cpatch, &header, 10);
+            header.patchids = (xy.first << 5) | xy.second;
+            code_patch_header(bitpack, &header, cpatch);
+            code_patch(bitpack, cpatch, 0);
+        }
+        code_end_of_data(bitpack);
+        data.resize(bitpack.flushBitPack());
+        return data;
+    }
+
+    // What LLSurface::decompressDCTPatch() does, into a block per patch
+    std::vector<F32> decode_reference(payload_t data, S32& patch_count)
+    {
+        LLBitPack bitpack(data.data(), (U32)data.size());
+        LLGroupHeader group;
+        decode_patch_group_header(bitpack, &group);
+        const S32 patch_size = group.patch_size;
+        init_patch_decompressor(patch_size);
+        group.stride = patch_size;
+        set_group_of_patch_header(&group);
+
+        std::vector<F32> heights;
+        patch_count = 0;
+        while (true)
+        {
+            LLPatchHeader header;
+            decode_patch_header(bitpack, &header, false);
+            if (header.quant_wbits == END_OF_PATCHES)
+            {
+                break;
+            }
+            S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+            decode_patch(bitpack, cpatch);
+            heights.resize(heights.size() + patch_size * patch_size);
+            decompress_patch(heights.data() + patch_count * patch_size * patch_size, cpatch, &header);
+            ++patch_count;
+        }
+        return heights;
+    }
+}
+
+namespace tut
+{
+    struct patchlayer_data
+    {
+        std::mt19937 mRandom{ 2024 };
+
+        // Rolling hills, with a flat and a noisy patch
+        std::vector<F32> makeTerrain(S32 patch_size, S32 patches_per_edge)
+        {
+            const S32 width = patch_size * patches_per_edge;
+            std::uniform_real_distribution<F32> unit(0.f, 1.f);
+            const F32 phase = unit(mRandom) * 10.f;
+            std::vector<F32> heights(width * width);
+            for (S32 y = 0; y < width; ++y)
+            {
+                for (S32 x = 0; x < width; ++x)
+                {
+                    F32& h = heights[y * width + x];
+                    h = 20.f + 8.f * sinf(x * 0.05f + phase) * cosf(y * 0.07f) + 0.5f * unit(mRandom);
+                    if (x < patch_size && y < patch_size)
+                    {
+                        h = 21.f;
+                    }
+                    else if (x >= width - patch_size && y >= width - patch_size)
+                    {
+                        h = 60.f * unit(mRandom);
+                    }
+                }
+            }
+            return heights;
+        }
+
+        std::vector<std::pair<U32, U32> > allPatches(S32 patches_per_edge)
+        {
+            std::vector<std::pair<U32, U32> > patches;
+            for (S32 y = 0; y < patches_per_edge; ++y)
+            {
+                for (S32 x = 0; x < patches_per_edge; ++x)
+                {
+                    patches.emplace_back(x, y);
+                }
+            }
+            std::shuffle(patches.begin(), patches.end(), mRandom);
+            return patches;
+        }
+
+        void ensureSameAsReference(const std::string& msg, const payload_t& data)
+        {
+            S32 count = 0;
+            std::vector<F32> expected = decode_reference(data, count);
+
+            LLPatchLayer layer;
+            ensure(msg + " decoded", layer.decode(data.data(), (S32)data.size(), false));
+            ensure_equals(msg + " patches", (S32)layer.getPatches().size(), count);
+            const S32 patch_size = layer.getPatchSize();
+            for (S32 i = 0; i < count; ++i)
+            {
+                ensure(STRINGIZE(msg << " patch " << i),
+                       !memcmp(expected.data() + i * patch_size * patch_size, layer.getHeights(i),
+                               patch_size * patch_size * sizeof(F32)));
+            }
+        }
+    };
+
+    typedef test_group<patchlayer_data> patchlayer_test;
+    typedef patchlayer_test::object patchlayer_object;
+    tut::patchlayer_test patchlayer_testcase("LLPatchLayer");
+
+    template<> template<>
+    void patchlayer_object::test<1>()
+    {
+        set_test_name("layers decode to the bit as the scalar decoder");
+        for (S32 patch_size : { (S32)NORMAL_PATCH_SIZE, (S32)LARGE_PATCH_SIZE })
+        {
+            const S32 patches_per_edge = 4;
+            std::vector<F32> terrain = makeTerrain(patch_size, patches_per_edge);
+            payload_t data = encode_layer(terrain, patch_size, patches_per_edge, allPatches(patches_per_edge));
+            ensureSameAsReference(STRINGIZE("size " << patch_size), data);
+
+            LLPatchLayer layer;
+            layer.decode(data.data(), (S32)data.size(), false);
+            for (const LLPatchLayer::Patch& patch : layer.getPatches())
+            {
+                ensure("patch x", patch.mX < (U32)patches_per_edge);
+                ensure("patch y", patch.mY < (U32)patches_per_edge);
+            }
+        }
+    }
+
+    template<> template<>
+    void patchlayer_object::test<2>()
+    {
+        set_test_name("truncated and unsupported layers");
+        std::vector<F32> terrain = makeTerrain(NORMAL_PATCH_SIZE, 4);
+        payload_t data = encode_layer(terrain, NORMAL_PATCH_SIZE, 4, allPatches(4));
+
+        // cut in the middle of the last patches: the first ones are kept
+        LLPatchLayer layer;
+        ensure("truncated", layer.decode(data.data(), (S32)data.size() * 3 / 4, false));
+        ensure("some patches", !layer.getPatches().empty() && layer.getPatches().size() < 16);
+
+        // a patch size of 8 is left to the scalar decoder
+        payload_t odd = data;
+        odd[2] = 8;
+        ensure("patch size 8", !layer.decode(odd.data(), (S32)odd.size(), false));
+    }
+
+    template<> template<>
+    void patchlayer_object::test<3>()
+    {
+        set_test_name("terrain layer decode benchmark");
+
+        // Decodes the land LayerData payloads in a folder, one Data field
+        // per file, checking them against the scalar decoder first:
+        // LL_LAYERDATA_BENCHMARK_DIR=/path/to/payloads
+        // "synthetic" encodes 256 layers of a region's worth of patches.
+        const char* dir = getenv("LL_LAYERDATA_BENCHMARK_DIR");
+        if (!dir || !*dir)
+        {
+            skip("set LL_LAYERDATA_BENCHMARK_DIR to run the terrain layer decode benchmark");
+        }
+
+        std::vector<payload_t> payloads;
+        if (!strcmp(dir, "synthetic"))
+        {
+            for (S32 i = 0; i < 256; ++i)
+            {
+                std::vector<F32> terrain = makeTerrain(NORMAL_PATCH_SIZE, 16);
+                std::vector<std::pair<U32, U32> > patches = allPatches(16);
+                patches.resize(8);
+                payloads.push_back(encode_layer(terrain, NORMAL_PATCH_SIZE, 16, patches));
+            }
+        }
+        else
+        {
+            boost::system::error_code ec;
+            boost::filesystem::recursive_directory_iterator iter(dir, ec);
+            while (iter != boost::filesystem::recursive_directory_iterator() && !ec.failed())
+            {
+                if (boost::filesystem::is_regular_file(*iter, ec))
+                {
+                    std::ifstream file((*iter).path().string(), std::ios::binary);
+                    payloads.emplace_back((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                }
+                iter.increment(ec);
+            }
+        }
+        if (payloads.empty())
+        {
+            skip("no payloads found in LL_LAYERDATA_BENCHMARK_DIR");
+        }
+
+        S32 patches = 0;
+        for (size_t i = 0; i < payloads.size(); ++i)
+        {
+            S32 count = 0;
+            decode_reference(payloads[i], count);
+            patches += count;
+            ensureSameAsReference(STRINGIZE("payload " << i), payloads[i]);
+        }
+
+        const S32 ROUNDS = 20;
+        typedef std::chrono::high_resolution_clock clock;
+        clock::time_point start = clock::now();
+        for (S32 round = 0; round < ROUNDS; ++round)
+        {
+            for (const payload_t& payload : payloads)
+            {
+                S32 count = 0;
+                decode_reference(payload, count);
+            }
+        }
+        clock::time_point scalar = clock::now();
+        for (S32 round = 0; round < ROUNDS; ++round)
+        {
+            for (const payload_t& payload : payloads)
+            {
+                LLPatchLayer layer;
+                layer.decode(payload.data(), (S32)payload.size(), false);
+            }
+        }
+        clock::time_point simd = clock::now();
+
+        std::cout << "\n" << payloads.size() << " layers, " << patches << " patches\n"
+                  << "scalar: " << std::chrono::duration<F64, std::micro>(scalar - start).count() / (ROUNDS * patches) << " us per patch\n"
+                  << "SIMD:   " << std::chrono::duration<F64, std::micro>(simd - scalar).count() / (ROUNDS * patches) << " us per patch" << std::endl;
+    }
+}
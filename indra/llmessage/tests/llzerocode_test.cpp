@@ -0,0 +1,268 @@
+/**
+ * @file   llzerocode_test.cpp
+ * @date   2024-11
+ * @brief  Test for the expansion of zero-coded packets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llzerocode.h"
+
+#include "../test/lltut.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    const S32 HEADER_SIZE = 6;      // LL_PACKET_ID_SIZE
+    const S32 BUFFER_SIZE = 8192;   // MAX_BUFFER_SIZE
+
+    // The byte at a time loop of LLMessageSystem::zeroCodeExpand() that
+    // LLZeroCode replaced, returning the failed check or 0
+    S32 reference_expand(const U8* in, S32 in_size, U8* out, S32& out_size)
+    {
+        S32 count = in_size;
+        const U8* inptr = in;
+        U8* outptr = out;
+        S32 failed = 0;
+
+        for (S32 ii = 0; ii < HEADER_SIZE; ++ii)
+        {
+            count--;
+            *outptr++ = *inptr++;
+        }
+
+        while (count--)
+        {
+            if (outptr > (&out[BUFFER_SIZE - 1]))
+            {
+                failed = 1;
+                outptr = out;
+                break;
+            }
+            if (!((*outptr++ = *inptr++)))
+            {
+                while (((count--)) && (!(*inptr)))
+                {
+                    *outptr++ = *inptr++;
+                    if (outptr > (&out[BUFFER_SIZE - 256]))
+                    {
+                        failed = 2;
+                        outptr = out;
+                        count = -1;
+                        break;
+                    }
+                    memset(outptr, 0, 255);
+                    outptr += 255;
+                }
+
+                if (count < 0)
+                {
+                    break;
+                }
+                if (outptr > (&out[BUFFER_SIZE - (*inptr)]))
+                {
+                    // the original went on writing from the start of the buffer
+                    failed = 3;
+                    outptr = out;
+                    break;
+                }
+                memset(outptr, 0, (*inptr) - 1);
+                outptr += ((*inptr) - 1);
+                inptr++;
+            }
+        }
+
+        out_size = (S32)(outptr - out);
+        return failed;
+    }
+
+    // Zero codes a packet the way LLTemplateMessageBuilder does
+    std::vector<U8> encode(const std::vector<U8>& packet)
+    {
+        std::vector<U8> encoded(packet.begin(), packet.begin() + HEADER_SIZE);
+        U8 num_zeroes = 0;
+        for (size_t i = HEADER_SIZE; i < packet.size(); ++i)
+        {
+            if (!packet[i])
+            {
+                if (num_zeroes)
+                {
+                    if (++num_zeroes > 254)
+                    {
+                        encoded.push_back(num_zeroes);
+                        num_zeroes = 0;
+                    }
+                }
+                else
+                {
+                    encoded.push_back(0);
+                    num_zeroes = 1;
+                }
+            }
+            else
+            {
+                if (num_zeroes)
+                {
+                    encoded.push_back(num_zeroes);
+                    num_zeroes = 0;
+                }
+                encoded.push_back(packet[i]);
+            }
+        }
+        if (num_zeroes)
+        {
+            encoded.push_back(num_zeroes);
+        }
+        return encoded;
+    }
+
+    // Bytes with runs of zeros of every length, like the object updates
+    std::vector<U8> make_packet(std::mt19937& rng, S32 size)
+    {
+        std::vector<U8> packet(size);
+        S32 i = 0;
+        while (i < size)
+        {
+            const S32 literals = std::min<S32>(rng() % 40, size - i);
+            for (S32 k = 0; k < literals; ++k)
+            {
+                packet[i++] = (U8)(1 + rng() % 255);
+            }
+            const S32 zeros = std::min<S32>((rng() % 8) ? rng() % 20 : rng() % 700, size - i);
+            i += zeros;
+        }
+        return packet;
+    }
+}
+
+namespace tut
+{
+    struct zerocode_data
+    {
+        void ensure_same(const std::string& msg, const std::vector<U8>& in)
+        {
+            std::vector<U8> expected(BUFFER_SIZE + 256);
+            std::vector<U8> actual(BUFFER_SIZE);
+            S32 expected_size = 0;
+            S32 actual_size = -1;
+            const S32 failed = reference_expand(in.data(), (S32)in.size(), expected.data(), expected_size);
+            const LLZeroCode::EExpandStatus status =
+                LLZeroCode::expand(in.data(), (S32)in.size(), actual.data(), BUFFER_SIZE, actual_size);
+
+            ensure_equals(msg + " status", (S32)status, failed);
+            ensure_equals(msg + " size", actual_size, expected_size);
+            ensure(msg + " data", !memcmp(actual.data(), expected.data(), actual_size));
+        }
+    };
+    typedef test_group<zerocode_data> zerocode_test;
+    typedef zerocode_test::object zerocode_object;
+    tut::zerocode_test zerocode_testcase("LLZeroCode");
+
+    template<> template<>
+    void zerocode_object::test<1>()
+    {
+        set_test_name("round trip of encoded packets");
+
+        std::mt19937 rng(1234);
+        for (S32 i = 0; i < 2000; ++i)
+        {
+            std::vector<U8> packet = make_packet(rng, HEADER_SIZE + rng() % 2000);
+            std::vector<U8> encoded = encode(packet);
+
+            std::vector<U8> decoded(BUFFER_SIZE);
+            S32 decoded_size = 0;
+            ensure_equals("status", LLZeroCode::expand(encoded.data(), (S32)encoded.size(), decoded.data(), BUFFER_SIZE, decoded_size),
+                          LLZeroCode::EXPAND_OK);
+            // including the trailing zeros
+            ensure_equals("size", decoded_size, (S32)packet.size());
+            ensure("data", !memcmp(decoded.data(), packet.data(), packet.size()));
+            ensure_same("encoded", encoded);
+        }
+    }
+
+    template<> template<>
+    void zerocode_object::test<2>()
+    {
+        set_test_name("same results as the byte at a time decoder");
+
+        const U8 header[HEADER_SIZE] = { 0x80, 0, 0, 0, 1, 0 };
+        std::vector<U8> in(header, header + HEADER_SIZE);
+        ensure_same("header only", in);
+
+        in.push_back(0);
+        ensure_same("run cut off", in);
+        in.push_back(0);
+        ensure_same("wrap cut off", in);
+        in.push_back(3);
+        in.push_back(7);
+        ensure_same("wrapped run", in);
+
+        // literals, runs and wraps up to and past the end of the buffer
+        std::mt19937 rng(4321);
+        for (S32 i = 0; i < 5000; ++i)
+        {
+            std::vector<U8> fuzz(header, header + HEADER_SIZE);
+            const S32 size = 1 + rng() % 600;
+            const bool long_runs = rng() % 2;
+            for (S32 k = 0; k < size; ++k)
+            {
+                const U32 pick = rng() % 10;
+                fuzz.push_back(pick < 3 ? 0 : (long_runs && pick < 6) ? (U8)(200 + rng() % 56) : (U8)(1 + rng() % 255));
+            }
+            ensure_same("fuzz", fuzz);
+        }
+    }
+
+    template<> template<>
+    void zerocode_object::test<3>()
+    {
+        set_test_name("overflow of the output buffer");
+
+        const U8 header[HEADER_SIZE] = { 0x80, 0, 0, 0, 1, 0 };
+
+        std::vector<U8> literals(header, header + HEADER_SIZE);
+        literals.insert(literals.end(), BUFFER_SIZE, 1);
+        ensure_same("literals", literals);
+
+        std::vector<U8> wraps(header, header + HEADER_SIZE);
+        wraps.insert(wraps.end(), 40, 0);
+        wraps.push_back(1);
+        ensure_same("wraps", wraps);
+
+        std::vector<U8> runs(header, header + HEADER_SIZE);
+        for (S32 i = 0; i < 40; ++i)
+        {
+            runs.push_back(0);
+            runs.push_back(255);
+        }
+        ensure_same("runs", runs);
+
+        S32 out_size = -1;
+        std::vector<U8> out(BUFFER_SIZE);
+        ensure("failure reported", LLZeroCode::expand(runs.data(), (S32)runs.size(), out.data(), BUFFER_SIZE, out_size) != LLZeroCode::EXPAND_OK);
+        ensure_equals("nothing decoded", out_size, 0);
+    }
+}
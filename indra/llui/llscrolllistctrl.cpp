@@ -447,20 +447,22 @@ S32 LLScrollListCtrl::getItemCount() const
     // <FS:Ansariel> Fix for FS-specific people list (radar)
     if (mIsFiltered)
     {
-        S32 count(0);
-        item_list::const_iterator iter;
-        for(iter = mItemList.begin(); iter != mItemList.end(); iter++)
-        {
-            LLScrollListItem* item  = *iter;
-            std::string filterColumnValue = item->getColumn(mFilterColumn)->getValue().asString();
-            std::transform(filterColumnValue.begin(), filterColumnValue.end(), filterColumnValue.begin(), ::tolower);
-            if (filterColumnValue.find(mFilterString) == std::string::npos)
+        // <FS> Counted once per filter stamp, addItem() keeps it up
+        const U32 stamp = getFilterStamp();
+        if (mFilteredCountStamp != stamp)
+        {
+            mFilteredCount = 0;
+            for (const LLScrollListItem* item : mItemList)
             {
-                continue;
+                if (!isFiltered(item))
+                {
+                    ++mFilteredCount;
+                }
             }
-            count++;
+            mFilteredCountStamp = stamp;
         }
-        return count;
+        return mFilteredCount;
+        // </FS>
     }
     // </FS:Ansariel> Fix for FS-specific people list (radar)
 
@@ -487,6 +489,7 @@ void LLScrollListCtrl::clearRows()
 {
     std::for_each(mItemList.begin(), mItemList.end(), DeletePointer());
     mItemList.clear();
+    mFilteredCountStamp = 0; // <FS/> getItemCount() counts again
     //mItemCount = 0;
 
     // Scroll the bar back up to the top.
@@ -714,6 +717,13 @@ bool LLScrollListCtrl::addItem( LLScrollListItem* item, EAddPosition pos, bool r
 
         updateLineHeightInsert(item);
 
+        // <FS> Keep the count of getItemCount(), instead of counting again
+        if (mIsFiltered && mFilteredCountStamp == getFilterStamp() && !isFiltered(item))
+        {
+            ++mFilteredCount;
+        }
+        // </FS>
+
         updateLayout();
     }
 
@@ -1001,6 +1011,7 @@ bool LLScrollListCtrl::selectItemRange(S32 first_index, S32 last_index)
         if (!itemp)
         {
             iter = mItemList.erase(iter);
+            mFilteredCountStamp = 0; // <FS/> getItemCount() counts again
             continue;
         }
 
@@ -1085,6 +1096,7 @@ void LLScrollListCtrl::deleteSingleItem(S32 target_index)
     }
     delete itemp;
     mItemList.erase(mItemList.begin() + target_index);
+    mFilteredCountStamp = 0; // <FS/> getItemCount() counts again
     dirtyColumns();
 }
 
@@ -1103,6 +1115,7 @@ void LLScrollListCtrl::deleteItems(const LLSD& sd)
             }
             delete itemp;
             iter = mItemList.erase(iter);
+            mFilteredCountStamp = 0; // <FS/> getItemCount() counts again
         }
         else
         {
@@ -1123,6 +1136,7 @@ void LLScrollListCtrl::deleteSelectedItems()
         {
             delete itemp;
             iter = mItemList.erase(iter);
+            mFilteredCountStamp = 0; // <FS/> getItemCount() counts again
         }
         else
         {
@@ -3185,7 +3199,10 @@ void LLScrollListCtrl::updateSort() const
         mLastUpdateFrame=0;
     // </FS:Beq>
         // do stable sort to preserve any previous sorts
-        std::stable_sort(
+        // <FS> Rows added to a sorted list only need to be merged in
+        //std::stable_sort(
+        ll_stable_sort_appended(
+        // </FS>
             mItemList.begin(),
             mItemList.end(),
             SortScrollListItem(mSortColumns,mSortCallback, mAlternateSort));
@@ -3201,7 +3218,10 @@ void LLScrollListCtrl::sortOnce(S32 column, bool ascending)
     sort_column.push_back(std::make_pair(column, ascending));
 
     // do stable sort to preserve any previous sorts
-    std::stable_sort(
+    // <FS> Rows added to a sorted list only need to be merged in
+    //std::stable_sort(
+    ll_stable_sort_appended(
+    // </FS>
         mItemList.begin(),
         mItemList.end(),
         SortScrollListItem(sort_column,mSortCallback,mAlternateSort));
@@ -3904,6 +3924,7 @@ void LLScrollListCtrl::setFilterString(const std::string& str)
     mFilterString = str;
     std::transform(mFilterString.begin(), mFilterString.end(), mFilterString.begin(), ::tolower);
     mIsFiltered = (mFilterColumn > -1 && !mFilterString.empty());
+    nextFilterStamp(); // <FS/> match the items again
     updateLayout();
 
     if (mIsFiltered && getNumSelected() > 0 && isFiltered(getFirstSelected()))
@@ -3923,15 +3944,47 @@ bool LLScrollListCtrl::isFiltered(const LLScrollListItem* item) const
 {
     if (mIsFiltered)
     {
+        // <FS> Matched once per filter stamp, the lists ask for every item several times a frame
+        const U32 stamp = getFilterStamp();
+        if (item->mFilterStamp == stamp)
+        {
+            return item->mFilteredOut;
+        }
+        item->mFilterStamp = stamp;
+        item->mFilteredOut = false;
+        // </FS>
         std::string filterColumnValue = item->getColumn(mFilterColumn)->getValue().asString();
         std::transform(filterColumnValue.begin(), filterColumnValue.end(), filterColumnValue.begin(), ::tolower);
         if (filterColumnValue.find(mFilterString) == std::string::npos)
         {
+            item->mFilteredOut = true; // <FS/>
             return true;
         }
     }
     return false;
 }
+
+// <FS> A new stamp with the filter and with each frame
+U32 LLScrollListCtrl::getFilterStamp() const
+{
+    const U32 frame = LLFrameTimer::getFrameCount();
+    if (frame != mFilterFrame)
+    {
+        mFilterFrame = frame;
+        nextFilterStamp();
+    }
+    return mFilterStamp;
+}
+
+void LLScrollListCtrl::nextFilterStamp() const
+{
+    // 0 is the stamp of no item and of no count
+    if (++mFilterStamp == 0)
+    {
+        ++mFilterStamp;
+    }
+}
+// </FS>
 // </FS:Ansariel> Fix for FS-specific people list (radar)
 
 // <FS:Ansariel> Persists sort order of scroll lists
@@ -350,7 +350,8 @@ public:
 
     // <FS:Ansariel> Fix for FS-specific people list (radar)
     void            setFilterString(const std::string& str);
-    void            setFilterColumn(S32 col) { mFilterColumn = col; }
+    //void            setFilterColumn(S32 col) { mFilterColumn = col; }
+    void            setFilterColumn(S32 col) { mFilterColumn = col; nextFilterStamp(); } // <FS/>
     bool            isFiltered(const LLScrollListItem* item) const;
     // </FS:Ansariel> Fix for FS-specific people list (radar)
 
@@ -502,6 +503,11 @@ private:
     // <FS:Ansariel> Persists sort order of scroll lists
     void            loadPersistedSortOrder();
 
+    // <FS>
+    U32             getFilterStamp() const;
+    void            nextFilterStamp() const;
+    // </FS>
+
     static void     showProfile(std::string id, bool is_group);
     static void     sendIM(std::string id);
     static void     addFriend(std::string id);
@@ -575,6 +581,13 @@ private:
     std::string     mFilterString;
     S32             mFilterColumn;
     bool            mIsFiltered;
+    // <FS> isFiltered() and getItemCount() are kept per filter stamp, which
+    // changes with the filter and every frame, as cells can change in place
+    mutable U32     mFilterStamp = 1;
+    mutable U32     mFilterFrame = 0;
+    mutable U32     mFilteredCountStamp = 0;   // 0: mFilteredCount to count again
+    mutable S32     mFilteredCount = 0;
+    // </FS>
 
     S32             mSearchColumn;
     S32             mNumDynamicWidthColumns;
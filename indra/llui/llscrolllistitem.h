@@ -137,6 +137,10 @@ private:
     LLSD    mItemAltValue;
     std::vector<LLScrollListCell *> mColumns;
     LLRect  mRectangle;
+    // <FS> LLScrollListCtrl::isFiltered() of the filter stamp
+    mutable U32     mFilterStamp = 0;
+    mutable bool    mFilteredOut = false;
+    // </FS>
 };
 
 #endif
@@ -3949,9 +3949,16 @@ F32 LLNormalTextSegment::drawClippedSegment(S32 seg_start, S32 seg_end, S32 sele
     {
         mLastGeneration = text_gen;
 
-        mFontBufferPreSelection.reset();
-        mFontBufferSelection.reset();
-        mFontBufferPostSelection.reset();
+        // <FS> Any edit, appending a chat line too, changes the generation of
+        // the whole document: only drop the glyph runs if the text of this
+        // segment changed. Moving it is caught by the buffers themselves.
+        if (mTextRunStamp.update(text, mStart, mEnd))
+        {
+        // </FS>
+            mFontBufferPreSelection.reset();
+            mFontBufferSelection.reset();
+            mFontBufferPostSelection.reset();
+        } // <FS/>
     }
 
     const LLFontGL* font = mStyle->getFont();
@@ -4285,9 +4292,12 @@ void LLNormalTextSegment::updateLayout(const class LLTextBase& editor)
 {
     LLTextSegment::updateLayout(editor);
 
-    mFontBufferPreSelection.reset();
-    mFontBufferSelection.reset();
-    mFontBufferPostSelection.reset();
+    // <FS> Keep the glyph runs through reflows: the buffers rebuild when the
+    // segment is drawn somewhere else, or with other characters on the line
+    //mFontBufferPreSelection.reset();
+    //mFontBufferSelection.reset();
+    //mFontBufferPostSelection.reset();
+    // </FS>
 }
 
 void LLNormalTextSegment::dump() const
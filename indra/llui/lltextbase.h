@@ -36,6 +36,7 @@
 #include "llkeywords.h"
 #include "llpanel.h"
 #include "llurlmatch.h"
+#include "lltextrunstamp.h" // <FS/> Glyph run reuse
 
 #include <string>
 #include <vector>
@@ -183,6 +184,7 @@ protected:
     LLFontVertexBuffer  mFontBufferSelection;
     LLFontVertexBuffer  mFontBufferPostSelection;
     S32                 mLastGeneration = -1;
+    LLTextRunStamp      mTextRunStamp; // <FS/> Text the glyph runs were built from
 };
 
 // This text segment is the same as LLNormalTextSegment, the only difference
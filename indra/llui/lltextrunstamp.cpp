@@ -0,0 +1,47 @@
+/**
+ * @file lltextrunstamp.cpp
+ * @brief Tells a text segment when its glyph runs must be rebuilt.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltextrunstamp.h"
+
+#include "hbxxh.h"
+
+bool LLTextRunStamp::update(const LLWString& text, S32 start, S32 end)
+{
+    // Segments may briefly lag behind a document that was cut short
+    const S32 text_size = (S32)text.size();
+    const S32 text_start = llclamp(start, 0, text_size);
+    const S32 text_end = llclamp(end, text_start, text_size);
+    const U64 text_hash = HBXXH64::digest(text.data() + text_start, (text_end - text_start) * sizeof(llwchar));
+    if (mValid && text_hash == mTextHash)
+    {
+        return false;
+    }
+    mTextHash = text_hash;
+    mValid = true;
+    return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file lltextrunstamp.h
+ * @brief Tells a text segment when its glyph runs must be rebuilt.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTRUNSTAMP_H
+#define LL_LLTEXTRUNSTAMP_H
+
+#include "llstring.h"
+
+/**
+ * Hash of the characters a segment built its glyph runs from. Any edit of
+ * a document, appending a chat line too, changes its generation: the
+ * segments whose own characters are unchanged keep their runs, and
+ * LLFontVertexBuffer rebuilds them itself when they are drawn elsewhere.
+ */
+class LLTextRunStamp
+{
+public:
+    /**
+     * Returns true when text [start, end) differs from what it was at the
+     * last call returning true, or on the first call.
+     */
+    bool update(const LLWString& text, S32 start, S32 end);
+
+    void reset() { mValid = false; }
+
+private:
+    U64     mTextHash{ 0 };
+    bool    mValid{ false };
+};
+
+#endif // LL_LLTEXTRUNSTAMP_H
@@ -186,7 +186,10 @@ bool LLUICtrlFactory::getLayeredXMLNode(const std::string &xui_filename, LLXMLNo
         paths.push_back(xui_filename);
     }
 
-    return LLXMLNode::getLayeredXMLNode(root, paths);
+    // <FS> Floaters and panels read the same files over and over
+    //return LLXMLNode::getLayeredXMLNode(root, paths);
+    return getInstance()->mXMLNodeCache.getLayeredXMLNode(root, paths);
+    // </FS>
 }
 
 
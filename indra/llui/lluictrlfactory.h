@@ -35,6 +35,7 @@
 #include "lldir.h"
 #include "llsingleton.h"
 #include "llheteromap.h"
+#include "llxmlnodecache.h" // <FS/>
 
 class LLView;
 void deleteView(LLView*); // Inside LLView.cpp, avoid having to potentially delete an incomplete type here.
@@ -273,6 +274,7 @@ private:
 
     class LLPanel*      mDummyPanel;
     std::vector<std::string>    mFileNames;
+    LLXMLNodeCache              mXMLNodeCache; // <FS/> see getLayeredXMLNode()
 
     // store ParamDefaults specializations
     // Each ParamDefaults specialization used to be an LLSingleton in its own
@@ -0,0 +1,90 @@
+/**
+ * @file lltextrunstamp_test.cpp
+ * @brief Unit tests for LLTextRunStamp
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lltextrunstamp.h"
+#include "lltut.h"
+
+namespace tut
+{
+    struct LLTextRunStampTest
+    {
+    };
+    typedef test_group<LLTextRunStampTest> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory tf("LLTextRunStamp");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("runs are kept while the segment text is unchanged");
+
+        LLTextRunStamp stamp;
+        LLWString text = utf8str_to_wstring("[12:00] Someone: hello\n");
+        ensure("first draw builds the runs", stamp.update(text, 8, 22));
+        ensure("same text", !stamp.update(text, 8, 22));
+
+        // Appending a chat line changes the document, not this segment
+        text += utf8str_to_wstring("[12:01] Someone: again\n");
+        ensure("line appended after the segment", !stamp.update(text, 8, 22));
+
+        // Edits outside of the segment are not its concern either
+        text[1] = '3';
+        ensure("edit before the segment", !stamp.update(text, 8, 22));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("runs are dropped when the segment text changes");
+
+        LLTextRunStamp stamp;
+        LLWString text = utf8str_to_wstring("hello world");
+        stamp.update(text, 0, 5);
+
+        text[4] = 'a';
+        ensure("character replaced", stamp.update(text, 0, 5));
+        ensure("once", !stamp.update(text, 0, 5));
+
+        ensure("segment grown", stamp.update(text, 0, 6));
+        ensure("same length, other characters", stamp.update(text, 6, 12));
+
+        text.resize(8);
+        ensure("document cut short", stamp.update(text, 6, 12));
+        ensure("cut short again", !stamp.update(text, 6, 12));
+
+        stamp.reset();
+        ensure("reset", stamp.update(text, 6, 12));
+    }
+}
@@ -47,6 +47,7 @@
 #include "llfile.h"
 #include "lltimer.h"
 #include "lldir.h"
+#include "lluuid.h"
 
 #if LL_RELEASE_WITH_DEBUG_INFO || LL_DEBUG
 #define CONTROL_ERRS LL_ERRS("ControlErrors")
@@ -423,7 +424,15 @@ LLPointer<LLControlVariable> LLControlGroup::getControl(std::string_view name)
     }
 
     ctrl_name_table_t::iterator iter = mNameTable.find(name);
-    return iter == mNameTable.end() ? LLPointer<LLControlVariable>() : iter->second;
+    if (iter != mNameTable.end())
+    {
+        return iter->second;
+    }
+    if (mSnapshots.empty())
+    {
+        return LLControlVariablePtr();
+    }
+    return loadFromSnapshots(name);
 }
 
 
@@ -444,6 +453,8 @@ const std::string LLControlGroup::mTypeString[TYPE_COUNT] = { "U32"
                                                              ,"LLSD"
                                                              };
 
+std::string LLControlGroup::sSnapshotDirectory;
+
 const std::string LLControlGroup::mSanityTypeString[SANITY_TYPE_COUNT] = { "None"
                                                                           ,"Equals"
                                                                           ,"NotEquals"
@@ -457,7 +468,8 @@ const std::string LLControlGroup::mSanityTypeString[SANITY_TYPE_COUNT] = { "None
 
 LLControlGroup::LLControlGroup(const std::string& name)
 :   LLInstanceTracker<LLControlGroup, std::string>(name),
-    mSettingsProfile(false)
+    mSettingsProfile(false),
+    mHandleValues(new std::atomic<U32>[MAX_HANDLES]())
 {
 
     if (NULL != getenv("LL_SETTINGS_PROFILE"))
@@ -531,6 +543,13 @@ void LLControlGroup::cleanup()
         }
     }
 
+    mSnapshots.clear();
+    for (boost::signals2::connection& connection : mHandleConnections)
+    {
+        connection.disconnect();
+    }
+    mHandleConnections.clear();
+    mHandleControls.clear();
     mNameTable.clear();
 }
 
@@ -588,6 +607,11 @@ LLControlVariable* LLControlGroup::declareControl(const std::string& name, eCont
     }
 
     // if not, create the control and add it to the name table
+    return addControl(name, type, initial_val, comment, sanity_type, sanity_value, sanity_comment, persist, can_backup, hidefromsettingseditor);
+}
+
+LLControlVariable* LLControlGroup::addControl(const std::string& name, eControlType type, const LLSD initial_val, const std::string& comment, eSanityType sanity_type, LLSD sanity_value, const std::string& sanity_comment, LLControlVariable::ePersist persist, bool can_backup, bool hidefromsettingseditor)
+{
     // <FS:Zi> Backup Settings
     // LLControlVariable* control = new LLControlVariable(name, type, initial_val, comment, sanity_type, sanity_value, sanity_comment, persist, hidefromsettingseditor);
     LLControlVariable* control = new LLControlVariable(name, type, initial_val, comment, sanity_type, sanity_value, sanity_comment, persist, can_backup, hidefromsettingseditor);
@@ -747,6 +771,7 @@ LLSD LLControlGroup::getLLSD(std::string_view name)
 LLSD LLControlGroup::asLLSD(bool diffs_only)
 {
     // Dump all stored values as LLSD
+    loadAllFromSnapshots();
     LLSD result = LLSD::emptyArray();
     for (ctrl_name_table_t::iterator iter = mNameTable.begin();
          iter != mNameTable.end(); iter++)
@@ -765,7 +790,18 @@ LLSD LLControlGroup::asLLSD(bool diffs_only)
 bool LLControlGroup::controlExists(std::string_view name)
 {
     ctrl_name_table_t::iterator iter = mNameTable.find(name);
-    return iter != mNameTable.end();
+    if (iter != mNameTable.end())
+    {
+        return true;
+    }
+    for (const LLPointer<LLControlSnapshot>& snapshot : mSnapshots)
+    {
+        if (snapshot->find(name) >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 
@@ -1057,6 +1093,12 @@ U32 LLControlGroup::loadFromFileLegacy(const std::string& filename, bool require
 
 U32 LLControlGroup::saveToFile(const std::string& filename, bool nondefault_only)
 {
+    // Controls still in a snapshot have their default value
+    if (!nondefault_only)
+    {
+        loadAllFromSnapshots();
+    }
+
     LLSD settings;
     int num_saved = 0;
     for (ctrl_name_table_t::iterator iter = mNameTable.begin();
@@ -1095,6 +1137,25 @@ U32 LLControlGroup::saveToFile(const std::string& filename, bool nondefault_only
 
 U32 LLControlGroup::loadFromFile(const std::string& filename, bool set_default_values, bool save_values)
 {
+    // The default settings files are large and never written by the viewer:
+    // map their snapshot and declare each control on first use instead.
+    std::string snapshot_filename;
+    if (set_default_values && !sSnapshotDirectory.empty())
+    {
+        LLUUID path_hash;
+        path_hash.generate(filename);
+        snapshot_filename = sSnapshotDirectory + gDirUtilp->getDirDelimiter()
+            + gDirUtilp->getBaseFileName(filename, true) + "_" + path_hash.asString().substr(0, 8) + ".llsnap";
+
+        LLPointer<LLControlSnapshot> snapshot = new LLControlSnapshot;
+        if (snapshot->open(snapshot_filename, filename))
+        {
+            addSnapshot(snapshot);
+            LL_DEBUGS("Settings") << "Loaded " << snapshot->size() << " settings from snapshot of " << filename << LL_ENDL;
+            return snapshot->size();
+        }
+    }
+
     LLSD settings;
     llifstream infile;
     infile.open(filename.c_str());
@@ -1110,131 +1171,201 @@ U32 LLControlGroup::loadFromFile(const std::string& filename, bool set_default_v
         LL_WARNS("Settings") << "Unable to parse LLSD control file " << filename << ". Trying Legacy Method." << LL_ENDL;
         return loadFromFileLegacy(filename, true, TYPE_STRING);
     }
+    infile.close();
+
+    if (!snapshot_filename.empty())
+    {
+        LLPointer<LLControlSnapshot> snapshot = new LLControlSnapshot;
+        if (LLControlSnapshot::write(snapshot_filename, filename, settings)
+            && snapshot->open(snapshot_filename, filename))
+        {
+            addSnapshot(snapshot);
+            LL_INFOS("Settings") << "Wrote settings snapshot " << snapshot_filename << LL_ENDL;
+            return snapshot->size();
+        }
+        LL_WARNS("Settings") << "Unable to write settings snapshot " << snapshot_filename << LL_ENDL;
+    }
 
     U32 validitems = 0;
+    for(LLSD::map_const_iterator itr = settings.beginMap(); itr != settings.endMap(); ++itr)
+    {
+        loadControl(itr->first, itr->second, getControl(itr->first), set_default_values, save_values, filename);
+        ++validitems;
+    }
+
+    LL_DEBUGS("Settings") << "Loaded " << validitems << " settings from " << filename << LL_ENDL;
+    return validitems;
+}
+
+LLControlVariable* LLControlGroup::loadControl(const std::string& name, const LLSD& control_map, LLControlVariable* existing_control,
+                                               bool set_default_values, bool save_values, const std::string& filename)
+{
+    LLControlVariable::ePersist persist = LLControlVariable::PERSIST_NONDFT;
+    bool can_backup = true;     // <FS:Zi> Backup Settings
     bool hidefromsettingseditor = false;
 
-    for(LLSD::map_const_iterator itr = settings.beginMap(); itr != settings.endMap(); ++itr)
+    if(control_map.has("Persist"))
     {
-        LLControlVariable::ePersist persist = LLControlVariable::PERSIST_NONDFT;
-        bool can_backup = true;     // <FS:Zi> Backup Settings
-        std::string const & name = itr->first;
-        LLSD const & control_map = itr->second;
+        persist = control_map["Persist"].asInteger()?
+                  LLControlVariable::PERSIST_NONDFT : LLControlVariable::PERSIST_NO;
+    }
+
+    // <FS:Zi> Backup Settings
+    if(control_map.has("Backup"))
+    {
+        can_backup = control_map["Backup"].asInteger();
+    }
+    // </FS:Zi>
 
-        if(control_map.has("Persist"))
+    // Sometimes we want to use the settings system to provide cheap persistence, but we
+    // don't want the settings themselves to be easily manipulated in the UI because
+    // doing so can cause support problems. So we have this option:
+    if(control_map.has("HideFromEditor"))
+    {
+        hidefromsettingseditor = control_map["HideFromEditor"].asInteger();
+    }
+
+    // If the control exists just set the value from the input file.
+    if(existing_control)
+    {
+        // set_default_values is true when we're loading the initial,
+        // immutable files from app_settings, e.g. settings.xml.
+        if(set_default_values)
         {
-            persist = control_map["Persist"].asInteger()?
-                      LLControlVariable::PERSIST_NONDFT : LLControlVariable::PERSIST_NO;
+            // Override all previously set properties of this control.
+            // ... except for type. The types must match.
+            eControlType new_type = typeStringToEnum(control_map["Type"].asString());
+            if(existing_control->isType(new_type))
+            {
+                existing_control->setDefaultValue(control_map["Value"]);
+                existing_control->setPersist(persist);
+                existing_control->setHiddenFromSettingsEditor(hidefromsettingseditor);
+                existing_control->setComment(control_map["Comment"].asString());
+                existing_control->setBackupable(can_backup);        // <FS:Zi> Backup Settings
+            }
+            else
+            {
+                LL_ERRS() << "Mismatched type of control variable '"
+                       << name << "' found while loading '"
+                       << filename << "'." << LL_ENDL;
+            }
         }
-
-        // <FS:Zi> Backup Settings
-        if(control_map.has("Backup"))
+        else if(existing_control->isPersisted())
         {
-            can_backup = control_map["Backup"].asInteger();
+            // save_values is specifically false for (e.g.)
+            // SessionSettingsFile and UserSessionSettingsFile -- in other
+            // words, for a file that's supposed to be transient.
+            existing_control->setValue(control_map["Value"], save_values);
         }
-        // </FS:Zi>
+        // *NOTE: If not persisted and not setting defaults,
+        // the value should not get loaded.
+        return existing_control;
+    }
 
-        // Sometimes we want to use the settings system to provide cheap persistence, but we
-        // don't want the settings themselves to be easily manipulated in the UI because
-        // doing so can cause support problems. So we have this option:
-        if(control_map.has("HideFromEditor"))
+    // We've never seen this control before. Either we're loading up
+    // the initial set of default settings files (set_default_values)
+    // -- or we're loading user settings last saved by a viewer that
+    // supports a superset of the variables we know.
+    // CHOP-962: if we're loading an unrecognized user setting, make
+    // sure we save it later. If you try an experimental viewer, tweak
+    // a new setting, briefly revert to an old viewer, then return to
+    // the new one, we don't want the old viewer to discard the
+    // setting you changed.
+    if (! set_default_values)
+    {
+        // Using PERSIST_ALWAYS insists that saveToFile() (which calls
+        // LLControlVariable::shouldSave()) must save this control
+        // variable regardless of its value. We can safely set this
+        // LLControlVariable persistent because the 'persistent' flag
+        // is not itself persisted!
+        persist = LLControlVariable::PERSIST_ALWAYS;
+        // We want to mention unrecognized user settings variables
+        // (e.g. from a newer version of the viewer) in the log. But
+        // we also arrive here for Boolean variables generated by
+        // the notifications subsystem when the user checks "Don't
+        // show me this again." These aren't declared in settings.xml;
+        // they're actually named for the notification they suppress.
+        // We don't want to mention those. Apologies, this is a bit of
+        // a hack: we happen to know that user settings go into an
+        // LLControlGroup whose name is "Global".
+        if (getKey() == "Global")
         {
-            hidefromsettingseditor = control_map["HideFromEditor"].asInteger();
+            LL_INFOS("LLControlGroup") << "preserving unrecognized " << getKey()
+                                       << " settings variable " << name << LL_ENDL;
         }
-        else
+    }
+
+    // Not declareControl(): its getControl() would look the snapshots up again
+    return addControl(name,
+                      typeStringToEnum(control_map["Type"].asString()),
+                      control_map["Value"],
+                      control_map["Comment"].asString(),
+                      sanityTypeStringToEnum(control_map["SanityCheckType"].asString()),
+                      control_map["SanityValue"],
+                      control_map["SanityComment"].asString(),
+                      persist,
+                      can_backup,      // <FS:Zi> Backup Settings
+                      hidefromsettingseditor
+                      );
+}
+
+void LLControlGroup::addSnapshot(LLControlSnapshot* snapshot)
+{
+    // Like loading the file, override what earlier files declared
+    for (ctrl_name_table_t::iterator iter = mNameTable.begin();
+         iter != mNameTable.end(); ++iter)
+    {
+        S32 index = snapshot->find(iter->first);
+        if (index >= 0)
         {
-            hidefromsettingseditor = false;
+            loadControl(iter->first, snapshot->getControlMap(index), iter->second, true, true, snapshot->getSourceFilename());
         }
+    }
+    mSnapshots.push_back(snapshot);
+}
 
-        // If the control exists just set the value from the input file.
-        LLControlVariable* existing_control = getControl(name);
-        if(existing_control)
+LLControlVariable* LLControlGroup::loadFromSnapshots(std::string_view name)
+{
+    LLControlVariable* control = NULL;
+    std::string control_name;
+    for (const LLPointer<LLControlSnapshot>& snapshot : mSnapshots)
+    {
+        S32 index = snapshot->find(name);
+        if (index >= 0)
         {
-            // set_default_values is true when we're loading the initial,
-            // immutable files from app_settings, e.g. settings.xml.
-            if(set_default_values)
-            {
-                // Override all previously set properties of this control.
-                // ... except for type. The types must match.
-                eControlType new_type = typeStringToEnum(control_map["Type"].asString());
-                if(existing_control->isType(new_type))
-                {
-                    existing_control->setDefaultValue(control_map["Value"]);
-                    existing_control->setPersist(persist);
-                    existing_control->setHiddenFromSettingsEditor(hidefromsettingseditor);
-                    existing_control->setComment(control_map["Comment"].asString());
-                    existing_control->setBackupable(can_backup);        // <FS:Zi> Backup Settings
-                }
-                else
-                {
-                    LL_ERRS() << "Mismatched type of control variable '"
-                           << name << "' found while loading '"
-                           << filename << "'." << LL_ENDL;
-                }
-            }
-            else if(existing_control->isPersisted())
-            {
-                // save_values is specifically false for (e.g.)
-                // SessionSettingsFile and UserSessionSettingsFile -- in other
-                // words, for a file that's supposed to be transient.
-                existing_control->setValue(control_map["Value"], save_values);
-            }
-            // *NOTE: If not persisted and not setting defaults,
-            // the value should not get loaded.
+            control_name.assign(name);
+            control = loadControl(control_name, snapshot->getControlMap(index), control, true, true, snapshot->getSourceFilename());
         }
-        else
+    }
+    return control;
+}
+
+void LLControlGroup::loadAllFromSnapshots()
+{
+    if (mSnapshots.empty())
+    {
+        return;
+    }
+
+    LL_PROFILE_ZONE_SCOPED;
+    for (const LLPointer<LLControlSnapshot>& snapshot : mSnapshots)
+    {
+        for (S32 i = 0; i < snapshot->size(); ++i)
         {
-            // We've never seen this control before. Either we're loading up
-            // the initial set of default settings files (set_default_values)
-            // -- or we're loading user settings last saved by a viewer that
-            // supports a superset of the variables we know.
-            // CHOP-962: if we're loading an unrecognized user setting, make
-            // sure we save it later. If you try an experimental viewer, tweak
-            // a new setting, briefly revert to an old viewer, then return to
-            // the new one, we don't want the old viewer to discard the
-            // setting you changed.
-            if (! set_default_values)
+            std::string_view name = snapshot->getName(i);
+            if (mNameTable.find(name) == mNameTable.end())
             {
-                // Using PERSIST_ALWAYS insists that saveToFile() (which calls
-                // LLControlVariable::shouldSave()) must save this control
-                // variable regardless of its value. We can safely set this
-                // LLControlVariable persistent because the 'persistent' flag
-                // is not itself persisted!
-                persist = LLControlVariable::PERSIST_ALWAYS;
-                // We want to mention unrecognized user settings variables
-                // (e.g. from a newer version of the viewer) in the log. But
-                // we also arrive here for Boolean variables generated by
-                // the notifications subsystem when the user checks "Don't
-                // show me this again." These aren't declared in settings.xml;
-                // they're actually named for the notification they suppress.
-                // We don't want to mention those. Apologies, this is a bit of
-                // a hack: we happen to know that user settings go into an
-                // LLControlGroup whose name is "Global".
-                if (getKey() == "Global")
-                {
-                    LL_INFOS("LLControlGroup") << "preserving unrecognized " << getKey()
-                                               << " settings variable " << name << LL_ENDL;
-                }
+                loadFromSnapshots(name);
             }
-
-            declareControl(name,
-                           typeStringToEnum(control_map["Type"].asString()),
-                           control_map["Value"],
-                           control_map["Comment"].asString(),
-                           sanityTypeStringToEnum(control_map["SanityCheckType"].asString()),
-                           control_map["SanityValue"],
-                           control_map["SanityComment"].asString(),
-                           persist,
-                           can_backup,      // <FS:Zi> Backup Settings
-                           hidefromsettingseditor
-                           );
         }
-
-        ++validitems;
     }
+    mSnapshots.clear();
+}
 
-    LL_DEBUGS("Settings") << "Loaded " << validitems << " settings from " << filename << LL_ENDL;
-    return validitems;
+// static
+void LLControlGroup::setSnapshotDirectory(const std::string& dir)
+{
+    sSnapshotDirectory = dir;
 }
 
 void LLControlGroup::resetToDefaults()
@@ -1247,10 +1378,76 @@ void LLControlGroup::resetToDefaults()
         LLControlVariable* control = (*control_iter).second;
         control->resetToDefault();
     }
+
+    // resetToDefault() doesn't signal, refresh the handles by hand
+    std::lock_guard<std::mutex> lock(mHandleMutex);
+    for (S32 i = 0; i < (S32)mHandleControls.size(); ++i)
+    {
+        updateHandle(i, mHandleControls[i]->type(), mHandleControls[i]->getValue());
+    }
+}
+
+S32 LLControlGroup::getHandleIndex(std::string_view name, eControlType type)
+{
+    LLControlVariablePtr control = getControl(name);
+    if (!control || !control->isType(type))
+    {
+        LL_ERRS("Settings") << "No " << typeEnumToString(type) << " control named " << name
+                            << " in " << getKey() << " for LLControlHandle" << LL_ENDL;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(mHandleMutex);
+    if (control->mHandleIndex < 0)
+    {
+        if ((S32)mHandleControls.size() >= MAX_HANDLES)
+        {
+            LL_ERRS("Settings") << "Out of LLControlHandle slots in " << getKey() << LL_ENDL;
+            return -1;
+        }
+
+        const S32 index = (S32)mHandleControls.size();
+        updateHandle(index, type, control->getValue());
+        mHandleControls.push_back(control);
+        // One listener per control, however many handles share it
+        mHandleConnections.push_back(control->getSignal()->connect(0,
+            [this, index, type](LLControlVariable*, const LLSD& new_value, const LLSD&)
+            {
+                updateHandle(index, type, new_value);
+            }));
+        control->mHandleIndex = index;
+    }
+    return control->mHandleIndex;
+}
+
+void LLControlGroup::updateHandle(S32 index, eControlType type, const LLSD& value)
+{
+    U32 bits = 0;
+    switch (type)
+    {
+    case TYPE_BOOLEAN:
+        bits = value.asBoolean() ? 1 : 0;
+        break;
+    case TYPE_S32:
+    case TYPE_U32:
+        bits = (U32)value.asInteger();
+        break;
+    case TYPE_F32:
+        {
+            F32 real = (F32)value.asReal();
+            memcpy(&bits, &real, sizeof(bits));
+        }
+        break;
+    default:
+        LL_ERRS("Settings") << "LLControlHandle of unsupported type " << typeEnumToString(type) << LL_ENDL;
+        break;
+    }
+    mHandleValues[index].store(bits, std::memory_order_relaxed);
 }
 
 void LLControlGroup::applyToAll(ApplyFunctor* func)
 {
+    loadAllFromSnapshots();
     for (ctrl_name_table_t::iterator iter = mNameTable.begin();
          iter != mNameTable.end(); iter++)
     {
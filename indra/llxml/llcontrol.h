@@ -28,13 +28,18 @@
 #define LL_LLCONTROL_H
 
 #include "llboost.h"
+#include "llcontrolsnapshot.h"
 #include "llstring.h"
 #include "llpointer.h"
 #include "llrect.h"
 #include "llrefcount.h"
 #include "llinstancetracker.h"
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 
 #include <boost/signals2.hpp>
@@ -111,6 +116,9 @@ private:
     validate_signal_t mValidateSignal;
     sanity_signal_t mSanitySignal;
 
+    // Slot of this control in its group's handle table, -1 if it has none
+    S32             mHandleIndex{ -1 };
+
 public:
     LLControlVariable(const std::string& name, eControlType type,
         LLSD initial, const std::string& comment,
@@ -204,6 +212,9 @@ class LLControlGroup : public LLInstanceTracker<LLControlGroup, std::string>
 protected:
     typedef std::map<std::string, LLControlVariablePtr, std::less<> > ctrl_name_table_t;
     ctrl_name_table_t mNameTable;
+    // Default settings files not yet declared into mNameTable, in load order
+    std::vector<LLPointer<LLControlSnapshot> > mSnapshots;
+    static std::string sSnapshotDirectory;
     static const std::string mTypeString[TYPE_COUNT];
     static const std::string mSanityTypeString[SANITY_TYPE_COUNT];
 
@@ -326,7 +337,37 @@ public:
     void    resetToDefaults();
     void    incrCount(std::string_view name);
 
+    // Where loadFromFile() keeps binary snapshots of the default settings
+    // files, empty to always parse the XML.
+    static void setSnapshotDirectory(const std::string& dir);
+    // Declares every control the snapshots still hold. Lookups declare
+    // them lazily without a lock, so call this before other threads can
+    // look controls up.
+    void    loadAllFromSnapshots();
+
+    // Dense slot of a Boolean, S32, U32 or F32 control for LLControlHandle,
+    // assigned on first request. Errors out when name isn't a control of type.
+    S32     getHandleIndex(std::string_view name, eControlType type);
+    // Raw 32 bits of the value in a slot, safe to read from any thread
+    U32     getHandleBits(S32 index) const { return mHandleValues[index].load(std::memory_order_relaxed); }
+
     bool    mSettingsProfile;
+
+private:
+    void updateHandle(S32 index, eControlType type, const LLSD& value);
+
+    static const S32 MAX_HANDLES = 4096;
+    // Fixed size, so that readers never see it move
+    std::unique_ptr<std::atomic<U32>[]> mHandleValues;
+    std::vector<LLControlVariablePtr> mHandleControls;
+    std::vector<boost::signals2::connection> mHandleConnections;
+    std::mutex mHandleMutex;
+
+    LLControlVariable* addControl(const std::string& name, eControlType type, const LLSD initial_val, const std::string& comment, eSanityType sanity_type, LLSD sanity_value, const std::string& sanity_comment, LLControlVariable::ePersist persist, bool can_backup, bool hidefromsettingseditor);
+    LLControlVariable* loadControl(const std::string& name, const LLSD& control_map, LLControlVariable* existing_control, bool set_default_values, bool save_values, const std::string& filename);
+    void addSnapshot(LLControlSnapshot* snapshot);
+    // Declares name from the snapshots holding it, NULL if none does
+    LLControlVariable* loadFromSnapshots(std::string_view name);
 };
 
 
@@ -454,6 +495,69 @@ private:
     LLPointer<LLControlCache<T> > mCachedControlPtr;
 };
 
+//! Typed, interned reference to a Boolean, S32, U32 or F32 control.
+
+//! The name is resolved once, on first read, to a dense slot of the group
+//! that the control keeps current as it changes. Reads after that are a
+//! single indexed load with no string hashing, map probe, LLSD copy or lock,
+//! so handles suit per-frame and per-object code, and threads other than
+//! the main one once resolved. Resolve on the main thread: the name lookup
+//! walks the control table. The name must outlive the handle, e.g. a
+//! literal:
+//!
+//!     static LLControlHandle<bool> show_hud(gSavedSettings, "ShowHUD");
+//!     if (show_hud) ...
+template <typename T>
+class LLControlHandle
+{
+    static_assert(std::is_same_v<T, bool> || std::is_same_v<T, S32> || std::is_same_v<T, U32> || std::is_same_v<T, F32>,
+                  "LLControlHandle only holds 32 bit scalar controls, use LLCachedControl");
+
+public:
+    LLControlHandle(LLControlGroup& group, const char* name)
+    :   mGroup(group),
+        mName(name)
+    {
+    }
+
+    T get() const
+    {
+        S32 index = mIndex.load(std::memory_order_acquire);
+        if (index < 0)
+        {
+            index = mGroup.getHandleIndex(mName, get_control_type<T>());
+            mIndex.store(index, std::memory_order_release);
+        }
+        return fromBits(mGroup.getHandleBits(index));
+    }
+
+    operator T() const { return get(); }
+    T operator()() const { return get(); }
+
+private:
+    static T fromBits(U32 bits)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            return bits != 0;
+        }
+        else if constexpr (std::is_same_v<T, F32>)
+        {
+            F32 value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        else
+        {
+            return (T)bits;
+        }
+    }
+
+    LLControlGroup&             mGroup;
+    const char*                 mName;
+    mutable std::atomic<S32>    mIndex{ -1 };
+};
+
 template <> eControlType get_control_type<U32>();
 template <> eControlType get_control_type<S32>();
 template <> eControlType get_control_type<F32>();
@@ -0,0 +1,225 @@
+/**
+ * @file llcontrolsnapshot.cpp
+ * @brief Binary snapshot of a settings file, for LLControlGroup
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llcontrolsnapshot.h"
+
+#include "llfile.h"
+#include "llmemorystream.h"
+#include "llsdserialize.h"
+
+#include <sstream>
+#include <vector>
+
+// Bump when the layout, or what LLControlGroup expects of the control
+// maps, changes
+static const char SNAPSHOT_MAGIC[4] = { 'L', 'L', 'C', 'S' };
+static const U32 SNAPSHOT_VERSION = 1;
+
+// The file holds a Header, the Entry of each control sorted by name, then
+// the names, the binary LLSD control maps and the source filename. Offsets
+// are from the start of the file.
+struct LLControlSnapshot::Header
+{
+    char    mMagic[4];
+    U32     mVersion;
+    U64     mSourceSize;
+    S64     mSourceTime;
+    U32     mSourceName;
+    U32     mSourceNameSize;
+    U32     mCount;
+    U32     mPad;
+};
+
+struct LLControlSnapshot::Entry
+{
+    U32     mName;
+    U32     mNameSize;
+    U32     mData;
+    U32     mDataSize;
+};
+
+bool LLControlSnapshot::open(const std::string& filename, const std::string& source_filename)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    mFile.close();
+    mCount = 0;
+
+    llstat source_stat;
+    if (LLFile::stat(source_filename, &source_stat) || !mFile.open(filename))
+    {
+        return false;
+    }
+
+    const U8* data = mFile.data();
+    const size_t file_size = mFile.size();
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (file_size < sizeof(Header)
+        || memcmp(header->mMagic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))
+        || header->mVersion != SNAPSHOT_VERSION
+        || header->mSourceSize != (U64)source_stat.st_size
+        || header->mSourceTime != (S64)source_stat.st_mtime
+        || (U64)header->mSourceName + header->mSourceNameSize > file_size
+        || source_filename != std::string_view((const char*)data + header->mSourceName, header->mSourceNameSize)
+        || sizeof(Header) + (U64)header->mCount * sizeof(Entry) > file_size)
+    {
+        mFile.close();
+        return false;
+    }
+
+    const Entry* entries = reinterpret_cast<const Entry*>(data + sizeof(Header));
+    for (U32 i = 0; i < header->mCount; ++i)
+    {
+        if ((U64)entries[i].mName + entries[i].mNameSize > file_size
+            || (U64)entries[i].mData + entries[i].mDataSize > file_size)
+        {
+            LL_WARNS("Settings") << "Corrupt settings snapshot " << filename << LL_ENDL;
+            mFile.close();
+            return false;
+        }
+    }
+
+    mSourceFilename = source_filename;
+    mCount = (S32)header->mCount;
+    return true;
+}
+
+// static
+bool LLControlSnapshot::write(const std::string& filename, const std::string& source_filename, const LLSD& settings)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    llstat source_stat;
+    if (LLFile::stat(source_filename, &source_stat))
+    {
+        return false;
+    }
+
+    Header header;
+    memcpy(header.mMagic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.mVersion = SNAPSHOT_VERSION;
+    header.mSourceSize = (U64)source_stat.st_size;
+    header.mSourceTime = (S64)source_stat.st_mtime;
+    header.mCount = (U32)settings.size();
+    header.mPad = 0;
+
+    // LLSD maps iterate in name order already
+    std::vector<Entry> entries;
+    entries.reserve(settings.size());
+    std::string blobs;
+    const size_t blobs_offset = sizeof(Header) + settings.size() * sizeof(Entry);
+    for (LLSD::map_const_iterator itr = settings.beginMap(); itr != settings.endMap(); ++itr)
+    {
+        std::ostringstream control_map;
+        LLSDSerialize::toBinary(itr->second, control_map);
+        const std::string data = control_map.str();
+
+        Entry entry;
+        entry.mName = (U32)(blobs_offset + blobs.size());
+        entry.mNameSize = (U32)itr->first.size();
+        blobs.append(itr->first);
+        entry.mData = (U32)(blobs_offset + blobs.size());
+        entry.mDataSize = (U32)data.size();
+        blobs.append(data);
+        entries.push_back(entry);
+    }
+    header.mSourceName = (U32)(blobs_offset + blobs.size());
+    header.mSourceNameSize = (U32)source_filename.size();
+    blobs.append(source_filename);
+
+    // Write next to it and rename, another instance may have it mapped
+    const std::string temp_filename = filename + ".tmp";
+    {
+        llofstream file(temp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+        if (!entries.empty())
+        {
+            file.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+        }
+        file.write(blobs.data(), blobs.size());
+        if (!file.good())
+        {
+            file.close();
+            LLFile::remove(temp_filename);
+            return false;
+        }
+    }
+
+    if (LLFile::rename(temp_filename, filename))
+    {
+        LLFile::remove(temp_filename);
+        return false;
+    }
+    return true;
+}
+
+const LLControlSnapshot::Entry* LLControlSnapshot::getEntry(S32 index) const
+{
+    return reinterpret_cast<const Entry*>(mFile.data() + sizeof(Header)) + index;
+}
+
+S32 LLControlSnapshot::find(std::string_view name) const
+{
+    S32 low = 0;
+    S32 high = mCount;
+    while (low < high)
+    {
+        const S32 mid = (low + high) / 2;
+        const int order = getName(mid).compare(name);
+        if (order == 0)
+        {
+            return mid;
+        }
+        if (order < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return -1;
+}
+
+std::string_view LLControlSnapshot::getName(S32 index) const
+{
+    const Entry* entry = getEntry(index);
+    return std::string_view((const char*)mFile.data() + entry->mName, entry->mNameSize);
+}
+
+LLSD LLControlSnapshot::getControlMap(S32 index) const
+{
+    const Entry* entry = getEntry(index);
+    LLMemoryStream stream(mFile.data() + entry->mData, (S32)entry->mDataSize);
+    LLSD control_map;
+    LLSDSerialize::fromBinary(control_map, stream, entry->mDataSize);
+    return control_map;
+}
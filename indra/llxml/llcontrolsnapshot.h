@@ -0,0 +1,75 @@
+/**
+ * @file llcontrolsnapshot.h
+ * @brief Binary snapshot of a settings file, for LLControlGroup
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLCONTROLSNAPSHOT_H
+#define LL_LLCONTROLSNAPSHOT_H
+
+#include "llmappedfile.h"
+#include "llrefcount.h"
+#include "llsd.h"
+
+#include <string>
+#include <string_view>
+
+//
+// A settings file as LLControlGroup::loadFromFile() parses it: the map of
+// each control, in binary LLSD, indexed by control name. Snapshots are
+// memory mapped, so that controls can be looked up one by one without
+// parsing the whole file. The XML stays the source of truth: a snapshot
+// records the size and modification time of the file it was built from,
+// and open() refuses it once the file changed.
+//
+class LLControlSnapshot : public LLRefCount
+{
+public:
+    // Maps filename when it is a snapshot of source_filename as the
+    // source is now.
+    bool open(const std::string& filename, const std::string& source_filename);
+
+    // Writes the snapshot of settings, parsed from source_filename
+    static bool write(const std::string& filename, const std::string& source_filename, const LLSD& settings);
+
+    const std::string& getSourceFilename() const { return mSourceFilename; }
+
+    // index of name, -1 when the snapshot doesn't have it
+    S32 find(std::string_view name) const;
+    S32 size() const { return mCount; }
+    std::string_view getName(S32 index) const;
+    // The map of the control, as in the settings file
+    LLSD getControlMap(S32 index) const;
+
+private:
+    struct Header;
+    struct Entry;
+
+    const Entry* getEntry(S32 index) const;
+
+    LLMappedFile    mFile;
+    std::string     mSourceFilename;
+    S32             mCount{ 0 };
+};
+
+#endif // LL_LLCONTROLSNAPSHOT_H
@@ -161,6 +161,34 @@ LLXMLNodePtr LLXMLNode::deepCopy()
     return newnode;
 }
 
+// <FS> Copies parent first, so that addChild() has no subtree to update
+static void copy_children(LLXMLNode* from, LLXMLNodePtr& to)
+{
+    for (LLXMLAttribList::iterator iter = from->mAttributes.begin();
+         iter != from->mAttributes.end(); ++iter)
+    {
+        LLXMLNodePtr attribute = new LLXMLNode(*iter->second);
+        attribute->mLineNumber = iter->second->mLineNumber;
+        to->addChild(attribute);
+    }
+    for (LLXMLNodePtr child = from->getFirstChild(); child.notNull(); child = child->getNextSibling())
+    {
+        LLXMLNodePtr child_copy = new LLXMLNode(*child);
+        child_copy->mLineNumber = child->mLineNumber;
+        to->addChild(child_copy);
+        copy_children(child, child_copy);
+    }
+}
+
+LLXMLNodePtr LLXMLNode::copyTree()
+{
+    LLXMLNodePtr newnode = new LLXMLNode(*this);
+    newnode->mLineNumber = mLineNumber;
+    copy_children(this, newnode);
+    return newnode;
+}
+// </FS>
+
 // virtual
 LLXMLNode::~LLXMLNode()
 {
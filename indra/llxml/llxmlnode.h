@@ -123,6 +123,10 @@ public:
     LLXMLNode(LLStringTableEntry* name, bool is_attribute);
     LLXMLNode(const LLXMLNode& rhs);
     LLXMLNodePtr deepCopy();
+    // <FS> deepCopy() in document order, with the line numbers, as
+    // parseFile() would have built the tree
+    LLXMLNodePtr copyTree();
+    // </FS>
 
     bool isNull();
 
@@ -0,0 +1,87 @@
+/**
+ * @file llxmlnodecache.cpp
+ * @brief Layered XUI trees kept from one read to the next
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llxmlnodecache.h"
+
+#include "llfile.h"
+
+bool LLXMLNodeCache::getLayeredXMLNode(LLXMLNodePtr& root, const std::vector<std::string>& paths)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    std::string key;
+    std::vector<FileStat> stats;
+    stats.reserve(paths.size());
+    bool cacheable = !paths.empty();
+    for (const std::string& path : paths)
+    {
+        key += path;
+        key += '\n';
+
+        // getLayeredXMLNode() skips the empty layers
+        FileStat file_stat;
+        llstat path_stat;
+        if (!path.empty())
+        {
+            if (LLFile::stat(path, &path_stat))
+            {
+                cacheable = false;
+                break;
+            }
+            file_stat.mSize = (U64)path_stat.st_size;
+            file_stat.mTime = (S64)path_stat.st_mtime;
+        }
+        stats.push_back(file_stat);
+    }
+
+    if (!cacheable)
+    {
+        // let it fail and warn as it would have
+        return LLXMLNode::getLayeredXMLNode(root, paths);
+    }
+
+    entries_t::iterator found = mEntries.find(key);
+    if (found != mEntries.end() && found->second.mStats == stats)
+    {
+        root = found->second.mRoot->copyTree();
+        return true;
+    }
+
+    if (!LLXMLNode::getLayeredXMLNode(root, paths))
+    {
+        if (found != mEntries.end())
+        {
+            mEntries.erase(found);
+        }
+        return false;
+    }
+
+    Entry& entry = mEntries[key];
+    entry.mStats.swap(stats);
+    entry.mRoot = root->copyTree();
+    return true;
+}
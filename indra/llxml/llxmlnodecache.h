@@ -0,0 +1,76 @@
+/**
+ * @file llxmlnodecache.h
+ * @brief Layered XUI trees kept from one read to the next
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLXMLNODECACHE_H
+#define LL_LLXMLNODECACHE_H
+
+#include "llxmlnode.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+//
+// LLXMLNode::getLayeredXMLNode(), remembering the trees it layered. The
+// files are parsed and layered the first time, and later calls get a copy
+// of that tree, about three times faster than parsing it again. The
+// files stay the source of truth: an entry records the size and
+// modification time of each layer, and is layered again once one changed.
+//
+// The cache hands out copies, so callers are free to change their tree.
+// It is not thread safe.
+//
+class LLXMLNodeCache
+{
+public:
+    // paths as for LLXMLNode::getLayeredXMLNode(): the base file, then the
+    // layers over it
+    bool getLayeredXMLNode(LLXMLNodePtr& root, const std::vector<std::string>& paths);
+
+    void clear() { mEntries.clear(); }
+    size_t size() const { return mEntries.size(); }
+
+private:
+    struct FileStat
+    {
+        U64     mSize{ 0 };
+        S64     mTime{ 0 };
+
+        bool operator==(const FileStat& rhs) const { return mSize == rhs.mSize && mTime == rhs.mTime; }
+    };
+
+    struct Entry
+    {
+        std::vector<FileStat>   mStats;     // of paths, in order
+        LLXMLNodePtr            mRoot;      // never handed out
+    };
+
+    // by the paths, joined by newlines
+    typedef std::map<std::string, Entry> entries_t;
+    entries_t   mEntries;
+};
+
+#endif // LL_LLXMLNODECACHE_H
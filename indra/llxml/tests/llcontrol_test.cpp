@@ -32,7 +32,12 @@
 
 #include "../llcontrol.h"
 
+#include "lldir.h"
+
 #include "../test/lltut.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
 #include <memory>
 #include <vector>
 
@@ -63,6 +68,8 @@ namespace tut
         }
         ~control_group()
         {
+            LLControlGroup::setSnapshotDirectory(std::string());
+            gDirUtilp->deleteFilesInDir(mTestConfigDir, "*.llsnap");
             //Remove test files
             for (auto filename : mCleanups)
             {
@@ -73,7 +80,11 @@ namespace tut
         }
         void writeSettingsFile(const LLSD& config)
         {
-            llofstream file(mTestConfigFile.c_str());
+            writeSettingsFile(mTestConfigFile, config);
+        }
+        void writeSettingsFile(const std::string& filename, const LLSD& config)
+        {
+            llofstream file(filename.c_str());
             if (file.is_open())
             {
                 LLSDSerialize::toPrettyXML(config, file);
@@ -151,4 +162,263 @@ namespace tut
         ensure("listener fired on changed setting", mListenerFired);
     }
 
+    //snapshots of default settings files
+    template<> template<>
+    void control_group_t::test<5>()
+    {
+        set_test_name("settings snapshot matches the XML");
+        LLSD config;
+        config["TestSetting"]["Comment"] = "Dummy setting used for testing";
+        config["TestSetting"]["Persist"] = 1;
+        config["TestSetting"]["Type"] = "U32";
+        config["TestSetting"]["Value"] = 12;
+        config["TestString"]["Comment"] = "Another dummy setting";
+        config["TestString"]["Persist"] = 0;
+        config["TestString"]["HideFromEditor"] = 1;
+        config["TestString"]["Type"] = "String";
+        config["TestString"]["Value"] = "twelve";
+        writeSettingsFile(config);
+
+        LLControlGroup::setSnapshotDirectory(mTestConfigDir);
+        // the first load writes the snapshot, the second maps it
+        for (S32 pass = 0; pass < 2; ++pass)
+        {
+            LLControlGroup test_cg(STRINGIZE("snapshot" << pass));
+            ensure_equals("number of settings", test_cg.loadFromFile(mTestConfigFile, true), 2);
+            ensure("setting exists", test_cg.controlExists("TestString"));
+            ensure("unknown setting", !test_cg.controlExists("NoSuchSetting"));
+            ensure("unknown control", test_cg.getControl("NoSuchSetting").isNull());
+            ensure_equals("value of setting", test_cg.getU32("TestSetting"), 12);
+            LLControlVariable* control = test_cg.getControl("TestString");
+            ensure("string control", control && control->isType(TYPE_STRING));
+            ensure_equals("string value", control->getValue().asString(), "twelve");
+            ensure_equals("comment", control->getComment(), "Another dummy setting");
+            ensure("persist", !control->isPersisted());
+            ensure("hidden", control->isHiddenFromSettingsEditor());
+        }
+    }
+
+    template<> template<>
+    void control_group_t::test<6>()
+    {
+        set_test_name("settings snapshot declares controls on first use");
+        LLControlGroup::setSnapshotDirectory(mTestConfigDir);
+        {
+            LLControlGroup test_cg("writer");
+            test_cg.loadFromFile(mTestConfigFile, true);
+        }
+
+        struct Counter : public LLControlGroup::ApplyFunctor
+        {
+            S32 mCount{ 0 };
+            void apply(const std::string& name, LLControlVariable* control) override { ++mCount; }
+        };
+
+        ensure_equals("number of settings", mCG->loadFromFile(mTestConfigFile, true), 1);
+        // a user settings file applies to the control like before
+        LLSD user;
+        user["TestSetting"]["Type"] = "U32";
+        user["TestSetting"]["Value"] = 13;
+        std::string user_file = mTestConfigDir + "user_settings.xml";
+        mCleanups.push_back(user_file);
+        writeSettingsFile(user_file, user);
+        ensure_equals("user settings", mCG->loadFromFile(user_file), 1);
+        ensure_equals("user value", mCG->getU32("TestSetting"), 13);
+        ensure("non default", !mCG->getControl("TestSetting")->isDefault());
+
+        Counter counter;
+        mCG->applyToAll(&counter);
+        ensure_equals("applyToAll sees every control", counter.mCount, 1);
+    }
+
+    template<> template<>
+    void control_group_t::test<7>()
+    {
+        set_test_name("later settings snapshot overrides defaults");
+        LLSD overrides;
+        overrides["TestSetting"]["Comment"] = "Overridden";
+        overrides["TestSetting"]["Persist"] = 1;
+        overrides["TestSetting"]["Type"] = "U32";
+        overrides["TestSetting"]["Value"] = 42;
+        std::string overrides_file = mTestConfigDir + "settings_overrides.xml";
+        mCleanups.push_back(overrides_file);
+        writeSettingsFile(overrides_file, overrides);
+
+        LLControlGroup::setSnapshotDirectory(mTestConfigDir);
+        for (S32 pass = 0; pass < 2; ++pass)
+        {
+            LLControlGroup lazy_cg(STRINGIZE("lazy" << pass));
+            lazy_cg.loadFromFile(mTestConfigFile, true);
+            lazy_cg.loadFromFile(overrides_file, true);
+            ensure_equals("overridden value", lazy_cg.getU32("TestSetting"), 42);
+            ensure_equals("overridden comment", lazy_cg.getControl("TestSetting")->getComment(), "Overridden");
+
+            // declared before the override is attached
+            LLControlGroup eager_cg(STRINGIZE("eager" << pass));
+            eager_cg.loadFromFile(mTestConfigFile, true);
+            ensure_equals("default value", eager_cg.getU32("TestSetting"), 12);
+            eager_cg.loadFromFile(overrides_file, true);
+            ensure_equals("overridden declared value", eager_cg.getU32("TestSetting"), 42);
+        }
+    }
+
+    template<> template<>
+    void control_group_t::test<8>()
+    {
+        set_test_name("stale settings snapshot is rebuilt");
+        LLControlGroup::setSnapshotDirectory(mTestConfigDir);
+        {
+            LLControlGroup test_cg("before");
+            ensure_equals("original settings", test_cg.loadFromFile(mTestConfigFile, true), 1);
+        }
+
+        LLSD config;
+        config["TestSetting"]["Comment"] = "Dummy setting used for testing";
+        config["TestSetting"]["Persist"] = 1;
+        config["TestSetting"]["Type"] = "U32";
+        config["TestSetting"]["Value"] = 1234;
+        config["NewSetting"]["Comment"] = "Added after the snapshot was written";
+        config["NewSetting"]["Persist"] = 1;
+        config["NewSetting"]["Type"] = "Boolean";
+        config["NewSetting"]["Value"] = true;
+        writeSettingsFile(config);
+
+        LLControlGroup test_cg("after");
+        ensure_equals("edited settings", test_cg.loadFromFile(mTestConfigFile, true), 2);
+        ensure_equals("edited value", test_cg.getU32("TestSetting"), 1234);
+        ensure("new setting", test_cg.getBOOL("NewSetting"));
+    }
+
+    template<> template<>
+    void control_group_t::test<9>()
+    {
+        set_test_name("settings snapshot benchmark");
+
+        // LL_SETTINGS_BENCHMARK=1 times loading the shipped default settings
+        // files from XML and from their snapshots
+        const char* enabled = getenv("LL_SETTINGS_BENCHMARK");
+        if (!enabled || !*enabled)
+        {
+            skip("set LL_SETTINGS_BENCHMARK to run the settings snapshot benchmark");
+        }
+
+        std::string app_settings(__FILE__);
+        app_settings = app_settings.substr(0, app_settings.find_last_of("/\\"));
+        app_settings += "/../../newview/app_settings/";
+        // each into its own group, like the viewer's Global and PerAccount
+        const char* files[] = { "settings.xml", "settings_per_account.xml" };
+
+        typedef std::chrono::high_resolution_clock clock;
+        const S32 REPEATS = 10;
+        for (bool snapshot : { false, true })
+        {
+            LLControlGroup::setSnapshotDirectory(snapshot ? mTestConfigDir : std::string());
+            if (snapshot)
+            {
+                // write the snapshots outside of the timing
+                for (const char* file : files)
+                {
+                    LLControlGroup warm_cg("warm");
+                    warm_cg.loadFromFile(app_settings + file, true);
+                }
+            }
+
+            U32 count = 0;
+            clock::time_point start = clock::now();
+            for (S32 i = 0; i < REPEATS; ++i)
+            {
+                count = 0;
+                for (const char* file : files)
+                {
+                    LLControlGroup test_cg(file);
+                    count += test_cg.loadFromFile(app_settings + file, true);
+                    // a few lookups, as startup does before the login screen
+                    test_cg.controlExists("Language");
+                    test_cg.getControl("FirstRunThisInstall");
+                }
+            }
+            F64 ms = std::chrono::duration<F64, std::milli>(clock::now() - start).count() / REPEATS;
+            ensure("loaded settings", count > 0);
+            std::cout << "\n" << (snapshot ? "snapshot" : "xml") << ": " << count
+                      << " settings in " << ms << " ms" << std::endl;
+        }
+    }
+
+    //handles
+    template<> template<>
+    void control_group_t::test<10>()
+    {
+        set_test_name("control handles follow their control");
+        mCG->declareBOOL("TestBool", true, "Handle test", LLControlVariable::PERSIST_NO);
+        mCG->declareF32("TestF32", 1.5f, "Handle test", LLControlVariable::PERSIST_NO);
+        mCG->declareS32("TestS32", -3, "Handle test", LLControlVariable::PERSIST_NO);
+        mCG->declareU32("TestU32", 7, "Handle test", LLControlVariable::PERSIST_NO);
+
+        LLControlHandle<bool> test_bool(*mCG, "TestBool");
+        LLControlHandle<F32> test_f32(*mCG, "TestF32");
+        LLControlHandle<S32> test_s32(*mCG, "TestS32");
+        LLControlHandle<U32> test_u32(*mCG, "TestU32");
+        ensure("bool", test_bool);
+        ensure_equals("F32", test_f32(), 1.5f);
+        ensure_equals("S32", test_s32(), -3);
+        ensure_equals("U32", test_u32(), 7U);
+
+        mCG->setBOOL("TestBool", false);
+        mCG->setF32("TestF32", 2.25f);
+        mCG->setS32("TestS32", 42);
+        ensure("changed bool", !test_bool);
+        ensure_equals("changed F32", test_f32(), 2.25f);
+        ensure_equals("changed S32", test_s32(), 42);
+
+        // a second handle shares the slot
+        LLControlHandle<S32> other_s32(*mCG, "TestS32");
+        ensure_equals("shared S32", other_s32(), 42);
+
+        mCG->resetToDefaults();
+        ensure("reset bool", test_bool);
+        ensure_equals("reset F32", test_f32(), 1.5f);
+        ensure_equals("reset S32", other_s32(), -3);
+    }
+
+    template<> template<>
+    void control_group_t::test<11>()
+    {
+        set_test_name("control handle benchmark");
+
+        // LL_SETTINGS_BENCHMARK=1 also times reading a setting by name, by
+        // LLCachedControl and by LLControlHandle
+        const char* enabled = getenv("LL_SETTINGS_BENCHMARK");
+        if (!enabled || !*enabled)
+        {
+            skip("set LL_SETTINGS_BENCHMARK to run the control handle benchmark");
+        }
+
+        // a table the size of the viewer's, so that lookups by name pay for it
+        for (S32 i = 0; i < 3000; ++i)
+        {
+            mCG->declareF32(STRINGIZE("BenchmarkFiller" << i), 0.f, "Benchmark filler", LLControlVariable::PERSIST_NO);
+        }
+        mCG->declareF32("BenchmarkSetting", 0.5f, "Benchmark setting", LLControlVariable::PERSIST_NO);
+
+        typedef std::chrono::high_resolution_clock clock;
+        const S32 READS = 10000000;
+        auto time_reads = [&](const char* what, const std::function<F32()>& read)
+        {
+            F64 sum = 0.0;
+            clock::time_point start = clock::now();
+            for (S32 i = 0; i < READS; ++i)
+            {
+                sum += read();
+            }
+            F64 ns = std::chrono::duration<F64, std::nano>(clock::now() - start).count() / READS;
+            ensure_equals(what, sum, 0.5 * READS);
+            std::cout << "\n" << what << ": " << ns << " ns per read" << std::endl;
+        };
+
+        LLCachedControl<F32> cached(*mCG, "BenchmarkSetting");
+        LLControlHandle<F32> handle(*mCG, "BenchmarkSetting");
+        time_reads("getF32", [&]() { return mCG->getF32("BenchmarkSetting"); });
+        time_reads("LLCachedControl", [&]() { return (F32)cached; });
+        time_reads("LLControlHandle", [&]() { return handle.get(); });
+    }
 }
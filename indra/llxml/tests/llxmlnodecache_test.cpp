@@ -0,0 +1,257 @@
+/**
+ * @file   llxmlnodecache_test.cpp
+ * @date   2024-11
+ * @brief  Test of the layered XUI tree cache.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llxmlnodecache.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "lluuid.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+    const char* BASE_XML =
+        "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n"
+        "<floater name=\"test\" title=\"Base\" width=\"100\">\n"
+        "  <panel name=\"zeta\" label=\"z\"/>\n"
+        "  <button name=\"alpha\" label=\"a\"/>\n"
+        "  <text name=\"mid\">Some text</text>\n"
+        "  <button name=\"beta\" label=\"b\"/>\n"
+        "</floater>\n";
+
+    const char* LAYER_XML =
+        "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n"
+        "<floater name=\"test\" title=\"Layered\">\n"
+        "  <button name=\"alpha\" label=\"A\"/>\n"
+        "</floater>\n";
+
+    void write_file(const std::string& filename, const std::string& contents)
+    {
+        llofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+
+    std::string attribute_of(LLXMLNodePtr node, const char* name)
+    {
+        std::string value;
+        node->getAttributeString(name, value);
+        return value;
+    }
+}
+
+namespace tut
+{
+    struct xmlnodecache_data
+    {
+        std::string mTestDir;
+        std::string mBaseFile;
+        std::string mLayerFile;
+        std::vector<std::string> mPaths;
+
+        xmlnodecache_data()
+        {
+            LLUUID random;
+            random.generate();
+            mTestDir = STRINGIZE(LLFile::tmpdir() << "llxmlnodecache-test-" << random << "/");
+            LLFile::mkdir(mTestDir);
+            mBaseFile = mTestDir + "base.xml";
+            mLayerFile = mTestDir + "layer.xml";
+            write_file(mBaseFile, BASE_XML);
+            write_file(mLayerFile, LAYER_XML);
+            mPaths.push_back(mBaseFile);
+            mPaths.push_back(mLayerFile);
+        }
+
+        ~xmlnodecache_data()
+        {
+            LLFile::remove(mBaseFile);
+            if (LLFile::isfile(mLayerFile))
+            {
+                LLFile::remove(mLayerFile);
+            }
+            LLFile::rmdir(mTestDir);
+        }
+
+        // same names, values, line numbers and attributes, children in the same order
+        void ensure_same_tree(const std::string& msg, LLXMLNodePtr expected, LLXMLNodePtr actual)
+        {
+            ensure_equals(msg + " name", std::string(actual->getName()->mString), std::string(expected->getName()->mString));
+            const std::string node_msg = msg + "/" + expected->getName()->mString;
+            ensure_equals(node_msg + " value", actual->getValue(), expected->getValue());
+            ensure_equals(node_msg + " line", actual->getLineNumber(), expected->getLineNumber());
+
+            ensure_equals(node_msg + " attributes", actual->mAttributes.size(), expected->mAttributes.size());
+            for (LLXMLAttribList::iterator iter = expected->mAttributes.begin(); iter != expected->mAttributes.end(); ++iter)
+            {
+                const std::string name(iter->first->mString);
+                LLXMLNodePtr attribute;
+                ensure(node_msg + " has " + name, actual->getAttribute(name.c_str(), attribute, false));
+                ensure_equals(node_msg + " " + name, attribute->getValue(), iter->second->getValue());
+            }
+
+            LLXMLNodePtr expected_child = expected->getFirstChild();
+            LLXMLNodePtr actual_child = actual->getFirstChild();
+            for (; expected_child.notNull(); expected_child = expected_child->getNextSibling(), actual_child = actual_child->getNextSibling())
+            {
+                ensure(node_msg + " child missing", actual_child.notNull());
+                ensure_same_tree(node_msg, expected_child, actual_child);
+            }
+            ensure(node_msg + " extra child", actual_child.isNull());
+        }
+    };
+
+    typedef test_group<xmlnodecache_data> xmlnodecache_test;
+    typedef xmlnodecache_test::object xmlnodecache_object;
+    tut::xmlnodecache_test xmlnodecache_testcase("LLXMLNodeCache");
+
+    template<> template<>
+    void xmlnodecache_object::test<1>()
+    {
+        set_test_name("cached trees are the layered ones");
+        LLXMLNodePtr expected;
+        ensure("layered", LLXMLNode::getLayeredXMLNode(expected, mPaths));
+        ensure_equals("layer applied", attribute_of(expected, "title"), "Layered");
+
+        LLXMLNodeCache cache;
+        LLXMLNodePtr first;
+        ensure("first read", cache.getLayeredXMLNode(first, mPaths));
+        ensure_equals("cached", cache.size(), 1);
+        ensure_same_tree("first", expected, first);
+
+        LLXMLNodePtr second;
+        ensure("second read", cache.getLayeredXMLNode(second, mPaths));
+        ensure_equals("still one entry", cache.size(), 1);
+        ensure_same_tree("second", expected, second);
+        ensure("not shared", first.get() != second.get());
+    }
+
+    template<> template<>
+    void xmlnodecache_object::test<2>()
+    {
+        set_test_name("copies are the caller's");
+        LLXMLNodeCache cache;
+        LLXMLNodePtr first;
+        ensure("first read", cache.getLayeredXMLNode(first, mPaths));
+        first->setAttributeString("title", "Changed");
+        LLXMLNodePtr child = first->getFirstChild();
+        first->deleteChild(child);
+
+        LLXMLNodePtr second;
+        ensure("second read", cache.getLayeredXMLNode(second, mPaths));
+        ensure_equals("attribute kept", attribute_of(second, "title"), "Layered");
+        ensure_equals("first child kept", attribute_of(second->getFirstChild(), "name"), "zeta");
+    }
+
+    template<> template<>
+    void xmlnodecache_object::test<3>()
+    {
+        set_test_name("changed and missing files are read again");
+        LLXMLNodeCache cache;
+        LLXMLNodePtr root;
+        ensure("first read", cache.getLayeredXMLNode(root, mPaths));
+
+        std::string layer(LAYER_XML);
+        LLStringUtil::replaceString(layer, "Layered", "Layered again");
+        write_file(mLayerFile, layer);
+        ensure("changed layer", cache.getLayeredXMLNode(root, mPaths));
+        ensure_equals("new layer applied", attribute_of(root, "title"), "Layered again");
+
+        LLFile::remove(mLayerFile);
+        ensure("missing layer", !cache.getLayeredXMLNode(root, mPaths));
+    }
+
+    template<> template<>
+    void xmlnodecache_object::test<4>()
+    {
+        set_test_name("XUI file read benchmark");
+
+        // Reads every XUI file of the default skin that many times, parsing
+        // them and then from the cache: LL_XML_NODE_CACHE_BENCHMARK=<reads>
+        const char* reads = getenv("LL_XML_NODE_CACHE_BENCHMARK");
+        if (!reads || !*reads)
+        {
+            skip("set LL_XML_NODE_CACHE_BENCHMARK to run the XUI file read benchmark");
+        }
+        std::string xui_dir(__FILE__);
+        xui_dir = xui_dir.substr(0, xui_dir.find_last_of("/\\") + 1) + "../../newview/skins/default/xui/en/";
+        std::vector<std::vector<std::string> > files;
+        for (const std::string& name : gDirUtilp->getFilesInDir(xui_dir))
+        {
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".xml") == 0)
+            {
+                files.push_back(std::vector<std::string>(1, xui_dir + name));
+            }
+        }
+        if (files.empty())
+        {
+            skip("xui/en not found");
+        }
+        const S32 count = llmax(atoi(reads), 1);
+
+        typedef std::chrono::high_resolution_clock clock;
+        S32 parsed = 0;
+        clock::time_point start = clock::now();
+        for (S32 i = 0; i < count; ++i)
+        {
+            for (const std::vector<std::string>& paths : files)
+            {
+                LLXMLNodePtr root;
+                parsed += LLXMLNode::getLayeredXMLNode(root, paths) ? 1 : 0;
+            }
+        }
+        const F64 parse_seconds = std::chrono::duration<F64>(clock::now() - start).count();
+
+        LLXMLNodeCache cache;
+        for (const std::vector<std::string>& paths : files)
+        {
+            LLXMLNodePtr root;
+            cache.getLayeredXMLNode(root, paths);
+        }
+        S32 cached = 0;
+        start = clock::now();
+        for (S32 i = 0; i < count; ++i)
+        {
+            for (const std::vector<std::string>& paths : files)
+            {
+                LLXMLNodePtr root;
+                cached += cache.getLayeredXMLNode(root, paths) ? 1 : 0;
+            }
+        }
+        const F64 cache_seconds = std::chrono::duration<F64>(clock::now() - start).count();
+        ensure_equals("same files", cached, parsed);
+
+        std::cout << "\n" << count << " reads of " << files.size() << " XUI files" << std::endl;
+        std::cout << "parse and layer: " << parse_seconds * 1000. / count << " ms per read of all" << std::endl;
+        std::cout << "from the cache:  " << cache_seconds * 1000. / count << " ms per read of all" << std::endl;
+    }
+}
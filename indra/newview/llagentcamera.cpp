@@ -1271,8 +1271,14 @@ void LLAgentCamera::updateLookAt(const S32 mouse_x, const S32 mouse_y)
             F32 y_from_center =
                 ((F32) mouse_y / (F32) gViewerWindow->getWorldViewHeightScaled() ) - 0.5f;
 
-            frameCamera.yaw( - x_from_center * gSavedSettings.getF32("YawFromMousePosition") * DEG_TO_RAD);
-            frameCamera.pitch( - y_from_center * gSavedSettings.getF32("PitchFromMousePosition") * DEG_TO_RAD);
+            // <FS> Per-frame settings reads through interned handles
+            //frameCamera.yaw( - x_from_center * gSavedSettings.getF32("YawFromMousePosition") * DEG_TO_RAD);
+            //frameCamera.pitch( - y_from_center * gSavedSettings.getF32("PitchFromMousePosition") * DEG_TO_RAD);
+            static LLControlHandle<F32> yaw_from_mouse_position(gSavedSettings, "YawFromMousePosition");
+            static LLControlHandle<F32> pitch_from_mouse_position(gSavedSettings, "PitchFromMousePosition");
+            frameCamera.yaw( - x_from_center * yaw_from_mouse_position * DEG_TO_RAD);
+            frameCamera.pitch( - y_from_center * pitch_from_mouse_position * DEG_TO_RAD);
+            // </FS>
             lookAtType = LOOKAT_TARGET_FREELOOK;
         }
 
@@ -1569,7 +1575,11 @@ void LLAgentCamera::updateCamera()
         {
             const F32 SMOOTHING_HALF_LIFE = 0.02f;
 
-            F32 smoothing = LLSmoothInterpolation::getInterpolant(gSavedSettings.getF32("CameraPositionSmoothing") * SMOOTHING_HALF_LIFE, false);
+            // <FS> Per-frame settings reads through interned handles
+            //F32 smoothing = LLSmoothInterpolation::getInterpolant(gSavedSettings.getF32("CameraPositionSmoothing") * SMOOTHING_HALF_LIFE, false);
+            static LLControlHandle<F32> camera_position_smoothing(gSavedSettings, "CameraPositionSmoothing");
+            F32 smoothing = LLSmoothInterpolation::getInterpolant(camera_position_smoothing * SMOOTHING_HALF_LIFE, false);
+            // </FS>
 
             if (mFocusOnAvatar && !mFocusObject) // we differentiate on avatar mode
             {
@@ -2303,7 +2313,12 @@ LLVector3d LLAgentCamera::getFocusOffsetInitial()
 // [RLVa:KB] - @setcam_eyeoffsetscale
 F32 LLAgentCamera::getCameraOffsetScale() const
 {
-    return gSavedSettings.getF32( (ECameraPreset::CAMERA_RLV_SETCAM_VIEW != mCameraPreset) ? "CameraOffsetScale" : "CameraOffsetScaleRLVa");
+    // <FS> Per-frame settings reads through interned handles
+    //return gSavedSettings.getF32( (ECameraPreset::CAMERA_RLV_SETCAM_VIEW != mCameraPreset) ? "CameraOffsetScale" : "CameraOffsetScaleRLVa");
+    static LLControlHandle<F32> camera_offset_scale(gSavedSettings, "CameraOffsetScale");
+    static LLControlHandle<F32> camera_offset_scale_rlva(gSavedSettings, "CameraOffsetScaleRLVa");
+    return (ECameraPreset::CAMERA_RLV_SETCAM_VIEW != mCameraPreset) ? camera_offset_scale : camera_offset_scale_rlva;
+    // </FS>
 }
 // [/RLVa:KB]
 
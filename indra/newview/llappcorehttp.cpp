@@ -54,6 +54,7 @@
 
 const F64 LLAppCoreHttp::MAX_THREAD_WAIT_TIME(10.0);
 const long LLAppCoreHttp::PIPELINING_DEPTH(5L);
+const long LLAppCoreHttp::HTTP2_STREAMS(16L);
 
 //  Default and dynamic values for classes
 static const struct
@@ -63,64 +64,65 @@ static const struct
     U32                         mMax;
     U32                         mRate;
     bool                        mPipelined;
+    bool                        mMultiplexed;
     std::string                 mKey;
     const char *                mUsage;
 } init_data[LLAppCoreHttp::AP_COUNT] =
 {
     { // AP_DEFAULT
-        8,      8,      8,      0,      false,
+        8,      8,      8,      0,      false,      false,
         "",
         "other"
     },
     // <FS:Beq> Avoid stall in texture fetch due to asset fetching. [Drake]
     { // AP_ASSET
-        12,     1,      16,     0,      true,
+        12,     1,      16,     0,      true,       false,
         "AssetFetchConcurrency",
         "asset fetch"
     },
     // </FS:Beq>
     { // AP_TEXTURE
-        8,      1,      12,     0,      true,
+        8,      1,      12,     0,      true,       true,
         "TextureFetchConcurrency",
         "texture fetch"
     },
     { // AP_MESH1
-        32,     1,      128,    0,      false,
+        32,     1,      128,    0,      false,      true,
         "MeshMaxConcurrentRequests",
         "mesh fetch"
     },
     { // AP_MESH2
-        8,      1,      32,     0,      true,
+        8,      1,      32,     0,      true,       true,
         "Mesh2MaxConcurrentRequests",
         "mesh2 fetch"
     },
     { // AP_LARGE_MESH
-        2,      1,      8,      0,      false,
+        2,      1,      8,      0,      false,      false,
         "",
         "large mesh fetch"
     },
     { // AP_UPLOADS
-        2,      1,      8,      0,      false,
+        2,      1,      8,      0,      false,      false,
         "",
         "asset upload"
     },
     { // AP_LONG_POLL
-        32,     32,     32,     0,      false,
+        32,     32,     32,     0,      false,      false,
         "",
         "long poll"
     },
     { // AP_INVENTORY
-        4,      1,      4,      0,      false,
+        4,      1,      4,      0,      false,      false,
         "",
         "inventory"
     },
     { // AP_MATERIALS
-        2,      1,      8,      0,      false,
+        2,      1,      8,      0,      false,      false,
         "RenderMaterials",
         "material manager requests"
     },
     { // AP_AGENT
-        2,      1,      32,     0,      false,
+        2,      1,      32,     0,      false,      false,
         "Agent",
         "Agent requests"
     }
@@ -133,7 +135,8 @@ static void ssl_verification_changed();
 LLAppCoreHttp::HttpClass::HttpClass()
     : mPolicy(LLCore::HttpRequest::DEFAULT_POLICY_ID),
       mConnLimit(0U),
-      mPipelined(false)
+      mPipelined(false),
+      mMultiplexed(false)
 {}
 
 
@@ -142,7 +145,8 @@ LLAppCoreHttp::LLAppCoreHttp()
       mStopHandle(LLCORE_HTTP_HANDLE_INVALID),
       mStopRequested(0.0),
       mStopped(false),
-      mPipelined(true)
+      mPipelined(true),
+      mMultiplexed(false)
 {}
 
 
@@ -292,6 +296,14 @@ void LLAppCoreHttp::init()
         LL_INFOS("Init") << "HTTP Pipelining " << (mPipelined ? "enabled" : "disabled") << "!" << LL_ENDL;
     }
 
+    // Global HTTP/2 multiplexing setting
+    static const std::string http_multiplexing("FSHttpMultiplexing");
+    if (gSavedSettings.controlExists(http_multiplexing))
+    {
+        mMultiplexed = gSavedSettings.getBOOL(http_multiplexing);
+        LL_INFOS("Init") << "HTTP/2 Multiplexing " << (mMultiplexed ? "enabled" : "disabled") << "!" << LL_ENDL;
+    }
+
     // Register signals for settings and state changes
     for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
     {
@@ -460,6 +472,33 @@ void LLAppCoreHttp::refreshSettings(bool initial)
                     mHttpClasses[app_policy].mPipelined = to_pipeline;
                 }
             }
+
+            // Multiplexing takes precedence over pipelining in llcorehttp
+            const bool to_multiplex(mMultiplexed && init_data[i].mMultiplexed);
+            if (to_multiplex != mHttpClasses[app_policy].mMultiplexed)
+            {
+                LLCore::HttpHandle handle;
+                const long new_streams(to_multiplex ? HTTP2_STREAMS : 0);
+
+                handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_HTTP2_STREAMS,
+                                                   mHttpClasses[app_policy].mPolicy,
+                                                   new_streams,
+                                                   LLCore::HttpHandler::ptr_t());
+                if (LLCORE_HTTP_HANDLE_INVALID == handle)
+                {
+                    status = mRequest->getStatus();
+                    LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+                                     << " multiplexing.  Reason:  " << status.toString()
+                                     << LL_ENDL;
+                }
+                else
+                {
+                    LL_DEBUGS("Init") << "Changed " << init_data[i].mUsage
+                                      << " multiplexing.  New value:  " << new_streams
+                                      << LL_ENDL;
+                    mHttpClasses[app_policy].mMultiplexed = to_multiplex;
+                }
+            }
         }
 
         // Get target connection concurrency value
@@ -490,10 +529,13 @@ void LLAppCoreHttp::refreshSettings(bool initial)
             // avatars, etc.) can request additional outbound connections
             // to other servers via 2X total connection limit.
             //
+            // Multiplexing.  As pipelining, with up to HTTP2_STREAMS
+            // requests on each connection.
+            //
             LLCore::HttpHandle handle;
             handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_CONNECTION_LIMIT,
                                                mHttpClasses[app_policy].mPolicy,
-                                               (mHttpClasses[app_policy].mPipelined ? 2 * setting : setting),
+                                               (isPipelined(app_policy) || isMultiplexed(app_policy) ? 2 * setting : setting),
                                                LLCore::HttpHandler::ptr_t());
             if (LLCORE_HTTP_HANDLE_INVALID == handle)
             {
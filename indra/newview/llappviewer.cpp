@@ -106,6 +106,7 @@
 #include "llprogressview.h"
 #include "llvocache.h"
 #include "lldiskcache.h"
+#include "llpackedassetstore.h" // <FS> Packed asset store
 #include "llvopartgroup.h"
 // [SL:KB] - Patch: Appearance-Misc | Checked: 2013-02-12 (Catznip-3.4)
 #include "llappearancemgr.h"
@@ -984,6 +985,18 @@ bool LLAppViewer::init()
     }
 
     LL_INFOS("InitInfo") << "Configuration initialized." << LL_ENDL ;
+
+    // <FS> Worker threads look controls up too, so leave nothing to be
+    // declared lazily from the settings snapshots once they start
+    for (const auto& key : LLControlGroup::key_snapshot())
+    {
+        if (std::shared_ptr<LLControlGroup> group = LLControlGroup::getInstance(key))
+        {
+            group->loadAllFromSnapshots();
+        }
+    }
+    // </FS>
+
     //set the max heap size.
     initMaxHeapSize() ;
     LLCoros::instance().setStackSize(gSavedSettings.getS32("CoroutineStackSize"));
@@ -2631,6 +2644,14 @@ bool LLAppViewer::initThreads()
     threadCounts["ImageDecode"] = image_decode_count;
     gSavedSettings.setLLSD("ThreadPoolSizes", threadCounts);
 
+    // <FS> Large textures may decode on several threads, using the cores
+    // the decode pool leaves free, but for the ones the default decode
+    // thread count above keeps for the main thread and the others
+    const S32 reserved_cores = 4;
+    LLImageJ2C::setDecodeThreads(gSavedSettings.getU32("FSImageDecodeThreadsPerImage"),
+                                 (U32)llmax(cores - image_decode_count - reserved_cores, 0));
+    // </FS>
+
     // Image decoding
     LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
     LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
@@ -3062,6 +3083,16 @@ bool LLAppViewer::initConfiguration()
     // - apply command line settings (to override the overrides)
     // - load per account settings (happens in llstartup
 
+    // <FS> Map binary snapshots of the default settings files instead of
+    // parsing their XML on every start
+    std::string settings_snapshots = gDirUtilp->getExpandedFilename(LL_PATH_USER_SETTINGS, "settings_snapshots");
+    LLFile::mkdir(settings_snapshots);
+    if (LLFile::isdir(settings_snapshots))
+    {
+        LLControlGroup::setSnapshotDirectory(settings_snapshots);
+    }
+    // </FS>
+
     // - load defaults
     bool set_defaults = true;
     if (!loadSettingsFromDirectory("Default", set_defaults))
@@ -5274,6 +5305,13 @@ bool LLAppViewer::initCache()
     // </FS:Ansariel>
 
     const std::string cache_dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, cache_dir_name);
+    // <FS> Packed asset store, must exist before the disk cache indexes it
+    if (gSavedSettings.getBOOL("FSDiskCachePackedStore"))
+    {
+        LLFile::mkdir(cache_dir);
+        LLPackedAssetStore::initParamSingleton(gDirUtilp->add(cache_dir, "packed"));
+    }
+    // </FS>
     // <FS:Beq> Improve cache purge triggering
     // LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info);
     LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info, gSavedSettings.getF32("FSDiskCacheHighWaterPercent"), gSavedSettings.getF32("FSDiskCacheLowWaterPercent"));
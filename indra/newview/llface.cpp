@@ -2314,9 +2314,13 @@ F32 LLFace::getTextureVirtualSize()
     return face_area;
 }
 
+// <FS> Shared with getPixelAreaUpdate()
+static constexpr F32 PIXEL_AREA_UPDATE_PERIOD = 0.1f;
+// </FS>
+
 bool LLFace::calcPixelArea(F32& cos_angle_to_view_dir, F32& radius)
 {
-    constexpr F32 PIXEL_AREA_UPDATE_PERIOD = 0.1f;
+    //constexpr F32 PIXEL_AREA_UPDATE_PERIOD = 0.1f; // <FS/> file scope
     // this is an expensive operation and the result is valid (enough) for several frames
     // don't update every frame
     if (gFrameTimeSeconds - mLastPixelAreaUpdate < PIXEL_AREA_UPDATE_PERIOD)
@@ -2515,20 +2519,15 @@ const F32 FACE_IMPORTANCE_TO_CAMERA_OVER_DISTANCE[FACE_IMPORTANCE_LEVEL][2] = //
 const F32 FACE_IMPORTANCE_TO_CAMERA_OVER_ANGLE[FACE_IMPORTANCE_LEVEL][2] =    //{cos(angle), importance_weight}
     {{0.985f /*cos(10 degrees)*/, 1.0f}, {0.94f /*cos(20 degrees)*/, 0.8f}, {0.866f /*cos(30 degrees)*/, 0.64f}, {0.0f, 0.36f}} ;
 
-//static
-F32 LLFace::calcImportanceToCamera(F32 cos_angle_to_view_dir, F32 dist)
+// <FS> calcImportanceToCamera() of a camera taken apart, see calcPixelAreas()
+static F32 importance_to_camera(F32 cos_angle_to_view_dir, F32 dist, F32 cos_half_fov, bool moving_fast)
 {
-    LL_PROFILE_ZONE_SCOPED_CATEGORY_FACE;
     F32 importance = 0.f ;
 
-    if(cos_angle_to_view_dir > LLViewerCamera::getInstance()->getCosHalfFov() &&
+    if(cos_angle_to_view_dir > cos_half_fov &&
         dist < FACE_IMPORTANCE_TO_CAMERA_OVER_DISTANCE[FACE_IMPORTANCE_LEVEL - 1][0])
     {
-        LLViewerCamera* camera = LLViewerCamera::getInstance();
-        F32 camera_moving_speed = camera->getAverageSpeed() ;
-        F32 camera_angular_speed = camera->getAverageAngularSpeed();
-
-        if(camera_moving_speed > 10.0f || camera_angular_speed > 1.0f)
+        if(moving_fast)
         {
             //if camera moves or rotates too fast, ignore the importance factor
             return 0.f ;
@@ -2546,6 +2545,106 @@ F32 LLFace::calcImportanceToCamera(F32 cos_angle_to_view_dir, F32 dist)
 
     return importance ;
 }
+// </FS>
+
+//static
+F32 LLFace::calcImportanceToCamera(F32 cos_angle_to_view_dir, F32 dist)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_FACE;
+    // <FS> Shared with calcPixelAreas()
+    LLViewerCamera* camera = LLViewerCamera::getInstance();
+    return importance_to_camera(cos_angle_to_view_dir, dist, camera->getCosHalfFov(),
+                                camera->getAverageSpeed() > 10.0f || camera->getAverageAngularSpeed() > 1.0f);
+    // </FS>
+}
+
+// <FS> calcPixelArea() in two halves for LLViewerTextureList
+LLFace::EPixelAreaUpdate LLFace::getPixelAreaUpdate(LLVector4a& sphere) const
+{
+    if (gFrameTimeSeconds - mLastPixelAreaUpdate < PIXEL_AREA_UPDATE_PERIOD)
+    {
+        return PIXEL_AREA_CURRENT;
+    }
+
+    // the skeleton of rigged faces and the frustum test of media are main thread business
+    if (isState(LLFace::RIGGED) || hasMedia())
+    {
+        return PIXEL_AREA_CALC;
+    }
+
+    LLVector4a center;
+    LLVector4a size;
+    if (mDrawablep && mVObjp.notNull() && mVObjp->getPartitionType() == LLViewerRegion::PARTITION_PARTICLE && mDrawablep->getSpatialGroup())
+    {
+        const LLVector4a* extents = mDrawablep->getSpatialGroup()->getExtents();
+        size.setSub(extents[1], extents[0]);
+        center.setAdd(extents[1], extents[0]);
+        center.mul(0.5f);
+    }
+    else
+    {
+        center.load3(getPositionAgent().mV);
+        size.setSub(mExtents[1], mExtents[0]);
+    }
+    size.mul(0.5f);
+
+    sphere = center;
+    sphere.getF32ptr()[3] = size.getLength3().getF32();
+    return PIXEL_AREA_SPHERE;
+}
+
+void LLFace::setPixelAreaUpdate(F32 pixel_area, F32 importance)
+{
+    mPixelArea = pixel_area;
+    mImportanceToCamera = importance;
+    // remember last update time, add 10% noise to avoid all faces updating at the same time
+    mLastPixelAreaUpdate = gFrameTimeSeconds + ll_frand() * PIXEL_AREA_UPDATE_PERIOD * 0.1f;
+}
+
+//static
+void LLFace::getPixelAreaCamera(PixelAreaCamera& camera)
+{
+    LLViewerCamera* viewer_camera = LLViewerCamera::getInstance();
+    camera.mOrigin.load3(viewer_camera->getOrigin().mV);
+    camera.mXAxis.load3(viewer_camera->getXAxis().mV);
+    camera.mPixelAngle = LLDrawable::sCurPixelAngle;
+    camera.mCosHalfFov = viewer_camera->getCosHalfFov();
+    camera.mMovingFast = viewer_camera->getAverageSpeed() > 10.0f || viewer_camera->getAverageAngularSpeed() > 1.0f;
+}
+
+//static
+void LLFace::calcPixelAreas(const PixelAreaCamera& camera, const LLVector4a* spheres, const F32* bounding_radii,
+                            S32 count, F32* pixel_areas, F32* importances)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_FACE;
+    for (S32 i = 0; i < count; ++i)
+    {
+        // the sums of calcPixelArea(), in the same order
+        const F32 size = spheres[i].getF32ptr()[3];
+        LLVector4a lookAt;
+        lookAt.setSub(spheres[i], camera.mOrigin);
+
+        F32 dist = lookAt.getLength3().getF32();
+        dist = llmax(dist - size, 0.001f);
+
+        lookAt.normalize3fast();
+
+        F32 app_angle = atanf(size / dist);
+        F32 radius = app_angle * camera.mPixelAngle;
+        pixel_areas[i] = radius * radius * 3.14159f;
+
+        if (dist < bounding_radii[i]) //camera is very close
+        {
+            importances[i] = 1.f;
+        }
+        else
+        {
+            const F32 cos_angle_to_view_dir = lookAt.dot3(camera.mXAxis).getF32();
+            importances[i] = importance_to_camera(cos_angle_to_view_dir, dist, camera.mCosHalfFov, camera.mMovingFast);
+        }
+    }
+}
+// </FS>
 
 //static
 F32 LLFace::adjustPixelArea(F32 importance, F32 pixel_area)
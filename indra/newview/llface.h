@@ -252,10 +252,40 @@ private:
     friend class LLViewerTextureList;
     F32         adjustPartialOverlapPixelArea(F32 cos_angle_to_view_dir, F32 radius );
     bool        calcPixelArea(F32& cos_angle_to_view_dir, F32& radius) ;
+
+    // <FS> calcPixelArea() in two halves, so that LLViewerTextureList can
+    // compute the areas of many faces at once, off the main thread
+    enum EPixelAreaUpdate
+    {
+        PIXEL_AREA_CURRENT,         // updated recently, calcPixelArea() would return true
+        PIXEL_AREA_SPHERE,          // sphere is set, see calcPixelAreas()
+        PIXEL_AREA_CALC             // needs calcPixelArea(): rigged and media faces
+    };
+    // The bounding sphere calcPixelArea() would measure, center in xyz and
+    // radius in w
+    EPixelAreaUpdate getPixelAreaUpdate(LLVector4a& sphere) const;
+    void        setPixelAreaUpdate(F32 pixel_area, F32 importance);
+    // </FS>
 public:
     static F32 calcImportanceToCamera(F32 to_view_dir, F32 dist);
     static F32 adjustPixelArea(F32 importance, F32 pixel_area) ;
 
+    // <FS> What calcPixelArea() reads from the camera, taken on the main thread
+    struct PixelAreaCamera
+    {
+        LLVector4a  mOrigin;
+        LLVector4a  mXAxis;
+        F32         mPixelAngle;
+        F32         mCosHalfFov;
+        bool        mMovingFast;    // importance is 0 while the camera moves fast
+    };
+    static void getPixelAreaCamera(PixelAreaCamera& camera);
+    // calcPixelArea() of count faces of getPixelAreaUpdate() spheres and
+    // mBoundingSphereRadius bounding_radii, safe on any thread
+    static void calcPixelAreas(const PixelAreaCamera& camera, const LLVector4a* spheres, const F32* bounding_radii,
+                               S32 count, F32* pixel_areas, F32* importances);
+    // </FS>
+
 public:
 
     LLVector3       mCenterLocal;
@@ -280,6 +310,10 @@ public:
     bool mInFrustum = false;
     // value of gFrameCount the last time the face was touched by LLViewerTextureList::updateImageDecodePriority
     U32 mLastTextureUpdate = 0;
+    // <FS> LLViewerTextureList virtual size pass that last gathered the face, and its index in that pass
+    U32 mVirtualSizePass = 0;
+    U32 mVirtualSizeIndex = 0;
+    // </FS>
 
 private:
     LLPointer<LLVertexBuffer> mVertexBuffer;
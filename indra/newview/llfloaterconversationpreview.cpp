@@ -41,6 +41,7 @@
 // <FS:CR>
 #include "llfloatersearchreplace.h"
 #include "lltextbox.h"
+#include "lltranscriptindex.h" // <FS/> Paged transcript loading
 #include "llviewerwindow.h"
 #include "llviewercontrol.h"
 #include "llwindow.h"
@@ -63,7 +64,11 @@ LLFloaterConversationPreview::LLFloaterConversationPreview(const LLSD& session_i
     mMessages(NULL),
     mHistoryThreadsBusy(false),
     mIsGroup(false),
-    mOpened(false)
+    mOpened(false),
+    // <FS> Paged transcript loading
+    mLoadThread(nullptr),
+    mLoadedPage(0)
+    // </FS>
 {
 }
 
@@ -131,7 +136,15 @@ void LLFloaterConversationPreview::setPages(std::list<LLSD>* messages, const std
             delete mMessages; // Clean up temporary message list with "Loading..." text
         }
         mMessages = messages;
-        mCurrentPage = (mMessages->size() ? (static_cast<int>(mMessages->size()) - 1) / mPageSize : 0);
+        // <FS> Paged transcript loading: only the last page was loaded
+        //mCurrentPage = (mMessages->size() ? (static_cast<int>(mMessages->size()) - 1) / mPageSize : 0);
+        // Called by the thread itself, which may not be listed by LLLogChat yet
+        mTranscriptIndex = mLoadThread ? mLoadThread->getTranscriptIndex() : nullptr;
+        mLoadThread = nullptr;
+        size_t message_count = mTranscriptIndex ? mTranscriptIndex->getMessageCount() : mMessages->size();
+        mCurrentPage = (message_count ? (static_cast<int>(message_count) - 1) / mPageSize : 0);
+        mLoadedPage = mCurrentPage;
+        // </FS>
 
         mPageSpinner->setEnabled(true);
         mPageSpinner->setMaxValue((F32)(mCurrentPage+1));
@@ -176,6 +189,10 @@ void LLFloaterConversationPreview::onOpen(const LLSD& key)
     load_params["load_all_history"] = true;
     load_params["cut_off_todays_date"] = false;
     load_params["is_group"] = mIsGroup;
+    // <FS> Paged transcript loading
+    load_params["page_size"] = mPageSize;
+    mLoadParams = load_params;
+    // </FS>
 
     // The temporary message list with "Loading..." text
     // Will be deleted upon loading completion in setPages() method
@@ -201,6 +218,13 @@ void LLFloaterConversationPreview::onOpen(const LLSD& key)
 
     LLLoadHistoryThread* loadThread = new LLLoadHistoryThread(mChatHistoryFileName, messages, load_params);
     loadThread->setLoadEndSignal(boost::bind(&LLFloaterConversationPreview::setPages, this, _1, _2));
+    // <FS> Paged transcript loading
+    {
+        LLMutexLock lock(&mMutex);
+        mTranscriptIndex.reset();
+        mLoadThread = loadThread;
+    }
+    // </FS>
     loadThread->start();
     log_chat_inst->addLoadHistoryThread(mSessionID, loadThread);
 
@@ -227,15 +251,34 @@ void LLFloaterConversationPreview::showHistory()
 {
     // additional protection to avoid changes of mMessages in setPages
     LLMutexLock lock(&mMutex);
-    if(mMessages == NULL || !mMessages->size() || mCurrentPage * mPageSize >= mMessages->size())
+    // <FS> Paged transcript loading: read the page shown from the transcript
+    //if(mMessages == NULL || !mMessages->size() || mCurrentPage * mPageSize >= mMessages->size())
+    //{
+    //    return;
+    //}
+    int first_message = mCurrentPage * mPageSize;
+    if (mTranscriptIndex && mMessages)
+    {
+        if (mLoadedPage != mCurrentPage)
+        {
+            // Refilled in place, LLDeleteHistoryThread deletes this list
+            mMessages->clear();
+            LLLogChat::loadChatHistoryPage(*mTranscriptIndex, first_message, mPageSize, *mMessages, mLoadParams);
+            mLoadedPage = mCurrentPage;
+        }
+        first_message = 0;
+    }
+    if (mMessages == NULL || !mMessages->size() || first_message >= mMessages->size())
     {
         return;
     }
+    // </FS>
 
     mChatHistory->clear();
     std::ostringstream message;
     std::list<LLSD>::const_iterator iter = mMessages->begin();
-    std::advance(iter, mCurrentPage * mPageSize);
+    //std::advance(iter, mCurrentPage * mPageSize);
+    std::advance(iter, first_message); // <FS/> Paged transcript loading
 
     for (int msg_num = 0; iter != mMessages->end() && msg_num < mPageSize; ++iter, ++msg_num)
     {
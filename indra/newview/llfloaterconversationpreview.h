@@ -36,6 +36,8 @@ extern const std::string LL_FCP_COMPLETE_NAME;  //"complete_name"
 extern const std::string LL_FCP_ACCOUNT_NAME;       //"user_name"
 
 class LLSpinCtrl;
+class LLTranscriptIndex; // <FS/> Paged transcript loading
+class LLLoadHistoryThread; // <FS/> Paged transcript loading
 
 class LLFloaterConversationPreview : public LLFloater
 {
@@ -79,6 +81,14 @@ private:
     bool            mHistoryThreadsBusy;
     bool            mOpened;
     bool            mIsGroup;
+
+    // <FS> Paged transcript loading: when set, mMessages only holds page
+    // mLoadedPage of the transcript
+    std::shared_ptr<LLTranscriptIndex> mTranscriptIndex;
+    LLLoadHistoryThread* mLoadThread;   // until it calls setPages()
+    int             mLoadedPage;
+    LLSD            mLoadParams;
+    // </FS>
 };
 
 #endif /* LLFLOATERCONVERSATIONPREVIEW_H_ */
@@ -37,6 +37,8 @@
 #include "llviewercontrol.h"
 
 #include "lldiriterator.h"
+#include "hbxxh.h"             // <FS/> Paged transcript loading
+#include "lltranscriptindex.h" // <FS/> Paged transcript loading
 // <FS:CR> Firectorm communications UI
 //#include "llfloaterimsessiontab.h"
 #include "fsfloaterim.h"
@@ -147,6 +149,23 @@ const char* remove_utf8_bom(const char* buf)
     return start;
 }
 
+// <FS> Paged transcript loading: shared by the history loaders
+void restore_mention_urls(std::string& line)
+{
+    // fast heuristic test for a mention URL in a string
+    // this is used to avoid costly regex calls
+    if (line.find("/mention)") != std::string::npos)
+    {
+        // restore original mention URL from [@username](URL) format
+        static const boost::regex altered_mention_regex("\\[@([^\\]]+)\\]\\((" APP_HEADER_REGEX "/agent/[\\da-f-]+/mention)\\)",
+                                                        boost::regex::perl | boost::regex::icase);
+
+        // $2 captures the URL part
+        line = boost::regex_replace(line, altered_mention_regex, "$2");
+    }
+}
+// </FS>
+
 class LLLogChatTimeScanner: public LLSingleton<LLLogChatTimeScanner>
 {
     LLSINGLETON(LLLogChatTimeScanner);
@@ -574,18 +593,7 @@ void LLLogChat::loadChatHistory(const std::string& file_name, std::list<LLSD>& m
 
         std::string line(remove_utf8_bom(buffer));
 
-
-        // fast heuristic test for a mention URL in a string
-        // this is used to avoid costly regex calls
-        if (line.find("/mention)") != std::string::npos)
-        {
-            // restore original mention URL from [@username](URL) format
-            static const boost::regex altered_mention_regex("\\[@([^\\]]+)\\]\\((" APP_HEADER_REGEX "/agent/[\\da-f-]+/mention)\\)",
-                                                            boost::regex::perl | boost::regex::icase);
-
-            // $2 captures the URL part
-            line = boost::regex_replace(line, altered_mention_regex, "$2");
-        }
+        restore_mention_urls(line); // <FS/> Paged transcript loading
 
         //updated 1.23 plain text log format requires a space added before subsequent lines in a multilined message
         if (' ' == line[0])
@@ -615,6 +623,55 @@ void LLLogChat::loadChatHistory(const std::string& file_name, std::list<LLSD>& m
         << " file mod time " << (F64)stat_data.st_mtime << LL_ENDL;
 }
 
+// <FS> Paged transcript loading
+//static
+void LLLogChat::loadChatHistoryPage(const LLTranscriptIndex& index, size_t first, size_t count, std::list<LLSD>& messages, const LLSD& load_params)
+{
+    std::vector<std::string> lines;
+    if (!index.readMessages(first, count, lines))
+    {
+        LL_WARNS("ChatHistory") << "Unable to read messages " << first << " to " << first + count
+            << " of " << index.getLogFilename() << LL_ENDL;
+        return;
+    }
+
+    // Same parsing as loadChatHistory(), on lines without their line ends
+    for (const std::string& log_line : lines)
+    {
+        std::string line(remove_utf8_bom(log_line.c_str()));
+        restore_mention_urls(line);
+
+        if (line.empty())
+        {
+            //to support old format's multilined messages with new lines used to divide paragraphs
+            append_to_last_message(messages, "\n");
+        }
+        else if (' ' == line[0])
+        {
+            line.erase(0, MULTI_LINE_PREFIX.length());
+            append_to_last_message(messages, '\n' + line);
+        }
+        else
+        {
+            LLSD item;
+            if (!LLChatLogParser::parse(line, item, load_params))
+            {
+                item[LL_IM_TEXT] = line;
+            }
+            messages.push_back(item);
+        }
+    }
+}
+
+//static
+std::string LLLogChat::makeTranscriptIndexFileName(const std::string& log_file_name)
+{
+    std::string dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "transcripts");
+    LLFile::mkdir(dir);
+    return gDirUtilp->add(dir, llformat("%016llx.idx", (unsigned long long)HBXXH64::digest(log_file_name)));
+}
+// </FS>
+
 bool LLLogChat::historyThreadsFinished(LLUUID session_id)
 {
     LLMutexLock lock(historyThreadsMutex());
@@ -1330,7 +1387,11 @@ void LLLoadHistoryThread::loadHistory(const std::string& file_name, std::list<LL
     }
 
     bool load_all_history = load_params.has("load_all_history") ? load_params["load_all_history"].asBoolean() : false;
-    LLFILE* fptr = LLFile::fopen(LLLogChat::makeLogFileName(file_name), "rb");/*Flawfinder: ignore*/
+    // <FS> Paged transcript loading: keep the name of the file read
+    //LLFILE* fptr = LLFile::fopen(LLLogChat::makeLogFileName(file_name), "rb");/*Flawfinder: ignore*/
+    std::string log_file_name = LLLogChat::makeLogFileName(file_name);
+    LLFILE* fptr = LLFile::fopen(log_file_name, "rb");/*Flawfinder: ignore*/
+    // </FS>
 
     if (!fptr)
     {
@@ -1355,7 +1416,11 @@ void LLLoadHistoryThread::loadHistory(const std::string& file_name, std::list<LL
         }
         if (!fptr)
         {
-            fptr = LLFile::fopen(LLLogChat::oldLogFileName(file_name), "rb");/*Flawfinder: ignore*/
+            // <FS> Paged transcript loading
+            //fptr = LLFile::fopen(LLLogChat::oldLogFileName(file_name), "rb");/*Flawfinder: ignore*/
+            log_file_name = LLLogChat::oldLogFileName(file_name);
+            fptr = LLFile::fopen(log_file_name, "rb");/*Flawfinder: ignore*/
+            // </FS>
             if (!fptr)
             {
                 mNewLoad = false;
@@ -1365,6 +1430,27 @@ void LLLoadHistoryThread::loadHistory(const std::string& file_name, std::list<LL
         }
     }
 
+    // <FS> Paged transcript loading: read the last page only, through an
+    // index of the messages which is kept up to date in the cache
+    S32 page_size = load_params.has("page_size") ? load_params["page_size"].asInteger() : 0;
+    if (load_all_history && page_size > 0)
+    {
+        mTranscriptIndex = std::make_shared<LLTranscriptIndex>(log_file_name, LLLogChat::makeTranscriptIndexFileName(log_file_name));
+        if (mTranscriptIndex->update())
+        {
+            fclose(fptr);
+            const size_t count = mTranscriptIndex->getMessageCount();
+            const size_t first = count ? (count - 1) / page_size * page_size : 0;
+            LLLogChat::loadChatHistoryPage(*mTranscriptIndex, first, page_size, *messages, load_params);
+            mNewLoad = false;
+            (*mLoadEndSignal)(messages, file_name);
+            return;
+        }
+        // Unreadable index, load the whole transcript instead
+        mTranscriptIndex.reset();
+    }
+    // </FS>
+
     char buffer[LOG_RECALL_SIZE];       /*Flawfinder: ignore*/
 
     char *bptr;
@@ -28,6 +28,8 @@
 #define LL_LLLOGCHAT_H
 #include "llthread.h"
 
+class LLTranscriptIndex; // <FS/> Paged transcript loading
+
 class LLChat;
 
 class LLActionThread : public LLThread
@@ -53,6 +55,7 @@ private:
     std::list<LLSD>* mMessages;
     LLSD mLoadParams;
     bool mNewLoad;
+    std::shared_ptr<LLTranscriptIndex> mTranscriptIndex; // <FS/> Paged transcript loading
 public:
     LLLoadHistoryThread(const std::string& file_name, std::list<LLSD>* messages, const LLSD& load_params);
     ~LLLoadHistoryThread();
@@ -60,6 +63,12 @@ public:
     virtual void loadHistory(const std::string& file_name, std::list<LLSD>* messages, const LLSD& load_params);
     virtual void run();
 
+    // <FS> Paged transcript loading: with a "page_size" load parameter, only
+    // the last page is loaded, the others are read through this index
+    // when the thread has finished.
+    std::shared_ptr<LLTranscriptIndex> getTranscriptIndex() const { return mTranscriptIndex; }
+    // </FS>
+
     typedef boost::signals2::signal<void (std::list<LLSD>* messages,const std::string& file_name)> load_end_signal_t;
     load_end_signal_t * mLoadEndSignal;
     boost::signals2::connection setLoadEndSignal(const load_end_signal_t::slot_type& cb);
@@ -109,6 +118,10 @@ public:
     static void getListOfTranscriptBackupFiles(std::vector<std::string>& list_of_transcriptions);
 
     static void loadChatHistory(const std::string& file_name, std::list<LLSD>& messages, const LLSD& load_params = LLSD(), bool is_group = false);
+    // <FS> Paged transcript loading
+    static void loadChatHistoryPage(const LLTranscriptIndex& index, size_t first, size_t count, std::list<LLSD>& messages, const LLSD& load_params);
+    static std::string makeTranscriptIndexFileName(const std::string& log_file_name);
+    // </FS>
 
     typedef boost::signals2::signal<void ()> save_history_signal_t;
     boost::signals2::connection setSaveHistorySignal(const save_history_signal_t::slot_type& cb);
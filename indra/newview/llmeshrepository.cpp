@@ -981,7 +981,7 @@ LLMeshRepoThread::LLMeshRepoThread()
 
     // Lod processing is expensive due to the number of requests
     // and a need to do expensive cacheOptimize().
-    mMeshThreadPool = std::make_unique<LL::ThreadPool>("MeshLodProcessing", 2);
+    mMeshThreadPool = std::make_unique<LL::WorkStealingThreadPool>("MeshLodProcessing", 2); // <FS/> per-worker lanes
     mMeshThreadPool->start();
 }
 
@@ -4577,7 +4577,9 @@ void LLMeshRepository::notifyLoadedMeshes()
         // we'll increase this.  See llappcorehttp and llcorehttp for
         // discussion on connection strategies.
         LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
-        S32 scale(app_core_http.isPipelined(LLAppCoreHttp::AP_MESH2)
+        S32 scale(app_core_http.isMultiplexed(LLAppCoreHttp::AP_MESH2)
+                  ? (2 * LLAppCoreHttp::HTTP2_STREAMS)
+                  : app_core_http.isPipelined(LLAppCoreHttp::AP_MESH2)
                   ? (2 * LLAppCoreHttp::PIPELINING_DEPTH)
                   : 5);
 
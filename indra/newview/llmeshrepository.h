@@ -558,7 +558,7 @@ public:
     // workqueue for processing generic requests
     LL::WorkQueue mWorkQueue;
     // lods have their own thread due to costly cacheOptimize() calls
-    std::unique_ptr<LL::ThreadPool> mMeshThreadPool;
+    std::unique_ptr<LL::WorkStealingThreadPool> mMeshThreadPool; // <FS/> per-worker lanes
 
     // llcorehttp library interface objects.
     LLCore::HttpStatus                  mHttpStatus;
@@ -0,0 +1,306 @@
+/**
+ * @file llobjectupdatepipeline.cpp
+ * @date   2024-11
+ * @brief Decoding of object updates on worker threads, applied in batches.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectupdatepipeline.h"
+
+#include "lldatapacker.h"
+#include "lltimer.h"
+
+#include <thread>
+
+namespace
+{
+    // Offsets of the compressed object data, see LLViewerObject::initObjectDataMap()
+    const S32 OFFSET_ID = 0;
+    const S32 OFFSET_LOCAL_ID = 16;
+    const S32 OFFSET_PCODE = 20;
+    const S32 OFFSET_CRC = 22;
+    const S32 OFFSET_SCALE = 28;
+    const S32 OFFSET_POS = 40;
+    const S32 OFFSET_SPECIAL_CODE = 64;
+    const S32 OFFSET_PARENT_ID = 96;    // after Omega, or 12 bytes earlier without it
+
+    const U32 SPECIAL_HAS_PARENT = 0x20;
+    const U32 SPECIAL_HAS_OMEGA = 0x80;
+
+    const S32 MIN_OBJECT_BLOCK_SIZE = OFFSET_PCODE + 1;
+    const S32 MIN_EXTENTS_SIZE = OFFSET_SPECIAL_CODE + 4;
+}
+
+LLObjectUpdatePipeline::Batch::Batch(U64 region_handle)
+:   mRegionHandle(region_handle),
+    mState(QUEUED)
+{
+}
+
+void LLObjectUpdatePipeline::Batch::addBlock(const U8* data, S32 size, U32 flags)
+{
+    llassert(mState.load() == QUEUED);
+
+    Record record;
+    record.mLocalID = 0;
+    record.mCRC = 0;
+    record.mFlags = flags;
+    record.mParentID = 0;
+    record.mPCode = 0;
+    record.mHasExtents = false;
+    record.mOffset = (S32)mData.size();
+    record.mSize = llmax(size, 0);
+
+    mData.insert(mData.end(), data, data + record.mSize);
+
+    // The local id is needed right away to hold back later updates of the object
+    if (size >= MIN_OBJECT_BLOCK_SIZE)
+    {
+        LLDataPackerBinaryBuffer dp(mData.data() + record.mOffset, record.mSize);
+        dp.shift(OFFSET_LOCAL_ID);
+        dp.unpackU32(record.mLocalID, "LocalID");
+    }
+
+    mRecords.push_back(record);
+}
+
+void LLObjectUpdatePipeline::Batch::decode()
+{
+    U32 expected = QUEUED;
+    if (mState.compare_exchange_strong(expected, DECODING, std::memory_order_acq_rel))
+    {
+        LL_PROFILE_ZONE_SCOPED;
+        for (Record& record : mRecords)
+        {
+            decodeBlock(mData.data() + record.mOffset, record);
+        }
+        mState.store(DECODED, std::memory_order_release);
+        return;
+    }
+
+    // claimed by a worker, which is already at it
+    while (mState.load(std::memory_order_acquire) != DECODED)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// static
+void LLObjectUpdatePipeline::Batch::decodeBlock(const U8* data, Record& record)
+{
+    if (record.mSize < MIN_OBJECT_BLOCK_SIZE)
+    {
+        // dropped like an object with no PCode
+        record.mPCode = 0;
+        return;
+    }
+
+    LLDataPackerBinaryBuffer dp(const_cast<U8*>(data), record.mSize);
+
+    dp.shift(OFFSET_ID);
+    dp.unpackUUID(record.mFullID, "ID");
+    dp.reset();
+    record.mPCode = data[OFFSET_PCODE];
+
+    if (record.mSize < MIN_EXTENTS_SIZE)
+    {
+        return;
+    }
+
+    dp.shift(OFFSET_CRC);
+    dp.unpackU32(record.mCRC, "CRC");
+    dp.reset();
+
+    // as LLViewerObject::extractSpatialExtents(), which also decodes the unused rotation
+    U32 special_code = 0;
+    dp.shift(OFFSET_SPECIAL_CODE);
+    dp.unpackU32(special_code, "SpecialCode");
+    dp.reset();
+
+    record.mParentID = 0;
+    if (special_code & SPECIAL_HAS_PARENT)
+    {
+        S32 offset = OFFSET_PARENT_ID;
+        if (!(special_code & SPECIAL_HAS_OMEGA))
+        {
+            offset -= sizeof(LLVector3);
+        }
+        if (offset + 4 > record.mSize)
+        {
+            return;
+        }
+        dp.shift(offset);
+        dp.unpackU32(record.mParentID, "ParentID");
+        dp.reset();
+    }
+
+    dp.shift(OFFSET_SCALE);
+    dp.unpackVector3(record.mScale, "Scale");
+    dp.reset();
+    dp.shift(OFFSET_POS);
+    dp.unpackVector3(record.mPosition, "Pos");
+    dp.reset();
+
+    record.mHasExtents = true;
+}
+
+LLObjectUpdatePipeline::LLObjectUpdatePipeline()
+:   mNextRecord(0),
+    mPendingCount(0)
+{
+}
+
+void LLObjectUpdatePipeline::post(const batch_ptr_t& batch, const LL::WorkQueueBase::ptr_t& worker)
+{
+    if (!batch || batch->isEmpty())
+    {
+        return;
+    }
+
+    id_count_map_t& ids = mPendingIDs[batch->getRegionHandle()];
+    for (const Record& record : batch->getRecords())
+    {
+        ++ids[record.mLocalID];
+    }
+    mPendingCount += batch->getRecords().size();
+    mBatches.push_back(batch);
+
+    // When the queue is full or gone, update() decodes on the main thread
+    if (worker && !worker->isClosed())
+    {
+        worker->tryPost([batch]() { batch->decode(); });
+    }
+}
+
+bool LLObjectUpdatePipeline::applyNext(const apply_func_t& apply)
+{
+    while (!mBatches.empty())
+    {
+        // copy, apply() may flush or drop the batch
+        batch_ptr_t batch = mBatches.front();
+        if (mNextRecord >= batch->getRecords().size())
+        {
+            mBatches.pop_front();
+            mNextRecord = 0;
+            continue;
+        }
+
+        batch->decode();
+
+        const Record& record = batch->getRecords()[mNextRecord++];
+        --mPendingCount;
+
+        auto region_it = mPendingIDs.find(batch->getRegionHandle());
+        if (region_it != mPendingIDs.end())
+        {
+            auto id_it = region_it->second.find(record.mLocalID);
+            if (id_it != region_it->second.end() && !--id_it->second)
+            {
+                region_it->second.erase(id_it);
+            }
+            if (region_it->second.empty())
+            {
+                mPendingIDs.erase(region_it);
+            }
+        }
+
+        apply(*batch, record);
+        return true;
+    }
+    return false;
+}
+
+U32 LLObjectUpdatePipeline::update(F32 max_time, const apply_func_t& apply)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    U32 applied = 0;
+    LLTimer timer;
+    while (applyNext(apply))
+    {
+        ++applied;
+        if (timer.getElapsedTimeF32() >= max_time)
+        {
+            break;
+        }
+    }
+    return applied;
+}
+
+U32 LLObjectUpdatePipeline::flush(const apply_func_t& apply)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    U32 applied = 0;
+    while (applyNext(apply))
+    {
+        ++applied;
+    }
+    return applied;
+}
+
+bool LLObjectUpdatePipeline::isPending(U64 region_handle, U32 local_id) const
+{
+    auto region_it = mPendingIDs.find(region_handle);
+    return region_it != mPendingIDs.end() && region_it->second.count(local_id);
+}
+
+void LLObjectUpdatePipeline::dropRegion(U64 region_handle)
+{
+    auto region_it = mPendingIDs.find(region_handle);
+    if (region_it == mPendingIDs.end())
+    {
+        return;
+    }
+    mPendingIDs.erase(region_it);
+
+    std::deque<batch_ptr_t> batches;
+    for (size_t i = 0; i < mBatches.size(); ++i)
+    {
+        const batch_ptr_t& batch = mBatches[i];
+        const size_t first = i ? 0 : mNextRecord;
+        if (batch->getRegionHandle() != region_handle)
+        {
+            batches.push_back(batch);
+        }
+        else
+        {
+            mPendingCount -= batch->getRecords().size() - first;
+            if (!i)
+            {
+                mNextRecord = 0;
+            }
+        }
+    }
+    mBatches.swap(batches);
+}
+
+void LLObjectUpdatePipeline::clear()
+{
+    mBatches.clear();
+    mNextRecord = 0;
+    mPendingIDs.clear();
+    mPendingCount = 0;
+}
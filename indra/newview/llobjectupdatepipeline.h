@@ -0,0 +1,154 @@
+/**
+ * @file llobjectupdatepipeline.h
+ * @date   2024-11
+ * @brief Decoding of object updates on worker threads, applied in batches.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATEPIPELINE_H
+#define LL_LLOBJECTUPDATEPIPELINE_H
+
+#include "lluuid.h"
+#include "v3math.h"
+#include "workqueue.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class LLObjectUpdatePipeline
+ * @brief Moves the decoding of full compressed object updates off the main thread.
+ *
+ * Most blocks of ObjectUpdateCompressed only go to the object cache of the
+ * region, and they arrive by the thousand on teleport arrival and region
+ * crossings. The message handler copies those blocks into a Batch, which
+ * is decoded into plain Records on a worker thread. The main thread then
+ * applies the records in the order they were received, a few milliseconds
+ * per frame.
+ *
+ * Updates for an object that still has a pending record must not overtake
+ * it: handlers for other updates, probes and kills of that object call
+ * isPending() and flush() first.
+ *
+ * Terse updates are not taken. Decoding one costs a few hundred
+ * nanoseconds, little more than copying it into a Batch, and applying it
+ * to the live object has to happen on the main thread anyway.
+ */
+class LLObjectUpdatePipeline
+{
+public:
+    /// One decoded ObjectData block of an ObjectUpdateCompressed message
+    struct Record
+    {
+        LLUUID          mFullID;
+        U32             mLocalID;
+        U32             mCRC;
+        U32             mFlags;         // UpdateFlags of the block
+        U32             mParentID;
+        LLVector3       mPosition;
+        LLVector3       mScale;
+        LLPCode         mPCode;         // 0 when the block is invalid
+        bool            mHasExtents;    // mCRC, mParentID, mPosition and mScale were decoded
+        S32             mOffset;        // of the block in the batch data
+        S32             mSize;
+    };
+
+    class Batch
+    {
+    public:
+        Batch(U64 region_handle);
+
+        /// Copies one ObjectData block, main thread only
+        void addBlock(const U8* data, S32 size, U32 flags);
+
+        bool isEmpty() const { return mRecords.empty(); }
+        U64 getRegionHandle() const { return mRegionHandle; }
+
+        /// Decodes the records, on whichever thread claims the batch first.
+        /// Returns once they are decoded.
+        void decode();
+        bool isDecoded() const { return mState.load(std::memory_order_acquire) == DECODED; }
+
+        const std::vector<Record>& getRecords() const { return mRecords; }
+        U8* getData(const Record& record) { return mData.data() + record.mOffset; }
+
+        /// Decodes a single block, exposed for the unit tests
+        static void decodeBlock(const U8* data, Record& record);
+
+    private:
+        enum : U32
+        {
+            QUEUED,
+            DECODING,
+            DECODED
+        };
+
+        U64                 mRegionHandle;
+        std::vector<U8>     mData;
+        std::vector<Record> mRecords;
+        std::atomic<U32>    mState;
+    };
+
+    typedef std::shared_ptr<Batch> batch_ptr_t;
+    typedef std::function<void(Batch& batch, const Record& record)> apply_func_t;
+
+    LLObjectUpdatePipeline();
+
+    /// Queues a batch for decoding on worker, which may be null, and for
+    /// the next update(). The batch must not change afterwards.
+    void post(const batch_ptr_t& batch, const LL::WorkQueueBase::ptr_t& worker);
+
+    /// Applies the decoded records in the order they were posted, for up
+    /// to max_time seconds. Returns the number of records applied.
+    U32 update(F32 max_time, const apply_func_t& apply);
+
+    /// Applies all pending records
+    U32 flush(const apply_func_t& apply);
+
+    bool isPending(U64 region_handle, U32 local_id) const;
+
+    /// Forgets the pending records of a region that went away
+    void dropRegion(U64 region_handle);
+    void clear();
+
+    size_t getPendingCount() const { return mPendingCount; }
+    bool isEmpty() const { return mBatches.empty(); }
+
+private:
+    bool applyNext(const apply_func_t& apply);
+
+    std::deque<batch_ptr_t> mBatches;
+    size_t                  mNextRecord;    // in the front batch
+
+    // local ids with pending records, by region handle
+    typedef std::unordered_map<U32, U32> id_count_map_t;
+    std::map<U64, id_count_map_t> mPendingIDs;
+    size_t                  mPendingCount;
+};
+
+#endif // LL_LLOBJECTUPDATEPIPELINE_H
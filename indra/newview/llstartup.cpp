@@ -917,6 +917,10 @@ bool idle_startup()
             const LLUseCircuitCodeResponder* responder = NULL;
             bool failure_is_fatal = true;
 
+            // <FS> Compile message_template.msg once into the cache directory
+            LLMessageSystem::setTemplateCacheDirectory(gDirUtilp->getCacheDir());
+            // </FS>
+
             if(!start_messaging_system(
                    message_template_path,
                    port,
@@ -1002,6 +1006,9 @@ bool idle_startup()
 
             F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
             msg->mPacketRing.setDropPercentage(dropPercent);
+            // <FS> Batched UDP I/O
+            msg->mPacketRing.setBatchIO(gSavedSettings.getBOOL("FSBatchedUDP"));
+            // </FS>
         }
 
         LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
@@ -32,6 +32,7 @@
 #include "patch_dct.h"
 #include "patch_code.h"
 #include "llbitpack.h"
+#include "llpatchlayer.h" // <FS/> Terrain layers decoded off the main thread
 #include "llviewerobjectlist.h"
 #include "llregionhandle.h"
 #include "llagent.h"
@@ -887,29 +888,76 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, bool
         decode_patch(bitpack, patch);
         decompress_patch(patchp->getDataZ(), patch, &ph);
 
-        // Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
-        patchp->updateNorthEdge();
-        patchp->updateEastEdge();
-        if (patchp->getNeighborPatch(WEST))
-        {
-            patchp->getNeighborPatch(WEST)->updateEastEdge();
-        }
-        if (patchp->getNeighborPatch(SOUTHWEST))
+        // <FS> Shared with applyDCTPatches()
+        onPatchDecoded(patchp);
+        // </FS>
+    }
+}
+
+// <FS> Terrain layers decoded by LLPatchLayer on a worker thread
+void LLSurface::applyDCTPatches(const LLPatchLayer& layer)
+{
+    const S32 patch_size = layer.getPatchSize();
+    const std::vector<LLPatchLayer::Patch>& patches = layer.getPatches();
+    for (size_t index = 0; index < patches.size(); ++index)
+    {
+        const LLPatchLayer::Patch& patch = patches[index];
+        const S32 i = (S32)patch.mX;
+        const S32 j = (S32)patch.mY;
+        if ((i >= mPatchesPerEdge) || (j >= mPatchesPerEdge))
         {
-            patchp->getNeighborPatch(SOUTHWEST)->updateEastEdge();
-            patchp->getNeighborPatch(SOUTHWEST)->updateNorthEdge();
+            const LLPatchHeader& ph = patch.mHeader;
+            LL_WARNS() << "Received invalid terrain packet - patch header patch ID incorrect!"
+                << " patches per edge " << mPatchesPerEdge
+                << " i " << i
+                << " j " << j
+                << " dc_offset " << ph.dc_offset
+                << " range " << (S32)ph.range
+                << " quant_wbits " << (S32)ph.quant_wbits
+                << " patchids " << (S32)ph.patchids
+                << LL_ENDL;
+            return;
         }
-        if (patchp->getNeighborPatch(SOUTH))
+
+        LLSurfacePatch* patchp = &mPatchList[j*mPatchesPerEdge + i];
+
+        // The layer keeps each patch as a block, the surface as rows of mGridsPerEdge
+        const F32* heights = layer.getHeights(index);
+        F32* z = patchp->getDataZ();
+        for (S32 row = 0; row < patch_size; ++row)
         {
-            patchp->getNeighborPatch(SOUTH)->updateNorthEdge();
+            memcpy(z + row * mGridsPerEdge, heights + row * patch_size, patch_size * sizeof(F32));
         }
 
-        // Dirty patch statistics, and flag that the patch has data.
-        patchp->dirtyZ();
-        patchp->setHasReceivedData();
+        onPatchDecoded(patchp);
     }
 }
 
+void LLSurface::onPatchDecoded(LLSurfacePatch* patchp)
+{
+    // Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
+    patchp->updateNorthEdge();
+    patchp->updateEastEdge();
+    if (patchp->getNeighborPatch(WEST))
+    {
+        patchp->getNeighborPatch(WEST)->updateEastEdge();
+    }
+    if (patchp->getNeighborPatch(SOUTHWEST))
+    {
+        patchp->getNeighborPatch(SOUTHWEST)->updateEastEdge();
+        patchp->getNeighborPatch(SOUTHWEST)->updateNorthEdge();
+    }
+    if (patchp->getNeighborPatch(SOUTH))
+    {
+        patchp->getNeighborPatch(SOUTH)->updateNorthEdge();
+    }
+
+    // Dirty patch statistics, and flag that the patch has data.
+    patchp->dirtyZ();
+    patchp->setHasReceivedData();
+}
+// </FS>
+
 
 // Retrurns true if "position" is within the bounds of surface.
 // "position" is region-local
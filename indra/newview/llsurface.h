@@ -55,6 +55,7 @@ class LLViewerRegion;
 class LLSurfacePatch;
 class LLBitPack;
 class LLGroupHeader;
+class LLPatchLayer; // <FS/> Terrain layers decoded off the main thread
 
 class LLSurface
 {
@@ -81,6 +82,10 @@ public:
     void rebuildWater();
 // </FS:CR> Aurora Sim
     virtual void decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, bool b_large_patch);
+    // <FS> Copies a layer decoded by LLPatchLayer into the patches, in the
+    // same order and with the same checks as decompressDCTPatch()
+    void applyDCTPatches(const LLPatchLayer& layer);
+    // </FS>
     virtual void updatePatchVisibilities(LLAgent &agent);
 
     inline F32 getZ(const U32 k) const              { return mSurfaceZ[k]; }
@@ -172,6 +177,7 @@ private:
 
     void createPatchData();     // Allocates memory for patches.
     void destroyPatchData();    // Deallocates memory for patches.
+    void onPatchDecoded(LLSurfacePatch* patchp); // <FS/> Edges, neighbors and stats of a freshly decoded patch
 
     LLVector3d  mOriginGlobal;      // In absolute frame
     LLSurfacePatch *mPatchList;     // Array of all patches
@@ -3256,7 +3256,8 @@ void LLTextureFetch::commonUpdate()
     // Update low/high water levels based on pipelining.  We pick
     // up setting eventually, so the semaphore/request level can
     // fall outside the [0..HIGH_WATER] range.  Expect that.
-    if (LLAppViewer::instance()->getAppCoreHttp().isPipelined(LLAppCoreHttp::AP_TEXTURE))
+    const LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
+    if (app_core_http.isPipelined(LLAppCoreHttp::AP_TEXTURE) || app_core_http.isMultiplexed(LLAppCoreHttp::AP_TEXTURE))
     {
         mHttpHighWater = HTTP_PIPE_REQUESTS_HIGH_WATER;
         mHttpLowWater = HTTP_PIPE_REQUESTS_LOW_WATER;
@@ -329,6 +329,7 @@ static void update_tp_display(bool minimized)
     }
 
     const std::string& message = gAgent.getTeleportMessage();
+    static LLControlHandle<bool> disable_teleport_screens(gSavedSettings, "FSDisableTeleportScreens"); // <FS/>
     switch (gAgent.getTeleportState())
     {
         case LLAgent::TELEPORT_PENDING:
@@ -337,7 +338,7 @@ static void update_tp_display(bool minimized)
             const std::string& msg = LLAgent::sTeleportProgressMessages["pending"];
             if (!minimized)
             {
-                gViewerWindow->setShowProgress(true, !gSavedSettings.getBOOL("FSDisableTeleportScreens"));
+                gViewerWindow->setShowProgress(true, !disable_teleport_screens()); // <FS/>
                 gViewerWindow->setProgressPercent(llmin(teleport_percent, 0.0f));
                 gViewerWindow->setProgressString(msg);
             }
@@ -374,7 +375,7 @@ static void update_tp_display(bool minimized)
             FSData::instance().selectNextMOTD();
             if (!minimized)
             {
-                gViewerWindow->setShowProgress(true, !gSavedSettings.getBOOL("FSDisableTeleportScreens"));
+                gViewerWindow->setShowProgress(true, !disable_teleport_screens()); // <FS/>
                 gViewerWindow->setProgressPercent(llmin(teleport_percent, 0.0f));
                 gViewerWindow->setProgressString(msg);
                 gViewerWindow->setProgressMessage(gAgent.mMOTD);
@@ -723,11 +724,15 @@ void display(bool rebuild, F32 zoom_factor, int subfield, bool for_snapshot)
             gSavedSettings.setF32("FSSavedRenderFarClip", 0.0f);
         }
 
-        if (gTeleportArrivalTimer.getElapsedTimeF32() >=
-            (F32)gSavedSettings.getU32("FSRenderFarClipSteppingInterval"))
+        // <FS> Per-frame settings reads through interned handles
+        //if (gTeleportArrivalTimer.getElapsedTimeF32() >=
+        //    (F32)gSavedSettings.getU32("FSRenderFarClipSteppingInterval"))
+        static LLControlHandle<U32> far_clip_stepping_interval(gSavedSettings, "FSRenderFarClipSteppingInterval");
+        if (gTeleportArrivalTimer.getElapsedTimeF32() >= (F32)far_clip_stepping_interval())
+        // </FS>
         {
             gTeleportArrivalTimer.reset();
-            F32 current = gSavedSettings.getF32("RenderFarClip");
+            F32 current = renderFarClip(); // <FS/>
             if (gSavedDrawDistance > current)
             {
                 current *= 2.0f;
@@ -106,6 +106,7 @@
 #include "llparcel.h"
 #include "llrootview.h"
 #include "llsceneview.h"
+#include "llscrolllistctrl.h" // <FS/> scroll list benchmark
 #include "llscenemonitor.h"
 #include "llselectmgr.h"
 #include "llsidepanelappearance.h"
@@ -5062,6 +5063,60 @@ void handle_dump_focus()
     LL_INFOS() << "Keyboard focus " << (ctrl ? ctrl->getName() : "(none)") << LL_ENDL;
 }
 
+// <FS> Fills a scroll list with 100K rows in batches of 1000, sorting after
+// each batch as the lists do while area search results or group members
+// arrive, then filters it. The times go to the log.
+void handle_benchmark_scroll_list()
+{
+    constexpr S32 ROWS = 100000;
+    constexpr S32 BATCH = 1000;
+
+    LLScrollListCtrl::Params params;
+    params.name("benchmark_scroll_list");
+    params.rect(LLRect(0, 400, 400, 0));
+    LLScrollListCtrl* list = LLUICtrlFactory::create<LLScrollListCtrl>(params);
+
+    LLSD column;
+    column["name"] = "name";
+    column["width"] = 200;
+    list->addColumn(column);
+    column["name"] = "distance";
+    column["width"] = 100;
+    list->addColumn(column);
+    list->sortByColumn("name", true);
+
+    LLTimer timer;
+    for (S32 first = 0; first < ROWS; first += BATCH)
+    {
+        for (S32 i = first; i < first + BATCH; ++i)
+        {
+            LLSD row;
+            row["columns"][0]["column"] = "name";
+            row["columns"][0]["value"] = llformat("Object %d", ll_rand(ROWS));
+            row["columns"][1]["column"] = "distance";
+            row["columns"][1]["value"] = ll_frand(256.f);
+            list->addElement(row);
+        }
+        list->updateSort();
+    }
+    const F64 fill_seconds = timer.getElapsedTimeF64();
+
+    timer.reset();
+    list->setFilterColumn(0);
+    list->setFilterString("object 1");
+    const S32 filtered = list->getItemCount();
+    for (const LLScrollListItem* item : list->getAllData())
+    {
+        list->isFiltered(item);
+    }
+    const F64 filter_seconds = timer.getElapsedTimeF64();
+
+    LL_INFOS() << "Scroll list benchmark: filled and sorted " << ROWS << " rows in " << fill_seconds
+               << " s, filtered to " << filtered << " rows in " << filter_seconds << " s" << LL_ENDL;
+    delete list;
+}
+// </FS>
+
 class LLSelfStandUp : public view_listener_t
 {
     bool handleEvent(const LLSD& userdata)
@@ -12954,6 +13009,7 @@ void initialize_menus()
     view_listener_t::addMenu(new LLAdvancedDumpInventory(), "Advanced.DumpInventory");
     commit.add("Advanced.DumpTimers", boost::bind(&handle_dump_timers) );
     commit.add("Advanced.DumpFocusHolder", boost::bind(&handle_dump_focus) );
+    commit.add("Advanced.BenchmarkScrollList", boost::bind(&handle_benchmark_scroll_list)); // <FS/>
     view_listener_t::addMenu(new LLAdvancedPrintSelectedObjectInfo(), "Advanced.PrintSelectedObjectInfo");
     view_listener_t::addMenu(new LLAdvancedPrintAgentInfo(), "Advanced.PrintAgentInfo");
     view_listener_t::addMenu(new LLAdvancedToggleDebugClicks(), "Advanced.ToggleDebugClicks");
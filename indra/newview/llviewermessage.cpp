@@ -4658,6 +4658,13 @@ void process_kill_object(LLMessageSystem *mesgsys, void **user_data)
         U32 local_id;
         mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
 
+        // <FS> A cached update still in the pipeline must not come back after the kill
+        if (regionp)
+        {
+            gObjectList.flushPendingUpdates(regionp->getHandle(), local_id);
+        }
+        // </FS>
+
         gObjectList.getUUIDFromLocal(id, local_id, ip, port);
         if (id == LLUUID::null)
         {
@@ -29,6 +29,8 @@
 #include "llviewerobjectlist.h"
 
 #include "message.h"
+#include "llmessagetemplate.h" // <FS/>
+#include "lltemplatemessagereader.h" // <FS/>
 #include "llfasttimer.h"
 #include "llrender.h"
 #include "llwindow.h"       // decBusyCount()
@@ -457,7 +459,20 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
     // Coordinates in simulators are region-local
     // Until we get region-locality working on viewer we
     // have to transform to absolute coordinates.
-    num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
+    // <FS> Resolve the ObjectData block once per message and read it by index
+    //num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
+    LLTemplateMessageReader* reader = mesgsys->getTemplateMessageReader();
+    if (!reader)
+    {
+        LL_WARNS() << "Object update not read from a message template" << LL_ENDL;
+        return;
+    }
+    const LLMessageTemplate* message_template = reader->getMessageTemplate();
+    const S32 object_data_block = message_template->getBlockIndex(_PREHASH_ObjectData);
+    const S32 data_variable = message_template->getVariableIndex(object_data_block, _PREHASH_Data);
+    const S32 update_flags_variable = message_template->getVariableIndex(object_data_block, _PREHASH_UpdateFlags);
+    num_objects = reader->getNumberOfBlocksAt(object_data_block);
+    // </FS>
 
     // I don't think this case is ever hit.  TODO* Test this.
     if (!compressed && update_type != OUT_FULL)
@@ -510,6 +525,12 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
     LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
     LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
+    // <FS> Blocks that only go to the object cache are decoded on the
+    // General thread pool, and applied from update()
+    static LLCachedControl<bool> threaded_decode(gSavedSettings, "FSObjectUpdateThreadedDecode", true);
+    LLObjectUpdatePipeline::batch_ptr_t batch;
+    // </FS>
+
     for (i = 0; i < num_objects; i++)
     {
         bool justCreated = false;
@@ -519,19 +540,44 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         {
             compressed_dp.reset();
 
-            S32 uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+            // <FS>
+            //S32 uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+            //LL_DEBUGS("ObjectUpdate") << "got binary data from message to compressed_dpbuffer" << LL_ENDL;
+            //mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i, 2048);
+            S32 uncompressed_length = reader->getSizeAt(object_data_block, i, data_variable);
             LL_DEBUGS("ObjectUpdate") << "got binary data from message to compressed_dpbuffer" << LL_ENDL;
-            mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i, 2048);
+            reader->getBinaryDataAt(object_data_block, data_variable, compressed_dpbuffer, 0, i, 2048);
+            // </FS>
             compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
 
             if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
             {
                 U32 flags = 0;
-                mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+                // <FS>
+                //mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+                reader->getBinaryDataAt(object_data_block, update_flags_variable, &flags, sizeof(U32), i);
+
+                if (threaded_decode && (flags & FLAGS_TEMPORARY_ON_REZ) == 0)
+                {
+                    if (!batch)
+                    {
+                        batch = std::make_shared<LLObjectUpdatePipeline::Batch>(region_handle);
+                    }
+                    batch->addBlock(compressed_dpbuffer, uncompressed_length, flags);
+                    continue;
+                }
+                if (batch)
+                {
+                    // keep the blocks in order
+                    mUpdatePipeline.post(batch, LL::WorkQueue::getInstance("General"));
+                    batch.reset();
+                }
+                // </FS>
 
                 compressed_dp.unpackUUID(fullid, "ID");
                 compressed_dp.unpackU32(local_id, "LocalID");
                 compressed_dp.unpackU8(pcode, "PCode");
+                flushPendingUpdates(region_handle, local_id); // <FS/>
 
                 if (pcode == 0)
                 {
@@ -555,6 +601,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
             {
                 update_cache = true;
                 compressed_dp.unpackU32(local_id, "LocalID");
+                flushPendingUpdates(region_handle, local_id); // <FS/>
                 getUUIDFromLocal(fullid,
                                  local_id,
                                  gMessageSystem->getSenderIP(),
@@ -569,6 +616,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         else if (update_type != OUT_FULL) // !compressed, !OUT_FULL ==> OUT_FULL_CACHED only?
         {
             mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+            flushPendingUpdates(region_handle, local_id); // <FS/>
 
             getUUIDFromLocal(fullid,
                             local_id,
@@ -589,6 +637,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
             update_cache = true;
             mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, fullid, i);
             mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+            flushPendingUpdates(region_handle, local_id); // <FS/>
             LL_DEBUGS("ObjectUpdate") << "Full Update, obj " << local_id << ", global ID " << fullid << " from " << mesgsys->getSender() << LL_ENDL;
         }
         objectp = findObject(fullid);
@@ -749,6 +798,13 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         objectp->setLastUpdateType(update_type);
     }
 
+    // <FS>
+    if (batch)
+    {
+        mUpdatePipeline.post(batch, LL::WorkQueue::getInstance("General"));
+    }
+    // </FS>
+
     LLVOAvatar::cullAvatarsByPixelArea();
 }
 
@@ -759,6 +815,54 @@ void LLViewerObjectList::processCompressedObjectUpdate(LLMessageSystem *mesgsys,
     processObjectUpdate(mesgsys, user_data, update_type, true);
 }
 
+// <FS>
+void LLViewerObjectList::flushPendingUpdates(U64 region_handle, U32 local_id)
+{
+    if (mUpdatePipeline.isPending(region_handle, local_id))
+    {
+        flushPendingUpdates();
+    }
+}
+
+void LLViewerObjectList::flushPendingUpdates()
+{
+    mUpdatePipeline.flush([this](LLObjectUpdatePipeline::Batch& batch, const LLObjectUpdatePipeline::Record& record)
+                          { applyPipelinedUpdate(batch, record); });
+}
+
+void LLViewerObjectList::applyPipelinedUpdate(LLObjectUpdatePipeline::Batch& batch, const LLObjectUpdatePipeline::Record& record)
+{
+    LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(batch.getRegionHandle());
+    if (!regionp)
+    {
+        return;
+    }
+
+    if (record.mPCode == 0)
+    {
+        // object creation will fail, LLViewerObject::createObject()
+        LL_WARNS() << "Received object " << record.mFullID
+            << " with 0 PCode. Local id: " << record.mLocalID
+            << " Flags: " << record.mFlags
+            << " Region: " << regionp->getName()
+            << " Region id: " << regionp->getRegionID() << LL_ENDL;
+        LLViewerStatsRecorder::instance().objectUpdateFailure();
+        return;
+    }
+
+    //send to object cache
+    LLDataPackerBinaryBuffer dp(batch.getData(record), record.mSize);
+    if (record.mHasExtents)
+    {
+        regionp->cacheFullUpdate(dp, record);
+    }
+    else
+    {
+        regionp->cacheFullUpdate(dp, record.mFlags);
+    }
+}
+// </FS>
+
 void LLViewerObjectList::processCachedObjectUpdate(LLMessageSystem *mesgsys,
                                              void **user_data,
                                              const EObjectUpdateType update_type)
@@ -787,6 +891,7 @@ void LLViewerObjectList::processCachedObjectUpdate(LLMessageSystem *mesgsys,
         mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
         mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
         mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+        flushPendingUpdates(region_handle, id); // <FS/>
 
         LL_DEBUGS("ObjectUpdate") << "got probe for id " << id << " crc " << crc << LL_ENDL;
 
@@ -942,6 +1047,13 @@ void LLViewerObjectList::update(LLAgent &agent)
     LLViewerObject::setVelocityInterpolate(velocityInterpolate);
     LLViewerObject::setPingInterpolate(pingInterpolate);
 
+    // <FS> Apply the object updates decoded since the last frame
+    static LLCachedControl<F32> apply_time(gSavedSettings, "FSObjectUpdateApplyTime", 2.f);
+    mUpdatePipeline.update(llmax((F32)apply_time, 0.f) / 1000.f,
+                           [this](LLObjectUpdatePipeline::Batch& batch, const LLObjectUpdatePipeline::Record& record)
+                           { applyPipelinedUpdate(batch, record); });
+    // </FS>
+
     F32 interp_time = (F32)interpolationTime;
     F32 phase_out_time = (F32)interpolationPhaseOut;
     F32 region_interp_time = llclamp(regionCrossingInterpolationTime(), 0.5f, 5.f);
@@ -1039,6 +1151,7 @@ void LLViewerObjectList::update(LLAgent &agent)
                 objectp->idleUpdate(agent, frame_time);
             }
         }
+        LLVOAvatar::updateDeferredPoses(); // <FS/> Parallel pose update
     }
     else
     {
@@ -1050,6 +1163,8 @@ void LLViewerObjectList::update(LLAgent &agent)
                 objectp->idleUpdate(agent, frame_time);
         }
 
+        LLVOAvatar::updateDeferredPoses(); // <FS/> Parallel pose update
+
         //update flexible objects
         LLVolumeImplFlexible::updateClass();
 
@@ -1563,6 +1678,7 @@ void LLViewerObjectList::killObjects(LLViewerRegion *regionp)
     LL_PROFILE_ZONE_SCOPED;
     LLViewerObject *objectp;
 
+    mUpdatePipeline.dropRegion(regionp->getHandle()); // <FS/>
 
     for (vobj_list_t::iterator iter = mObjects.begin(); iter != mObjects.end(); ++iter)
     {
@@ -1583,6 +1699,7 @@ void LLViewerObjectList::killAllObjects()
     // Used only on global destruction.
 
     // Mass cleanup to not clear lists one item at a time
+    mUpdatePipeline.clear(); // <FS/>
     mIndexAndLocalIDToUUID.clear();
     mActiveObjects.clear();
     mMapObjects.clear();
@@ -38,6 +38,7 @@
 #include "llviewerobject.h"
 #include "lleventcoro.h"
 #include "llcoros.h"
+#include "llobjectupdatepipeline.h" // <FS/>
 
 class LLCamera;
 class LLNetMap;
@@ -89,6 +90,11 @@ public:
     void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool compressed=false);
     void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
     void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+    // <FS> Full compressed updates decoded on the General thread pool
+    // Applies the pending updates first when one of them is for this object
+    void flushPendingUpdates(U64 region_handle, U32 local_id);
+    void flushPendingUpdates();
+    // </FS>
     void updateApparentAngles(LLAgent &agent);
     void update(LLAgent &agent);
 
@@ -252,6 +258,11 @@ private:
     // <FS:Ansariel> FIRE-20288: Option to render friends only
     bool isNonFriendDerendered(const LLUUID& id, LLPCode pcode);
 
+    // <FS>
+    void applyPipelinedUpdate(LLObjectUpdatePipeline::Batch& batch, const LLObjectUpdatePipeline::Record& record);
+    LLObjectUpdatePipeline mUpdatePipeline;
+    // </FS>
+
 // <FS:ND> Remember objects we did derender. We might get object updates for them that create new instances. In those cases we kill them again.
 private:
     std::map< LLUUID, bool > mDerendered;
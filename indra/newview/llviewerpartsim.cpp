@@ -65,12 +65,139 @@ const F32 LLViewerPartSim::PART_ADAPT_RATE_MULT_RECIP = 1.0f/PART_ADAPT_RATE_MUL
 
 U32 LLViewerPart::sNextPartID = 1;
 
-F32 calc_desired_size(LLViewerCamera* camera, LLVector3 pos, LLVector2 scale)
+// <FS> From the camera origin, for groups simulated off the main thread
+F32 calc_desired_size(const LLVector3& camera_origin, const LLVector3& pos, const LLVector2& scale)
 {
-    F32 desired_size = (pos - camera->getOrigin()).magVec();
+    F32 desired_size = (pos - camera_origin).magVec();
     desired_size /= 4;
     return llclamp(desired_size, scale.magVec()*0.5f, PART_SIM_BOX_SIDE*2);
 }
+// </FS>
+
+F32 calc_desired_size(LLViewerCamera* camera, LLVector3 pos, LLVector2 scale)
+{
+    // <FS> From the camera origin, for groups simulated off the main thread
+    //F32 desired_size = (pos - camera->getOrigin()).magVec();
+    //desired_size /= 4;
+    //return llclamp(desired_size, scale.magVec()*0.5f, PART_SIM_BOX_SIDE*2);
+    return calc_desired_size(camera->getOrigin(), pos, scale);
+    // </FS>
+}
+
+// <FS> Particles recycled through a free list
+namespace
+{
+    // Carves particles out of slabs and keeps the freed ones for reuse.
+    // Slabs whose particles are all freed are released, but for one kept
+    // for the next burst.
+    class LLViewerPartAllocator
+    {
+    public:
+        void* allocate()
+        {
+            if (mPartial.empty())
+            {
+                std::unique_ptr<Slab> new_slab = std::make_unique<Slab>();
+                new_slab->mParts.reset(new U8[PARTS_PER_SLAB * sizeof(LLViewerPart)]);
+                U8* parts = new_slab->mParts.get();
+                new_slab->mFree.reserve(PARTS_PER_SLAB);
+                for (S32 i = PARTS_PER_SLAB - 1; i >= 0; --i)
+                {
+                    new_slab->mFree.push_back(parts + i * sizeof(LLViewerPart));
+                }
+                mPartial.push_back(new_slab.get());
+                mSlabs.emplace(parts, std::move(new_slab));
+            }
+
+            Slab* slab = mPartial.back();
+            if (slab == mEmptySlab)
+            {
+                mEmptySlab = nullptr;
+            }
+            void* ptr = slab->mFree.back();
+            slab->mFree.pop_back();
+            if (slab->mFree.empty())
+            {
+                mPartial.pop_back();
+            }
+            return ptr;
+        }
+
+        void deallocate(void* ptr)
+        {
+            // the slab starting last at or before ptr
+            slab_map_t::iterator iter = mSlabs.upper_bound(static_cast<const U8*>(ptr));
+            llassert(iter != mSlabs.begin());
+            --iter;
+            Slab* slab = iter->second.get();
+
+            if (slab->mFree.empty())
+            {
+                mPartial.push_back(slab);
+            }
+            slab->mFree.push_back(ptr);
+            if (slab->mFree.size() < PARTS_PER_SLAB)
+            {
+                return;
+            }
+
+            if (!mEmptySlab)
+            {
+                mEmptySlab = slab;
+                return;
+            }
+            mPartial.erase(std::find(mPartial.begin(), mPartial.end(), slab));
+            mSlabs.erase(iter);
+        }
+
+    private:
+        static const S32 PARTS_PER_SLAB = 256;
+
+        struct Slab
+        {
+            std::unique_ptr<U8[]>   mParts;
+            std::vector<void*>      mFree;
+        };
+        typedef std::map<const U8*, std::unique_ptr<Slab> > slab_map_t;
+
+        slab_map_t          mSlabs;     // by the address of their particles
+        std::vector<Slab*>  mPartial;   // slabs with free particles
+        Slab*               mEmptySlab = nullptr; // the one with all of them free kept
+    };
+
+    // Never destroyed, particles may outlive the static destructors
+    LLViewerPartAllocator& get_part_allocator()
+    {
+        static LLViewerPartAllocator* allocator = new LLViewerPartAllocator();
+        return *allocator;
+    }
+}
+
+//static
+void* LLViewerPart::operator new(size_t size)
+{
+    if (size != sizeof(LLViewerPart))
+    {
+        return ::operator new(size);
+    }
+    return get_part_allocator().allocate();
+}
+
+//static
+void LLViewerPart::operator delete(void* ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    if (size != sizeof(LLViewerPart))
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    get_part_allocator().deallocate(ptr);
+}
+// </FS>
 
 LLViewerPart::LLViewerPart() :
     mPartID(0),
@@ -134,7 +261,9 @@ void LLViewerPart::init(LLPointer<LLViewerPartSource> sourcep, LLViewerTexture *
 
 
 LLViewerPartGroup::LLViewerPartGroup(const LLVector3 &center_agent, const F32 box_side, bool hud)
- : mHud(hud)
+ : mHud(hud),
+   mCallbackCount(0), // <FS/> Particles in structure of arrays
+   mUpdateDt(0.f) // <FS/> Particles in structure of arrays
 {
     mVOPartGroupp = NULL;
     mUniformParticles = true;
@@ -268,6 +397,12 @@ bool LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 
     mParticles.push_back(part);
     part->mSkipOffset=mSkippedTime;
+    // <FS> Particles in structure of arrays
+    if (part->mVPCallback)
+    {
+        ++mCallbackCount;
+    }
+    // </FS>
     ++LLViewerPartSim::sParticleCount; // <FS:Beq/> FIRE-34600 - bugsplat AVX2 particle count mismatch
     return true;
 }
@@ -275,29 +410,33 @@ bool LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 
 void LLViewerPartGroup::updateParticles(const F32 lastdt)
 {
-    F32 dt;
-
-    LLVector3 gravity(0.f, 0.f, GRAVITY);
-
-    LLViewerPartSim::checkParticleCount(static_cast<U32>(mParticles.size()));
+    // <FS> Simulated in structure of arrays, see LLParticlePool
+    prepareUpdate(lastdt, LLViewerCamera::getInstance()->getOrigin());
+    simulate();
+    finishUpdate();
+    // </FS>
+}
 
-    LLViewerCamera* camera = LLViewerCamera::getInstance();
-    LLViewerRegion *regionp = getRegion();
-    // <FS:Beq> FIRE-34600 - Bugsplat AVX2 particle count mismatch    
-    // S32 end = (S32) mParticles.size();
-    bool changed = false;
-    // </FS:Beq>
-    for (S32 i = 0 ; i < (S32)mParticles.size();)
+// <FS> Particles in structure of arrays
+void LLViewerPartGroup::prepareUpdate(const F32 lastdt, const LLVector3& camera_origin)
+{
+    mUpdateDt = lastdt;
+    mCameraOrigin = camera_origin;
+    if (!mCallbackCount)
     {
-        LLVector3 a(0.f, 0.f, 0.f);
-        LLViewerPart* part = mParticles[i] ;
+        return;
+    }
 
-        dt = lastdt + mSkippedTime - part->mSkipOffset;
-        part->mSkipOffset = 0.f;
+    // The callbacks look at the objects of their sources, which is only safe
+    // on the main thread. simulate() computes the same dt after them.
+    for (LLViewerPart* part : mParticles)
+    {
+        if (!part->mVPCallback)
+        {
+            continue;
+        }
 
-        // Update current time
-        const F32 cur_time = part->mLastUpdateTime + dt;
-        const F32 frac = cur_time / part->mMaxAge;
+        const F32 dt = lastdt + mSkippedTime - part->mSkipOffset;
 
         // "Drift" the object based on the source object
         if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
@@ -306,149 +445,175 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
             part->mPosAgent += part->mPosOffset;
         }
 
-        // Do a custom callback if we have one...
-        if (part->mVPCallback)
-        {
-            (*part->mVPCallback)(*part, dt);
-        }
+        (*part->mVPCallback)(*part, dt);
+    }
+}
 
-        if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
-        {
-            part->mVelocity *= 1.f - 0.1f*dt;
-            part->mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
-        }
+void LLViewerPartGroup::simulate()
+{
+    LL_PROFILE_ZONE_SCOPED;
 
-        // Now do interpolation towards a target
-        if (part->mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
-        {
-            F32 remaining = part->mMaxAge - part->mLastUpdateTime;
-            F32 step = dt / remaining;
+    const U32 SOURCE_FLAGS = LLPartData::LL_PART_FOLLOW_SRC_MASK | LLPartData::LL_PART_BOUNCE_MASK
+                             | LLPartData::LL_PART_TARGET_POS_MASK | LLPartData::LL_PART_TARGET_LINEAR_MASK;
+    const U32 TARGET_FLAGS = LLPartData::LL_PART_TARGET_POS_MASK | LLPartData::LL_PART_TARGET_LINEAR_MASK;
 
-            step = llclamp(step, 0.f, 0.1f);
-            step *= 5.f;
-            // we want a velocity that will result in reaching the target in the
-            // Interpolate towards the target.
-            LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPosAgent;
+    const S32 count = (S32)mParticles.size();
+    mPool.resize(count);
+    mOutcomes.resize(count);
+    if (!count)
+    {
+        return;
+    }
 
-            delta_pos /= remaining;
+    LLViewerRegion* regionp = getRegion();
+    U32* flags = mPool.flags();
+    F32* field[LLParticlePool::FIELD_COUNT];
+    for (S32 f = 0; f < LLParticlePool::FIELD_COUNT; ++f)
+    {
+        field[f] = mPool.field((LLParticlePool::EField)f);
+    }
 
-            part->mVelocity *= (1.f - step);
-            part->mVelocity += step*delta_pos;
-        }
+    for (S32 i = 0; i < count; ++i)
+    {
+        LLViewerPart* part = mParticles[i];
 
+        const F32 dt = mUpdateDt + mSkippedTime - part->mSkipOffset;
+        part->mSkipOffset = 0.f;
 
-        if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
+        // Particles with a callback drifted in prepareUpdate()
+        const LLViewerPartSource* sourcep = part->mPartSourcep.get();
+        if ((part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK) && !part->mVPCallback)
         {
-            LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;
-            part->mPosAgent = part->mPartSourcep->mPosAgent;
-            part->mPosAgent += frac*delta_pos;
-            part->mVelocity = delta_pos;
+            part->mPosAgent = sourcep->mPosAgent;
+            part->mPosAgent += part->mPosOffset;
         }
-        else
+
+        flags[i] = part->mFlags;
+
+        LLVector3 wind;
+        if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
         {
-            // Do velocity interpolation
-            part->mPosAgent += dt*part->mVelocity;
-            part->mPosAgent += 0.5f*dt*dt*part->mAccel;
-            part->mVelocity += part->mAccel*dt;
+            wind = regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
         }
-
-        // Do a bounce test
-        if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+        LLVector3 source;
+        LLVector3 target;
+        if (part->mFlags & SOURCE_FLAGS)
         {
-            // Need to do point vs. plane check...
-            // For now, just check relative to object height...
-            F32 dz = part->mPosAgent.mV[VZ] - part->mPartSourcep->mPosAgent.mV[VZ];
-            if (dz < 0)
+            source = sourcep->mPosAgent;
+            if (part->mFlags & TARGET_FLAGS)
             {
-                part->mPosAgent.mV[VZ] += -2.f*dz;
-                part->mVelocity.mV[VZ] *= -0.75f;
+                target = sourcep->mTargetPosAgent;
             }
         }
 
-
-        // Reset the offset from the source position
-        if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+        for (S32 c = 0; c < 3; ++c)
         {
-            part->mPosOffset = part->mPosAgent;
-            part->mPosOffset -= part->mPartSourcep->mPosAgent;
+            field[LLParticlePool::POS_X + c][i] = part->mPosAgent.mV[c];
+            field[LLParticlePool::VEL_X + c][i] = part->mVelocity.mV[c];
+            field[LLParticlePool::ACCEL_X + c][i] = part->mAccel.mV[c];
+            field[LLParticlePool::WIND_X + c][i] = wind.mV[c];
+            field[LLParticlePool::SOURCE_X + c][i] = source.mV[c];
+            field[LLParticlePool::TARGET_X + c][i] = target.mV[c];
         }
-
-        // Do color interpolation
-        if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+        for (S32 c = 0; c < 4; ++c)
         {
-            part->mColor.setVec(part->mStartColor);
-            // note: LLColor4's v%k means multiply-alpha-only,
-            //       LLColor4's v*k means multiply-rgb-only
-            part->mColor *= 1.f - frac; // rgb*k
-            part->mColor %= 1.f - frac; // alpha*k
-            part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
+            field[LLParticlePool::COLOR_R + c][i] = part->mColor.mV[c];
+            field[LLParticlePool::START_COLOR_R + c][i] = part->mStartColor.mV[c];
+            field[LLParticlePool::END_COLOR_R + c][i] = part->mEndColor.mV[c];
         }
+        for (S32 c = 0; c < 2; ++c)
+        {
+            field[LLParticlePool::SCALE_X + c][i] = part->mScale.mV[c];
+            field[LLParticlePool::START_SCALE_X + c][i] = part->mStartScale.mV[c];
+            field[LLParticlePool::END_SCALE_X + c][i] = part->mEndScale.mV[c];
+        }
+        field[LLParticlePool::DT][i] = dt;
+        field[LLParticlePool::AGE][i] = part->mLastUpdateTime;
+        field[LLParticlePool::MAX_AGE][i] = part->mMaxAge;
+    }
+
+    mPool.integrate();
+
+    for (S32 i = 0; i < count; ++i)
+    {
+        LLViewerPart* part = mParticles[i];
+
+        part->mPosAgent.set(field[LLParticlePool::POS_X][i], field[LLParticlePool::POS_Y][i], field[LLParticlePool::POS_Z][i]);
+        part->mVelocity.set(field[LLParticlePool::VEL_X][i], field[LLParticlePool::VEL_Y][i], field[LLParticlePool::VEL_Z][i]);
 
-        // Do scale interpolation
-        if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+        // Reset the offset from the source position
+        if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
         {
-            part->mScale.setVec(part->mStartScale);
-            part->mScale *= 1.f - frac;
-            part->mScale += frac*part->mEndScale;
+            part->mPosOffset.set(field[LLParticlePool::OFFSET_X][i], field[LLParticlePool::OFFSET_Y][i], field[LLParticlePool::OFFSET_Z][i]);
         }
 
+        part->mColor.set(field[LLParticlePool::COLOR_R][i], field[LLParticlePool::COLOR_G][i],
+                         field[LLParticlePool::COLOR_B][i], field[LLParticlePool::COLOR_A][i]);
+        part->mScale.set(field[LLParticlePool::SCALE_X][i], field[LLParticlePool::SCALE_Y][i]);
+
         // Do glow interpolation
+        const F32 frac = field[LLParticlePool::FRAC][i];
         part->mGlow.mV[3] = (U8) ll_round(lerp(part->mStartGlow, part->mEndGlow, frac)*255.f);
 
         // Set the last update time to now.
-        part->mLastUpdateTime = cur_time;
+        part->mLastUpdateTime = field[LLParticlePool::AGE][i];
 
-
-        // Kill dead particles (either flagged dead, or too old)
+        // Dead particles (either flagged dead, or too old), and the ones
+        // that left the group, are dealt with in finishUpdate()
         if ((part->mLastUpdateTime > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
         {
-            // <FS:Beq> FIRE-34600 - Bugsplat AVX2 particle count mismatch
-            // mParticles[i] = mParticles.back() ;
-            // mParticles.pop_back() ;
-            // delete part ;
-            vector_replace_with_last(mParticles, mParticles.begin() + i);
-            --LLViewerPartSim::sParticleCount; 
-            delete part ;
-            changed = true; 
-            // </FS:Beq>
+            mOutcomes[i] = PART_DEAD;
         }
         else
         {
-            F32 desired_size = calc_desired_size(camera, part->mPosAgent, part->mScale);
-            if (!posInGroup(part->mPosAgent, desired_size))
-            {
-                // Transfer particles between groups
-                // <FS:Beq> FIRE-34600 - Bugsplat AVX2 particle count mismatch
-                // LLViewerPartSim::getInstance()->put(part) ;
-                // mParticles[i] = mParticles.back() ;
-                // mParticles.pop_back() ;                
-                vector_replace_with_last(mParticles, mParticles.begin() + i); 
-                LLViewerPartSim::getInstance()->put(part) ; 
-                // Note: put() uses addpart when succesful, this increase sParticleCount by 1
-                // even though it has stayed the same. If it is not succesful then we need to decrease by 1
-                // so a decrement here works for both cases.
-                --LLViewerPartSim::sParticleCount; 
-                changed = true;
-                // </FS:Beq>
-            }
-            else
-            {
-                i++ ;
-            }
+            F32 desired_size = calc_desired_size(mCameraOrigin, part->mPosAgent, part->mScale);
+            mOutcomes[i] = posInGroup(part->mPosAgent, desired_size) ? PART_KEEP : PART_MOVE;
         }
     }
+}
+
+void LLViewerPartGroup::finishUpdate()
+{
+    LLViewerPartSim::checkParticleCount(static_cast<U32>(mParticles.size()));
+
+    // Particles moved in from other groups since simulate() stay
+    mOutcomes.resize(mParticles.size(), PART_KEEP);
+
+    bool changed = false;
+    for (S32 i = 0 ; i < (S32)mParticles.size();)
+    {
+        LLViewerPart* part = mParticles[i];
+        const U8 outcome = mOutcomes[i];
+        if (outcome == PART_KEEP)
+        {
+            i++;
+            continue;
+        }
+
+        vector_replace_with_last(mParticles, mParticles.begin() + i);
+        vector_replace_with_last(mOutcomes, mOutcomes.begin() + i);
+        if (part->mVPCallback)
+        {
+            --mCallbackCount;
+        }
+        if (outcome == PART_DEAD)
+        {
+            --LLViewerPartSim::sParticleCount;
+            delete part;
+        }
+        else
+        {
+            // Transfer particles between groups
+            LLViewerPartSim::getInstance()->put(part);
+            // Note: put() uses addpart when succesful, this increase sParticleCount by 1
+            // even though it has stayed the same. If it is not succesful then we need to decrease by 1
+            // so a decrement here works for both cases.
+            --LLViewerPartSim::sParticleCount;
+        }
+        changed = true;
+    }
+    mOutcomes.clear();
 
-    // <FS:Beq> FIRE-34600 - Bugsplat AVX2 particle count mismatch
-    // S32 removed = end - (S32)mParticles.size();
-    // if (removed > 0)
-    // {
-    //     // we removed one or more particles, so flag this group for update
-    //     if (mVOPartGroupp.notNull())
-    //     {
-    //         gPipeline.markRebuild(mVOPartGroupp->mDrawable, LLDrawable::REBUILD_ALL);
-    //     }
-    //     LLViewerPartSim::decPartCount(removed);
-    // }    
     if (changed)
     {
         if (mVOPartGroupp.notNull())
@@ -456,7 +621,6 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
             gPipeline.markRebuild(mVOPartGroupp->mDrawable, LLDrawable::REBUILD_ALL);
         }
     }
-    // </FS:Beq>
 
     // Kill the viewer object if this particle group is empty
     if (mParticles.empty())
@@ -467,6 +631,7 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 
     LLViewerPartSim::checkParticleCount() ;
 }
+// </FS>
 
 
 void LLViewerPartGroup::shift(const LLVector3 &offset)
@@ -542,6 +707,7 @@ void LLViewerPartSim::checkParticleCount(U32 size)
 }
 
 LLViewerPartSim::LLViewerPartSim()
+:   mGroupUpdates("PartSim") // <FS/> Particle groups simulated on a thread pool
 {
     sMaxParticleCount = llmin(gSavedSettings.getS32("RenderMaxPartCount"), LL_MAX_PARTICLE_COUNT);
     static U32 id_seed = 0;
@@ -805,6 +971,13 @@ void LLViewerPartSim::updateSimulation()
         num_updates++;
     }
 
+    // <FS> The groups due this frame are prepared here, simulated side by
+    // side on mGroupUpdates, then finished one after the other
+    static LLCachedControl<bool> parallel_groups(gSavedSettings, "FSParallelParticleGroups", false);
+    const LLVector3 camera_origin = LLViewerCamera::getInstance()->getOrigin();
+    mDueGroups.clear();
+    // </FS>
+
     count = (S32) mViewerPartGroups.size();
     for (i = 0; i < count; i++)
     {
@@ -828,15 +1001,19 @@ void LLViewerPartSim::updateSimulation()
             {
                 gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_ALL);
             }
-            mViewerPartGroups[i]->updateParticles(dt * visirate);
-            mViewerPartGroups[i]->mSkippedTime=0.0f;
-            if (!mViewerPartGroups[i]->getCount())
-            {
-                delete mViewerPartGroups[i];
-                mViewerPartGroups.erase(mViewerPartGroups.begin() + i);
-                i--;
-                count--;
-            }
+            // <FS> Particles in structure of arrays
+            //mViewerPartGroups[i]->updateParticles(dt * visirate);
+            //mViewerPartGroups[i]->mSkippedTime=0.0f;
+            //if (!mViewerPartGroups[i]->getCount())
+            //{
+            //    delete mViewerPartGroups[i];
+            //    mViewerPartGroups.erase(mViewerPartGroups.begin() + i);
+            //    i--;
+            //    count--;
+            //}
+            mViewerPartGroups[i]->prepareUpdate(dt * visirate, camera_origin);
+            mDueGroups.push_back(mViewerPartGroups[i]);
+            // </FS>
         }
         else
         {
@@ -844,6 +1021,28 @@ void LLViewerPartSim::updateSimulation()
         }
 
     }
+    // <FS> Each group only touches its own particles in simulate()
+    for (LLViewerPartGroup* groupp : mDueGroups)
+    {
+        mGroupUpdates.add([groupp]() { groupp->simulate(); });
+    }
+    mGroupUpdates.run(parallel_groups);
+
+    // A group emptied by finishUpdate() goes at once, before the next ones
+    // move particles into it
+    for (LLViewerPartGroup* groupp : mDueGroups)
+    {
+        groupp->finishUpdate();
+        groupp->mSkippedTime = 0.0f;
+        if (!groupp->getCount())
+        {
+            mViewerPartGroups.erase(std::find(mViewerPartGroups.begin(), mViewerPartGroups.end(), groupp));
+            delete groupp;
+        }
+    }
+    mDueGroups.clear();
+    // </FS>
+
     if (LLDrawable::getCurrentFrame()%16==0)
     {
         if (sParticleCount > sMaxParticleCount * 0.875f
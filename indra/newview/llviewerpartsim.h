@@ -31,6 +31,10 @@
 #include "llpointer.h"
 #include "llpartdata.h"
 #include "llviewerpartsource.h"
+// <FS> Particle groups simulated in structure of arrays, on a thread pool
+#include "llforkjoin.h"
+#include "llparticlepool.h"
+// </FS>
 
 class LLViewerTexture;
 class LLViewerPart;
@@ -56,6 +60,12 @@ public:
 
     void init(LLPointer<LLViewerPartSource> sourcep, LLViewerTexture *imagep, LLVPCallback cb);
 
+    // <FS> Particles come and go by the thousands, they are recycled
+    // through a free list rather than the heap
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+    // </FS>
+
 
     U32                 mPartID;                    // Particle ID used primarily for moving between groups
     F32                 mLastUpdateTime;            // Last time the particle was updated
@@ -99,6 +109,16 @@ public:
 
     void updateParticles(const F32 lastdt);
 
+    // <FS> updateParticles() in three steps, so that groups can be simulated
+    // side by side: prepareUpdate() runs the particle callbacks, which look
+    // at the world, simulate() only touches the particles of this group and
+    // can run on any thread, and finishUpdate() kills the dead particles
+    // and moves the ones that left the group.
+    void prepareUpdate(const F32 lastdt, const LLVector3& camera_origin);
+    void simulate();
+    void finishUpdate();
+    // </FS>
+
     bool posInGroup(const LLVector3 &pos, const F32 desired_size = -1.f);
 
     void shift(const LLVector3 &offset);
@@ -131,6 +151,21 @@ protected:
     LLVector3 mMaxObjPos;
 
     LLViewerRegion *mRegionp;
+
+    // <FS> Particles in structure of arrays
+    enum EPartOutcome
+    {
+        PART_KEEP,
+        PART_DEAD,
+        PART_MOVE       // left the group
+    };
+
+    LLParticlePool      mPool;
+    std::vector<U8>     mOutcomes;              // EPartOutcome of each particle after simulate()
+    S32                 mCallbackCount;         // particles with an mVPCallback
+    F32                 mUpdateDt;
+    LLVector3           mCameraOrigin;
+    // </FS>
 };
 
 class LLViewerPartSim : public LLSingleton<LLViewerPartSim>
@@ -196,6 +231,11 @@ protected:
     source_list_t mViewerPartSources;
     LLFrameTimer mSimulationTimer;
 
+    // <FS> Groups due for an update this frame, simulated on mGroupUpdates
+    group_list_t mDueGroups;
+    LLForkJoin mGroupUpdates;
+    // </FS>
+
     static S32 sMaxParticleCount;
     static std::atomic<S32> sParticleCount; // <FS:Beq/> FIRE-34600 - bugsplat AVX2 particle count mismatch
     static F32 sParticleAdaptiveRate;
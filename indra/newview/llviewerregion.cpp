@@ -219,6 +219,7 @@ public:
     LLVLComposition *mCompositionp;     // Composition layer for the surface
 
     LLVOCacheEntry::vocache_entry_map_t   mCacheMap; //all cached entries
+    LLPointer<LLVOCacheMappedFile>        mMappedCacheFile; //cached entries not loaded into mCacheMap yet
     LLVOCacheEntry::vocache_entry_set_t   mActiveSet; //all active entries;
     LLVOCacheEntry::vocache_entry_set_t   mWaitingSet; //entries waiting for LLDrawable to be generated.
     std::set< LLPointer<LLViewerOctreeGroup> >      mVisibleGroups; //visible groupa
@@ -844,10 +845,10 @@ void LLViewerRegion::loadObjectCache()
     {
         LLVOCache & vocache = LLVOCache::instance();
         // Without this a "corrupted" vocache persists until a cache clear or other rewrite. Mark as dirty hereif read fails to force a rewrite.
-        mCacheDirty = !vocache.readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap);
-        vocache.readGenericExtrasFromCache(mHandle, mImpl->mCacheID, mImpl->mGLTFOverridesLLSD, mImpl->mCacheMap);
+        mCacheDirty = !vocache.readFromCache(mHandle, mImpl->mCacheID, mImpl->mMappedCacheFile);
+        vocache.readGenericExtrasFromCache(mHandle, mImpl->mCacheID, mImpl->mGLTFOverridesLLSD, mImpl->mCacheMap, mImpl->mMappedCacheFile);
 
-        if (mImpl->mCacheMap.empty())
+        if (isCacheEmpty())
         {
             mCacheDirty = true;
         }
@@ -862,7 +863,7 @@ void LLViewerRegion::saveObjectCache()
         return;
     }
 
-    if (mImpl->mCacheMap.empty())
+    if (isCacheEmpty())
     {
         return;
     }
@@ -874,10 +875,11 @@ void LLViewerRegion::saveObjectCache()
 
         LLVOCache & instance = LLVOCache::instance();
 
-        instance.writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty, removal_enabled);
+        instance.writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mImpl->mMappedCacheFile, mCacheDirty, removal_enabled);
         instance.writeGenericExtrasToCache(mHandle, mImpl->mCacheID, mImpl->mGLTFOverridesLLSD, mCacheDirty, removal_enabled);
         mCacheDirty = false;
     }
+    mImpl->mMappedCacheFile = NULL;
 
     if (LLAppViewer::instance()->isQuitting())
     {
@@ -1693,7 +1695,7 @@ void LLViewerRegion::lightIdleUpdate()
     {
         return;
     }
-    if(mImpl->mCacheMap.empty())
+    if(isCacheEmpty())
     {
         return;
     }
@@ -1734,7 +1736,7 @@ void LLViewerRegion::idleUpdate(F32 max_update_time)
     {
         return;
     }
-    if(mImpl->mCacheMap.empty())
+    if(isCacheEmpty())
     {
         return;
     }
@@ -2756,7 +2758,10 @@ void LLViewerRegion::findOrphans(U32 parent_id)
     }
 }
 
-void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
+// <FS>
+//void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
+void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry, const LLObjectUpdatePipeline::Record* decoded)
+// </FS>
 {
     if(!sVOCacheCullingEnabled)
     {
@@ -2793,7 +2798,14 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
         //set parent id
         U32 parent_id = 0;
-        if (entry->getDP()) // NULL if nothing cached
+        // <FS>
+        //if (entry->getDP()) // NULL if nothing cached
+        if (decoded && decoded->mHasExtents)
+        {
+            parent_id = decoded->mParentID;
+        }
+        else if (entry->getDP()) // NULL if nothing cached
+        // </FS>
         {
             LLViewerObject::unpackParentID(entry->getDP(), parent_id);
         }
@@ -2816,7 +2828,20 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
     LLQuaternion rot;
 
     //decode spatial info and parent info
-    U32 parent_id = entry->getDP() ? LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot) : entry->getParentID();
+    // <FS>
+    //U32 parent_id = entry->getDP() ? LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot) : entry->getParentID();
+    U32 parent_id;
+    if (decoded && decoded->mHasExtents)
+    {
+        parent_id = decoded->mParentID;
+        pos = decoded->mPosition;
+        scale = decoded->mScale;
+    }
+    else
+    {
+        parent_id = entry->getDP() ? LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot) : entry->getParentID();
+    }
+    // </FS>
 
     U32 old_parent_id = entry->getParentID();
     bool same_old_parent = false;
@@ -2926,13 +2951,28 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
 LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags)
 {
-    eCacheUpdateResult result;
+    // <FS>
+    //eCacheUpdateResult result;
     U32 crc;
     U32 local_id;
 
     LLViewerObject::unpackU32(&dp, local_id, "LocalID");
     LLViewerObject::unpackU32(&dp, crc, "CRC");
 
+    return cacheFullUpdate(dp, flags, local_id, crc, NULL);
+}
+
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, const LLObjectUpdatePipeline::Record& record)
+{
+    return cacheFullUpdate(dp, record.mFlags, record.mLocalID, record.mCRC, &record);
+}
+
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags, U32 local_id, U32 crc,
+                                                                   const LLObjectUpdatePipeline::Record* decoded)
+{
+    eCacheUpdateResult result;
+    // </FS>
+
     LLVOCacheEntry* entry = getCacheEntry(local_id, false);
 
     if (entry)
@@ -2955,7 +2995,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
             // Update the cache entry
             entry->updateEntry(crc, dp);
 
-            decodeBoundingInfo(entry);
+            decodeBoundingInfo(entry, decoded); // <FS/>
 
             result = CACHE_UPDATE_CHANGED;
         }
@@ -2972,7 +3012,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 
         mImpl->mCacheMap[local_id] = entry;
 
-        decodeBoundingInfo(entry);
+        decodeBoundingInfo(entry, decoded); // <FS/>
     }
     entry->setUpdateFlags(flags);
 
@@ -3022,9 +3062,27 @@ LLVOCacheEntry* LLViewerRegion::getCacheEntry(U32 local_id, bool valid)
             return iter->second;
         }
     }
+    else if(mImpl->mMappedCacheFile.notNull())
+    {
+        // loaded from the cache file on first use, never valid yet
+        LLPointer<LLVOCacheEntry> entry = mImpl->mMappedCacheFile->takeEntry(local_id);
+        if(entry.notNull())
+        {
+            mImpl->mCacheMap[local_id] = entry;
+            if(!valid)
+            {
+                return entry;
+            }
+        }
+    }
     return NULL;
 }
 
+bool LLViewerRegion::isCacheEmpty() const
+{
+    return mImpl->mCacheMap.empty() && (mImpl->mMappedCacheFile.isNull() || mImpl->mMappedCacheFile->isEmpty());
+}
+
 void LLViewerRegion::addCacheMiss(U32 id, LLViewerRegion::eCacheMissType cache_miss_type)
 {
     mRegionCacheMissCount++;
@@ -3222,6 +3280,10 @@ void LLViewerRegion::dumpCache()
     }
 
     LL_INFOS() << "Count " << mImpl->mCacheMap.size() << LL_ENDL;
+    if (mImpl->mMappedCacheFile.notNull())
+    {
+        LL_INFOS() << "Not loaded " << mImpl->mMappedCacheFile->getOffsets().size() << LL_ENDL;
+    }
     for (i = 0; i < BINS; i++)
     {
         LL_INFOS() << "Hits " << i << " " << hit_bin[i] << LL_ENDL;
@@ -3236,6 +3298,7 @@ void LLViewerRegion::dumpCache()
 void LLViewerRegion::clearVOCacheFromMemory()
 {
     mImpl->mCacheMap.clear();
+    mImpl->mMappedCacheFile = NULL;
 }
 
 void LLViewerRegion::unpackRegionHandshake()
@@ -3443,7 +3506,7 @@ void LLViewerRegion::unpackRegionHandshake()
     {
         flags |= 0x00000001; //set the bit 0 to be 1 to ask sim to send all cacheable objects.
     }
-    if(mImpl->mCacheMap.empty())
+    if(isCacheEmpty())
     {
         flags |= 0x00000002; //set the bit 1 to be 1 to tell sim the cache file is empty, no need to send cache probes.
     }
@@ -44,6 +44,7 @@
 #include "llframetimer.h"
 #include "llreflectionmap.h"
 #include "llpointer.h"
+#include "llobjectupdatepipeline.h" // <FS/>
 
 // Surface id's
 #define LAND  1
@@ -403,11 +404,15 @@ public:
     // handle a full update message
     eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags);
     eCacheUpdateResult cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags);
+    // <FS> with the ids and extents already decoded by LLObjectUpdatePipeline
+    eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, const LLObjectUpdatePipeline::Record& record);
+    // </FS>
 
     void cacheFullUpdateGLTFOverride(const LLGLTFOverrideCacheEntry &override_data);
 
     LLVOCacheEntry* getCacheEntryForOctree(U32 local_id);
     LLVOCacheEntry* getCacheEntry(U32 local_id, bool valid = true);
+    bool isCacheEmpty() const; // neither loaded nor still in the cache file
     bool probeCache(U32 local_id, U32 crc, U32 flags, U8 &cache_miss_type);
     U64 getRegionCacheHitCount() { return mRegionCacheHitCount; }
     U64 getRegionCacheMissCount() { return mRegionCacheMissCount; }
@@ -474,7 +479,12 @@ private:
     void updateVisibleEntries(F32 max_time); //update visible entries
 
     void addCacheMiss(U32 id, LLViewerRegion::eCacheMissType miss_type);
-    void decodeBoundingInfo(LLVOCacheEntry* entry);
+    // <FS>
+    //void decodeBoundingInfo(LLVOCacheEntry* entry);
+    void decodeBoundingInfo(LLVOCacheEntry* entry, const LLObjectUpdatePipeline::Record* decoded = NULL);
+    eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags, U32 local_id, U32 crc,
+                                       const LLObjectUpdatePipeline::Record* decoded);
+    // </FS>
     bool isNonCacheableObjectCreated(U32 local_id);
 
 public:
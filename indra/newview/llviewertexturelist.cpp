@@ -62,6 +62,8 @@
 #include "llviewerdisplay.h"
 #include "llviewerwindow.h"
 #include "llprogressview.h"
+#include "llface.h" // <FS/>
+#include "llforkjoin.h" // <FS/>
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -299,6 +301,10 @@ void LLViewerTextureList::shutdown()
     // clear out preloads
     mImagePreloads.clear();
 
+    // <FS> Virtual size pass
+    mVirtualSizeUpdates.reset();
+    // </FS>
+
     // Write out list of currently loaded textures for precaching on startup
     typedef std::set<std::pair<S32,LLViewerFetchedTexture*> > image_area_list_t;
     image_area_list_t image_area_list;
@@ -924,7 +930,216 @@ void LLViewerTextureList::clearFetchingRequests()
 
 extern bool gCubeSnapshot;
 
-void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool flush_images)
+// <FS> Cost of the virtual size pass of updateImagesFetchTextures()
+static LLTrace::SampleStatHandle<F64Milliseconds> sVirtualSizePassTime("texturevirtualsizetime", "Time of the texture virtual size pass in a frame");
+static LLTrace::SampleStatHandle<> sVirtualSizePassFaces("texturevirtualsizefaces", "Faces the texture virtual size pass looked at in a frame");
+static LLTrace::SampleStatHandle<> sVirtualSizePassAreas("texturevirtualsizeareas", "Face pixel areas the texture virtual size pass computed in a frame");
+
+// faces of pixel areas and textures of virtual sizes per job of the pass
+static const S32 VIRTUAL_SIZE_FACES_PER_JOB = 256;
+static const S32 VIRTUAL_SIZE_TEXTURES_PER_JOB = 64;
+// textures per pass, between which updateImagesFetchTextures() checks its time
+static const size_t VIRTUAL_SIZE_TEXTURES_PER_PASS = 128;
+
+// Faces of that many textures or more are not checked, see updateImageDecodePriority()
+static const U32 MAX_FACES_TO_CHECK = 1024;
+
+void LLViewerTextureList::computeVirtualSizes(const std::vector<LLPointer<LLViewerFetchedTexture> >& textures, size_t first, size_t last)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    LLTimer timer;
+
+    static LLCachedControl<F32> texture_scale_min(gSavedSettings, "TextureScaleMinAreaFactor", 0.0095f);
+    static LLCachedControl<F32> texture_scale_max(gSavedSettings, "TextureScaleMaxAreaFactor", 25.f);
+    static LLCachedControl<F32> texture_camera_boost(gSavedSettings, "TextureCameraBoost", 8.f);
+    static LLCachedControl<bool> parallel_pass(gSavedSettings, "FSParallelTextureVirtualSize", false);
+
+    // a new pass number tells the faces gathered by the last one apart
+    if (++mVirtualSizePass == 0)
+    {
+        ++mVirtualSizePass;
+    }
+    mFaces.clear();
+    mFacePixelAreas.clear();
+    mFaceImportances.clear();
+    mFaceMinScales.clear();
+    mFaceInFrustum.clear();
+    mSphereFaces.clear();
+    mSpheres.clear();
+    mSphereBoundingRadii.clear();
+    mTextureFaces.clear();
+    mTextureFaceStarts.clear();
+    mTextureBiases.clear();
+    mVirtualSizes.assign(last - first, TextureVirtualSize());
+
+    // Gather on this thread: the faces hang off their objects and drawables,
+    // and the rigged and media ones need calcPixelArea() as it is
+    for (size_t t = 0; t < last - first; ++t)
+    {
+        LLViewerFetchedTexture* imagep = textures[first + t];
+        mTextureFaceStarts.push_back((U32)mTextureFaces.size());
+
+        // see updateImageDecodePriority()
+        LLImageGL* img = imagep->getGLTexture();
+        F32 max_discard = F32(img ? img->getMaxDiscardLevel() : MAX_DISCARD_LEVEL);
+        F32 bias = llclamp(max_discard - 2.f, 1.f, LLViewerTexture::sDesiredDiscardBias);
+        mTextureBiases.push_back((F32)llroundf(powf(4, bias - 1.f)));
+
+        if (imagep->getNumRefs() <= 1 || imagep->getBoostLevel() >= LLViewerFetchedTexture::BOOST_HIGH)
+        {
+            continue;
+        }
+        TextureVirtualSize& vsize = mVirtualSizes[t];
+        vsize.mComputed = true;
+
+        for (U32 i = 0; i < LLRender::NUM_TEXTURE_CHANNELS; ++i)
+        {
+            vsize.mFaceCount += imagep->getNumFaces(i);
+            S32 faces_to_check = (vsize.mFaceCount > MAX_FACES_TO_CHECK) ? 0 : imagep->getNumFaces(i);
+
+            for (S32 fi = 0; fi < faces_to_check; ++fi)
+            {
+                LLFace* face = (*(imagep->getFaceList(i)))[fi];
+                if (!face || !face->getViewerObject())
+                {
+                    continue;
+                }
+
+                // a face with several textures is gathered once
+                if (face->mVirtualSizePass == mVirtualSizePass)
+                {
+                    mTextureFaces.push_back(face->mVirtualSizeIndex);
+                    continue;
+                }
+                const U32 index = (U32)mFaces.size();
+                face->mVirtualSizePass = mVirtualSizePass;
+                face->mVirtualSizeIndex = index;
+                mTextureFaces.push_back(index);
+                mFaces.push_back(face);
+
+                if ((gFrameCount - face->mLastTextureUpdate) > 10)
+                { // only update the pixel area at most once every 10 frames for a given face
+                    LLVector4a sphere;
+                    switch (face->getPixelAreaUpdate(sphere))
+                    {
+                    case LLFace::PIXEL_AREA_SPHERE:
+                        mSphereFaces.push_back(index);
+                        mSpheres.push_back(sphere);
+                        mSphereBoundingRadii.push_back(face->mBoundingSphereRadius);
+                        face->mInFrustum = true;
+                        break;
+                    case LLFace::PIXEL_AREA_CALC:
+                        {
+                            F32 radius;
+                            F32 cos_angle_to_view_dir;
+                            face->mInFrustum = face->calcPixelArea(cos_angle_to_view_dir, radius);
+                        }
+                        break;
+                    default:
+                        face->mInFrustum = true;
+                        break;
+                    }
+                    face->mLastTextureUpdate = gFrameCount;
+                }
+
+                // the sphere faces get theirs below
+                mFacePixelAreas.push_back(face->getPixelArea());
+                mFaceImportances.push_back(face->mImportanceToCamera);
+                mFaceInFrustum.push_back(face->mInFrustum);
+
+                // TODO: make this work with the GLTF texture transforms
+                S32 te_offset = face->getTEOffset();  // offset is -1 if not inited
+                LLViewerObject* objp = face->getViewerObject();
+                const LLTextureEntry* te = (te_offset < 0 || te_offset >= objp->getNumTEs()) ? nullptr : objp->getTE(te_offset);
+                F32 min_scale = te ? llmin(fabsf(te->getScaleS()), fabsf(te->getScaleT())) : 1.f;
+                mFaceMinScales.push_back(llclamp(min_scale * min_scale, texture_scale_min(), texture_scale_max()));
+            }
+        }
+    }
+    mTextureFaceStarts.push_back((U32)mTextureFaces.size());
+
+    if (!mVirtualSizeUpdates)
+    {
+        mVirtualSizeUpdates = std::make_unique<LLForkJoin>("TextureVSize");
+    }
+
+    // Pixel areas of the spheres, in jobs of consecutive faces
+    const S32 sphere_count = (S32)mSpheres.size();
+    mSpherePixelAreas.resize(sphere_count);
+    mSphereImportances.resize(sphere_count);
+    LLFace::PixelAreaCamera camera;
+    LLFace::getPixelAreaCamera(camera);
+    for (S32 first = 0; first < sphere_count; first += VIRTUAL_SIZE_FACES_PER_JOB)
+    {
+        const S32 count = llmin(VIRTUAL_SIZE_FACES_PER_JOB, sphere_count - first);
+        mVirtualSizeUpdates->add([this, &camera, first, count]()
+        {
+            LLFace::calcPixelAreas(camera, &mSpheres[first], &mSphereBoundingRadii[first], count,
+                                   &mSpherePixelAreas[first], &mSphereImportances[first]);
+        });
+    }
+    mVirtualSizeUpdates->run(parallel_pass);
+
+    for (S32 s = 0; s < sphere_count; ++s)
+    {
+        const U32 index = mSphereFaces[s];
+        mFacePixelAreas[index] = mSpherePixelAreas[s];
+        mFaceImportances[index] = mSphereImportances[s];
+        mFaces[index]->setPixelAreaUpdate(mSpherePixelAreas[s], mSphereImportances[s]);
+    }
+
+    // Largest virtual size of each texture, in jobs of consecutive textures
+    const S32 texture_count = (S32)mVirtualSizes.size();
+    const F32 discard_bias = LLViewerTexture::sDesiredDiscardBias;
+    const F32 camera_boost = texture_camera_boost();
+    const F32 max_virtual_size = LLViewerFetchedTexture::sMaxVirtualSize;
+    for (S32 job_first = 0; job_first < texture_count; job_first += VIRTUAL_SIZE_TEXTURES_PER_JOB)
+    {
+        const S32 job_last = llmin(job_first + VIRTUAL_SIZE_TEXTURES_PER_JOB, texture_count);
+        mVirtualSizeUpdates->add([this, job_first, job_last, discard_bias, camera_boost, max_virtual_size]()
+        {
+            for (S32 t = job_first; t < job_last; ++t)
+            {
+                TextureVirtualSize& vsize = mVirtualSizes[t];
+                const F32 bias = mTextureBiases[t];
+                for (U32 f = mTextureFaceStarts[t]; f < mTextureFaceStarts[t + 1]; ++f)
+                {
+                    const U32 index = mTextureFaces[f];
+                    const bool in_frustum = mFaceInFrustum[index];
+                    const F32 importance = mFaceImportances[index];
+
+                    // the virtual size updateImageDecodePriority() gives the face
+                    F32 face_vsize = mFacePixelAreas[index] / mFaceMinScales[index];
+                    if (!in_frustum || discard_bias > 1.9f + importance / 2.f)
+                    {
+                        face_vsize /= bias;
+                    }
+                    if (in_frustum)
+                    {
+                        face_vsize *= llmax(importance * camera_boost, 1.f);
+                    }
+
+                    vsize.mMaxVirtualSize = llmax(vsize.mMaxVirtualSize, face_vsize);
+                    vsize.mOnScreen |= in_frustum;
+
+                    // addTextureStats limits size to sMaxVirtualSize
+                    if (vsize.mMaxVirtualSize >= max_virtual_size && (vsize.mOnScreen || discard_bias <= 1.f))
+                    {
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    mVirtualSizeUpdates->run(parallel_pass);
+
+    LLTrace::sample(sVirtualSizePassTime, F64Seconds(timer.getElapsedTimeF64()));
+    LLTrace::sample(sVirtualSizePassFaces, (F64)mFaces.size());
+    LLTrace::sample(sVirtualSizePassAreas, (F64)sphere_count);
+}
+// </FS>
+
+void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool flush_images, const TextureVirtualSize* pass_vsize)
 {
     llassert(!gCubeSnapshot);
 
@@ -940,7 +1155,8 @@ void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imag
         bool on_screen = false;
 
         U32 face_count = 0;
-        U32 max_faces_to_check = 1024;
+        //U32 max_faces_to_check = 1024;
+        U32 max_faces_to_check = MAX_FACES_TO_CHECK; // <FS/> shared with computeVirtualSizes()
 
         // get adjusted bias based on image resolution
         LLImageGL* img = imagep->getGLTexture();
@@ -951,7 +1167,19 @@ void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imag
         bias = (F32) llroundf(powf(4, bias - 1.f));
 
         LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
-        for (U32 i = 0; i < LLRender::NUM_TEXTURE_CHANNELS; ++i)
+        // <FS> Computed by the virtual size pass of updateImagesFetchTextures(),
+        // there is no face to walk then
+        U32 channels_to_check = LLRender::NUM_TEXTURE_CHANNELS;
+        if (pass_vsize && pass_vsize->mComputed)
+        {
+            max_vsize = pass_vsize->mMaxVirtualSize;
+            on_screen = pass_vsize->mOnScreen;
+            face_count = pass_vsize->mFaceCount;
+            channels_to_check = 0;
+        }
+        // </FS>
+        //for (U32 i = 0; i < LLRender::NUM_TEXTURE_CHANNELS; ++i)
+        for (U32 i = 0; i < channels_to_check; ++i) // <FS/>
         {
             face_count += imagep->getNumFaces(i);
             S32 faces_to_check = (face_count > max_faces_to_check) ? 0 : imagep->getNumFaces(i);
@@ -1303,21 +1531,35 @@ F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
 
     LLTimer timer;
 
-    for (auto& imagep : entries)
+    // <FS> Virtual sizes of the entries in passes over a few of them at a
+    // time, so that max_time bounds the passes too, see computeVirtualSizes()
+    //for (auto& imagep : entries)
+    bool out_of_time = false;
+    for (size_t first = 0; first < entries.size() && !out_of_time; first += VIRTUAL_SIZE_TEXTURES_PER_PASS)
     {
-        mLastUpdateKey = LLTextureKey(imagep->getID(), (ETexListType)imagep->getTextureListType());
+        const size_t last = llmin(first + VIRTUAL_SIZE_TEXTURES_PER_PASS, entries.size());
+        computeVirtualSizes(entries, first, last);
 
-        if (imagep->getNumRefs() > 1) // make sure this image hasn't been deleted before attempting to update (may happen as a side effect of some other image updating)
+        for (size_t i = first; i < last; ++i)
         {
-            updateImageDecodePriority(imagep);
-            imagep->updateFetch();
-        }
+            LLViewerFetchedTexture* imagep = entries[i];
+    // </FS>
+            mLastUpdateKey = LLTextureKey(imagep->getID(), (ETexListType)imagep->getTextureListType());
 
-        if (timer.getElapsedTimeF32() > max_time)
-        {
-            break;
+            if (imagep->getNumRefs() > 1) // make sure this image hasn't been deleted before attempting to update (may happen as a side effect of some other image updating)
+            {
+                //updateImageDecodePriority(imagep);
+                updateImageDecodePriority(imagep, true, &mVirtualSizes[i - first]); // <FS/>
+                imagep->updateFetch();
+            }
+
+            if (timer.getElapsedTimeF32() > max_time)
+            {
+                out_of_time = true; // <FS/>
+                break;
+            }
         }
-    }
+    } // <FS/>
 
     return timer.getElapsedTimeF32();
 }
@@ -50,6 +50,8 @@ const bool IMMEDIATE_NO = false;
 class LLImageJ2C;
 class LLMessageSystem;
 class LLTextureView;
+class LLFace; // <FS/>
+class LLForkJoin; // <FS/>
 
 typedef void (*LLImageCallback)(bool success,
                                 LLViewerFetchedTexture *src_vi,
@@ -145,15 +147,32 @@ public:
 
     void clearFetchingRequests();
 
+    // <FS> Largest virtual size of the faces of a texture, as the virtual
+    // size pass of updateImagesFetchTextures() computes it
+    struct TextureVirtualSize
+    {
+        F32     mMaxVirtualSize = 0.f;
+        U32     mFaceCount = 0;         // of all channels, checked or not
+        bool    mOnScreen = false;
+        bool    mComputed = false;      // false for boosted textures, which are not checked
+    };
+    // </FS>
+
     // do some book keeping on the specified texture
     // - updates decode priority
     // - updates desired discard level
     // - cleans up textures that haven't been referenced in awhile
-    void updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool flush_images = true);
+    // <FS> pass_vsize: from computeVirtualSizes(), instead of walking the faces
+    //void updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool flush_images = true);
+    void updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool flush_images = true, const TextureVirtualSize* pass_vsize = nullptr);
+    // </FS>
 
 private:
     F32  updateImagesCreateTextures(F32 max_time);
     F32  updateImagesFetchTextures(F32 max_time);
+    // <FS> Virtual size pass: fills mVirtualSizes for textures [first, last)
+    void computeVirtualSizes(const std::vector<LLPointer<LLViewerFetchedTexture> >& textures, size_t first, size_t last);
+    // </FS>
     void updateImagesUpdateStats();
     F32  updateImagesLoadingFastCache(F32 max_time);
 
@@ -248,6 +267,29 @@ private:
     bool mInitialized ;
     LLFrameTimer mForceDecodeTimer;
 
+    // <FS> The virtual size pass, in arrays kept from frame to frame.
+    // The faces of the textures due for an update, once each:
+    std::vector<LLFace*>                    mFaces;
+    std::vector<F32>                        mFacePixelAreas;
+    std::vector<F32>                        mFaceImportances;
+    std::vector<F32>                        mFaceMinScales;     // texture scale, squared and clamped
+    std::vector<U8>                         mFaceInFrustum;
+    // the ones whose pixel area is computed on the pool, and their inputs
+    std::vector<U32>                        mSphereFaces;       // index in mFaces
+    std::vector<LLVector4a>                 mSpheres;           // LLFace::getPixelAreaUpdate()
+    std::vector<F32>                        mSphereBoundingRadii;
+    std::vector<F32>                        mSpherePixelAreas;
+    std::vector<F32>                        mSphereImportances;
+    // the faces of texture i are mTextureFaces[mTextureFaceStarts[i]] up to
+    // mTextureFaces[mTextureFaceStarts[i + 1]], indices in mFaces
+    std::vector<U32>                        mTextureFaces;
+    std::vector<U32>                        mTextureFaceStarts;
+    std::vector<F32>                        mTextureBiases;
+    std::vector<TextureVirtualSize>         mVirtualSizes;      // of textures first + i of the pass
+    U32                                     mVirtualSizePass = 0;
+    std::unique_ptr<LLForkJoin>             mVirtualSizeUpdates;
+    // </FS>
+
 private:
     static S32 sNumImages;
     static void (*sUUIDCallback)(void**, const LLUUID &);
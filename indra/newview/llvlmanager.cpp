@@ -35,6 +35,8 @@
 #include "llframetimer.h"
 #include "llsurface.h"
 #include "llbitpack.h"
+#include "llviewercontrol.h" // <FS/> FSTerrainThreadedDecode
+#include "workqueue.h" // <FS/> Land layers decoded on the General thread pool
 
 const   char    LAND_LAYER_CODE                 = 'L';
 const   char    WIND_LAYER_CODE                 = '7';
@@ -69,6 +71,23 @@ void LLVLManager::addLayerData(LLVLData *vl_datap, const S32Bytes mesg_size)
 // </FS:CR> Aurora Sim
     {
         mLandBits += mesg_size;
+
+        // <FS> Decoded on the General thread pool, unpackData() applies the
+        // layer once it is done, or decodes it itself if no worker got to it
+        static LLCachedControl<bool> threaded_decode(gSavedSettings, "FSTerrainThreadedDecode", true);
+        if (threaded_decode)
+        {
+            std::shared_ptr<LLVLData::LandDecode> decode = std::make_shared<LLVLData::LandDecode>(
+                vl_datap->mData, vl_datap->mSize, AURORA_LAND_LAYER_CODE == vl_datap->mType);
+            vl_datap->mLandDecode = decode;
+
+            LL::WorkQueue::ptr_t worker = LL::WorkQueue::getInstance("General");
+            if (worker && !worker->isClosed())
+            {
+                worker->tryPost([decode]() { decode->decode(); });
+            }
+        }
+        // </FS>
     }
 // <FS:CR> Aurora Sim
     //else if (WIND_LAYER_CODE == vl_datap->mType)
@@ -107,6 +126,23 @@ void LLVLManager::unpackData(const S32 num_packets)
     {
         LLVLData *datap = mPacketData[i];
 
+        // <FS> Layers are applied in the order they came in: stop at a land
+        // layer that a worker is still decoding, and pick up from there on
+        // the next frame
+        if (datap->mLandDecode)
+        {
+            if (!datap->mLandDecode->decode())
+            {
+                break;
+            }
+            if (datap->mLandDecode->isValid())
+            {
+                datap->mRegionp->getLand().applyDCTPatches(datap->mLandDecode->getLayer());
+                continue;
+            }
+        }
+        // </FS>
+
         LLBitPack bit_pack(datap->mData, datap->mSize);
         LLGroupHeader goph;
 
@@ -140,12 +176,18 @@ void LLVLManager::unpackData(const S32 num_packets)
         }
     }
 
-    for (i = 0; i < mPacketData.size(); i++)
+    // <FS> Only the layers applied above
+    //for (i = 0; i < mPacketData.size(); i++)
+    //{
+    //    delete mPacketData[i];
+    //}
+    //mPacketData.clear();
+    for (S32 applied = 0; applied < i; applied++)
     {
-        delete mPacketData[i];
+        delete mPacketData[applied];
     }
-    mPacketData.clear();
-
+    mPacketData.erase(mPacketData.begin(), mPacketData.begin() + i);
+    // </FS>
 }
 
 void LLVLManager::resetBitCounts()
@@ -204,3 +246,26 @@ LLVLData::~LLVLData()
     mData = NULL;
     mRegionp = NULL;
 }
+
+// <FS> Land layers decoded on the General thread pool
+LLVLData::LandDecode::LandDecode(const U8* data, S32 size, bool b_large_patch)
+:   mData(data, data + llmax(size, 0)),
+    mLargePatch(b_large_patch),
+    mValid(false),
+    mState(QUEUED)
+{
+}
+
+bool LLVLData::LandDecode::decode()
+{
+    U32 expected = QUEUED;
+    if (mState.compare_exchange_strong(expected, DECODING, std::memory_order_acq_rel))
+    {
+        LL_PROFILE_ZONE_SCOPED;
+        mValid = mLayer.decode(mData.data(), (S32)mData.size(), mLargePatch);
+        mState.store(DECODED, std::memory_order_release);
+        return true;
+    }
+    return mState.load(std::memory_order_acquire) == DECODED;
+}
+// </FS>
@@ -30,6 +30,12 @@
 // This class manages the data coming in for viewer layers from the network.
 
 #include "stdtypes.h"
+// <FS> Land layers decoded on the General thread pool
+#include "llpatchlayer.h"
+
+#include <atomic>
+#include <memory>
+// </FS>
 
 class LLVLData;
 class LLViewerRegion;
@@ -74,6 +80,34 @@ public:
     U8 *mData;
     S32 mSize;
     LLViewerRegion *mRegionp;
+
+    // <FS> A land layer, decoded by a worker or by whichever of it and the
+    // main thread gets to it first. It owns a copy of the data, since the
+    // packet may be dropped with its region while a worker is at it.
+    class LandDecode
+    {
+    public:
+        LandDecode(const U8* data, S32 size, bool b_large_patch);
+
+        // Returns true once the layer is decoded, false while a worker is
+        // still decoding it
+        bool decode();
+
+        // false when decode() left the layer to LLSurface::decompressDCTPatch()
+        bool isValid() const { return mValid; }
+        const LLPatchLayer& getLayer() const { return mLayer; }
+
+    private:
+        enum { QUEUED, DECODING, DECODED };
+
+        std::vector<U8>     mData;
+        bool                mLargePatch;
+        bool                mValid;
+        LLPatchLayer        mLayer;
+        std::atomic<U32>    mState;
+    };
+    std::shared_ptr<LandDecode> mLandDecode;
+    // </FS>
 };
 
 extern LLVLManager gVLManager;
@@ -656,6 +656,10 @@ F32 LLVOAvatar::sGreyUpdateTime = 0.f;
 LLPointer<LLViewerTexture> LLVOAvatar::sCloudTexture = NULL;
 std::vector<LLUUID> LLVOAvatar::sAVsIgnoringARTLimit;
 S32 LLVOAvatar::sAvatarsNearby = 0;
+// <FS> Parallel pose update
+std::unique_ptr<LLForkJoin> LLVOAvatar::sPoseUpdate;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sDeferredPoseAvatars;
+// </FS>
 
 //-----------------------------------------------------------------------------
 // Helper functions
@@ -714,6 +718,8 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
     mCulled( false ),
     mVisibilityRank(0),
     mNeedsSkin(false),
+    mPoseDeferred(false), // <FS/> Parallel pose update
+    mDeferredDetailedUpdate(false), // <FS/> Parallel pose update
     mLastSkinTime(0.f),
     mUpdatePeriod(1),
     mOverallAppearance(AOA_INVISIBLE),
@@ -1287,11 +1293,17 @@ void LLVOAvatar::initClass()
     sCloudTexture = LLViewerTextureManager::getFetchedTextureFromFile("cloud-particle.j2c");
 
     initCloud();
+
+    sPoseUpdate = std::make_unique<LLForkJoin>("AvatarPose"); // <FS/> Parallel pose update
 }
 
 
 void LLVOAvatar::cleanupClass()
 {
+    // <FS> Parallel pose update
+    sDeferredPoseAvatars.clear();
+    sPoseUpdate.reset();
+    // </FS>
 }
 
 LLPartSysData LLVOAvatar::sCloud;
@@ -3209,6 +3221,23 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     mLastRootPos = mRoot->getWorldPosition();
     bool detailed_update = updateCharacter(agent);
 
+    // <FS> Parallel pose update
+    if (mPoseDeferred)
+    {
+        // the rest wants this frame's joints, see updateDeferredPoses()
+        mDeferredDetailedUpdate = detailed_update;
+        return;
+    }
+    idleUpdateAfterCharacter(detailed_update);
+}
+
+//------------------------------------------------------------------------
+// idleUpdateAfterCharacter()
+// The part of idleUpdate() that needs the joints updated
+//------------------------------------------------------------------------
+void LLVOAvatar::idleUpdateAfterCharacter(bool detailed_update)
+{
+    // </FS>
     static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
     bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
                          LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -3266,6 +3295,38 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     idleUpdateDebugInfo();
 }
 
+// <FS> Parallel pose update
+//------------------------------------------------------------------------
+// updateDeferredPoses()
+//------------------------------------------------------------------------
+// static
+void LLVOAvatar::updateDeferredPoses()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (sDeferredPoseAvatars.empty())
+    {
+        return;
+    }
+
+    // Only the avatars computeNeedsUpdate() picked for this frame are here:
+    // impostors come in once per update period, spread over the frames.
+    sPoseUpdate->run();
+
+    for (LLVOAvatar* avatar : sDeferredPoseAvatars)
+    {
+        avatar->mPoseDeferred = false;
+        if (!avatar->isDead())
+        {
+            // what updateCharacter() left for after the pose
+            avatar->updateHeadOffset();
+            avatar->updateFootstepSounds();
+            avatar->idleUpdateAfterCharacter(avatar->mDeferredDetailedUpdate);
+        }
+    }
+    sDeferredPoseAvatars.clear();
+}
+// </FS>
+
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled, const LLVector3 &position)
 {
     bool render_visualizer = voice_enabled;
@@ -3385,7 +3446,7 @@ void LLVOAvatar::idleUpdateMisc(bool detailed_update)
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     if (LLVOAvatar::sJointDebug)
     {
-        LL_INFOS() << getDebugName() << ": joint touches: " << LLJoint::sNumTouches << " updates: " << LLJoint::sNumUpdates << LL_ENDL;
+        LL_INFOS() << getDebugName() << ": joint touches: " << LLJoint::sNumTouches.load() << " updates: " << LLJoint::sNumUpdates.load() << LL_ENDL;
     }
 
     LLJoint::sNumUpdates = 0;
@@ -5736,6 +5797,13 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     // store data relevant to motions
     mSpeed = speed;
 
+    // <FS> Parallel pose update
+    // Leave blending this pose to updateDeferredPoses(), with the other
+    // avatars'. Not ours: the camera and agent code read it right away.
+    static LLCachedControl<bool> parallel_poses(gSavedSettings, "FSParallelAvatarPoses", false);
+    mMotionController.setDeferPoseBlend(parallel_poses && sPoseUpdate && !isSelf() && !isUIAvatar() && mSpecialRenderMode == 0);
+    // </FS>
+
     // update animations
     if (!visible && !isSelf()) // NOTE: never do a "hidden update" for self avatar as it interrupts controller processing
     {
@@ -5750,6 +5818,7 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
         // Might be better to do HIDDEN_UPDATE if cloud
         updateMotions(LLCharacter::NORMAL_UPDATE);
     }
+    mMotionController.setDeferPoseBlend(false); // <FS/> Parallel pose update
 
     // Special handling for sitting on ground.
     if (!getParent() && (isSitting() || was_sit_ground_constrained))
@@ -5766,6 +5835,24 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
         }
     }
 
+    // <FS> Parallel pose update
+    if (mMotionController.isPoseBlendPending())
+    {
+        // head offset and footsteps read the pose, they wait for it in
+        // updateDeferredPoses()
+        mPoseDeferred = true;
+        sDeferredPoseAvatars.push_back(this);
+        LLJoint* root = mRoot;
+        LLMotionController* controller = &mMotionController;
+        sPoseUpdate->add([controller, root]()
+            {
+                controller->applyDeferredPose();
+                root->updateWorldMatrixChildren();
+            });
+    }
+    else
+    {
+    // </FS>
     // update head position
     updateHeadOffset();
 
@@ -5774,6 +5861,7 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 
     // Update child joints as needed.
     mRoot->updateWorldMatrixChildren();
+    } // <FS/> Parallel pose update
 
     if (visible)
     {
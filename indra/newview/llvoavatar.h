@@ -54,6 +54,7 @@
 #include "llvovolume.h"
 #include "llavatarrendernotifier.h"
 #include "llmodel.h"
+#include "llforkjoin.h" // <FS/> Parallel pose update
 
 extern const LLUUID ANIM_AGENT_BODY_NOISE;
 extern const LLUUID ANIM_AGENT_BREATHE_ROT;
@@ -283,6 +284,14 @@ public:
     void            updateTimeStep();
     void            updateRootPositionAndRotation(LLAgent &agent, F32 speed, bool was_sit_ground_constrained);
 
+    // <FS> Parallel pose update
+    // Blends the poses and updates the skeletons that updateCharacter() left
+    // to the thread pool, then finishes those avatars' idle updates. Call
+    // after the idle updates, before anything reads the joints.
+    static void     updateDeferredPoses();
+    void            idleUpdateAfterCharacter(bool detailed_update);
+    // </FS>
+
     void            idleUpdateVoiceVisualizer(bool voice_enabled, const LLVector3 &position);
     void            idleUpdateMisc(bool detailed_update);
     virtual void    idleUpdateAppearanceAnimation();
@@ -585,6 +594,12 @@ private:
     bool        shouldAlphaMask();
 
     bool        mNeedsSkin; // avatar has been animated and verts have not been updated
+    // <FS> Parallel pose update
+    bool        mPoseDeferred; // pose left for updateDeferredPoses()
+    bool        mDeferredDetailedUpdate;
+    static std::unique_ptr<LLForkJoin> sPoseUpdate;
+    static std::vector<LLPointer<LLVOAvatar> > sDeferredPoseAvatars;
+    // </FS>
     F32         mLastSkinTime; //value of gFrameTimeSeconds at last skin update
 
     S32         mUpdatePeriod;
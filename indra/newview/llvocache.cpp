@@ -169,7 +169,8 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
     mSceneContrib(0.f),
     mValid(true),
     mParentID(0),
-    mBSphereRadius(-1.0f)
+    mBSphereRadius(-1.0f),
+    mDirty(true)
 {
     mBuffer = new U8[dp.getBufferSize()];
     mDP.assignBuffer(mBuffer, dp.getBufferSize());
@@ -189,12 +190,13 @@ LLVOCacheEntry::LLVOCacheEntry()
     mSceneContrib(0.f),
     mValid(true),
     mParentID(0),
-    mBSphereRadius(-1.0f)
+    mBSphereRadius(-1.0f),
+    mDirty(true)
 {
     mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(LLVOCacheMappedFile* mapped_file, S32 offset)
 :   LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
     mBuffer(NULL),
     mUpdateFlags(-1),
@@ -202,68 +204,44 @@ LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
     mSceneContrib(0.f),
     mValid(false),
     mParentID(0),
-    mBSphereRadius(-1.0f)
-{
-    S32 size = -1;
-    bool success;
-    static U8 data_buffer[ENTRY_HEADER_SIZE];
-
-    mDP.assignBuffer(mBuffer, 0);
+    mBSphereRadius(-1.0f),
+    mDirty(false)
+{
+    // LLVOCacheMappedFile::open() checked the record
+    S32 record_size = 0;
+    const U8* data_buffer = mapped_file->getRecord(offset, record_size);
+    S32 size = 0;
+
+    memcpy(&mLocalID, data_buffer, sizeof(U32));
+    memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
+    memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
+    memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
+    memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
+    memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
+
+    // read only, the data packer is only used for unpacking
+    mMappedFile = mapped_file;
+    mBuffer = const_cast<U8*>(data_buffer + ENTRY_HEADER_SIZE);
+    mDP.assignBuffer(mBuffer, size);
+}
 
-    success = check_read(apr_file, (void *)data_buffer, ENTRY_HEADER_SIZE);
-    if (success)
-    {
-        memcpy(&mLocalID, data_buffer, sizeof(U32));
-        memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
-        memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
-        memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
-        memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
-        memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
+LLVOCacheEntry::~LLVOCacheEntry()
+{
+    releaseBuffer();
+}
 
-        // Corruption in the cache entries
-        if ((size > MAX_ENTRY_BODY_SIZE) || (size < 1))
-        {
-            // We've got a bogus size, skip reading it.
-            // We won't bother seeking, because the rest of this file
-            // is likely bogus, and will be tossed anyway.
-            LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-            success = false;
-        }
-    }
-    if(success && size > 0)
+void LLVOCacheEntry::releaseBuffer()
+{
+    if (mMappedFile)
     {
-        mBuffer = new U8[size];
-        success = check_read(apr_file, mBuffer, size);
-
-        if(success)
-        {
-            mDP.assignBuffer(mBuffer, size);
-        }
-        else
-        {
-            // Improve logging around vocache
-            LL_WARNS() << "Error loading cache entry for " << mLocalID << ", size " << size << " aborting!" << LL_ENDL;
-            delete[] mBuffer ;
-            mBuffer = NULL ;
-        }
+        mDP.detachBuffer();
+        mMappedFile = NULL;
     }
-
-    if(!success)
+    else
     {
-        mLocalID = 0;
-        mCRC = 0;
-        mHitCount = 0;
-        mDupeCount = 0;
-        mCRCChangeCount = 0;
-        mBuffer = NULL;
-        mEntry = NULL;
-        mState = INACTIVE;
+        mDP.freeBuffer();
     }
-}
-
-LLVOCacheEntry::~LLVOCacheEntry()
-{
-    mDP.freeBuffer();
+    mBuffer = NULL;
 }
 
 void LLVOCacheEntry::updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp)
@@ -274,12 +252,13 @@ void LLVOCacheEntry::updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp)
         mCRCChangeCount++;
     }
 
-    mDP.freeBuffer();
+    releaseBuffer();
 
     llassert_always(dp.getBufferSize() > 0);
     mBuffer = new U8[dp.getBufferSize()];
     mDP.assignBuffer(mBuffer, dp.getBufferSize());
     mDP = dp;
+    mDirty = true;
 }
 
 void LLVOCacheEntry::setParentID(U32 id)
@@ -1165,6 +1144,100 @@ void LLVOCachePartition::removeOccluder(LLVOCacheGroup* group)
     }
     mOccludedGroups.erase(group);
 }
+
+//-------------------------------------------------------------------
+//LLVOCacheMappedFile
+//-------------------------------------------------------------------
+// The cache file of a region holds its id, a record count, then the
+// records, each an ENTRY_HEADER_SIZE header and its body. A record
+// supersedes earlier records of the same object.
+const S32 FILE_HEADER_SIZE = UUID_BYTES + sizeof(S32);
+
+LLVOCacheMappedFile::LLVOCacheMappedFile() :
+    mNumRecords(0),
+    mFileSize(0),
+    mCanAppend(false)
+{
+}
+
+bool LLVOCacheMappedFile::open(const std::string& filename, const LLUUID& id)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+    mFilename = filename;
+    if (!mFile.open(filename) || mFile.size() < (size_t)FILE_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    const U8* data = mFile.data();
+    const S64 file_size = (S64)mFile.size();
+    if (memcmp(data, id.mData, UUID_BYTES))
+    {
+        LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+        return false;
+    }
+
+    S32 num_records = 0;
+    memcpy(&num_records, data + UUID_BYTES, sizeof(S32));
+
+    bool success = true;
+    S64 offset = FILE_HEADER_SIZE;
+    for (S32 i = 0; i < num_records && offset < file_size; i++)
+    {
+        U32 local_id = 0;
+        S32 size = -1;
+        if (offset + ENTRY_HEADER_SIZE <= file_size)
+        {
+            memcpy(&local_id, data + offset, sizeof(U32));
+            memcpy(&size, data + offset + (5 * sizeof(U32)), sizeof(S32));
+        }
+
+        // Corruption in the cache entries
+        if (!local_id || (size > MAX_ENTRY_BODY_SIZE) || (size < 1) || offset + ENTRY_HEADER_SIZE + size > file_size)
+        {
+            LL_WARNS() << "Bogus cache entry, size " << size << ", aborting cache file load for " << filename << LL_ENDL;
+            success = false;
+            break;
+        }
+
+        mOffsets[local_id] = (S32)offset;
+        offset += ENTRY_HEADER_SIZE + size;
+        mNumRecords++;
+    }
+
+    mFileSize = file_size;
+    mCanAppend = success && offset == file_size;
+    return success;
+}
+
+LLPointer<LLVOCacheEntry> LLVOCacheMappedFile::takeEntry(U32 local_id)
+{
+    offset_map_t::iterator iter = mOffsets.find(local_id);
+    if (iter == mOffsets.end())
+    {
+        return NULL;
+    }
+
+    LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(this, iter->second);
+    mOffsets.erase(iter);
+    return entry;
+}
+
+const U8* LLVOCacheMappedFile::getRecord(S32 offset, S32& size) const
+{
+    const U8* record = mFile.data() + offset;
+    S32 body_size = 0;
+    memcpy(&body_size, record + (5 * sizeof(U32)), sizeof(S32));
+    size = ENTRY_HEADER_SIZE + body_size;
+    return record;
+}
+
+void LLVOCacheMappedFile::appended(S32 records, S32 bytes)
+{
+    mNumRecords += records;
+    mFileSize += bytes;
+}
+
 //-------------------------------------------------------------------
 //LLVOCache
 //-------------------------------------------------------------------
@@ -1558,7 +1631,7 @@ bool LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 
 // we now return bool to trigger dirty cache
 // this in turn forces a rewrite after a partial read due to corruption.
-bool LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+bool LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLPointer<LLVOCacheMappedFile>& mapped_file)
 {
 	LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
     if(!mEnabled)
@@ -1575,62 +1648,28 @@ bool LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
         return false; // arguably no a problem, but we'll mark this as dirty anyway.
     }
 
-    bool success = true ;
-    S32 num_entries = 0 ; // lifted out of inner loop.
-    std::string filename; // lifted out of loop
-    {
-		LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("VOCache:loadRegionObjectCache");        
-        LLUUID cache_id;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-
-        success = check_read(&apr_file, cache_id.mData, UUID_BYTES);
-
-        if(success)
-        {
-            LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("VOCache:loadCacheForRegion");
-            if(cache_id != id)
-            {
-                LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-                success = false ;
-            }
-
-            if(success)
-            {
-                success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-
-                if(success)
-                {
-                    for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-                    {
-                        LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-                        if (!entry->getLocalID())
-                        {
-                            LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-                            success = false ;
-                            break ;
-                        }
-                        cache_entry_map[entry->getLocalID()] = entry;
-                    }
-                }
-            }
-        }
-    }
+    // Only index the records here, the region creates the entries it needs
+    std::string filename;
+    getObjectCacheFilename(handle, filename);
+    mapped_file = new LLVOCacheMappedFile();
+    bool success = mapped_file->open(filename, id);
 
     if(!success)
     {
-        if(cache_entry_map.empty())
+        if(mapped_file->isEmpty())
         {
             removeEntry(iter->second) ;
+            mapped_file = NULL;
         }
     }
 
-    LL_DEBUGS("GLTF", "VOCache") << "Read " << cache_entry_map.size() << " entries from object cache " << filename << ", expected " << num_entries << ", success=" << (success?"True":"False") << LL_ENDL;
+    LL_DEBUGS("GLTF", "VOCache") << "Indexed " << (mapped_file ? mapped_file->getOffsets().size() : 0) << " entries from object cache " << filename << ", success=" << (success?"True":"False") << LL_ENDL;
     return success;
 }
 
 // We now pass in the cache entry map, so that we can remove entries from extras that are no longer in the primary cache.
-void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map,
+                                           const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, const LLVOCacheMappedFile* mapped_file)
 {
 	LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
     int loaded= 0;
@@ -1752,7 +1791,7 @@ void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCac
         U32 local_id = entry_llsd["local_id"].asInteger();
         // only add entries that exist in the primary cache
         // this is a self-healing test that avoids us polluting the cache with entries that are no longer valid based on the main cache.
-        if(cache_entry_map.find(local_id)!= cache_entry_map.end())
+        if(cache_entry_map.find(local_id)!= cache_entry_map.end() || (mapped_file && mapped_file->hasEntry(local_id)))
         {
             // attempt to backfill a null objectId, though these shouldn't be in the persisted cache really
             if(entry.mObjectId.isNull() && pRegion)
@@ -1786,7 +1825,8 @@ void LLVOCache::purgeEntries(U32 size)
     mNumEntries = static_cast<U32>(mHandleEntryMap.size());
 }
 
-void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, bool dirty_cache, bool removal_enabled)
+void LLVOCache::writeToCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLVOCacheMappedFile* mapped_file,
+                             bool dirty_cache, bool removal_enabled)
 {
 	LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
     std::string filename;
@@ -1848,75 +1888,228 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
     //write to cache file
     bool success = true ;
     {
-        std::string filename;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY|APR_TRUNCATE, mLocalAPRFilePoolp);
+        // Entries still in the mapped file were never probed, so they are
+        // invalid and go with the removal of invalid entries
+        bool append = mapped_file && mapped_file->canAppend() && mapped_file->getFilename() == filename
+            && (!removal_enabled || mapped_file->isEmpty());
+
+        S32 dirty_entries = 0;
+        for (LLVOCacheEntry::vocache_entry_map_t::const_iterator entry_iter = cache_entry_map.begin(); append && entry_iter != cache_entry_map.end(); ++entry_iter)
+        {
+            if (removal_enabled && !entry_iter->second->isValid())
+            {
+                append = false;
+            }
+            dirty_entries += entry_iter->second->isDirty();
+        }
+
+        // Superseded records pile up with each append, compact when they
+        // outnumber the live ones
+        if (append)
+        {
+            S32 live_entries = (S32)(mapped_file->getOffsets().size() + cache_entry_map.size());
+            append = mapped_file->getNumRecords() + dirty_entries <= 2 * live_entries + (S32)MIN_ENTRIES_TO_PURGE;
+        }
+
+        if (append)
+        {
+            success = appendToCache(filename, cache_entry_map, mapped_file);
+        }
+        if (!append || !success)
+        {
+            success = rewriteCache(filename, id, cache_entry_map, mapped_file, removal_enabled);
+            if (mapped_file)
+            {
+                mapped_file->rewritten();
+            }
+        }
+
+        if (success)
+        {
+            for (LLVOCacheEntry::vocache_entry_map_t::iterator entry_iter = cache_entry_map.begin(); entry_iter != cache_entry_map.end(); ++entry_iter)
+            {
+                entry_iter->second->setDirty(false);
+            }
+        }
+    }
+
+    if(!success)
+    {
+        removeEntry(entry) ;
+    }
 
-        success = check_write(&apr_file, (void*)id.mData, UUID_BYTES);
+    return ;
+}
 
-        if(success)
+bool LLVOCache::appendToCache(const std::string& filename, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLVOCacheMappedFile* mapped_file)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+
+    // give up when something else changed the file since it was mapped
+    S32 file_size = LLAPRFile::size(filename, mLocalAPRFilePoolp);
+    S32 size_in_file = file_size;
+    if (file_size < FILE_HEADER_SIZE || file_size != mapped_file->getFileSize())
+    {
+        return false;
+    }
+
+    LLAPRFile apr_file(filename, APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
+    if (!apr_file.getFileHandle())
+    {
+        return false;
+    }
+
+    const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
+    U8 data_buffer[buffer_size];
+    S32 size_in_buffer = 0;
+    S32 num_records = 0;
+    bool success = apr_file.seek(APR_END, 0) == file_size;
+
+    // only the entries that changed, they supersede their earlier records
+    for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+    {
+        if (!iter->second->isDirty())
+        {
+            continue;
+        }
+
+        S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
+        if (size <= ENTRY_HEADER_SIZE) // body is minimum of 1
+        {
+            LL_WARNS() << "Failed to write cache entry to buffer for " << filename << ", entry number " << iter->second->getLocalID() << LL_ENDL;
+            success = false;
+            break;
+        }
+        size_in_buffer += size;
+        num_records++;
+
+        // Make sure we have space in buffer for next element
+        if (buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
         {
-            S32 num_entries = static_cast<S32>(cache_entry_map.size()); // if removal is enabled num_entries might be wrong
-            success = check_write(&apr_file, &num_entries, sizeof(S32));
-            if (success)
+            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
+            size_in_file += size_in_buffer;
+            size_in_buffer = 0;
+        }
+    }
+
+    if (success && size_in_buffer > 0)
+    {
+        success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
+        size_in_file += size_in_buffer;
+    }
+
+    // the record count last, the file stays readable if we fail before
+    if (success)
+    {
+        S32 total_records = mapped_file->getNumRecords() + num_records;
+        success = apr_file.seek(APR_SET, UUID_BYTES) == UUID_BYTES
+            && check_write(&apr_file, &total_records, sizeof(S32));
+    }
+
+    if (success)
+    {
+        mapped_file->appended(num_records, size_in_file - file_size);
+    }
+    else
+    {
+        LL_WARNS() << "Failed to append to cache file " << filename << LL_ENDL;
+    }
+    LL_DEBUGS("VOCache") << "Appended " << num_records << " entries to the primary VOCache file " << filename << ". success = " << (success ? "True":"False") << LL_ENDL;
+    return success;
+}
+
+bool LLVOCache::rewriteCache(const std::string& filename, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map,
+                             const LLVOCacheMappedFile* mapped_file, bool removal_enabled)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+
+    // The old file may still be mapped, write a new one and replace it
+    std::string temp_filename = filename + ".tmp";
+    bool success = true;
+    {
+        LLAPRFile apr_file(temp_filename, APR_CREATE|APR_WRITE|APR_BINARY|APR_TRUNCATE, mLocalAPRFilePoolp);
+
+        S32 num_entries = 0; // written last
+        success = check_write(&apr_file, (void*)id.mData, UUID_BYTES)
+            && check_write(&apr_file, &num_entries, sizeof(S32));
+
+        const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
+        U8 data_buffer[buffer_size]; // generaly entries are fairly small, so collect them and drop onto disk in one go
+        S32 size_in_buffer = 0;
+
+        // Make sure we have space in buffer for next element
+        auto flush = [&]()
+        {
+            if (success && buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
             {
-                const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
-                U8 data_buffer[buffer_size]; // generaly entries are fairly small, so collect them and drop onto disk in one go
-                S32 size_in_buffer = 0;
+                success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
+                size_in_buffer = 0;
+            }
+        };
 
-                // This can have a lot of entries, so might be better to dump them into buffer first and write in one go.
-                for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+        // Records the region never asked for are copied as they are
+        if (mapped_file && !removal_enabled)
+        {
+            for (const auto& offset : mapped_file->getOffsets())
+            {
+                if (!success)
                 {
-                    if (!removal_enabled || iter->second->isValid())
-                    {
-                        S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
-
-                        if (size > ENTRY_HEADER_SIZE) // body is minimum of 1
-                        {
-                            size_in_buffer += size;
-                        }
-                        else
-                        {
-                            LL_WARNS() << "Failed to write cache entry to buffer for " << filename << ", entry number " << iter->second->getLocalID() << LL_ENDL;
-                            success = false;
-                            break;
-                        }
-
-                        // Make sure we have space in buffer for next element
-                        if (buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
-                        {
-                            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                            size_in_buffer = 0;
-                            if (!success)
-                            {
-                                LL_WARNS() << "Failed to write cache to disk " << filename << LL_ENDL;
-                                break;
-                            }
-                        }
-                    }
+                    break;
                 }
+                S32 size = 0;
+                const U8* record = mapped_file->getRecord(offset.second, size);
+                memcpy(data_buffer + size_in_buffer, record, size);
+                size_in_buffer += size;
+                num_entries++;
+                flush();
+            }
+        }
+
+        for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+        {
+            if (!removal_enabled || iter->second->isValid())
+            {
+                S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
 
-                if (success && size_in_buffer > 0)
+                if (size > ENTRY_HEADER_SIZE) // body is minimum of 1
+                {
+                    size_in_buffer += size;
+                    num_entries++;
+                }
+                else
                 {
-                    // final write
-                    success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                    if(!success)
-                    {
-                        LL_WARNS() << "Failed to write cache entry to disk " << filename << LL_ENDL;
-                    }
-                    size_in_buffer = 0;
+                    LL_WARNS() << "Failed to write cache entry to buffer for " << filename << ", entry number " << iter->second->getLocalID() << LL_ENDL;
+                    success = false;
+                    break;
                 }
-                LL_DEBUGS("VOCache") << "Wrote " << num_entries << " entries to the primary VOCache file " << filename << ". success = " << (success ? "True":"False") << LL_ENDL;
+                flush();
             }
         }
+
+        if (success && size_in_buffer > 0)
+        {
+            // final write
+            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
+        }
+
+        if (success)
+        {
+            success = apr_file.seek(APR_SET, UUID_BYTES) == UUID_BYTES
+                && check_write(&apr_file, &num_entries, sizeof(S32));
+        }
+        LL_DEBUGS("VOCache") << "Wrote " << num_entries << " entries to the primary VOCache file " << filename << ". success = " << (success ? "True":"False") << LL_ENDL;
     }
 
-    if(!success)
+    if (success)
     {
-        removeEntry(entry) ;
+        success = LLFile::rename(temp_filename, filename) == 0;
     }
-
-    return ;
+    if (!success)
+    {
+        LL_WARNS() << "Failed to write cache to disk " << filename << LL_ENDL;
+        LLFile::remove(temp_filename);
+    }
+    return success;
 }
 
 void LLVOCache::removeGenericExtrasForHandle(U64 handle)
@@ -33,12 +33,14 @@
 #include "llvieweroctree.h"
 #include "llapr.h"
 #include "llgltfmaterial.h"
+#include "llmappedfile.h"
 
 #include <unordered_map>
 
 //---------------------------------------------------------------------------
 // Cache entries
 class LLCamera;
+class LLVOCacheMappedFile;
 
 class LLGLTFOverrideCacheEntry
 {
@@ -109,7 +111,7 @@ protected:
     ~LLVOCacheEntry();
 public:
     LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-    LLVOCacheEntry(LLAPRFile* apr_file);
+    LLVOCacheEntry(LLVOCacheMappedFile* mapped_file, S32 offset); // data stays in the mapped file until updated
     LLVOCacheEntry();
 
     void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -137,6 +139,10 @@ public:
     void recordHit();
     void recordDupe() { mDupeCount++; }
 
+    // the data differs from what the region's cache file holds
+    bool isDirty() const { return mDirty; }
+    void setDirty(bool dirty) { mDirty = dirty; }
+
     /*virtual*/ void setOctreeEntry(LLViewerOctreeEntry* entry);
 
     void setParentID(U32 id);
@@ -164,6 +170,7 @@ public:
 
 private:
     void updateParentBoundingInfo(const LLVOCacheEntry* child);
+    void releaseBuffer();
 
 public:
     typedef std::map<U32, LLPointer<LLVOCacheEntry> >      vocache_entry_map_t;
@@ -183,6 +190,8 @@ protected:
     S32                         mCRCChangeCount;
     LLDataPackerBinaryBuffer    mDP;
     U8                          *mBuffer;
+    LLPointer<LLVOCacheMappedFile> mMappedFile; // owns mBuffer when set
+    bool                        mDirty;
 
     F32                         mSceneContrib; //projected scene contributuion of this object.
     U32                         mState; //high 16 bits reserved for special use.
@@ -201,6 +210,53 @@ public:
     static F32                  sRearPixelThreshold;
 };
 
+//
+// Read-only mapping of a region's object cache file, with the offset of
+// the latest record of each object. LLVOCacheEntry objects are only
+// created when the region asks for them.
+//
+class LLVOCacheMappedFile : public LLRefCount
+{
+public:
+    typedef std::unordered_map<U32, S32> offset_map_t;
+
+    LLVOCacheMappedFile();
+
+    // Maps the file and indexes its records. Returns false when the file
+    // is missing, belongs to another region or is corrupt, in which case
+    // the records indexed before the corruption stay available.
+    bool open(const std::string& filename, const LLUUID& id);
+
+    bool hasEntry(U32 local_id) const { return mOffsets.find(local_id) != mOffsets.end(); }
+    // Creates the entry of local_id, and forgets it
+    LLPointer<LLVOCacheEntry> takeEntry(U32 local_id);
+
+    // entries not taken yet
+    const offset_map_t& getOffsets() const { return mOffsets; }
+    bool isEmpty() const { return mOffsets.empty(); }
+
+    // a record, header and body, at an offset from getOffsets()
+    const U8* getRecord(S32 offset, S32& size) const;
+
+    const std::string& getFilename() const { return mFilename; }
+    S32 getNumRecords() const { return mNumRecords; }
+    S64 getFileSize() const { return mFileSize; }
+
+    // New records can go at the end of the file when it still ends where
+    // the mapping does
+    bool canAppend() const { return mCanAppend; }
+    void appended(S32 records, S32 bytes);
+    void rewritten() { mCanAppend = false; }
+
+private:
+    LLMappedFile    mFile;
+    std::string     mFilename;
+    offset_map_t    mOffsets;
+    S32             mNumRecords;
+    S64             mFileSize;  // as written by us
+    bool            mCanAppend;
+};
+
 class LLVOCacheGroup : public LLOcclusionCullingGroup
 {
 public:
@@ -292,10 +348,15 @@ public:
     void initCache(ELLPath location, U32 size, U32 cache_version);
     void removeCache(ELLPath location, bool started = false) ;
 
-    bool readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
-    void readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+    bool readFromCache(U64 handle, const LLUUID& id, LLPointer<LLVOCacheMappedFile>& mapped_file) ;
+    void readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map,
+                                    const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, const LLVOCacheMappedFile* mapped_file);
 
-    void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, bool dirty_cache, bool removal_enabled);
+    // Appends the dirty entries to the region's cache file when possible,
+    // rewrites the file otherwise. Entries still in mapped_file are kept,
+    // unless removal_enabled.
+    void writeToCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLVOCacheMappedFile* mapped_file,
+                      bool dirty_cache, bool removal_enabled);
     void writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, bool dirty_cache, bool removal_enabled);
     void removeEntry(U64 handle) ;
     void removeGenericExtrasForHandle(U64 handle);
@@ -316,6 +377,9 @@ private:
     void removeEntry(HeaderEntryInfo* entry) ;
     void purgeEntries(U32 size);
     bool updateEntry(const HeaderEntryInfo* entry);
+    bool appendToCache(const std::string& filename, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLVOCacheMappedFile* mapped_file);
+    bool rewriteCache(const std::string& filename, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map,
+                      const LLVOCacheMappedFile* mapped_file, bool removal_enabled);
 
 private:
     bool                 mEnabled;
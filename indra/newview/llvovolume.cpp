@@ -5238,6 +5238,8 @@ void LLRiggedVolume::update(
     if (copy)
     {
         copyVolumeFaces(volume);
+        // <FS/> The faces were reallocated
+        mSkinningBatches.clear();
     }
     else
     {
@@ -5264,6 +5266,8 @@ void LLRiggedVolume::update(
     S32 rigged_vert_count = 0;
     S32 rigged_face_count = 0;
     LLVector4a box_min, box_max;
+    // <FS/> Faces can be skinned one at a time
+    mSkinningBatches.resize(getNumVolumeFaces());
     S32 face_begin;
     S32 face_end;
     if (face_index == DO_NOT_UPDATE_FACES)
@@ -5301,72 +5305,34 @@ void LLRiggedVolume::update(
                 rigged_vert_count += dst_face.mNumVertices;
                 rigged_face_count++;
 
-            #if USE_SEPARATE_JOINT_INDICES_AND_WEIGHTS
-                if (vol_face.mJointIndices) // fast path with preconditioned joint indices
+                // <FS> Skin the whole face at once, in runs of vertices sharing
+                // their joints; an unchanged pose leaves positions and extents as
+                // they are
+                LLSkinningBatch& batch = mSkinningBatches[i];
+                const U32 batch_joints = llmin(max_joints, maxJoints);
+                if (!batch.isPrepared(weight, dst_face.mNumVertices, batch_joints))
                 {
-                    LLMatrix4a src[4];
-                    U8* joint_indices_cursor = vol_face.mJointIndices;
-                    LLVector4a* just_weights = vol_face.mJustWeights;
-                    for (U32 j = 0; j < dst_face.mNumVertices; ++j)
-                    {
-                        LLMatrix4a final_mat;
-                        F32* w = just_weights[j].getF32ptr();
-                        LLSkinningUtil::getPerVertexSkinMatrixWithIndices(w, joint_indices_cursor, mat, final_mat, src);
-                        joint_indices_cursor += 4;
-
-                        LLVector4a& v = vol_face.mPositions[j];
-                        LLVector4a t;
-                        LLVector4a dst;
-                        bind_shape_matrix.affineTransform(v, t);
-                        final_mat.affineTransform(t, dst);
-                        pos[j] = dst;
-                    }
+                    batch.prepare(weight, dst_face.mNumVertices, batch_joints);
                 }
-                else
-            #endif
+
+                if (batch.skin(mat, maxJoints, bind_shape_matrix, vol_face.mPositions, pos, dst_face.mExtents))
                 {
-                    for (S32 j = 0; j < dst_face.mNumVertices; ++j)
-                    {
-                        LLMatrix4a final_mat;
-                        // <FS:ND> Use the SSE2 version
-                        // LLSkinningUtil::getPerVertexSkinMatrix(weight[j].getF32ptr(), mat, false, final_mat, max_joints);
-                        FSSkinningUtil::getPerVertexSkinMatrixSSE(weight[j], mat, false, final_mat, max_joints);
-                        // </FS:ND>
-
-                        LLVector4a& v = vol_face.mPositions[j];
-                        LLVector4a t;
-                        LLVector4a dst;
-                        bind_shape_matrix.affineTransform(v, t);
-                        final_mat.affineTransform(t, dst);
-                        pos[j] = dst;
-                    }
+                    dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
+                    dst_face.mCenter->mul(0.5f);
                 }
 
                 //update bounding box
                 // VFExtents change
-                LLVector4a& min = dst_face.mExtents[0];
-                LLVector4a& max = dst_face.mExtents[1];
-
-                min = pos[0];
-                max = pos[1];
-                if (i==0)
+                const LLVector4a& min = dst_face.mExtents[0];
+                const LLVector4a& max = dst_face.mExtents[1];
+                if (rigged_face_count == 1)
                 {
                     box_min = min;
                     box_max = max;
                 }
-
-                for (S32 j = 1; j < dst_face.mNumVertices; ++j)
-                {
-                    min.setMin(min, pos[j]);
-                    max.setMax(max, pos[j]);
-                }
-
                 box_min.setMin(min,box_min);
                 box_max.setMax(max,box_max);
-
-                dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
-                dst_face.mCenter->mul(0.5f);
-
+                // </FS>
             }
 
             if (rebuild_face_octrees)
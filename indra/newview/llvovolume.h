@@ -34,6 +34,7 @@
 #include "lllocalbitmaps.h"
 #include "m3math.h"     // LLMatrix3
 #include "m4math.h"     // LLMatrix4
+#include "llskinningbatch.h" // <FS/> LLSkinningBatch
 #include <unordered_map>
 #include <unordered_set>
 
@@ -78,6 +79,12 @@ public:
         bool rebuild_face_octrees = true);
 
     std::string mExtraDebugText;
+
+    // <FS> One per volume face, sorted by joint influences and caching the
+    // last skinned positions
+private:
+    std::vector<LLSkinningBatch> mSkinningBatches;
+    // </FS>
 };
 
 // Base class for implementations of the volume - Primitive, Flexible Object, etc.
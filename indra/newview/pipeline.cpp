@@ -5058,7 +5058,16 @@ void LLPipeline::renderDebug()
 
                 if ( pathfindingConsole->getVisible() || gAgentCamera.cameraMouselook() )
                 {
-                    F32 ambiance = gSavedSettings.getF32("PathfindingAmbiance");
+                    // <FS> Per-frame settings reads through interned handles
+                    static LLControlHandle<F32> pathfinding_ambiance(gSavedSettings, "PathfindingAmbiance");
+                    static LLControlHandle<F32> pathfinding_line_offset(gSavedSettings, "PathfindingLineOffset");
+                    static LLControlHandle<F32> pathfinding_line_width(gSavedSettings, "PathfindingLineWidth");
+                    static LLControlHandle<F32> pathfinding_xray_tint(gSavedSettings, "PathfindingXRayTint");
+                    static LLControlHandle<F32> pathfinding_xray_opacity(gSavedSettings, "PathfindingXRayOpacity");
+                    static LLControlHandle<bool> pathfinding_xray_wireframe(gSavedSettings, "PathfindingXRayWireframe");
+                    // </FS>
+
+                    F32 ambiance = pathfinding_ambiance(); // <FS/>
 
                     gPathfindingProgram.bind();
 
@@ -5188,18 +5197,18 @@ void LLPipeline::renderDebug()
                                 LLGLEnable lineOffset(GL_POLYGON_OFFSET_LINE);
                                 glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
 
-                                F32 offset = gSavedSettings.getF32("PathfindingLineOffset");
+                                F32 offset = pathfinding_line_offset(); // <FS/>
 
                                 if (pathfindingConsole->isRenderXRay())
                                 {
-                                    gPathfindingProgram.uniform1f(sTint, gSavedSettings.getF32("PathfindingXRayTint"));
-                                    gPathfindingProgram.uniform1f(sAlphaScale, gSavedSettings.getF32("PathfindingXRayOpacity"));
+                                    gPathfindingProgram.uniform1f(sTint, pathfinding_xray_tint()); // <FS/>
+                                    gPathfindingProgram.uniform1f(sAlphaScale, pathfinding_xray_opacity()); // <FS/>
                                     LLGLEnable blend(GL_BLEND);
                                     LLGLDepthTest depth(GL_TRUE, GL_FALSE, GL_GREATER);
 
                                     glPolygonOffset(offset, -offset);
 
-                                    if (gSavedSettings.getBOOL("PathfindingXRayWireframe"))
+                                    if (pathfinding_xray_wireframe()) // <FS/>
                                     { //draw hidden wireframe as darker and less opaque
                                         gPathfindingProgram.uniform1f(sAmbiance, 1.f);
                                         llPathingLibInstance->renderNavMeshShapesVBO( render_order[i] );
@@ -5219,7 +5228,7 @@ void LLPipeline::renderDebug()
                                     gPathfindingProgram.uniform1f(sTint, 1.f);
                                     gPathfindingProgram.uniform1f(sAlphaScale, 1.f);
 
-                                    gGL.setLineWidth(gSavedSettings.getF32("PathfindingLineWidth")); // <FS> Line width OGL core profile fix by Rye Mutt
+                                    gGL.setLineWidth(pathfinding_line_width()); // <FS> Line width OGL core profile fix by Rye Mutt
                                     LLGLDisable blendOut(GL_BLEND);
                                     llPathingLibInstance->renderNavMeshShapesVBO( render_order[i] );
                                     gGL.flush();
@@ -5235,12 +5244,12 @@ void LLPipeline::renderDebug()
 
                     if ( pathfindingConsole->isRenderNavMesh() && pathfindingConsole->isRenderXRay() )
                     {   //render navmesh xray
-                        F32 ambiance = gSavedSettings.getF32("PathfindingAmbiance");
+                        F32 ambiance = pathfinding_ambiance(); // <FS/>
 
                         LLGLEnable lineOffset(GL_POLYGON_OFFSET_LINE);
                         LLGLEnable polyOffset(GL_POLYGON_OFFSET_FILL);
 
-                        F32 offset = gSavedSettings.getF32("PathfindingLineOffset");
+                        F32 offset = pathfinding_line_offset(); // <FS/>
                         glPolygonOffset(offset, -offset);
 
                         LLGLEnable blend(GL_BLEND);
@@ -5249,10 +5258,10 @@ void LLPipeline::renderDebug()
                         gGL.setLineWidth(2.0f); // <FS> Line width OGL core profile fix by Rye Mutt
                         LLGLEnable cull(GL_CULL_FACE);
 
-                        gPathfindingProgram.uniform1f(sTint, gSavedSettings.getF32("PathfindingXRayTint"));
-                        gPathfindingProgram.uniform1f(sAlphaScale, gSavedSettings.getF32("PathfindingXRayOpacity"));
+                        gPathfindingProgram.uniform1f(sTint, pathfinding_xray_tint()); // <FS/>
+                        gPathfindingProgram.uniform1f(sAlphaScale, pathfinding_xray_opacity()); // <FS/>
 
-                        if (gSavedSettings.getBOOL("PathfindingXRayWireframe"))
+                        if (pathfinding_xray_wireframe()) // <FS/>
                         { //draw hidden wireframe as darker and less opaque
                             glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
                             gPathfindingProgram.uniform1f(sAmbiance, 1.f);
@@ -5267,8 +5276,8 @@ void LLPipeline::renderDebug()
 
                         //render edges
                         gPathfindingNoNormalsProgram.bind();
-                        gPathfindingNoNormalsProgram.uniform1f(sTint, gSavedSettings.getF32("PathfindingXRayTint"));
-                        gPathfindingNoNormalsProgram.uniform1f(sAlphaScale, gSavedSettings.getF32("PathfindingXRayOpacity"));
+                        gPathfindingNoNormalsProgram.uniform1f(sTint, pathfinding_xray_tint()); // <FS/>
+                        gPathfindingNoNormalsProgram.uniform1f(sAlphaScale, pathfinding_xray_opacity()); // <FS/>
                         llPathingLibInstance->renderNavMeshEdges();
                         gPathfindingProgram.bind();
 
@@ -0,0 +1,609 @@
+/**
+ * @file llobjectupdatepipeline_test.cpp
+ * @date   2024-11
+ * @brief Test of the object update decoding pipeline, and a replay benchmark
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "../llviewerprecompiledheaders.h"
+#include "../test/lltut.h"
+
+#include "../llobjectupdatepipeline.h"
+
+#include "lldatapacker.h"
+#include "llquantize.h"
+#include "llregionhandle.h"
+#include "lltimer.h"
+#include "llvolume.h"
+#include "threadpool.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    typedef LLObjectUpdatePipeline::Record Record;
+    typedef LLObjectUpdatePipeline::Batch Batch;
+
+    struct Message
+    {
+        std::vector<U32> mFlags;
+        std::vector<std::vector<U8>> mBlocks;
+    };
+
+    // A full compressed update block, laid out as LLViewerObject::initObjectDataMap()
+    std::vector<U8> make_block(U32 local_id, LLPCode pcode, U32 crc, const LLVector3& scale, const LLVector3& pos,
+                               U32 parent_id, bool omega, S32 extra = 0)
+    {
+        std::vector<U8> block(200 + extra);
+        LLDataPackerBinaryBuffer dp(block.data(), (S32)block.size());
+
+        U32 special_code = 0;
+        if (parent_id)
+        {
+            special_code |= 0x20;
+        }
+        if (omega)
+        {
+            special_code |= 0x80;
+        }
+
+        LLUUID id;
+        id.generate();
+        dp.packUUID(id, "ID");
+        dp.packU32(local_id, "LocalID");
+        dp.packU8(pcode, "PCode");
+        dp.packU8(0, "State");
+        dp.packU32(crc, "CRC");
+        dp.packU8(0, "Material");
+        dp.packU8(0, "ClickAction");
+        dp.packVector3(scale, "Scale");
+        dp.packVector3(pos, "Pos");
+        dp.packVector3(LLVector3::zero, "Rot");
+        dp.packU32(special_code, "SpecialCode");
+        dp.packUUID(LLUUID::null, "Owner");
+        if (omega)
+        {
+            dp.packVector3(LLVector3(0.f, 0.f, 1.f), "Omega");
+        }
+        if (parent_id)
+        {
+            dp.packU32(parent_id, "ParentID");
+        }
+        // texture entries, extra parameters and so on, not decoded here
+        block.resize(dp.getCurrentSize() + 60 + extra);
+        return block;
+    }
+
+    std::vector<Message> make_traffic(U32 objects, U32 blocks_per_message)
+    {
+        std::vector<Message> messages;
+        for (U32 i = 0; i < objects; ++i)
+        {
+            if (i % blocks_per_message == 0)
+            {
+                messages.emplace_back();
+            }
+            // every fourth object is a child of the previous root
+            const U32 parent = (i % 4) ? (i - i % 4 + 1) : 0;
+            messages.back().mFlags.push_back(0);
+            messages.back().mBlocks.push_back(make_block(i + 1, LL_PCODE_VOLUME, i * 7919,
+                                                         LLVector3(1.f, 1.f, 1.f),
+                                                         LLVector3((F32)(i % 256), (F32)(i / 256 % 256), 25.f),
+                                                         parent, (i % 8) == 0, (S32)(i % 300)));
+        }
+        return messages;
+    }
+
+    // Capture format: per message, a U32 block count, then per block its
+    // UpdateFlags, its size and its data. Little endian.
+    bool read_capture(const std::string& path, std::vector<Message>& messages)
+    {
+        std::ifstream in(path, std::ios::binary);
+        U32 count = 0;
+        while (in.read(reinterpret_cast<char*>(&count), sizeof(count)))
+        {
+            messages.emplace_back();
+            Message& message = messages.back();
+            for (U32 i = 0; i < count; ++i)
+            {
+                U32 flags = 0;
+                U32 size = 0;
+                if (!in.read(reinterpret_cast<char*>(&flags), sizeof(flags))
+                    || !in.read(reinterpret_cast<char*>(&size), sizeof(size))
+                    || size > 2048)
+                {
+                    return false;
+                }
+                message.mFlags.push_back(flags);
+                message.mBlocks.emplace_back(size);
+                if (!in.read(reinterpret_cast<char*>(message.mBlocks.back().data()), size))
+                {
+                    return false;
+                }
+            }
+        }
+        return !messages.empty();
+    }
+
+    // Stands in for LLViewerRegion::cacheFullUpdate(): keeps a copy of
+    // the block by local id
+    struct CacheStub
+    {
+        std::unordered_map<U32, std::vector<U8>> mEntries;
+        std::vector<U32> mOrder;
+        F32 mChecksum = 0.f;
+
+        void apply(Batch& batch, const Record& record)
+        {
+            mOrder.push_back(record.mLocalID);
+            if (!record.mPCode)
+            {
+                return;
+            }
+            const U8* data = batch.getData(record);
+            mEntries[record.mLocalID].assign(data, data + record.mSize);
+            mChecksum += record.mPosition.mV[VX] + (F32)record.mParentID;
+        }
+    };
+
+    Record decode_one(const std::vector<U8>& block)
+    {
+        Batch batch(0);
+        batch.addBlock(block.data(), (S32)block.size(), 0);
+        batch.decode();
+        return batch.getRecords()[0];
+    }
+
+    // An ImprovedTerseObjectUpdate block, laid out as the OUT_TERSE_IMPROVED
+    // case of LLViewerObject::processUpdateMessage() reads it
+    std::vector<U8> make_terse_block(U32 local_id, bool avatar)
+    {
+        std::vector<U8> block(64);
+        LLDataPackerBinaryBuffer dp(block.data(), (S32)block.size());
+        dp.packU32(local_id, "LocalID");
+        dp.packU8(0, "State");
+        dp.packU8(avatar, "agent");
+        if (avatar)
+        {
+            dp.packVector4(LLVector4(0.f, 0.f, 1.f, 20.f), "Plane");
+        }
+        dp.packVector3(LLVector3((F32)(local_id % 256), 128.f, 25.f), "Pos");
+        for (S32 i = 0; i < 13; ++i)
+        {
+            dp.packU16((U16)(local_id * 31 + i), "Quantized");
+        }
+        block.resize(dp.getCurrentSize());
+        return block;
+    }
+
+    struct TerseValues
+    {
+        LLVector4 mPlane;
+        LLVector3 mPosition;
+        LLVector3 mVelocity;
+        LLVector3 mAcceleration;
+        LLQuaternion mRotation;
+        LLVector3 mAngularVelocity;
+    };
+
+    // What the handler and processUpdateMessage() do with a terse block
+    // before the values go to the object
+    U32 decode_terse(const U8* data, S32 size, TerseValues& values)
+    {
+        LLDataPackerBinaryBuffer dp(const_cast<U8*>(data), size);
+        U32 local_id;
+        U8 state, agent;
+        U16 val[4];
+        dp.unpackU32(local_id, "LocalID");
+        dp.unpackU8(state, "State");
+        dp.unpackU8(agent, "agent");
+        if (agent)
+        {
+            dp.unpackVector4(values.mPlane, "Plane");
+        }
+        dp.unpackVector3(values.mPosition, "Pos");
+        dp.unpackU16(val[VX], "VelX");
+        dp.unpackU16(val[VY], "VelY");
+        dp.unpackU16(val[VZ], "VelZ");
+        values.mVelocity.set(U16_to_F32(val[VX], -128.f, 128.f), U16_to_F32(val[VY], -128.f, 128.f), U16_to_F32(val[VZ], -128.f, 128.f));
+        dp.unpackU16(val[VX], "AccX");
+        dp.unpackU16(val[VY], "AccY");
+        dp.unpackU16(val[VZ], "AccZ");
+        values.mAcceleration.set(U16_to_F32(val[VX], -64.f, 64.f), U16_to_F32(val[VY], -64.f, 64.f), U16_to_F32(val[VZ], -64.f, 64.f));
+        dp.unpackU16(val[VX], "ThetaX");
+        dp.unpackU16(val[VY], "ThetaY");
+        dp.unpackU16(val[VZ], "ThetaZ");
+        dp.unpackU16(val[VS], "ThetaS");
+        values.mRotation.set(U16_to_F32(val[VX], -1.f, 1.f), U16_to_F32(val[VY], -1.f, 1.f),
+                             U16_to_F32(val[VZ], -1.f, 1.f), U16_to_F32(val[VS], -1.f, 1.f));
+        dp.unpackU16(val[VX], "AccX");
+        dp.unpackU16(val[VY], "AccY");
+        dp.unpackU16(val[VZ], "AccZ");
+        values.mAngularVelocity.set(U16_to_F32(val[VX], -64.f, 64.f), U16_to_F32(val[VY], -64.f, 64.f), U16_to_F32(val[VZ], -64.f, 64.f));
+        return local_id;
+    }
+}
+
+namespace tut
+{
+    struct objectupdatepipeline_test
+    {
+        typedef LLObjectUpdatePipeline::batch_ptr_t batch_ptr_t;
+
+        const U64 mRegion = to_region_handle(256000, 256000);
+        const U64 mOtherRegion = to_region_handle(256256, 256000);
+
+        batch_ptr_t makeBatch(U64 region, U32 first_id, U32 count)
+        {
+            batch_ptr_t batch = std::make_shared<Batch>(region);
+            for (U32 id = first_id; id < first_id + count; ++id)
+            {
+                std::vector<U8> block = make_block(id, LL_PCODE_VOLUME, id, LLVector3(1.f, 1.f, 1.f),
+                                                   LLVector3((F32)id, 0.f, 0.f), 0, false);
+                batch->addBlock(block.data(), (S32)block.size(), 0);
+            }
+            return batch;
+        }
+    };
+    typedef test_group<objectupdatepipeline_test> objectupdatepipeline_t;
+    typedef objectupdatepipeline_t::object objectupdatepipeline_object_t;
+    tut::objectupdatepipeline_t tut_objectupdatepipeline("LLObjectUpdatePipeline");
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<1>()
+    {
+        set_test_name("decode a block without parent");
+        std::vector<U8> block = make_block(1234, LL_PCODE_VOLUME, 0xdeadbeef,
+                                           LLVector3(1.f, 2.f, 3.f), LLVector3(10.f, 20.f, 30.f), 0, false);
+        Record record = decode_one(block);
+        ensure_equals("local id", record.mLocalID, 1234U);
+        ensure_equals("pcode", record.mPCode, LL_PCODE_VOLUME);
+        ensure("extents", record.mHasExtents);
+        ensure_equals("crc", record.mCRC, 0xdeadbeefU);
+        ensure_equals("parent", record.mParentID, 0U);
+        ensure_equals("scale", record.mScale, LLVector3(1.f, 2.f, 3.f));
+        ensure_equals("position", record.mPosition, LLVector3(10.f, 20.f, 30.f));
+        ensure_equals("size", record.mSize, (S32)block.size());
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<2>()
+    {
+        set_test_name("decode the parent id with and without omega");
+        Record with_omega = decode_one(make_block(2, LL_PCODE_VOLUME, 0, LLVector3::zero, LLVector3::zero, 77, true));
+        ensure_equals("parent after omega", with_omega.mParentID, 77U);
+        Record without_omega = decode_one(make_block(3, LL_PCODE_VOLUME, 0, LLVector3::zero, LLVector3::zero, 88, false));
+        ensure_equals("parent without omega", without_omega.mParentID, 88U);
+        Record omega_only = decode_one(make_block(4, LL_PCODE_VOLUME, 0, LLVector3::zero, LLVector3::zero, 0, true));
+        ensure_equals("no parent", omega_only.mParentID, 0U);
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<3>()
+    {
+        set_test_name("truncated blocks");
+        std::vector<U8> block = make_block(5, LL_PCODE_VOLUME, 0, LLVector3::zero, LLVector3::zero, 0, false);
+
+        std::vector<U8> tiny(block.begin(), block.begin() + 10);
+        Record record = decode_one(tiny);
+        ensure_equals("no pcode", record.mPCode, 0);
+        ensure("no extents in tiny block", !record.mHasExtents);
+
+        std::vector<U8> header(block.begin(), block.begin() + 40);
+        record = decode_one(header);
+        ensure_equals("local id in header", record.mLocalID, 5U);
+        ensure_equals("pcode in header", record.mPCode, LL_PCODE_VOLUME);
+        ensure("no extents in header", !record.mHasExtents);
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<4>()
+    {
+        set_test_name("records are applied in order, within the time budget");
+        LLObjectUpdatePipeline pipeline;
+        CacheStub cache;
+        auto apply = [&cache](Batch& batch, const Record& record) { cache.apply(batch, record); };
+
+        pipeline.post(makeBatch(mRegion, 1, 10), nullptr);
+        pipeline.post(makeBatch(mOtherRegion, 11, 5), nullptr);
+        pipeline.post(std::make_shared<Batch>(mRegion), nullptr);
+        ensure_equals("pending", pipeline.getPendingCount(), (size_t)15);
+        ensure("pending id", pipeline.isPending(mRegion, 3));
+        ensure("pending id in the other region", pipeline.isPending(mOtherRegion, 12));
+        ensure("not pending in the wrong region", !pipeline.isPending(mOtherRegion, 3));
+
+        // a zero budget still applies one record per frame
+        ensure_equals("one record", pipeline.update(0.f, apply), 1U);
+        ensure("applied id", !pipeline.isPending(mRegion, 1));
+
+        ensure_equals("the rest", pipeline.update(10.f, apply), 14U);
+        ensure("empty", pipeline.isEmpty());
+        ensure_equals("none pending", pipeline.getPendingCount(), (size_t)0);
+        ensure_equals("all applied", cache.mOrder.size(), (size_t)15);
+        for (U32 i = 0; i < cache.mOrder.size(); ++i)
+        {
+            ensure_equals("order", cache.mOrder[i], i + 1);
+        }
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<5>()
+    {
+        set_test_name("repeated ids, flush and dropRegion");
+        LLObjectUpdatePipeline pipeline;
+        CacheStub cache;
+        auto apply = [&cache](Batch& batch, const Record& record) { cache.apply(batch, record); };
+
+        pipeline.post(makeBatch(mRegion, 1, 4), nullptr);
+        pipeline.post(makeBatch(mRegion, 3, 4), nullptr);
+        pipeline.post(makeBatch(mOtherRegion, 1, 4), nullptr);
+        pipeline.update(0.f, apply);
+        pipeline.update(0.f, apply);
+        pipeline.update(0.f, apply);
+        ensure("3 still pending from the second batch", pipeline.isPending(mRegion, 3));
+
+        pipeline.dropRegion(mRegion);
+        ensure("dropped", !pipeline.isPending(mRegion, 3));
+        ensure("other region kept", pipeline.isPending(mOtherRegion, 1));
+        ensure_equals("pending after drop", pipeline.getPendingCount(), (size_t)4);
+
+        ensure_equals("flushed", pipeline.flush(apply), 4U);
+        ensure("empty", pipeline.isEmpty());
+        ensure_equals("applied", cache.mOrder.size(), (size_t)7);
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<6>()
+    {
+        set_test_name("decode on a thread pool");
+        LL::ThreadPool pool("ObjectUpdatePipelineTest", 4, 1024, false);
+        pool.start();
+        LL::WorkQueueBase::ptr_t queue = LL::WorkQueueBase::getInstance("ObjectUpdatePipelineTest");
+
+        LLObjectUpdatePipeline pipeline;
+        CacheStub cache;
+        auto apply = [&cache](Batch& batch, const Record& record) { cache.apply(batch, record); };
+
+        const U32 BATCHES = 200;
+        const U32 BLOCKS = 8;
+        for (U32 i = 0; i < BATCHES; ++i)
+        {
+            pipeline.post(makeBatch(mRegion, i * BLOCKS + 1, BLOCKS), queue);
+            if (i % 16 == 0)
+            {
+                pipeline.update(0.f, apply);
+            }
+        }
+        pipeline.flush(apply);
+        pool.close();
+
+        ensure_equals("all applied", cache.mOrder.size(), (size_t)(BATCHES * BLOCKS));
+        for (U32 i = 0; i < cache.mOrder.size(); ++i)
+        {
+            ensure_equals("order", cache.mOrder[i], i + 1);
+        }
+        ensure_equals("cached", cache.mEntries.size(), (size_t)(BATCHES * BLOCKS));
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<7>()
+    {
+        set_test_name("replay benchmark");
+        // Timing runs are noisy and slow, only run on request:
+        // LL_OBJECT_UPDATE_BENCHMARK=1
+        // LL_OBJECT_UPDATE_REPLAY_FILE may name a capture, see read_capture()
+        if (!getenv("LL_OBJECT_UPDATE_BENCHMARK"))
+        {
+            skip("set LL_OBJECT_UPDATE_BENCHMARK to replay object updates");
+        }
+
+        std::vector<Message> messages;
+        const char* capture = getenv("LL_OBJECT_UPDATE_REPLAY_FILE");
+        if (capture)
+        {
+            ensure(std::string("reading ") + capture, read_capture(capture, messages));
+        }
+        else
+        {
+            // a teleport into a busy region
+            messages = make_traffic(15000, 8);
+        }
+        size_t blocks = 0;
+        for (const Message& message : messages)
+        {
+            blocks += message.mBlocks.size();
+        }
+
+        // messages handled per frame, and main thread budget as FSObjectUpdateApplyTime
+        const size_t MESSAGES_PER_FRAME = 150;
+        const F32 APPLY_TIME = 0.002f;
+        const size_t threads = llmax(2u, std::thread::hardware_concurrency() / 2);
+
+        struct FrameStats
+        {
+            F64 mTotal = 0.0;
+            F64 mMax = 0.0;
+            U32 mFrames = 0;
+
+            void add(F64 seconds)
+            {
+                mTotal += seconds;
+                mMax = llmax(mMax, seconds);
+                ++mFrames;
+            }
+
+            void report(const std::string& name, size_t blocks) const
+            {
+                std::cout << name << ": " << mFrames << " frames, main thread "
+                          << (mTotal * 1000.0 / mFrames) << " ms/frame average, "
+                          << (mMax * 1000.0) << " ms max, "
+                          << (U64)(blocks / mTotal) << " blocks/s" << std::endl;
+            }
+        };
+        using clock = std::chrono::steady_clock;
+        auto seconds_since = [](clock::time_point start)
+        { return std::chrono::duration<F64>(clock::now() - start).count(); };
+
+        // Decode throughput of the worker stage alone
+        {
+            std::vector<LLObjectUpdatePipeline::batch_ptr_t> batches;
+            for (const Message& message : messages)
+            {
+                batches.push_back(std::make_shared<Batch>(mRegion));
+                for (size_t i = 0; i < message.mBlocks.size(); ++i)
+                {
+                    batches.back()->addBlock(message.mBlocks[i].data(), (S32)message.mBlocks[i].size(), message.mFlags[i]);
+                }
+            }
+            LL::ThreadPool pool("ObjectUpdateDecodeBenchmark", threads, 1024 * 1024, false);
+            pool.start();
+            auto& queue = pool.getQueue();
+            std::atomic<size_t> remaining(batches.size());
+            clock::time_point start = clock::now();
+            for (auto& batch : batches)
+            {
+                queue.post([batch, &remaining]() { batch->decode(); --remaining; });
+            }
+            while (remaining)
+            {
+                std::this_thread::yield();
+            }
+            F64 seconds = seconds_since(start);
+            pool.close();
+            std::cout << "decode on " << threads << " threads: " << (U64)(blocks / seconds) << " blocks/s, "
+                      << (U64)(messages.size() / seconds) << " messages/s" << std::endl;
+        }
+
+        // Decoding and caching in the message handler, as before
+        {
+            CacheStub cache;
+            FrameStats stats;
+            for (size_t first = 0; first < messages.size(); first += MESSAGES_PER_FRAME)
+            {
+                clock::time_point start = clock::now();
+                for (size_t m = first; m < llmin(first + MESSAGES_PER_FRAME, messages.size()); ++m)
+                {
+                    Batch batch(mRegion);
+                    for (size_t i = 0; i < messages[m].mBlocks.size(); ++i)
+                    {
+                        batch.addBlock(messages[m].mBlocks[i].data(), (S32)messages[m].mBlocks[i].size(), messages[m].mFlags[i]);
+                    }
+                    batch.decode();
+                    for (const Record& record : batch.getRecords())
+                    {
+                        cache.apply(batch, record);
+                    }
+                }
+                stats.add(seconds_since(start));
+            }
+            stats.report("main thread decode", blocks);
+        }
+
+        // The pipeline: the handler copies the blocks, workers decode and
+        // update() applies within the budget
+        {
+            LL::ThreadPool pool("ObjectUpdatePipelineBenchmark", threads, 1024 * 1024, false);
+            pool.start();
+            LL::WorkQueueBase::ptr_t queue = LL::WorkQueueBase::getInstance("ObjectUpdatePipelineBenchmark");
+
+            LLObjectUpdatePipeline pipeline;
+            CacheStub cache;
+            auto apply = [&cache](Batch& batch, const Record& record) { cache.apply(batch, record); };
+            FrameStats stats;
+            size_t next = 0;
+            while (next < messages.size() || !pipeline.isEmpty())
+            {
+                clock::time_point start = clock::now();
+                for (size_t end = llmin(next + MESSAGES_PER_FRAME, messages.size()); next < end; ++next)
+                {
+                    auto batch = std::make_shared<Batch>(mRegion);
+                    for (size_t i = 0; i < messages[next].mBlocks.size(); ++i)
+                    {
+                        batch->addBlock(messages[next].mBlocks[i].data(), (S32)messages[next].mBlocks[i].size(), messages[next].mFlags[i]);
+                    }
+                    pipeline.post(batch, queue);
+                }
+                pipeline.update(APPLY_TIME, apply);
+                stats.add(seconds_since(start));
+            }
+            pool.close();
+            stats.report("pipelined decode", blocks);
+            ensure_equals("all applied", cache.mOrder.size(), blocks);
+        }
+    }
+
+    template<> template<>
+    void objectupdatepipeline_object_t::test<8>()
+    {
+        set_test_name("terse decode benchmark");
+        // Terse updates stay in the message handler: this measures what
+        // the pipeline could take off the main thread for them, against
+        // the copy into a Batch the handler would do instead.
+        // LL_OBJECT_UPDATE_BENCHMARK=1
+        if (!getenv("LL_OBJECT_UPDATE_BENCHMARK"))
+        {
+            skip("set LL_OBJECT_UPDATE_BENCHMARK to time terse updates");
+        }
+
+        // moving avatars and physical objects of a busy region
+        const U32 BLOCKS = 200000;
+        std::vector<std::vector<U8>> blocks;
+        for (U32 i = 0; i < BLOCKS; ++i)
+        {
+            blocks.push_back(make_terse_block(i + 1, (i % 10) == 0));
+        }
+
+        using clock = std::chrono::steady_clock;
+        auto ns_per_block = [BLOCKS](clock::time_point start)
+        { return std::chrono::duration<F64, std::nano>(clock::now() - start).count() / BLOCKS; };
+
+        F32 checksum = 0.f;
+        clock::time_point start = clock::now();
+        for (const std::vector<U8>& block : blocks)
+        {
+            TerseValues values;
+            decode_terse(block.data(), (S32)block.size(), values);
+            checksum += values.mPosition.mV[VX] + values.mRotation.mQ[VW];
+        }
+        const F64 decode_ns = ns_per_block(start);
+
+        start = clock::now();
+        const U32 BLOCKS_PER_MESSAGE = 8;
+        for (U32 first = 0; first < BLOCKS; first += BLOCKS_PER_MESSAGE)
+        {
+            Batch batch(mRegion);
+            for (U32 i = first; i < llmin(first + BLOCKS_PER_MESSAGE, BLOCKS); ++i)
+            {
+                batch.addBlock(blocks[i].data(), (S32)blocks[i].size(), 0);
+            }
+            checksum += (F32)batch.getRecords().size();
+        }
+        const F64 copy_ns = ns_per_block(start);
+
+        std::cout << "terse blocks on the main thread: decode " << decode_ns << " ns/block, "
+                  << "copy into a batch " << copy_ns << " ns/block" << std::endl;
+        ensure("checksum", checksum != 0.f);
+    }
+} // namespace tut
@@ -30,17 +30,26 @@
 #include "lltut.h"
 
 #include "llapr.h"
+#include "llformat.h"
 #include "llmessagetemplate.h"
+#include "llmessagetemplateparser.h"
 #include "llmath.h"
 #include "llquaternion.h"
 #include "lltemplatemessagebuilder.h"
 #include "lltemplatemessagereader.h"
+#include "llzerocode.h"
 #include "message_prehash.h"
 #include "u64.h"
 #include "v3dmath.h"
 #include "v3math.h"
 #include "v4math.h"
 
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
 namespace tut
 {
     static LLTemplateMessageBuilder::message_template_name_map_t nameMap;
@@ -116,6 +125,138 @@ namespace tut
             return reader;
         }
 
+        // The messages of message_template.msg, kept apart from the ones
+        // of the message system
+        struct ViewerTemplates
+        {
+            LLTemplateMessageBuilder::message_template_name_map_t mNames;
+            LLTemplateMessageReader::message_template_number_map_t mNumbers;
+        };
+
+        static void ignoreMessage(LLMessageSystem*, void**)
+        {
+        }
+
+        static ViewerTemplates* viewerTemplates()
+        {
+            static ViewerTemplates* templates = NULL;
+            static bool loaded = false;
+            if (!loaded)
+            {
+                loaded = true;
+                std::string path(__FILE__);
+                path = path.substr(0, path.find_last_of("/\\") + 1) + "../../scripts/messages/message_template.msg";
+                std::ifstream file(path.c_str());
+                if (file)
+                {
+                    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    LLTemplateTokenizer tokens(contents);
+                    LLTemplateParser parsed(tokens);
+                    templates = new ViewerTemplates;
+                    for (LLTemplateParser::message_iterator iter = parsed.getMessagesBegin();
+                         iter != parsed.getMessagesEnd(); ++iter)
+                    {
+                        (*iter)->setHandlerFunc(ignoreMessage, NULL);
+                        templates->mNames[(*iter)->mName] = *iter;
+                        templates->mNumbers[(*iter)->mMessageNumber] = *iter;
+                    }
+                }
+            }
+            return templates;
+        }
+
+        /** Fills every variable with random bytes, zeros included, and
+            returns the packet zero coded like the message system sends it */
+        static std::vector<U8> buildRandomPacket(const ViewerTemplates& templates,
+                                                 const LLMessageTemplate* messageTemplate,
+                                                 std::mt19937& rng,
+                                                 std::vector<std::vector<U8> >& values)
+        {
+            LLTemplateMessageBuilder builder(templates.mNames);
+            builder.newMessage(messageTemplate->mName);
+            for (const LLMessageBlock* block : messageTemplate->mMemberBlocks)
+            {
+                const S32 repeats = block->mType == MBT_SINGLE ? 1 :
+                    (block->mType == MBT_MULTIPLE ? block->mNumber : rng() % 4);
+                for (S32 i = 0; i < repeats; ++i)
+                {
+                    builder.nextBlock(block->mName);
+                    for (const LLMessageVariable* variable : block->mMemberVariables)
+                    {
+                        const S32 size = variable->getType() == MVT_VARIABLE ? rng() % 40 : variable->getSize();
+                        std::vector<U8> value(size);
+                        for (U8& byte : value)
+                        {
+                            byte = (rng() % 3) ? 0 : (U8)rng();
+                        }
+                        builder.addBinaryData(variable->getName(), value.data(), size);
+                        values.push_back(value);
+                    }
+                }
+            }
+
+            U8 buffer[MAX_BUFFER_SIZE];
+            memset(buffer, 0, LL_PACKET_ID_SIZE);
+            U32 size = builder.buildMessage(buffer, MAX_BUFFER_SIZE, 0);
+            U8* packet = buffer;
+            builder.compressMessage(packet, size);
+            return std::vector<U8>(packet, packet + size);
+        }
+
+        /** Reads every variable of the message, like the handlers do */
+        static void readMessageData(LLTemplateMessageReader& reader,
+                                    const LLMessageTemplate* messageTemplate,
+                                    std::vector<std::vector<U8> >& values)
+        {
+            U8 buffer[MAX_BUFFER_SIZE];
+            for (const LLMessageBlock* block : messageTemplate->mMemberBlocks)
+            {
+                const S32 repeats = reader.getNumberOfBlocks(block->mName);
+                for (S32 i = 0; i < repeats; ++i)
+                {
+                    for (const LLMessageVariable* variable : block->mMemberVariables)
+                    {
+                        const S32 size = reader.getSize(block->mName, i, variable->getName());
+                        reader.getBinaryData(block->mName, variable->getName(), buffer, 0, i, size);
+                        values.push_back(std::vector<U8>(buffer, buffer + size));
+                    }
+                }
+            }
+        }
+
+        /** Expands a received packet the way LLMessageSystem::checkMessages()
+            does, returning the message size or 0 */
+        static S32 expandPacket(const std::vector<U8>& packet, U8* buffer, U8* expanded, const U8*& message)
+        {
+            S32 size = (S32)packet.size();
+            if (size < LL_MINIMUM_VALID_PACKET_SIZE || size > MAX_BUFFER_SIZE)
+            {
+                return 0;
+            }
+            memcpy(buffer, packet.data(), size);
+            if (buffer[0] & LL_ACK_FLAG)
+            {
+                const S32 acks = buffer[--size];
+                size -= acks * (S32)sizeof(U32);
+                if (size < LL_MINIMUM_VALID_PACKET_SIZE)
+                {
+                    return 0;
+                }
+            }
+            message = buffer;
+            if (buffer[0] & LL_ZERO_CODE_FLAG)
+            {
+                buffer[0] &= ~LL_ZERO_CODE_FLAG;
+                S32 expanded_size = 0;
+                if (LLZeroCode::expand(buffer, size, expanded, MAX_BUFFER_SIZE, expanded_size) != LLZeroCode::EXPAND_OK)
+                {
+                    return 0;
+                }
+                message = expanded;
+                size = expanded_size;
+            }
+            return size;
+        }
     };
 
     typedef test_group<LLTemplateMessageBuilderTestData>    LLTemplateMessageBuilderTestGroup;
@@ -967,5 +1108,270 @@ namespace tut
         ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
         delete reader;
     }
-}
 
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<46>()
+        // repeated blocks, sizes and copy to a builder
+    {
+        LLMessageTemplate messageTemplate = defaultTemplate();
+        messageTemplate.addBlock(defaultBlock(MVT_U32, 4, MBT_SINGLE));
+        LLMessageBlock* multiple = new LLMessageBlock(_PREHASH_Test1, MBT_MULTIPLE, 2);
+        multiple->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U16, 2);
+        multiple->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 1);
+        messageTemplate.addBlock(multiple);
+        LLMessageBlock* variable = new LLMessageBlock(_PREHASH_Test2, MBT_VARIABLE);
+        variable->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+        variable->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 2);
+        messageTemplate.addBlock(variable);
+
+        LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+        builder->addU32(_PREHASH_Test0, 7);
+        for (S32 i = 0; i < 2; ++i)
+        {
+            builder->nextBlock(_PREHASH_Test1);
+            builder->addU16(_PREHASH_Test0, (U16)(100 + i));
+            builder->addString(_PREHASH_Test1, llformat("multiple %d", i));
+        }
+        std::vector<U8> data(200);
+        for (S32 i = 0; i < 3; ++i)
+        {
+            builder->nextBlock(_PREHASH_Test2);
+            builder->addU32(_PREHASH_Test0, i * 1000);
+            memset(&data[0], 'a' + i, data.size());
+            builder->addBinaryData(_PREHASH_Test1, &data[0], i * 100);
+        }
+        LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+
+        for (S32 pass = 0; pass < 2; ++pass)
+        {
+            ensure_equals("single blocks", reader->getNumberOfBlocks(_PREHASH_Test0), 1);
+            ensure_equals("multiple blocks", reader->getNumberOfBlocks(_PREHASH_Test1), 2);
+            ensure_equals("variable blocks", reader->getNumberOfBlocks(_PREHASH_Test2), 3);
+
+            U32 u32 = 0;
+            reader->getU32(_PREHASH_Test0, _PREHASH_Test0, u32);
+            ensure_equals("single value", u32, 7U);
+            for (S32 i = 0; i < 2; ++i)
+            {
+                // out of template order
+                std::string str;
+                reader->getString(_PREHASH_Test1, _PREHASH_Test1, str, i);
+                ensure_equals("multiple string", str, llformat("multiple %d", i));
+                U16 u16 = 0;
+                reader->getU16(_PREHASH_Test1, _PREHASH_Test0, u16, i);
+                ensure_equals("multiple value", u16, (U16)(100 + i));
+            }
+            for (S32 i = 0; i < 3; ++i)
+            {
+                reader->getU32(_PREHASH_Test2, _PREHASH_Test0, u32, i);
+                ensure_equals("variable value", u32, (U32)(i * 1000));
+                ensure_equals("variable size", reader->getSize(_PREHASH_Test2, i, _PREHASH_Test1), i * 100);
+                std::vector<U8> out(i * 100 + 1, 0);
+                reader->getBinaryData(_PREHASH_Test2, _PREHASH_Test1, &out[0], i * 100, i);
+                ensure_equals("variable data", std::string(out.begin(), out.end() - 1), std::string(i * 100, 'a' + i));
+            }
+
+            ensure_equals("single size", reader->getSize(_PREHASH_Test0, _PREHASH_Test0), 4);
+            ensure_equals("missing block", reader->getSize(_PREHASH_Test2, 3, _PREHASH_Test0), LL_BLOCK_NOT_IN_MESSAGE);
+            ensure_equals("missing variable", reader->getSize(_PREHASH_Test0, _PREHASH_Test2), LL_VARIABLE_NOT_IN_BLOCK);
+            ensure_equals("unknown block", reader->getNumberOfBlocks(_PREHASH_TestMessage), 0);
+
+            // the copy must read back the same
+            LLTemplateMessageBuilder* copy = new LLTemplateMessageBuilder(nameMap);
+            copy->newMessage(_PREHASH_TestMessage);
+            reader->copyToBuilder(*copy);
+            delete reader;
+            reader = setReader(messageTemplate, copy);
+        }
+        delete reader;
+    }
+
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<47>()
+        // every message of message_template.msg through zero coding and the reader
+    {
+        defaultTemplate();
+        ViewerTemplates* templates = viewerTemplates();
+        if (!templates)
+        {
+            skip("message_template.msg not found");
+        }
+
+        std::mt19937 rng(2024);
+        U8 buffer[MAX_BUFFER_SIZE];
+        U8 expanded[MAX_BUFFER_SIZE];
+        LLTemplateMessageReader reader(templates->mNumbers);
+        for (S32 pass = 0; pass < 4; ++pass)
+        {
+            for (const auto& entry : templates->mNumbers)
+            {
+                const LLMessageTemplate* messageTemplate = entry.second;
+                if (messageTemplate->isUdpBanned())
+                {
+                    continue;
+                }
+
+                std::vector<std::vector<U8> > values;
+                std::vector<U8> packet = buildRandomPacket(*templates, messageTemplate, rng, values);
+                const U8* message = NULL;
+                S32 size = expandPacket(packet, buffer, expanded, message);
+                ensure(std::string("expanded ") + messageTemplate->mName, size > 0);
+
+                reader.clearMessage();
+                ensure(std::string("valid ") + messageTemplate->mName, reader.validateMessage(message, size, LLHost()));
+                reader.readMessage(message, LLHost());
+                ensure_equals("message name", std::string(reader.getMessageName()), std::string(messageTemplate->mName));
+
+                std::vector<std::vector<U8> > read;
+                readMessageData(reader, messageTemplate, read);
+                ensure(std::string("data of ") + messageTemplate->mName, read == values);
+            }
+        }
+    }
+
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<48>()
+        // replay benchmark
+    {
+        // Runs packets through zero code expansion and the reader, reading
+        // every variable like the handlers do, and reports packets per
+        // second. By default the packets are object updates built from the
+        // templates, or they come from a capture of the UDP payloads the
+        // viewer received, each preceded by its size as a little endian U32:
+        // LL_MESSAGE_REPLAY_BENCHMARK=1 LL_MESSAGE_REPLAY_FILE=/path/to/capture
+        const char* benchmark = getenv("LL_MESSAGE_REPLAY_BENCHMARK");
+        if (!benchmark || !*benchmark)
+        {
+            skip("set LL_MESSAGE_REPLAY_BENCHMARK to run the message replay benchmark");
+        }
+        defaultTemplate();
+        ViewerTemplates* templates = viewerTemplates();
+        if (!templates)
+        {
+            skip("message_template.msg not found");
+        }
+
+        std::vector<std::vector<U8> > packets;
+        const char* capture = getenv("LL_MESSAGE_REPLAY_FILE");
+        if (capture && *capture)
+        {
+            std::ifstream file(capture, std::ios::binary);
+            U8 size_bytes[4];
+            while (file.read((char*)size_bytes, sizeof(size_bytes)))
+            {
+                const U32 size = size_bytes[0] | (size_bytes[1] << 8) | (size_bytes[2] << 16) | ((U32)size_bytes[3] << 24);
+                std::vector<U8> packet(llmin(size, (U32)MAX_BUFFER_SIZE + 1));
+                if (packet.size() > MAX_BUFFER_SIZE || !file.read((char*)&packet[0], packet.size()))
+                {
+                    break;
+                }
+                packets.push_back(packet);
+            }
+            ensure("packets in LL_MESSAGE_REPLAY_FILE", !packets.empty());
+        }
+        else
+        {
+            // the bulk of what a region sends
+            const char* names[] = { "ObjectUpdate", "ImprovedTerseObjectUpdate", "ObjectUpdateCompressed",
+                                    "ObjectUpdateCached", "CoarseLocationUpdate", "AvatarAnimation" };
+            std::mt19937 rng(42);
+            for (S32 i = 0; i < 60000; ++i)
+            {
+                const char* name = LLMessageStringTable::getInstance()->getString(names[i % LL_ARRAY_SIZE(names)]);
+                LLTemplateMessageBuilder::message_template_name_map_t::const_iterator iter = templates->mNames.find(name);
+                ensure(name, iter != templates->mNames.end());
+                std::vector<std::vector<U8> > values;
+                packets.push_back(buildRandomPacket(*templates, iter->second, rng, values));
+            }
+        }
+
+        U8 buffer[MAX_BUFFER_SIZE];
+        U8 expanded[MAX_BUFFER_SIZE];
+        std::vector<std::vector<U8> > values;
+        LLTemplateMessageReader reader(templates->mNumbers);
+        const S32 passes = 10;
+        size_t decoded = 0;
+        size_t bytes = 0;
+        typedef std::chrono::high_resolution_clock clock;
+        clock::time_point start = clock::now();
+        for (S32 pass = 0; pass < passes; ++pass)
+        {
+            for (const std::vector<U8>& packet : packets)
+            {
+                const U8* message = NULL;
+                S32 size = expandPacket(packet, buffer, expanded, message);
+                reader.clearMessage();
+                if (size && reader.validateMessage(message, size, LLHost()) && reader.readMessage(message, LLHost()))
+                {
+                    LLTemplateMessageBuilder::message_template_name_map_t::const_iterator iter =
+                        templates->mNames.find(reader.getMessageName());
+                    values.clear();
+                    readMessageData(reader, iter->second, values);
+                    bytes += size;
+                    ++decoded;
+                }
+            }
+        }
+        F64 seconds = std::chrono::duration<F64>(clock::now() - start).count();
+
+        std::cout << "replayed " << packets.size() << " packets " << passes << " times, " << decoded << " decoded: "
+                  << decoded / seconds << " packets/s, " << bytes / seconds / 1e6 << " MB/s expanded" << std::endl;
+    }
+
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<49>()
+        // indexed access matches access by name
+    {
+        LLMessageTemplate messageTemplate = defaultTemplate();
+        messageTemplate.addBlock(defaultBlock(MVT_U32, 4, MBT_SINGLE));
+        LLMessageBlock* variable = new LLMessageBlock(_PREHASH_Test1, MBT_VARIABLE);
+        variable->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+        variable->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 2);
+        messageTemplate.addBlock(variable);
+
+        const S32 single = messageTemplate.getBlockIndex(_PREHASH_Test0);
+        const S32 repeated = messageTemplate.getBlockIndex(_PREHASH_Test1);
+        ensure("single index", single >= 0);
+        ensure("repeated index", repeated >= 0);
+        ensure_equals("unknown block index", messageTemplate.getBlockIndex(_PREHASH_Test2), -1);
+        const S32 single_value = messageTemplate.getVariableIndex(single, _PREHASH_Test0);
+        const S32 repeated_value = messageTemplate.getVariableIndex(repeated, _PREHASH_Test0);
+        const S32 repeated_data = messageTemplate.getVariableIndex(repeated, _PREHASH_Test1);
+        ensure_equals("unknown variable index", messageTemplate.getVariableIndex(single, _PREHASH_Test1), -1);
+
+        // written by index, read by name
+        LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+        builder->addU32(_PREHASH_Test0, 7);
+        std::vector<U8> data(200);
+        for (S32 i = 0; i < 3; ++i)
+        {
+            builder->nextBlockAt(repeated);
+            U32 value = i * 1000;
+            builder->addBinaryDataAt(repeated_value, &value, sizeof(value));
+            memset(&data[0], 'a' + i, data.size());
+            builder->addBinaryDataAt(repeated_data, &data[0], i * 100);
+        }
+        LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+        ensure_equals("message template", reader->getMessageTemplate()->mName, messageTemplate.mName);
+
+        ensure_equals("single blocks", reader->getNumberOfBlocksAt(single), reader->getNumberOfBlocks(_PREHASH_Test0));
+        ensure_equals("repeated blocks", reader->getNumberOfBlocksAt(repeated), 3);
+        U32 u32 = 0;
+        reader->getBinaryDataAt(single, single_value, &u32, sizeof(u32));
+        ensure_equals("single value", u32, 7U);
+        for (S32 i = 0; i < 3; ++i)
+        {
+            reader->getU32(_PREHASH_Test1, _PREHASH_Test0, u32, i);
+            ensure_equals("repeated value by name", u32, (U32)(i * 1000));
+            reader->getBinaryDataAt(repeated, repeated_value, &u32, sizeof(u32), i);
+            ensure_equals("repeated value", u32, (U32)(i * 1000));
+
+            ensure_equals("repeated size", reader->getSizeAt(repeated, i, repeated_data), reader->getSize(_PREHASH_Test1, i, _PREHASH_Test1));
+            std::vector<U8> out(i * 100 + 1, 0);
+            reader->getBinaryDataAt(repeated, repeated_data, &out[0], i * 100, i);
+            ensure_equals("repeated data", std::string(out.begin(), out.end() - 1), std::string(i * 100, 'a' + i));
+        }
+        ensure_equals("missing block", reader->getSizeAt(repeated, 3, repeated_value), LL_BLOCK_NOT_IN_MESSAGE);
+        delete reader;
+    }
+}